@@ -4,6 +4,9 @@
 #include "uscxml/debug/InterpreterIssue.h"
 #include "uscxml/debug/DebuggerServlet.h"
 #include "uscxml/interpreter/InterpreterMonitor.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/transform/NativeMicroStep.h"
+#include "uscxml/util/Convenience.h"
 #include "uscxml/util/DOM.h"
 
 #include "uscxml/interpreter/Logging.h"
@@ -86,6 +89,12 @@ int main(int argc, char** argv) {
 
 				}
 
+				if (envVarIsTrue("USCXML_NATIVE_MICROSTEP")) {
+					ActionLanguage al;
+					al.microStepper = MicroStep(std::shared_ptr<MicroStepImpl>(new NativeMicroStep(interpreter.getImpl().get())));
+					interpreter.setActionLanguage(al);
+				}
+
 				if (options.verbose) {
 					StateTransitionMonitor* vm = new StateTransitionMonitor();
 					vm->copyToInvokers(true);
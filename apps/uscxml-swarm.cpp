@@ -0,0 +1,605 @@
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/util/String.h"
+#include "uscxml/transform/ChartToPromela.h"
+
+#include <boost/algorithm/string.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#include <direct.h>
+#include <windows.h>
+#endif
+
+#include "getopt.h"
+
+#include "uscxml/interpreter/Logging.h"
+
+/**
+ * Transforms a chart to promela, builds the verifier once and runs a swarm
+ * of pan searches with different seeds, search depths and hash functions on
+ * all cores. Counterexamples are replayed with spin and their trace mapped
+ * back onto the states and transitions of the chart.
+ */
+
+using namespace uscxml;
+
+/// One search of the swarm and what pan reported
+struct SwarmRun {
+	size_t index = 0;
+	size_t seed = 0;
+	size_t depth = 0;
+	size_t hashFunctions = 0;
+	size_t hashBits = 0;
+	std::string dir;
+
+	bool completed = false;
+	bool commandFailed = false; ///< pan or the trail replay exited with an error
+	size_t statesStored = 0;
+	size_t depthReached = 0;
+	size_t errors = 0;
+	double elapsed = 0;
+	std::string error;
+
+	std::map<std::string, size_t> totalPerProctype;
+	std::map<std::string, std::set<std::string> > unreachedPerProctype;
+
+	std::string counterExample;
+};
+
+void printUsageAndExit(const char* progName) {
+	// remove path from program name
+	std::string progStr(progName);
+	if (progStr.find_last_of(PATH_SEPERATOR) != std::string::npos) {
+		progStr = progStr.substr(progStr.find_last_of(PATH_SEPERATOR) + 1, progStr.length() - (progStr.find_last_of(PATH_SEPERATOR) + 1));
+	}
+
+	printf("%s version " USCXML_VERSION " (" CMAKE_BUILD_TYPE " build - " CMAKE_COMPILER_STRING ")\n", progStr.c_str());
+	printf("Usage\n");
+	printf("\t%s", progStr.c_str());
+	printf(" [-j JOBS] [-n RUNS] [-m DEPTH] [-w BITS] [-s SEED] [-X {PARAMETER}] [-o DIR] -i URL");
+	printf("\n");
+	printf("Options\n");
+	printf("\t-i URL         : SCXML document with the promela datamodel to verify\n");
+	printf("\t-o DIR         : Directory for the model, the verifier and the runs (defaults to NAME.swarm)\n");
+	printf("\t-j JOBS        : Searches to run in parallel (defaults to the number of cores)\n");
+	printf("\t-n RUNS        : Searches in total (defaults to JOBS)\n");
+	printf("\t-m DEPTH       : Depth bound of the deepest search, others get a half, quarter and eighth (defaults to 10000)\n");
+	printf("\t-w BITS        : log2 of the bitstate hash array size in bits (defaults to 24)\n");
+	printf("\t-s SEED        : Seed of the first search, the others count up (defaults to 1)\n");
+	printf("\t-X {PARAMETER} : pass additional parameters to the transformation (see uscxml-transform)\n");
+	printf("\t-v             : be verbose\n");
+	printf("\n");
+	printf("Environment\n");
+	printf("\tSPIN           : spin binary (defaults to spin)\n");
+	printf("\tCC             : compiler for the verifier (defaults to cc)\n");
+	printf("\n");
+	exit(1);
+}
+
+static std::string fromEnv(const char* key, const std::string& fallback) {
+	const char* value = getenv(key);
+	return (value != NULL && strlen(value) > 0 ? value : fallback);
+}
+
+static std::string readFile(const std::string& path) {
+	std::ifstream file(path.c_str());
+	std::stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+static bool isDirectory(const std::string& path) {
+	struct stat fileStat;
+	return (stat(path.c_str(), &fileStat) == 0 && (fileStat.st_mode & S_IFMT) == S_IFDIR);
+}
+
+static std::string dirName(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	if (slash == std::string::npos)
+		return ".";
+	return path.substr(0, slash);
+}
+
+static bool makeDirectories(const std::string& path) {
+	if (path.empty() || isDirectory(path))
+		return true;
+	if (!makeDirectories(dirName(path)))
+		return false;
+#ifndef WIN32
+	return mkdir(path.c_str(), 0755) == 0 || isDirectory(path);
+#else
+	return _mkdir(path.c_str()) == 0 || isDirectory(path);
+#endif
+}
+
+static bool copyFile(const std::string& from, const std::string& to) {
+	std::ifstream in(from.c_str(), std::ios::binary);
+	std::ofstream out(to.c_str(), std::ios::binary);
+	if (!in || !out)
+		return false;
+	out << in.rdbuf();
+	return out.good();
+}
+
+/**
+ * Run a program with the given arguments in workDir and wait for it, stdout
+ * and stderr go to outFile in workDir. Nothing is passed through a shell, so
+ * paths from the command line or the environment are never interpreted.
+ */
+static bool runCommand(const std::vector<std::string>& args, const std::string& workDir, const std::string& outFile, bool verbose) {
+	if (verbose) {
+		std::cerr << "(" << workDir << ")";
+		for (auto& arg : args)
+			std::cerr << " " << arg;
+		std::cerr << " > " << outFile << std::endl;
+	}
+
+#ifndef WIN32
+	std::vector<char*> argv;
+	for (auto& arg : args)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(NULL);
+
+	pid_t pid = fork();
+	if (pid < 0)
+		return false;
+
+	if (pid == 0) {
+		// only async-signal-safe calls in the child
+		if (chdir(workDir.c_str()) != 0)
+			_exit(127);
+		int fd = open(outFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			_exit(127);
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+		execvp(argv[0], &argv[0]);
+		_exit(127);
+	}
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+	// quote every argument as the C runtime of the child will split them again
+	std::string commandLine;
+	for (auto& arg : args) {
+		if (commandLine.size() > 0)
+			commandLine += " ";
+		commandLine += "\"" + arg + "\"";
+	}
+
+	SECURITY_ATTRIBUTES security;
+	security.nLength = sizeof(security);
+	security.lpSecurityDescriptor = NULL;
+	security.bInheritHandle = TRUE;
+
+	HANDLE out = CreateFileA((workDir + PATH_SEPERATOR + outFile).c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (out == INVALID_HANDLE_VALUE)
+		return false;
+
+	STARTUPINFOA startup;
+	ZeroMemory(&startup, sizeof(startup));
+	startup.cb = sizeof(startup);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	startup.hStdOutput = out;
+	startup.hStdError = out;
+
+	PROCESS_INFORMATION process;
+	ZeroMemory(&process, sizeof(process));
+
+	std::vector<char> mutableCommandLine(commandLine.begin(), commandLine.end());
+	mutableCommandLine.push_back(0);
+
+	if (!CreateProcessA(NULL, &mutableCommandLine[0], NULL, NULL, TRUE, 0, NULL, workDir.c_str(), &startup, &process)) {
+		CloseHandle(out);
+		return false;
+	}
+	WaitForSingleObject(process.hProcess, INFINITE);
+
+	DWORD exitCode = 1;
+	GetExitCodeProcess(process.hProcess, &exitCode);
+	CloseHandle(process.hProcess);
+	CloseHandle(process.hThread);
+	CloseHandle(out);
+	return exitCode == 0;
+#endif
+}
+
+/// Number in front of marker in e.g. "14 states, stored" or after it in "errors: 1"
+static size_t numberBefore(const std::string& text, const std::string& marker) {
+	size_t end = text.find(marker);
+	if (end == std::string::npos)
+		return 0;
+	size_t start = text.find_last_not_of(" \t", end - 1);
+	if (start == std::string::npos)
+		return 0;
+	size_t begin = text.find_last_of(" \t\n", start);
+	return strTo<size_t>(text.substr(begin + 1, start - begin));
+}
+
+static double numberAfter(const std::string& text, const std::string& marker) {
+	size_t start = text.find(marker);
+	if (start == std::string::npos)
+		return 0;
+	start += marker.size();
+	size_t end = text.find_first_of(" \t\n,", start);
+	return strTo<double>(text.substr(start, end - start));
+}
+
+static void parsePanOutput(SwarmRun& run, const std::string& output) {
+	run.completed = (output.find("State-vector") != std::string::npos);
+	run.statesStored = numberBefore(output, " states, stored");
+	run.depthReached = (size_t)numberAfter(output, "depth reached ");
+	run.errors = (size_t)numberAfter(output, "errors: ");
+	run.elapsed = numberAfter(output, "pan: elapsed time ");
+
+	std::stringstream lines(output);
+	std::string line;
+	std::string proctype;
+	while (std::getline(lines, line)) {
+		// "pan:1: acceptance cycle (at depth 12)"
+		if (run.error.size() == 0 && boost::starts_with(line, "pan:") && line.size() > 4 && isdigit(line[4])) {
+			run.error = boost::trim_copy(line.substr(line.find(':', 4) + 1));
+			continue;
+		}
+		// "unreached in proctype ROOT_step" followed by tab indented statements
+		if (boost::starts_with(line, "unreached in ")) {
+			proctype = line.substr(strlen("unreached in "));
+			run.unreachedPerProctype[proctype];
+			continue;
+		}
+		if (proctype.size() == 0)
+			continue;
+		if (!boost::starts_with(line, "\t")) {
+			proctype.clear();
+			continue;
+		}
+
+		size_t statePos = line.find(", state ");
+		if (statePos != std::string::npos) {
+			size_t end = line.find(',', statePos + 8);
+			run.unreachedPerProctype[proctype].insert(line.substr(statePos + 8, end - statePos - 8));
+		} else if (line.find(" states)") != std::string::npos) {
+			// "(3 of 412 states)"
+			run.totalPerProctype[proctype] = (size_t)numberAfter(line, " of ");
+		}
+	}
+}
+
+static std::string mapBits(const std::string& bits, const std::vector<std::string>& names, const std::string& separator) {
+	std::string mapped;
+	for (size_t i = 0; i < bits.size() && i < names.size(); i++) {
+		if (bits[i] != '1')
+			continue;
+		mapped += (mapped.size() > 0 ? separator : "") + names[i];
+	}
+	return mapped;
+}
+
+/// Map the trace the promela model prints when replaying a trail onto the chart
+static std::string mapTrail(const std::string& output, const std::map<std::string, ChartToPromela::NameMapping>& mappings) {
+	std::stringstream mapped;
+	std::stringstream lines(output);
+	std::string line;
+	std::string lastConfig;
+
+	while (std::getline(lines, line)) {
+		boost::trim(line);
+		if (line.find("START OF CYCLE") != std::string::npos) {
+			mapped << "  -- cycle --" << std::endl;
+			continue;
+		}
+		// "[ROOT] Configuration: 0110" and "[ROOT] Selected Transitions: 001"
+		if (!boost::starts_with(line, "["))
+			continue;
+		size_t idEnd = line.find("] ");
+		size_t colon = line.find(": ", idEnd);
+		if (idEnd == std::string::npos || colon == std::string::npos)
+			continue;
+
+		std::string invokerId = line.substr(1, idEnd - 1);
+		std::string kind = line.substr(idEnd + 2, colon - idEnd - 2);
+		std::string bits = boost::trim_copy(line.substr(colon + 2));
+
+		auto mapping = mappings.find(invokerId);
+		if (mapping == mappings.end())
+			continue;
+
+		if (kind == "Configuration") {
+			std::string config = invokerId + " in {" + mapBits(bits, mapping->second.states, ", ") + "}";
+			if (config != lastConfig)
+				mapped << "  " << config << std::endl;
+			lastConfig = config;
+		} else if (kind == "Selected Transitions") {
+			std::string transitions = mapBits(bits, mapping->second.transitions, "; ");
+			if (transitions.size() > 0)
+				mapped << "    " << invokerId << " takes " << transitions << std::endl;
+		}
+	}
+	return mapped.str();
+}
+
+int main(int argc, char** argv) {
+	bool verbose = false;
+	std::string inputFile;
+	std::string outDir;
+	size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+	size_t nrRuns = 0;
+	size_t maxDepth = 10000;
+	size_t hashBits = 24;
+	size_t firstSeed = 1;
+	std::multimap<std::string, std::string> extensions;
+
+	optind = 0;
+	opterr = 0;
+
+	struct option longOptions[] = {
+		{"verbose",       no_argument,       0, 'v'},
+		{"param",         required_argument, 0, 'X'},
+		{"input-file",    required_argument, 0, 'i'},
+		{"output-dir",    required_argument, 0, 'o'},
+		{"jobs",          required_argument, 0, 'j'},
+		{"runs",          required_argument, 0, 'n'},
+		{"depth",         required_argument, 0, 'm'},
+		{"hash-bits",     required_argument, 0, 'w'},
+		{"seed",          required_argument, 0, 's'},
+		{0, 0, 0, 0}
+	};
+
+	int optionInd = 0;
+	int option;
+	for (;;) {
+		option = getopt_long_only(argc, argv, "+vX:i:o:j:n:m:w:s:", longOptions, &optionInd);
+		if (option == -1) {
+			break;
+		}
+		switch(option) {
+		case 'v':
+			verbose = true;
+			break;
+		case 'i':
+			inputFile = optarg;
+			break;
+		case 'o':
+			outDir = optarg;
+			break;
+		case 'j':
+			jobs = strTo<size_t>(optarg);
+			break;
+		case 'n':
+			nrRuns = strTo<size_t>(optarg);
+			break;
+		case 'm':
+			maxDepth = strTo<size_t>(optarg);
+			break;
+		case 'w':
+			hashBits = strTo<size_t>(optarg);
+			break;
+		case 's':
+			firstSeed = strTo<size_t>(optarg);
+			break;
+		case 'X': {
+			std::list<std::string> extension = tokenize(optarg, '=');
+			if (extension.size() != 2)
+				printUsageAndExit(argv[0]);
+			std::string key = boost::trim_copy(*(extension.begin()));
+			std::string value = boost::trim_copy(*(++extension.begin()));
+			extensions.insert(std::pair<std::string, std::string>(key, value));
+		}
+		break;
+		default:
+			break;
+		}
+	}
+
+	if (inputFile.size() == 0 || jobs == 0)
+		printUsageAndExit(argv[0]);
+	if (nrRuns == 0)
+		nrRuns = jobs;
+
+	std::string modelName = inputFile.substr(inputFile.find_last_of(PATH_SEPERATOR) == std::string::npos ? 0 : inputFile.find_last_of(PATH_SEPERATOR) + 1);
+	if (modelName.find_last_of(".") != std::string::npos)
+		modelName = modelName.substr(0, modelName.find_last_of("."));
+	if (outDir.size() == 0)
+		outDir = modelName + ".swarm";
+	modelName += ".pml";
+
+	std::string spin = fromEnv("SPIN", "spin");
+	std::string compiler = fromEnv("CC", "cc");
+
+	// transform and keep the name mapping of states and transitions
+	std::map<std::string, ChartToPromela::NameMapping> mappings;
+	try {
+		Interpreter interpreter = Interpreter::fromURL(inputFile);
+		if (!interpreter) {
+			LOGD(USCXML_ERROR) << "Cannot create interpreter from " << inputFile << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (!makeDirectories(outDir)) {
+			LOGD(USCXML_ERROR) << "Cannot create " << outDir << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		Transformer transformer = ChartToPromela::transform(interpreter);
+		transformer.setExtensions(extensions);
+
+		std::ofstream outStream((outDir + PATH_SEPERATOR + modelName).c_str());
+		transformer.writeTo(outStream);
+		outStream.close();
+
+		mappings = std::static_pointer_cast<ChartToPromela>(transformer.getImpl())->getNameMappings();
+	} catch (Event e) {
+		std::cout << e << std::endl;
+		return EXIT_FAILURE;
+	} catch (const std::exception &e) {
+		std::cout << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// build one verifier, the searches differ by runtime parameters only
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!runCommand({ spin, "-a", modelName }, outDir, "spin.out", verbose)) {
+		std::cerr << readFile(outDir + PATH_SEPERATOR + "spin.out");
+		LOGD(USCXML_ERROR) << "Cannot generate the verifier with " << spin << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::vector<std::string> compile = { compiler, "-DMEMLIM=1024", "-DVECTORSZ=8192", "-DBITSTATE", "-DT_RAND", "-DP_RAND", "-DXUSAFE", "-O2", "-w", "-o", "pan", "pan.c" };
+	if (!runCommand(compile, outDir, "cc.out", verbose)) {
+		std::cerr << readFile(outDir + PATH_SEPERATOR + "cc.out");
+		LOGD(USCXML_ERROR) << "Cannot compile the verifier with " << compiler << std::endl;
+		return EXIT_FAILURE;
+	}
+	double buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// vary seed, depth bound and hash functions, the seed randomizes the search order
+	std::vector<SwarmRun> runs(nrRuns);
+	for (size_t i = 0; i < nrRuns; i++) {
+		runs[i].index = i;
+		runs[i].seed = firstSeed + i;
+		runs[i].depth = std::max(maxDepth >> (i % 4), (size_t)100);
+		runs[i].hashFunctions = 1 + (i / 4) % 3;
+		runs[i].hashBits = hashBits;
+		runs[i].dir = outDir + PATH_SEPERATOR + "run" + toStr(i);
+	}
+
+	std::atomic<size_t> nextRun(0);
+	auto worker = [&]() {
+		for (size_t i = nextRun++; i < runs.size(); i = nextRun++) {
+			SwarmRun& run = runs[i];
+			if (!makeDirectories(run.dir)) {
+				run.error = "Cannot create " + run.dir;
+				continue;
+			}
+			std::vector<std::string> search = { std::string("..") + PATH_SEPERATOR + "pan", "-a",
+			                                    "-RS" + toStr(run.seed),
+			                                    "-m" + toStr(run.depth),
+			                                    "-k" + toStr(run.hashFunctions),
+			                                    "-w" + toStr(run.hashBits)
+			                                  };
+			if (!runCommand(search, run.dir, "pan.out", verbose))
+				run.commandFailed = true;
+			parsePanOutput(run, readFile(run.dir + PATH_SEPERATOR + "pan.out"));
+
+			if (run.errors == 0)
+				continue;
+
+			// spin replays the trail next to a copy of the model
+			if (!copyFile(outDir + PATH_SEPERATOR + modelName, run.dir + PATH_SEPERATOR + modelName) ||
+			        !runCommand({ spin, "-T", "-t", modelName }, run.dir, "trail.out", verbose)) {
+				run.commandFailed = true;
+				continue;
+			}
+			run.counterExample = mapTrail(readFile(run.dir + PATH_SEPERATOR + "trail.out"), mappings);
+		}
+	};
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < std::min(jobs, nrRuns); i++) {
+		threads.push_back(std::thread(worker));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double swarmTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// report per run, throughput, coverage and distinct counterexamples
+	size_t totalStates = 0;
+	std::cout << "run      seed     depth  k   w        states   reached  errors   time" << std::endl;
+	for (auto& run : runs) {
+		totalStates += run.statesStored;
+		std::cout << std::left << std::setw(9) << run.index
+		          << std::setw(9) << run.seed
+		          << std::setw(7) << run.depth
+		          << std::setw(4) << run.hashFunctions
+		          << std::setw(4) << run.hashBits
+		          << std::right << std::setw(11) << run.statesStored
+		          << std::setw(10) << run.depthReached
+		          << std::setw(8) << (run.completed ? toStr(run.errors) : "failed")
+		          << std::setw(7) << std::fixed << std::setprecision(2) << run.elapsed
+		          << std::left << std::endl;
+	}
+	std::cout << std::endl;
+	std::cout << "Verifier built in " << buildTime << "s" << std::endl;
+	std::cout << nrRuns << " searches on " << std::min(jobs, nrRuns) << " cores in " << swarmTime << "s: "
+	          << totalStates << " states, " << std::setprecision(0) << (swarmTime > 0 ? totalStates / swarmTime : 0) << " states/s" << std::endl;
+	std::cout << std::setprecision(1);
+
+	// a statement is covered if any of the searches reached it
+	std::map<std::string, size_t> totalPerProctype;
+	std::map<std::string, std::set<std::string> > unreachedPerProctype;
+	for (auto& run : runs) {
+		for (auto& proctype : run.unreachedPerProctype) {
+			if (totalPerProctype.find(proctype.first) == totalPerProctype.end()) {
+				totalPerProctype[proctype.first] = run.totalPerProctype[proctype.first];
+				unreachedPerProctype[proctype.first] = proctype.second;
+				continue;
+			}
+			std::set<std::string> stillUnreached;
+			for (auto& state : unreachedPerProctype[proctype.first]) {
+				if (proctype.second.find(state) != proctype.second.end())
+					stillUnreached.insert(state);
+			}
+			unreachedPerProctype[proctype.first] = stillUnreached;
+		}
+	}
+	for (auto& proctype : totalPerProctype) {
+		size_t unreached = unreachedPerProctype[proctype.first].size();
+		std::cout << "Coverage of " << proctype.first << ": " << (proctype.second - unreached) << " of " << proctype.second << " statements";
+		if (proctype.second > 0)
+			std::cout << " (" << 100.0 * (proctype.second - unreached) / proctype.second << "%)";
+		std::cout << std::endl;
+	}
+
+	std::map<std::string, std::list<size_t> > counterExamples;
+	for (auto& run : runs) {
+		if (run.errors > 0)
+			counterExamples[run.error + "\n" + run.counterExample].push_back(run.index);
+	}
+	for (auto& counterExample : counterExamples) {
+		std::cout << std::endl << "Counterexample found by run";
+		for (auto index : counterExample.second) {
+			std::cout << " " << index;
+		}
+		std::cout << ", trail in " << runs[counterExample.second.front()].dir << ":" << std::endl;
+		std::cout << "  " << counterExample.first;
+	}
+
+	// a swarm with searches that did not run through proves nothing
+	bool allRan = true;
+	for (auto& run : runs) {
+		if (!run.completed) {
+			std::cout << std::endl << "Run " << run.index << " did not complete, see " << run.dir << PATH_SEPERATOR << "pan.out" << std::endl;
+			allRan = false;
+		} else if (run.commandFailed) {
+			std::cout << std::endl << "Run " << run.index << " exited with an error, see " << run.dir << std::endl;
+			allRan = false;
+		}
+	}
+
+	return (counterExamples.size() > 0 || !allRan ? EXIT_FAILURE : EXIT_SUCCESS);
+}
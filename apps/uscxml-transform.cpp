@@ -1,15 +1,43 @@
 #include "uscxml/config.h"
 #include "uscxml/Interpreter.h"
 #include "uscxml/util/String.h"
+#include "uscxml/util/Convenience.h"
 #include "uscxml/transform/ChartToC.h"
+#include "uscxml/transform/ChartToCpp.h"
 #include "uscxml/transform/ChartToJava.h"
+#if defined(WITH_DM_PROMELA) || defined(BUILD_AS_PLUGINS)
+#include "uscxml/transform/ChartToPromela.h"
+#endif
 #include "uscxml/transform/ChartToVHDL.h"
 
+#include "uscxml/util/MD5.hpp"
+#include "uscxml/util/DOM.h"
+
 #include <boost/algorithm/string.hpp>
 
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
+
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <iomanip>
 #include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef WIN32
+#include <dirent.h>
+#else
+#include <direct.h>
+#endif
 
 #include "uscxml/plugins/Factory.h"
 #include "uscxml/server/HTTPServer.h"
@@ -30,28 +58,479 @@ void printUsageAndExit(const char* progName) {
 	printf("%s version " USCXML_VERSION " (" CMAKE_BUILD_TYPE " build - " CMAKE_COMPILER_STRING ")\n", progStr.c_str());
 	printf("Usage\n");
 	printf("\t%s", progStr.c_str());
-	printf(" [-t c|pml|flat|min] [-a {OPTIONS}] [-v] [-lN]");
+	printf(" [-t c|cpp|pml|flat|min] [-a {OPTIONS}] [-v] [-lN]");
 #ifdef BUILD_AS_PLUGINS
 	printf(" [-p pluginPath]");
 #endif
 	printf(" [-i URL] [-o FILE]");
 	printf("\n");
+	printf("\t%s", progStr.c_str());
+	printf(" -t TYPE[,TYPE...] -b MANIFEST|DIR -o DIR [-j N] [-X {PARAMETER}]");
+	printf("\n");
 	printf("Options\n");
 	printf("\t-t c           : convert to C program\n");
+	printf("\t-t c-types     : write the macros and types of C programs as a header for hosts, no input\n");
+	printf("\t-t cpp         : convert to a header-only C++ machine\n");
     printf("\t-t vhdl        : convert to VHDL hardware description\n");
     printf("\t-t java        : convert to Java classes\n");
+	printf("\t-t pml         : convert to Promela for the SPIN model checker\n");
 	printf("\t-t flat        : flatten to SCXML state-machine\n");
 	printf("\t-a FILE        : write annotated SCXML document for transformation\n");
 	printf("\t-X {PARAMETER} : pass additional parameters to the transformation\n");
 	printf("\t    prefix=ID    - prefix all symbols and identifiers with ID (-tc)\n");
+	printf("\t    bitset=words - operate on 64 bit words of aligned bitsets per default (-tc)\n");
+	printf("\t    batch=soa    - step batches of instances kept as a structure of arrays (-tc)\n");
+	printf("\t    namespace=NS - put the machine into namespace NS (-tcpp)\n");
+	printf("\t    vector=packed - pack bitsets into words and narrow variables to their range (-tpml)\n");
+	printf("\t    multicycle=on - a microstep in four registered cycles and several event ports (-tvhdl)\n");
 	printf("\t-v             : be verbose\n");
 	printf("\t-lN            : Set loglevel to N\n");
 	printf("\t-i URL         : Input file (defaults to STDIN)\n");
 	printf("\t-o FILE        : Output file (defaults to STDOUT)\n");
+	printf("\t-b MANIFEST    : transform all charts listed in MANIFEST into the directory given with -o\n");
+	printf("\t                 one chart per line, optionally followed by its output path without extension\n");
+	printf("\t-b DIR         : transform all *.scxml files below DIR\n");
+	printf("\t-j N           : transform N charts in parallel in batch mode (defaults to the number of cores)\n");
 	printf("\n");
 	exit(1);
 }
 
+/// A chart of a batch and the path of its outputs without extension
+struct BatchJob {
+	std::string inputFile;
+	std::string outputBase;
+};
+
+/// Outputs of one transformer or the parser over all charts of a batch
+struct BatchTiming {
+	BatchTiming() : written(0), skipped(0), failed(0), seconds(0) {}
+	size_t written;
+	size_t skipped;
+	size_t failed;
+	double seconds; ///< summed over all threads
+};
+
+static std::string outputExtension(const std::string& outType) {
+	if (outType == "cpp")
+		return ".hpp";
+	return "." + outType;
+}
+
+static uscxml::Transformer createTransformer(const std::string& outType, const uscxml::Interpreter& interpreter) {
+	using namespace uscxml;
+	if (outType == "c")
+		return ChartToC::transform(interpreter);
+	if (outType == "cpp")
+		return ChartToCpp::transform(interpreter);
+	if (outType == "java")
+		return ChartToJava::transform(interpreter);
+	if (outType == "vhdl")
+		return ChartToVHDL::transform(interpreter);
+#if defined(WITH_DM_PROMELA) || defined(BUILD_AS_PLUGINS)
+	if (outType == "pml")
+		return ChartToPromela::transform(interpreter);
+#endif
+	return Transformer();
+}
+
+static bool isDirectory(const std::string& path) {
+	struct stat fileStat;
+	return (stat(path.c_str(), &fileStat) == 0 && (fileStat.st_mode & S_IFMT) == S_IFDIR);
+}
+
+static bool fileExists(const std::string& path) {
+	struct stat fileStat;
+	return stat(path.c_str(), &fileStat) == 0;
+}
+
+static std::string dirName(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	if (slash == std::string::npos)
+		return ".";
+	return path.substr(0, slash);
+}
+
+static bool makeDirectories(const std::string& path) {
+	if (path.empty() || isDirectory(path))
+		return true;
+	if (!makeDirectories(dirName(path)))
+		return false;
+#ifndef WIN32
+	return mkdir(path.c_str(), 0755) == 0 || isDirectory(path);
+#else
+	return _mkdir(path.c_str()) == 0 || isDirectory(path);
+#endif
+}
+
+static void findCharts(const std::string& baseDir, const std::string& relDir, const std::string& outDir, std::vector<BatchJob>& jobs) {
+	using namespace uscxml;
+#ifndef WIN32
+	DIR* dp = opendir((baseDir + relDir).c_str());
+	if (dp == NULL) {
+		LOGD(USCXML_ERROR) << "Cannot open directory " << baseDir + relDir << std::endl;
+		return;
+	}
+
+	std::list<std::string> entries;
+	struct dirent* entry;
+	while((entry = readdir(dp))) {
+		std::string name(entry->d_name);
+		if (name.size() > 0 && name[0] != '.')
+			entries.push_back(name);
+	}
+	closedir(dp);
+	entries.sort();
+
+	for (auto name : entries) {
+		std::string relPath = relDir + name;
+		if (isDirectory(baseDir + relPath)) {
+			findCharts(baseDir, relPath + "/", outDir, jobs);
+		} else if (boost::ends_with(name, ".scxml")) {
+			BatchJob job;
+			job.inputFile = baseDir + relPath;
+			job.outputBase = outDir + "/" + relPath.substr(0, relPath.size() - 6);
+			jobs.push_back(job);
+		}
+	}
+#else
+	LOGD(USCXML_ERROR) << "Batches from directories are not supported on this platform, use a manifest" << std::endl;
+#endif
+}
+
+static bool readManifest(const std::string& manifest, const std::string& outDir, std::vector<BatchJob>& jobs) {
+	std::ifstream manifestStream(manifest.c_str());
+	if (!manifestStream)
+		return false;
+
+	// relative charts are resolved against the directory of the manifest
+	std::string baseDir = dirName(manifest) + "/";
+	std::string line;
+	while (std::getline(manifestStream, line)) {
+		boost::trim(line);
+		if (line.size() == 0 || line[0] == '#')
+			continue;
+
+		std::stringstream fields(line);
+		std::string chart;
+		std::string outputBase;
+		fields >> chart >> outputBase;
+
+		BatchJob job;
+		bool isAbsolute = (chart[0] == '/' || chart[0] == '\\' || (chart.size() > 1 && chart[1] == ':'));
+		job.inputFile = (isAbsolute ? chart : baseDir + chart);
+
+		if (outputBase.size() > 0) {
+			job.outputBase = outDir + "/" + outputBase;
+		} else {
+			std::string relPath = (isAbsolute ? chart.substr(chart.find_last_of("/\\") + 1) : chart);
+			if (boost::ends_with(relPath, ".scxml"))
+				relPath = relPath.substr(0, relPath.size() - 6);
+			job.outputBase = outDir + "/" + relPath;
+		}
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+/**
+ * Append the contents of everything the chart loads via src, i.e. invoked
+ * charts with what they load in turn and external scripts. They end up in
+ * the outputs just as the chart itself.
+ */
+static void appendSources(XERCESC_NS::XercesDOMParser* parser,
+                          XERCESC_NS::DOMDocument* document,
+                          const uscxml::URL& baseURL,
+                          std::set<std::string>& visited,
+                          std::ostream& sources) {
+	using namespace uscxml;
+	XERCESC_NS::DOMElement* root = document->getDocumentElement();
+	if (root == NULL)
+		return;
+
+	std::list<XERCESC_NS::DOMElement*> elements = DOMUtils::inDocumentOrder({
+		XML_PREFIX(root).str() + "invoke",
+		XML_PREFIX(root).str() + "script"
+	}, root);
+
+	for (auto element : elements) {
+		if (!HAS_ATTR(element, kXMLCharSource))
+			continue;
+
+		URL srcURL(ATTR(element, kXMLCharSource));
+		if (!srcURL.isAbsolute())
+			srcURL = URL::resolve(srcURL, baseURL);
+		std::string resolved = srcURL;
+		sources << resolved << "\n";
+		if (visited.find(resolved) != visited.end())
+			continue;
+		visited.insert(resolved);
+
+		std::string content;
+		try {
+			content = srcURL.getInContent();
+		} catch (ErrorEvent e) {
+			sources << "unavailable\n";
+			continue;
+		}
+		sources << content << "\n";
+
+		if (X(element->getLocalName()).str() != "invoke" ||
+		        (HAS_ATTR(element, kXMLCharType) &&
+		         ATTR(element, kXMLCharType) != "scxml" &&
+		         ATTR(element, kXMLCharType) != "http://www.w3.org/TR/scxml/"))
+			continue;
+
+		// invoked charts might load more
+		XERCESC_NS::DOMDocument* invoked = NULL;
+		try {
+			XERCESC_NS::MemBufInputSource is((XMLByte*)content.c_str(), content.size(), resolved.c_str());
+			parser->parse(is);
+			invoked = parser->adoptDocument();
+		} catch (const XERCESC_NS::SAXParseException&) {
+		} catch (const XERCESC_NS::XMLException&) {
+		} catch (const XERCESC_NS::DOMException&) {
+		}
+		// the transformation will fail on an invoked chart that does not parse
+		if (invoked != NULL) {
+			appendSources(parser, invoked, srcURL, visited, sources);
+			invoked->release();
+		}
+	}
+}
+
+/**
+ * Transform all charts of a manifest or directory with every given type.
+ *
+ * Plugins are scanned once and every thread reuses its parser for all the
+ * charts it takes. An output is skipped if the hash of the chart, of
+ * everything it loads via src, of the transformation parameters and of the
+ * uscxml version is the one recorded in the output directory when the
+ * output was last written.
+ */
+static int runBatch(const std::string& batchSource,
+                    const std::string& outDir,
+                    const std::list<std::string>& outTypes,
+                    size_t nrThreads,
+                    const std::multimap<std::string, std::string>& extensions,
+                    const std::list<std::string>& options) {
+	using namespace uscxml;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<BatchJob> jobs;
+	if (isDirectory(batchSource)) {
+		findCharts(batchSource + "/", "", outDir, jobs);
+	} else if (!readManifest(batchSource, outDir, jobs)) {
+		LOGD(USCXML_ERROR) << "Cannot read manifest " << batchSource << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!makeDirectories(outDir)) {
+		LOGD(USCXML_ERROR) << "Cannot create output directory " << outDir << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// everything but the chart that goes into the output
+	std::stringstream paramSS;
+	for (auto extension : extensions)
+		paramSS << extension.first << "=" << extension.second << "\n";
+	for (auto option : options)
+		paramSS << option << "\n";
+	std::string params = paramSS.str();
+
+	// hashes of the charts the outputs were written from
+	std::string hashFile = outDir + "/.uscxml-transform.md5";
+	std::map<std::string, std::string> hashes;
+	{
+		std::ifstream hashStream(hashFile.c_str());
+		std::string hash;
+		std::string outputFile;
+		while (hashStream >> hash && std::getline(hashStream, outputFile)) {
+			hashes[boost::trim_copy(outputFile)] = hash;
+		}
+	}
+
+	// scan for plugins before any thread needs a datamodel
+	Factory::getInstance();
+	XERCESC_NS::XMLPlatformUtils::Initialize();
+
+	std::mutex mutex;
+	std::map<std::string, BatchTiming> timings;
+	std::atomic<size_t> nextJob(0);
+
+	auto worker = [&]() {
+		std::unique_ptr<XERCESC_NS::XercesDOMParser> parser(new XERCESC_NS::XercesDOMParser());
+		std::unique_ptr<XERCESC_NS::ErrorHandler> errHandler(new XERCESC_NS::HandlerBase());
+		parser->setValidationScheme(XERCESC_NS::XercesDOMParser::Val_Always);
+		parser->setDoNamespaces(true);
+		parser->useScanner(XERCESC_NS::XMLUni::fgWFXMLScanner);
+		parser->setErrorHandler(errHandler.get());
+
+		size_t jobNr;
+		while ((jobNr = nextJob++) < jobs.size()) {
+			const BatchJob& job = jobs[jobNr];
+
+			std::ifstream inStream(job.inputFile.c_str(), std::ios::binary);
+			std::stringstream contentSS;
+			contentSS << inStream.rdbuf();
+			std::string content = contentSS.str();
+
+			std::string inlineBeginMarker = "INLINE SCXML BEGIN\n";
+			std::string inlineEndMarker = "\nINLINE SCXML END";
+			size_t inlineSCXMLBegin = content.find(inlineBeginMarker);
+			if (inlineSCXMLBegin != std::string::npos) {
+				inlineSCXMLBegin += inlineBeginMarker.size();
+				content = content.substr(inlineSCXMLBegin, content.find(inlineEndMarker) - inlineSCXMLBegin);
+			}
+
+			std::chrono::steady_clock::time_point parseStart = std::chrono::steady_clock::now();
+			XERCESC_NS::DOMDocument* document = NULL;
+			std::string error;
+			if (!inStream || content.size() == 0) {
+				error = "cannot read chart";
+			} else {
+				try {
+					XERCESC_NS::MemBufInputSource is((XMLByte*)content.c_str(), content.size(), job.inputFile.c_str());
+					parser->parse(is);
+					document = parser->adoptDocument();
+				} catch (const XERCESC_NS::SAXParseException& toCatch) {
+					error = X(toCatch.getMessage()).str();
+				} catch (const XERCESC_NS::XMLException& toCatch) {
+					error = X(toCatch.getMessage()).str();
+				} catch (const XERCESC_NS::DOMException& toCatch) {
+					error = X(toCatch.getMessage()).str();
+				}
+			}
+			double parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parseStart).count();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				timings["parse"].seconds += parseSeconds;
+				if (document == NULL) {
+					std::cerr << job.inputFile << ": " << error << std::endl;
+					timings["parse"].failed++;
+					for (auto outType : outTypes) {
+						timings[outType].failed++;
+						hashes.erase(job.outputBase + outputExtension(outType));
+					}
+					continue;
+				}
+				timings["parse"].written++;
+			}
+
+			// invoked charts and scripts are only known once the chart is parsed
+			URL url = URL::resolveWithCWD(URL(job.inputFile));
+			std::stringstream sourcesSS;
+			std::set<std::string> visited;
+			appendSources(parser.get(), document, url, visited, sourcesSS);
+			std::string sources = USCXML_VERSION "\n" + content + "\n" + sourcesSS.str();
+
+			std::map<std::string, std::string> pending; // outType -> hash
+			for (auto outType : outTypes) {
+				std::string outputFile = job.outputBase + outputExtension(outType);
+				std::string hash = md5(sources + outType + "\n" + params);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (hashes.find(outputFile) != hashes.end() && hashes[outputFile] == hash && fileExists(outputFile)) {
+					timings[outType].skipped++;
+				} else {
+					pending[outType] = hash;
+				}
+			}
+			if (pending.size() == 0) {
+				document->release();
+				continue;
+			}
+
+			if (!makeDirectories(dirName(job.outputBase))) {
+				std::lock_guard<std::mutex> lock(mutex);
+				std::cerr << job.inputFile << ": cannot create " << dirName(job.outputBase) << std::endl;
+				for (auto outType : pending)
+					timings[outType.first].failed++;
+				document->release();
+				continue;
+			}
+
+			for (auto outType : pending) {
+				std::string outputFile = job.outputBase + outputExtension(outType.first);
+				std::chrono::steady_clock::time_point transformStart = std::chrono::steady_clock::now();
+
+				std::stringstream errorSS;
+				try {
+					// every transformer gets a copy as they annotate the document
+					Interpreter interpreter = Interpreter::fromDocument(document, url, true);
+					Transformer transformer = createTransformer(outType.first, interpreter);
+
+					std::multimap<std::string, std::string> chartExtensions = extensions;
+					chartExtensions.insert(std::make_pair("outputFile", outputFile));
+					transformer.setExtensions(chartExtensions);
+					transformer.setOptions(options);
+
+					std::ofstream outStream;
+					outStream.open(outputFile.c_str());
+					transformer.writeTo(outStream);
+					outStream.close();
+					if (!outStream)
+						errorSS << "cannot write " << outputFile;
+				} catch (Event e) {
+					errorSS << e;
+				} catch (const std::exception &e) {
+					errorSS << e.what();
+				}
+
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - transformStart).count();
+				std::lock_guard<std::mutex> lock(mutex);
+				BatchTiming& timing = timings[outType.first];
+				timing.seconds += seconds;
+				if (errorSS.str().size() > 0) {
+					std::cerr << job.inputFile << " (" << outType.first << "): " << errorSS.str() << std::endl;
+					timing.failed++;
+					hashes.erase(outputFile);
+				} else {
+					timing.written++;
+					hashes[outputFile] = outType.second;
+				}
+			}
+			document->release();
+		}
+	};
+
+	if (nrThreads == 0)
+		nrThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	nrThreads = std::min(nrThreads, std::max(jobs.size(), (size_t)1));
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nrThreads; i++)
+		threads.push_back(std::thread(worker));
+	for (auto& thread : threads)
+		thread.join();
+
+	{
+		std::ofstream hashStream(hashFile.c_str());
+		for (auto hash : hashes)
+			hashStream << hash.second << " " << hash.first << std::endl;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Transformed " << jobs.size() << " charts with " << nrThreads << " threads in "
+	          << std::fixed << std::setprecision(3) << seconds << "s" << std::endl;
+
+	bool failed = false;
+	for (auto timing : timings) {
+		std::cout << "  " << std::left << std::setw(6) << timing.first << std::right
+		          << std::setw(8) << timing.second.written << " written"
+		          << std::setw(8) << timing.second.skipped << " skipped"
+		          << std::setw(8) << timing.second.failed << " failed"
+		          << std::setw(10) << timing.second.seconds << "s";
+		if (timing.second.written > 0)
+			std::cout << std::setw(10) << 1000 * timing.second.seconds / timing.second.written << "ms per chart";
+		std::cout << std::endl;
+		failed = failed || timing.second.failed > 0;
+	}
+
+	return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 int main(int argc, char** argv) {
 	using namespace uscxml;
 
@@ -61,6 +540,8 @@ int main(int argc, char** argv) {
     std::string inputFile;
     std::string annotatedFile;
 	std::string outputFile;
+	std::string batchSource;
+	size_t nrThreads = 0;
 	std::list<std::string> options;
 	std::multimap<std::string, std::string> extensions;
 
@@ -80,6 +561,8 @@ int main(int argc, char** argv) {
 		{"input-file",    required_argument, 0, 'i'},
 		{"output-file",   required_argument, 0, 'o'},
 		{"loglevel",      required_argument, 0, 'l'},
+		{"batch",         required_argument, 0, 'b'},
+		{"jobs",          required_argument, 0, 'j'},
 		{0, 0, 0, 0}
 	};
 
@@ -87,7 +570,7 @@ int main(int argc, char** argv) {
 	int optionInd = 0;
 	int option;
 	for (;;) {
-		option = getopt_long_only(argc, argv, "+vp:X:t:i:o:l:a:", longOptions, &optionInd);
+		option = getopt_long_only(argc, argv, "+vp:X:t:i:o:l:a:b:j:", longOptions, &optionInd);
 		if (option == -1) {
 			break;
 		}
@@ -127,6 +610,12 @@ int main(int argc, char** argv) {
 			break;
 		case 'l':
 			break;
+		case 'b':
+			batchSource = optarg;
+			break;
+		case 'j':
+			nrThreads = strTo<size_t>(optarg);
+			break;
 		case '?': {
 			break;
 		}
@@ -173,6 +662,44 @@ int main(int argc, char** argv) {
 		setenv("USCXML_ANNOTATE_NOCOMMENT", "YES", 1);
 
 
+	if (batchSource.size() > 0) {
+		std::list<std::string> outTypes = tokenize(outType, ',');
+		if (outTypes.size() == 0 || outputFile.size() == 0 || outputFile == "-")
+			printUsageAndExit(argv[0]);
+		for (auto type : outTypes) {
+			if (type != "c" &&
+#if defined(WITH_DM_PROMELA) || defined(BUILD_AS_PLUGINS)
+			        type != "pml" &&
+#endif
+			        type != "cpp" &&
+			        type != "vhdl" &&
+			        type != "java")
+				printUsageAndExit(argv[0]);
+		}
+		extensions.erase("outputFile");
+
+		if (pluginPath.length() > 0) {
+			Factory::setDefaultPluginPath(pluginPath);
+		}
+		return runBatch(batchSource, outputFile, outTypes, nrThreads, extensions, options);
+	}
+
+	if (outType == "c-types") {
+		if (outputFile.size() == 0 || outputFile == "-") {
+			ChartToC::writeTypesHeader(std::cout);
+		} else {
+			std::ofstream outStream;
+			outStream.open(outputFile.c_str());
+			ChartToC::writeTypesHeader(outStream);
+			outStream.close();
+			if (!outStream) {
+				LOGD(USCXML_ERROR) << "Cannot write " << outputFile << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+		return EXIT_SUCCESS;
+	}
+
 //	if (outType.length() == 0 && outputFile.length() > 0) {
 //		// try to get type from outfile extension
 //		size_t dotPos = outputFile.find_last_of(".");
@@ -187,6 +714,8 @@ int main(int argc, char** argv) {
 	if (outType != "flat" &&
 	        outType != "scxml" &&
 	        outType != "c" &&
+	        outType != "cpp" &&
+	        outType != "pml" &&
             outType != "vhdl" &&
             outType != "java" &&
 	        outType != "min" &&
@@ -280,6 +809,21 @@ int main(int argc, char** argv) {
 			}
 		}
 
+		if (outType == "cpp") {
+			transformer = ChartToCpp::transform(interpreter);
+			transformer.setExtensions(extensions);
+			transformer.setOptions(options);
+
+			if (outputFile.size() == 0 || outputFile == "-") {
+				transformer.writeTo(std::cout);
+			} else {
+				std::ofstream outStream;
+				outStream.open(outputFile.c_str());
+				transformer.writeTo(outStream);
+				outStream.close();
+			}
+		}
+
         if (outType == "java") {
             transformer = ChartToJava::transform(interpreter);
             transformer.setExtensions(extensions);
@@ -310,20 +854,22 @@ int main(int argc, char** argv) {
 			}
 		}
 
-		//if (outType == "pml") {
-  //          transformer = ChartToPromela::transform(interpreter);
-  //          transformer.setExtensions(extensions);
-  //          transformer.setOptions(options);
-  //          
-  //          if (outputFile.size() == 0 || outputFile == "-") {
-  //              transformer.writeTo(std::cout);
-  //          } else {
-  //              std::ofstream outStream;
-  //              outStream.open(outputFile.c_str());
-  //              transformer.writeTo(outStream);
-  //              outStream.close();
-  //          }
-		//}
+#if defined(WITH_DM_PROMELA) || defined(BUILD_AS_PLUGINS)
+		if (outType == "pml") {
+			transformer = ChartToPromela::transform(interpreter);
+			transformer.setExtensions(extensions);
+			transformer.setOptions(options);
+
+			if (outputFile.size() == 0 || outputFile == "-") {
+				transformer.writeTo(std::cout);
+			} else {
+				std::ofstream outStream;
+				outStream.open(outputFile.c_str());
+				transformer.writeTo(outStream);
+				outStream.close();
+			}
+		}
+#endif
 
 //		if (outType == "tex") {
 //			if (outputFile.size() == 0 || outputFile == "-") {
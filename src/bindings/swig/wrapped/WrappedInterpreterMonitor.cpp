@@ -22,61 +22,270 @@
 #include "uscxml/util/DOM.h"
 #include <xercesc/dom/DOM.hpp>
 #include <ostream>
+#include <sstream>
 
 namespace uscxml {
 
 using namespace XERCESC_NS;
 
-WrappedInterpreterMonitor::WrappedInterpreterMonitor() {}
-WrappedInterpreterMonitor::~WrappedInterpreterMonitor() {}
+/**
+ * Element ids, cached names and lazily computed xpaths / XML for one chart. It
+ * is attached as user data to the document and dropped when Xerces deletes it.
+ */
+class WrappedChartIndex : public DOMUserDataHandler {
+public:
+	WrappedChartIndex(WrappedInterpreterMonitor* monitor, DOMDocument* document, size_t firstId) :
+		monitor(monitor), document(document), firstId(firstId) {}
+	virtual ~WrappedChartIndex() {}
+
+	virtual void handle(DOMOperationType operation,
+	                    const XMLCh* const key,
+	                    void* data,
+	                    const DOMNode* src,
+	                    DOMNode* dst) {
+		if (operation == NODE_DELETED)
+			monitor->dropChart(this);
+	}
+
+	void index(const DOMElement* element) {
+		ids[element] = firstId + elements.size();
+		elements.push_back(element);
+
+		if (LOCALNAME(element) == "transition") {
+			DOMElement* source = getSourceState(element);
+			names.push_back(source != NULL ? ATTR(source, kXMLCharId) : "");
+		} else if (isState(element, false)) {
+			names.push_back(ATTR(element, kXMLCharId));
+		} else {
+			names.push_back(TAGNAME(element));
+		}
+
+		for (DOMElement* child = element->getFirstElementChild(); child; child = child->getNextElementSibling()) {
+			index(child);
+		}
+	}
+
+	WrappedInterpreterMonitor* monitor;
+	DOMDocument* document;
+	size_t firstId;
+
+	std::vector<const DOMElement*> elements; // in document order
+	std::vector<std::string> names; // id of states and transition sources, tag name otherwise
+	std::unordered_map<const DOMElement*, size_t> ids;
+
+	std::map<size_t, std::string> xpaths;
+	std::map<size_t, std::string> xmls;
+};
+
+WrappedInterpreterMonitor::WrappedInterpreterMonitor() : _callbackMask(ALL_CALLBACKS), _lightweight(false), _defaulted(0), _defaultedById(0), _nextId(0) {
+	// one key per monitor, several monitors may index the same document
+	std::stringstream ss;
+	ss << "uscxml.monitor.index." << (void*)this;
+	_indexKey = XMLString::transcode(ss.str().c_str());
+}
+
+WrappedInterpreterMonitor::~WrappedInterpreterMonitor() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (auto chart : _charts) {
+		chart.second->document->setUserData(_indexKey, NULL, NULL);
+		delete chart.second;
+	}
+	_charts.clear();
+	XMLString::release(&_indexKey);
+}
+
+size_t WrappedInterpreterMonitor::indexElement(const DOMElement* element, const std::string** name) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	DOMDocument* document = element->getOwnerDocument();
+	WrappedChartIndex* chart = (WrappedChartIndex*)document->getUserData(_indexKey);
+	if (chart == NULL) {
+		chart = new WrappedChartIndex(this, document, _nextId);
+		chart->index(document->getDocumentElement());
+		_nextId += chart->elements.size();
+		_charts[chart->firstId] = chart;
+		document->setUserData(_indexKey, chart, chart);
+	}
+
+	auto idIter = chart->ids.find(element);
+	if (idIter == chart->ids.end()) {
+		// not part of the document when we indexed it
+		static const std::string unknown;
+		if (name != NULL)
+			*name = &unknown;
+		return (size_t)-1;
+	}
+
+	if (name != NULL)
+		*name = &chart->names[idIter->second - chart->firstId];
+	return idIter->second;
+}
+
+const DOMElement* WrappedInterpreterMonitor::elementForId(size_t elementId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	auto chartIter = _charts.upper_bound(elementId);
+	if (chartIter == _charts.begin())
+		return NULL;
+	chartIter--;
+
+	WrappedChartIndex* chart = chartIter->second;
+	if (elementId - chart->firstId >= chart->elements.size())
+		return NULL;
+	return chart->elements[elementId - chart->firstId];
+}
+
+void WrappedInterpreterMonitor::dropChart(WrappedChartIndex* chart) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_charts.erase(chart->firstId);
+	delete chart;
+}
+
+std::string WrappedInterpreterMonitor::getXPath(size_t elementId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	const DOMElement* element = elementForId(elementId);
+	if (element == NULL)
+		return "";
+
+	WrappedChartIndex* chart = (--_charts.upper_bound(elementId))->second;
+	auto xpathIter = chart->xpaths.find(elementId);
+	if (xpathIter == chart->xpaths.end())
+		xpathIter = chart->xpaths.insert(std::make_pair(elementId, DOMUtils::xPathForNode(element))).first;
+	return xpathIter->second;
+}
+
+std::string WrappedInterpreterMonitor::getXML(size_t elementId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	const DOMElement* element = elementForId(elementId);
+	if (element == NULL)
+		return "";
+
+	WrappedChartIndex* chart = (--_charts.upper_bound(elementId))->second;
+	auto xmlIter = chart->xmls.find(elementId);
+	if (xmlIter == chart->xmls.end()) {
+		std::stringstream ss;
+		ss << *element;
+		xmlIter = chart->xmls.insert(std::make_pair(elementId, ss.str())).first;
+	}
+	return xmlIter->second;
+}
+
+std::list<std::string> WrappedInterpreterMonitor::getTargets(size_t transitionId) {
+	std::list<std::string> targets;
+	const DOMElement* transition = elementForId(transitionId);
+	if (transition == NULL)
+		return targets;
+
+	const XERCESC_NS::DOMElement* root = DOMUtils::getNearestAncestor(transition, "scxml");
+	for (auto t : getTargetStates(transition, root)) {
+		targets.push_back(ATTR_CAST(t, kXMLCharId));
+	}
+	return targets;
+}
+
+std::string WrappedInterpreterMonitor::invokeIdFor(const XERCESC_NS::DOMElement* invoker) {
+	if (invoker->getUserData(kXMLCharInvokeId) != NULL) {
+		return (char*)invoker->getUserData(kXMLCharInvokeId);
+	}
+	return "";
+}
 
 void WrappedInterpreterMonitor::beforeExitingState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+	if (!isDispatched(BEFORE_EXITING_STATE))
+		return;
+	if (_lightweight) {
+		const std::string* stateId;
+		size_t elementId = indexElement(state, &stateId);
+		beforeExitingStateById(elementId, *stateId);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *state;
 	beforeExitingState(ATTR(state, kXMLCharId), DOMUtils::xPathForNode(state), ss.str());
 }
 
 void WrappedInterpreterMonitor::afterExitingState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+	if (!isDispatched(AFTER_EXITING_STATE))
+		return;
+	if (_lightweight) {
+		const std::string* stateId;
+		size_t elementId = indexElement(state, &stateId);
+		afterExitingStateById(elementId, *stateId);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *state;
 	afterExitingState(ATTR(state, kXMLCharId), DOMUtils::xPathForNode(state), ss.str());
 }
 
 void WrappedInterpreterMonitor::beforeExecutingContent(Interpreter& interpreter, const XERCESC_NS::DOMElement* content) {
+	if (!isDispatched(BEFORE_EXECUTING_CONTENT))
+		return;
+	if (_lightweight) {
+		const std::string* tagName;
+		size_t elementId = indexElement(content, &tagName);
+		beforeExecutingContentById(elementId, *tagName);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *content;
 	beforeExecutingContent(TAGNAME(content), DOMUtils::xPathForNode(content), ss.str());
 }
 
 void WrappedInterpreterMonitor::afterExecutingContent(Interpreter& interpreter, const XERCESC_NS::DOMElement* content) {
+	if (!isDispatched(AFTER_EXECUTING_CONTENT))
+		return;
+	if (_lightweight) {
+		const std::string* tagName;
+		size_t elementId = indexElement(content, &tagName);
+		afterExecutingContentById(elementId, *tagName);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *content;
 	afterExecutingContent(TAGNAME(content), DOMUtils::xPathForNode(content), ss.str());
 }
 
 void WrappedInterpreterMonitor::beforeUninvoking(Interpreter& interpreter, const XERCESC_NS::DOMElement* invoker, const std::string& invokeid) {
-	std::stringstream ss;
-	ss << *invoker;
-	std::string invokeId;
-	if (invoker->getUserData(kXMLCharInvokeId) != NULL) {
-		invokeId = (char*)invoker->getUserData(kXMLCharInvokeId);
+	if (!isDispatched(BEFORE_UNINVOKING))
+		return;
+	if (_lightweight) {
+		beforeUninvokingById(indexElement(invoker), invokeIdFor(invoker));
+		return;
 	}
 
-	beforeUninvoking(DOMUtils::xPathForNode(invoker), invokeId, ss.str());
+	std::stringstream ss;
+	ss << *invoker;
+	beforeUninvoking(DOMUtils::xPathForNode(invoker), invokeIdFor(invoker), ss.str());
 }
 
 void WrappedInterpreterMonitor::afterUninvoking(Interpreter& interpreter, const XERCESC_NS::DOMElement* invoker, const std::string& invokeid) {
-	std::stringstream ss;
-	ss << *invoker;
-	std::string invokeId;
-	if (invoker->getUserData(kXMLCharInvokeId) != NULL) {
-		invokeId = (char*)invoker->getUserData(kXMLCharInvokeId);
+	if (!isDispatched(AFTER_UNINVOKING))
+		return;
+	if (_lightweight) {
+		afterUninvokingById(indexElement(invoker), invokeIdFor(invoker));
+		return;
 	}
 
-	afterUninvoking(DOMUtils::xPathForNode(invoker), invokeId, ss.str());
+	std::stringstream ss;
+	ss << *invoker;
+	afterUninvoking(DOMUtils::xPathForNode(invoker), invokeIdFor(invoker), ss.str());
 }
 
 void WrappedInterpreterMonitor::beforeTakingTransition(Interpreter& interpreter, const XERCESC_NS::DOMElement* transition) {
+	if (!isDispatched(BEFORE_TAKING_TRANSITION))
+		return;
+	if (_lightweight) {
+		const std::string* source;
+		size_t elementId = indexElement(transition, &source);
+		beforeTakingTransitionById(elementId, *source);
+		return;
+	}
+
 	XERCESC_NS::DOMElement* sourceState = getSourceState(transition);
 	const XERCESC_NS::DOMElement* root = DOMUtils::getNearestAncestor(transition, "scxml");
 
@@ -94,6 +303,15 @@ void WrappedInterpreterMonitor::beforeTakingTransition(Interpreter& interpreter,
 }
 
 void WrappedInterpreterMonitor::afterTakingTransition(Interpreter& interpreter, const XERCESC_NS::DOMElement* transition) {
+	if (!isDispatched(AFTER_TAKING_TRANSITION))
+		return;
+	if (_lightweight) {
+		const std::string* source;
+		size_t elementId = indexElement(transition, &source);
+		afterTakingTransitionById(elementId, *source);
+		return;
+	}
+
 	XERCESC_NS::DOMElement* sourceState = getSourceState(transition);
 	const XERCESC_NS::DOMElement* root = DOMUtils::getNearestAncestor(transition, "scxml");
 
@@ -111,37 +329,59 @@ void WrappedInterpreterMonitor::afterTakingTransition(Interpreter& interpreter,
 }
 
 void WrappedInterpreterMonitor::beforeEnteringState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+	if (!isDispatched(BEFORE_ENTERING_STATE))
+		return;
+	if (_lightweight) {
+		const std::string* stateId;
+		size_t elementId = indexElement(state, &stateId);
+		beforeEnteringStateById(elementId, *stateId);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *state;
 	beforeEnteringState(ATTR(state, kXMLCharId), DOMUtils::xPathForNode(state), ss.str());
 }
 
 void WrappedInterpreterMonitor::afterEnteringState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+	if (!isDispatched(AFTER_ENTERING_STATE))
+		return;
+	if (_lightweight) {
+		const std::string* stateId;
+		size_t elementId = indexElement(state, &stateId);
+		afterEnteringStateById(elementId, *stateId);
+		return;
+	}
+
 	std::stringstream ss;
 	ss << *state;
 	afterEnteringState(ATTR(state, kXMLCharId), DOMUtils::xPathForNode(state), ss.str());
 }
 
 void WrappedInterpreterMonitor::beforeInvoking(Interpreter& interpreter, const XERCESC_NS::DOMElement* invoker, const std::string& invokeid) {
-	std::stringstream ss;
-	ss << *invoker;
-	std::string invokeId;
-	if (invoker->getUserData(kXMLCharInvokeId) != NULL) {
-		invokeId = (char*)invoker->getUserData(kXMLCharInvokeId);
+	if (!isDispatched(BEFORE_INVOKING))
+		return;
+	if (_lightweight) {
+		beforeInvokingById(indexElement(invoker), invokeIdFor(invoker));
+		return;
 	}
 
-	beforeInvoking(DOMUtils::xPathForNode(invoker), invokeId, ss.str());
+	std::stringstream ss;
+	ss << *invoker;
+	beforeInvoking(DOMUtils::xPathForNode(invoker), invokeIdFor(invoker), ss.str());
 }
 
 void WrappedInterpreterMonitor::afterInvoking(Interpreter& interpreter, const XERCESC_NS::DOMElement* invoker, const std::string& invokeid) {
-	std::stringstream ss;
-	ss << *invoker;
-	std::string invokeId;
-	if (invoker->getUserData(kXMLCharInvokeId) != NULL) {
-		invokeId = (char*)invoker->getUserData(kXMLCharInvokeId);
+	if (!isDispatched(AFTER_INVOKING))
+		return;
+	if (_lightweight) {
+		afterInvokingById(indexElement(invoker), invokeIdFor(invoker));
+		return;
 	}
 
-	afterInvoking(DOMUtils::xPathForNode(invoker), invokeId, ss.str());
+	std::stringstream ss;
+	ss << *invoker;
+	afterInvoking(DOMUtils::xPathForNode(invoker), invokeIdFor(invoker), ss.str());
 }
 
 }
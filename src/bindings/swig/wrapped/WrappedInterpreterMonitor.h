@@ -20,10 +20,14 @@
 #ifndef WRAPPEDINTERPRETERMONITOR_H_F5C83A0D
 #define WRAPPEDINTERPRETERMONITOR_H_F5C83A0D
 
+#include <atomic>
 #include <vector>
 #include <list>
+#include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <unordered_map>
 
 #include <xercesc/dom/DOM.hpp>
 
@@ -39,36 +43,133 @@ class DOMElement;
 
 namespace uscxml {
 
+class WrappedChartIndex;
+
 class WrappedInterpreterMonitor : public InterpreterMonitor {
 public:
+	/// Bits for setCallbackMask, only the selected callbacks are dispatched into the script
+	enum Callback {
+		BEFORE_EXITING_STATE      = 1 << 0,
+		AFTER_EXITING_STATE       = 1 << 1,
+		BEFORE_EXECUTING_CONTENT  = 1 << 2,
+		AFTER_EXECUTING_CONTENT   = 1 << 3,
+		BEFORE_UNINVOKING         = 1 << 4,
+		AFTER_UNINVOKING          = 1 << 5,
+		BEFORE_TAKING_TRANSITION  = 1 << 6,
+		AFTER_TAKING_TRANSITION   = 1 << 7,
+		BEFORE_ENTERING_STATE     = 1 << 8,
+		AFTER_ENTERING_STATE      = 1 << 9,
+		BEFORE_INVOKING           = 1 << 10,
+		AFTER_INVOKING            = 1 << 11,
+		ALL_CALLBACKS             = (1 << 12) - 1
+	};
+
 	WrappedInterpreterMonitor();
 	virtual ~WrappedInterpreterMonitor();
 
+	/**
+	 * Callbacks not overridden by a subclass or script reach the empty defaults
+	 * below, which mark them as defaulted. They are skipped from then on.
+	 */
+	unsigned int getDefaultedCallbacks() {
+		return (_lightweight ? _defaultedById : _defaulted);
+	}
+
+	void setCallbackMask(unsigned int mask) {
+		_callbackMask = mask;
+	}
+	unsigned int getCallbackMask() {
+		return _callbackMask;
+	}
+
+	/**
+	 * In lightweight mode, the *ById callbacks are invoked instead of the ones
+	 * passing serialized XML. Ids number the elements of a chart in document
+	 * order and stay valid while its document is alive, elements added to the
+	 * document later are reported as (size_t)-1.
+	 */
+	void setLightweight(bool lightweight) {
+		_lightweight = lightweight;
+	}
+	bool isLightweight() {
+		return _lightweight;
+	}
+
+	/// Resolve an element id on demand, results are cached per element
+	std::string getXPath(size_t elementId);
+	std::string getXML(size_t elementId);
+	std::list<std::string> getTargets(size_t transitionId);
+
+	virtual void beforeExitingStateById(size_t elementId, const std::string& stateId) {
+		_defaultedById |= BEFORE_EXITING_STATE;
+	}
+	virtual void afterExitingStateById(size_t elementId, const std::string& stateId) {
+		_defaultedById |= AFTER_EXITING_STATE;
+	}
+	virtual void beforeExecutingContentById(size_t elementId, const std::string& tagName) {
+		_defaultedById |= BEFORE_EXECUTING_CONTENT;
+	}
+	virtual void afterExecutingContentById(size_t elementId, const std::string& tagName) {
+		_defaultedById |= AFTER_EXECUTING_CONTENT;
+	}
+	virtual void beforeUninvokingById(size_t elementId, const std::string& invokeid) {
+		_defaultedById |= BEFORE_UNINVOKING;
+	}
+	virtual void afterUninvokingById(size_t elementId, const std::string& invokeid) {
+		_defaultedById |= AFTER_UNINVOKING;
+	}
+	virtual void beforeTakingTransitionById(size_t elementId, const std::string& source) {
+		_defaultedById |= BEFORE_TAKING_TRANSITION;
+	}
+	virtual void afterTakingTransitionById(size_t elementId, const std::string& source) {
+		_defaultedById |= AFTER_TAKING_TRANSITION;
+	}
+	virtual void beforeEnteringStateById(size_t elementId, const std::string& stateId) {
+		_defaultedById |= BEFORE_ENTERING_STATE;
+	}
+	virtual void afterEnteringStateById(size_t elementId, const std::string& stateId) {
+		_defaultedById |= AFTER_ENTERING_STATE;
+	}
+	virtual void beforeInvokingById(size_t elementId, const std::string& invokeid) {
+		_defaultedById |= BEFORE_INVOKING;
+	}
+	virtual void afterInvokingById(size_t elementId, const std::string& invokeid) {
+		_defaultedById |= AFTER_INVOKING;
+	}
+
 	virtual void beforeProcessingEvent(Interpreter& interpreter, const Event& event) {}
 	virtual void beforeMicroStep(Interpreter& interpreter) {}
 
 	void beforeExitingState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state);
 	virtual void beforeExitingState(const std::string& stateId,
 	                                const std::string& xpath,
-	                                const std::string& stateXML) {}
+	                                const std::string& stateXML) {
+		_defaulted |= BEFORE_EXITING_STATE;
+	}
 
 
 	void afterExitingState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state);
 	virtual void afterExitingState(const std::string& stateId,
 	                               const std::string& xpath,
-	                               const std::string& stateXML) {}
+	                               const std::string& stateXML) {
+		_defaulted |= AFTER_EXITING_STATE;
+	}
 
 
 	void beforeExecutingContent(Interpreter& interpreter, const XERCESC_NS::DOMElement* content);
 	virtual void beforeExecutingContent(const std::string& tagName,
 	                                    const std::string& xpath,
-	                                    const std::string& contentXML) {}
+	                                    const std::string& contentXML) {
+		_defaulted |= BEFORE_EXECUTING_CONTENT;
+	}
 
 
 	void afterExecutingContent(Interpreter& interpreter, const XERCESC_NS::DOMElement* content);
 	virtual void afterExecutingContent(const std::string& tagName,
 	                                   const std::string& xpath,
-	                                   const std::string& contentXML) {}
+	                                   const std::string& contentXML) {
+		_defaulted |= AFTER_EXECUTING_CONTENT;
+	}
 
 
 	void beforeUninvoking(Interpreter& interpreter,
@@ -76,7 +177,9 @@ public:
 	                      const std::string& invokeid);
 	virtual void beforeUninvoking(const std::string& xpath,
 	                              const std::string& invokeid,
-	                              const std::string& invokerXML) {}
+	                              const std::string& invokerXML) {
+		_defaulted |= BEFORE_UNINVOKING;
+	}
 
 
 	void afterUninvoking(Interpreter& interpreter,
@@ -84,7 +187,9 @@ public:
 	                     const std::string& invokeid);
 	virtual void afterUninvoking(const std::string& xpath,
 	                             const std::string& invokeid,
-	                             const std::string& invokerXML) {}
+	                             const std::string& invokerXML) {
+		_defaulted |= AFTER_UNINVOKING;
+	}
 
 
 	void beforeTakingTransition(Interpreter& interpreter,
@@ -92,28 +197,36 @@ public:
 	virtual void beforeTakingTransition(const std::string& xpath,
 	                                    const std::string& source,
 	                                    const std::list<std::string>& targets,
-	                                    const std::string& transitionXML) {}
+	                                    const std::string& transitionXML) {
+		_defaulted |= BEFORE_TAKING_TRANSITION;
+	}
 
 	void afterTakingTransition(Interpreter& interpreter,
 	                           const XERCESC_NS::DOMElement* transition);
 	virtual void afterTakingTransition(const std::string& xpath,
 	                                   const std::string& source,
 	                                   const std::list<std::string>& targets,
-	                                   const std::string& transitionXML) {}
+	                                   const std::string& transitionXML) {
+		_defaulted |= AFTER_TAKING_TRANSITION;
+	}
 
 
 	void beforeEnteringState(Interpreter& interpreter,
 	                         const XERCESC_NS::DOMElement* state);
 	virtual void beforeEnteringState(const std::string& stateId,
 	                                 const std::string& xpath,
-	                                 const std::string& stateXML) {}
+	                                 const std::string& stateXML) {
+		_defaulted |= BEFORE_ENTERING_STATE;
+	}
 
 
 	void afterEnteringState(Interpreter& interpreter,
 	                        const XERCESC_NS::DOMElement* state);
 	virtual void afterEnteringState(const std::string& stateId,
 	                                const std::string& xpath,
-	                                const std::string& stateXML) {}
+	                                const std::string& stateXML) {
+		_defaulted |= AFTER_ENTERING_STATE;
+	}
 
 
 	void beforeInvoking(Interpreter& interpreter,
@@ -121,14 +234,18 @@ public:
 	                    const std::string& invokeid);
 	virtual void beforeInvoking(const std::string& xpath,
 	                            const std::string& invokeid,
-	                            const std::string& invokerXML) {}
+	                            const std::string& invokerXML) {
+		_defaulted |= BEFORE_INVOKING;
+	}
 
 	void afterInvoking(Interpreter& interpreter,
 	                   const XERCESC_NS::DOMElement* invoker,
 	                   const std::string& invokeid);
 	virtual void afterInvoking(const std::string& xpath,
 	                           const std::string& invokeid,
-	                           const std::string& invokerXML) {}
+	                           const std::string& invokerXML) {
+		_defaulted |= AFTER_INVOKING;
+	}
 
 	virtual void afterMicroStep(Interpreter& interpreter) {}
 	virtual void onStableConfiguration(Interpreter& interpreter) {}
@@ -138,6 +255,28 @@ public:
 
 	virtual void reportIssue(Interpreter& interpreter,
 	                         const InterpreterIssue& issue) {}
+
+protected:
+	size_t indexElement(const XERCESC_NS::DOMElement* element, const std::string** name = NULL);
+	const XERCESC_NS::DOMElement* elementForId(size_t elementId);
+	std::string invokeIdFor(const XERCESC_NS::DOMElement* invoker);
+	void dropChart(WrappedChartIndex* chart);
+
+	bool isDispatched(Callback callback) {
+		return (_callbackMask & callback) && !(getDefaultedCallbacks() & callback);
+	}
+
+	unsigned int _callbackMask;
+	bool _lightweight;
+	std::atomic<unsigned int> _defaulted;
+	std::atomic<unsigned int> _defaultedById;
+
+	std::recursive_mutex _mutex;
+	size_t _nextId;
+	std::map<size_t, WrappedChartIndex*> _charts; // by first id
+	XMLCh* _indexKey;
+
+	friend class WrappedChartIndex;
 };
 
 }
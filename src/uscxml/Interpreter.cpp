@@ -70,32 +70,9 @@ Interpreter Interpreter::fromXML(const std::string& xml, const std::string& base
 	std::shared_ptr<InterpreterImpl> interpreterImpl(new InterpreterImpl());
 	Interpreter interpreter(interpreterImpl);
 
-	std::unique_ptr<XERCESC_NS::XercesDOMParser> parser(new XERCESC_NS::XercesDOMParser());
-	std::unique_ptr<XERCESC_NS::ErrorHandler> errHandler(new XERCESC_NS::HandlerBase());
-
-	try {
-		parser->setValidationScheme(XERCESC_NS::XercesDOMParser::Val_Always);
-		parser->setDoNamespaces(true);
-		parser->useScanner(XERCESC_NS::XMLUni::fgWFXMLScanner);
-
-		parser->setErrorHandler(errHandler.get());
-
-		XERCESC_NS::MemBufInputSource is((XMLByte*)xml.c_str(), xml.size(), X("fake"));
-		parser->parse(is);
-
-		interpreterImpl->_document = parser->adoptDocument();
-		interpreterImpl->_baseURL = absUrl;
-		InterpreterImpl::addInstance(interpreterImpl);
-
-	} catch (const XERCESC_NS::SAXParseException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
-	} catch (const XERCESC_NS::RuntimeException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
-	} catch (const XERCESC_NS::XMLException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
-	} catch (const XERCESC_NS::DOMException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
-	}
+	interpreterImpl->_document = InterpreterImpl::parseXML(xml);
+	interpreterImpl->_baseURL = absUrl;
+	InterpreterImpl::addInstance(interpreterImpl);
 
 	return interpreter;
 }
@@ -154,34 +131,9 @@ Interpreter Interpreter::fromURL(const std::string& url) {
 	std::shared_ptr<InterpreterImpl> interpreterImpl(new InterpreterImpl());
 	Interpreter interpreter(interpreterImpl);
 
-	std::unique_ptr<XERCESC_NS::XercesDOMParser> parser(new XERCESC_NS::XercesDOMParser());
-	parser->setValidationScheme(XERCESC_NS::XercesDOMParser::Val_Always);
-	parser->setDoNamespaces(true);
-
-	// we do not have a real schema anyway
-	parser->useScanner(XERCESC_NS::XMLUni::fgWFXMLScanner);
-
-	std::unique_ptr<XERCESC_NS::ErrorHandler> errHandler(new XERCESC_NS::HandlerBase());
-	parser->setErrorHandler(errHandler.get());
-
-
-	try {
-		std::string tmp = absUrl;
-		parser->parse(tmp.c_str());
-		interpreterImpl->_document = parser->adoptDocument();
-		interpreterImpl->_baseURL = absUrl;
-		InterpreterImpl::addInstance(interpreterImpl);
-	}
-
-	catch (const XERCESC_NS::SAXParseException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()));
-	} catch (const XERCESC_NS::RuntimeException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()));
-	} catch (const XERCESC_NS::XMLException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()));
-	} catch (const XERCESC_NS::DOMException& toCatch) {
-		ERROR_PLATFORM_THROW(X(toCatch.getMessage()));
-	}
+	interpreterImpl->_document = InterpreterImpl::parseURL(absUrl);
+	interpreterImpl->_baseURL = absUrl;
+	InterpreterImpl::addInstance(interpreterImpl);
 
 	return interpreter;
 
@@ -0,0 +1,251 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "uscxml/debug/BreakpointIndex.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/Predicates.h"
+
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
+namespace uscxml {
+
+using namespace XERCESC_NS;
+
+static void collectElements(const DOMElement* element, std::list<const DOMElement*>& elements) {
+	elements.push_back(element);
+	for (DOMElement* child = element->getFirstElementChild(); child; child = child->getNextElementSibling()) {
+		collectElements(child, elements);
+	}
+}
+
+void BreakpointIndex::clear() {
+	_any.clear();
+	_subjects.clear();
+	_events = EventNode();
+	_size = 0;
+}
+
+bool BreakpointIndex::empty() const {
+	return _size == 0;
+}
+
+void BreakpointIndex::rebuild(const std::set<Breakpoint>& breakpoints, const DOMElement* root) {
+	clear();
+
+	std::list<const DOMElement*> elements;
+	if (root != NULL)
+		collectElements(root, elements);
+
+	for (auto& breakpoint : breakpoints) {
+		if (!breakpoint.enabled)
+			continue;
+		index(&breakpoint, elements);
+		_size++;
+	}
+}
+
+void BreakpointIndex::index(const Breakpoint* breakpoint, const std::list<const DOMElement*>& elements) {
+	if (breakpoint->subject == Breakpoint::UNDEF_SUBJECT) {
+		_any.push_back(breakpoint);
+		return;
+	}
+
+	SubjectIndex& subject = _subjects[breakpoint->subject];
+
+	if (breakpoint->subject == Breakpoint::EVENT) {
+		indexEvent(breakpoint);
+		return;
+	}
+
+	// without a document we cannot resolve anything
+	if (elements.empty()) {
+		subject.generic.push_back(breakpoint);
+		return;
+	}
+
+	switch (breakpoint->subject) {
+	case Breakpoint::STATE:
+		if (breakpoint->stateId.length() > 0) {
+			for (auto element : elements) {
+				if (isState(element, false) && ATTR(element, kXMLCharId) == breakpoint->stateId)
+					subject.byElement[element].push_back(breakpoint);
+			}
+			return;
+		}
+		break;
+	case Breakpoint::TRANSITION:
+		if (breakpoint->transSourceId.length() > 0 || breakpoint->transTargetId.length() > 0) {
+			for (auto element : elements) {
+				if (LOCALNAME(element) != "transition")
+					continue;
+
+				if (breakpoint->transSourceId.length() > 0) {
+					DOMElement* source = getSourceState(element);
+					if (source == NULL || ATTR(source, kXMLCharId) != breakpoint->transSourceId)
+						continue;
+				}
+
+				if (breakpoint->transTargetId.length() > 0) {
+					std::string target = ATTR(element, kXMLCharTarget);
+					std::list<std::string> targets;
+					boost::split(targets, target, boost::is_any_of(" \t\n\r"), boost::token_compress_on);
+					if (std::find(targets.begin(), targets.end(), breakpoint->transTargetId) == targets.end())
+						continue;
+				}
+				subject.byElement[element].push_back(breakpoint);
+			}
+			return;
+		}
+		break;
+	case Breakpoint::EXECUTABLE:
+		if (breakpoint->executableName.length() > 0) {
+			for (auto element : elements) {
+				if (LOCALNAME(element) == breakpoint->executableName)
+					subject.byElement[element].push_back(breakpoint);
+			}
+			return;
+		}
+		break;
+	default:
+		// invokers are only known by their runtime invokeid and type
+		break;
+	}
+
+	subject.generic.push_back(breakpoint);
+}
+
+void BreakpointIndex::indexEvent(const Breakpoint* breakpoint) {
+	SubjectIndex& subject = _subjects[Breakpoint::EVENT];
+
+	if (breakpoint->eventName.length() == 0) {
+		subject.generic.push_back(breakpoint);
+		return;
+	}
+
+	std::list<std::string> descriptors;
+	boost::split(descriptors, breakpoint->eventName, boost::is_any_of(" \t\n\r"), boost::token_compress_on);
+
+	for (auto descriptor : descriptors) {
+		if (descriptor.length() == 0)
+			continue;
+
+		// same normalization as nameMatch
+		if (boost::ends_with(descriptor, "*"))
+			descriptor = descriptor.substr(0, descriptor.size() - 1);
+		if (boost::ends_with(descriptor, "."))
+			descriptor = descriptor.substr(0, descriptor.size() - 1);
+
+		if (descriptor.length() == 0) {
+			subject.generic.push_back(breakpoint);
+			continue;
+		}
+
+		std::list<std::string> tokens;
+		boost::split(tokens, boost::to_lower_copy(descriptor), boost::is_any_of("."));
+
+		EventNode* node = &_events;
+		for (auto token : tokens) {
+			node = &node->children[token];
+		}
+		node->breakpoints.push_back(breakpoint);
+	}
+}
+
+void BreakpointIndex::eventNodes(const std::string& eventName, std::list<const EventNode*>& nodes) const {
+	const EventNode* node = &_events;
+
+	size_t start = 0;
+	while (start <= eventName.size()) {
+		size_t end = eventName.find('.', start);
+		if (end == std::string::npos)
+			end = eventName.size();
+
+		auto childIter = node->children.find(boost::to_lower_copy(eventName.substr(start, end - start)));
+		if (childIter == node->children.end())
+			return;
+
+		node = &childIter->second;
+		if (!node->breakpoints.empty())
+			nodes.push_back(node);
+		start = end + 1;
+	}
+}
+
+bool BreakpointIndex::watches(Breakpoint::Subject subject, const DOMElement* element) const {
+	if (_size == 0)
+		return false;
+	if (!_any.empty())
+		return true;
+
+	auto subjectIter = _subjects.find(subject);
+	if (subjectIter == _subjects.end())
+		return false;
+	if (!subjectIter->second.generic.empty())
+		return true;
+
+	return (element != NULL && subjectIter->second.byElement.find(element) != subjectIter->second.byElement.end());
+}
+
+bool BreakpointIndex::watchesEvent(const std::string& eventName) const {
+	if (watches(Breakpoint::EVENT, NULL))
+		return true;
+	if (_events.children.empty())
+		return false;
+
+	std::list<const EventNode*> nodes;
+	eventNodes(eventName, nodes);
+	return !nodes.empty();
+}
+
+void BreakpointIndex::candidates(const Breakpoint& qualified, std::list<Breakpoint>& result) const {
+	// a breakpoint with several event descriptors may be indexed more than once
+	std::set<const Breakpoint*> seen;
+	std::list<const std::list<const Breakpoint*>*> lists;
+
+	lists.push_back(&_any);
+
+	auto subjectIter = _subjects.find(qualified.subject);
+	if (subjectIter != _subjects.end()) {
+		lists.push_back(&subjectIter->second.generic);
+
+		if (qualified.element != NULL) {
+			auto elementIter = subjectIter->second.byElement.find(qualified.element);
+			if (elementIter != subjectIter->second.byElement.end())
+				lists.push_back(&elementIter->second);
+		}
+	}
+
+	std::list<const EventNode*> nodes;
+	if (qualified.subject == Breakpoint::EVENT) {
+		eventNodes(qualified.eventName, nodes);
+		for (auto node : nodes) {
+			lists.push_back(&node->breakpoints);
+		}
+	}
+
+	for (auto list : lists) {
+		for (auto breakpoint : *list) {
+			if (seen.insert(breakpoint).second)
+				result.push_back(*breakpoint);
+		}
+	}
+}
+
+}
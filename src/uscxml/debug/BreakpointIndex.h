@@ -0,0 +1,84 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef BREAKPOINTINDEX_H_4C1E9D27
+#define BREAKPOINTINDEX_H_4C1E9D27
+
+#include "uscxml/Common.h"              // for USCXML_API
+#include "uscxml/debug/Breakpoint.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+// forward declare
+namespace XERCESC_NS {
+class DOMElement;
+}
+
+namespace uscxml {
+
+/**
+ * Breakpoints by subject, resolved to the elements they can match when they
+ * are added, with a trie over the tokens of event descriptors. It only narrows
+ * the candidates, Breakpoint::matches still has the final say.
+ */
+class USCXML_API BreakpointIndex {
+public:
+	BreakpointIndex() {}
+
+	void clear();
+	/// Index all enabled breakpoints, root may be NULL if there is no document yet
+	void rebuild(const std::set<Breakpoint>& breakpoints, const XERCESC_NS::DOMElement* root);
+
+	bool empty() const;
+
+	/// Can any breakpoint match a callback for the given subject and element?
+	bool watches(Breakpoint::Subject subject, const XERCESC_NS::DOMElement* element) const;
+	bool watchesEvent(const std::string& eventName) const;
+
+	/// Breakpoints possibly matching the qualified breakpoint from a callback
+	void candidates(const Breakpoint& qualified, std::list<Breakpoint>& result) const;
+
+protected:
+	struct EventNode {
+		std::list<const Breakpoint*> breakpoints;
+		std::map<std::string, EventNode> children;
+	};
+
+	struct SubjectIndex {
+		std::list<const Breakpoint*> generic;
+		std::unordered_map<const XERCESC_NS::DOMElement*, std::list<const Breakpoint*> > byElement;
+	};
+
+	void index(const Breakpoint* breakpoint, const std::list<const XERCESC_NS::DOMElement*>& elements);
+	void indexEvent(const Breakpoint* breakpoint);
+	void eventNodes(const std::string& eventName, std::list<const EventNode*>& nodes) const;
+
+	std::list<const Breakpoint*> _any; // no subject, matches every callback
+	std::map<Breakpoint::Subject, SubjectIndex> _subjects;
+	EventNode _events;
+	size_t _size = 0;
+};
+
+}
+
+#endif /* end of include guard: BREAKPOINTINDEX_H_4C1E9D27 */
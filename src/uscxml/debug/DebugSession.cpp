@@ -25,6 +25,41 @@
 
 namespace uscxml {
 
+bool DebugSession::isWatching(Breakpoint::Subject subject, const XERCESC_NS::DOMElement* element) {
+	if (!_breakpointsEnabled)
+		return false;
+	if (_isStepping || _skipTo)
+		return true;
+	if (_nrBreakpoints == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(_indexMutex);
+	return _index.watches(subject, element);
+}
+
+bool DebugSession::isWatchingEvent(const std::string& eventName) {
+	if (!_breakpointsEnabled)
+		return false;
+	if (_isStepping || _skipTo)
+		return true;
+	if (_nrBreakpoints == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(_indexMutex);
+	return _index.watchesEvent(eventName);
+}
+
+void DebugSession::rebuildIndex() {
+	std::lock_guard<std::mutex> lock(_indexMutex);
+
+	const XERCESC_NS::DOMElement* root = NULL;
+	if (_interpreter && _interpreter.getImpl()->getDocument() != NULL)
+		root = _interpreter.getImpl()->getDocument()->getDocumentElement();
+
+	_index.rebuild(_breakPoints, root);
+	_nrBreakpoints = (_index.empty() ? 0 : _breakPoints.size());
+}
+
 void DebugSession::checkBreakpoints(const std::list<Breakpoint> qualifiedBreakpoints) {
 	std::list<Breakpoint>::const_iterator qualifiedBreakpointIter = qualifiedBreakpoints.begin();
 
@@ -48,8 +83,15 @@ void DebugSession::checkBreakpoints(const std::list<Breakpoint> qualifiedBreakpo
 			continue;
 		}
 
-		std::set<Breakpoint>::const_iterator breakpointIter = _breakPoints.begin();
-		while(breakpointIter != _breakPoints.end()) {
+		// copies, the client may change breakpoints while we are halted
+		std::list<Breakpoint> candidates;
+		{
+			std::lock_guard<std::mutex> lock(_indexMutex);
+			_index.candidates(qualifiedBreakpoint, candidates);
+		}
+
+		std::list<Breakpoint>::const_iterator breakpointIter = candidates.begin();
+		while(breakpointIter != candidates.end()) {
 			const Breakpoint& breakpoint = *breakpointIter++;
 			if (!breakpoint.enabled)
 				continue;
@@ -121,6 +163,7 @@ Data DebugSession::debugPrepare(const Data& data) {
 		// register ourself as a monitor
 		_interpreter.addMonitor(_debugger);
 		_debugger->attachSession(_interpreter.getImpl().get(), shared_from_this());
+		rebuildIndex();
 
 		replyData.compound["status"] = Data("success", Data::VERBATIM);
 	} else {
@@ -144,16 +187,12 @@ Data DebugSession::debugAttach(const Data& data) {
 	bool interpreterFound = false;
 
 	// find interpreter for sessionid
-	std::map<std::string, std::weak_ptr<InterpreterImpl> > instances = InterpreterImpl::getInstances();
-	for (auto weakInstance : instances) {
-
-		std::shared_ptr<InterpreterImpl> instance = weakInstance.second.lock();
-		if (instance && instance->getSessionId() == interpreterId) {
-			_interpreter = instance;
-			_debugger->attachSession(_interpreter.getImpl().get(), shared_from_this());
-			interpreterFound = true;
-			break;
-		}
+	std::shared_ptr<InterpreterImpl> instance = InterpreterImpl::getInstance(interpreterId);
+	if (instance) {
+		_interpreter = instance;
+		rebuildIndex();
+		_debugger->attachSession(_interpreter.getImpl().get(), shared_from_this());
+		interpreterFound = true;
 	}
 
 	if (!interpreterFound) {
@@ -242,6 +281,7 @@ Data DebugSession::debugStop(const Data& data) {
 
 	// calls destructor
 	_interpreter = Interpreter();
+	rebuildIndex();
 
 	return replyData;
 }
@@ -319,8 +359,13 @@ Data DebugSession::addBreakPoint(const Data& data) {
 	Breakpoint breakpoint(data);
 
 	Data replyData;
-	if (_breakPoints.find(breakpoint) == _breakPoints.end()) {
-		_breakPoints.insert(breakpoint);
+	bool inserted;
+	{
+		std::lock_guard<std::mutex> lock(_indexMutex);
+		inserted = _breakPoints.insert(breakpoint).second;
+	}
+	if (inserted) {
+		rebuildIndex();
 		replyData.compound["status"] = Data("success", Data::VERBATIM);
 
 	} else {
@@ -334,8 +379,13 @@ Data DebugSession::removeBreakPoint(const Data& data) {
 	Breakpoint breakpoint(data);
 
 	Data replyData;
-	if (_breakPoints.find(breakpoint) != _breakPoints.end()) {
-		_breakPoints.erase(breakpoint);
+	bool erased;
+	{
+		std::lock_guard<std::mutex> lock(_indexMutex);
+		erased = (_breakPoints.erase(breakpoint) > 0);
+	}
+	if (erased) {
+		rebuildIndex();
 		replyData.compound["status"] = Data("success", Data::VERBATIM);
 	} else {
 		replyData.compound["reason"] = Data("No such breakpoint", Data::VERBATIM);
@@ -344,12 +394,22 @@ Data DebugSession::removeBreakPoint(const Data& data) {
 	return replyData;
 }
 
+bool DebugSession::setBreakPointEnabled(const Breakpoint& breakpoint, bool enabled) {
+	// the interpreter thread copies candidates from the same set
+	std::lock_guard<std::mutex> lock(_indexMutex);
+	std::set<Breakpoint>::iterator breakpointIter = _breakPoints.find(breakpoint);
+	if (breakpointIter == _breakPoints.end())
+		return false;
+	breakpointIter->enabled = enabled;
+	return true;
+}
+
 Data DebugSession::enableBreakPoint(const Data& data) {
 	Breakpoint breakpoint(data);
 
 	Data replyData;
-	if (_breakPoints.find(breakpoint) != _breakPoints.end()) {
-		_breakPoints.find(breakpoint)->enabled = true;
+	if (setBreakPointEnabled(breakpoint, true)) {
+		rebuildIndex();
 		replyData.compound["status"] = Data("success", Data::VERBATIM);
 	} else {
 		replyData.compound["reason"] = Data("No such breakpoint", Data::VERBATIM);
@@ -362,8 +422,8 @@ Data DebugSession::disableBreakPoint(const Data& data) {
 	Breakpoint breakpoint(data);
 
 	Data replyData;
-	if (_breakPoints.find(breakpoint) != _breakPoints.end()) {
-		_breakPoints.find(breakpoint)->enabled = false;
+	if (setBreakPointEnabled(breakpoint, false)) {
+		rebuildIndex();
 		replyData.compound["status"] = Data("success", Data::VERBATIM);
 	} else {
 		replyData.compound["reason"] = Data("No such breakpoint", Data::VERBATIM);
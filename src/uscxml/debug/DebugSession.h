@@ -21,12 +21,14 @@
 #define DEBUGSESSION_H_M8YHEGV6
 
 #include "uscxml/debug/Breakpoint.h"
+#include "uscxml/debug/BreakpointIndex.h"
 #include "uscxml/Interpreter.h"
 #include "uscxml/interpreter/LoggingImpl.h"
 
 #include <time.h>
 #include <set>
 #include <thread>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
@@ -43,6 +45,7 @@ public:
 		_breakpointsEnabled = true;
 		_markedForDeletion = false;
 		_debugger = NULL;
+		_nrBreakpoints = 0;
 	}
 
 	void stepping(bool enable) {
@@ -51,6 +54,10 @@ public:
 
 	void checkBreakpoints(const std::list<Breakpoint> qualifiedBreakpoints);
 
+	/// Whether a callback for the subject may break at all, called before qualifying it
+	bool isWatching(Breakpoint::Subject subject, const XERCESC_NS::DOMElement* element = NULL);
+	bool isWatchingEvent(const std::string& eventName);
+
 	Data debugPrepare(const Data& data);
 	Data debugAttach(const Data& data);
 	Data debugDetach(const Data& data);
@@ -90,6 +97,8 @@ public:
 
 protected:
 	void breakExecution(Data replyData);
+	void rebuildIndex();
+	bool setBreakPointEnabled(const Breakpoint& breakpoint, bool enabled);
 
 	bool _isStepping;
 	bool _isAttached;
@@ -109,6 +118,10 @@ protected:
 	std::set<Breakpoint> _breakPoints;
 	Breakpoint _skipTo;
 
+	std::mutex _indexMutex;
+	BreakpointIndex _index;
+	std::atomic<size_t> _nrBreakpoints;
+
 	friend class Debugger;
 };
 
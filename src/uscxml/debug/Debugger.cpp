@@ -145,6 +145,8 @@ void Debugger::handleExecutable(Interpreter& interpreter,
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::EXECUTABLE, execContentElem))
+		return;
 
 	std::list<Breakpoint> breakpoints;
 
@@ -166,6 +168,8 @@ void Debugger::handleEvent(Interpreter& interpreter, const Event& event, Breakpo
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatchingEvent(event.name))
+		return;
 
 	std::list<Breakpoint> breakpoints;
 
@@ -186,6 +190,8 @@ void Debugger::handleStable(Interpreter& interpreter, Breakpoint::When when) {
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::STABLE))
+		return;
 
 	std::list<Breakpoint> breakpoints;
 
@@ -204,6 +210,8 @@ void Debugger::handleMicrostep(Interpreter& interpreter, Breakpoint::When when)
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::MICROSTEP))
+		return;
 
 	std::list<Breakpoint> breakpoints;
 
@@ -222,6 +230,8 @@ void Debugger::handleTransition(Interpreter& interpreter, const XERCESC_NS::DOME
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::TRANSITION, transition))
+		return;
 
 	Breakpoint breakpointTemplate;
 	breakpointTemplate.when = when;
@@ -236,6 +246,8 @@ void Debugger::handleState(Interpreter& interpreter, const XERCESC_NS::DOMElemen
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::STATE, state))
+		return;
 
 	Breakpoint breakpointTemplate;
 	breakpointTemplate.when = when;
@@ -252,6 +264,8 @@ void Debugger::handleInvoke(Interpreter& interpreter, const XERCESC_NS::DOMEleme
 		return;
 	if (!session->_isRunning)
 		return;
+	if (!session->isWatching(Breakpoint::INVOKER, invokeElem))
+		return;
 
 	Breakpoint breakpointTemplate;
 	breakpointTemplate.when = when;
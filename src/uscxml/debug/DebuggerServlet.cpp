@@ -223,21 +223,17 @@ void DebuggerServlet::processDisconnect(const HTTPServer::Request& request) {
 void DebuggerServlet::processListSessions(const HTTPServer::Request& request) {
 	Data replyData;
 
-	std::map<std::string, std::weak_ptr<InterpreterImpl> > instances = InterpreterImpl::getInstances();
 	int index = 0;
-	for (auto weakInstance : instances) {
-
-		std::shared_ptr<InterpreterImpl> instance = weakInstance.second.lock();
-		if (instance) {
-			Data sessionData;
-			sessionData.compound["name"] = Data(instance->getName(), Data::VERBATIM);
-			sessionData.compound["id"] = Data(instance->getSessionId(), Data::VERBATIM);
-			sessionData.compound["source"] = Data(instance->getBaseURL(), Data::VERBATIM);
-			sessionData.compound["xml"].node = instance->getDocument();
-
-			replyData.compound["sessions"].array.insert(std::make_pair(index++,sessionData));
-		}
-	}
+	InterpreterImpl::forEachInstance([&replyData, &index](const std::shared_ptr<InterpreterImpl>& instance) {
+		Data sessionData;
+		sessionData.compound["name"] = Data(instance->getName(), Data::VERBATIM);
+		sessionData.compound["id"] = Data(instance->getSessionId(), Data::VERBATIM);
+		sessionData.compound["source"] = Data(instance->getBaseURL(), Data::VERBATIM);
+		sessionData.compound["xml"].node = instance->getDocument();
+
+		replyData.compound["sessions"].array.insert(std::make_pair(index++,sessionData));
+		return true;
+	});
 
 	replyData.compound["status"] = Data("success", Data::VERBATIM);
 	returnData(request, replyData);
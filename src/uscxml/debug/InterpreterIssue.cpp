@@ -18,6 +18,9 @@
  */
 
 #include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "InterpreterIssue.h"
 #include "uscxml/util/DOM.h"
@@ -37,77 +40,231 @@ InterpreterIssue::InterpreterIssue(const std::string& msg, DOMNode* node, IssueS
 		xPath = DOMUtils::xPathForNode(node);
 }
 
-// find all elements in the SCXML namespace in one traversal
-void assembleNodeSets(const std::string nsPrefix, DOMElement* node, std::map<std::string, std::list<DOMElement*> >& sets) {
-	for (auto childElem = node->getFirstElementChild(); childElem; childElem = childElem->getNextElementSibling()) {
-
-		if (TAGNAME(childElem).find(nsPrefix) == 0) {
-			// correct namespace, insert via localname
-			sets[LOCALNAME(childElem)].push_back(static_cast<DOMElement*>(childElem));
+/**
+ * All elements below a root, indexed in a single traversal of the document.
+ *
+ * Every element is assigned its position in document order and the position
+ * of its last descendant, so ancestry becomes an interval check. States are
+ * looked up by id per machine, mirroring the breadth-first search of
+ * uscxml::getState().
+ */
+class ValidationIndex {
+public:
+	ValidationIndex(const std::string& nsPrefix, DOMElement* root) : _nrElements(0) {
+		traverse(nsPrefix, root, NULL);
+
+		std::list<DOMElement*> machines = nodeSets["scxml"];
+		machines.push_back(root);
+		for (auto machine : machines) {
+			indexStates(machine);
 		}
-		assembleNodeSets(nsPrefix, childElem, sets);
 	}
-}
 
-std::list<std::set<const DOMElement* > > getAllConfigurations(const DOMElement* root) {
-	std::list<std::set<const DOMElement* > > allConfigurations;
-	std::string nsPrefix = X(root->getPrefix());
-	std::string localName = X(root->getLocalName());
-	bool isAtomic = true;
+	size_t size() const {
+		return _nrElements;
+	}
 
-//	std::cout << *root;
+	bool isDescendant(const DOMNode* s1, const DOMNode* s2) const {
+		auto i1 = _intervals.find(s1);
+		auto i2 = _intervals.find(s2);
+		if (i1 == _intervals.end() || i2 == _intervals.end())
+			return DOMUtils::isDescendant(s1, s2);
+		return (i2->second.pre < i1->second.pre && i1->second.pre <= i2->second.last);
+	}
 
-	for (auto childElem = root->getFirstElementChild(); childElem; childElem = childElem->getNextElementSibling()) {
-//		std::cout << *childElem;
+	/// the innermost scxml element containing the node, see uscxml::getScxmlNode()
+	const DOMElement* getMachine(const DOMNode* node) const {
+		auto iter = _intervals.find(node);
+		if (iter == _intervals.end())
+			return getScxmlNode(node);
+		return iter->second.machine;
+	}
 
-		if (XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "state")) == 0 ||
-		        XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "parallel")) == 0 ||
-		        XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "final")) == 0) {
-			// nested child state
-			std::list<std::set<const DOMElement*> > nestedConfigurations = getAllConfigurations(childElem);
-			isAtomic = false;
-			if (localName == "parallel" && allConfigurations.size() > 0) {
-				// for every nested configuration, every new nested is valid
-				std::list<std::set<const DOMElement*> > combinedConfigurations;
-				for (auto existIter = allConfigurations.begin(); existIter != allConfigurations.end(); existIter++) {
-					std::set<const DOMElement*> existingConfig = *existIter;
+	DOMElement* getState(const std::string& stateId, const DOMElement* root) const {
+		auto machineIter = _stateIds.find(root);
+		if (machineIter == _stateIds.end())
+			return uscxml::getState(stateId, root);
+		auto stateIter = machineIter->second.find(stateId);
+		if (stateIter == machineIter->second.end())
+			return NULL;
+		return stateIter->second;
+	}
 
-					for (auto newIter = nestedConfigurations.begin(); newIter != nestedConfigurations.end(); newIter++) {
+	std::list<DOMElement*> getTargetStates(const DOMElement* transition, const DOMElement* root) const {
+		std::list<DOMElement*> targetStates;
+		std::list<std::string> targetIds = tokenize(ATTR(transition, kXMLCharTarget));
+		for (auto targetIter = targetIds.begin(); targetIter != targetIds.end(); targetIter++) {
+			DOMElement* state = getState(*targetIter, root);
+			if (state)
+				targetStates.push_back(state);
+		}
+		return targetStates;
+	}
 
-						std::set<const DOMElement*> newConfig = *newIter;
-						std::set<const DOMElement*> combinedSet;
-						combinedSet.insert(existingConfig.begin(), existingConfig.end());
-						combinedSet.insert(newConfig.begin(), newConfig.end());
+	/// see uscxml::getInitialStates()
+	std::list<DOMElement*> getInitialStates(const DOMElement* state, const DOMElement* root) const {
+		if (isAtomic(state))
+			return std::list<DOMElement*>();
 
-						combinedConfigurations.push_back(combinedSet);
-					}
+		if (isParallel(state))
+			return getChildStates(state);
+
+		if (isCompound(state)) {
+			if (HAS_ATTR(state, kXMLCharInitial)) {
+				std::list<DOMElement*> initStates;
+				std::list<std::string> initIds = tokenize(ATTR(state, kXMLCharInitial));
+				for (auto initIter = initIds.begin(); initIter != initIds.end(); initIter++) {
+					DOMElement* initState = getState(*initIter, root);
+					if (initState)
+						initStates.push_back(initState);
 				}
-				allConfigurations = combinedConfigurations;
-			} else {
-				// just add nested configurations and this
-				for (auto newIter = nestedConfigurations.begin(); newIter != nestedConfigurations.end(); newIter++) {
-					std::set<const DOMElement*> newConfig = *newIter;
-					if (localName != "scxml")
-						newConfig.insert(root);
-					allConfigurations.push_back(newConfig);
+				return initStates;
+			}
+
+			std::list<DOMElement*> initElems = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "initial", state);
+			if(initElems.size() > 0 ) {
+				std::list<DOMElement*> initTrans = DOMUtils::filterChildElements(XML_PREFIX(initElems.front()).str() + "transition", initElems.front());
+				if (initTrans.size() > 0 && HAS_ATTR(initTrans.front(), kXMLCharTarget)) {
+					return getTargetStates(initTrans.front(), root);
 				}
+				return std::list<DOMElement*>();
+			}
+
+			for (auto childElem = state->getFirstElementChild(); childElem; childElem = childElem->getNextElementSibling()) {
+				if (isState(childElem)) {
+					return std::list<DOMElement*>(1, childElem);
+				}
+			}
+		}
+		return std::list<DOMElement*>();
+	}
+
+	/// see uscxml::getReachableStates(), but linear in the number of states
+	std::unordered_set<const DOMElement*> getReachableStates(const DOMElement* root) const {
+		std::unordered_set<const DOMElement*> reachable;
+		std::list<const DOMElement*> pending;
+
+		reachable.insert(root);
+		pending.push_back(root);
+
+		while (pending.size() > 0) {
+			const DOMElement* state = pending.front();
+			pending.pop_front();
+
+			std::list<DOMElement*> successors = getInitialStates(state, root);
+
+			std::list<DOMElement*> transitions = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "transition", state, false);
+			for (auto transIter = transitions.begin(); transIter != transitions.end(); transIter++) {
+				std::list<DOMElement*> targets = getTargetStates(*transIter, root);
+				successors.insert(successors.end(), targets.begin(), targets.end());
+			}
+
+			if (isAtomic(state)) {
+				DOMNode* parent = state->getParentNode();
+				while(parent && parent->getNodeType() == DOMNode::ELEMENT_NODE) {
+					DOMElement* parentElem = static_cast<DOMElement*>(parent);
+					if (!isState(parentElem))
+						break;
+					successors.push_back(parentElem);
+					parent = parent->getParentNode();
+				}
+			}
+
+			for (auto succIter = successors.begin(); succIter != successors.end(); succIter++) {
+				if (reachable.insert(*succIter).second)
+					pending.push_back(*succIter);
 			}
 		}
+		return reachable;
 	}
 
-	if (isAtomic) {
-		std::set<const DOMElement*> soleConfig;
-		soleConfig.insert(root);
-		allConfigurations.push_back(soleConfig);
+	std::map<std::string, std::list<DOMElement*> > nodeSets;
+
+protected:
+	struct Interval {
+		size_t pre;
+		size_t last;
+		const DOMElement* machine;
+	};
+
+	void traverse(const std::string& nsPrefix, DOMElement* node, const DOMElement* machine) {
+		size_t pre = _nrElements++;
+		if (iequals(LOCALNAME(node), "scxml"))
+			machine = node;
+
+		for (auto childElem = node->getFirstElementChild(); childElem; childElem = childElem->getNextElementSibling()) {
+			if (TAGNAME(childElem).find(nsPrefix) == 0) {
+				// correct namespace, insert via localname
+				nodeSets[LOCALNAME(childElem)].push_back(childElem);
+			}
+			traverse(nsPrefix, childElem, machine);
+		}
+
+		Interval& interval = _intervals[node];
+		interval.pre = pre;
+		interval.last = _nrElements - 1;
+		interval.machine = machine;
 	}
-	return allConfigurations;
 
+	void indexStates(const DOMElement* root) {
+		std::unordered_map<std::string, DOMElement*>& stateIds = _stateIds[root];
+
+		std::list<const DOMElement*> stateStack;
+		stateStack.push_back(root);
+
+		while(stateStack.size() > 0) {
+			const DOMElement* curr = stateStack.front();
+			stateStack.pop_front();
+
+			// first in breadth-first order wins as with getState()
+			if (HAS_ATTR(curr, kXMLCharId))
+				stateIds.insert(std::make_pair(ATTR(curr, kXMLCharId), (DOMElement*)curr));
+
+			std::list<DOMElement*> children = getChildStates(curr, false);
+			stateStack.insert(stateStack.end(), children.begin(), children.end());
+		}
+	}
+
+	size_t _nrElements;
+	std::unordered_map<const DOMNode*, Interval> _intervals;
+	std::unordered_map<const DOMElement*, std::unordered_map<std::string, DOMElement*> > _stateIds;
+};
+
+/**
+ * Number of legal configurations below root, saturated at max.
+ */
+static size_t countConfigurations(const DOMElement* root, size_t max) {
+	std::string nsPrefix = X(root->getPrefix());
+	std::string localName = X(root->getLocalName());
+	bool isParallel = (localName == "parallel");
+	bool isAtomic = true;
+	size_t configurations = 0;
+
+	for (auto childElem = root->getFirstElementChild(); childElem; childElem = childElem->getNextElementSibling()) {
+		if (XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "state")) == 0 ||
+		        XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "parallel")) == 0 ||
+		        XMLString::compareIString(childElem->getTagName(), X(nsPrefix + "final")) == 0) {
+			size_t nested = countConfigurations(childElem, max);
+			if (isParallel && !isAtomic) {
+				// every nested configuration combines with every existing one
+				configurations *= nested;
+			} else {
+				configurations += nested;
+			}
+			configurations = (std::min)(configurations, max);
+			isAtomic = false;
+		}
+	}
+
+	if (isAtomic)
+		return 1;
+	return configurations;
 }
 
 /**
  * Can the given states ever appear in an active configuration?
  */
-bool hasLegalCompletion(const std::list<DOMElement*>& states) {
+static bool hasLegalCompletion(const ValidationIndex& index, const std::list<DOMElement*>& states) {
 	if (states.size() < 2)
 		return true;
 
@@ -122,13 +279,13 @@ bool hasLegalCompletion(const std::list<DOMElement*>& states) {
 			DOMNode* parent;
 
 			// ok to be directly ancestorally related
-			if (DOMUtils::isDescendant(s1, s2) || DOMUtils::isDescendant(s2, s1))
+			if (index.isDescendant(s1, s2) || index.isDescendant(s2, s1))
 				goto NEXT_PAIR;
 
 			// find least common ancestor
 			parent = s1->getParentNode();
 			while(parent && parent->getNodeType() == DOMNode::ELEMENT_NODE) {
-				if (DOMUtils::isDescendant(s2, parent)) {
+				if (index.isDescendant(s2, parent)) {
 					if (isParallel(static_cast<DOMElement*>(parent)))
 						goto NEXT_PAIR;
 				}
@@ -143,6 +300,12 @@ NEXT_PAIR:
 	return true;
 }
 
+static std::string machinePrefix(const DOMElement* scxmlRoot) {
+	if (scxmlRoot && HAS_ATTR(scxmlRoot, kXMLCharName))
+		return "[" + ATTR(scxmlRoot, kXMLCharName) + "]: ";
+	return "";
+}
+
 std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* interpreter) {
 	// some things we need to prepare first
 	if (interpreter->_factory == NULL)
@@ -157,7 +320,7 @@ std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* in
 		return issues;
 	}
 
-	std::map<std::string, DOMElement* > seenStates;
+	std::unordered_map<std::string, DOMElement* > seenStates;
 
 	// get some aliases
 	DOMElement* _scxml = interpreter->_scxml;
@@ -165,18 +328,12 @@ std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* in
 	DataModel& _dataModel = interpreter->_dataModel;
 	std::string xmlNSPrefix = interpreter->_xmlPrefix;
 
-	std::map<std::string, std::list<DOMElement*> > nodeSets;
-	assembleNodeSets(xmlNSPrefix, _scxml, nodeSets);
-
+	ValidationIndex index(xmlNSPrefix, _scxml);
+	std::map<std::string, std::list<DOMElement*> >& nodeSets = index.nodeSets;
 
 	std::list<DOMElement*> scxmls = nodeSets["scxml"];
 	scxmls.push_back(_scxml);
 
-	std::map<DOMElement*, std::list<XERCESC_NS::DOMElement*>> reachable;
-	for (const auto it : scxmls) {
-		reachable[it] = getReachableStates(it);
-	}
-
 	std::list<DOMElement*>& states = nodeSets["state"];
 	std::list<DOMElement*>& parallels = nodeSets["parallel"];
 	std::list<DOMElement*>& transitions = nodeSets["transition"];
@@ -212,22 +369,31 @@ std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* in
 	allStates.insert(allStates.end(), histories.begin(), histories.end());
 	allStates.insert(allStates.end(), finals.begin(), finals.end());
 
-	std::list<DOMElement*> allExecContents;
-	allExecContents.insert(allExecContents.end(), raises.begin(), raises.end());
-	allExecContents.insert(allExecContents.end(), ifs.begin(), ifs.end());
-	allExecContents.insert(allExecContents.end(), elseIfs.begin(), elseIfs.end());
-	allExecContents.insert(allExecContents.end(), elses.begin(), elses.end());
-	allExecContents.insert(allExecContents.end(), foreachs.begin(), foreachs.end());
-	allExecContents.insert(allExecContents.end(), logs.begin(), logs.end());
-	allExecContents.insert(allExecContents.end(), sends.begin(), sends.end());
-	allExecContents.insert(allExecContents.end(), assigns.begin(), assigns.end());
-	allExecContents.insert(allExecContents.end(), scripts.begin(), scripts.end());
-	allExecContents.insert(allExecContents.end(), cancels.begin(), cancels.end());
+	std::unordered_set<const DOMElement*> allExecContents;
+	allExecContents.insert(raises.begin(), raises.end());
+	allExecContents.insert(ifs.begin(), ifs.end());
+	allExecContents.insert(elseIfs.begin(), elseIfs.end());
+	allExecContents.insert(elses.begin(), elses.end());
+	allExecContents.insert(foreachs.begin(), foreachs.end());
+	allExecContents.insert(logs.begin(), logs.end());
+	allExecContents.insert(sends.begin(), sends.end());
+	allExecContents.insert(assigns.begin(), assigns.end());
+	allExecContents.insert(scripts.begin(), scripts.end());
+	allExecContents.insert(cancels.begin(), cancels.end());
 
 	std::list<DOMElement*> allElements;
 	allElements.insert(allElements.end(), scxmls.begin(), scxmls.end());
 	allElements.insert(allElements.end(), allStates.begin(), allStates.end());
-	allElements.insert(allElements.end(), allExecContents.begin(), allExecContents.end());
+	allElements.insert(allElements.end(), raises.begin(), raises.end());
+	allElements.insert(allElements.end(), ifs.begin(), ifs.end());
+	allElements.insert(allElements.end(), elseIfs.begin(), elseIfs.end());
+	allElements.insert(allElements.end(), elses.begin(), elses.end());
+	allElements.insert(allElements.end(), foreachs.begin(), foreachs.end());
+	allElements.insert(allElements.end(), logs.begin(), logs.end());
+	allElements.insert(allElements.end(), sends.begin(), sends.end());
+	allElements.insert(allElements.end(), assigns.begin(), assigns.end());
+	allElements.insert(allElements.end(), scripts.begin(), scripts.end());
+	allElements.insert(allElements.end(), cancels.begin(), cancels.end());
 	allElements.insert(allElements.end(), transitions.begin(), transitions.end());
 	allElements.insert(allElements.end(), initials.begin(), initials.end());
 	allElements.insert(allElements.end(), onEntries.begin(), onEntries.end());
@@ -331,21 +497,15 @@ std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* in
 		}
 	}
 
-
+	// state ids have to be known before any of the remaining checks
 	for (auto stateIter = allStates.begin(); stateIter != allStates.end(); stateIter++) {
 		DOMElement* state = static_cast<DOMElement*>(*stateIter);
 
-		if (DOMUtils::isMember(state, finals) && !HAS_ATTR(state, kXMLCharId)) // id is not required for finals
+		if (LOCALNAME(state) == "final" && !HAS_ATTR(state, kXMLCharId)) // id is not required for finals
 			continue;
 
-		std::string sInterpreter = "";
-		auto scxmlRoot = uscxml::getScxmlNode(state);
-		if (scxmlRoot) {
-			if (HAS_ATTR(scxmlRoot, kXMLCharName)) {
-				sInterpreter = "[" + ATTR(scxmlRoot, kXMLCharName) + "]: ";
-			}
-		}
-		
+		std::string sInterpreter = machinePrefix(index.getMachine(state));
+
 		// check for existance of id attribute - this not actually required!
 		if (!HAS_ATTR(state, kXMLCharId)) {
 			issues.push_back(InterpreterIssue(sInterpreter + "State has no 'id' attribute", state, InterpreterIssue::USCXML_ISSUE_FATAL));
@@ -359,128 +519,141 @@ std::list<InterpreterIssue> InterpreterIssue::forInterpreter(InterpreterImpl* in
 
 		std::string stateId = ATTR(state, kXMLCharId);
 
-		// check for valid transition with history states
-		if (LOCALNAME(state) == "history") {
-			std::list<DOMElement*> transitions = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "transition", state, false);
-			if (transitions.size() > 1) {
-				issues.push_back(InterpreterIssue(sInterpreter + "History pseudo-state with id '" + stateId + "' has multiple transitions", state, InterpreterIssue::USCXML_ISSUE_FATAL));
-			} else if (transitions.size() == 0) {
-				issues.push_back(InterpreterIssue(sInterpreter + "History pseudo-state with id '" + stateId + "' has no default transition", state, InterpreterIssue::USCXML_ISSUE_FATAL));
-			} else {
-				DOMElement* transition = static_cast<DOMElement*>(transitions.front());
-				if (HAS_ATTR(transition, kXMLCharCond)) {
-					issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' must not have a condition", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-				}
-				if (HAS_ATTR(transition, kXMLCharEvent)) {
-					issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' must not have an event attribute", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-				}
-				if (!HAS_ATTR(transition, kXMLCharTarget)) {
-					issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' has no target", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-				} else {
-					std::list<DOMElement*> targetStates = getTargetStates(transition, _scxml);
-					for (auto tIter = targetStates.begin(); tIter != targetStates.end(); tIter++) {
-						DOMElement* target = *tIter;
-						if (HAS_ATTR(state, kXMLCharType) && ATTR(state, kXMLCharType) == "deep") {
-							if (!DOMUtils::isDescendant(target, state->getParentNode())) {
-								issues.push_back(InterpreterIssue(sInterpreter + "Transition in deep history pseudo-state '" + stateId + "' has illegal target state '" + ATTR(target, kXMLCharId) + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-							}
-						} else {
-							if (target->getParentNode() != state->getParentNode()) {
-								issues.push_back(InterpreterIssue(sInterpreter + "Transition in shallow history pseudo-state '" + stateId + "' has illegal target state '" + ATTR(target, kXMLCharId) + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-							}
-						}
-					}
-				}
-			}
-		}
-
-		// check whether state is reachable
-		// 24.01.2020: bugfix: unreachable for invoked also
-		auto sameReachable = reachable.find(scxmlRoot);
-		if (sameReachable != reachable.end() && !DOMUtils::isMember(state, sameReachable->second)) {
-			issues.push_back(InterpreterIssue(sInterpreter + "State with id '" + stateId + "' is unreachable", state, InterpreterIssue::USCXML_ISSUE_WARNING));
-		}
-		
 		// check for uniqueness of id attribute
 		// 24.01.2020: bugfix: check that states are from the same machine
 		auto itState = seenStates.find(stateId);
-		if (itState != seenStates.end() && areFromSameMachine(itState->second, state)) {
+		if (itState != seenStates.end() && index.getMachine(itState->second) == index.getMachine(state)) {
 			issues.push_back(InterpreterIssue(sInterpreter + "Duplicate state with id '" + stateId + "'", state, InterpreterIssue::USCXML_ISSUE_FATAL));
 			continue;
 		}
-		seenStates[ATTR(state, kXMLCharId)] = state;		
+		seenStates[stateId] = state;
 	}
 
-	for (auto tIter = transitions.begin(); tIter != transitions.end(); tIter++) {
-		DOMElement* transition = *tIter;
-
-		std::string sInterpreter = "";
-		if (auto scxmlRoot = uscxml::getScxmlNode(transition)) {
-			if (HAS_ATTR(scxmlRoot, kXMLCharName)) {
-				sInterpreter = "[" + ATTR(scxmlRoot, kXMLCharName) + "]: ";
-			}
+	// check whether states are reachable and history transitions are valid
+	{
+		// 24.01.2020: bugfix: unreachable for invoked also
+		std::unordered_map<const DOMElement*, std::unordered_set<const DOMElement*> > reachable;
+		for (auto scxml : scxmls) {
+			reachable[scxml] = index.getReachableStates(scxml);
 		}
 
-		// check for valid target
-		if (HAS_ATTR(transition, kXMLCharTarget)) {
-			std::list<std::string> targetIds = tokenize(ATTR(transition, kXMLCharTarget));
-			if (targetIds.size() == 0) {
-				issues.push_back(InterpreterIssue(sInterpreter + "Transition has empty target state list", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-			}
+		for (auto stateIter = allStates.begin(); stateIter != allStates.end(); stateIter++) {
+			DOMElement* state = *stateIter;
 
-			for (std::list<std::string>::iterator targetIter = targetIds.begin(); targetIter != targetIds.end(); targetIter++) {
-				if (seenStates.find(*targetIter) == seenStates.end()) {
-					issues.push_back(InterpreterIssue(sInterpreter + "Transition has non-existant target state with id '" + *targetIter + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-					continue;
+			if (!HAS_ATTR(state, kXMLCharId) || ATTR(state, kXMLCharId).size() == 0)
+				continue; // reported above
+
+			const DOMElement* scxmlRoot = index.getMachine(state);
+			std::string sInterpreter = machinePrefix(scxmlRoot);
+			std::string stateId = ATTR(state, kXMLCharId);
+
+			// check for valid transition with history states
+			if (LOCALNAME(state) == "history") {
+				std::list<DOMElement*> transitions = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "transition", state, false);
+				if (transitions.size() > 1) {
+					issues.push_back(InterpreterIssue(sInterpreter + "History pseudo-state with id '" + stateId + "' has multiple transitions", state, InterpreterIssue::USCXML_ISSUE_FATAL));
+				} else if (transitions.size() == 0) {
+					issues.push_back(InterpreterIssue(sInterpreter + "History pseudo-state with id '" + stateId + "' has no default transition", state, InterpreterIssue::USCXML_ISSUE_FATAL));
+				} else {
+					DOMElement* transition = static_cast<DOMElement*>(transitions.front());
+					if (HAS_ATTR(transition, kXMLCharCond)) {
+						issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' must not have a condition", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+					}
+					if (HAS_ATTR(transition, kXMLCharEvent)) {
+						issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' must not have an event attribute", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+					}
+					if (!HAS_ATTR(transition, kXMLCharTarget)) {
+						issues.push_back(InterpreterIssue(sInterpreter + "Transition in history pseudo-state '" + stateId + "' has no target", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+					} else {
+						std::list<DOMElement*> targetStates = index.getTargetStates(transition, _scxml);
+						for (auto tIter = targetStates.begin(); tIter != targetStates.end(); tIter++) {
+							DOMElement* target = *tIter;
+							if (HAS_ATTR(state, kXMLCharType) && ATTR(state, kXMLCharType) == "deep") {
+								if (!index.isDescendant(target, state->getParentNode())) {
+									issues.push_back(InterpreterIssue(sInterpreter + "Transition in deep history pseudo-state '" + stateId + "' has illegal target state '" + ATTR(target, kXMLCharId) + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+								}
+							} else {
+								if (target->getParentNode() != state->getParentNode()) {
+									issues.push_back(InterpreterIssue(sInterpreter + "Transition in shallow history pseudo-state '" + stateId + "' has illegal target state '" + ATTR(target, kXMLCharId) + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+								}
+							}
+						}
+					}
 				}
 			}
+
+			auto sameReachable = reachable.find(scxmlRoot);
+			if (sameReachable != reachable.end() && sameReachable->second.find(state) == sameReachable->second.end()) {
+				issues.push_back(InterpreterIssue(sInterpreter + "State with id '" + stateId + "' is unreachable", state, InterpreterIssue::USCXML_ISSUE_WARNING));
+			}
 		}
 	}
 
-	// check for redundancy of transition
-	for (auto stateIter = allStates.begin(); stateIter != allStates.end(); stateIter++) {
-		DOMElement* state = *stateIter;
-		std::list<DOMElement*> transitions = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "transition", state, false);
-
+	// check targets of transitions and initial states
+	{
 		for (auto tIter = transitions.begin(); tIter != transitions.end(); tIter++) {
 			DOMElement* transition = *tIter;
-			for (auto t2Iter = transitions.begin(); t2Iter != tIter; t2Iter++) {
-				DOMElement* earlierTransition = *t2Iter;
-
-				// will the earlier transition always be enabled when the later is?
-				if (!HAS_ATTR(earlierTransition, kXMLCharCond)) {
-					// earlier transition has no condition -> check event descriptor
-					if (!HAS_ATTR(earlierTransition, kXMLCharEvent)) {
-						// earlier transition is eventless
-						issues.push_back(InterpreterIssue("Transition can never be optimally enabled", transition, InterpreterIssue::USCXML_ISSUE_INFO));
-						goto NEXT_TRANSITION;
-
-					} else if (HAS_ATTR(transition, kXMLCharEvent)) {
-						// does the earlier transition match all our events?
-						std::list<std::string> events = tokenize(ATTR(transition, kXMLCharEvent));
-
-						bool allMatched = true;
-						for (std::list<std::string>::iterator eventIter = events.begin(); eventIter != events.end(); eventIter++) {
-							if (!nameMatch(ATTR(earlierTransition, kXMLCharEvent), *eventIter)) {
-								allMatched = false;
-								break;
-							}
-						}
+			std::string sInterpreter = machinePrefix(index.getMachine(transition));
+
+			// check for valid target
+			if (HAS_ATTR(transition, kXMLCharTarget)) {
+				std::list<std::string> targetIds = tokenize(ATTR(transition, kXMLCharTarget));
+				if (targetIds.size() == 0) {
+					issues.push_back(InterpreterIssue(sInterpreter + "Transition has empty target state list", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+				}
+
+				for (std::list<std::string>::iterator targetIter = targetIds.begin(); targetIter != targetIds.end(); targetIter++) {
+					if (seenStates.find(*targetIter) == seenStates.end()) {
+						issues.push_back(InterpreterIssue(sInterpreter + "Transition has non-existant target state with id '" + *targetIter + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+						continue;
+					}
+				}
+			}
+		}
+
+		// check for redundancy of transition
+		for (auto stateIter = allStates.begin(); stateIter != allStates.end(); stateIter++) {
+			DOMElement* state = *stateIter;
+			std::list<DOMElement*> transitions = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "transition", state, false);
+
+			for (auto tIter = transitions.begin(); tIter != transitions.end(); tIter++) {
+				DOMElement* transition = *tIter;
+				for (auto t2Iter = transitions.begin(); t2Iter != tIter; t2Iter++) {
+					DOMElement* earlierTransition = *t2Iter;
 
-						if (allMatched) {
+					// will the earlier transition always be enabled when the later is?
+					if (!HAS_ATTR(earlierTransition, kXMLCharCond)) {
+						// earlier transition has no condition -> check event descriptor
+						if (!HAS_ATTR(earlierTransition, kXMLCharEvent)) {
+							// earlier transition is eventless
 							issues.push_back(InterpreterIssue("Transition can never be optimally enabled", transition, InterpreterIssue::USCXML_ISSUE_INFO));
 							goto NEXT_TRANSITION;
+
+						} else if (HAS_ATTR(transition, kXMLCharEvent)) {
+							// does the earlier transition match all our events?
+							std::list<std::string> events = tokenize(ATTR(transition, kXMLCharEvent));
+
+							bool allMatched = true;
+							for (std::list<std::string>::iterator eventIter = events.begin(); eventIter != events.end(); eventIter++) {
+								if (!nameMatch(ATTR(earlierTransition, kXMLCharEvent), *eventIter)) {
+									allMatched = false;
+									break;
+								}
+							}
+
+							if (allMatched) {
+								issues.push_back(InterpreterIssue("Transition can never be optimally enabled", transition, InterpreterIssue::USCXML_ISSUE_INFO));
+								goto NEXT_TRANSITION;
+							}
 						}
 					}
 				}
-			}
 NEXT_TRANSITION:
-			;
+				;
+			}
 		}
-	}
 
-	// check for useless history elements
-	{
+		// check for useless history elements
 		for (auto histIter = histories.begin(); histIter != histories.end(); histIter++) {
 			DOMElement* history = *histIter;
 
@@ -492,155 +665,134 @@ NEXT_TRANSITION:
 				issues.push_back(InterpreterIssue("Useless history '" + ATTR(history, kXMLCharId) + "' in atomic state", history, InterpreterIssue::USCXML_ISSUE_INFO));
 				continue;
 			}
-			std::list<std::set<const DOMElement* > > configs = getAllConfigurations(parent);
-			if (configs.size() <= 1) {
+			if (countConfigurations(parent, 2) <= 1) {
 				issues.push_back(InterpreterIssue("Useless history '" + ATTR(history, kXMLCharId) + "' in state with single legal configuration", history, InterpreterIssue::USCXML_ISSUE_INFO));
 				continue;
 			}
 		}
-	}
 
-	// check for valid initial attribute
-	{
-		std::list<DOMElement*> withInitialAttr;
-		withInitialAttr.insert(withInitialAttr.end(), allStates.begin(), allStates.end());
-		withInitialAttr.push_back(_scxml);
+		// check for valid initial attribute
+		{
+			std::list<DOMElement*> withInitialAttr;
+			withInitialAttr.insert(withInitialAttr.end(), allStates.begin(), allStates.end());
+			withInitialAttr.push_back(_scxml);
 
-		for (auto stateIter = withInitialAttr.begin(); stateIter != withInitialAttr.end(); stateIter++) {
-			DOMElement* state = *stateIter;
+			for (auto stateIter = withInitialAttr.begin(); stateIter != withInitialAttr.end(); stateIter++) {
+				DOMElement* state = *stateIter;
 
-			if (HAS_ATTR(state, kXMLCharInitial)) {
-				std::list<DOMElement*> childs;
-				std::list<DOMElement*> tmp;
-				tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "state", state, true);
-				childs.insert(childs.end(), tmp.begin(), tmp.end());
-				tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "parallel", state, true);
-				childs.insert(childs.end(), tmp.begin(), tmp.end());
-				tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "final", state, true);
-				childs.insert(childs.end(), tmp.begin(), tmp.end());
-				tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "history", state, true);
-				childs.insert(childs.end(), tmp.begin(), tmp.end());
-
-				std::list<std::string> intials = tokenize(ATTR(state, kXMLCharInitial));
-				for (std::list<std::string>::iterator initIter = intials.begin(); initIter != intials.end(); initIter++) {
-					if (seenStates.find(*initIter) == seenStates.end()) {
-						issues.push_back(InterpreterIssue("Initial attribute has invalid target state with id '" + *initIter + "'", state, InterpreterIssue::USCXML_ISSUE_FATAL));
-						continue;
-					}
-					// value of the 'initial' attribute [..] must be descendants of the containing <state> or <parallel> element
-					if (!DOMUtils::isMember(seenStates[*initIter], childs)) {
-						issues.push_back(InterpreterIssue("Initial attribute references non-child state '" + *initIter + "'", state, InterpreterIssue::USCXML_ISSUE_FATAL));
+				if (HAS_ATTR(state, kXMLCharInitial)) {
+					std::list<std::string> intials = tokenize(ATTR(state, kXMLCharInitial));
+					for (std::list<std::string>::iterator initIter = intials.begin(); initIter != intials.end(); initIter++) {
+						auto initState = seenStates.find(*initIter);
+						if (initState == seenStates.end()) {
+							issues.push_back(InterpreterIssue("Initial attribute has invalid target state with id '" + *initIter + "'", state, InterpreterIssue::USCXML_ISSUE_FATAL));
+							continue;
+						}
+						// value of the 'initial' attribute [..] must be descendants of the containing <state> or <parallel> element
+						if (!index.isDescendant(initState->second, state)) {
+							issues.push_back(InterpreterIssue("Initial attribute references non-child state '" + *initIter + "'", state, InterpreterIssue::USCXML_ISSUE_FATAL));
+						}
 					}
 				}
 			}
 		}
-	}
 
-	// check for legal configuration of target sets
-	{
-		std::map<DOMElement*, std::string > targetIdSets;
-		for (auto iter = transitions.begin(); iter != transitions.end(); iter++) {
-			DOMElement* transition = *iter;
+		// check for legal configuration of target sets
+		{
+			std::map<DOMElement*, std::string > targetIdSets;
+			for (auto iter = transitions.begin(); iter != transitions.end(); iter++) {
+				DOMElement* transition = *iter;
 
-			if (HAS_ATTR(transition, kXMLCharTarget)) {
-				targetIdSets[transition] = ATTR(transition, kXMLCharTarget);
+				if (HAS_ATTR(transition, kXMLCharTarget)) {
+					targetIdSets[transition] = ATTR(transition, kXMLCharTarget);
+				}
 			}
-		}
 
-		for (auto iter = initials.begin(); iter != initials.end(); iter++) {
-			DOMElement* initial = *iter;
+			for (auto iter = initials.begin(); iter != initials.end(); iter++) {
+				DOMElement* initial = *iter;
 
-			if (HAS_ATTR(initial, kXMLCharTarget)) {
-				targetIdSets[initial] = ATTR(initial, kXMLCharTarget);
+				if (HAS_ATTR(initial, kXMLCharTarget)) {
+					targetIdSets[initial] = ATTR(initial, kXMLCharTarget);
+				}
 			}
-		}
 
-		for (auto iter = allStates.begin(); iter != allStates.end(); iter++) {
-			DOMElement* state = *iter;
+			for (auto iter = allStates.begin(); iter != allStates.end(); iter++) {
+				DOMElement* state = *iter;
 
-			if (HAS_ATTR(state, kXMLCharInitial)) {
-				targetIdSets[state] = ATTR(state, kXMLCharInitial);
+				if (HAS_ATTR(state, kXMLCharInitial)) {
+					targetIdSets[state] = ATTR(state, kXMLCharInitial);
+				}
 			}
-		}
 
-		for (auto setIter = targetIdSets.begin();
-		        setIter != targetIdSets.end();
-		        setIter++) {
-			std::list<DOMElement*> targets;
-			std::list<std::string> targetIds = tokenize(setIter->second);
-			for (auto tgtIter = targetIds.begin(); tgtIter != targetIds.end(); tgtIter++) {
-				if (seenStates.find(*tgtIter) == seenStates.end())
-					goto NEXT_SET;
-				targets.push_back(seenStates[*tgtIter]);
-			}
-			if (!hasLegalCompletion(targets)) {
-				issues.push_back(InterpreterIssue("Target states cause illegal configuration", setIter->first, InterpreterIssue::USCXML_ISSUE_FATAL));
-			}
+			for (auto setIter = targetIdSets.begin();
+			        setIter != targetIdSets.end();
+			        setIter++) {
+				std::list<DOMElement*> targets;
+				std::list<std::string> targetIds = tokenize(setIter->second);
+				for (auto tgtIter = targetIds.begin(); tgtIter != targetIds.end(); tgtIter++) {
+					auto target = seenStates.find(*tgtIter);
+					if (target == seenStates.end())
+						goto NEXT_SET;
+					targets.push_back(target->second);
+				}
+				if (!hasLegalCompletion(index, targets)) {
+					issues.push_back(InterpreterIssue("Target states cause illegal configuration", setIter->first, InterpreterIssue::USCXML_ISSUE_FATAL));
+				}
 NEXT_SET:
-			;
+				;
+			}
 		}
-	}
 
-	// check for valid initial transition
-	{
-		std::list<DOMElement*> initTrans;
+		// check for valid initial transition
+		{
+			std::list<DOMElement*> initTrans;
 
-		for (auto iter = initials.begin(); iter != initials.end(); iter++) {
-			DOMElement* initial = *iter;
+			for (auto iter = initials.begin(); iter != initials.end(); iter++) {
+				DOMElement* initial = *iter;
+
+				std::list<DOMElement*> initTransitions = DOMUtils::filterChildElements(XML_PREFIX(initial).str() + "transition", initial, true);
+				if (initTransitions.size() != 1) {
+					issues.push_back(InterpreterIssue("Initial element must define exactly one transition", initial, InterpreterIssue::USCXML_ISSUE_FATAL));
+				}
+				initTrans.insert(initTrans.end(), initTransitions.begin(), initTransitions.end());
 
-			std::list<DOMElement*> initTransitions = DOMUtils::filterChildElements(XML_PREFIX(initial).str() + "transition", initial, true);
-			if (initTransitions.size() != 1) {
-				issues.push_back(InterpreterIssue("Initial element must define exactly one transition", initial, InterpreterIssue::USCXML_ISSUE_FATAL));
 			}
-			initTrans.insert(initTrans.end(), initTransitions.begin(), initTransitions.end());
 
-		}
+			for (auto iter = initTrans.begin(); iter != initTrans.end(); iter++) {
+				DOMElement* transition = *iter;
+
+				/* In a conformant SCXML document, this transition must not contain 'cond' or 'event' attributes, and must specify a non-null 'target'
+				 * whose value is a valid state specification consisting solely of descendants of the containing state
+				 */
+
+				if (HAS_ATTR(transition, kXMLCharCond)) {
+					issues.push_back(InterpreterIssue("Initial transition cannot have a condition", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+				}
+				if (HAS_ATTR(transition, kXMLCharEvent)) {
+					issues.push_back(InterpreterIssue("Initial transition cannot be eventful", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+				}
 
-		for (auto iter = initTrans.begin(); iter != initTrans.end(); iter++) {
-			DOMElement* transition = *iter;
-
-			/* In a conformant SCXML document, this transition must not contain 'cond' or 'event' attributes, and must specify a non-null 'target'
-			 * whose value is a valid state specification consisting solely of descendants of the containing state
-			 */
-
-			if (HAS_ATTR(transition, kXMLCharCond)) {
-				issues.push_back(InterpreterIssue("Initial transition cannot have a condition", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-			}
-			if (HAS_ATTR(transition, kXMLCharEvent)) {
-				issues.push_back(InterpreterIssue("Initial transition cannot be eventful", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
-			}
-
-			if (!transition->getParentNode() ||
-			        !transition->getParentNode()->getParentNode() ||
-			        transition->getParentNode()->getParentNode()->getNodeType() != DOMNode::ELEMENT_NODE)
-				continue; // syntax will catch this one
-			DOMElement* state = static_cast<DOMElement*>(transition->getParentNode()->getParentNode());
-			if (!isState(state))
-				continue; // syntax will catch this one
-
-			std::list<DOMElement*> childs;
-			std::list<DOMElement*> tmp;
-			tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "state", state, true);
-			childs.insert(childs.end(), tmp.begin(), tmp.end());
-			tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "parallel", state, true);
-			childs.insert(childs.end(), tmp.begin(), tmp.end());
-			tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "final", state, true);
-			childs.insert(childs.end(), tmp.begin(), tmp.end());
-			tmp = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "history", state, true);
-			childs.insert(childs.end(), tmp.begin(), tmp.end());
-
-			std::list<std::string> intials = tokenize(ATTR(transition, kXMLCharTarget));
-			for (std::list<std::string>::iterator initIter = intials.begin(); initIter != intials.end(); initIter++) {
-				// the 'target' of a <transition> inside an <initial> or <history> element: all the states must be descendants of the containing <state> or <parallel> element
-				if (!DOMUtils::isMember(seenStates[*initIter], childs)) {
-					issues.push_back(InterpreterIssue("Target of initial transition references non-child state '" + *initIter + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+				if (!transition->getParentNode() ||
+				        !transition->getParentNode()->getParentNode() ||
+				        transition->getParentNode()->getParentNode()->getNodeType() != DOMNode::ELEMENT_NODE)
+					continue; // syntax will catch this one
+				DOMElement* state = static_cast<DOMElement*>(transition->getParentNode()->getParentNode());
+				if (!isState(state))
+					continue; // syntax will catch this one
+
+				std::list<std::string> intials = tokenize(ATTR(transition, kXMLCharTarget));
+				for (std::list<std::string>::iterator initIter = intials.begin(); initIter != intials.end(); initIter++) {
+					// the 'target' of a <transition> inside an <initial> or <history> element: all the states must be descendants of the containing <state> or <parallel> element
+					auto initState = seenStates.find(*initIter);
+					if (initState == seenStates.end() || !index.isDescendant(initState->second, state)) {
+						issues.push_back(InterpreterIssue("Target of initial transition references non-child state '" + *initIter + "'", transition, InterpreterIssue::USCXML_ISSUE_FATAL));
+					}
 				}
 			}
 		}
 	}
 
-
-	// check that all invokers exists
+	// check that all invokers, io processors and custom executable content is known
 	{
 		for (auto iter = invokes.begin(); iter != invokes.end(); iter++) {
 			DOMElement* invoke = *iter;
@@ -661,10 +813,7 @@ NEXT_SET:
 				continue;
 			}
 		}
-	}
 
-	// check that all io processors exists
-	{
 		for (auto iter = sends.begin(); iter != sends.end(); iter++) {
 			DOMElement* send = *iter;
 			if (HAS_ATTR(send, kXMLCharType) && !_factory->hasIOProcessor(ATTR(send, kXMLCharType))) {
@@ -675,10 +824,7 @@ NEXT_SET:
 				continue;
 			}
 		}
-	}
 
-	// check that all custom executable content is known
-	{
 		std::list<DOMElement*> allExecContentContainers;
 		allExecContentContainers.insert(allExecContentContainers.end(), onEntries.begin(), onEntries.end());
 		allExecContentContainers.insert(allExecContentContainers.end(), onExits.begin(), onExits.end());
@@ -687,11 +833,9 @@ NEXT_SET:
 
 		for (auto bIter = allExecContentContainers.begin(); bIter != allExecContentContainers.end(); bIter++) {
 			DOMElement* block = *bIter;
-			std::list<DOMNode*> execContents = DOMUtils::filterChildType(DOMNode::ELEMENT_NODE, block);
-			for (auto ecIter = execContents.begin(); ecIter != execContents.end(); ecIter++) {
-				DOMElement* execContent = static_cast<DOMElement*>(*ecIter);
+			for (auto execContent = block->getFirstElementChild(); execContent; execContent = execContent->getNextElementSibling()) {
 				// SCXML specific executable content, always available
-				if (DOMUtils::isMember(execContent, allExecContents)) {
+				if (allExecContents.find(execContent) != allExecContents.end()) {
 					continue;
 				}
 
@@ -703,15 +847,16 @@ NEXT_SET:
 		}
 	}
 
-	// check that all SCXML elements have valid parents and required attributes
+	// check that all SCXML elements have valid parents, required attributes and attribute constraints
 	{
 		for (auto iter = allElements.begin(); iter != allElements.end(); iter++) {
 			DOMElement* element = *iter;
 			std::string localName = LOCALNAME(element);
 
-			if (reqAttr.find(localName) != reqAttr.end()) {
-				for (std::set<std::string>::const_iterator reqIter = reqAttr[localName].begin();
-				        reqIter != reqAttr[localName].end(); reqIter++) {
+			auto reqIters = reqAttr.find(localName);
+			if (reqIters != reqAttr.end()) {
+				for (std::set<std::string>::const_iterator reqIter = reqIters->second.begin();
+				        reqIter != reqIters->second.end(); reqIter++) {
 					if (!HAS_ATTR(element, X(*reqIter))) {
 						issues.push_back(InterpreterIssue("Element " + localName + " is missing required attribute '" + *reqIter + "'", element, InterpreterIssue::USCXML_ISSUE_WARNING));
 					}
@@ -732,15 +877,13 @@ NEXT_SET:
 			DOMElement* parent = static_cast<DOMElement*>(element->getParentNode());
 			std::string parentName = LOCALNAME(parent);
 
-			if (validParents[localName].find(parentName) == validParents[localName].end()) {
+			auto parentNames = validParents.find(localName);
+			if (parentNames == validParents.end() || parentNames->second.find(parentName) == parentNames->second.end()) {
 				issues.push_back(InterpreterIssue("Element " + localName + " can be no child of " + parentName, element, InterpreterIssue::USCXML_ISSUE_WARNING));
 				continue;
 			}
 		}
-	}
 
-	// check attribute constraints
-	{
 		for (auto iter = initials.begin(); iter != initials.end(); iter++) {
 			DOMElement* initial = *iter;
 			if (initial->getParentNode() && initial->getParentNode()->getNodeType() == DOMNode::ELEMENT_NODE) {
@@ -858,17 +1001,22 @@ NEXT_SET:
 	}
 
 	// check that the datamodel is known if not already instantiated
+	bool knownDataModel = true;
 	if (!interpreter->_dataModel) {
 		if (HAS_ATTR(_scxml, kXMLCharDataModel)) {
 			if (!_factory->hasDataModel(ATTR(_scxml, kXMLCharDataModel))) {
-				issues.push_back(InterpreterIssue("SCXML document requires unknown datamodel '" + ATTR(_scxml, kXMLCharDataModel) + "'", _scxml, InterpreterIssue::USCXML_ISSUE_FATAL));
-
-				// we cannot even check the rest as we require a datamodel
-				return issues;
+				knownDataModel = false;
 			}
 		}
 	}
 
+	if (!knownDataModel) {
+		issues.push_back(InterpreterIssue("SCXML document requires unknown datamodel '" + ATTR(_scxml, kXMLCharDataModel) + "'", _scxml, InterpreterIssue::USCXML_ISSUE_FATAL));
+
+		// we cannot even check the rest as we require a datamodel
+		return issues;
+	}
+
 	bool instantiatedDataModel = false;
 	// instantiate datamodel if not explicitly set
 	if (!_dataModel) {
@@ -881,7 +1029,6 @@ NEXT_SET:
 		}
 	}
 
-
 	// test all scripts for valid syntax
 	{
 		for (auto iter = scripts.begin(); iter != scripts.end(); iter++) {
@@ -931,16 +1078,9 @@ NEXT_SET:
 		for (auto iter = withExprAttrs.begin(); iter != withExprAttrs.end(); iter++) {
 			DOMElement* withExprAttr = *iter;
 			if (HAS_ATTR(withExprAttr, kXMLCharExpr)) {
-				if (DOMUtils::isMember(withExprAttr, datas) || DOMUtils::isMember(withExprAttr, assigns)) {
-					if (!_dataModel.isValidExprSyntax(ATTR(withExprAttr, kXMLCharExpr))) { // Corrected
-						issues.push_back(InterpreterIssue("Syntax error in expr attribute", withExprAttr, InterpreterIssue::USCXML_ISSUE_WARNING));
-						continue;
-					}
-				} else {
-					if (!_dataModel.isValidExprSyntax(ATTR(withExprAttr, kXMLCharExpr))) {
-						issues.push_back(InterpreterIssue("Syntax error in expr attribute", withExprAttr, InterpreterIssue::USCXML_ISSUE_WARNING));
-						continue;
-					}
+				if (!_dataModel.isValidExprSyntax(ATTR(withExprAttr, kXMLCharExpr))) {
+					issues.push_back(InterpreterIssue("Syntax error in expr attribute", withExprAttr, InterpreterIssue::USCXML_ISSUE_WARNING));
+					continue;
 				}
 			}
 		}
@@ -0,0 +1,394 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "AsyncLogger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace uscxml {
+
+/**
+ * Single producer, single consumer ring of formatted records. The owning
+ * thread pushes, the writer thread pops.
+ */
+class AsyncLoggerRing {
+public:
+	AsyncLoggerRing(size_t size) : _head(0), _tail(0) {
+		size_t capacity = 2;
+		while (capacity < size)
+			capacity <<= 1;
+		_slots.resize(capacity);
+		_mask = capacity - 1;
+	}
+
+	bool push(std::string& record) {
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) > _mask)
+			return false;
+		_slots[head & _mask].swap(record);
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(std::string& record) {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail == _head.load(std::memory_order_acquire))
+			return false;
+		record.swap(_slots[tail & _mask]);
+		_slots[tail & _mask].clear();
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() {
+		return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() {
+		return _mask + 1;
+	}
+
+protected:
+	std::vector<std::string> _slots;
+	size_t _mask;
+	std::atomic<size_t> _head;
+	std::atomic<size_t> _tail;
+};
+
+class AsyncLogger::Backend {
+public:
+	Backend(const AsyncLogger::Config& config) : _config(config), _alive(new bool(true)), _blocked(0), _isRunning(true), _dropped(0), _reportedDropped(0), _flushRequested(0), _flushDone(0), _fileSize(0) {
+		static std::atomic<uint64_t> nextId(0);
+		_id = nextId++;
+
+		if (_config.target != STDOUT)
+			openFile();
+		_thread = std::thread(&Backend::run, this);
+	}
+
+	~Backend() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_isRunning = false;
+		}
+		_cond.notify_all();
+		_spaceCond.notify_all();
+		if (_thread.joinable())
+			_thread.join();
+		if (_file.is_open())
+			_file.close();
+	}
+
+	void enqueue(std::string& record) {
+		std::shared_ptr<AsyncLoggerRing> ring = ringForThread();
+		if (ring->push(record)) {
+			// only wake the writer when it is falling behind, it polls otherwise
+			if (ring->size() == ring->capacity() / 2)
+				_cond.notify_one();
+			return;
+		}
+
+		if (_config.overflow == DROP || !_isRunning) {
+			_dropped++;
+			return;
+		}
+
+		// wait for the writer to make room, it wakes us once it drained the rings
+		std::unique_lock<std::mutex> lock(_mutex);
+		_blocked++;
+		_cond.notify_one();
+		while (!ring->push(record)) {
+			if (!_isRunning) {
+				_dropped++;
+				break;
+			}
+			_spaceCond.wait(lock);
+		}
+		_blocked--;
+	}
+
+	void flush() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		uint64_t request = ++_flushRequested;
+		_cond.notify_all();
+		while (_flushDone < request && _isRunning)
+			_cond.wait(lock);
+	}
+
+	size_t getDropped() {
+		return _dropped;
+	}
+
+protected:
+	struct ThreadRing {
+		std::weak_ptr<bool> alive; ///< expires with the backend
+		std::shared_ptr<AsyncLoggerRing> ring;
+	};
+
+	std::shared_ptr<AsyncLoggerRing> ringForThread() {
+		// keyed by backend id, addresses of destroyed backends may be reused
+		static thread_local std::map<uint64_t, ThreadRing> rings;
+
+		std::map<uint64_t, ThreadRing>::iterator ringIter = rings.find(_id);
+		if (ringIter != rings.end())
+			return ringIter->second.ring;
+
+		// only other threads can clear these, so drop the rings of destroyed backends when we add one
+		ringIter = rings.begin();
+		while (ringIter != rings.end()) {
+			if (ringIter->second.alive.expired()) {
+				ringIter = rings.erase(ringIter);
+			} else {
+				ringIter++;
+			}
+		}
+
+		ThreadRing threadRing;
+		threadRing.alive = _alive;
+		threadRing.ring = std::shared_ptr<AsyncLoggerRing>(new AsyncLoggerRing(_config.ringSize));
+		{
+			std::lock_guard<std::mutex> lock(_ringMutex);
+			_rings.push_back(threadRing.ring);
+		}
+		rings[_id] = threadRing;
+		return threadRing.ring;
+	}
+
+	void run() {
+		std::string record;
+		std::string batch;
+
+		while (true) {
+			uint64_t flushRequest;
+			bool isRunning;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				if (_isRunning && _flushRequested == _flushDone && _blocked == 0)
+					_cond.wait_for(lock, std::chrono::milliseconds(_config.flushInterval));
+				flushRequest = _flushRequested;
+				isRunning = _isRunning;
+			}
+
+			std::list<std::shared_ptr<AsyncLoggerRing> > rings;
+			{
+				std::lock_guard<std::mutex> lock(_ringMutex);
+				// rings only referenced by us belong to exited threads
+				std::list<std::shared_ptr<AsyncLoggerRing> >::iterator ringIter = _rings.begin();
+				while (ringIter != _rings.end()) {
+					if (ringIter->use_count() == 1 && (*ringIter)->size() == 0) {
+						ringIter = _rings.erase(ringIter);
+					} else {
+						rings.push_back(*ringIter);
+						ringIter++;
+					}
+				}
+			}
+
+			for (auto ring : rings) {
+				while (ring->pop(record)) {
+					batch += record;
+					if (batch.size() > 64 * 1024) {
+						write(batch);
+						batch.clear();
+					}
+				}
+			}
+
+			size_t dropped = _dropped;
+			if (dropped != _reportedDropped) {
+				std::stringstream ss;
+				ss << Logger::severityToPrefix(USCXML_WARN) << "Dropped " << (dropped - _reportedDropped) << " log records" << std::endl;
+				batch += ss.str();
+				_reportedDropped = dropped;
+			}
+
+			if (batch.size() > 0) {
+				write(batch);
+				batch.clear();
+			}
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_blocked > 0)
+					_spaceCond.notify_all();
+			}
+			if (_config.target == STDOUT) {
+				std::cout << std::flush;
+			} else if (_file.is_open()) {
+				_file.flush();
+			}
+
+			if (flushRequest > 0) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (flushRequest > _flushDone) {
+					_flushDone = flushRequest;
+					_cond.notify_all();
+				}
+			}
+
+			if (!isRunning)
+				break;
+		}
+
+		// wake anyone still waiting in flush()
+		std::lock_guard<std::mutex> lock(_mutex);
+		_flushDone = _flushRequested;
+		_cond.notify_all();
+	}
+
+	void write(const std::string& batch) {
+		if (_config.target == STDOUT) {
+			std::cout.write(batch.data(), batch.size());
+			return;
+		}
+
+		if (_config.target == ROTATING_FILE && _fileSize > 0 && _fileSize + batch.size() > _config.maxFileSize)
+			rotate();
+
+		if (!_file.is_open())
+			return;
+		_file.write(batch.data(), batch.size());
+		_fileSize += batch.size();
+	}
+
+	void openFile() {
+		_file.open(_config.path.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+		if (!_file.is_open()) {
+			std::cerr << Logger::severityToPrefix(USCXML_ERROR) << "Cannot open log file " << _config.path << std::endl;
+			return;
+		}
+		_file.seekp(0, std::ios::end);
+		std::streamoff pos = _file.tellp();
+		_fileSize = (pos > 0 ? (size_t)pos : 0);
+	}
+
+	void rotate() {
+		if (_file.is_open())
+			_file.close();
+
+		if (_config.maxFiles > 0) {
+			std::stringstream oldest;
+			oldest << _config.path << "." << _config.maxFiles;
+			remove(oldest.str().c_str());
+
+			for (size_t i = _config.maxFiles - 1; i > 0; i--) {
+				std::stringstream from;
+				std::stringstream to;
+				from << _config.path << "." << i;
+				to << _config.path << "." << (i + 1);
+				rename(from.str().c_str(), to.str().c_str());
+			}
+			std::string first = _config.path + ".1";
+			rename(_config.path.c_str(), first.c_str());
+		} else {
+			remove(_config.path.c_str());
+		}
+
+		openFile();
+	}
+
+	AsyncLogger::Config _config;
+	uint64_t _id;
+	std::shared_ptr<bool> _alive;
+
+	std::mutex _ringMutex;
+	std::list<std::shared_ptr<AsyncLoggerRing> > _rings;
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::condition_variable _spaceCond; ///< signalled for producers blocked on a full ring
+	size_t _blocked;
+	std::atomic<bool> _isRunning;
+
+	std::atomic<size_t> _dropped;
+	size_t _reportedDropped;
+	uint64_t _flushRequested;
+	uint64_t _flushDone;
+
+	std::ofstream _file;
+	size_t _fileSize;
+};
+
+AsyncLogger::AsyncLogger() : _backend(new Backend(Config())) {
+}
+
+AsyncLogger::AsyncLogger(const Config& config) : _backend(new Backend(config)) {
+}
+
+AsyncLogger::~AsyncLogger() {
+}
+
+std::shared_ptr<LoggerImpl> AsyncLogger::create() {
+	std::shared_ptr<LoggerImpl> logger(new AsyncLogger(_backend));
+	logger->setMinSeverity(_minSeverity);
+	return logger;
+}
+
+void AsyncLogger::log(LogSeverity severity, const std::string& message) {
+	if (!isEnabled(severity))
+		return;
+	enqueue(severity, message);
+}
+
+void AsyncLogger::log(LogSeverity severity, const Event& event) {
+	if (!isEnabled(severity))
+		return;
+	std::stringstream ss;
+	ss << event;
+	enqueue(severity, ss.str());
+}
+
+void AsyncLogger::log(LogSeverity severity, const Data& data) {
+	if (!isEnabled(severity))
+		return;
+	std::stringstream ss;
+	ss << data;
+	enqueue(severity, ss.str());
+}
+
+void AsyncLogger::enqueue(LogSeverity severity, const std::string& message) {
+	const char* prefix = Logger::severityToPrefix(severity);
+	std::string record;
+	record.reserve(strlen(prefix) + message.size());
+	record.append(prefix);
+	record.append(message);
+	_backend->enqueue(record);
+}
+
+void AsyncLogger::flush() {
+	_backend->flush();
+}
+
+size_t AsyncLogger::getDropped() {
+	return _backend->getDropped();
+}
+
+}
@@ -0,0 +1,93 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef ASYNCLOGGER_H_5E2C7B19
+#define ASYNCLOGGER_H_5E2C7B19
+
+#include "LoggingImpl.h"
+
+#include <string>
+#include <memory>
+
+namespace uscxml {
+
+/**
+ * A logger that formats records on the calling thread, hands them to a
+ * per-thread lock-free ring buffer and writes them from a background thread.
+ */
+class USCXML_API AsyncLogger : public LoggerImpl {
+public:
+	enum Target {
+		STDOUT,
+		FILE,
+		ROTATING_FILE
+	};
+
+	/// What to do when the ring buffer of a thread is full
+	enum Overflow {
+		DROP, ///< discard the record and report the number of dropped records later
+		BLOCK ///< wait for the writer thread to make room
+	};
+
+	struct Config {
+		Config() :
+			target(STDOUT),
+			maxFileSize(10 * 1024 * 1024),
+			maxFiles(5),
+			ringSize(4096),
+			overflow(DROP),
+			flushInterval(20) {}
+
+		Target target;
+		std::string path; ///< for FILE and ROTATING_FILE
+		size_t maxFileSize; ///< bytes before a ROTATING_FILE is rotated
+		size_t maxFiles; ///< rotated files to keep as path.1 ... path.n
+		size_t ringSize; ///< records per thread, rounded up to a power of two
+		Overflow overflow;
+		size_t flushInterval; ///< ms between writes when the rings are not filling up
+	};
+
+	AsyncLogger();
+	AsyncLogger(const Config& config);
+	virtual ~AsyncLogger();
+
+	/// Loggers for nested interpreters share the writer thread and target
+	virtual std::shared_ptr<LoggerImpl> create();
+
+	virtual void log(LogSeverity severity, const std::string& message);
+	virtual void log(LogSeverity severity, const Event& event);
+	virtual void log(LogSeverity severity, const Data& data);
+
+	/// Block until every record logged before the call was written
+	void flush();
+	/// Records discarded with the DROP policy so far
+	size_t getDropped();
+
+	class Backend;
+
+protected:
+	AsyncLogger(std::shared_ptr<Backend> backend) : _backend(backend) {}
+	void enqueue(LogSeverity severity, const std::string& message);
+
+	std::shared_ptr<Backend> _backend;
+};
+
+}
+
+#endif /* end of include guard: ASYNCLOGGER_H_5E2C7B19 */
@@ -50,6 +50,9 @@ public:
 	virtual void enqueue(const Event& event) {
 		return BasicEventQueue::enqueue(event);
 	}
+	virtual void enqueueBatch(const std::list<Event>& events) {
+		return BasicEventQueue::enqueueBatch(events);
+	}
 	virtual void reset();
 
 	virtual Data serialize();
@@ -85,6 +85,16 @@ void BasicEventQueue::enqueue(const Event& event) {
 	_cond.notify_all();
 }
 
+void BasicEventQueue::enqueueBatch(const std::list<Event>& events) {
+	if (events.empty())
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_queue.insert(_queue.end(), events.begin(), events.end());
+	}
+	_cond.notify_all();
+}
+
 void BasicEventQueue::reset() {
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	_queue.clear();
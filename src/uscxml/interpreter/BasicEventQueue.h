@@ -41,6 +41,7 @@ public:
 	virtual std::shared_ptr<EventQueueImpl> create();
 	virtual Event dequeue(size_t blockMs);
 	virtual void enqueue(const Event& event);
+	virtual void enqueueBatch(const std::list<Event>& events);
 	virtual void reset();
 	virtual Data serialize();
 	virtual void deserialize(const Data& data);
@@ -39,6 +39,10 @@ void EventQueue::enqueue(const Event& event) {
 	if (_impl)
 		_impl->enqueue(event);
 }
+void EventQueue::enqueueBatch(const std::list<Event>& events) {
+	if (_impl)
+		_impl->enqueueBatch(events);
+}
 void EventQueue::reset() {
 	if (_impl)
 		_impl->reset();
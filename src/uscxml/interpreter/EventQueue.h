@@ -38,6 +38,7 @@ public:
 
 	virtual Event dequeue(size_t blockMs);
 	virtual void enqueue(const Event& event);
+	virtual void enqueueBatch(const std::list<Event>& events);
 	virtual void reset();
 
 	Data serialize();
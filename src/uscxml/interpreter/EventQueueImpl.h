@@ -44,6 +44,12 @@ public:
 	virtual void reset() = 0;
 	virtual Data serialize() = 0;
 	virtual void deserialize(const Data& data) = 0;
+
+	/// Enqueue several events in order, implementations ought to wake up consumers only once
+	virtual void enqueueBatch(const std::list<Event>& events) {
+		for (auto& event : events)
+			enqueue(event);
+	}
 };
 
 /**
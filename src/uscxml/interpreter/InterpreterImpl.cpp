@@ -24,6 +24,8 @@
 #include "uscxml/interpreter/InterpreterImpl.h" // beware cyclic reference!
 #include "uscxml/interpreter/BasicEventQueue.h"
 #include "uscxml/interpreter/BasicDelayedEventQueue.h"
+#include "uscxml/interpreter/VirtualTimeEventQueue.h"
+#include "uscxml/interpreter/PriorityEventQueue.h"
 #include "uscxml/messages/Event.h"
 #include "uscxml/util/String.h"
 #include "uscxml/util/Predicates.h"
@@ -42,27 +44,33 @@
 #include "uscxml/interpreter/FastMicroStep.h"
 #include "uscxml/interpreter/BasicContentExecutor.h"
 
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
 #include <xercesc/dom/DOM.hpp>
+#include <xercesc/sax/HandlerBase.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
 
 #define VERBOSE 0
 
 namespace uscxml {
 
-std::map<std::string, std::weak_ptr<InterpreterImpl> > InterpreterImpl::_instances;
-std::recursive_mutex InterpreterImpl::_instanceMutex;
+SessionRegistry InterpreterImpl::_instances;
 
 std::map<std::string, std::weak_ptr<InterpreterImpl> > InterpreterImpl::getInstances() {
-	std::lock_guard<std::recursive_mutex> lock(_instanceMutex);
-	std::map<std::string, std::weak_ptr<InterpreterImpl> >::iterator instIter = _instances.begin();
-	while(instIter != _instances.end()) {
-		if (!instIter->second.lock()) {
-			_instances.erase(instIter++);
-		} else {
-			instIter++;
-		}
-	}
-	return _instances;
+	std::map<std::string, std::weak_ptr<InterpreterImpl> > instances;
+	_instances.forEach([&instances](const std::shared_ptr<InterpreterImpl>& instance) {
+		instances[instance->getSessionId()] = instance;
+		return true;
+	});
+	return instances;
+}
+
+std::shared_ptr<InterpreterImpl> InterpreterImpl::getInstance(const std::string& sessionId) {
+	return _instances.get(sessionId);
+}
+
+void InterpreterImpl::forEachInstance(std::function<bool(const std::shared_ptr<InterpreterImpl>&)> visitor) {
+	_instances.forEach(visitor);
 }
 
 std::string InterpreterImpl::getInvokedScxmlName(const std::string &invokeid) const {	
@@ -70,9 +78,7 @@ std::string InterpreterImpl::getInvokedScxmlName(const std::string &invokeid) co
 	if (itInv != _invokers.end()) {		
 		auto sessionID = itInv->second.internalID();
 
-		auto instances = getInstances();
-		auto instance = instances.find(sessionID);
-		if (auto session = instance->second.lock()) {
+		if (auto session = getInstance(sessionID)) {
 			return session->getName();
 		}
 	}
@@ -81,9 +87,49 @@ std::string InterpreterImpl::getInvokedScxmlName(const std::string &invokeid) co
 }
 
 void InterpreterImpl::addInstance(std::shared_ptr<InterpreterImpl> interpreterImpl) {
-	std::lock_guard<std::recursive_mutex> lock(_instanceMutex);
-	assert(_instances.find(interpreterImpl->getSessionId()) == _instances.end());
-	_instances[interpreterImpl->getSessionId()] = interpreterImpl;
+	bool added = _instances.add(interpreterImpl->getSessionId(), interpreterImpl);
+	assert(added);
+	(void)added;
+}
+
+static XERCESC_NS::DOMDocument* parseDocument(std::function<void(XERCESC_NS::XercesDOMParser*)> parse) {
+	std::unique_ptr<XERCESC_NS::XercesDOMParser> parser(new XERCESC_NS::XercesDOMParser());
+	std::unique_ptr<XERCESC_NS::ErrorHandler> errHandler(new XERCESC_NS::HandlerBase());
+
+	try {
+		parser->setValidationScheme(XERCESC_NS::XercesDOMParser::Val_Always);
+		parser->setDoNamespaces(true);
+
+		// we do not have a real schema anyway
+		parser->useScanner(XERCESC_NS::XMLUni::fgWFXMLScanner);
+		parser->setErrorHandler(errHandler.get());
+
+		parse(parser.get());
+		return parser->adoptDocument();
+
+	} catch (const XERCESC_NS::SAXParseException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	} catch (const XERCESC_NS::RuntimeException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	} catch (const XERCESC_NS::XMLException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	} catch (const XERCESC_NS::DOMException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	}
+	return NULL;
+}
+
+XERCESC_NS::DOMDocument* InterpreterImpl::parseXML(const std::string& xml) {
+	return parseDocument([&xml](XERCESC_NS::XercesDOMParser* parser) {
+		XERCESC_NS::MemBufInputSource is((XMLByte*)xml.c_str(), xml.size(), X("fake"));
+		parser->parse(is);
+	});
+}
+
+XERCESC_NS::DOMDocument* InterpreterImpl::parseURL(const std::string& url) {
+	return parseDocument([&url](XERCESC_NS::XercesDOMParser* parser) {
+		parser->parse(url.c_str());
+	});
 }
 
 InterpreterImpl::InterpreterImpl() : _isInitialized(false), _document(NULL), _scxml(NULL), _state(USCXML_INSTANTIATED) {
@@ -116,10 +162,7 @@ InterpreterImpl::~InterpreterImpl() {
 	if (_document)
 		delete _document;
 
-	{
-		std::lock_guard<std::recursive_mutex> lock(_instanceMutex);
-		_instances.erase(getSessionId());
-	}
+	_instances.remove(getSessionId());
 
 #ifdef WITH_CACHE_FILES
 	if (!envVarIsTrue("USCXML_NOCACHE_FILES") && _document != NULL) {
@@ -141,6 +184,12 @@ InterpreterState InterpreterImpl::step(size_t blockMs) {
 		_state = USCXML_INITIALIZED;
 	} else {
 		_state = _microStepper.step(blockMs);
+		if (_state == USCXML_FINISHED || _state == USCXML_CANCELLED) {
+			// a finished session must not hold back a simulated clock
+			auto virtualQueue = std::dynamic_pointer_cast<VirtualTimeEventQueue>(_externalQueue.getImplBase());
+			if (virtualQueue)
+				virtualQueue->detach();
+		}
 	}
 	return _state;
 }
@@ -414,6 +463,29 @@ void InterpreterImpl::init() {
 		_execContent = ContentExecutor(std::shared_ptr<ContentExecutorImpl>(new BasicContentExecutor(this,_factory)));
 	}
 
+	if (envVarIsTrue("USCXML_VIRTUAL_TIME")) {
+		// all sessions of the process share a simulated clock
+		if (!_externalQueue) {
+			_externalQueue = EventQueue(std::shared_ptr<EventQueueImpl>(new VirtualTimeEventQueue(VirtualClock::getInstance())));
+		}
+		if (!_delayQueue) {
+			_delayQueue = DelayedEventQueue(std::shared_ptr<DelayedEventQueueImpl>(new VirtualTimeDelayedEventQueue(this, VirtualClock::getInstance())));
+		}
+	}
+
+	const char* queueCapacity = getenv("USCXML_EVENTQUEUE_CAPACITY");
+	if (!_externalQueue && queueCapacity != NULL) {
+		// bounded external queue with control events ahead of all others
+		const char* queuePolicy = getenv("USCXML_EVENTQUEUE_POLICY");
+		std::shared_ptr<PriorityEventQueue> queue(new PriorityEventQueue(strTo<size_t>(queueCapacity),
+		        PriorityEventQueue::policyFromString(queuePolicy != NULL ? queuePolicy : "")));
+
+		const char* controlEvents = getenv("USCXML_EVENTQUEUE_CONTROL");
+		if (controlEvents != NULL)
+			queue->addEvents("control", tokenize(controlEvents));
+		_externalQueue = EventQueue(queue);
+	}
+
 	if (!_externalQueue) {
 		_externalQueue = EventQueue(std::shared_ptr<EventQueueImpl>(new BasicEventQueue()));
 	}
@@ -529,7 +601,7 @@ void InterpreterImpl::enqueue(const std::string& type, const std::string& target
 	_delayedEventTargets[sendEvent.uuid] = std::tuple<std::string, std::string, std::string>(sendEvent.sendid, type, target);
 	if (delayMs == 0) {
 		Event copy(sendEvent);
-		return eventReady(copy, sendEvent.uuid);
+		return dispatch(copy, sendEvent.uuid);
 	} else {
 		return _delayQueue.enqueueDelayed(sendEvent, delayMs, sendEvent.uuid);
 	}
@@ -551,6 +623,24 @@ void InterpreterImpl::cancelDelayed(const std::string& sendId) {
 }
 
 void InterpreterImpl::eventReady(Event& sendEvent, const std::string& eventUUID) {
+	try {
+		dispatch(sendEvent, eventUUID);
+	} catch (ErrorEvent e) {
+		/**
+		 * The send element is long done, e.g. the target's queue was full. We are
+		 * on the timer thread, the external queue is safe to use from here and
+		 * wakes an idle session.
+		 */
+		e.sendid = sendEvent.sendid;
+		try {
+			_externalQueue.enqueue(e);
+		} catch (ErrorEvent e) {
+			LOG(getLogger(), USCXML_ERROR) << "Cannot report failed delayed send " << sendEvent.sendid << std::endl << e << std::endl;
+		}
+	}
+}
+
+void InterpreterImpl::dispatch(Event& sendEvent, const std::string& eventUUID) {
 	std::lock_guard<std::recursive_mutex> lock(_delayMutex);
 
 	// we only arrive here after the delay already passed!
@@ -605,10 +695,19 @@ void InterpreterImpl::uninvoke(const std::string& invokeId) {
 }
 
 void InterpreterImpl::enqueueAtInvoker(const std::string& invokeId, const Event& event) {
-	if (_invokers.find(invokeId) != _invokers.end()) {
-		std::lock_guard<std::recursive_mutex> lock(_instanceMutex);
+	auto invokerIter = _invokers.find(invokeId);
+	if (invokerIter != _invokers.end()) {
+		// an invoked session is found via the registry and kept alive while we deliver
+		std::shared_ptr<InterpreterImpl> invokedSession;
+		std::string invokedSessionId = invokerIter->second.internalID();
+		if (invokedSessionId.size() > 0) {
+			invokedSession = getInstance(invokedSessionId);
+			if (!invokedSession)
+				ERROR_COMMUNICATION_THROW("Can not send to invoked component '" + invokeId + "', its session is gone");
+		}
+
 		try {
-			_invokers[invokeId].eventFromSCXML(event);
+			invokerIter->second.eventFromSCXML(event);
 		} catch (const std::exception &e) {
 			ERROR_COMMUNICATION_THROW("Exception caught while sending event to invoker '" + invokeId + "': " + e.what());
 		} catch(...) {
@@ -26,6 +26,7 @@
 #include <map>
 #include <string>
 #include <limits>
+#include <functional>
 
 #include "uscxml/Common.h"
 #include "uscxml/util/URL.h"
@@ -38,6 +39,7 @@
 #include "uscxml/interpreter/ContentExecutorImpl.h"
 #include "uscxml/interpreter/EventQueue.h"
 #include "uscxml/interpreter/EventQueueImpl.h"
+#include "uscxml/interpreter/SessionRegistry.h"
 //#include "uscxml/util/DOM.h"
 
 namespace uscxml {
@@ -169,6 +171,9 @@ public:
 	inline virtual void enqueueExternal(const Event& event) override {
 		return _externalQueue.enqueue(event);
 	}
+	inline virtual void enqueueExternalBatch(const std::list<Event>& events) override {
+		return _externalQueue.enqueueBatch(events);
+	}
 	inline virtual void enqueueExternalDelayed(const Event& event, size_t delayMs, const std::string& eventUUID) override {
 		return _delayQueue.enqueueDelayed(event, delayMs, eventUUID);
 	}
@@ -276,7 +281,16 @@ public:
 		return _logger;
 	}
 
+	/// A snapshot of all sessions, prefer getInstance() or forEachInstance()
 	static std::map<std::string, std::weak_ptr<InterpreterImpl> > getInstances();
+	/// The live session with the given id, a constant time lookup
+	static std::shared_ptr<InterpreterImpl> getInstance(const std::string& sessionId);
+	/// Visit all live sessions until the visitor returns false
+	static void forEachInstance(std::function<bool(const std::shared_ptr<InterpreterImpl>&)> visitor);
+
+	/// Parse a document the way Interpreter::fromXML and Interpreter::fromURL do, the caller owns it
+	static XERCESC_NS::DOMDocument* parseXML(const std::string& xml);
+	static XERCESC_NS::DOMDocument* parseURL(const std::string& url);
 
 	inline virtual XERCESC_NS::DOMDocument* getDocument() {
 		return _document;
@@ -302,9 +316,9 @@ protected:
 	std::map<std::string, std::tuple<std::string, std::string, std::string> > _delayedEventTargets;
 
 	virtual void init();
+	void dispatch(Event& sendEvent, const std::string& eventUUID);
 
-	static std::map<std::string, std::weak_ptr<InterpreterImpl> > _instances;
-	static std::recursive_mutex _instanceMutex;
+	static SessionRegistry _instances;
 	std::recursive_mutex _delayMutex;
 	std::recursive_mutex _serializationMutex;
 
@@ -22,14 +22,35 @@
 
 // for default logger
 #include "StdOutLogger.h"
+#include "AsyncLogger.h"
+
+#include "uscxml/util/Convenience.h" // envVarIsTrue
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib> // getenv
+#include <map>
 
 namespace uscxml {
 
 std::shared_ptr<LoggerImpl> LoggerImpl::_defaultLogger;
 
 std::shared_ptr<LoggerImpl> LoggerImpl::getDefault() {
-	if (!_defaultLogger)
-		_defaultLogger = std::shared_ptr<LoggerImpl>(new StdOutLogger());
+	if (!_defaultLogger) {
+		if (envVarIsTrue("USCXML_LOG_ASYNC")) {
+			_defaultLogger = std::shared_ptr<LoggerImpl>(new AsyncLogger());
+		} else {
+			_defaultLogger = std::shared_ptr<LoggerImpl>(new StdOutLogger());
+		}
+		const char* minLevel = getenv("USCXML_LOG_LEVEL");
+		if (minLevel != NULL) {
+			if (Logger::isSeverity(minLevel)) {
+				_defaultLogger->setMinSeverity(Logger::stringToSeverity(minLevel));
+			} else {
+				LOG(Logger(_defaultLogger), USCXML_WARN) << "Ignoring unknown USCXML_LOG_LEVEL '" << minLevel << "'" << std::endl;
+			}
+		}
+	}
 	return _defaultLogger;
 }
 
@@ -70,6 +91,15 @@ StreamLogger::~StreamLogger() {
 	}
 }
 
+LogScope*& LogScope::current() {
+	static thread_local LogScope* scope = NULL;
+	return scope;
+}
+
+bool Logger::isEnabled(LogSeverity severity) const {
+	return _impl && _impl->isEnabled(severity);
+}
+
 std::shared_ptr<LoggerImpl> Logger::getImpl() const {
 	return _impl;
 }
@@ -103,4 +133,62 @@ std::string Logger::severityToString(LogSeverity severity) {
 	}
 }
 
+const char* Logger::severityToPrefix(LogSeverity severity) {
+	// constant prefixes spare the per-message string concatenation
+	switch (severity) {
+	case USCXML_SCXML:
+		return "[Interpreter] ";
+	case USCXML_TRACE:
+		return "[Trace] ";
+	case USCXML_DEBUG:
+		return "[Debug] ";
+	case USCXML_INFO:
+		return "[Info] ";
+	case USCXML_WARN:
+		return "[Warning] ";
+	case USCXML_ERROR:
+		return "[Error] ";
+	case USCXML_FATAL:
+		return "[Fatal] ";
+	case USCXML_LOG:
+		return "[Log] ";
+	case USCXML_VERBATIM:
+		return "";
+	default:
+		return "[Unknown] ";
+	}
+}
+
+static const std::map<std::string, LogSeverity>& severityNames() {
+	static std::map<std::string, LogSeverity> names = {
+		{ "interpreter", USCXML_SCXML },
+		{ "scxml", USCXML_SCXML },
+		{ "trace", USCXML_TRACE },
+		{ "debug", USCXML_DEBUG },
+		{ "info", USCXML_INFO },
+		{ "log", USCXML_LOG },
+		{ "verbatim", USCXML_VERBATIM },
+		{ "warn", USCXML_WARN },
+		{ "warning", USCXML_WARN },
+		{ "error", USCXML_ERROR },
+		{ "fatal", USCXML_FATAL }
+	};
+	return names;
+}
+
+bool Logger::isSeverity(const std::string& severity) {
+	std::string level = severity;
+	std::transform(level.begin(), level.end(), level.begin(), ::tolower);
+	return severityNames().find(level) != severityNames().end();
+}
+
+LogSeverity Logger::stringToSeverity(const std::string& severity, LogSeverity fallback) {
+	std::string level = severity;
+	std::transform(level.begin(), level.end(), level.begin(), ::tolower);
+	auto name = severityNames().find(level);
+	if (name == severityNames().end())
+		return fallback;
+	return name->second;
+}
+
 }
@@ -26,10 +26,11 @@
 
 #include <memory>
 
-#define LOG(logger, lvl) logger.log(lvl)
-#define LOG2(logger, lvl, thing) logger.log(lvl, thing)
-#define LOGD(lvl) uscxml::Logger::getDefault().log(lvl)
-#define LOGD2(lvl, thing) uscxml::Logger::getDefault().log(lvl, thing);
+// operands streamed into a disabled severity are never evaluated
+#define LOG(logger, lvl) !uscxml::LogScope((logger), (lvl)) ? (void)0 : uscxml::LogVoidify() & uscxml::LogScope::stream()
+#define LOG2(logger, lvl, thing) !uscxml::LogScope((logger), (lvl)) ? (void)0 : uscxml::LogScope::log(thing)
+#define LOGD(lvl) LOG(uscxml::Logger::getDefault(), lvl)
+#define LOGD2(lvl, thing) LOG2(uscxml::Logger::getDefault(), lvl, thing);
 
 namespace uscxml {
 
@@ -64,6 +65,16 @@ protected:
 	std::stringstream ss;
 
 	friend class Logger;
+	friend class LogScope;
+};
+
+/**
+ * Turns a streamed log statement into void so the LOG macros can short-circuit it.
+ */
+class USCXML_API LogVoidify {
+public:
+	void operator&(std::ostream&) {}
+	void operator&(const StreamLogger&) {}
 };
 
 class USCXML_API Logger {
@@ -75,7 +86,13 @@ public:
 	virtual void log(LogSeverity severity, const std::string& message);
 
 	virtual StreamLogger log(LogSeverity severity);
+	bool isEnabled(LogSeverity severity) const;
+
 	static std::string severityToString(LogSeverity severity);
+	static const char* severityToPrefix(LogSeverity severity);
+	/// Parse a severity name case-insensitively, unknown names yield fallback
+	static LogSeverity stringToSeverity(const std::string& severity, LogSeverity fallback = USCXML_SCXML);
+	static bool isSeverity(const std::string& severity);
 
 	static Logger getDefault();
 
@@ -85,6 +102,53 @@ protected:
 
 };
 
+/**
+ * Binds the logger expression of the LOG macros until the end of the statement,
+ * it is evaluated once and the streamed operands only if the severity is enabled.
+ */
+class USCXML_API LogScope {
+public:
+	LogScope(Logger& logger, LogSeverity severity) {
+		enter(logger, severity);
+	}
+	LogScope(Logger&& logger, LogSeverity severity) {
+		enter(logger, severity);
+	}
+	~LogScope() {
+		if (_enabled)
+			current() = _previous;
+	}
+
+	bool operator!() const {
+		return !_enabled;
+	}
+
+	/// Stream for the innermost enabled scope of this thread
+	static StreamLogger stream() {
+		return current()->_logger->log(current()->_severity);
+	}
+	template <typename T> static void log(const T& thing) {
+		current()->_logger->log(current()->_severity, thing);
+	}
+
+protected:
+	void enter(Logger& logger, LogSeverity severity) {
+		_enabled = logger.isEnabled(severity);
+		if (!_enabled)
+			return;
+		_logger = &logger;
+		_severity = severity;
+		_previous = current();
+		current() = this;
+	}
+	static LogScope*& current();
+
+	Logger* _logger; ///< even a temporary logger lives until the end of the statement, as do we
+	LogSeverity _severity;
+	bool _enabled;
+	LogScope* _previous;
+};
+
 }
 
 #endif /* end of include guard: LOGGING_H_3B1A3A0F */
@@ -36,15 +36,30 @@ namespace uscxml {
 class USCXML_API LoggerImpl {
 public:
 
-	LoggerImpl() {}
+	LoggerImpl() : _minSeverity(USCXML_SCXML) {}
+	virtual ~LoggerImpl() {}
 	virtual std::shared_ptr<LoggerImpl> create() = 0;
 
+	/// Messages below the given severity are dropped before they are formatted
+	virtual void setMinSeverity(LogSeverity severity) {
+		_minSeverity = severity;
+	}
+	LogSeverity getMinSeverity() const {
+		return _minSeverity;
+	}
+	bool isEnabled(LogSeverity severity) const {
+		return severity >= _minSeverity;
+	}
+
 	virtual void log(LogSeverity severity, const Event& event) = 0;
 	virtual void log(LogSeverity severity, const Data& data) = 0;
 	virtual void log(LogSeverity severity, const std::string& message) = 0;
 
 	static std::shared_ptr<LoggerImpl> getDefault();
 
+protected:
+	LogSeverity _minSeverity;
+
 private:
 	static std::shared_ptr<LoggerImpl> _defaultLogger;
 };
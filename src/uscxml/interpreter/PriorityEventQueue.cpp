@@ -0,0 +1,296 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "PriorityEventQueue.h"
+
+#include "uscxml/interpreter/Logging.h"
+#include "uscxml/util/String.h"
+
+#include <chrono>
+#include <limits>
+#include <boost/algorithm/string.hpp>
+
+namespace uscxml {
+
+static thread_local bool nonBlockingThread = false;
+
+PriorityEventQueue::NonBlockingScope::NonBlockingScope() : _wasNonBlocking(nonBlockingThread) {
+	nonBlockingThread = true;
+}
+
+PriorityEventQueue::NonBlockingScope::~NonBlockingScope() {
+	nonBlockingThread = _wasNonBlocking;
+}
+
+PriorityEventQueue::PriorityEventQueue(size_t capacity, OverflowPolicy policy) {
+	Lane control("control");
+	control.events.push_back("done");
+	control.events.push_back("error");
+	control.events.push_back("cancel");
+
+	_lanes.push_back(control);
+	_lanes.push_back(Lane("default", capacity, policy));
+	_queues.resize(_lanes.size());
+	_stats.resize(_lanes.size());
+}
+
+PriorityEventQueue::~PriorityEventQueue() {
+}
+
+void PriorityEventQueue::addLane(const Lane& lane) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_lanes.insert(_lanes.end() - 1, lane);
+	_queues.insert(_queues.end() - 1, std::deque<Event>());
+	_stats.insert(_stats.end() - 1, LaneStats());
+}
+
+void PriorityEventQueue::addEvents(const std::string& laneName, const std::list<std::string>& events) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (auto& lane : _lanes) {
+		if (lane.name == laneName) {
+			lane.events.insert(lane.events.end(), events.begin(), events.end());
+			return;
+		}
+	}
+	LOGD(USCXML_WARN) << "No event queue lane '" << laneName << "'";
+}
+
+std::shared_ptr<EventQueueImpl> PriorityEventQueue::create() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	std::shared_ptr<PriorityEventQueue> queue(new PriorityEventQueue());
+	queue->_lanes = _lanes;
+	queue->_queues.resize(_lanes.size());
+	queue->_stats.resize(_lanes.size());
+	return queue;
+}
+
+size_t PriorityEventQueue::laneFor(const Event& event) {
+	for (size_t i = 0; i < _lanes.size() - 1; i++) {
+		for (auto& descriptor : _lanes[i].events) {
+			if (nameMatch(descriptor, event.name))
+				return i;
+		}
+		for (auto& origintype : _lanes[i].origintypes) {
+			if (origintype == event.origintype)
+				return i;
+		}
+	}
+	return _lanes.size() - 1;
+}
+
+bool PriorityEventQueue::makeRoom(size_t laneIndex, size_t needed) {
+	if (_lanes[laneIndex].capacity == 0)
+		return true;
+
+	switch (_lanes[laneIndex].policy) {
+	case DROP_OLDEST:
+		// push will make room
+		return true;
+	case BLOCK:
+		// a session sending to itself would wait for itself
+		if (!nonBlockingThread && std::this_thread::get_id() != _consumer && needed <= _lanes[laneIndex].capacity) {
+			std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(USCXML_PRIORITY_QUEUE_BLOCK_MS);
+			while (_queues[laneIndex].size() + needed > _lanes[laneIndex].capacity) {
+				if (_roomCond.wait_until(_mutex, endTime) == std::cv_status::timeout)
+					break;
+			}
+		}
+		return _queues[laneIndex].size() + needed <= _lanes[laneIndex].capacity;
+	case REJECT:
+	default:
+		return _queues[laneIndex].size() + needed <= _lanes[laneIndex].capacity;
+	}
+}
+
+void PriorityEventQueue::push(size_t laneIndex, const Event& event) {
+	LaneStats& stats = _stats[laneIndex];
+	std::deque<Event>& queue = _queues[laneIndex];
+
+	if (_lanes[laneIndex].policy == DROP_OLDEST && _lanes[laneIndex].capacity > 0) {
+		while (queue.size() >= _lanes[laneIndex].capacity) {
+			queue.pop_front();
+			stats.dropped++;
+			_depth--;
+		}
+	}
+
+	queue.push_back(event);
+	_depth++;
+	stats.enqueued++;
+
+	if (queue.size() > stats.highWater)
+		stats.highWater = queue.size();
+	if (_depth > _highWater)
+		_highWater = _depth;
+}
+
+Event PriorityEventQueue::dequeue(size_t blockMs) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_consumer = std::this_thread::get_id();
+
+	if (blockMs == std::numeric_limits<size_t>::max()) {
+		while (_depth == 0) {
+			_cond.wait(_mutex);
+		}
+
+	} else if (blockMs > 0) {
+		using namespace std::chrono;
+
+		// see BasicEventQueue::dequeue
+		system_clock::time_point now = system_clock::now();
+		system_clock::time_point endTime = now + milliseconds(blockMs);
+		if (blockMs > (size_t)(system_clock::duration::max().count() - duration_cast<milliseconds>(now.time_since_epoch()).count())) {
+			endTime = system_clock::time_point::max();
+		}
+
+		while (endTime > std::chrono::system_clock::now() && _depth == 0) {
+			_cond.wait_until(_mutex, endTime);
+		}
+	}
+
+	for (size_t i = 0; i < _queues.size(); i++) {
+		if (_queues[i].size() > 0) {
+			Event event = _queues[i].front();
+			_queues[i].pop_front();
+			_depth--;
+			if (_lanes[i].policy == BLOCK)
+				_roomCond.notify_all();
+			return event;
+		}
+	}
+	return Event();
+}
+
+void PriorityEventQueue::enqueue(const Event& event) {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		size_t laneIndex = laneFor(event);
+
+		// unnamed events unblock the interpreter, they always have room
+		if (event.name.size() > 0 && !makeRoom(laneIndex, 1)) {
+			_stats[laneIndex].rejected++;
+			ERROR_COMMUNICATION_THROW("Event queue lane '" + _lanes[laneIndex].name + "' is full");
+		}
+		push(laneIndex, event);
+	}
+	_cond.notify_all();
+}
+
+void PriorityEventQueue::enqueueBatch(const std::list<Event>& events) {
+	if (events.empty())
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		std::list<size_t> laneIndices;
+		std::map<size_t, size_t> needed;
+		for (auto& event : events) {
+			laneIndices.push_back(laneFor(event));
+			if (event.name.size() > 0)
+				needed[laneIndices.back()]++;
+		}
+
+		// all or nothing, the batch is rejected if any of its lanes is full
+		for (auto& lane : needed) {
+			if (!makeRoom(lane.first, lane.second)) {
+				_stats[lane.first].rejected += lane.second;
+				ERROR_COMMUNICATION_THROW("Event queue lane '" + _lanes[lane.first].name + "' is full");
+			}
+		}
+
+		auto laneIter = laneIndices.begin();
+		for (auto& event : events) {
+			push(*laneIter++, event);
+		}
+	}
+	_cond.notify_all();
+}
+
+void PriorityEventQueue::reset() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (auto& queue : _queues) {
+		queue.clear();
+	}
+	_depth = 0;
+	_roomCond.notify_all();
+}
+
+size_t PriorityEventQueue::depth() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _depth;
+}
+
+size_t PriorityEventQueue::highWaterMark() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _highWater;
+}
+
+std::map<std::string, PriorityEventQueue::LaneStats> PriorityEventQueue::getStats() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	std::map<std::string, LaneStats> stats;
+	for (size_t i = 0; i < _lanes.size(); i++) {
+		stats[_lanes[i].name] = _stats[i];
+		stats[_lanes[i].name].depth = _queues[i].size();
+	}
+	return stats;
+}
+
+PriorityEventQueue::OverflowPolicy PriorityEventQueue::policyFromString(const std::string& policy) {
+	if (boost::iequals(policy, "block"))
+		return BLOCK;
+	if (boost::iequals(policy, "drop") || boost::iequals(policy, "drop_oldest"))
+		return DROP_OLDEST;
+	return REJECT;
+}
+
+Data PriorityEventQueue::serialize() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	Data serialized;
+
+	for (size_t i = 0; i < _lanes.size(); i++) {
+		int index = 0;
+		for (auto event : _queues[i]) {
+			Data eventData = event;
+			serialized["PriorityEventQueue"][_lanes[i].name].array.insert(std::make_pair(index++, eventData));
+		}
+	}
+	return serialized;
+}
+
+void PriorityEventQueue::deserialize(const Data& data) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (data.hasKey("PriorityEventQueue")) {
+		for (auto& lane : data["PriorityEventQueue"].compound) {
+			for (auto event : lane.second.array) {
+				Event e = Event::fromData(event.second);
+				push(laneFor(e), e);
+			}
+		}
+	}
+
+	// we might replace a BasicEventQueue
+	if (data.hasKey("BasicEventQueue")) {
+		for (auto event : data["BasicEventQueue"].array) {
+			Event e = Event::fromData(event.second);
+			push(laneFor(e), e);
+		}
+	}
+}
+
+}
@@ -0,0 +1,142 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef PRIORITYEVENTQUEUE_H_5D3B71A2
+#define PRIORITYEVENTQUEUE_H_5D3B71A2
+
+#include "EventQueueImpl.h"
+
+#include <string>
+#include <map>
+#include <list>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// longest time a producer waits for room in a BLOCK lane before it is rejected
+#define USCXML_PRIORITY_QUEUE_BLOCK_MS 1000
+
+namespace uscxml {
+
+/**
+ * @ingroup eventqueue
+ * @ingroup impl
+ * An external event queue with prioritized lanes of bounded capacity.
+ *
+ * Every event is put into the first lane whose event descriptors or origin
+ * types match and into the last, default lane otherwise. Events are
+ * dequeued from the first non-empty lane, in order within a lane. Events
+ * in different lanes may overtake each other, e.g. a done.invoke event
+ * ahead of bulk data that arrived earlier.
+ *
+ * A full lane either blocks the producer, drops its oldest event or rejects
+ * the new one by throwing an error.communication event. A session sending
+ * to itself is never blocked but rejected instead, as is a producer still
+ * waiting after USCXML_PRIORITY_QUEUE_BLOCK_MS or one on a thread within a
+ * NonBlockingScope.
+ */
+class USCXML_API PriorityEventQueue : public EventQueueImpl {
+public:
+	enum OverflowPolicy {
+		BLOCK,
+		DROP_OLDEST,
+		REJECT
+	};
+
+	struct Lane {
+		Lane(const std::string& name = "", size_t capacity = 0, OverflowPolicy policy = REJECT)
+			: name(name), capacity(capacity), policy(policy) {}
+
+		std::string name;
+		std::list<std::string> events; ///< event descriptors, "done.invoke" matches "done.invoke.foo"
+		std::list<std::string> origintypes;
+		size_t capacity; ///< 0 for unbounded
+		OverflowPolicy policy;
+	};
+
+	/**
+	 * Producers on the current thread are rejected instead of blocked while
+	 * an instance exists, e.g. on event loops that must never stall.
+	 */
+	class USCXML_API NonBlockingScope {
+	public:
+		NonBlockingScope();
+		~NonBlockingScope();
+	protected:
+		bool _wasNonBlocking;
+	};
+
+	struct LaneStats {
+		size_t depth = 0;
+		size_t highWater = 0;
+		size_t enqueued = 0;
+		size_t dropped = 0;
+		size_t rejected = 0;
+	};
+
+	/**
+	 * A queue with an unbounded "control" lane for done.*, error.* and
+	 * cancel.* events ahead of a "default" lane with the given capacity.
+	 */
+	PriorityEventQueue(size_t capacity = 0, OverflowPolicy policy = REJECT);
+	virtual ~PriorityEventQueue();
+
+	/// Add a lane with a lower priority than all existing ones but the default lane
+	void addLane(const Lane& lane);
+	/// Make the lane with the given name match more events
+	void addEvents(const std::string& laneName, const std::list<std::string>& events);
+
+	virtual std::shared_ptr<EventQueueImpl> create();
+	virtual Event dequeue(size_t blockMs);
+	virtual void enqueue(const Event& event);
+	virtual void enqueueBatch(const std::list<Event>& events);
+	virtual void reset();
+	virtual Data serialize();
+	virtual void deserialize(const Data& data);
+
+	/// Events currently queued in all lanes
+	size_t depth();
+	/// Most events ever queued in all lanes at once
+	size_t highWaterMark();
+	std::map<std::string, LaneStats> getStats();
+
+	static OverflowPolicy policyFromString(const std::string& policy);
+
+protected:
+	size_t laneFor(const Event& event);
+	bool makeRoom(size_t laneIndex, size_t needed);
+	void push(size_t laneIndex, const Event& event);
+
+	std::vector<Lane> _lanes;
+	std::vector<std::deque<Event> > _queues;
+	std::vector<LaneStats> _stats;
+	size_t _depth = 0;
+	size_t _highWater = 0;
+
+	std::thread::id _consumer;
+	std::recursive_mutex _mutex;
+	std::condition_variable_any _cond;
+	std::condition_variable_any _roomCond;
+};
+
+}
+
+#endif /* end of include guard: PRIORITYEVENTQUEUE_H_5D3B71A2 */
@@ -0,0 +1,104 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "SessionRegistry.h"
+
+#include <vector>
+
+namespace uscxml {
+
+bool SessionRegistry::add(const std::string& sessionId, std::weak_ptr<InterpreterImpl> session) {
+	Shard& shard = shardFor(sessionId);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto sessionIter = shard.sessions.find(sessionId);
+	if (sessionIter != shard.sessions.end() && !sessionIter->second.expired())
+		return false;
+	shard.sessions[sessionId] = session;
+
+	if (shard.sessions.size() >= shard.sweepAt) {
+		// drop sessions that went away without removing themselves
+		for (auto iter = shard.sessions.begin(); iter != shard.sessions.end();) {
+			if (iter->second.expired()) {
+				iter = shard.sessions.erase(iter);
+			} else {
+				iter++;
+			}
+		}
+		shard.sweepAt = 2 * shard.sessions.size() + 64;
+	}
+	return true;
+}
+
+void SessionRegistry::remove(const std::string& sessionId) {
+	Shard& shard = shardFor(sessionId);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	shard.sessions.erase(sessionId);
+}
+
+std::shared_ptr<InterpreterImpl> SessionRegistry::get(const std::string& sessionId) {
+	Shard& shard = shardFor(sessionId);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto sessionIter = shard.sessions.find(sessionId);
+	if (sessionIter == shard.sessions.end())
+		return std::shared_ptr<InterpreterImpl>();
+
+	std::shared_ptr<InterpreterImpl> session = sessionIter->second.lock();
+	if (!session)
+		shard.sessions.erase(sessionIter);
+	return session;
+}
+
+void SessionRegistry::forEach(std::function<bool(const std::shared_ptr<InterpreterImpl>&)> visitor) {
+	std::vector<std::shared_ptr<InterpreterImpl> > sessions;
+	for (size_t i = 0; i < USCXML_SESSION_REGISTRY_SHARDS; i++) {
+		sessions.clear();
+		{
+			Shard& shard = _shards[i];
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			sessions.reserve(shard.sessions.size());
+			for (auto iter = shard.sessions.begin(); iter != shard.sessions.end();) {
+				std::shared_ptr<InterpreterImpl> session = iter->second.lock();
+				if (session) {
+					sessions.push_back(session);
+					iter++;
+				} else {
+					iter = shard.sessions.erase(iter);
+				}
+			}
+		}
+		// references are released outside the lock, a session might be destroyed here
+		for (auto& session : sessions) {
+			if (!visitor(session))
+				return;
+		}
+	}
+}
+
+size_t SessionRegistry::size() {
+	size_t size = 0;
+	for (size_t i = 0; i < USCXML_SESSION_REGISTRY_SHARDS; i++) {
+		std::lock_guard<std::mutex> lock(_shards[i].mutex);
+		size += _shards[i].sessions.size();
+	}
+	return size;
+}
+
+}
@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef SESSIONREGISTRY_H_A81F3C6D
+#define SESSIONREGISTRY_H_A81F3C6D
+
+#include "uscxml/Common.h"
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+
+/// number of independently locked shards, power of two
+#define USCXML_SESSION_REGISTRY_SHARDS 64
+
+namespace uscxml {
+
+class InterpreterImpl;
+
+/**
+ * All live interpreter sessions by session id.
+ *
+ * Sessions are distributed over shards by the hash of their id, every
+ * operation locks a single shard for the duration of a hash map operation.
+ * Sessions are not owned by the registry, expired entries are dropped when
+ * they are encountered and with every growth of their shard.
+ */
+class USCXML_API SessionRegistry {
+public:
+	SessionRegistry() {}
+
+	/// Register a session, returns false if the id is already taken by a live session
+	bool add(const std::string& sessionId, std::weak_ptr<InterpreterImpl> session);
+	void remove(const std::string& sessionId);
+
+	/// The live session with the given id or an empty pointer
+	std::shared_ptr<InterpreterImpl> get(const std::string& sessionId);
+
+	/**
+	 * Call the visitor for every live session until it returns false.
+	 * Only one shard at a time is locked while collecting its sessions,
+	 * the visitor itself is called without holding any lock.
+	 */
+	void forEach(std::function<bool(const std::shared_ptr<InterpreterImpl>&)> visitor);
+
+	size_t size();
+
+protected:
+	struct Shard {
+		Shard() : sweepAt(64) {}
+		std::mutex mutex;
+		std::unordered_map<std::string, std::weak_ptr<InterpreterImpl> > sessions;
+		size_t sweepAt;
+	};
+
+	Shard& shardFor(const std::string& sessionId) {
+		return _shards[std::hash<std::string>()(sessionId) & (USCXML_SESSION_REGISTRY_SHARDS - 1)];
+	}
+
+	Shard _shards[USCXML_SESSION_REGISTRY_SHARDS];
+
+private:
+	SessionRegistry(const SessionRegistry&) = delete;
+	SessionRegistry& operator=(const SessionRegistry&) = delete;
+};
+
+}
+
+#endif /* end of include guard: SESSIONREGISTRY_H_A81F3C6D */
@@ -23,19 +23,21 @@
 namespace uscxml {
 
 std::shared_ptr<LoggerImpl> StdOutLogger::create() {
-	return std::shared_ptr<LoggerImpl>(new StdOutLogger());
+	std::shared_ptr<LoggerImpl> logger(new StdOutLogger());
+	logger->setMinSeverity(_minSeverity);
+	return logger;
 }
 
 void StdOutLogger::log(LogSeverity severity, const std::string& message) {
-	std::cout << (severity != USCXML_VERBATIM ? "[" + Logger::severityToString(severity) + "] " : "") << message << std::flush;
+	std::cout << Logger::severityToPrefix(severity) << message << std::flush;
 }
 
 void StdOutLogger::log(LogSeverity severity, const Event& event) {
-	std::cout << (severity != USCXML_VERBATIM ? "[" + Logger::severityToString(severity) + "] " : "") << event << std::flush;
+	std::cout << Logger::severityToPrefix(severity) << event << std::flush;
 }
 
 void StdOutLogger::log(LogSeverity severity, const Data& data) {
-	std::cout << (severity != USCXML_VERBATIM ? "[" + Logger::severityToString(severity) + "] " : "") << data << std::flush;
+	std::cout << Logger::severityToPrefix(severity) << data << std::flush;
 }
 
 }
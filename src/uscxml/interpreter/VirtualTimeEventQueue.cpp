@@ -0,0 +1,350 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "VirtualTimeEventQueue.h"
+
+#include "uscxml/interpreter/Logging.h"
+
+namespace uscxml {
+
+std::shared_ptr<VirtualClock> VirtualClock::getInstance() {
+	static std::shared_ptr<VirtualClock> instance(new VirtualClock());
+	return instance;
+}
+
+uint64_t VirtualClock::now() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _now;
+}
+
+size_t VirtualClock::pending() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _timers.size();
+}
+
+void VirtualClock::setAutoAdvance(bool autoAdvance) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_autoAdvance = autoAdvance;
+}
+
+bool VirtualClock::isAutoAdvance() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _autoAdvance;
+}
+
+void VirtualClock::advance(uint64_t ms) {
+	uint64_t until;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		until = _now + ms;
+	}
+
+	while(true) {
+		std::list<Timer> due;
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			if (_timers.empty() || _timers.begin()->first > until) {
+				_now = until;
+				return;
+			}
+			_now = _timers.begin()->first;
+			while (!_timers.empty() && _timers.begin()->first == _now) {
+				due.push_back(_timers.begin()->second);
+				_timersByUUID.erase(std::make_pair(due.back().queue, due.back().eventUUID));
+				_timers.erase(_timers.begin());
+			}
+		}
+		fire(due);
+	}
+}
+
+bool VirtualClock::advanceToNext() {
+	std::list<Timer> due;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_timers.empty())
+			return false;
+
+		if (_timers.begin()->first > _now)
+			_now = _timers.begin()->first;
+
+		uint64_t dueAt = _timers.begin()->first;
+		while (!_timers.empty() && _timers.begin()->first == dueAt) {
+			due.push_back(_timers.begin()->second);
+			_timersByUUID.erase(std::make_pair(due.back().queue, due.back().eventUUID));
+			_timers.erase(_timers.begin());
+		}
+	}
+	fire(due);
+	return true;
+}
+
+void VirtualClock::fire(std::list<Timer>& timers) {
+	for (auto& timer : timers) {
+		std::multimap<VirtualTimeDelayedEventQueue*, std::thread::id>::iterator inFlight;
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			// destroyed since we took the timer
+			if (_delayQueues.find(timer.queue) == _delayQueues.end())
+				continue;
+			inFlight = _inFlight.insert(std::make_pair(timer.queue, std::this_thread::get_id()));
+		}
+
+		// we cannot hold the mutex as this may trigger delayed sends
+		try {
+			timer.queue->_callbacks->eventReady(timer.event, timer.eventUUID);
+		} catch (...) {
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_inFlight.erase(inFlight);
+			_inFlightCond.notify_all();
+			throw;
+		}
+
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_inFlight.erase(inFlight);
+		_inFlightCond.notify_all();
+	}
+}
+
+void VirtualClock::addDelayQueue(VirtualTimeDelayedEventQueue* queue) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_delayQueues.insert(queue);
+}
+
+void VirtualClock::removeDelayQueue(VirtualTimeDelayedEventQueue* queue) {
+	std::unique_lock<std::recursive_mutex> lock(_mutex);
+	cancelAll(queue);
+	_delayQueues.erase(queue);
+
+	// a callback destroying its own queue cannot wait for itself
+	_inFlightCond.wait(lock, [this, queue] {
+		auto range = _inFlight.equal_range(queue);
+		for (auto iter = range.first; iter != range.second; iter++) {
+			if (iter->second != std::this_thread::get_id())
+				return false;
+		}
+		return true;
+	});
+}
+
+void VirtualClock::schedule(VirtualTimeDelayedEventQueue* queue, const Event& event, size_t delayMs, const std::string& eventUUID) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	cancel(queue, eventUUID);
+
+	Timer timer;
+	timer.queue = queue;
+	timer.event = event;
+	timer.eventUUID = eventUUID;
+
+	// the multimap inserts equal keys at the upper bound, i.e. in order of scheduling
+	timers_t::iterator timerIter = _timers.insert(std::make_pair(_now + delayMs, timer));
+	_timersByUUID[std::make_pair(queue, eventUUID)] = timerIter;
+}
+
+void VirtualClock::cancel(VirtualTimeDelayedEventQueue* queue, const std::string& eventUUID) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	auto uuidIter = _timersByUUID.find(std::make_pair(queue, eventUUID));
+	if (uuidIter != _timersByUUID.end()) {
+		_timers.erase(uuidIter->second);
+		_timersByUUID.erase(uuidIter);
+	}
+}
+
+void VirtualClock::cancelAll(VirtualTimeDelayedEventQueue* queue) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	auto uuidIter = _timersByUUID.lower_bound(std::make_pair(queue, std::string()));
+	while (uuidIter != _timersByUUID.end() && uuidIter->first.first == queue) {
+		_timers.erase(uuidIter->second);
+		uuidIter = _timersByUUID.erase(uuidIter);
+	}
+}
+
+std::list<std::pair<Event, uint64_t> > VirtualClock::getDelayed(VirtualTimeDelayedEventQueue* queue) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	std::list<std::pair<Event, uint64_t> > delayed;
+	for (auto& timer : _timers) {
+		if (timer.second.queue == queue)
+			delayed.push_back(std::make_pair(timer.second.event, timer.first - _now));
+	}
+	return delayed;
+}
+
+void VirtualClock::addParticipant(VirtualTimeEventQueue* queue) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_participants.insert(queue);
+	_busy.insert(queue);
+}
+
+void VirtualClock::removeParticipant(VirtualTimeEventQueue* queue) {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_participants.erase(queue) == 0)
+			return;
+		_busy.erase(queue);
+		if (!_autoAdvance || !_busy.empty() || _isAdvancing)
+			return;
+		_isAdvancing = true;
+	}
+	// the others might only have been waiting for this one
+	advanceWhileIdle();
+}
+
+void VirtualClock::busy(VirtualTimeEventQueue* queue) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (_participants.find(queue) != _participants.end())
+		_busy.insert(queue);
+}
+
+void VirtualClock::idle(VirtualTimeEventQueue* queue) {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		// events are enqueued with our mutex held, none can slip in between
+		if (!queue->isEmpty())
+			return;
+		_busy.erase(queue);
+		if (!_autoAdvance || !_busy.empty() || _isAdvancing)
+			return;
+		_isAdvancing = true;
+	}
+	advanceWhileIdle();
+}
+
+void VirtualClock::advanceWhileIdle() {
+	// everyone waits for events, move on until someone has something to do
+	while(true) {
+		advanceToNext();
+
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (!_busy.empty() || _timers.empty()) {
+			_isAdvancing = false;
+			return;
+		}
+	}
+}
+
+VirtualTimeEventQueue::VirtualTimeEventQueue(std::shared_ptr<VirtualClock> clock) : _clock(clock) {
+	_clock->addParticipant(this);
+}
+
+VirtualTimeEventQueue::~VirtualTimeEventQueue() {
+	_clock->removeParticipant(this);
+}
+
+std::shared_ptr<EventQueueImpl> VirtualTimeEventQueue::create() {
+	return std::shared_ptr<EventQueueImpl>(new VirtualTimeEventQueue(_clock));
+}
+
+Event VirtualTimeEventQueue::dequeue(size_t blockMs) {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_queue.size() > 0) {
+			Event event = _queue.front();
+			_queue.pop_front();
+			return event;
+		}
+	}
+
+	// nothing to do, this may deliver delayed events to us
+	_clock->idle(this);
+	return BasicEventQueue::dequeue(blockMs);
+}
+
+void VirtualTimeEventQueue::enqueue(const Event& event) {
+	{
+		// busy and enqueued at once, the clock must not advance in between
+		std::lock_guard<std::recursive_mutex> clockLock(_clock->_mutex);
+		_clock->busy(this);
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_queue.push_back(event);
+	}
+	_cond.notify_all();
+}
+
+void VirtualTimeEventQueue::enqueueBatch(const std::list<Event>& events) {
+	if (events.empty())
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> clockLock(_clock->_mutex);
+		_clock->busy(this);
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_queue.insert(_queue.end(), events.begin(), events.end());
+	}
+	_cond.notify_all();
+}
+
+void VirtualTimeEventQueue::detach() {
+	_clock->removeParticipant(this);
+}
+
+bool VirtualTimeEventQueue::isEmpty() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _queue.empty();
+}
+
+VirtualTimeDelayedEventQueue::VirtualTimeDelayedEventQueue(DelayedEventQueueCallbacks* callbacks, std::shared_ptr<VirtualClock> clock) : _callbacks(callbacks), _clock(clock) {
+	_clock->addDelayQueue(this);
+}
+
+VirtualTimeDelayedEventQueue::~VirtualTimeDelayedEventQueue() {
+	_clock->removeDelayQueue(this);
+}
+
+std::shared_ptr<DelayedEventQueueImpl> VirtualTimeDelayedEventQueue::create(DelayedEventQueueCallbacks* callbacks) {
+	return std::shared_ptr<DelayedEventQueueImpl>(new VirtualTimeDelayedEventQueue(callbacks, _clock));
+}
+
+void VirtualTimeDelayedEventQueue::enqueueDelayed(const Event& event, size_t delayMs, const std::string& eventUUID) {
+	_clock->schedule(this, event, delayMs, eventUUID);
+}
+
+void VirtualTimeDelayedEventQueue::cancelDelayed(const std::string& eventId) {
+	_clock->cancel(this, eventId);
+}
+
+void VirtualTimeDelayedEventQueue::cancelAllDelayed() {
+	_clock->cancelAll(this);
+}
+
+void VirtualTimeDelayedEventQueue::reset() {
+	cancelAllDelayed();
+	BasicEventQueue::reset();
+}
+
+Data VirtualTimeDelayedEventQueue::serialize() {
+	Data serialized;
+	int index = 0;
+	for (auto delayed : _clock->getDelayed(this)) {
+		Data delayedEvent;
+		delayedEvent["event"] = delayed.first;
+		delayedEvent["delay"] = Data(delayed.second, Data::INTERPRETED);
+		serialized["VirtualTimeDelayedEventQueue"].array.insert(std::make_pair(index++, delayedEvent));
+	}
+	return serialized;
+}
+
+void VirtualTimeDelayedEventQueue::deserialize(const Data& data) {
+	if (data.hasKey("VirtualTimeDelayedEventQueue")) {
+		for (auto delayed : data["VirtualTimeDelayedEventQueue"].array) {
+			Event e = Event::fromData(delayed.second["event"]);
+			enqueueDelayed(e, strTo<size_t>(delayed.second["delay"]), e.uuid);
+		}
+	}
+}
+
+}
@@ -0,0 +1,193 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef VIRTUALTIMEEVENTQUEUE_H_6E02B94C
+#define VIRTUALTIMEEVENTQUEUE_H_6E02B94C
+
+#include "BasicEventQueue.h"
+#include "EventQueueImpl.h"
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace uscxml {
+
+class VirtualTimeEventQueue;
+class VirtualTimeDelayedEventQueue;
+
+/**
+ * @ingroup eventqueue
+ * A simulated clock for the delayed events of any number of sessions.
+ *
+ * Time only moves when advance() is called or, with auto advance, as soon
+ * as every participating session is idle, i.e. waits on an empty external
+ * VirtualTimeEventQueue. The clock then jumps to the earliest due delayed
+ * event and delivers all events due at that time in the order they were
+ * sent. Events crossing sessions in this process keep the clock from
+ * advancing until their receiver processed them, events leaving the
+ * process (e.g. via basichttp) do not.
+ *
+ * Delayed events are delivered on the thread that advanced the clock. With
+ * auto advance, this is the thread of the session that went idle last, which
+ * may deliver the events of any other session. The callbacks of an
+ * InterpreterImpl only ever touch the receiving session's external queue,
+ * which is safe from any thread. A delayed queue that is destroyed waits
+ * for the delivery of its events still in progress on other threads.
+ */
+class USCXML_API VirtualClock {
+public:
+	VirtualClock(bool autoAdvance = true) : _autoAdvance(autoAdvance) {}
+
+	/// The clock shared by all sessions with USCXML_VIRTUAL_TIME set
+	static std::shared_ptr<VirtualClock> getInstance();
+
+	/// Virtual milliseconds since the clock was created
+	uint64_t now();
+
+	/// Move on by the given time, delivering all delayed events due until then
+	void advance(uint64_t ms);
+
+	/// Jump to the earliest due delayed events and deliver them, false if there are none
+	bool advanceToNext();
+
+	/// Number of delayed events not yet delivered
+	size_t pending();
+
+	void setAutoAdvance(bool autoAdvance);
+	bool isAutoAdvance();
+
+protected:
+	struct Timer {
+		VirtualTimeDelayedEventQueue* queue;
+		std::string eventUUID;
+		Event event;
+	};
+	typedef std::multimap<uint64_t, Timer> timers_t;
+
+	void schedule(VirtualTimeDelayedEventQueue* queue, const Event& event, size_t delayMs, const std::string& eventUUID);
+	void cancel(VirtualTimeDelayedEventQueue* queue, const std::string& eventUUID);
+	void cancelAll(VirtualTimeDelayedEventQueue* queue);
+	std::list<std::pair<Event, uint64_t> > getDelayed(VirtualTimeDelayedEventQueue* queue);
+	void fire(std::list<Timer>& timers);
+
+	void addDelayQueue(VirtualTimeDelayedEventQueue* queue);
+	void removeDelayQueue(VirtualTimeDelayedEventQueue* queue);
+
+	void addParticipant(VirtualTimeEventQueue* queue);
+	void removeParticipant(VirtualTimeEventQueue* queue);
+	void busy(VirtualTimeEventQueue* queue);
+	void idle(VirtualTimeEventQueue* queue);
+	void advanceWhileIdle();
+
+	std::recursive_mutex _mutex;
+	uint64_t _now = 0;
+	bool _autoAdvance;
+	bool _isAdvancing = false;
+
+	timers_t _timers; ///< by due time, equal due times in order of scheduling
+	std::map<std::pair<VirtualTimeDelayedEventQueue*, std::string>, timers_t::iterator> _timersByUUID;
+
+	std::set<VirtualTimeDelayedEventQueue*> _delayQueues;
+	std::multimap<VirtualTimeDelayedEventQueue*, std::thread::id> _inFlight; ///< threads delivering events of a queue
+	std::condition_variable_any _inFlightCond;
+
+	std::set<VirtualTimeEventQueue*> _participants;
+	std::set<VirtualTimeEventQueue*> _busy;
+
+	friend class VirtualTimeEventQueue;
+	friend class VirtualTimeDelayedEventQueue;
+};
+
+/**
+ * @ingroup eventqueue
+ * @ingroup impl
+ * An external queue that reports its session as idle to a VirtualClock
+ * whenever it is dequeued while empty and as busy once events arrive.
+ * A session counts as busy until it first waits for an event and until it
+ * detaches, e.g. when it finished.
+ */
+class USCXML_API VirtualTimeEventQueue : public BasicEventQueue {
+public:
+	VirtualTimeEventQueue(std::shared_ptr<VirtualClock> clock);
+	virtual ~VirtualTimeEventQueue();
+	virtual std::shared_ptr<EventQueueImpl> create();
+	virtual Event dequeue(size_t blockMs);
+	virtual void enqueue(const Event& event);
+	virtual void enqueueBatch(const std::list<Event>& events);
+
+	/// No longer hold back the clock, the session will not dequeue anymore
+	void detach();
+
+protected:
+	bool isEmpty();
+
+	std::shared_ptr<VirtualClock> _clock;
+
+	friend class VirtualClock;
+};
+
+/**
+ * @ingroup eventqueue
+ * @ingroup impl
+ * Delayed events are due in virtual time of a VirtualClock instead of after
+ * real timers expired.
+ */
+class USCXML_API VirtualTimeDelayedEventQueue : public BasicEventQueue, public DelayedEventQueueImpl {
+public:
+	VirtualTimeDelayedEventQueue(DelayedEventQueueCallbacks* callbacks, std::shared_ptr<VirtualClock> clock);
+	virtual ~VirtualTimeDelayedEventQueue();
+	virtual std::shared_ptr<DelayedEventQueueImpl> create(DelayedEventQueueCallbacks* callbacks);
+	virtual void enqueueDelayed(const Event& event, size_t delayMs, const std::string& eventUUID);
+	virtual void cancelDelayed(const std::string& eventId);
+	virtual void cancelAllDelayed();
+	virtual Event dequeue(size_t blockMs) {
+		return BasicEventQueue::dequeue(blockMs);
+	}
+	virtual void enqueue(const Event& event) {
+		return BasicEventQueue::enqueue(event);
+	}
+	virtual void enqueueBatch(const std::list<Event>& events) {
+		return BasicEventQueue::enqueueBatch(events);
+	}
+	virtual void reset();
+
+	virtual Data serialize();
+	virtual void deserialize(const Data& data);
+
+protected:
+	virtual std::shared_ptr<EventQueueImpl> create() {
+		ErrorEvent e("Cannot create a DelayedEventQueue without callbacks");
+		throw e;
+	}
+
+	DelayedEventQueueCallbacks* _callbacks;
+	std::shared_ptr<VirtualClock> _clock;
+
+	friend class VirtualClock;
+};
+
+}
+
+#endif /* end of include guard: VIRTUALTIMEEVENTQUEUE_H_6E02B94C */
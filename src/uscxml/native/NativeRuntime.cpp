@@ -0,0 +1,641 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "uscxml/native/NativeRuntime.h"
+#include "uscxml/native/NativeSession.h"
+#include "uscxml/interpreter/Logging.h"
+
+#define WHEEL_MASK (USCXML_NATIVE_WHEEL_SLOTS - 1)
+
+namespace uscxml {
+
+static void clearEvent(NativeEvent* event) {
+	Event& e = event->event;
+	e.raw.clear();
+	e.name.clear();
+	e.eventType = Event::INTERNAL;
+	e.origin.clear();
+	e.origintype.clear();
+	e.sendid.clear();
+	e.hideSendId = false;
+	e.invokeid.clear();
+	e.uuid.clear();
+	e.namelist.clear();
+	e.params.clear();
+	e.data = Data();
+	event->target.clear();
+	event->next = NULL;
+}
+
+static void checkMachine(const uscxml_machine* machine) {
+	if (machine->nr_states > USCXML_MAX_NR_STATES_BYTES * 8 ||
+	        machine->nr_transitions > USCXML_MAX_NR_TRANS_BYTES * 8) {
+		ERROR_PLATFORM_THROW("Machine '" + std::string(machine->name != NULL ? machine->name : "") +
+		                     "' exceeds the bitsets uscxml_native was built with, rebuild with larger USCXML_MAX_NR_STATES_BYTES / USCXML_MAX_NR_TRANS_BYTES");
+	}
+}
+
+NativeEventPool::~NativeEventPool() {
+	for (auto chunk : _chunks) {
+		delete[] chunk;
+	}
+}
+
+NativeEvent* NativeEventPool::acquire() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_free == NULL) {
+		NativeEvent* chunk = new NativeEvent[USCXML_NATIVE_POOL_CHUNK];
+		for (size_t i = 0; i < USCXML_NATIVE_POOL_CHUNK; i++) {
+			chunk[i].next = _free;
+			_free = &chunk[i];
+		}
+		_chunks.push_back(chunk);
+		_capacity += USCXML_NATIVE_POOL_CHUNK;
+		_available += USCXML_NATIVE_POOL_CHUNK;
+	}
+	NativeEvent* event = _free;
+	_free = event->next;
+	event->next = NULL;
+	_available--;
+	return event;
+}
+
+NativeEvent* NativeEventPool::acquire(const Event& event) {
+	NativeEvent* pooled = acquire();
+	pooled->event = event;
+	return pooled;
+}
+
+void NativeEventPool::release(NativeEvent* event) {
+	clearEvent(event);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	event->next = _free;
+	_free = event;
+	_available++;
+}
+
+void NativeEventPool::release(NativeEventQueue& queue) {
+	if (queue.empty())
+		return;
+
+	size_t nrEvents = 0;
+	NativeEvent* event = queue.head;
+	while(event != NULL) {
+		NativeEvent* next = event->next;
+		clearEvent(event);
+		event->next = next;
+		event = next;
+		nrEvents++;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	queue.tail->next = _free;
+	_free = queue.head;
+	_available += nrEvents;
+	queue.head = queue.tail = NULL;
+}
+
+size_t NativeEventPool::capacity() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _capacity;
+}
+
+size_t NativeEventPool::available() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _available;
+}
+
+NativeTimerWheel::NativeTimerWheel() :
+	_slots(USCXML_NATIVE_WHEEL_SLOTS, NULL),
+	_tails(USCXML_NATIVE_WHEEL_SLOTS, NULL),
+	_start(std::chrono::steady_clock::now()) {
+}
+
+NativeTimerWheel::~NativeTimerWheel() {
+	for (auto timer : _slots) {
+		while(timer != NULL) {
+			Timer* next = timer->next;
+			delete timer;
+			timer = next;
+		}
+	}
+	while(_free != NULL) {
+		Timer* next = _free->next;
+		delete _free;
+		_free = next;
+	}
+}
+
+uint64_t NativeTimerWheel::now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start).count();
+}
+
+std::chrono::steady_clock::time_point NativeTimerWheel::timeOf(uint64_t tick) {
+	return _start + std::chrono::milliseconds(tick);
+}
+
+void NativeTimerWheel::schedule(NativeSession* session, NativeEvent* event, size_t delayMs, const std::string& sendId) {
+	Timer* timer = _free;
+	if (timer != NULL) {
+		_free = timer->next;
+	} else {
+		timer = new Timer();
+	}
+
+	uint64_t current = now();
+	if (_size == 0 && current > _tick) {
+		// no timer in between, advance() must not walk every tick since the wheel was idle
+		_tick = current;
+	}
+
+	uint64_t due = current + delayMs;
+	if (due <= _tick)
+		due = _tick + 1;
+
+	timer->session = session;
+	timer->event = event;
+	timer->sendId = sendId;
+	timer->slot = due & WHEEL_MASK;
+	// revolutions before the slot is visited at the due tick
+	timer->rounds = (due - _tick - 1) / USCXML_NATIVE_WHEEL_SLOTS;
+
+	timer->next = NULL;
+	timer->prev = _tails[timer->slot];
+	if (timer->prev != NULL) {
+		timer->prev->next = timer;
+	} else {
+		_slots[timer->slot] = timer;
+	}
+	_tails[timer->slot] = timer;
+
+	timer->sessionPrev = NULL;
+	timer->sessionNext = session->_timers;
+	if (session->_timers != NULL)
+		session->_timers->sessionPrev = timer;
+	session->_timers = timer;
+
+	_size++;
+}
+
+void NativeTimerWheel::unlink(Timer* timer) {
+	if (timer->prev != NULL) {
+		timer->prev->next = timer->next;
+	} else {
+		_slots[timer->slot] = timer->next;
+	}
+	if (timer->next != NULL) {
+		timer->next->prev = timer->prev;
+	} else {
+		_tails[timer->slot] = timer->prev;
+	}
+
+	if (timer->sessionPrev != NULL) {
+		timer->sessionPrev->sessionNext = timer->sessionNext;
+	} else {
+		timer->session->_timers = timer->sessionNext;
+	}
+	if (timer->sessionNext != NULL)
+		timer->sessionNext->sessionPrev = timer->sessionPrev;
+
+	timer->prev = timer->next = NULL;
+	timer->sessionPrev = timer->sessionNext = NULL;
+	_size--;
+}
+
+void NativeTimerWheel::cancel(NativeSession* session, const std::string& sendId, std::list<Timer*>& cancelled) {
+	Timer* timer = session->_timers;
+	while(timer != NULL) {
+		Timer* next = timer->sessionNext;
+		if (timer->sendId == sendId) {
+			unlink(timer);
+			cancelled.push_back(timer);
+		}
+		timer = next;
+	}
+}
+
+void NativeTimerWheel::cancelAll(NativeSession* session, std::list<Timer*>& cancelled) {
+	while(session->_timers != NULL) {
+		Timer* timer = session->_timers;
+		unlink(timer);
+		cancelled.push_back(timer);
+	}
+}
+
+void NativeTimerWheel::advance(uint64_t tick, std::list<Timer*>& expired) {
+	while(_tick < tick) {
+		if (_size == 0) {
+			_tick = tick;
+			return;
+		}
+
+		_tick++;
+		Timer* timer = _slots[_tick & WHEEL_MASK];
+		while(timer != NULL) {
+			Timer* next = timer->next;
+			if (timer->rounds == 0) {
+				unlink(timer);
+				expired.push_back(timer);
+			} else {
+				timer->rounds--;
+			}
+			timer = next;
+		}
+	}
+}
+
+uint64_t NativeTimerWheel::nextExpiration() {
+	if (_size > 0) {
+		for (uint64_t tick = _tick + 1; tick <= _tick + USCXML_NATIVE_WHEEL_SLOTS; tick++) {
+			for (Timer* timer = _slots[tick & WHEEL_MASK]; timer != NULL; timer = timer->next) {
+				if (timer->rounds == 0)
+					return tick;
+			}
+		}
+	}
+	return _tick + USCXML_NATIVE_WHEEL_SLOTS;
+}
+
+void NativeTimerWheel::release(Timer* timer) {
+	timer->session = NULL;
+	timer->event = NULL;
+	timer->sendId.clear();
+	timer->next = _free;
+	_free = timer;
+}
+
+NativeRuntime::NativeRuntime(size_t nrThreads) {
+	for (size_t i = 0; i < nrThreads; i++) {
+		_threads.push_back(new std::thread(&NativeRuntime::work, this, false));
+	}
+}
+
+NativeRuntime::~NativeRuntime() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isStopped = true;
+	}
+	_cond.notify_all();
+
+	for (auto thread : _threads) {
+		thread->join();
+		delete thread;
+	}
+
+	NativeEventQueue events;
+	for (auto session : _alive) {
+		std::list<NativeTimerWheel::Timer*> timers;
+		_timers.cancelAll(session, timers);
+		releaseTimers(timers, events);
+		delete session;
+	}
+	_pool.release(events);
+}
+
+NativeSession* NativeRuntime::create(const uscxml_machine* machine, size_t ctxSize) {
+	if (ctxSize != sizeof(uscxml_ctx)) {
+		ERROR_PLATFORM_THROW("Generated types of the application and uscxml_native differ, include uscxml/native/NativeTypes.h before the machine and build both with the same bitset sizes");
+	}
+	checkMachine(machine);
+
+	NativeSession* session = new NativeSession(this, machine, NULL, NULL);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_sessions[session->_sessionId] = session;
+	_alive.insert(session);
+	_unfinished++;
+	session->_state = NativeSession::QUEUED;
+	scheduleLocked(session);
+	return session;
+}
+
+std::string NativeRuntime::invoke(NativeSession* parent, const uscxml_elem_invoke* invocation, const std::string& invokeId) {
+	checkMachine(invocation->machine);
+
+	NativeSession* session = new NativeSession(this, invocation->machine, parent, invocation);
+	session->_invocation->invokeId = invokeId;
+	std::string sessionId = session->_sessionId;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_sessions[sessionId] = session;
+	_alive.insert(session);
+	session->_state = NativeSession::QUEUED;
+	scheduleLocked(session);
+	return sessionId;
+}
+
+void NativeRuntime::destroy(NativeSession* session) {
+	NativeEventQueue events;
+	bool isAccepting = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!session->_isDone) {
+			session->_isDone = true;
+			_unfinished--;
+			_cond.notify_all();
+			_finishedCond.notify_all();
+		}
+
+		// a worker finishing the session in between would leave it to no one
+		auto sessionIter = _sessions.find(session->_sessionId);
+		isAccepting = (sessionIter != _sessions.end());
+		if (isAccepting) {
+			// still running, the worker picking it up will dispose it
+			cancelLocked(sessionIter, events);
+		}
+	}
+	_pool.release(events);
+
+	if (!isAccepting)
+		dispose(session);
+}
+
+void NativeRuntime::cancel(const std::string& sessionId) {
+	NativeEventQueue events;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto sessionIter = _sessions.find(sessionId);
+		if (sessionIter == _sessions.end())
+			return;
+		cancelLocked(sessionIter, events);
+	}
+	_pool.release(events);
+}
+
+void NativeRuntime::cancelLocked(std::map<std::string, NativeSession*>::iterator sessionIter, NativeEventQueue& events) {
+	NativeSession* session = sessionIter->second;
+	_sessions.erase(sessionIter);
+
+	std::list<NativeTimerWheel::Timer*> timers;
+	_timers.cancelAll(session, timers);
+	releaseTimers(timers, events);
+
+	std::lock_guard<std::mutex> sessionLock(session->_mutex);
+	session->_isCancelled = true;
+	if (session->_state == NativeSession::IDLE) {
+		session->_state = NativeSession::QUEUED;
+		scheduleLocked(session);
+	}
+}
+
+void NativeRuntime::run() {
+	work(true);
+}
+
+void NativeRuntime::wait() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(_unfinished > 0 && !_isStopped) {
+		_finishedCond.wait(lock);
+	}
+}
+
+bool NativeRuntime::send(const std::string& sessionId, const Event& event) {
+	NativeEvent* pooled = _pool.acquire(event);
+	pooled->event.eventType = Event::EXTERNAL;
+	if (!deliver(sessionId, pooled)) {
+		_pool.release(pooled);
+		return false;
+	}
+	return true;
+}
+
+size_t NativeRuntime::getNrSessions() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _alive.size();
+}
+
+bool NativeRuntime::deliver(const std::string& sessionId, NativeEvent* event) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto sessionIter = _sessions.find(sessionId);
+	if (sessionIter == _sessions.end())
+		return false;
+
+	if (sessionIter->second->pushExternal(event))
+		scheduleLocked(sessionIter->second);
+	return true;
+}
+
+void NativeRuntime::delay(NativeSession* from, NativeEvent* event, size_t delayMs, const std::string& sendId) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_timers.schedule(from, event, delayMs, sendId);
+	// idle workers have to reconsider how long to sleep
+	_cond.notify_one();
+}
+
+void NativeRuntime::cancelDelayed(NativeSession* from, const std::string& sendId) {
+	NativeEventQueue events;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::list<NativeTimerWheel::Timer*> timers;
+		_timers.cancel(from, sendId, timers);
+		releaseTimers(timers, events);
+	}
+	_pool.release(events);
+}
+
+void NativeRuntime::releaseTimers(std::list<NativeTimerWheel::Timer*>& timers, NativeEventQueue& events) {
+	for (auto timer : timers) {
+		events.push(timer->event);
+		_timers.release(timer);
+	}
+	timers.clear();
+}
+
+void NativeRuntime::schedule(NativeSession* session) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	scheduleLocked(session);
+}
+
+void NativeRuntime::scheduleLocked(NativeSession* session) {
+	_runnable.push_back(session);
+	_cond.notify_one();
+}
+
+void NativeRuntime::fireTimers() {
+	std::list<NativeTimerWheel::Timer*> expired;
+	_timers.advance(_timers.now(), expired);
+
+	for (auto timer : expired) {
+		if (timer->session->pushIncoming(timer->event))
+			scheduleLocked(timer->session);
+		_timers.release(timer);
+	}
+}
+
+void NativeRuntime::work(bool untilFinished) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_isStopped && !(untilFinished && _unfinished == 0)) {
+		if (_timers.size() > 0)
+			fireTimers();
+
+		if (!_runnable.empty()) {
+			NativeSession* session = _runnable.front();
+			_runnable.pop_front();
+
+			lock.unlock();
+			process(session);
+			lock.lock();
+			continue;
+		}
+
+		if (_timers.size() > 0) {
+			_cond.wait_until(lock, _timers.timeOf(_timers.nextExpiration()));
+		} else {
+			_cond.wait(lock);
+		}
+	}
+}
+
+void NativeRuntime::process(NativeSession* session) {
+	bool isCancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(session->_mutex);
+		isCancelled = session->_isCancelled;
+		session->_state = NativeSession::RUNNING;
+	}
+	if (isCancelled) {
+		dispose(session);
+		return;
+	}
+
+	int err = USCXML_ERR_OK;
+	for (size_t i = 0; i < USCXML_NATIVE_STEP_BUDGET; i++) {
+		err = session->step();
+		if (err == USCXML_ERR_IDLE || err == USCXML_ERR_DONE)
+			break;
+	}
+
+	if (err == USCXML_ERR_DONE) {
+		finish(session);
+		return;
+	}
+
+	bool requeue = false;
+	{
+		std::lock_guard<std::mutex> lock(session->_mutex);
+		isCancelled = session->_isCancelled;
+		requeue = (isCancelled ||
+		           err != USCXML_ERR_IDLE ||
+		           !session->_external.empty() ||
+		           !session->_incoming.empty());
+		session->_state = (requeue ? NativeSession::QUEUED : NativeSession::IDLE);
+	}
+
+	if (isCancelled) {
+		dispose(session);
+	} else if (requeue) {
+		schedule(session);
+	}
+}
+
+void NativeRuntime::finish(NativeSession* session) {
+	// children not uninvoked when exiting all states, e.g. after a failed invocation
+	if (session->_extras) {
+		for (auto& child : session->_extras->children) {
+			cancel(child.second.first);
+		}
+		session->_extras->children.clear();
+	}
+
+	if (session->_invocation) {
+		bool isCancelled = false;
+		{
+			std::lock_guard<std::mutex> lock(session->_mutex);
+			isCancelled = session->_isCancelled;
+		}
+
+		if (!isCancelled) {
+			NativeEvent* done = _pool.acquire();
+			done->event.name = "done.invoke." + session->_invocation->invokeId;
+			done->event.invokeid = session->_invocation->invokeId;
+			done->event.eventType = Event::EXTERNAL;
+			if (!deliver(session->_invocation->parentId, done))
+				_pool.release(done);
+		}
+		dispose(session);
+		return;
+	}
+
+	NativeEventQueue events;
+	bool isCancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_sessions.erase(session->_sessionId);
+
+		std::list<NativeTimerWheel::Timer*> timers;
+		_timers.cancelAll(session, timers);
+		releaseTimers(timers, events);
+
+		{
+			std::lock_guard<std::mutex> sessionLock(session->_mutex);
+			isCancelled = session->_isCancelled;
+			session->_state = NativeSession::FINISHED;
+		}
+
+		// the session belongs to whoever created it from here on
+		if (!session->_isDone) {
+			session->_isDone = true;
+			_unfinished--;
+			_cond.notify_all();
+			_finishedCond.notify_all();
+		}
+	}
+	_pool.release(events);
+
+	// destroy() was called while we were stepping, it left the session to us
+	if (isCancelled)
+		dispose(session);
+}
+
+void NativeRuntime::dispose(NativeSession* session) {
+	if (session->_extras) {
+		for (auto& child : session->_extras->children) {
+			cancel(child.second.first);
+		}
+		for (auto& invoker : session->_extras->invokers) {
+			try {
+				invoker.second.uninvoke();
+			} catch (Event e) {
+				LOG(session->getLogger(), USCXML_ERROR) << "Cannot uninvoke " << invoker.first << ": " << e << std::endl;
+			}
+		}
+		session->_extras->children.clear();
+		session->_extras->invokers.clear();
+	}
+
+	NativeEventQueue events;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto sessionIter = _sessions.find(session->_sessionId);
+		if (sessionIter != _sessions.end() && sessionIter->second == session)
+			_sessions.erase(sessionIter);
+
+		std::list<NativeTimerWheel::Timer*> timers;
+		_timers.cancelAll(session, timers);
+		releaseTimers(timers, events);
+
+		_alive.erase(session);
+	}
+	_pool.release(events);
+
+	delete session;
+}
+
+}
@@ -0,0 +1,280 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef NATIVERUNTIME_H_2F9D4B17
+#define NATIVERUNTIME_H_2F9D4B17
+
+#include "uscxml/Common.h"
+#include "uscxml/messages/Event.h"
+#include "uscxml/native/NativeTypes.h"
+
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/// microsteps of a session before others get their turn
+#define USCXML_NATIVE_STEP_BUDGET 64
+/// slots of the timer wheel, a power of two
+#define USCXML_NATIVE_WHEEL_SLOTS 512
+/// events allocated at once when the pool runs dry
+#define USCXML_NATIVE_POOL_CHUNK 64
+
+namespace uscxml {
+
+class NativeSession;
+
+/**
+ * An event as queued by a NativeRuntime, recycled via its NativeEventPool.
+ */
+struct NativeEvent {
+	NativeEvent() : event(""), next(NULL) {}
+	Event event;
+	std::string target; ///< of a delayed send, routed by its session once expired
+	NativeEvent* next;
+};
+
+/**
+ * An intrusive queue of pooled events.
+ */
+struct NativeEventQueue {
+	NativeEvent* head = NULL;
+	NativeEvent* tail = NULL;
+
+	bool empty() const {
+		return head == NULL;
+	}
+
+	void push(NativeEvent* event) {
+		event->next = NULL;
+		if (tail != NULL) {
+			tail->next = event;
+		} else {
+			head = event;
+		}
+		tail = event;
+	}
+
+	NativeEvent* pop() {
+		NativeEvent* event = head;
+		if (event != NULL) {
+			head = event->next;
+			if (head == NULL)
+				tail = NULL;
+			event->next = NULL;
+		}
+		return event;
+	}
+
+	void append(NativeEventQueue& other) {
+		if (other.empty())
+			return;
+		if (tail != NULL) {
+			tail->next = other.head;
+		} else {
+			head = other.head;
+		}
+		tail = other.tail;
+		other.head = other.tail = NULL;
+	}
+};
+
+/**
+ * Events are taken from and returned to a free list, its chunks are only
+ * released with the pool. Strings and containers of a recycled event keep
+ * their capacity.
+ */
+class USCXML_API NativeEventPool {
+public:
+	NativeEventPool() {}
+	~NativeEventPool();
+
+	/// A cleared event
+	NativeEvent* acquire();
+	/// An event with a copy of the given one
+	NativeEvent* acquire(const Event& event);
+	void release(NativeEvent* event);
+	void release(NativeEventQueue& queue);
+
+	/// Events ever allocated and currently available
+	size_t capacity();
+	size_t available();
+
+protected:
+	std::mutex _mutex;
+	NativeEvent* _free = NULL;
+	std::list<NativeEvent*> _chunks;
+	size_t _capacity = 0;
+	size_t _available = 0;
+};
+
+/**
+ * A hashed timing wheel with a tick of a millisecond for the delayed events
+ * of all sessions. Scheduling and cancelling are constant time, advancing
+ * visits the slots of the elapsed ticks only. Not synchronized, the
+ * NativeRuntime guards it with its mutex.
+ */
+class USCXML_API NativeTimerWheel {
+public:
+	struct Timer {
+		NativeSession* session;
+		NativeEvent* event;
+		std::string sendId;
+		uint64_t rounds;
+		size_t slot;
+		Timer* prev;
+		Timer* next;
+		Timer* sessionPrev;
+		Timer* sessionNext;
+	};
+
+	NativeTimerWheel();
+	~NativeTimerWheel();
+
+	void schedule(NativeSession* session, NativeEvent* event, size_t delayMs, const std::string& sendId);
+	/// Remove and return all timers of the session with the given send id
+	void cancel(NativeSession* session, const std::string& sendId, std::list<Timer*>& cancelled);
+	/// Remove and return all timers of the session
+	void cancelAll(NativeSession* session, std::list<Timer*>& cancelled);
+
+	/// Move on to the given tick and remove and return all expired timers, in order of expiration
+	void advance(uint64_t tick, std::list<Timer*>& expired);
+	/// The tick of the earliest expiration, at most a revolution ahead
+	uint64_t nextExpiration();
+
+	void release(Timer* timer);
+
+	size_t size() {
+		return _size;
+	}
+
+	uint64_t tick() {
+		return _tick;
+	}
+
+	/// Milliseconds since the wheel was created
+	uint64_t now();
+	/// When the given tick is due
+	std::chrono::steady_clock::time_point timeOf(uint64_t tick);
+
+protected:
+	void unlink(Timer* timer);
+
+	std::vector<Timer*> _slots;
+	std::vector<Timer*> _tails; ///< timers of a slot expire in the order they were scheduled
+	Timer* _free = NULL;
+	uint64_t _tick = 0;
+	size_t _size = 0;
+	std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @ingroup impl
+ * Runs machines generated by ChartToC, compiled into the application with
+ * uscxml/native/NativeTypes.h included first.
+ *
+ * Every NativeSession is a uscxml_ctx with the datamodel, queues and
+ * invocations of its machine. Runnable sessions are stepped by a pool of
+ * worker threads, or by the thread calling run(), a session by a single
+ * thread at a time. Delayed events are kept in a NativeTimerWheel, all
+ * events are recycled via a NativeEventPool.
+ *
+ * Sessions invoked by others are owned by the runtime and destroyed when
+ * they finish or are cancelled, sessions created via create() remain until
+ * destroy() so their final configuration can be inspected.
+ */
+class USCXML_API NativeRuntime {
+public:
+	/// No worker threads with nrThreads = 0, sessions are stepped in run() then
+	NativeRuntime(size_t nrThreads = 0);
+	virtual ~NativeRuntime();
+
+	/// A started session of the given machine
+	NativeSession* create(const uscxml_machine* machine) {
+		// catches a library and application built with different bitset sizes
+		return create(machine, sizeof(uscxml_ctx));
+	}
+	void destroy(NativeSession* session);
+
+	/// Step sessions in the calling thread until all created sessions finished
+	void run();
+	/// Wait until all created sessions finished
+	void wait();
+
+	/// Deliver an external event to the session with the given id, false if there is none
+	bool send(const std::string& sessionId, const Event& event);
+
+	NativeEventPool& getEventPool() {
+		return _pool;
+	}
+
+	/// Sessions currently running, including invoked ones
+	size_t getNrSessions();
+
+protected:
+	NativeSession* create(const uscxml_machine* machine, size_t ctxSize);
+
+	/// Start a session invoked by the given one and return its id, it might be gone already
+	std::string invoke(NativeSession* parent, const uscxml_elem_invoke* invocation, const std::string& invokeId);
+	/// Cancel an invoked session, it is destroyed by the next worker picking it up
+	void cancel(const std::string& sessionId);
+
+	/// Hand an event over to the session with the given id, false if there is none
+	bool deliver(const std::string& sessionId, NativeEvent* event);
+	void delay(NativeSession* from, NativeEvent* event, size_t delayMs, const std::string& sendId);
+	void cancelDelayed(NativeSession* from, const std::string& sendId);
+
+	void schedule(NativeSession* session);
+	void scheduleLocked(NativeSession* session);
+	void cancelLocked(std::map<std::string, NativeSession*>::iterator sessionIter, NativeEventQueue& events);
+
+	void work(bool untilFinished);
+	void process(NativeSession* session);
+	void finish(NativeSession* session);
+	void dispose(NativeSession* session);
+	void fireTimers();
+	/// With the runtime locked, return the timers to the wheel and collect their events
+	void releaseTimers(std::list<NativeTimerWheel::Timer*>& timers, NativeEventQueue& events);
+
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::condition_variable _finishedCond;
+	bool _isStopped = false;
+
+	NativeEventPool _pool;
+	NativeTimerWheel _timers;
+	std::deque<NativeSession*> _runnable;
+	std::map<std::string, NativeSession*> _sessions; ///< all sessions still accepting events
+	std::set<NativeSession*> _alive;
+	size_t _unfinished = 0;
+
+	std::list<std::thread*> _threads;
+
+	friend class NativeSession;
+};
+
+}
+
+#endif /* end of include guard: NATIVERUNTIME_H_2F9D4B17 */
@@ -0,0 +1,796 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "uscxml/native/NativeSession.h"
+#include "uscxml/util/String.h"
+#include "uscxml/util/UUID.h"
+#include "uscxml/util/Convenience.h"
+#include "uscxml/interpreter/Logging.h"
+
+#include <string.h>
+#include <sstream>
+
+#define USER_DATA(ctx) ((NativeSession*)(((uscxml_ctx*)ctx)->user_data))
+#define SCXML_IO_PROCESSOR "http://www.w3.org/TR/scxml/#SCXMLEventProcessor"
+
+namespace uscxml {
+
+NativeSession::NativeSession(NativeRuntime* runtime, const uscxml_machine* machine, NativeSession* parent, const uscxml_elem_invoke* invocation) :
+	_runtime(runtime), _hasIncoming(false) {
+
+	// clear and initialize machine context
+	memset(&_ctx, 0, sizeof(uscxml_ctx));
+	_ctx.machine = machine;
+	_ctx.user_data = (void*)this;
+
+	// register callbacks with scxml context
+	_ctx.is_matched = &isMatched;
+	_ctx.event_id = &eventId;
+	_ctx.is_true = &isTrue;
+	_ctx.raise_done_event = &raiseDoneEvent;
+	_ctx.invoke = &invoke;
+	_ctx.exec_content_send = &execContentSend;
+	_ctx.exec_content_raise = &execContentRaise;
+	_ctx.exec_content_cancel = &execContentCancel;
+	_ctx.exec_content_log = &execContentLog;
+	_ctx.exec_content_assign = &execContentAssign;
+	_ctx.exec_content_foreach_init = &execContentForeachInit;
+	_ctx.exec_content_foreach_next = &execContentForeachNext;
+	_ctx.exec_content_foreach_done = &execContentForeachDone;
+	_ctx.dequeue_external = &dequeueExternal;
+	_ctx.dequeue_internal = &dequeueInternal;
+	_ctx.exec_content_init = &execContentInit;
+	_ctx.exec_content_script = &execContentScript;
+
+	_sessionId = UUID::getUUID();
+	_name = (machine->name != NULL ? machine->name : "");
+
+	if (invocation != NULL) {
+		_invocation.reset(new Invocation());
+		_invocation->invocation = invocation;
+		_invocation->parentId = parent->_sessionId;
+
+		/// test 226/240 - initialize from invoke request
+		const uscxml_elem_param* param = invocation->params;
+		while(param != NULL && USCXML_ELEM_PARAM_IS_SET(param)) {
+			std::string identifier;
+			if (param->name != NULL) {
+				identifier = param->name;
+			} else if (param->location != NULL) {
+				identifier = param->location;
+			}
+			_invocation->data[identifier] = parent->_dataModel.evalAsData(param->expr != NULL ? param->expr : param->location);
+			param++;
+		}
+
+		if (invocation->namelist != NULL) {
+			std::list<std::string> names = tokenize(invocation->namelist);
+			for (auto& name : names) {
+				_invocation->data[name] = parent->_dataModel.evalAsData(name);
+			}
+		}
+	}
+
+	_dataModel = Factory::getInstance().createDataModel(machine->datamodel != NULL ? machine->datamodel : "null", this);
+	if (!_dataModel) {
+		ERROR_PLATFORM_THROW("No datamodel '" + std::string(machine->datamodel != NULL ? machine->datamodel : "null") + "' registered");
+	}
+}
+
+NativeSession::~NativeSession() {
+	NativeEventPool& pool = _runtime->_pool;
+	if (_current != NULL)
+		pool.release(_current);
+	pool.release(_internal);
+	pool.release(_external);
+	pool.release(_incoming);
+}
+
+bool NativeSession::isInState(const std::string& stateId) {
+	for (size_t i = 0; i < _ctx.machine->nr_states; i++) {
+		if (_ctx.machine->states[i].name &&
+		        strcmp(_ctx.machine->states[i].name, stateId.c_str()) == 0 &&
+		        BIT_HAS(i, _ctx.config)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const std::map<std::string, IOProcessor>& NativeSession::getIOProcessors() {
+	Extras* x = extras();
+	if (!x->hasIOProcs) {
+		std::map<std::string, IOProcessorImpl*> allIOProcs = Factory::getInstance().getIOProcessors();
+		for (auto ioProcImpl : allIOProcs) {
+			x->ioProcs[ioProcImpl.first] = Factory::getInstance().createIOProcessor(ioProcImpl.first, this);
+			std::list<std::string> names = ioProcImpl.second->getNames();
+			for (auto name : names) {
+				x->ioProcs[name] = x->ioProcs[ioProcImpl.first];
+			}
+		}
+		x->hasIOProcs = true;
+	}
+	return x->ioProcs;
+}
+
+const std::map<std::string, Invoker>& NativeSession::getInvokers() {
+	static std::map<std::string, Invoker> noInvokers;
+	if (!_extras)
+		return noInvokers;
+	return _extras->invokers;
+}
+
+void NativeSession::enqueueInternal(const Event& event) {
+	// might be called from another thread, routed by the stepping one
+	NativeEvent* pooled = _runtime->_pool.acquire(event);
+	pooled->target = "#_internal";
+	if (pushIncoming(pooled))
+		_runtime->schedule(this);
+}
+
+void NativeSession::enqueueExternal(const Event& event) {
+	NativeEvent* pooled = _runtime->_pool.acquire(event);
+	pooled->event.eventType = Event::EXTERNAL;
+	if (pushExternal(pooled))
+		_runtime->schedule(this);
+}
+
+void NativeSession::enqueueAtInvoker(const std::string& invokeId, const Event& event) {
+	route(_runtime->_pool.acquire(event), "#_" + invokeId);
+}
+
+void NativeSession::enqueueAtParent(const Event& event) {
+	route(_runtime->_pool.acquire(event), "#_parent");
+}
+
+int NativeSession::step() {
+	int err = uscxml_step(&_ctx);
+	if (err == USCXML_ERR_OK)
+		_nrMicroSteps++;
+	return err;
+}
+
+bool NativeSession::pushExternal(NativeEvent* event) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_external.push(event);
+	if (_state == IDLE) {
+		_state = QUEUED;
+		return true;
+	}
+	return false;
+}
+
+bool NativeSession::pushIncoming(NativeEvent* event) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_incoming.push(event);
+	_hasIncoming = true;
+	if (_state == IDLE) {
+		_state = QUEUED;
+		return true;
+	}
+	return false;
+}
+
+void NativeSession::route(NativeEvent* event, const std::string& target) {
+	NativeEventPool& pool = _runtime->_pool;
+	Event& e = event->event;
+
+	if (target == "#_internal") {
+		e.eventType = (e.name.find("error.") == 0 ? Event::PLATFORM : Event::INTERNAL);
+		_internal.push(event);
+		return;
+	}
+
+	if (e.origintype.size() > 0 && e.origintype != SCXML_IO_PROCESSOR) {
+		// sent via another I/O processor
+		std::string type = e.origintype;
+		const std::map<std::string, IOProcessor>& ioProcs = getIOProcessors();
+		try {
+			if (ioProcs.find(type) != ioProcs.end()) {
+				IOProcessor ioProc = ioProcs.find(type)->second;
+				ioProc.eventFromSCXML(target, e);
+			}
+		} catch (Event exc) {
+			raise("error.communication");
+		}
+		pool.release(event);
+		return;
+	}
+
+	e.eventType = Event::EXTERNAL;
+	if (target.size() == 0 || target == "#_external") {
+		if (pushExternal(event))
+			_runtime->schedule(this);
+		return;
+	}
+
+	std::string sessionId;
+	if (target == "#_parent") {
+		if (_invocation)
+			sessionId = _invocation->parentId;
+	} else if (target.find("#_scxml_") == 0) {
+		sessionId = target.substr(8);
+	} else if (target.find("#_") == 0 && _extras) {
+		std::string invokeId = target.substr(2);
+		auto child = _extras->children.find(invokeId);
+		if (child != _extras->children.end()) {
+			sessionId = child->second.first;
+		} else if (_extras->invokers.find(invokeId) != _extras->invokers.end()) {
+			try {
+				_extras->invokers[invokeId].eventFromSCXML(e);
+			} catch (Event exc) {
+				raise("error.communication");
+			}
+			pool.release(event);
+			return;
+		}
+	}
+
+	if (sessionId.size() > 0 && _runtime->deliver(sessionId, event))
+		return;
+
+	// test496
+	pool.release(event);
+	raise("error.communication");
+}
+
+void NativeSession::raise(const std::string& name) {
+	NativeEvent* event = _runtime->_pool.acquire();
+	event->event.name = name;
+	event->event.eventType = (name.find("error.") == 0 ? Event::PLATFORM : Event::INTERNAL);
+	_internal.push(event);
+}
+
+NativeSession::Extras* NativeSession::extras() {
+	if (!_extras)
+		_extras.reset(new Extras());
+	return _extras.get();
+}
+
+void* NativeSession::dequeueInternal(const uscxml_ctx* ctx) {
+	NativeSession* session = USER_DATA(ctx);
+
+	if (session->_hasIncoming) {
+		NativeEventQueue incoming;
+		{
+			std::lock_guard<std::mutex> lock(session->_mutex);
+			incoming.append(session->_incoming);
+			session->_hasIncoming = false;
+		}
+		while(NativeEvent* event = incoming.pop()) {
+			std::string target = event->target;
+			session->route(event, target);
+		}
+	}
+
+	NativeEvent* event = session->_internal.pop();
+	if (event == NULL)
+		return NULL;
+
+	// the previous event is not referenced by the machine anymore
+	if (session->_current != NULL)
+		session->_runtime->_pool.release(session->_current);
+	session->_current = event;
+
+	try {
+		session->_dataModel.setEvent(event->event);
+	} catch (Event e) {
+		LOG(session->getLogger(), USCXML_ERROR) << "Cannot set _event: " << e << std::endl;
+	}
+	return &event->event;
+}
+
+void* NativeSession::dequeueExternal(const uscxml_ctx* ctx) {
+	NativeSession* session = USER_DATA(ctx);
+
+	NativeEvent* event = NULL;
+	{
+		std::lock_guard<std::mutex> lock(session->_mutex);
+		event = session->_external.pop();
+	}
+	if (event == NULL)
+		return NULL;
+
+	if (session->_current != NULL)
+		session->_runtime->_pool.release(session->_current);
+	session->_current = event;
+
+	const Event& e = event->event;
+	try {
+		session->_dataModel.setEvent(e);
+	} catch (Event exc) {
+		LOG(session->getLogger(), USCXML_ERROR) << "Cannot set _event: " << exc << std::endl;
+	}
+
+	if (session->_extras) {
+		// we need to check for finalize content
+		if (e.invokeid.size() > 0) {
+			auto child = session->_extras->children.find(e.invokeid);
+			if (child != session->_extras->children.end() && child->second.second->finalize != NULL)
+				child->second.second->finalize(ctx, child->second.second, &e);
+		}
+
+		// auto forward event
+		for (auto& child : session->_extras->children) {
+			if (child.second.second->autoforward) {
+				NativeEvent* forward = session->_runtime->_pool.acquire(e);
+				if (!session->_runtime->deliver(child.second.first, forward))
+					session->_runtime->_pool.release(forward);
+			}
+		}
+	}
+
+	return &event->event;
+}
+
+int NativeSession::isMatched(const uscxml_ctx* ctx, const uscxml_transition* t, const void* e) {
+	const Event* event = (const Event*)e;
+	return nameMatch(t->event, event->name);
+}
+
+int NativeSession::eventId(const uscxml_ctx* ctx, const void* e) {
+	const Event* event = (const Event*)e;
+	return uscxml_event_id(ctx->machine, event->name.c_str());
+}
+
+int NativeSession::isTrue(const uscxml_ctx* ctx, const char* expr) {
+	try {
+		return USER_DATA(ctx)->_dataModel.evalAsBool(expr);
+	} catch (Event e) {
+		USER_DATA(ctx)->raise(e.name.size() > 0 ? e.name : "error.execution");
+	}
+	return false;
+}
+
+int NativeSession::raiseDoneEvent(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata) {
+	NativeSession* session = USER_DATA(ctx);
+	NativeEvent* event = session->_runtime->_pool.acquire();
+	Event& e = event->event;
+	e.name = std::string("done.state.") + state->name;
+
+	if (donedata) {
+		try {
+			if (donedata->content != NULL) {
+				if (isNumeric(donedata->content, 10)) {
+					// test 529
+					e.data = Data(strTo<double>(donedata->content), Data::INTERPRETED);
+				} else {
+					e.data = Data(donedata->content, Data::VERBATIM);
+				}
+			} else if (donedata->contentexpr != NULL) {
+				e.data = session->_dataModel.getAsData(donedata->contentexpr);
+			} else {
+				const uscxml_elem_param* param = donedata->params;
+				while (param && USCXML_ELEM_PARAM_IS_SET(param)) {
+					Data paramValue;
+					if (param->expr != NULL) {
+						paramValue = session->_dataModel.evalAsData(param->expr);
+					} else if(param->location) {
+						paramValue = session->_dataModel.evalAsData(param->location);
+					}
+					e.params.insert(std::make_pair(param->name, paramValue));
+					param++;
+				}
+			}
+		} catch (Event exc) {
+			session->raise(exc.name.size() > 0 ? exc.name : "error.execution");
+		}
+	}
+
+	e.eventType = Event::INTERNAL;
+	session->_internal.push(event);
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke) {
+	NativeSession* session = USER_DATA(ctx);
+
+	if (uninvoke) {
+		if (!session->_extras)
+			return USCXML_ERR_OK;
+
+		Extras* x = session->_extras.get();
+		auto invokeIdIter = x->invokeIds.find(invocation);
+		if (invokeIdIter == x->invokeIds.end())
+			return USCXML_ERR_OK;
+
+		std::string invokeId = invokeIdIter->second;
+		x->invokeIds.erase(invokeIdIter);
+
+		auto child = x->children.find(invokeId);
+		if (child != x->children.end()) {
+			std::string childId = child->second.first;
+			x->children.erase(child);
+			session->_runtime->cancel(childId);
+		}
+
+		auto invoker = x->invokers.find(invokeId);
+		if (invoker != x->invokers.end()) {
+			try {
+				invoker->second.uninvoke();
+			} catch (Event e) {
+				LOG(session->getLogger(), USCXML_ERROR) << "Cannot uninvoke " << invokeId << ": " << e << std::endl;
+			}
+			x->invokers.erase(invoker);
+		}
+		return USCXML_ERR_OK;
+	}
+
+	if (invocation->machine == NULL && (invocation->type == NULL || !Factory::getInstance().hasInvoker(invocation->type)))
+		return USCXML_ERR_UNSUPPORTED;
+
+	std::string invokeId;
+	try {
+		if (invocation->id != NULL) {
+			invokeId = invocation->id;
+		} else if (invocation->idlocation != NULL) {
+			// test224
+			invokeId = (invocation->sourcename != NULL ? std::string(invocation->sourcename) + "." : "") + UUID::getUUID();
+			session->_dataModel.assign(invocation->idlocation, Data(invokeId, Data::VERBATIM));
+		} else {
+			invokeId = UUID::getUUID();
+		}
+
+		Extras* x = session->extras();
+		if (invocation->machine != NULL) {
+			// invoke a nested SCXML machine, it runs concurrently from here on
+			std::string childId = session->_runtime->invoke(session, invocation, invokeId);
+			x->children[invokeId] = std::make_pair(childId, invocation);
+		} else {
+			Event invokeEvent(""); // see BasicContentExecutor::384ff
+			invokeEvent.invokeid = invokeId;
+			const uscxml_elem_param* param = invocation->params;
+			while (param && USCXML_ELEM_PARAM_IS_SET(param)) {
+				invokeEvent.params.insert(std::make_pair(param->name,
+				                          session->_dataModel.evalAsData(param->expr != NULL ? param->expr : param->location)));
+				param++;
+			}
+			if (invocation->namelist != NULL) {
+				std::list<std::string> names = tokenize(invocation->namelist);
+				for (auto& name : names) {
+					invokeEvent.namelist[name] = session->_dataModel.evalAsData(name);
+				}
+			}
+			if (invocation->content != NULL)
+				invokeEvent.data = Data(spaceNormalize(invocation->content), Data::VERBATIM);
+
+			std::string source;
+			if (invocation->src != NULL) {
+				source = invocation->src;
+			} else if (invocation->srcexpr != NULL) {
+				source = session->_dataModel.evalAsData(invocation->srcexpr).atom;
+			}
+
+			Invoker invoker = Factory::getInstance().createInvoker(invocation->type, session);
+			invoker.invoke(source, invokeEvent);
+			x->invokers[invokeId] = invoker;
+		}
+		x->invokeIds[invocation] = invokeId;
+
+	} catch (Event e) {
+		session->raise("error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentSend(const uscxml_ctx* ctx, const uscxml_elem_send* send) {
+	NativeSession* session = USER_DATA(ctx);
+	NativeEventPool& pool = session->_runtime->_pool;
+	NativeEvent* event = pool.acquire();
+	Event& e = event->event;
+
+	std::string target;
+	size_t delayMs = 0;
+
+	try {
+		if (send->id != NULL) {
+			e.sendid = send->id;
+		} else {
+			e.sendid = UUID::getUUID();
+			if (send->idlocation != NULL) {
+				session->_dataModel.assign(send->idlocation, Data(e.sendid, Data::VERBATIM));
+			} else {
+				e.hideSendId = true;
+			}
+		}
+
+		if (send->target != NULL) {
+			target = send->target;
+		} else if (send->targetexpr != NULL) {
+			target = session->_dataModel.evalAsData(send->targetexpr).atom;
+		}
+
+		std::string type;
+		if (send->type != NULL) {
+			type = send->type;
+		} else if (send->typeexpr != NULL) {
+			type = session->_dataModel.evalAsData(send->typeexpr).atom;
+		}
+		if (type.size() == 0 || type == "scxml")
+			type = SCXML_IO_PROCESSOR;
+
+		if (type == SCXML_IO_PROCESSOR) {
+			if (target.size() > 0 && (target.size() < 2 || target[0] != '#' || target[1] != '_')) {
+				pool.release(event);
+				session->raise("error.execution");
+				return USCXML_ERR_INVALID_TARGET;
+			}
+		} else if (session->getIOProcessors().find(type) == session->getIOProcessors().end()) {
+			pool.release(event);
+			session->raise("error.execution");
+			return USCXML_ERR_INVALID_TARGET;
+		}
+
+		e.origintype = type;
+		e.origin = "#_scxml_" + session->_sessionId;
+		if (session->_invocation) {
+			// test 228
+			e.invokeid = session->_invocation->invokeId;
+		}
+
+		if (send->eventexpr != NULL) {
+			e.name = session->_dataModel.evalAsData(send->eventexpr).atom;
+		} else if (send->event != NULL) {
+			e.name = send->event;
+		}
+
+		const uscxml_elem_param* param = send->params;
+		while (param && USCXML_ELEM_PARAM_IS_SET(param)) {
+			Data paramValue;
+			if (param->expr != NULL) {
+				paramValue = session->_dataModel.evalAsData(param->expr);
+			} else if(param->location) {
+				paramValue = session->_dataModel.evalAsData(param->location);
+			}
+			e.params.insert(std::make_pair(param->name, paramValue));
+			param++;
+		}
+
+		if (send->namelist != NULL) {
+			std::list<std::string> names = tokenize(send->namelist);
+			for (auto& name : names) {
+				e.namelist[name] = session->_dataModel.evalAsData(name);
+			}
+		}
+
+		if (send->content != NULL) {
+			try {
+				// will it parse as json?
+				Data d = session->_dataModel.getAsData(send->content);
+				if (!d.empty()) {
+					e.data = d;
+				}
+			} catch (Event err) {
+				e.data = Data(spaceNormalize(send->content), Data::VERBATIM);
+			}
+		}
+
+		std::string delay;
+		if (send->delayexpr != NULL) {
+			delay = session->_dataModel.evalAsData(send->delayexpr).atom;
+		}
+		if (delay.size() > 0) {
+			NumAttr delayAttr(delay);
+			if (iequals(delayAttr.unit, "ms")) {
+				delayMs = strTo<uint32_t>(delayAttr.value);
+			} else if (iequals(delayAttr.unit, "s")) {
+				delayMs = strTo<double>(delayAttr.value) * 1000;
+			} else if (delayAttr.unit.length() == 0) { // unit less delay is interpreted as milliseconds
+				delayMs = strTo<uint32_t>(delayAttr.value);
+			} else {
+				LOG(session->getLogger(), USCXML_ERROR) << "Cannot make sense of delay value " << delay << ": does not end in 's' or 'ms'" << std::endl;
+			}
+		} else if (send->delay > 0) {
+			delayMs = send->delay;
+		}
+
+	} catch (Event exc) {
+		pool.release(event);
+		session->raise("error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+
+	if (delayMs > 0) {
+		event->target = target;
+		std::string sendId = e.sendid;
+		session->_runtime->delay(session, event, delayMs, sendId);
+	} else {
+		session->route(event, target);
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentRaise(const uscxml_ctx* ctx, const char* event) {
+	USER_DATA(ctx)->raise(event);
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentCancel(const uscxml_ctx* ctx, const char* sendid, const char* sendidexpr) {
+	NativeSession* session = USER_DATA(ctx);
+	std::string sendId;
+	try {
+		if (sendid != NULL) {
+			sendId = sendid;
+		} else if (sendidexpr != NULL) {
+			sendId = session->_dataModel.evalAsData(sendidexpr).atom;
+		}
+	} catch (Event e) {
+		session->raise("error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+
+	if (sendId.length() == 0) {
+		session->raise("error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+
+	session->_runtime->cancelDelayed(session, sendId);
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentLog(const uscxml_ctx* ctx, const char* label, const char* expr) {
+	NativeSession* session = USER_DATA(ctx);
+	try {
+		Data d;
+		if (expr != NULL)
+			d = session->_dataModel.evalAsData(expr);
+		session->getLogger().log(USCXML_LOG) << (label != NULL ? label : "") << (label != NULL && expr != NULL ? ": " : "") << d << std::endl;
+	} catch (Event e) {
+		session->raise(e.name.size() > 0 ? e.name : "error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentAssign(const uscxml_ctx* ctx, const uscxml_elem_assign* assign) {
+	NativeSession* session = USER_DATA(ctx);
+	std::string key = assign->location;
+	if (key == "_sessionid" || key == "_name" || key == "_ioprocessors" || key == "_invokers" || key == "_event") {
+		session->raise("error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+
+	try {
+		if (assign->expr != NULL) {
+			session->_dataModel.assign(key, Data(assign->expr, Data::INTERPRETED));
+		} else if (assign->content != NULL) {
+			session->_dataModel.assign(key, Data(assign->content, Data::INTERPRETED));
+		}
+	} catch (Event e) {
+		session->raise(e.name.size() > 0 ? e.name : "error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentForeachInit(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach) {
+	NativeSession* session = USER_DATA(ctx);
+	try {
+		Foreach info;
+		info.foreach = foreach;
+		info.iterations = session->_dataModel.getLength(foreach->array);
+		info.iteration = 0;
+		session->_foreach.push_back(info);
+	} catch (Event e) {
+		session->raise(e.name.size() > 0 ? e.name : "error.execution");
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentForeachNext(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach) {
+	NativeSession* session = USER_DATA(ctx);
+	// foreach elements nest, the innermost one is iterated
+	if (session->_foreach.empty() || session->_foreach.back().foreach != foreach)
+		return USCXML_ERR_FOREACH_DONE;
+
+	Foreach& info = session->_foreach.back();
+	try {
+		if (info.iteration < info.iterations) {
+			session->_dataModel.setForeach((foreach->item != NULL ? foreach->item : ""),
+			                               (foreach->array != NULL ? foreach->array : ""),
+			                               (foreach->index != NULL ? foreach->index : ""),
+			                               info.iteration);
+			info.iteration++;
+			return USCXML_ERR_OK;
+		}
+	} catch (Event e) {
+		session->raise(e.name.size() > 0 ? e.name : "error.execution");
+		session->_foreach.pop_back();
+		return USCXML_ERR_EXEC_CONTENT;
+	}
+	return USCXML_ERR_FOREACH_DONE;
+}
+
+int NativeSession::execContentForeachDone(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach) {
+	NativeSession* session = USER_DATA(ctx);
+	if (!session->_foreach.empty() && session->_foreach.back().foreach == foreach)
+		session->_foreach.pop_back();
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentInit(const uscxml_ctx* ctx, const uscxml_elem_data* data) {
+	NativeSession* session = USER_DATA(ctx);
+	while(USCXML_ELEM_DATA_IS_SET(data)) {
+		if (session->_invocation && session->_invocation->data.find(data->id) != session->_invocation->data.end()) {
+			// passed via param or namelist: test245
+			try {
+				session->_dataModel.init(data->id, session->_invocation->data[data->id]);
+			} catch (Event e) {
+				session->raise(e.name.size() > 0 ? e.name : "error.execution");
+			}
+		} else {
+			Data d;
+			std::string content;
+
+			try {
+				if (data->expr != NULL) {
+					d = Data(data->expr, Data::INTERPRETED);
+
+				} else if (data->content != NULL) {
+					content = data->content;
+					/**
+					 * first attempt to parse as structured data, we will try
+					 * as space normalized string literals if this fails below
+					 */
+					d = session->_dataModel.getAsData(content);
+					if (d.empty()) {
+						d = Data(escape(spaceNormalize(content)), Data::VERBATIM);
+					}
+				} else {
+					// leave d undefined, src is not supported without URL
+				}
+				// this might fail with an unquoted string literal in content
+				session->_dataModel.init(data->id, d);
+
+			} catch (Event e) {
+				if (content.size() > 0) {
+					try {
+						d = Data(escape(spaceNormalize(content)), Data::VERBATIM);
+						session->_dataModel.init(data->id, d);
+					} catch (Event e) {
+						session->raise(e.name.size() > 0 ? e.name : "error.execution");
+					}
+				} else {
+					session->raise(e.name.size() > 0 ? e.name : "error.execution");
+				}
+			}
+		}
+		data++;
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeSession::execContentScript(const uscxml_ctx* ctx, const char* src, const char* content) {
+	NativeSession* session = USER_DATA(ctx);
+	if (content != NULL) {
+		try {
+			session->_dataModel.eval(content);
+		} catch (Event e) {
+			session->raise(e.name.size() > 0 ? e.name : "error.execution");
+			return USCXML_ERR_EXEC_CONTENT;
+		}
+	} else if (src != NULL) {
+		return USCXML_ERR_UNSUPPORTED;
+	}
+	return USCXML_ERR_OK;
+}
+
+}
@@ -0,0 +1,197 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef NATIVESESSION_H_64A0E3D9
+#define NATIVESESSION_H_64A0E3D9
+
+#include "uscxml/Common.h"
+#include "uscxml/native/NativeRuntime.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/DataModel.h"
+#include "uscxml/plugins/DataModelImpl.h"
+#include "uscxml/plugins/IOProcessor.h"
+#include "uscxml/plugins/IOProcessorImpl.h"
+#include "uscxml/plugins/Invoker.h"
+#include "uscxml/plugins/InvokerImpl.h"
+
+#include <atomic>
+#include <memory>
+
+namespace uscxml {
+
+/**
+ * @ingroup impl
+ * A running instance of a generated machine, the host of its uscxml_ctx.
+ *
+ * The context comes first and everything touched per microstep right after
+ * it, data only needed by invoked sessions or sessions with invokers and
+ * I/O processors is allocated on demand. Only the thread stepping the
+ * session touches its internal queue and invocations, other threads hand
+ * events over via the external and the incoming queue.
+ */
+class USCXML_API NativeSession : public DataModelCallbacks, public IOProcessorCallbacks, public InvokerCallbacks {
+public:
+	const std::string& getName() {
+		return _name;
+	}
+	const std::string& getSessionId() {
+		return _sessionId;
+	}
+
+	const uscxml_ctx* getContext() {
+		return &_ctx;
+	}
+	const uscxml_machine* getMachine() {
+		return _ctx.machine;
+	}
+	DataModel& getDataModel() {
+		return _dataModel;
+	}
+
+	bool isInState(const std::string& stateId);
+	/// Reached a top-level final state and exited all states
+	bool isFinished() {
+		return (_ctx.flags & USCXML_CTX_FINISHED) != 0;
+	}
+	/// Microsteps taken so far
+	uint64_t getNrMicroSteps() {
+		return _nrMicroSteps;
+	}
+
+	// DataModelCallbacks / IOProcessorCallbacks / InvokerCallbacks
+	const std::map<std::string, IOProcessor>& getIOProcessors();
+	const std::map<std::string, Invoker>& getInvokers();
+	XERCESC_NS::DOMDocument* getDocument() const {
+		return NULL;
+	}
+	Logger getLogger() {
+		return Logger::getDefault();
+	}
+
+	void enqueueInternal(const Event& event);
+	void enqueueExternal(const Event& event);
+	void enqueueAtInvoker(const std::string& invokeId, const Event& event);
+	void enqueueAtParent(const Event& event);
+
+	ActionLanguage* getActionLanguage() {
+		return NULL;
+	}
+	std::set<InterpreterMonitor*> getMonitors() {
+		return std::set<InterpreterMonitor*>();
+	}
+	std::string getBaseURL() {
+		return "";
+	}
+	Factory* getFactory() {
+		return &Factory::getInstance();
+	}
+
+protected:
+	enum State {
+		IDLE,
+		QUEUED,
+		RUNNING,
+		FINISHED ///< never scheduled again
+	};
+
+	struct Foreach {
+		const uscxml_elem_foreach* foreach;
+		uint32_t iterations;
+		uint32_t iteration;
+	};
+
+	/// Only allocated for invoked sessions
+	struct Invocation {
+		const uscxml_elem_invoke* invocation;
+		std::string invokeId;
+		std::string parentId;
+		std::map<std::string, Data> data;
+	};
+
+	/// Only allocated for sessions that invoke or use I/O processors
+	struct Extras {
+		std::map<std::string, std::pair<std::string, const uscxml_elem_invoke*> > children; ///< session id and element per invokeid
+		std::map<const uscxml_elem_invoke*, std::string> invokeIds;
+		std::map<std::string, Invoker> invokers;
+		std::map<std::string, IOProcessor> ioProcs;
+		bool hasIOProcs = false;
+	};
+
+	NativeSession(NativeRuntime* runtime, const uscxml_machine* machine, NativeSession* parent, const uscxml_elem_invoke* invocation);
+	virtual ~NativeSession();
+
+	int step();
+
+	/// Push an event handed over by another thread, true if the session has to be scheduled
+	bool pushExternal(NativeEvent* event);
+	bool pushIncoming(NativeEvent* event);
+
+	/// Deliver an event sent from this session, only ever called by the stepping thread
+	void route(NativeEvent* event, const std::string& target);
+	void raise(const std::string& name);
+	Extras* extras();
+
+	// callbacks for the uscxml_ctx
+	static void* dequeueInternal(const uscxml_ctx* ctx);
+	static void* dequeueExternal(const uscxml_ctx* ctx);
+	static int isMatched(const uscxml_ctx* ctx, const uscxml_transition* t, const void* e);
+	static int eventId(const uscxml_ctx* ctx, const void* e);
+	static int isTrue(const uscxml_ctx* ctx, const char* expr);
+	static int raiseDoneEvent(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata);
+	static int invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke);
+	static int execContentLog(const uscxml_ctx* ctx, const char* label, const char* expr);
+	static int execContentRaise(const uscxml_ctx* ctx, const char* event);
+	static int execContentSend(const uscxml_ctx* ctx, const uscxml_elem_send* send);
+	static int execContentForeachInit(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach);
+	static int execContentForeachNext(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach);
+	static int execContentForeachDone(const uscxml_ctx* ctx, const uscxml_elem_foreach* foreach);
+	static int execContentAssign(const uscxml_ctx* ctx, const uscxml_elem_assign* assign);
+	static int execContentInit(const uscxml_ctx* ctx, const uscxml_elem_data* data);
+	static int execContentCancel(const uscxml_ctx* ctx, const char* sendid, const char* sendidexpr);
+	static int execContentScript(const uscxml_ctx* ctx, const char* src, const char* content);
+
+	uscxml_ctx _ctx;
+	NativeRuntime* _runtime;
+	NativeEvent* _current = NULL; ///< recycled with the next event dequeued
+	NativeEventQueue _internal;
+	std::atomic<bool> _hasIncoming;
+	DataModel _dataModel;
+	std::vector<Foreach> _foreach;
+	uint64_t _nrMicroSteps = 0;
+
+	std::mutex _mutex; ///< guards the following
+	NativeEventQueue _external;
+	NativeEventQueue _incoming; ///< expired delayed sends and internal events from other threads, still to be routed
+	State _state = IDLE;
+	bool _isCancelled = false;
+	bool _isDone = false;
+
+	NativeTimerWheel::Timer* _timers = NULL; ///< guarded by the runtime
+	std::unique_ptr<Invocation> _invocation;
+	std::unique_ptr<Extras> _extras;
+	std::string _sessionId;
+	std::string _name;
+
+	friend class NativeRuntime;
+	friend class NativeTimerWheel;
+};
+
+}
+
+#endif /* end of include guard: NATIVESESSION_H_64A0E3D9 */
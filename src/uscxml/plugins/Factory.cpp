@@ -623,6 +623,20 @@ void IOProcessorImpl::eventToSCXML(Event& event,
 	}
 }
 
+void IOProcessorImpl::eventsToSCXML(std::list<Event>& events,
+                                    const std::string& type,
+                                    const std::string& origin) {
+	for (auto& event : events) {
+		if (event.eventType == 0)
+			event.eventType = Event::EXTERNAL;
+		if (event.origin.length() == 0 && origin.length() > 0)
+			event.origin = origin;
+		if (event.origintype.length() == 0)
+			event.origintype = type;
+	}
+	_callbacks->enqueueExternalBatch(events);
+}
+
 void InvokerImpl::eventToSCXML(Event& event,
                                const std::string& type,
                                const std::string& invokeId,
@@ -40,6 +40,10 @@ public:
 	virtual const std::string& getSessionId() = 0;
 	virtual void enqueueInternal(const Event& event) = 0;
 	virtual void enqueueExternal(const Event& event) = 0;
+	virtual void enqueueExternalBatch(const std::list<Event>& events) {
+		for (auto& event : events)
+			enqueueExternal(event);
+	}
 	virtual void enqueueAtInvoker(const std::string& invokeId, const Event& event) = 0;
 	virtual void enqueueAtParent(const Event& event) = 0;
 	virtual Logger getLogger() = 0;
@@ -85,6 +89,14 @@ protected:
 	 */
 	void eventToSCXML(Event& event, const std::string& type, const std::string& origin, bool internal = false);
 
+	/**
+	 * Return several events to the external queue of the SCXML Interpreter at once.
+	 * @param events The events to enqueue in order, their origin and type are completed as with eventToSCXML.
+	 * @param type The type of this I/O Processor for `event.origintype`.
+	 * @param origin The origin of this I/O Processor for `event.origin`.
+	 */
+	void eventsToSCXML(std::list<Event>& events, const std::string& type, const std::string& origin);
+
 	IOProcessorCallbacks* _callbacks;
 };
 
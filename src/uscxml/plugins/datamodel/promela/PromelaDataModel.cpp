@@ -42,6 +42,35 @@ name.compare("_event") == 0
 
 namespace uscxml {
 
+std::map<std::string, std::shared_ptr<PromelaParser> > PromelaDataModel::_astCache;
+std::mutex PromelaDataModel::_astCacheMutex;
+
+// same atoms as Data(int) / Data(bool) without going through a stringstream
+static inline Data intData(int value) {
+	Data data;
+	data.atom = std::to_string(value);
+	return data;
+}
+
+static inline Data verbatimData(const std::string& value) {
+	Data data;
+	data.atom = value;
+	data.type = Data::VERBATIM;
+	return data;
+}
+
+static inline Data boolData(bool value) {
+	Data data;
+	data.atom = (value ? "1" : "0");
+	return data;
+}
+
+static void expectSyntaxType(const PromelaParser& parser, PromelaParser::Type expected) {
+	if (parser.type != expected) {
+		ERROR_EXECUTION_THROW("Promela syntax type mismatch: Expected {" + PromelaParser::typeToDesc(expected) + "} but got " + PromelaParser::typeToDesc(parser.type));
+	}
+}
+
 #ifdef BUILD_AS_PLUGINS
 PLUMA_CONNECTOR
 bool pluginConnect(pluma::Host& host) {
@@ -191,9 +220,260 @@ void PromelaDataModel::setEvent(const Event& event) {
 
 	}
 
+	std::shared_ptr<PromelaParser> PromelaDataModel::parse(const std::string& expr) {
+		{
+			std::lock_guard<std::mutex> lock(_astCacheMutex);
+			auto astIter = _astCache.find(expr);
+			if (astIter != _astCache.end())
+				return astIter->second;
+		}
+
+		// parse outside the lock, a failed parse throws and is not cached
+		std::shared_ptr<PromelaParser> parser(new PromelaParser(expr));
+
+		std::lock_guard<std::mutex> lock(_astCacheMutex);
+		if (_astCache.size() >= PROMELA_AST_CACHE_SIZE)
+			_astCache.clear(); // callers hold their own references
+		_astCache[expr] = parser;
+		return parser;
+	}
+
+	std::shared_ptr<PromelaDataModel::CompiledExpr> PromelaDataModel::compiled(const std::string& expr) {
+		auto exprIter = _exprCache.find(expr);
+		if (exprIter != _exprCache.end())
+			return exprIter->second;
+
+		std::shared_ptr<CompiledExpr> compiledExpr(new CompiledExpr());
+		compiledExpr->parser = parse(expr);
+		compiledExpr->isCompiled = false;
+		if (compiledExpr->parser->type == PromelaParser::PROMELA_EXPR) {
+			compile(compiledExpr->parser->ast, compiledExpr->program);
+			compiledExpr->isCompiled = true;
+		}
+
+		if (_exprCache.size() >= PROMELA_EXPR_CACHE_SIZE)
+			_exprCache.clear();
+		_exprCache[expr] = compiledExpr;
+		return compiledExpr;
+	}
+
+	size_t PromelaDataModel::slotFor(const std::string& name) {
+		auto slotIter = _slotIndex.find(name);
+		if (slotIter != _slotIndex.end())
+			return slotIter->second;
+
+		size_t slot = _slots.size();
+		_slotIndex[name] = slot;
+		_slotNames.push_back(name);
+		_slots.push_back(NULL);
+		return slot;
+	}
+
+	Data& PromelaDataModel::slotValue(size_t slot) {
+		return slotVariable(slot)["value"];
+	}
+
+	Data& PromelaDataModel::slotVariable(size_t slot) {
+		if (_slots[slot] == NULL) {
+			// resolve lazily, variables might be declared after an expression was compiled
+			auto varIter = _variables.compound.find(_slotNames[slot]);
+			if (varIter == _variables.compound.end()) {
+				ERROR_EXECUTION_THROW("No variable " + _slotNames[slot] + " was declared");
+			}
+			// nodes in std::map are stable and variables are never erased
+			_slots[slot] = &varIter->second;
+		}
+		return *_slots[slot];
+	}
+
+	void PromelaDataModel::compile(void* ast, std::vector<Instruction>& program) {
+		PromelaParserNode* node = (PromelaParserNode*)ast;
+
+		Instruction instr;
+		instr.op = node->type;
+		instr.slot = 0;
+		instr.literal = false;
+		instr.node = node;
+
+		switch (node->type) {
+		case PML_CONST:
+			if (iequals(node->value, "false")) {
+				instr.constant = Data(false);
+			} else if (iequals(node->value, "true")) {
+				instr.constant = Data(true);
+			} else {
+				instr.constant = Data(strTo<int>(node->value));
+			}
+			break;
+		case PML_STRING:
+			instr.op = PML_CONST;
+			instr.constant = Data(node->value.substr(1, node->value.size() - 2), Data::VERBATIM);
+			break;
+		case PML_NAME:
+			instr.slot = slotFor(node->value);
+			break;
+		case PML_VAR_ARRAY:
+			if (node->operands.size() != 2 || node->operands.front()->type != PML_NAME) {
+				instr.op = 0;
+				break;
+			}
+			instr.slot = slotFor(node->operands.front()->value);
+			compile(node->operands.back(), program);
+			break;
+		case PML_NEG:
+			if (node->operands.size() != 1) {
+				instr.op = 0;
+				break;
+			}
+			compile(node->operands.front(), program);
+			break;
+		case PML_EQ:
+		case PML_PLUS:
+		case PML_MINUS:
+		case PML_DIVIDE:
+		case PML_MODULO:
+		case PML_LT:
+		case PML_LE:
+		case PML_GT:
+		case PML_GE:
+		case PML_TIMES:
+		case PML_LSHIFT:
+		case PML_RSHIFT:
+		case PML_AND:
+		case PML_OR:
+			if (node->operands.size() != 2) {
+				instr.op = 0;
+				break;
+			}
+			instr.literal = (node->operands.front()->type == PML_STRING || node->operands.back()->type == PML_STRING);
+			compile(node->operands.front(), program);
+			compile(node->operands.back(), program);
+			break;
+		default:
+			// compounds, assignments and anything unsupported are evaluated from the AST
+			instr.op = 0;
+			break;
+		}
+		program.push_back(instr);
+	}
+
+	Data PromelaDataModel::execute(const CompiledExpr& expr) {
+		if (!expr.isCompiled)
+			return evaluateExpr(expr.parser->ast);
+
+		// the stack is shared, AST fallbacks may recurse into execute
+		size_t base = _stack.size();
+		try {
+			for (auto instrIter = expr.program.begin(); instrIter != expr.program.end(); instrIter++) {
+				const Instruction& instr = *instrIter;
+				switch (instr.op) {
+				case 0:
+					_stack.push_back(evaluateExpr(instr.node));
+					break;
+				case PML_CONST:
+					_stack.push_back(instr.constant);
+					break;
+				case PML_NAME: {
+					const Data& d = slotValue(instr.slot);
+					if (d.atom.size() != 0 && isNumeric(d.atom.c_str(), 10)) {
+						// fixes issue 127
+						_stack.push_back(verbatimData(d.atom));
+					} else {
+						_stack.push_back(verbatimData(d.asJSON()));
+					}
+					break;
+				}
+				case PML_VAR_ARRAY: {
+					int index = dataToInt(_stack.back());
+					const std::string& name = _slotNames[instr.slot];
+					Data& var = slotVariable(instr.slot);
+					if (!var.hasKey("size")) {
+						ERROR_EXECUTION_THROW("Variable " + name + " is no array");
+					}
+					if (strTo<int>(var["size"].atom) <= index) {
+						ERROR_EXECUTION_THROW("Index " + toStr(index) + " in array " + name + "[" + var["size"].atom + "] is out of bounds");
+					}
+					_stack.back() = var.compound["value"][index];
+					break;
+				}
+				case PML_NEG:
+					_stack.back() = boolData(!dataToBool(_stack.back()));
+					break;
+				default: {
+					Data right = _stack.back();
+					_stack.pop_back();
+					Data& left = _stack.back();
+
+					switch (instr.op) {
+					case PML_EQ:
+						if (left == right) { // overloaded operator==
+							left = boolData(true);
+						} else if (instr.literal || (left.type == Data::VERBATIM && right.type == Data::VERBATIM)) {
+							// literal strings or strings in variables
+							left = (left.atom.compare(right.atom) == 0 ? boolData(true) : boolData(false));
+						} else {
+							left = boolData(dataToInt(left) == dataToInt(right));
+						}
+						break;
+					case PML_PLUS:
+						left = intData(dataToInt(left) + dataToInt(right));
+						break;
+					case PML_MINUS:
+						left = intData(dataToInt(left) - dataToInt(right));
+						break;
+					case PML_DIVIDE:
+						left = intData(dataToInt(left) / dataToInt(right));
+						break;
+					case PML_MODULO:
+						left = intData(dataToInt(left) % dataToInt(right));
+						break;
+					case PML_LT:
+						left = boolData(dataToInt(left) < dataToInt(right));
+						break;
+					case PML_LE:
+						left = boolData(dataToInt(left) <= dataToInt(right));
+						break;
+					case PML_GT:
+						left = boolData(dataToInt(left) > dataToInt(right));
+						break;
+					case PML_GE:
+						left = boolData(dataToInt(left) >= dataToInt(right));
+						break;
+					case PML_TIMES:
+						left = intData(dataToInt(left) * dataToInt(right));
+						break;
+					case PML_LSHIFT:
+						left = intData(dataToInt(left) << dataToInt(right));
+						break;
+					case PML_RSHIFT:
+						left = intData(dataToInt(left) >> dataToInt(right));
+						break;
+					case PML_AND:
+						left = boolData(dataToBool(left) && dataToBool(right));
+						break;
+					case PML_OR:
+						left = boolData(dataToBool(left) || dataToBool(right));
+						break;
+					default:
+						ERROR_EXECUTION_THROW("Support for " + PromelaParserNode::typeToDesc(instr.op) + " expressions not implemented");
+					}
+				}
+				}
+			}
+		} catch (...) {
+			_stack.resize(base);
+			throw;
+		}
+
+		assert(_stack.size() == base + 1);
+		Data result = _stack.back();
+		_stack.resize(base);
+		return result;
+	}
+
 	bool PromelaDataModel::isValidSyntax(const std::string& expr) {
 		try {
-			PromelaParser parser(expr);
+			parse(expr);
 		} catch (Event e) {
 			LOG(_callbacks->getLogger(), USCXML_ERROR) << e << std::endl;
 			return false;
@@ -218,42 +498,61 @@ void PromelaDataModel::setEvent(const Event& event) {
 	                                  const std::string& index,
 	                                  uint32_t iteration) {
 		// assign array element to item
-		std::stringstream ss;
-		ss << array << "[" << iteration << "]";
-
-		PromelaParser itemParser(item, 1, PromelaParser::PROMELA_EXPR);
-		if (itemParser.ast->type != PML_NAME)
+		std::shared_ptr<PromelaParser> itemParser = parse(item);
+		expectSyntaxType(*itemParser, PromelaParser::PROMELA_EXPR);
+		if (itemParser->ast->type != PML_NAME)
 			ERROR_EXECUTION_THROW("Expression '" + item + "' is no valid item");
 
-		PromelaParser arrayParser(ss.str(), 1, PromelaParser::PROMELA_EXPR);
+		std::shared_ptr<PromelaParser> arrayParser = parse(array);
+		expectSyntaxType(*arrayParser, PromelaParser::PROMELA_EXPR);
+
+		Data element;
+		if (arrayParser->ast->type == PML_NAME) {
+			// index the array directly instead of parsing "array[iteration]" every time
+			const std::string& name = arrayParser->ast->value;
+			if (_variables.compound.find(name) == _variables.compound.end()) {
+				ERROR_EXECUTION_THROW("No variable " + name + " was declared");
+			}
+			if (!_variables[name].hasKey("size")) {
+				ERROR_EXECUTION_THROW("Variable " + name + " is no array");
+			}
+			if (strTo<uint32_t>(_variables[name]["size"].atom) <= iteration) {
+				ERROR_EXECUTION_THROW("Index " + toStr(iteration) + " in array " + name + "[" + _variables[name]["size"].atom + "] is out of bounds");
+			}
+			element = _variables.compound[name].compound["value"][iteration];
+		} else {
+			std::stringstream ss;
+			ss << array << "[" << iteration << "]";
+			PromelaParser elementParser(ss.str(), 1, PromelaParser::PROMELA_EXPR);
+			element = getVariable(elementParser.ast);
+		}
 
 		try {
-			setVariable(itemParser.ast, getVariable(arrayParser.ast));
+			setVariable(itemParser->ast, element);
 		} catch (ErrorEvent e) {
 			// test150
-			PromelaParser itemDeclParser("int " + item); // this is likely the wrong type
-			evaluateDecl(itemDeclParser.ast);
-			setVariable(itemParser.ast, getVariable(arrayParser.ast));
+			evaluateDecl(parse("int " + item)->ast); // this is likely the wrong type
+			setVariable(itemParser->ast, element);
 		}
 
 		if (index.length() > 0) {
-			PromelaParser indexParser(index, 1, PromelaParser::PROMELA_EXPR);
+			std::shared_ptr<PromelaParser> indexParser = parse(index);
+			expectSyntaxType(*indexParser, PromelaParser::PROMELA_EXPR);
 			try {
-				setVariable(indexParser.ast, Data(iteration));
+				setVariable(indexParser->ast, Data(iteration));
 			} catch (ErrorEvent e) {
 				// test150
-				PromelaParser indexDeclParser("int " + index);
-				evaluateDecl(indexDeclParser.ast);
-				setVariable(indexParser.ast, Data(iteration));
+				evaluateDecl(parse("int " + index)->ast);
+				setVariable(indexParser->ast, Data(iteration));
 			}
 		}
 
 	}
 
 	bool PromelaDataModel::evalAsBool(const std::string& expr) {
-		PromelaParser parser(expr, 1, PromelaParser::PROMELA_EXPR);
-//	parser.dump();
-		Data tmp = evaluateExpr(parser.ast);
+		std::shared_ptr<CompiledExpr> compiledExpr = compiled(expr);
+		expectSyntaxType(*compiledExpr->parser, PromelaParser::PROMELA_EXPR);
+		Data tmp = execute(*compiledExpr);
 
 		if (tmp.atom.compare("false") == 0)
 			return false;
@@ -263,8 +562,8 @@ void PromelaDataModel::setEvent(const Event& event) {
 	}
 
 	Data PromelaDataModel::evalAsData(const std::string& expr) {
-		PromelaParser parser(expr);
-		return evaluateExpr(parser.ast);
+		std::shared_ptr<CompiledExpr> compiledExpr = compiled(expr);
+		return execute(*compiledExpr);
 	}
 
 	Data PromelaDataModel::getAsData(const std::string& content) {
@@ -276,18 +575,21 @@ void PromelaDataModel::setEvent(const Event& event) {
 	}
 
 	void PromelaDataModel::evaluateDecl(const std::string& expr) {
-		PromelaParser parser(expr, 1, PromelaParser::PROMELA_DECL);
-		evaluateDecl(parser.ast);
+		std::shared_ptr<PromelaParser> parser = parse(expr);
+		expectSyntaxType(*parser, PromelaParser::PROMELA_DECL);
+		evaluateDecl(parser->ast);
 	}
 
 	Data PromelaDataModel::evaluateExpr(const std::string& expr) {
-		PromelaParser parser(expr, 1, PromelaParser::PROMELA_EXPR);
-		return evaluateExpr(parser.ast);
+		std::shared_ptr<CompiledExpr> compiledExpr = compiled(expr);
+		expectSyntaxType(*compiledExpr->parser, PromelaParser::PROMELA_EXPR);
+		return execute(*compiledExpr);
 	}
 
 	void PromelaDataModel::evaluateStmnt(const std::string& expr) {
-		PromelaParser parser(expr, 1, PromelaParser::PROMELA_STMNT);
-		evaluateStmnt(parser.ast);
+		std::shared_ptr<PromelaParser> parser = parse(expr);
+		expectSyntaxType(*parser, PromelaParser::PROMELA_STMNT);
+		evaluateStmnt(parser->ast);
 	}
 
 	void PromelaDataModel::evaluateDecl(void* ast) {
@@ -370,6 +672,20 @@ void PromelaDataModel::setEvent(const Event& event) {
 	int PromelaDataModel::dataToInt(const Data& data) {
 //		if (data.type != Data::INTERPRETED)
 //			ERROR_EXECUTION_THROW("Operand is not integer");
+
+		// fast path for canonical decimals that survive the round-trip below
+		const std::string& atom = data.atom;
+		size_t start = (atom.size() > 1 && atom[0] == '-' ? 1 : 0);
+		if (start < atom.size() && atom.size() - start <= 9 && (atom[start] != '0' || atom.size() == 1)) {
+			int fast = 0;
+			size_t i = start;
+			for (; i < atom.size() && atom[i] >= '0' && atom[i] <= '9'; i++) {
+				fast = fast * 10 + (atom[i] - '0');
+			}
+			if (i == atom.size())
+				return (start > 0 ? -fast : fast);
+		}
+
 		int value = strTo<int>(data.atom);
 		if (data.atom.compare(toStr(value)) != 0)
 			ERROR_EXECUTION_THROW("Operand is not integer");
@@ -429,6 +745,8 @@ void PromelaDataModel::setEvent(const Event& event) {
 		case PML_PLUS:
 			return Data(dataToInt(evaluateExpr(*opIter++)) + dataToInt(evaluateExpr(*opIter++)));
 		case PML_MINUS:
+			if (node->operands.size() == 1)
+				return Data(-dataToInt(evaluateExpr(*opIter++)));
 			return Data(dataToInt(evaluateExpr(*opIter++)) - dataToInt(evaluateExpr(*opIter++)));
 		case PML_DIVIDE:
 			return Data(dataToInt(evaluateExpr(*opIter++)) / dataToInt(evaluateExpr(*opIter++)));
@@ -705,11 +1023,11 @@ void PromelaDataModel::setEvent(const Event& event) {
 	}
 
 	void PromelaDataModel::assign(const std::string& location, const Data& data, const std::map<std::string, std::string>& attr) {
-		PromelaParser parser(location);
+		std::shared_ptr<PromelaParser> parser = parse(location);
 		if (data.atom.size() > 0 && data.type == Data::INTERPRETED) {
-			setVariable(parser.ast, evalAsData(data.atom));
+			setVariable(parser->ast, evalAsData(data.atom));
 		} else {
-			setVariable(parser.ast, data);
+			setVariable(parser->ast, data);
 		}
 	}
 
@@ -724,34 +1042,31 @@ void PromelaDataModel::setEvent(const Event& event) {
 				type = type.substr(0, bracketPos);
 			}
 
-			std::string expr = type + " " + location + arrSize;
-			PromelaParser parser(expr, 1, PromelaParser::PROMELA_DECL);
-			evaluateDecl(parser.ast);
+			evaluateDecl(type + " " + location + arrSize);
 		}
 
-		PromelaParser parser(location);
+		std::shared_ptr<PromelaParser> parser = parse(location);
 		if (data.atom.size() > 0 && data.type == Data::INTERPRETED) {
 			Data d = Data::fromJSON(data);
 			if (!d.empty())
-				setVariable(parser.ast, Data::fromJSON(data));
-			setVariable(parser.ast, data);
+				setVariable(parser->ast, Data::fromJSON(data));
+			setVariable(parser->ast, data);
 		} else {
-			setVariable(parser.ast, data);
+			setVariable(parser->ast, data);
 		}
 	}
 
 	bool PromelaDataModel::isDeclared(const std::string& expr) {
-		PromelaParser parser(expr);
-//	parser.dump();
-		if (parser.ast->type == PML_VAR_ARRAY)
-			return _variables.compound.find(parser.ast->operands.front()->value) != _variables.compound.end();
+		std::shared_ptr<PromelaParser> parser = parse(expr);
+		if (parser->ast->type == PML_VAR_ARRAY)
+			return _variables.compound.find(parser->ast->operands.front()->value) != _variables.compound.end();
 
-		if (parser.ast->type == PML_CMPND) {
+		if (parser->ast->type == PML_CMPND) {
 			// JSON declaration
-			std::list<PromelaParserNode*>::iterator opIter = parser.ast->operands.begin();
+			std::list<PromelaParserNode*>::iterator opIter = parser->ast->operands.begin();
 			Data* var = &_variables;
 
-			while(opIter != parser.ast->operands.end()) {
+			while(opIter != parser->ast->operands.end()) {
 				std::string name = (*opIter)->value;
 				opIter++;
 				if (var->compound.find(name) != var->compound.end()) {
@@ -23,13 +23,28 @@
 #include "uscxml/config.h"
 #include "uscxml/plugins/DataModelImpl.h"
 #include <list>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
 
 #ifdef BUILD_AS_PLUGINS
 #include "uscxml/plugins/Plugins.h"
 #endif
 
+// parsed ASTs are shared process-wide, compiled programs are per session
+#ifndef PROMELA_AST_CACHE_SIZE
+#define PROMELA_AST_CACHE_SIZE 4096
+#endif
+
+#ifndef PROMELA_EXPR_CACHE_SIZE
+#define PROMELA_EXPR_CACHE_SIZE 1024
+#endif
+
 namespace uscxml {
 
+class PromelaParser;
+
 class PromelaDataModel : public DataModelImpl {
 public:
 	PromelaDataModel();
@@ -87,6 +102,42 @@ protected:
 
 	void adaptType(Data& data);
 
+	/**
+	 * A parsed expression lowered into a postfix stack program. Variable names are
+	 * resolved to slot indices into _slots, the AST is kept for unsupported nodes.
+	 */
+	struct Instruction {
+		int op; ///< PML_* node type, PML_CONST for literals, 0 to evaluate node as AST
+		size_t slot;
+		bool literal;
+		Data constant;
+		void* node;
+	};
+
+	struct CompiledExpr {
+		std::shared_ptr<PromelaParser> parser;
+		std::vector<Instruction> program;
+		bool isCompiled;
+	};
+
+	std::shared_ptr<PromelaParser> parse(const std::string& expr);
+	std::shared_ptr<CompiledExpr> compiled(const std::string& expr);
+	void compile(void* ast, std::vector<Instruction>& program);
+	Data execute(const CompiledExpr& expr);
+
+	size_t slotFor(const std::string& name);
+	Data& slotValue(size_t slot);
+	Data& slotVariable(size_t slot);
+
+	std::map<std::string, std::shared_ptr<CompiledExpr> > _exprCache;
+	std::map<std::string, size_t> _slotIndex;
+	std::vector<std::string> _slotNames;
+	std::vector<Data*> _slots;
+	std::vector<Data> _stack;
+
+	static std::map<std::string, std::shared_ptr<PromelaParser> > _astCache;
+	static std::mutex _astCacheMutex;
+
 	int _lastMType;
 
 	Event _event;
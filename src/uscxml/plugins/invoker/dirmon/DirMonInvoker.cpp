@@ -30,6 +30,14 @@
 #include <strsafe.h>
 #endif
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define DIRMON_INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#endif
+
 #include <boost/algorithm/string.hpp>
 #include "uscxml/interpreter/Logging.h"
 #include "uscxml/util/URL.h"
@@ -48,6 +56,7 @@ DirMonInvoker::DirMonInvoker() :
 	_reportExisting(true),
 	_reportHidden(false),
 	_recurse(false),
+	_poll(false),
 	_thread(NULL),
 	_watcher(NULL) {
 }
@@ -112,6 +121,9 @@ void DirMonInvoker::invoke(const std::string& source, const Event& req) {
 	if (req.params.find("reporthidden") != req.params.end() &&
 	        iequals(req.params.find("reporthidden")->second.atom, "true"))
 		_reportHidden = true;
+	if (req.params.find("poll") != req.params.end() &&
+	        iequals(req.params.find("poll")->second.atom, "true"))
+		_poll = true;
 
 	std::string suffixList;
 	if (req.params.find("suffix") != req.params.end()) {
@@ -149,6 +161,10 @@ void DirMonInvoker::invoke(const std::string& source, const Event& req) {
 	_watcher->addMonitor(this);
 	_watcher->updateEntries(true);
 
+	if (!_poll && !_watcher->startNotifications()) {
+		LOG(_callbacks->getLogger(), USCXML_INFO) << "No change notifications for '" << _dir << "', polling instead" << std::endl;
+	}
+
 	_isRunning = true;
 	_thread = new std::thread(DirMonInvoker::run, this);
 }
@@ -158,14 +174,24 @@ void DirMonInvoker::uninvoke() {
 	if (_thread) {
 		_thread->join();
 		delete _thread;
+		_thread = NULL;
 	}
 }
 
 void DirMonInvoker::run(void* instance) {
-	while(((DirMonInvoker*)instance)->_isRunning) {
+	DirMonInvoker* INSTANCE = (DirMonInvoker*)instance;
+	while(INSTANCE->_isRunning) {
+		if (INSTANCE->_watcher->hasNotifications()) {
+			// wake up regularly to notice uninvocation
+			if (INSTANCE->_watcher->waitForNotifications(20)) {
+				std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
+				INSTANCE->_watcher->processNotifications();
+			}
+			continue;
+		}
 		{
-			std::lock_guard<std::recursive_mutex> lock(((DirMonInvoker*)instance)->_mutex);
-			((DirMonInvoker*)instance)->_watcher->updateEntries();
+			std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
+			INSTANCE->_watcher->updateEntries();
 		}
 		std::this_thread::sleep_for(std::chrono::milliseconds(20));
 	}
@@ -276,6 +302,20 @@ void DirMonInvoker::handleChanges(DirectoryWatch::Action action, const std::stri
 	eventToSCXML(event, "dimon", "");
 }
 
+/**
+ * Whether the entry was modified since we last saw it, use sub-second
+ * precision where available.
+ */
+static bool isNewer(const struct stat& oldStat, const struct stat& newStat) {
+#ifdef __linux__
+	if (oldStat.st_mtim.tv_sec != newStat.st_mtim.tv_sec)
+		return oldStat.st_mtim.tv_sec < newStat.st_mtim.tv_sec;
+	return oldStat.st_mtim.tv_nsec < newStat.st_mtim.tv_nsec;
+#else
+	return oldStat.st_mtime < newStat.st_mtime;
+#endif
+}
+
 DirectoryWatch::~DirectoryWatch() {
 	std::map<std::string, DirectoryWatch*>::iterator dirIter = _knownDirs.begin();
 	while(dirIter != _knownDirs.end()) {
@@ -283,6 +323,248 @@ DirectoryWatch::~DirectoryWatch() {
 		dirIter++;
 	}
 
+#ifdef __linux__
+	if (_wd >= 0 && _root && _root != this && _root->_inotifyFd >= 0) {
+		_root->_watches.erase(_wd);
+		inotify_rm_watch(_root->_inotifyFd, _wd);
+	}
+	if (_inotifyFd >= 0)
+		close(_inotifyFd);
+#endif
+}
+
+bool DirectoryWatch::startNotifications() {
+#ifdef __linux__
+	if (_root != this)
+		return false;
+	if (_inotifyFd >= 0)
+		return true;
+
+	_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotifyFd < 0) {
+		LOG(_logger, USCXML_WARN) << "Cannot initialize inotify: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	if (!watch()) {
+		stopNotifications();
+		return false;
+	}
+
+	// catch everything that happened before we established the watches
+	updateEntries();
+	return hasNotifications();
+#else
+	return false;
+#endif
+}
+
+void DirectoryWatch::stopNotifications() {
+#ifdef __linux__
+	if (_root->_inotifyFd < 0)
+		return;
+
+	// closing the instance removes all watches with the kernel
+	close(_root->_inotifyFd);
+	_root->_inotifyFd = -1;
+
+	std::map<int, DirectoryWatch*>::iterator watchIter = _root->_watches.begin();
+	while(watchIter != _root->_watches.end()) {
+		watchIter->second->_wd = -1;
+		watchIter++;
+	}
+	_root->_watches.clear();
+#endif
+}
+
+bool DirectoryWatch::watch() {
+#ifdef __linux__
+	if (!_root || _root->_inotifyFd < 0)
+		return false;
+
+	_wd = inotify_add_watch(_root->_inotifyFd, (_dir + _relDir).c_str(), DIRMON_INOTIFY_MASK);
+	if (_wd < 0) {
+		// most likely fs.inotify.max_user_watches is exhausted
+		LOG(_logger, USCXML_WARN) << "Cannot watch directory " << _dir + _relDir << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	_root->_watches[_wd] = this;
+
+	if (_recurse) {
+		std::map<std::string, DirectoryWatch*>::iterator dirIter = _knownDirs.begin();
+		while(dirIter != _knownDirs.end()) {
+			if (!dirIter->second->watch())
+				return false;
+			dirIter++;
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool DirectoryWatch::waitForNotifications(int timeoutMs) {
+#ifdef __linux__
+	if (_inotifyFd < 0)
+		return false;
+
+	struct pollfd pfd;
+	pfd.fd = _inotifyFd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return (poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN));
+#else
+	return false;
+#endif
+}
+
+void DirectoryWatch::processNotifications() {
+#ifdef __linux__
+	if (_inotifyFd < 0)
+		return;
+
+	// coalesce all pending events per directory and entry
+	std::map<int, std::set<std::string> > changes;
+	bool overflow = false;
+
+	char buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+	while((length = read(_inotifyFd, buffer, sizeof(buffer))) > 0) {
+		char* ptr = buffer;
+		while(ptr < buffer + length) {
+			const struct inotify_event* event = (const struct inotify_event*)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				overflow = true;
+				continue;
+			}
+			if (event->mask & IN_IGNORED) {
+				// watched directory is gone, the kernel dropped the watch
+				std::map<int, DirectoryWatch*>::iterator watchIter = _watches.find(event->wd);
+				if (watchIter != _watches.end()) {
+					watchIter->second->_wd = -1;
+					_watches.erase(watchIter);
+				}
+				continue;
+			}
+			if (event->len == 0)
+				continue; // event on the watched directory itself, reported with its parent
+
+			changes[event->wd].insert(event->name);
+		}
+	}
+
+	if (overflow) {
+		// we lost events, fall back to a full scan
+		LOG(_logger, USCXML_WARN) << "Lost change notifications for " << _dir << ", rescanning" << std::endl;
+		invalidate();
+		updateEntries();
+		return;
+	}
+
+	std::map<int, std::set<std::string> >::iterator changeIter = changes.begin();
+	while(changeIter != changes.end()) {
+		// directory might have been removed with an earlier entry
+		std::map<int, DirectoryWatch*>::iterator watchIter = _watches.find(changeIter->first);
+		if (watchIter != _watches.end()) {
+			DirectoryWatch* watch = watchIter->second;
+			std::set<std::string>::iterator nameIter = changeIter->second.begin();
+			while(nameIter != changeIter->second.end()) {
+				watch->updateEntry(*nameIter);
+				nameIter++;
+			}
+		}
+		changeIter++;
+	}
+#endif
+}
+
+void DirectoryWatch::invalidate() {
+	_lastChecked = 0;
+	std::map<std::string, DirectoryWatch*>::iterator dirIter = _knownDirs.begin();
+	while(dirIter != _knownDirs.end()) {
+		dirIter->second->invalidate();
+		dirIter++;
+	}
+}
+
+void DirectoryWatch::report(Action action, const std::string& dname, const struct stat& fileStat) {
+	_monitors_t::iterator monIter = _monitors.begin();
+	while(monIter != _monitors.end()) {
+		(*monIter)->handleChanges(action, _dir, _relDir + PATH_SEPERATOR + dname, fileStat);
+		monIter++;
+	}
+}
+
+DirectoryWatch* DirectoryWatch::addDirectory(const std::string& dname) {
+	DirectoryWatch* subDir = new DirectoryWatch(_dir, _relDir + PATH_SEPERATOR + dname);
+	subDir->_root = _root;
+	subDir->_logger = _logger;
+	_knownDirs[dname] = subDir;
+
+	_monitors_t::iterator monIter = _monitors.begin();
+	while(monIter != _monitors.end()) {
+		subDir->addMonitor(*monIter);
+		monIter++;
+	}
+
+	if (_root->hasNotifications() && _root->_recurse) {
+		if (!subDir->watch()) {
+			// we can no longer rely on notifications
+			stopNotifications();
+		}
+	}
+	return subDir;
+}
+
+void DirectoryWatch::updateEntry(const std::string& dname) {
+	if (dname.length() == 0 || dname == "." || dname == "..")
+		return;
+
+	std::string filename = _dir + _relDir + "/" + dname;
+	std::map<std::string, struct stat>::iterator entryIter = _knownEntries.find(dname);
+
+	struct stat fileStat;
+	if (stat(filename.c_str(), &fileStat) != 0) {
+		if (entryIter == _knownEntries.end())
+			return; // created and removed before we had a look
+
+		// we used to know this entry
+		if (entryIter->second.st_mode & S_IFDIR) {
+			std::map<std::string, DirectoryWatch*>::iterator dirIter = _knownDirs.find(dname);
+			if (dirIter != _knownDirs.end()) {
+				if (_recurse)
+					dirIter->second->reportAsDeleted();
+				delete dirIter->second;
+				_knownDirs.erase(dirIter);
+			}
+		} else {
+			report(DELETED, dname, entryIter->second);
+		}
+		_knownEntries.erase(entryIter);
+		return;
+	}
+
+	if (entryIter != _knownEntries.end()) {
+		// we have seen this entry before
+		if (isNewer(entryIter->second, fileStat)) {
+			report(MODIFIED, dname, fileStat);
+		}
+		entryIter->second = fileStat;
+		return;
+	}
+
+	_knownEntries[dname] = fileStat;
+	if (fileStat.st_mode & S_IFDIR) {
+		DirectoryWatch* subDir = addDirectory(dname);
+		// report whatever was created in the directory before we watched it
+		if (_recurse)
+			subDir->updateEntries();
+	} else {
+		report(ADDED, dname, fileStat);
+	}
 }
 
 void DirectoryWatch::reportAsDeleted() {
@@ -368,7 +650,7 @@ void DirectoryWatch::updateEntries(bool reportAsExisting) {
 			if (_knownEntries.find(dname) != _knownEntries.end()) {
 				// we have seen this entry before
 				struct stat oldStat = _knownEntries[dname];
-				if (oldStat.st_mtime < fileStat.st_mtime) {
+				if (isNewer(oldStat, fileStat)) {
 					monIter = _monitors.begin();
 					while(monIter != _monitors.end()) {
 						(*monIter)->handleChanges(MODIFIED, _dir, _relDir + PATH_SEPERATOR + dname, fileStat);
@@ -378,12 +660,7 @@ void DirectoryWatch::updateEntries(bool reportAsExisting) {
 			} else {
 				// we have not yet seen this entry
 				if (fileStat.st_mode & S_IFDIR) {
-					_knownDirs[dname] = new DirectoryWatch(_dir, _relDir + PATH_SEPERATOR + dname);
-					monIter = _monitors.begin();
-					while(monIter != _monitors.end()) {
-						_knownDirs[dname]->addMonitor(*monIter);
-						monIter++;
-					}
+					addDirectory(dname);
 				} else {
 					monIter = _monitors.begin();
 					while(monIter != _monitors.end()) {
@@ -47,7 +47,7 @@ public:
 		EXISTING = 8
 	};
 
-	DirectoryWatch(const std::string& dir, bool recurse = false) : _dir(dir), _recurse(recurse), _lastChecked(0) {}
+	DirectoryWatch(const std::string& dir, bool recurse = false) : _dir(dir), _recurse(recurse), _lastChecked(0), _root(this), _inotifyFd(-1), _wd(-1) {}
 	~DirectoryWatch();
 
 	void addMonitor(DirectoryWatchMonitor* monitor) {
@@ -59,6 +59,20 @@ public:
 	void updateEntries(bool reportAsExisting = false);
 	void reportAsDeleted();
 
+	/**
+	 * Have the kernel notify us about changes instead of scanning the whole tree,
+	 * only available with inotify on Linux. Call after the initial updateEntries().
+	 * @return Whether notifications are available, keep polling otherwise.
+	 */
+	bool startNotifications();
+	bool hasNotifications() {
+		return _inotifyFd >= 0;
+	}
+	/// Block for at most timeoutMs milliseconds until changes are pending
+	bool waitForNotifications(int timeoutMs);
+	/// Report all pending changes to the monitors, coalesced per entry
+	void processNotifications();
+
 	std::map<std::string, struct stat> getAllEntries() {
 		std::map<std::string, struct stat> entries;
 		entries.insert(_knownEntries.begin(), _knownEntries.end());
@@ -82,7 +96,15 @@ public:
 	}
 
 protected:
-	DirectoryWatch(const std::string& dir, const std::string& relDir) : _dir(dir), _relDir(relDir), _recurse(true), _lastChecked(0) {}
+	DirectoryWatch(const std::string& dir, const std::string& relDir) : _dir(dir), _relDir(relDir), _recurse(true), _lastChecked(0), _root(NULL), _inotifyFd(-1), _wd(-1) {}
+
+	void updateEntry(const std::string& dname);
+	DirectoryWatch* addDirectory(const std::string& dname);
+	void report(Action action, const std::string& dname, const struct stat& fileStat);
+	void invalidate();
+
+	bool watch();
+	void stopNotifications();
 
 	std::string _dir;
 	std::string _relDir;
@@ -94,6 +116,11 @@ protected:
 	std::set<DirectoryWatchMonitor*> _monitors;
 	typedef std::set<DirectoryWatchMonitor*> _monitors_t;
 	time_t _lastChecked;
+
+	DirectoryWatch* _root; ///< the watch for the monitored directory itself
+	int _inotifyFd; ///< only set at the root
+	int _wd; ///< our watch descriptor with the root's inotify instance
+	std::map<int, DirectoryWatch*> _watches; ///< all watch descriptors, only at the root
 };
 
 class DirectoryWatchMonitor {
@@ -128,6 +155,7 @@ protected:
 	bool _reportExisting;
 	bool _reportHidden;
 	bool _recurse;
+	bool _poll;
 
 	std::string _dir;
 	std::set<std::string> _suffixes;
@@ -0,0 +1,257 @@
+/**
+ *  @file
+ *  @author     2012-2013 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "ChartTemplateCache.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/URL.h"
+#include "uscxml/util/MD5.hpp"
+#include "uscxml/util/Convenience.h"
+
+#include <xercesc/dom/DOM.hpp>
+
+#include <sys/stat.h>
+
+namespace uscxml {
+
+// user data key to recognize inline content elements we already cached
+static const X kXMLCharChartTemplate = X("uscxml::chartTemplate");
+static const X kXMLNSNamespace = X("http://www.w3.org/2000/xmlns/");
+
+ChartTemplateCache& ChartTemplateCache::getInstance() {
+	static ChartTemplateCache instance;
+	return instance;
+}
+
+/// Modification time and size of a local file, empty if there is no such file
+static std::string fileValidator(const std::string& path) {
+	struct stat fileStat;
+	if (stat(path.c_str(), &fileStat) != 0)
+		return "";
+#ifdef __linux__
+	return toStr(fileStat.st_mtim.tv_sec) + "." + toStr(fileStat.st_mtim.tv_nsec) + ":" + toStr(fileStat.st_size);
+#else
+	return toStr(fileStat.st_mtime) + ":" + toStr(fileStat.st_size);
+#endif
+}
+
+ChartTemplateCache::ChartTemplateCache() :
+	_maxSize(USCXML_CHART_CACHE_DEFAULT_SIZE),
+	_remoteTTL(USCXML_CHART_CACHE_DEFAULT_REMOTE_TTL),
+	_nextElementId(1) {
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.evictions = 0;
+	_stats.size = 0;
+}
+
+Interpreter ChartTemplateCache::fromURL(const std::string& url) {
+	if (envVarIsTrue("USCXML_NOCACHE_INVOKERS"))
+		return Interpreter::fromURL(url);
+
+	// same normalization as in Interpreter::fromURL
+	URL absUrl(url);
+	if (absUrl.scheme() == "" || !absUrl.isAbsolute()) {
+		absUrl = URL::resolveWithCWD(absUrl);
+	}
+	if (absUrl.scheme() == "") {
+		absUrl = URL("file://" + url);
+	}
+	std::string absUrlStr = absUrl;
+	std::string key = "url:" + absUrlStr;
+
+	if (absUrl.scheme() != "file") {
+		// we cannot tell whether remote documents changed without fetching them, do so after a while
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			if (lookup(key))
+				return instantiate(key, absUrlStr);
+		}
+
+		// a slow server must not hold up the invocations of every other chart
+		XERCESC_NS::DOMDocument* document = InterpreterImpl::parseXML(absUrl.getInContent(true));
+
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		insert(key, document, "", true);
+		return instantiate(key, absUrlStr);
+	}
+
+	// local files are parsed again once their modification time or size changed
+	std::string validator = fileValidator(absUrl.path());
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (validator.size() > 0 && lookup(key, validator))
+			return instantiate(key, absUrlStr);
+	}
+
+	XERCESC_NS::DOMDocument* document = InterpreterImpl::parseXML(absUrl.getInContent());
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	insert(key, document, validator);
+	return instantiate(key, absUrlStr);
+}
+
+Interpreter ChartTemplateCache::fromElement(XERCESC_NS::DOMElement* element, const std::string& baseURL) {
+	if (envVarIsTrue("USCXML_NOCACHE_INVOKERS"))
+		return Interpreter::fromElement(element, baseURL);
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	/**
+	 * The element pointer itself might be reused once its document is gone, but
+	 * xerces drops user data with the node, so the id is only found on the very
+	 * element we cached.
+	 */
+	size_t elementId = (size_t)element->getUserData(kXMLCharChartTemplate);
+	if (elementId == 0) {
+		elementId = _nextElementId++;
+		element->setUserData(kXMLCharChartTemplate, (void*)elementId, NULL);
+	}
+
+	std::string key = "element:" + toStr(elementId);
+	if (!lookup(key)) {
+		XERCESC_NS::DOMImplementation* implementation = XERCESC_NS::DOMImplementationRegistry::getDOMImplementation(X("core"));
+		XERCESC_NS::DOMDocument* document = implementation->createDocument();
+
+		// we need to import the parent - to support xpath test150
+		XERCESC_NS::DOMElement* newElement = static_cast<XERCESC_NS::DOMElement*>(document->importNode(element, true));
+		document->appendChild(newElement);
+
+		/**
+		 * Inline content relies on the namespace declarations of the invoking document,
+		 * copy the ones in scope that the chart does not declare itself.
+		 */
+		for (XERCESC_NS::DOMNode* ancestor = element->getParentNode();
+		        ancestor && ancestor->getNodeType() == XERCESC_NS::DOMNode::ELEMENT_NODE;
+		        ancestor = ancestor->getParentNode()) {
+			XERCESC_NS::DOMNamedNodeMap* attrs = ancestor->getAttributes();
+			for (size_t i = 0; i < attrs->getLength(); i++) {
+				XERCESC_NS::DOMNode* attr = attrs->item(i);
+				if (!XERCESC_NS::XMLString::equals(attr->getNamespaceURI(), kXMLNSNamespace))
+					continue;
+				if (newElement->hasAttributeNS(kXMLNSNamespace, attr->getLocalName()))
+					continue;
+				newElement->setAttributeNS(kXMLNSNamespace, attr->getNodeName(), attr->getNodeValue());
+			}
+		}
+		insert(key, document);
+	}
+	return instantiate(key, baseURL);
+}
+
+Interpreter ChartTemplateCache::fromXML(const std::string& xml, const std::string& baseURL) {
+	if (envVarIsTrue("USCXML_NOCACHE_INVOKERS"))
+		return Interpreter::fromXML(xml, baseURL);
+
+	std::string key = "xml:" + md5(xml);
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (!lookup(key))
+		insert(key, InterpreterImpl::parseXML(xml));
+	return instantiate(key, baseURL);
+}
+
+void ChartTemplateCache::setMaxSize(size_t maxSize) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_maxSize = maxSize;
+	while (_templates.size() > _maxSize)
+		evict();
+}
+
+void ChartTemplateCache::setRemoteTTL(size_t ms) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_remoteTTL = ms;
+}
+
+void ChartTemplateCache::clear() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (auto tmplIter = _templates.begin(); tmplIter != _templates.end(); tmplIter++) {
+		delete tmplIter->second.document;
+	}
+	_templates.clear();
+	_lru.clear();
+	_stats.size = 0;
+}
+
+ChartTemplateCache::Stats ChartTemplateCache::getStats() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _stats;
+}
+
+XERCESC_NS::DOMDocument* ChartTemplateCache::lookup(const std::string& key, const std::string& validator) {
+	auto tmplIter = _templates.find(key);
+	if (tmplIter == _templates.end()) {
+		_stats.misses++;
+		return NULL;
+	}
+
+	const Template& tmpl = tmplIter->second;
+	if (tmpl.validator != validator ||
+	        (tmpl.remote && std::chrono::steady_clock::now() - tmpl.fetched >= std::chrono::milliseconds(_remoteTTL))) {
+		remove(tmplIter);
+		_stats.misses++;
+		return NULL;
+	}
+
+	// move to the front of the lru list
+	_lru.splice(_lru.begin(), _lru, tmpl.lruPos);
+	_stats.hits++;
+	return tmpl.document;
+}
+
+void ChartTemplateCache::insert(const std::string& key, XERCESC_NS::DOMDocument* document, const std::string& validator, bool remote) {
+	// another thread might have parsed the same document while we did
+	auto tmplIter = _templates.find(key);
+	if (tmplIter != _templates.end())
+		remove(tmplIter);
+
+	_lru.push_front(key);
+	Template& tmpl = _templates[key];
+	tmpl.document = document;
+	tmpl.lruPos = _lru.begin();
+	tmpl.validator = validator;
+	tmpl.remote = remote;
+	tmpl.fetched = std::chrono::steady_clock::now();
+
+	while (_templates.size() > _maxSize && _templates.size() > 1)
+		evict();
+	_stats.size = _templates.size();
+}
+
+void ChartTemplateCache::remove(std::map<std::string, Template>::iterator tmplIter) {
+	delete tmplIter->second.document;
+	_lru.erase(tmplIter->second.lruPos);
+	_templates.erase(tmplIter);
+	_stats.size = _templates.size();
+}
+
+void ChartTemplateCache::evict() {
+	if (_lru.empty())
+		return;
+
+	remove(_templates.find(_lru.back()));
+	_stats.evictions++;
+}
+
+Interpreter ChartTemplateCache::instantiate(const std::string& key, const std::string& baseURL) {
+	// copy while we hold the lock, an eviction would delete the template underneath us
+	return Interpreter::fromDocument(_templates[key].document, baseURL, true);
+}
+
+}
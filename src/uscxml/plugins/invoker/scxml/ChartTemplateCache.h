@@ -0,0 +1,108 @@
+/**
+ *  @file
+ *  @author     2012-2013 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef CHARTTEMPLATECACHE_H_5C3A2E71
+#define CHARTTEMPLATECACHE_H_5C3A2E71
+
+#include "uscxml/Common.h"
+#include "uscxml/Interpreter.h"
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+// forward declare
+namespace XERCESC_NS {
+class DOMDocument;
+class DOMElement;
+}
+
+#define USCXML_CHART_CACHE_DEFAULT_SIZE 64
+#define USCXML_CHART_CACHE_DEFAULT_REMOTE_TTL 60000
+
+namespace uscxml {
+
+/**
+ * @ingroup invoker
+ * A process-wide, size-bounded cache of parsed SCXML documents for nested interpreters.
+ *
+ * Invoking the same child chart over and over again would re-read and re-parse it
+ * every time. This cache keeps a pristine template of every parsed document and
+ * every new session is instantiated from a deep copy of its template.
+ *
+ * Documents from local files are keyed by their resolved URL and parsed again once
+ * the modification time or size of the file changed. Remote documents are keyed by
+ * their URL and fetched again after a time to live, serialized XML is keyed by its
+ * MD5 and inline `<content>` by the identity of the element. Documents are fetched
+ * and parsed without holding the cache's lock. Set USCXML_NOCACHE_INVOKERS to bypass
+ * the cache.
+ */
+class USCXML_API ChartTemplateCache {
+public:
+	struct Stats {
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t size;
+	};
+
+	static ChartTemplateCache& getInstance();
+
+	Interpreter fromURL(const std::string& url);
+	Interpreter fromElement(XERCESC_NS::DOMElement* element, const std::string& baseURL);
+	Interpreter fromXML(const std::string& xml, const std::string& baseURL);
+
+	void setMaxSize(size_t maxSize);
+	void setRemoteTTL(size_t ms); ///< Milliseconds before a remote document is fetched again
+	void clear();
+	Stats getStats();
+
+protected:
+	ChartTemplateCache();
+
+	struct Template {
+		XERCESC_NS::DOMDocument* document;
+		std::list<std::string>::iterator lruPos;
+		std::string validator; ///< Has to match on lookup, e.g. mtime and size of a file
+		bool remote; ///< Stale once the remote time to live passed since it was fetched
+		std::chrono::steady_clock::time_point fetched;
+	};
+
+	XERCESC_NS::DOMDocument* lookup(const std::string& key, const std::string& validator = "");
+	void insert(const std::string& key, XERCESC_NS::DOMDocument* document, const std::string& validator = "", bool remote = false);
+	Interpreter instantiate(const std::string& key, const std::string& baseURL);
+	void remove(std::map<std::string, Template>::iterator tmplIter);
+	void evict();
+
+	std::map<std::string, Template> _templates;
+	std::list<std::string> _lru;
+
+	size_t _maxSize;
+	size_t _remoteTTL;
+	size_t _nextElementId;
+	Stats _stats;
+
+	std::recursive_mutex _mutex;
+};
+
+}
+
+#endif /* end of include guard: CHARTTEMPLATECACHE_H_5C3A2E71 */
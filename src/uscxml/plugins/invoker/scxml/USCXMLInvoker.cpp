@@ -18,7 +18,9 @@
  */
 
 #include "USCXMLInvoker.h"
+#include "ChartTemplateCache.h"
 #include "uscxml/util/DOM.h"
+#include "uscxml/util/Convenience.h"
 #include "uscxml/interpreter/LoggingImpl.h"
 
 #ifdef BUILD_AS_PLUGINS
@@ -29,6 +31,11 @@
 #include <pthread.h>
 #endif
 
+#include <deque>
+
+// microsteps a pooled child may take before it yields its executor thread
+#define USCXML_INVOKER_POOLED_SLICE 64
+
 namespace uscxml {
 
 // msxml.h should die in a fire for polluting the global namespace
@@ -42,11 +49,84 @@ bool pluginConnect(pluma::Host& host) {
 }
 #endif
 
+// -1 until setPooled() was called, then 0 or 1
+static std::atomic<int> _pooled(-1);
+
+/**
+ * A fixed set of threads stepping pooled nested interpreters until they are idle.
+ */
+class InvokerExecutor {
+public:
+	static InvokerExecutor& getInstance() {
+		// never destroyed, our detached threads still wait on its condition at exit
+		static InvokerExecutor* instance = new InvokerExecutor();
+		return *instance;
+	}
+
+	void schedule(std::shared_ptr<USCXMLInvoker> invoker) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_runnable.push_back(invoker);
+		}
+		_cond.notify_one();
+	}
+
+protected:
+	InvokerExecutor() {
+		size_t nrThreads = std::thread::hardware_concurrency();
+		const char* envThreads = getenv("USCXML_INVOKER_THREADS");
+		if (envThreads != NULL)
+			nrThreads = strTo<size_t>(envThreads);
+		if (nrThreads == 0)
+			nrThreads = 1;
+
+		// the executor lives as long as the process
+		for (size_t i = 0; i < nrThreads; i++) {
+			std::thread(InvokerExecutor::run, this).detach();
+		}
+	}
+
+	static void run(void* instance) {
+		InvokerExecutor* INSTANCE = (InvokerExecutor*)instance;
+		while(true) {
+			std::shared_ptr<USCXMLInvoker> invoker;
+			{
+				std::unique_lock<std::mutex> lock(INSTANCE->_mutex);
+				while (INSTANCE->_runnable.empty()) {
+					INSTANCE->_cond.wait(lock);
+				}
+				invoker = INSTANCE->_runnable.front();
+				INSTANCE->_runnable.pop_front();
+			}
+			invoker->stepPooled();
+		}
+	}
+
+	std::deque<std::shared_ptr<USCXMLInvoker> > _runnable;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+};
+
+void USCXMLInvoker::setPooled(bool pooled) {
+	_pooled = (pooled ? 1 : 0);
+}
+
+bool USCXMLInvoker::isPooled() {
+	int pooled = _pooled;
+	if (pooled < 0)
+		return envVarIsTrue("USCXML_INVOKER_POOLED");
+	return pooled > 0;
+}
+
 USCXMLInvoker::USCXMLInvoker() {
 	_parentQueue = EventQueue(std::shared_ptr<ParentQueueImpl>(new ParentQueueImpl(this)));
 	_thread = NULL;
 	_isActive = false;
 	_isStarted = false;
+	_isPooled = false;
+	_isRunning = false;
+	_isScheduled = false;
+	_hasPendingWakeup = false;
 }
 
 
@@ -56,6 +136,13 @@ USCXMLInvoker::~USCXMLInvoker() {
 
 void USCXMLInvoker::start() {
 	_isStarted = true;
+	_isRunning = true;
+
+	if (_isPooled) {
+		_isScheduled = true;
+		InvokerExecutor::getInstance().schedule(_self.lock());
+		return;
+	}
 	_thread = new std::thread(USCXMLInvoker::run, this);
 }
 
@@ -73,6 +160,108 @@ void USCXMLInvoker::stop() {
 		delete _thread;
 		_thread = NULL;
 	}
+
+	if (_isPooled && _isRunning) {
+		_invokedInterpreter.cancel();
+
+		std::unique_lock<std::recursive_mutex> lock(_mutex);
+		while (_isRunning) {
+			if (!_isScheduled.exchange(true)) {
+				/**
+				 * No executor thread owns the child, we might be in our destructor.
+				 * Step it to its end without blocking and without keeping the lock,
+				 * the child may still send to its parent while finalizing.
+				 */
+				lock.unlock();
+				while (_isRunning) {
+					InterpreterState state;
+					{
+						std::lock_guard<std::recursive_mutex> stepLock(_mutex);
+						state = _invokedInterpreter.step(0);
+					}
+					_cond.notify_all();
+					if (state == USCXML_FINISHED)
+						finished();
+				}
+				_isScheduled = false;
+				lock.lock();
+			} else {
+				_cond.wait(lock);
+			}
+		}
+	}
+}
+
+void USCXMLInvoker::wakeup() {
+	_hasPendingWakeup = true;
+	if (!_isRunning)
+		return;
+
+	// if a thread is already stepping the child, it will see the pending wakeup
+	if (_isScheduled.exchange(true))
+		return;
+
+	std::shared_ptr<USCXMLInvoker> self = _self.lock();
+	if (!self) {
+		_isScheduled = false;
+		return;
+	}
+	InvokerExecutor::getInstance().schedule(self);
+}
+
+void USCXMLInvoker::stepPooled() {
+	_hasPendingWakeup = false;
+
+	InterpreterState state = USCXML_UNDEF;
+	size_t steps = 0;
+	do {
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			if (!_isRunning)
+				break;
+			state = _invokedInterpreter.step(0);
+		}
+		_cond.notify_all();
+	} while (state != USCXML_FINISHED && state != USCXML_IDLE && ++steps < USCXML_INVOKER_POOLED_SLICE);
+
+	if (state == USCXML_FINISHED) {
+		finished();
+		_isScheduled = false;
+		return;
+	}
+
+	if (state != USCXML_IDLE) {
+		// there is more to do, give other children a chance first
+		_hasPendingWakeup = true;
+	}
+
+	_isScheduled = false;
+	if (_hasPendingWakeup && _isRunning && !_isScheduled.exchange(true)) {
+		std::shared_ptr<USCXMLInvoker> self = _self.lock();
+		if (self) {
+			InvokerExecutor::getInstance().schedule(self);
+		} else {
+			_isScheduled = false;
+		}
+	}
+}
+
+void USCXMLInvoker::finished() {
+	if (_isActive) {
+		// we finished on our own and were not cancelled
+		Event e;
+		e.eventType = Event::PLATFORM;
+		e.invokeid = _invokedInterpreter.getImpl()->getInvokeId();
+		e.name = "done.invoke." + e.invokeid;
+		_callbacks->enqueueExternal(e);
+	}
+
+	_isActive = false;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_isRunning = false;
+	}
+	_cond.notify_all();
 }
 
 void USCXMLInvoker::deserialize(const Data& encodedState) {
@@ -141,21 +330,13 @@ void USCXMLInvoker::run(void* instance) {
 		INSTANCE->_cond.notify_all();
 	}
 
-	if (INSTANCE->_isActive) {
-		// we finished on our own and were not cancelled
-		Event e;
-		e.eventType = Event::PLATFORM;
-		e.invokeid = INSTANCE->_invokedInterpreter.getImpl()->getInvokeId();
-		e.name = "done.invoke." + e.invokeid;
-		INSTANCE->_callbacks->enqueueExternal(e);
-	}
-
-	INSTANCE->_isActive = false;
+	INSTANCE->finished();
 }
 
 std::shared_ptr<InvokerImpl> USCXMLInvoker::create(InvokerCallbacks* callbacks) {
 	std::shared_ptr<USCXMLInvoker> invoker(new USCXMLInvoker());
 	invoker->_callbacks = callbacks;
+	invoker->_self = invoker;
 	return invoker;
 }
 
@@ -165,8 +346,14 @@ Data USCXMLInvoker::getDataModelVariables() {
 }
 
 void USCXMLInvoker::invoke(const std::string& source, const Event& invokeEvent) {
+	// parsed documents are shared via the template cache, every session gets its own copy
+	ChartTemplateCache& templates = ChartTemplateCache::getInstance();
+
 	if (source.length() > 0) {
-		_invokedInterpreter = Interpreter::fromURL(source);
+		_invokedInterpreter = templates.fromURL(source);
+	} else if (invokeEvent.data.node && invokeEvent.data.node->getNodeType() == XERCESC_NS::DOMNode::ELEMENT_NODE) {
+		// the template cache copies the namespace declarations in scope at the content element
+		_invokedInterpreter = templates.fromElement(static_cast<XERCESC_NS::DOMElement*>(invokeEvent.data.node), _callbacks->getBaseURL());
 	} else if (invokeEvent.data.node) {
 		XERCESC_NS::DOMImplementation* implementation = XERCESC_NS::DOMImplementationRegistry::getDOMImplementation(X("core"));
 		XERCESC_NS::DOMDocument* document = implementation->createDocument();
@@ -175,11 +362,10 @@ void USCXMLInvoker::invoke(const std::string& source, const Event& invokeEvent)
 		XERCESC_NS::DOMNode* newNode = document->importNode(invokeEvent.data.node, true);
 		document->appendChild(newNode);
 
-		// TODO: where do we get the namespace from?
 		_invokedInterpreter = Interpreter::fromDocument(document, _callbacks->getBaseURL(), false);
 	} else if (invokeEvent.data.atom.size() > 0) {
 		// test530 when deserializing
-		_invokedInterpreter = Interpreter::fromXML(invokeEvent.data.atom, _callbacks->getBaseURL());
+		_invokedInterpreter = templates.fromXML(invokeEvent.data.atom, _callbacks->getBaseURL());
 
 	} else {
 		_isActive = false;
@@ -219,6 +405,15 @@ void USCXMLInvoker::invoke(const std::string& source, const Event& invokeEvent)
 		}
 		// TODO: setup invokers dom, check datamodel attribute and create new instance from parent if matching?
 
+		_isPooled = isPooled() && !_self.expired();
+		if (_isPooled) {
+			// get notified about events for the child to reschedule it
+			EventQueue externalQueue = invoked->_externalQueue;
+			if (!externalQueue)
+				externalQueue = EventQueue(std::shared_ptr<EventQueueImpl>(new BasicEventQueue()));
+			invoked->_externalQueue = EventQueue(std::shared_ptr<EventQueueImpl>(new ChildQueueImpl(externalQueue, _self)));
+		}
+
 		// copy monitors
 		std::set<InterpreterMonitor*> monitors = _callbacks->getMonitors();
 		for (auto monitor : monitors) {
@@ -247,8 +442,35 @@ void USCXMLInvoker::ParentQueueImpl::enqueue(const Event& event) {
 	// test 252
 	if (!_invoker->_isActive)
 		return;
-	Event copy(event); // TODO: can we get around a copy?
-	_invoker->eventToSCXML(copy, USCXML_INVOKER_SCXML_TYPE, _invoker->_invokeId);
+
+	/**
+	 * This queue belongs to a single invocation, everything the child sends to
+	 * #_parent is from it. The child's SCXML I/O processor already set the event
+	 * type, origin and origin type, only the invokeid is ours to add.
+	 */
+	const std::string& invokeId = _invoker->_invokeId;
+	if (event.eventType != 0 && event.origintype.length() > 0 &&
+	        (event.origin.length() > 0 || invokeId.length() == 0)) {
+		if (event.invokeid.length() > 0 || invokeId.length() == 0) {
+			_invoker->_callbacks->enqueueExternal(event);
+		} else {
+			Event copy(event);
+			copy.invokeid = invokeId;
+			_invoker->_callbacks->enqueueExternal(copy);
+		}
+		return;
+	}
+
+	Event copy(event);
+	_invoker->eventToSCXML(copy, USCXML_INVOKER_SCXML_TYPE, invokeId);
+}
+
+void USCXMLInvoker::ChildQueueImpl::enqueue(const Event& event) {
+	_queue.enqueue(event);
+
+	std::shared_ptr<USCXMLInvoker> invoker = _invoker.lock();
+	if (invoker)
+		invoker->wakeup();
 }
 
 }
@@ -27,6 +27,8 @@
 
 #include "uscxml/plugins/InvokerImpl.h"
 
+#include <atomic>
+
 #ifdef BUILD_AS_PLUGINS
 #include "uscxml/plugins/Plugins.h"
 #endif
@@ -50,6 +52,42 @@ public:
 		USCXMLInvoker* _invoker;
 	};
 
+	/**
+	 * External queue of a pooled child, wraps the actual queue and reschedules
+	 * the child with the executor whenever an event arrives.
+	 */
+	class ChildQueueImpl : public EventQueueImpl {
+	public:
+		ChildQueueImpl(EventQueue queue, std::weak_ptr<USCXMLInvoker> invoker) : _queue(queue), _invoker(invoker) {}
+		virtual std::shared_ptr<EventQueueImpl> create() {
+			return _queue.getImplBase()->create();
+		}
+		virtual Event dequeue(size_t blockMs) {
+			return _queue.dequeue(blockMs);
+		}
+		virtual void enqueue(const Event& event);
+		virtual void reset() {
+			_queue.reset();
+		}
+		virtual Data serialize() {
+			return _queue.serialize();
+		}
+		virtual void deserialize(const Data& data) {
+			_queue.deserialize(data);
+		}
+		EventQueue _queue;
+		std::weak_ptr<USCXMLInvoker> _invoker;
+	};
+
+	/**
+	 * Step nested interpreters cooperatively on a shared executor instead of
+	 * a dedicated thread per invocation. Defaults to the USCXML_INVOKER_POOLED
+	 * environment variable, the number of threads to USCXML_INVOKER_THREADS
+	 * or the number of cores.
+	 */
+	static void setPooled(bool pooled);
+	static bool isPooled();
+
 	USCXMLInvoker();
 	virtual ~USCXMLInvoker();
 	virtual std::shared_ptr<InvokerImpl> create(InvokerCallbacks* callbacks) override;
@@ -80,9 +118,22 @@ protected:
 	void stop();
 	static void run(void* instance);
 
-	bool _isActive;
-	bool _isStarted;
+	void wakeup();
+	void stepPooled();
+	void finished();
+
+	// read by the parent, the child's and the executor threads
+	std::atomic<bool> _isActive;
+	std::atomic<bool> _isStarted;
 	std::thread* _thread;
+
+	bool _isPooled;
+	std::atomic<bool> _isRunning;
+	std::atomic<bool> _isScheduled;
+	std::atomic<bool> _hasPendingWakeup;
+	std::weak_ptr<USCXMLInvoker> _self;
+
+	friend class InvokerExecutor;
 	EventQueue _parentQueue;
 	Interpreter _invokedInterpreter;
 
@@ -20,8 +20,10 @@
 #include "uscxml/Common.h"
 
 #include "uscxml/plugins/ioprocessor/basichttp/BasicHTTPIOProcessor.h"
+#include "uscxml/interpreter/PriorityEventQueue.h"
 #include "uscxml/messages/Event.h"
 #include "uscxml/util/DOM.h"
+#include "uscxml/util/Convenience.h"
 
 #include <event2/dns.h>
 #include <event2/buffer.h>
@@ -62,13 +64,44 @@ bool pluginConnect(pluma::Host& host) {
 
 // see http://www.w3.org/TR/scxml/#BasicHTTPEventProcessor
 
-BasicHTTPIOProcessor::BasicHTTPIOProcessor() {
+std::map<std::string, BasicHTTPIOProcessor*> BasicHTTPIOProcessor::_localProcessors;
+std::mutex BasicHTTPIOProcessor::_localMutex;
+std::condition_variable BasicHTTPIOProcessor::_localCond;
+
+BasicHTTPIOProcessor::BasicHTTPIOProcessor() : _wsStream(this) {
 	HTTPServer::getInstance();
 }
 
 BasicHTTPIOProcessor::~BasicHTTPIOProcessor() {
 	HTTPServer* httpServer = HTTPServer::getInstance();
 	httpServer->unregisterServlet(this);
+	httpServer->unregisterServlet(&_wsStream);
+
+	std::unique_lock<std::mutex> lock(_localMutex);
+	auto localIter = _localProcessors.find(_path);
+	if (localIter != _localProcessors.end() && localIter->second == this)
+		_localProcessors.erase(localIter);
+
+	// no one finds us anymore, wait for those already delivering to us
+	_localCond.wait(lock, [this] {
+		return _localDeliveries == 0;
+	});
+}
+
+void BasicHTTPIOProcessor::setURL(const std::string& url) {
+	std::lock_guard<std::mutex> lock(_localMutex);
+
+	auto localIter = _localProcessors.find(_path);
+	if (localIter != _localProcessors.end() && localIter->second == this)
+		_localProcessors.erase(localIter);
+
+	_url = url;
+	try {
+		_path = URL(url).path();
+		_localProcessors[_path] = this;
+	} catch (ErrorEvent e) {
+		_path.clear();
+	}
 }
 
 
@@ -85,6 +118,11 @@ std::shared_ptr<IOProcessorImpl> BasicHTTPIOProcessor::create(IOProcessorCallbac
 		path = ss.str();
 	}
 
+	// batches of events may be streamed via websockets at the same path
+	if (!HTTPServer::registerServlet(path + "/basichttp", &io->_wsStream)) {
+		LOG(callbacks->getLogger(), USCXML_WARN) << "Cannot stream events via websockets at " << path << "/basichttp, path is taken" << std::endl;
+	}
+
 	return io;
 }
 
@@ -96,6 +134,8 @@ Data BasicHTTPIOProcessor::getDataModelVariables() {
 		return data;
 
 	data.compound["location"] = Data(_url, Data::VERBATIM);
+	if (_wsStream._url.length() > 0)
+		data.compound["wsLocation"] = Data(_wsStream._url, Data::VERBATIM);
 
 	URL url(_url);
 	data.compound["host"] = Data(url.host(), Data::VERBATIM);
@@ -115,8 +155,43 @@ Data BasicHTTPIOProcessor::getDataModelVariables() {
 }
 
 bool BasicHTTPIOProcessor::requestFromHTTP(const HTTPServer::Request& req) {
+	// we are on the event loop of the HTTP server, answer 503 rather than wait for a full queue
+	PriorityEventQueue::NonBlockingScope nonBlocking;
+
+	std::string contentType;
+	if (req.data.hasKey("header")) {
+		const Data& headers = req.data["header"];
+		for (auto& header : headers.compound) {
+			if (boost::iequals(header.first, "Content-Type")) {
+				contentType = header.second.atom;
+				break;
+			}
+		}
+	}
+
+	// many events in a single request, they are enqueued at once
+	bool lineDelimited = boost::istarts_with(contentType, USCXML_BASICHTTP_NDJSON_TYPE);
+	if (lineDelimited || boost::istarts_with(contentType, USCXML_BASICHTTP_BATCH_TYPE)) {
+		std::list<Event> events;
+		if (!decodeBatch(req.content, lineDelimited, events)) {
+			evhttp_send_reply(req.evhttpReq, 400, "Bad Request", NULL);
+			return true;
+		}
+		try {
+			eventsToSCXML(events, USCXML_IOPROC_BASICHTTP_TYPE, _url);
+		} catch (ErrorEvent e) {
+			// the session's event queue is full
+			evhttp_send_reply(req.evhttpReq, 503, "Service Unavailable", NULL);
+			return true;
+		}
+		evhttp_send_reply(req.evhttpReq, 200, "OK", NULL);
+		return true;
+	}
+
 	Event event = req;
 	event.eventType = Event::EXTERNAL;
+	if (HTTPServer::hasRawRequests())
+		event.raw = req.getRaw();
 
 	/**
 	 * If a single instance of the parameter '_scxmleventname' is present, the
@@ -161,7 +236,12 @@ bool BasicHTTPIOProcessor::requestFromHTTP(const HTTPServer::Request& req) {
 	if (event.name.length() == 0)
 		event.name = "http." + req.data.compound.at("type").atom;
 
-	eventToSCXML(event, USCXML_IOPROC_BASICHTTP_TYPE, _url);
+	try {
+		eventToSCXML(event, USCXML_IOPROC_BASICHTTP_TYPE, _url);
+	} catch (ErrorEvent e) {
+		evhttp_send_reply(req.evhttpReq, 503, "Service Unavailable", NULL);
+		return true;
+	}
 	evhttp_send_reply(req.evhttpReq, 200, "OK", NULL);
 	return true;
 }
@@ -186,131 +266,399 @@ void BasicHTTPIOProcessor::eventFromSCXML(const std::string& target, const Event
 		return;
 	}
 
+	// sessions of this process receive the event without a roundtrip through HTTP
+	if (!envVarIsTrue("USCXML_BASICHTTP_NO_LOCAL") && sendLocal(target, event))
+		return;
+
 	bool isLocal = target == _url;
 	URL targetURL(target);
+	std::string content = encodeForm(event, &targetURL);
+
+	targetURL.setOutContent(content);
+	targetURL.addOutHeader("Content-Type", "application/x-www-form-urlencoded");
+
+	targetURL.setRequestType(URLRequestType::POST);
+	targetURL.addMonitor(this);
+
+	{
+		std::lock_guard<std::mutex> lock(_sendMutex);
+		_sendRequests[targetURL.getImpl().get()] = std::make_pair(targetURL, event);
+	}
+	if (isLocal) {
+		// test201 use a blocking request with local communication
+		targetURL.download(true);
+	} else {
+		URLFetcher::fetchURL(targetURL);
+	}
+}
+
+/// Append a URL-encoded key=value pair to a form
+static void appendFormField(std::ostream& kvps, std::string& kvpSeperator, const std::string& key, const std::string& value) {
+	char* keyCStr = evhttp_encode_uri(key.c_str());
+	char* valueCStr = evhttp_encode_uri(value.c_str());
+	kvps << kvpSeperator << keyCStr << "=" << valueCStr;
+	free(keyCStr);
+	free(valueCStr);
+	kvpSeperator = "&";
+}
+
+/// The textual representation of event content in a form, false if there is none
+static bool formContent(const Data& data, std::string& content) {
+	if (data.empty())
+		return false;
+	if (!data.atom.empty() || data.array.size() || data.compound.size()) {
+		content = Data::toJSON(data);
+		return true;
+	}
+	if (data.node) {
+		std::stringstream xmlStream;
+		xmlStream << data.node;
+		content = xmlStream.str();
+		return true;
+	}
+	if (data.binary) {
+		content = data.binary.base64();
+		return true;
+	}
+	return false;
+}
+
+/**
+ * The event as an application/x-www-form-urlencoded request body, the
+ * given URL receives the accompanying headers.
+ */
+std::string BasicHTTPIOProcessor::encodeForm(const Event& event, URL* url) {
 	std::stringstream kvps;
 	std::string kvpSeperator;
 
 	// event name
 	if (event.name.size() > 0) {
-		char* eventNameCStr = evhttp_encode_uri("_scxmleventname");
-		char* eventValueCStr = evhttp_encode_uri(event.name.c_str());
-		kvps << kvpSeperator << eventNameCStr << "=" << eventValueCStr;
-		kvpSeperator = "&";
-		targetURL.addOutHeader("_scxmleventname", eventValueCStr);
-		free(eventNameCStr);
-		free(eventValueCStr);
+		appendFormField(kvps, kvpSeperator, "_scxmleventname", event.name);
+		if (url) {
+			char* eventValueCStr = evhttp_encode_uri(event.name.c_str());
+			url->addOutHeader("_scxmleventname", eventValueCStr);
+			free(eventValueCStr);
+		}
 	}
 
 	// event namelist
-	if (event.namelist.size() > 0) {
-		std::map<std::string, Data>::const_iterator namelistIter = event.namelist.begin();
-		while (namelistIter != event.namelist.end()) {
-			char* keyCStr = evhttp_encode_uri(namelistIter->first.c_str());
-			// this is simplified - Data might be more elaborate than a simple string atom
-			char* valueCStr = evhttp_encode_uri(Data::toJSON(namelistIter->second).c_str());
-			kvps << kvpSeperator << keyCStr << "=" << valueCStr;
-			free(keyCStr);
-			free(valueCStr);
-			kvpSeperator = "&";
-			targetURL.addOutHeader(namelistIter->first, namelistIter->second);
-			namelistIter++;
-		}
+	for (auto namelistIter = event.namelist.begin(); namelistIter != event.namelist.end(); namelistIter++) {
+		// this is simplified - Data might be more elaborate than a simple string atom
+		appendFormField(kvps, kvpSeperator, namelistIter->first, Data::toJSON(namelistIter->second));
+		if (url)
+			url->addOutHeader(namelistIter->first, namelistIter->second);
 	}
 
 	// event params
-	if (event.params.size() > 0) {
-		std::multimap<std::string, Data>::const_iterator paramIter = event.params.begin();
-		while (paramIter != event.params.end()) {
-			char* keyCStr = evhttp_encode_uri(paramIter->first.c_str());
-			// this is simplified - Data might be more elaborate than a simple string atom
-			char* valueCStr = evhttp_encode_uri(Data::toJSON(paramIter->second).c_str());
-			kvps << kvpSeperator << keyCStr << "=" << valueCStr;
-			free(keyCStr);
-			free(valueCStr);
-			kvpSeperator = "&";
-			targetURL.addOutHeader(paramIter->first, paramIter->second);
-			paramIter++;
-		}
+	for (auto paramIter = event.params.begin(); paramIter != event.params.end(); paramIter++) {
+		// this is simplified - Data might be more elaborate than a simple string atom
+		appendFormField(kvps, kvpSeperator, paramIter->first, Data::toJSON(paramIter->second));
+		if (url)
+			url->addOutHeader(paramIter->first, paramIter->second);
 	}
 
 	// try hard to find actual content
-	char* keyCStr = evhttp_encode_uri("content");
-	if (!event.data.empty()) {
-		char* valueCStr = NULL;
-		if (!event.data.atom.empty() || event.data.array.size() || event.data.compound.size()) {
-			valueCStr = evhttp_encode_uri(Data::toJSON(event.data).c_str());
-		} 
-		else if(event.data.node) {
-			std::stringstream xmlStream;
-			xmlStream << event.data.node;
-			valueCStr = evhttp_encode_uri(xmlStream.str().c_str());
-		} else if(event.data.binary) {
-			valueCStr = evhttp_encode_uri(event.data.binary.base64().c_str());
+	std::string content;
+	if (formContent(event.data, content))
+		appendFormField(kvps, kvpSeperator, "content", content);
+
+	return kvps.str();
+}
+
+bool BasicHTTPIOProcessor::sendLocal(const std::string& target, const Event& event) {
+	BasicHTTPIOProcessor* receiver = NULL;
+	{
+		std::lock_guard<std::mutex> lock(_localMutex);
+		try {
+			URL targetURL(target);
+			auto localIter = _localProcessors.find(targetURL.path());
+			if (localIter == _localProcessors.end())
+				return false;
+
+			receiver = localIter->second;
+			if (target != receiver->_url) {
+				// same path, but is it actually served by us?
+				URL localURL(receiver->_url);
+				if (targetURL.port() != localURL.port())
+					return false;
+
+				std::string host = targetURL.host();
+				if (host != localURL.host() &&
+				        host != "localhost" &&
+				        host != "127.0.0.1" &&
+				        host != "::1" &&
+				        host != "[::1]")
+					return false;
+			}
+		} catch (ErrorEvent e) {
+			return false;
 		}
-		if (valueCStr != NULL) {
-			kvps << kvpSeperator << keyCStr << "=" << valueCStr;
-			free(valueCStr);
-			kvpSeperator = "&";
+		// the receiver's destructor waits for us
+		receiver->_localDeliveries++;
+	}
+
+	// not under the lock, the receiving session may itself send or be destroyed meanwhile
+	try {
+		receiver->receiveLocal(event);
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(_localMutex);
+		receiver->_localDeliveries--;
+		_localCond.notify_all();
+		throw;
+	}
+
+	std::lock_guard<std::mutex> lock(_localMutex);
+	receiver->_localDeliveries--;
+	_localCond.notify_all();
+	return true;
+}
+
+/**
+ * Raise the event as requestFromHTTP() would have, had it been sent to us
+ * via HTTP. Namelist and param values are passed as they are instead of
+ * their JSON representation and nothing is URL-encoded, unless someone
+ * might look at the raw request.
+ */
+void BasicHTTPIOProcessor::receiveLocal(const Event& sent) {
+	Event event;
+	event.eventType = Event::EXTERNAL;
+	event.name = sent.name;
+
+	event.data.compound["type"] = Data("post", Data::VERBATIM);
+	event.data.compound["path"] = Data(_path, Data::VERBATIM);
+	event.data.compound["uri"] = Data(_url, Data::VERBATIM);
+	event.data.compound["httpMajor"] = Data("1", Data::VERBATIM);
+	event.data.compound["httpMinor"] = Data("1", Data::VERBATIM);
+
+	Data& header = event.data.compound["header"];
+	if (sent.name.size() > 0)
+		header.compound["_scxmleventname"] = Data(sent.name, Data::VERBATIM);
+	for (auto namelistIter = sent.namelist.begin(); namelistIter != sent.namelist.end(); namelistIter++) {
+		header.compound[namelistIter->first] = Data((std::string)namelistIter->second, Data::VERBATIM);
+	}
+	for (auto paramIter = sent.params.begin(); paramIter != sent.params.end(); paramIter++) {
+		header.compound[paramIter->first] = Data((std::string)paramIter->second, Data::VERBATIM);
+	}
+	header.compound["Content-Type"] = Data("application/x-www-form-urlencoded", Data::VERBATIM);
+	try {
+		URL url(_url);
+		header.compound["Host"] = Data(url.host() + ":" + toStr(url.port()), Data::VERBATIM);
+	} catch (ErrorEvent e) {}
+
+	int index = 0;
+	std::stringstream pathSS(_path);
+	std::string pathItem;
+	while(std::getline(pathSS, pathItem, '/')) {
+		if (pathItem.length() == 0)
+			continue;
+		event.data.compound["pathComponent"].array.insert(std::make_pair(index++, Data(pathItem, Data::VERBATIM)));
+	}
+
+	for (auto namelistIter = sent.namelist.begin(); namelistIter != sent.namelist.end(); namelistIter++) {
+		event.data.compound[namelistIter->first] = namelistIter->second;
+	}
+	for (auto paramIter = sent.params.begin(); paramIter != sent.params.end(); paramIter++) {
+		event.data.compound[paramIter->first] = paramIter->second;
+	}
+	if (sent.name.size() > 0 || sent.namelist.size() > 0 || sent.params.size() > 0 || !sent.data.empty()) {
+		// a form request with any field has content, empty once the fields were moved into data
+		event.data.compound["content"] = sent.data;
+	}
+
+	auto nameIter = event.data.compound.find("_scxmleventname");
+	if (nameIter != event.data.compound.end()) {
+		event.name = nameIter->second.atom;
+		event.data.compound.erase(nameIter);
+	}
+
+	// test 532
+	if (event.name.length() == 0)
+		event.name = "http.post";
+
+	if (HTTPServer::hasRawRequests()) {
+		// only encode if someone might look at _event.raw
+		std::stringstream form;
+		std::string kvpSeperator;
+		if (sent.name.size() > 0)
+			appendFormField(form, kvpSeperator, "_scxmleventname", sent.name);
+		for (auto namelistIter = sent.namelist.begin(); namelistIter != sent.namelist.end(); namelistIter++) {
+			appendFormField(form, kvpSeperator, namelistIter->first, Data::toJSON(namelistIter->second));
 		}
+		for (auto paramIter = sent.params.begin(); paramIter != sent.params.end(); paramIter++) {
+			appendFormField(form, kvpSeperator, paramIter->first, Data::toJSON(paramIter->second));
+		}
+		std::string content;
+		if (formContent(sent.data, content))
+			appendFormField(form, kvpSeperator, "content", content);
+
+		std::stringstream raw;
+		raw << "POST " << _path << " HTTP/1.1" << std::endl;
+		if (sent.name.size() > 0) {
+			char* eventNameCStr = evhttp_encode_uri(sent.name.c_str());
+			raw << "_scxmleventname: " << eventNameCStr << std::endl;
+			free(eventNameCStr);
+		}
+		raw << "Content-Type: application/x-www-form-urlencoded" << std::endl;
+		raw << "Content-Length: " << form.str().size() << std::endl;
+		raw << std::endl;
+		raw << form.str();
+		event.raw = raw.str();
 	}
-	free(keyCStr);
 
-	targetURL.setOutContent(kvps.str());
-	targetURL.addOutHeader("Content-Type", "application/x-www-form-urlencoded");
+	eventToSCXML(event, USCXML_IOPROC_BASICHTTP_TYPE, _url);
+}
 
-	targetURL.setRequestType(URLRequestType::POST);
-	targetURL.addMonitor(this);
+/**
+ * Every event of a batch is a JSON object with a `name` and optional `data`.
+ * A batch is rejected as a whole if any of its events is malformed, if it
+ * is not a JSON array when expected or if it holds no events at all.
+ */
+bool BasicHTTPIOProcessor::decodeBatch(const std::string& content, bool lineDelimited, std::list<Event>& events) {
+	std::list<Data> entries;
+	try {
+		if (lineDelimited) {
+			size_t start = 0;
+			while (start < content.size()) {
+				size_t end = content.find('\n', start);
+				if (end == std::string::npos)
+					end = content.size();
+				std::string line = content.substr(start, end - start);
+				start = end + 1;
+
+				if (boost::trim_copy(line).length() == 0)
+					continue;
+				entries.push_back(Data::fromJSON(line));
+			}
+		} else {
+			// anything else would parse into an atom or compound without events
+			if (!boost::starts_with(boost::trim_copy(content), "["))
+				return false;
+			Data batch = Data::fromJSON(content);
+			for (auto& entry : batch.array) {
+				entries.push_back(entry.second);
+			}
+		}
+	} catch (ErrorEvent e) {
+		return false;
+	}
 
-	_sendRequests[event.sendid] = std::make_pair(targetURL, event);
-	if (isLocal) {
-		// test201 use a blocking request with local communication
-		targetURL.download(true);
-	} else {
-		URLFetcher::fetchURL(targetURL);
+	if (entries.empty())
+		return false;
+
+	for (auto& entry : entries) {
+		if (!entry.hasKey("name") || entry.at("name").atom.length() == 0)
+			return false;
+
+		Event event;
+		event.eventType = Event::EXTERNAL;
+		event.name = entry.at("name").atom;
+		if (entry.hasKey("data"))
+			event.data = entry["data"];
+		events.push_back(event);
+	}
+	return true;
+}
+
+bool BasicHTTPIOProcessor::WSStream::requestFromWS(struct evws_connection *conn, const HTTPServer::WSFrame& frame) {
+	std::string type = frame.data.at("type").atom;
+	if (type == "close") {
+		std::lock_guard<std::mutex> lock(_fragmentMutex);
+		_fragments.erase(conn);
+		return true;
+	}
+	if (type != "text" && type != "binary" && type != "continuation")
+		return true;
+
+	bool fin = !frame.data.hasKey("fin") || frame.data.at("fin").atom == "true";
+	std::string content;
+	{
+		std::lock_guard<std::mutex> lock(_fragmentMutex);
+		auto fragmentIter = _fragments.find(conn);
+		if (type == "continuation") {
+			if (fragmentIter == _fragments.end()) {
+				static const std::string error = "{\"error\": \"continuation without a message\"}";
+				HTTPServer::wsSend(conn, EVWS_TEXT_FRAME, error.c_str(), error.size());
+				return true;
+			}
+			if (fragmentIter->second.isText)
+				fragmentIter->second.content += frame.data.at("content").atom;
+		} else {
+			// a new message, whatever was pending was never finished
+			fragmentIter = _fragments.insert(std::make_pair(conn, Fragments())).first;
+			fragmentIter->second.isText = (type == "text");
+			if (fragmentIter->second.isText)
+				fragmentIter->second.content = frame.data.at("content").atom;
+		}
+
+		if (fragmentIter->second.isText && fragmentIter->second.content.size() > USCXML_BASICHTTP_WS_MAX_MESSAGE) {
+			_fragments.erase(fragmentIter);
+			static const std::string error = "{\"error\": \"message too large\"}";
+			HTTPServer::wsSend(conn, EVWS_TEXT_FRAME, error.c_str(), error.size());
+			return true;
+		}
+
+		if (!fin)
+			return true;
+
+		bool isText = fragmentIter->second.isText;
+		content.swap(fragmentIter->second.content);
+		_fragments.erase(fragmentIter);
+		if (!isText)
+			return true;
+	}
+
+	PriorityEventQueue::NonBlockingScope nonBlocking;
+
+	std::list<Event> events;
+	if (!decodeBatch(content, true, events)) {
+		static const std::string error = "{\"error\": \"malformed batch\"}";
+		HTTPServer::wsSend(conn, EVWS_TEXT_FRAME, error.c_str(), error.size());
+		return true;
+	}
+	try {
+		_ioProc->eventsToSCXML(events, USCXML_IOPROC_BASICHTTP_TYPE, _ioProc->_url);
+	} catch (ErrorEvent e) {
+		static const std::string error = "{\"error\": \"queue full\"}";
+		HTTPServer::wsSend(conn, EVWS_TEXT_FRAME, error.c_str(), error.size());
 	}
+	return true;
 }
 
 void BasicHTTPIOProcessor::downloadStarted(const URL& url) {}
 
 void BasicHTTPIOProcessor::downloadCompleted(const URL& url) {
-	std::map<std::string, std::pair<URL, Event> >::iterator reqIter = _sendRequests.begin();
-	while(reqIter != _sendRequests.end()) {
-		if (reqIter->second.first == url) {
-			// test513
-			std::string statusCode = url.getStatusCode();
-			if (statusCode.length() > 0) {
-				std::string statusPrefix = statusCode.substr(0,1);
-				std::string statusRest = statusCode.substr(1);
-				Event event;
-				event.data = url;
-				event.name = "HTTP." + statusPrefix + "." + statusRest;
-				eventToSCXML(event, USCXML_IOPROC_BASICHTTP_TYPE, std::string(_url));
-			}
-			_sendRequests.erase(reqIter);
+	{
+		std::lock_guard<std::mutex> lock(_sendMutex);
+		if (_sendRequests.erase(url.getImpl().get()) == 0) {
+			assert(false);
 			return;
 		}
-		reqIter++;
 	}
-	assert(false);
+
+	// test513
+	std::string statusCode = url.getStatusCode();
+	if (statusCode.length() > 0) {
+		std::string statusPrefix = statusCode.substr(0,1);
+		std::string statusRest = statusCode.substr(1);
+		Event event;
+		event.data = url;
+		event.name = "HTTP." + statusPrefix + "." + statusRest;
+		eventToSCXML(event, USCXML_IOPROC_BASICHTTP_TYPE, std::string(_url));
+	}
 }
 
 void BasicHTTPIOProcessor::downloadFailed(const URL& url, int errorCode) {
-
-	std::map<std::string, std::pair<URL, Event> >::iterator reqIter = _sendRequests.begin();
-	while(reqIter != _sendRequests.end()) {
-		if (reqIter->second.first == url) {
-			Event failEvent;
-			failEvent.name = "error.communication";
-			eventToSCXML(failEvent, USCXML_IOPROC_BASICHTTP_TYPE, std::string(_url));
-
-			_sendRequests.erase(reqIter);
+	{
+		std::lock_guard<std::mutex> lock(_sendMutex);
+		if (_sendRequests.erase(url.getImpl().get()) == 0) {
+			assert(false);
 			return;
 		}
-		reqIter++;
 	}
-	assert(false);
 
+	Event failEvent;
+	failEvent.name = "error.communication";
+	eventToSCXML(failEvent, USCXML_IOPROC_BASICHTTP_TYPE, std::string(_url));
 }
 
 
@@ -43,6 +43,10 @@ extern "C" {
 #include "uscxml/interpreter/InterpreterImpl.h"
 #include "uscxml/plugins/IOProcessorImpl.h"
 
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
 #ifndef _WIN32
 #include <sys/time.h>
 #endif
@@ -53,6 +57,13 @@ extern "C" {
 
 #define USCXML_IOPROC_BASICHTTP_TYPE "http://www.w3.org/TR/scxml/#BasicHTTPEventProcessor"
 
+/// content type for batches of events as one JSON object per line
+#define USCXML_BASICHTTP_NDJSON_TYPE "application/x-ndjson"
+/// content type for batches of events as a JSON array of objects
+#define USCXML_BASICHTTP_BATCH_TYPE "application/x-scxml-events+json"
+/// largest websocket message reassembled from fragments
+#define USCXML_BASICHTTP_WS_MAX_MESSAGE (16 * 1024 * 1024)
+
 namespace uscxml {
 
 /**
@@ -79,9 +90,7 @@ public:
 
 	/// HTTPServlet
 	bool requestFromHTTP(const HTTPServer::Request& req);
-	void setURL(const std::string& url) {
-		_url = url;
-	}
+	void setURL(const std::string& url);
 
 	bool canAdaptPath() {
 		return false;
@@ -92,9 +101,54 @@ public:
 	void downloadCompleted(const URL& url);
 	void downloadFailed(const URL& url, int errorCode);
 
+	/**
+	 * Streams events into the session via the WebSocket server, every text
+	 * message holds one or more complete lines of newline delimited JSON.
+	 * Messages fragmented over several frames are reassembled first.
+	 */
+	class WSStream : public WebSocketServlet {
+	public:
+		WSStream(BasicHTTPIOProcessor* ioProc) : _ioProc(ioProc) {}
+
+		bool requestFromWS(struct evws_connection *conn, const HTTPServer::WSFrame& frame);
+		void setURL(const std::string& url) {
+			_url = url;
+		}
+		bool canAdaptPath() {
+			return false;
+		}
+
+		std::string _url;
+
+	protected:
+		struct Fragments {
+			bool isText = false;
+			std::string content;
+		};
+
+		BasicHTTPIOProcessor* _ioProc;
+		std::map<struct evws_connection*, Fragments> _fragments; ///< unfinished messages by connection
+		std::mutex _fragmentMutex;
+	};
+
 protected:
+	static std::string encodeForm(const Event& event, URL* url = NULL);
+	static bool decodeBatch(const std::string& content, bool lineDelimited, std::list<Event>& events);
+
+	bool sendLocal(const std::string& target, const Event& event);
+	void receiveLocal(const Event& event);
+
 	std::string _url;
-	std::map<std::string, std::pair<URL, Event> > _sendRequests;
+	std::string _path;
+	WSStream _wsStream;
+	std::unordered_map<URLImpl*, std::pair<URL, Event> > _sendRequests; ///< in flight by their URL
+	std::mutex _sendMutex;
+	size_t _localDeliveries = 0; ///< sessions delivering to us, guarded by _localMutex
+
+	/// processors of this process by the path they are served at
+	static std::map<std::string, BasicHTTPIOProcessor*> _localProcessors;
+	static std::mutex _localMutex;
+	static std::condition_variable _localCond;
 };
 
 #ifdef BUILD_AS_PLUGINS
@@ -123,15 +123,9 @@ void SCXMLIOProcessor::eventFromSCXML(const std::string& target, const Event& ev
 		 */
 		std::string sessionId = target.substr(8);
 
-		std::lock_guard<std::recursive_mutex> lock(InterpreterImpl::_instanceMutex);
-		std::map<std::string, std::weak_ptr<InterpreterImpl> > instances = InterpreterImpl::getInstances();
-		if (instances.find(sessionId) != instances.end()) {
-			std::shared_ptr<InterpreterImpl> otherSession = instances[sessionId].lock();
-			if (otherSession) {
-				otherSession->enqueueExternal(eventCopy);
-			} else {
-				ERROR_COMMUNICATION_THROW("Can not send to scxml session " + sessionId + " - not known");
-			}
+		std::shared_ptr<InterpreterImpl> otherSession = InterpreterImpl::getInstance(sessionId);
+		if (otherSession) {
+			otherSession->enqueueExternal(eventCopy);
 		} else {
 			ERROR_COMMUNICATION_THROW("Invalid target scxml session for send");
 		}
@@ -37,6 +37,7 @@ extern "C" {
 #include <event2/keyvalq_struct.h>
 #include <event2/http_struct.h>
 #include <event2/thread.h>
+#include <event2/listener.h>
 }
 
 #include "uscxml/interpreter/Logging.h"
@@ -60,12 +61,105 @@ extern "C" {
 
 namespace uscxml {
 
+size_t HTTPServer::_nrThreads = 0;
+bool HTTPServer::_rawRequests = true;
+bool HTTPServer::_rawRequestsConfigured = false;
+
+// the event loop of the calling thread, if it is one of ours
+static thread_local void* _currentLoop = NULL;
+
+// lower-cased, non-empty path segments
+static std::vector<std::string> pathSegments(const std::string& path) {
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start < path.size()) {
+		size_t end = path.find('/', start);
+		if (end == std::string::npos)
+			end = path.size();
+		if (end > start)
+			segments.push_back(boost::to_lower_copy(path.substr(start, end - start)));
+		start = end + 1;
+	}
+	return segments;
+}
+
+// copy the nodes along the path and set the servlet at its end, empty nodes are pruned
+template <typename Node, typename Servlet>
+static std::shared_ptr<const Node> trieUpdate(const std::shared_ptr<const Node>& node,
+        const std::vector<std::string>& segments,
+        size_t depth,
+        Servlet* servlet) {
+	std::shared_ptr<Node> copy(node ? new Node(*node) : new Node());
+
+	if (depth == segments.size()) {
+		copy->servlet = servlet;
+	} else {
+		std::shared_ptr<const Node> child;
+		auto childIter = copy->children.find(segments[depth]);
+		if (childIter != copy->children.end())
+			child = childIter->second;
+
+		child = trieUpdate(child, segments, depth + 1, servlet);
+		if (child) {
+			copy->children[segments[depth]] = child;
+		} else {
+			copy->children.erase(segments[depth]);
+		}
+	}
+
+	if (copy->servlet == NULL && copy->children.empty())
+		return std::shared_ptr<const Node>();
+	return copy;
+}
+
+// servlets at the path and all its prefixes, shortest prefix first
+template <typename Node, typename Servlet>
+static void trieMatch(std::shared_ptr<const Node> node,
+                      const std::vector<std::string>& segments,
+                      std::vector<Servlet*>& matches) {
+	size_t depth = 0;
+	while (node) {
+		if (node->servlet != NULL)
+			matches.push_back(node->servlet);
+		if (depth == segments.size())
+			break;
+
+		auto childIter = node->children.find(segments[depth++]);
+		if (childIter == node->children.end())
+			break;
+		node = childIter->second;
+	}
+}
+
 HTTPServer::HTTPServer(unsigned short port, unsigned short wsPort, SSLConfig* sslConf) {
 	_port = port;
-	_base = event_base_new();
-	_http = evhttp_new(_base);
+	_isRunning = false;
+
+	size_t nrThreads = _nrThreads;
+	if (nrThreads == 0) {
+		const char* envThreads = getenv("USCXML_HTTP_THREADS");
+		if (envThreads != NULL)
+			nrThreads = strTo<size_t>(envThreads);
+	}
+	if (nrThreads == 0)
+		nrThreads = 1;
+#ifndef LEV_OPT_REUSEABLE_PORT
+	if (nrThreads > 1) {
+		LOGD(USCXML_WARN) << "libevent lacks SO_REUSEPORT support, serving HTTP from a single thread" << std::endl;
+		nrThreads = 1;
+	}
+#endif
+
+	for (size_t i = 0; i < nrThreads; i++) {
+		EventLoop* loop = new EventLoop();
+		loop->base = event_base_new();
+		loop->http = evhttp_new(loop->base);
+		_loops.push_back(loop);
+	}
+
+	_base = _loops[0]->base;
+	_http = _loops[0]->http;
 	_evws = evws_new(_base);
-	_thread = NULL;
 	_httpHandle = NULL;
 	
 #ifdef _WIN32
@@ -87,12 +181,9 @@ HTTPServer::HTTPServer(unsigned short port, unsigned short wsPort, SSLConfig* ss
 	    EVHTTP_REQ_CONNECT |
 	    EVHTTP_REQ_PATCH;
 
-	evhttp_set_allowed_methods(_http, allowedMethods); // allow all methods
-
 	if (_port > 0) {
-		_httpHandle = evhttp_bind_socket_with_handle(_http, NULL, _port);
-		if (_httpHandle) {
-			LOGD(USCXML_INFO) << "HTTP server listening on tcp/" << _port << std::endl;;
+		if (bindHTTP(allowedMethods)) {
+			LOGD(USCXML_INFO) << "HTTP server listening on tcp/" << _port << " with " << _loops.size() << " thread(s)" << std::endl;
 		} else {
 			LOGD(USCXML_ERROR) << "HTTP server cannot bind to tcp/" << _port << std::endl;
 		}
@@ -156,20 +247,62 @@ HTTPServer::HTTPServer(unsigned short port, unsigned short wsPort, SSLConfig* ss
 
 //	evhttp_set_timeout(_http, 5);
 
-	// generic callback
-	evhttp_set_gencb(_http, HTTPServer::httpRecvReqCallback, NULL);
+	// generic callback, servlets are routed by our own path trie
+	for (auto loop : _loops) {
+		evhttp_set_gencb(loop->http, HTTPServer::httpRecvReqCallback, NULL);
+	}
 	evws_set_gencb(_evws, HTTPServer::wsRecvReqCallback, NULL);
 }
 
+bool HTTPServer::bindHTTP(unsigned int allowedMethods) {
+	for (auto loop : _loops) {
+		evhttp_set_allowed_methods(loop->http, allowedMethods); // allow all methods
+	}
+
+	if (_loops.size() == 1) {
+		_loops[0]->httpHandle = evhttp_bind_socket_with_handle(_loops[0]->http, NULL, _port);
+		_httpHandle = _loops[0]->httpHandle;
+		return _httpHandle != NULL;
+	}
+
+#ifdef LEV_OPT_REUSEABLE_PORT
+	// every loop gets its own listening socket and the kernel balances connections
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	sin.sin_port = htons(_port);
+
+	for (auto loop : _loops) {
+		struct evconnlistener* listener = evconnlistener_new_bind(loop->base, NULL, NULL,
+		                                  LEV_OPT_REUSEABLE | LEV_OPT_REUSEABLE_PORT | LEV_OPT_CLOSE_ON_EXEC | LEV_OPT_CLOSE_ON_FREE,
+		                                  -1, (struct sockaddr*)&sin, sizeof(sin));
+		if (listener == NULL)
+			return false;
+		loop->httpHandle = evhttp_bind_listener(loop->http, listener);
+		if (loop->httpHandle == NULL) {
+			evconnlistener_free(listener);
+			return false;
+		}
+	}
+	_httpHandle = _loops[0]->httpHandle;
+	return true;
+#else
+	return false;
+#endif
+}
+
 HTTPServer::~HTTPServer() {
 	_isRunning = false;
-	if (_base) {
-		event_base_loopbreak(_base);
+	for (auto loop : _loops) {
+		event_base_loopbreak(loop->base);
 	}
-	if (_thread) {
-		_thread->join();
-		delete _thread;
-		_thread = nullptr;
+	for (auto loop : _loops) {
+		if (loop->thread) {
+			loop->thread->join();
+			delete loop->thread;
+			loop->thread = nullptr;
+		}
 	}
 	if (_evws) {
 		
@@ -181,14 +314,14 @@ HTTPServer::~HTTPServer() {
 		evws_free(_evws);
 		_evws = nullptr;
 	} 
-	if (_http) {
-		evhttp_free(_http);
-		_http = nullptr;
-	}
-	if (_base) {
-		event_base_free(_base);
-		_base = nullptr;
+	for (auto loop : _loops) {
+		evhttp_free(loop->http);
+		event_base_free(loop->base);
+		delete loop;
 	}
+	_loops.clear();
+	_http = nullptr;
+	_base = nullptr;
 }
 
 HTTPServer* HTTPServer::_instance = NULL;
@@ -255,9 +388,13 @@ void HTTPServer::wsRecvReqCallback(struct evws_connection *conn, struct evws_fra
 		break;
 	}
 
+	// messages may be fragmented over several frames, the last one has fin set
+	wsFrame.data.compound["fin"] = Data(frame->fin ? "true" : "false", Data::INTERPRETED);
 	wsFrame.data.compound["uri"] = Data(HTTPServer::getBaseURL(WebSockets) + conn->uri, Data::VERBATIM);
 	wsFrame.data.compound["path"] = Data(conn->uri, Data::VERBATIM);
 
+	enterServlets();
+
 	// try with the handler registered for path first
 	bool answered = false;
 	if (callbackData != NULL)
@@ -266,14 +403,13 @@ void HTTPServer::wsRecvReqCallback(struct evws_connection *conn, struct evws_fra
 	if (!answered)
 		HTTPServer::getInstance()->processByMatchingServlet(conn, wsFrame);
 
+	leaveServlets();
 }
 
 /**
  * This callback is registered for all HTTP requests
  */
 void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackData) {
-	std::stringstream raw;
-
 	struct evkeyvalq *headers;
 	headers = evhttp_request_get_input_headers(req);
 
@@ -324,7 +460,6 @@ void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackD
 		request.data.compound["type"] = Data("unknown", Data::VERBATIM);
 		break;
 	}
-	raw << boost::to_upper_copy(request.data.compound["type"].atom);
 
 	request.data.compound["remoteHost"] = Data(req->remote_host, Data::VERBATIM);
 	request.data.compound["remotePort"] = Data(toStr(req->remote_port), Data::VERBATIM);
@@ -336,13 +471,9 @@ void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackD
 	request.data.compound["path"] = Data(pathCStr, Data::VERBATIM);
 	free(pathCStr);
 
-	raw << " " << request.data.compound["path"].atom;
 	const char* query = evhttp_uri_get_query(evhttp_request_get_evhttp_uri(req));
 	if (query)
-		raw << "?" << std::string(query);
-
-	raw << " HTTP/" << request.data.compound["httpMajor"].atom << "." << request.data.compound["httpMinor"].atom;
-	raw << std::endl;
+		request.queryString = query;
 
 	struct evkeyval *header;
 	struct evbuffer *buf;
@@ -354,13 +485,11 @@ void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackD
 	for (header = headers->tqh_first; header; header = header->next.tqe_next) {
 		const std::string sKey(header->key);
 		request.data.compound["header"].compound[sKey] = Data(header->value, Data::VERBATIM);
-		raw << header->key << ": " << header->value << std::endl;
-		
+
 		if (boost::iequals(sKey, "Content-Type")) {
 			contentType = header->value;
 		}
 	}
-	raw << std::endl;
 
 	// seperate path into components
 	{
@@ -385,19 +514,14 @@ void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackD
 
 	// get content
 	buf = evhttp_request_get_input_buffer(req);
-	if (evbuffer_get_length(buf))
-		request.data.compound["content"] = Data("", Data::VERBATIM);
-	while (evbuffer_get_length(buf)) {
-		int n;
-		char cbuf[1024];
-		n = evbuffer_remove(buf, cbuf, sizeof(buf)-1);
-		if (n > 0) {
-			request.data.compound["content"].atom.append(cbuf, n);
-		}
+	size_t contentLength = evbuffer_get_length(buf);
+	if (contentLength > 0) {
+		request.content.resize(contentLength);
+		int n = evbuffer_remove(buf, &request.content[0], contentLength);
+		request.content.resize(n > 0 ? n : 0);
+		request.data.compound["content"] = Data(request.content, Data::VERBATIM);
 	}
 
-	raw << request.data.compound["content"].atom;
-
 	// decode content
 	if (!contentType.empty()) {
 		if (request.data.compound.find("content") != request.data.compound.end()) {
@@ -448,82 +572,118 @@ void HTTPServer::httpRecvReqCallback(struct evhttp_request *req, void *callbackD
 		LOGD(USCXML_ERROR) << "HTTP request require header 'Content-Type'!";
 	}
 
-	request.raw = raw.str();
+	HTTPServer::getInstance()->processByMatchingServlet(request);
+}
 
-#if 0
-	std::cout << "====" << std::endl;
-	std::cout << request.raw << std::endl;
-	std::cout << "====" << std::endl;
-#endif
+std::string HTTPServer::Request::getRaw() const {
+	std::stringstream raw;
 
-	// try with the handler registered for path first
-	bool answered = false;
-	if (callbackData != NULL)
-		answered = ((HTTPServlet*)callbackData)->requestFromHTTP(request);
+	raw << boost::to_upper_copy(data.at("type").atom);
+	raw << " " << data.at("path").atom;
+	if (queryString.size() > 0)
+		raw << "?" << queryString;
+	raw << " HTTP/" << data.at("httpMajor").atom << "." << data.at("httpMinor").atom;
+	raw << std::endl;
 
-	if (!answered)
-		HTTPServer::getInstance()->processByMatchingServlet(request);
+	if (evhttpReq != NULL) {
+		// in the order and with the repetitions they came in, the compound is sorted by name
+		struct evkeyvalq* headers = evhttp_request_get_input_headers(evhttpReq);
+		for (struct evkeyval* header = headers->tqh_first; header; header = header->next.tqe_next) {
+			raw << header->key << ": " << header->value << std::endl;
+		}
+	} else if (data.hasKey("header")) {
+		const Data& headers = data.at("header");
+		for (auto header : headers.compound) {
+			raw << header.first << ": " << header.second.atom << std::endl;
+		}
+	}
+	raw << std::endl;
+	raw << content;
+
+	return raw.str();
 }
 
+void HTTPServer::enterServlets() {
+	// odd epochs tell unregisterServlet that this loop may still hold a servlet
+	if (_currentLoop != NULL)
+		((EventLoop*)_currentLoop)->epoch++;
+}
 
-void HTTPServer::processByMatchingServlet(const Request& request) {
-	std::lock_guard<std::recursive_mutex> lock(_mutex);
+void HTTPServer::leaveEpoch(EventLoop* loop) {
+	loop->epoch++;
+	if (loop->waiting > 0) {
+		// waitForServlets checks the epoch with the mutex held, we cannot slip in between
+		std::lock_guard<std::mutex> lock(loop->servletMutex);
+		loop->servletCond.notify_all();
+	}
+}
 
-	http_servlet_iter_t servletIter = _httpServlets.begin();
+void HTTPServer::leaveServlets() {
+	if (_currentLoop != NULL)
+		leaveEpoch((EventLoop*)_currentLoop);
+}
 
-	std::string actualPath = request.data.compound.at("path").atom;
-	std::map<std::string, HTTPServlet*, comp_strsize_less> matches;
-
-	while(servletIter != _httpServlets.end()) {
-		// is the servlet path a prefix of the actual path?
-		std::string servletPath = "/" + servletIter->first;
-		if (servletIter->first.length() == 0) {
-			matches.insert(std::make_pair(servletPath, servletIter->second)); // single servlet at root
-		} else if (iequals(actualPath.substr(0, servletPath.length()), servletPath) && // servlet path is a prefix
-		           iequals(actualPath.substr(servletPath.length(), 1), "/")) {     // and next character is a '/'
-			matches.insert(std::make_pair(servletPath, servletIter->second));
+void HTTPServer::waitForServlets() {
+	EventLoop* current = (EventLoop*)_currentLoop;
+
+	// we are called from within a servlet, do not make others wait for us
+	bool isInServlet = (current != NULL && (current->epoch & 1));
+	if (isInServlet)
+		leaveEpoch(current);
+
+	for (auto loop : _loops) {
+		if (loop == current)
+			continue;
+		uint64_t epoch = loop->epoch;
+		if (epoch & 1) {
+			loop->waiting++;
+			{
+				std::unique_lock<std::mutex> lock(loop->servletMutex);
+				loop->servletCond.wait(lock, [loop, epoch]() {
+					return loop->epoch != epoch;
+				});
+			}
+			loop->waiting--;
 		}
-		servletIter++;
 	}
 
+	if (isInServlet)
+		current->epoch++;
+}
+
+void HTTPServer::processByMatchingServlet(const Request& request) {
+	std::string actualPath = request.data.compound.at("path").atom;
+
+	std::vector<HTTPServlet*> matches;
+	trieMatch(std::atomic_load(&_httpTrie), pathSegments(actualPath), matches);
+
+	enterServlets();
+
 	// process by best matching servlet until someone feels responsible
-	std::map<std::string, HTTPServlet*, comp_strsize_less>::iterator matchesIter = matches.begin();
-	while(matchesIter != matches.end()) {
-		if (matchesIter->second->requestFromHTTP(request)) {
+	for (auto matchIter = matches.rbegin(); matchIter != matches.rend(); matchIter++) {
+		if ((*matchIter)->requestFromHTTP(request)) {
+			leaveServlets();
 			return;
 		}
-		matchesIter++;
 	}
 
+	leaveServlets();
+
 	LOGD(USCXML_INFO) << "Got an HTTP request at " << actualPath << " but no servlet is registered there or at a prefix"  << std::endl;
 	evhttp_send_error(request.evhttpReq, 404, NULL);
 }
 
 void HTTPServer::processByMatchingServlet(evws_connection* conn, const WSFrame& frame) {
-	std::lock_guard<std::recursive_mutex> lock(_mutex);
-
-	ws_servlet_iter_t servletIter = _wsServlets.begin();
-
 	std::string actualPath = frame.data.compound.at("path").atom;
-	std::map<std::string, WebSocketServlet*, comp_strsize_less> matches;
-
-	while(servletIter != _wsServlets.end()) {
-		// is the servlet path a prefix of the actual path?
-		std::string servletPath = "/" + servletIter->first;
-		if (iequals(actualPath.substr(0, servletPath.length()), servletPath) && // servlet path is a prefix
-		        iequals(actualPath.substr(servletPath.length(), 1), "/")) {     // and next character is a '/'
-			matches.insert(std::make_pair(servletPath, servletIter->second));
-		}
-		servletIter++;
-	}
+
+	std::vector<WebSocketServlet*> matches;
+	trieMatch(std::atomic_load(&_wsTrie), pathSegments(actualPath), matches);
 
 	// process by best matching servlet until someone feels responsible
-	std::map<std::string, WebSocketServlet*, comp_strsize_less>::iterator matchesIter = matches.begin();
-	while(matchesIter != matches.end()) {
-		if (matchesIter->second->requestFromWS(conn, frame)) {
+	for (auto matchIter = matches.rbegin(); matchIter != matches.rend(); matchIter++) {
+		if ((*matchIter)->requestFromWS(conn, frame)) {
 			return;
 		}
-		matchesIter++;
 	}
 }
 
@@ -531,7 +691,15 @@ void HTTPServer::reply(const Reply& reply) {
 	// we need to reply from the thread calling event_base_dispatch, just add to its base queue!
 	Reply* replyCB = new Reply(reply);
 	HTTPServer* INSTANCE = getInstance();
-	event_base_once(INSTANCE->_base, -1, EV_TIMEOUT, HTTPServer::replyCallback, replyCB, NULL);
+
+	// with several loops, the connection belongs to the one that accepted it
+	struct event_base* base = INSTANCE->_base;
+	if (reply.evhttpReq != NULL) {
+		struct evhttp_connection* conn = evhttp_request_get_connection(reply.evhttpReq);
+		if (conn != NULL)
+			base = evhttp_connection_get_base(conn);
+	}
+	event_base_once(base, -1, EV_TIMEOUT, HTTPServer::replyCallback, replyCB, NULL);
 }
 
 void HTTPServer::replyCallback(evutil_socket_t fd, short what, void *arg) {
@@ -629,24 +797,28 @@ bool HTTPServer::registerServlet(const std::string& path, HTTPServlet* servlet)
 	INSTANCE->_httpServlets[suffixedPath] = servlet;
 //	LOG(USCXML_INFO) << "HTTP Servlet listening at: " << servletURL.str();
 
-	// register callback
-	evhttp_set_cb(INSTANCE->_http, ("/" + suffixedPath).c_str(), HTTPServer::httpRecvReqCallback, servlet);
+	// publish a new trie for the event loops
+	std::atomic_store(&INSTANCE->_httpTrie, trieUpdate(std::atomic_load(&INSTANCE->_httpTrie), pathSegments(suffixedPath), 0, servlet));
 
 	return true;
 }
 
 void HTTPServer::unregisterServlet(HTTPServlet* servlet) {
 	HTTPServer* INSTANCE = getInstance();
-	std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
-	http_servlet_iter_t servletIter = INSTANCE->_httpServlets.begin();
-	while(servletIter != INSTANCE->_httpServlets.end()) {
-		if (servletIter->second == servlet) {
-			evhttp_del_cb(INSTANCE->_http, std::string("/" + servletIter->first).c_str());
-			INSTANCE->_httpServlets.erase(servletIter);
-			break;
+	{
+		std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
+		http_servlet_iter_t servletIter = INSTANCE->_httpServlets.begin();
+		while(servletIter != INSTANCE->_httpServlets.end()) {
+			if (servletIter->second == servlet) {
+				std::atomic_store(&INSTANCE->_httpTrie, trieUpdate(std::atomic_load(&INSTANCE->_httpTrie), pathSegments(servletIter->first), 0, (HTTPServlet*)NULL));
+				INSTANCE->_httpServlets.erase(servletIter);
+				break;
+			}
+			servletIter++;
 		}
-		servletIter++;
 	}
+	// the servlet is usually destroyed after we return
+	INSTANCE->waitForServlets();
 }
 
 bool HTTPServer::registerServlet(const std::string& path, WebSocketServlet* servlet) {
@@ -683,24 +855,27 @@ bool HTTPServer::registerServlet(const std::string& path, WebSocketServlet* serv
 
 	//	LOG(USCXML_INFO) << "HTTP Servlet listening at: " << servletURL.str() << std::endl;
 
-	// register callback
-	evws_set_cb(INSTANCE->_evws, ("/" + suffixedPath).c_str(), HTTPServer::wsRecvReqCallback, NULL, servlet);
+	// frames are routed from the generic callback, evws would call path callbacks in addition
+	std::atomic_store(&INSTANCE->_wsTrie, trieUpdate(std::atomic_load(&INSTANCE->_wsTrie), pathSegments(suffixedPath), 0, servlet));
 
 	return true;
 }
 
 void HTTPServer::unregisterServlet(WebSocketServlet* servlet) {
 	HTTPServer* INSTANCE = getInstance();
-	std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
-	ws_servlet_iter_t servletIter = INSTANCE->_wsServlets.begin();
-	while(servletIter != INSTANCE->_wsServlets.end()) {
-		if (servletIter->second == servlet) {
-			evhttp_del_cb(INSTANCE->_http, std::string("/" + servletIter->first).c_str());
-			INSTANCE->_wsServlets.erase(servletIter);
-			break;
+	{
+		std::lock_guard<std::recursive_mutex> lock(INSTANCE->_mutex);
+		ws_servlet_iter_t servletIter = INSTANCE->_wsServlets.begin();
+		while(servletIter != INSTANCE->_wsServlets.end()) {
+			if (servletIter->second == servlet) {
+				std::atomic_store(&INSTANCE->_wsTrie, trieUpdate(std::atomic_load(&INSTANCE->_wsTrie), pathSegments(servletIter->first), 0, (WebSocketServlet*)NULL));
+				INSTANCE->_wsServlets.erase(servletIter);
+				break;
+			}
+			servletIter++;
 		}
-		servletIter++;
 	}
+	INSTANCE->waitForServlets();
 }
 
 void HTTPServer::cleanup()
@@ -733,17 +908,36 @@ std::string HTTPServer::getBaseURL(ServerType type) {
 	return servletURL.str();
 }
 
+void HTTPServer::setThreads(size_t nrThreads) {
+	_nrThreads = nrThreads;
+}
+
+void HTTPServer::setRawRequests(bool rawRequests) {
+	_rawRequestsConfigured = true;
+	_rawRequests = rawRequests;
+}
+
+bool HTTPServer::hasRawRequests() {
+	if (!_rawRequestsConfigured)
+		return !envVarIsTrue("USCXML_HTTP_NO_RAW");
+	return _rawRequests;
+}
+
 void HTTPServer::start() {
 	_isRunning = true;
-	_thread = new std::thread(HTTPServer::run, this);
+	for (auto loop : _loops) {
+		loop->thread = new std::thread(HTTPServer::run, loop);
+	}
 }
 
-void HTTPServer::run(void* instance) {
-	HTTPServer* INSTANCE = (HTTPServer*)instance;
-	while(INSTANCE->_isRunning) {
-		event_base_dispatch(INSTANCE->_base);
+void HTTPServer::run(EventLoop* loop) {
+	_currentLoop = loop;
+	while(_instance->_isRunning) {
+		event_base_dispatch(loop->base);
 	}
-	LOGD(USCXML_INFO) << "HTTP Server stopped" << std::endl;
+	_currentLoop = NULL;
+	if (loop == _instance->_loops[0])
+		LOGD(USCXML_INFO) << "HTTP Server stopped" << std::endl;
 }
 
 void HTTPServer::determineAddress() {
@@ -24,8 +24,12 @@
 
 #include <map>                          // for map, map<>::iterator, etc
 #include <string>                       // for string, operator<
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 extern "C" {
 #include "event2/util.h"                // for evutil_socket_t
@@ -47,9 +51,14 @@ public:
 	class Request : public Event {
 	public:
 		Request() : evhttpReq(NULL) {}
-		std::string content;
+		std::string content; ///< the undecoded request body
+		std::string queryString;
 		struct evhttp_request* evhttpReq;
 
+		/// Assemble the raw HTTP request on demand, it is not built per request.
+		/// Headers keep their wire order as long as the request was not replied to.
+		std::string getRaw() const;
+
 		operator bool() {
 			return evhttpReq != NULL;
 		}
@@ -105,6 +114,12 @@ public:
 
 	static void cleanup();
 
+	/// Number of event loops accepting HTTP connections, set before the first getInstance()
+	static void setThreads(size_t nrThreads);
+	/// Whether servlets should pass the raw request on with their events
+	static void setRawRequests(bool rawRequests);
+	static bool hasRawRequests();
+
 	static std::string getBaseURL(ServerType type = HTTP);
 
 	static void reply(const Reply& reply);
@@ -134,13 +149,28 @@ private:
 		evws_opcode opcode;
 	};
 
-	struct comp_strsize_less {
-		bool operator()(std::string const& l, std::string const& r) const {
-			if (l.size() < r.size())
-				return false;
-			return true;
-//			return l < r;
-		};
+	/**
+	 * Immutable node of the servlet path trie. Registering or unregistering copies
+	 * the nodes along the path and publishes a new root, lookups never lock.
+	 */
+	template <typename T>
+	struct ServletNode {
+		ServletNode() : servlet(NULL) {}
+		T* servlet;
+		std::map<std::string, std::shared_ptr<const ServletNode<T> > > children;
+	};
+
+	class EventLoop {
+	public:
+		EventLoop() : base(NULL), http(NULL), httpHandle(NULL), thread(NULL), epoch(0), waiting(0) {}
+		struct event_base* base;
+		struct evhttp* http;
+		struct evhttp_bound_socket* httpHandle;
+		std::thread* thread;
+		std::atomic<uint64_t> epoch; ///< odd while a servlet is being called from this loop
+		std::atomic<size_t> waiting; ///< threads in waitForServlets, leaving servlets only notifies if any
+		std::mutex servletMutex;
+		std::condition_variable servletCond;
 	};
 
 	HTTPServer(unsigned short port, unsigned short wsPort, SSLConfig* sslConf);
@@ -148,7 +178,13 @@ private:
 
 	void start();
 	void stop();
-	static void run(void* instance);
+	static void run(EventLoop* loop);
+
+	bool bindHTTP(unsigned int allowedMethods);
+	static void enterServlets();
+	static void leaveServlets();
+	static void leaveEpoch(EventLoop* loop);
+	void waitForServlets();
 
 	void determineAddress();
 
@@ -164,9 +200,17 @@ private:
 	static std::map<std::string, std::string> mimeTypes;
 	std::map<std::string, HTTPServlet*> _httpServlets;
 	typedef std::map<std::string, HTTPServlet*>::iterator http_servlet_iter_t;
+	std::shared_ptr<const ServletNode<HTTPServlet> > _httpTrie;
 
 	std::map<std::string, WebSocketServlet*> _wsServlets;
 	typedef std::map<std::string, WebSocketServlet*>::iterator ws_servlet_iter_t;
+	std::shared_ptr<const ServletNode<WebSocketServlet> > _wsTrie;
+
+	// the first loop also serves websockets, https and replies
+	std::vector<EventLoop*> _loops;
+	static size_t _nrThreads;
+	static bool _rawRequests;
+	static bool _rawRequestsConfigured;
 
 	struct event_base* _base = nullptr;
 	struct evhttp* _http = nullptr;
@@ -181,7 +225,6 @@ private:
 
 	static HTTPServer* _instance;
 
-	std::thread* _thread = nullptr;
 	std::recursive_mutex _mutex;
 	bool _isRunning;
 
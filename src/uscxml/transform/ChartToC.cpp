@@ -37,6 +37,26 @@ using namespace XERCESC_NS;
 
 // many more tricks: https://graphics.stanford.edu/~seander/bithacks.html
 
+/// FNV-1a, has to be the same as in the generated uscxml_event_id
+static uint32_t eventHash(uint32_t seed, const std::string& name) {
+	uint32_t hash = 2166136261u ^ seed;
+	for (size_t i = 0; i < name.size(); i++) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/// strip a trailing * and dot as nameMatch does, the empty descriptor matches all events
+static std::string normalizeEventDescriptor(const std::string& descriptor) {
+	std::string normalized = descriptor;
+	if (boost::ends_with(normalized, "*"))
+		normalized = normalized.substr(0, normalized.size() - 1);
+	if (boost::ends_with(normalized, "."))
+		normalized = normalized.substr(0, normalized.size() - 1);
+	return normalized;
+}
+
 Transformer ChartToC::transform(const Interpreter& other) {
 	ChartToC* c2c = new ChartToC(other);
 
@@ -422,6 +442,72 @@ void ChartToC::prepare() {
 		_transDataType = "uint64_t";
 	}
 
+	prepareEvents();
+}
+
+void ChartToC::prepareEvents() {
+	// all event descriptors per transition in priority order
+	std::vector<std::list<std::string> > transDescriptors(_transitions.size());
+	std::set<std::string> descriptors;
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		if (!HAS_ATTR(_transitions[i], kXMLCharEvent))
+			continue;
+		std::list<std::string> tokens = tokenize(ATTR(_transitions[i], kXMLCharEvent));
+		for (auto& token : tokens) {
+			transDescriptors[i].push_back(normalizeEventDescriptor(token));
+			if (transDescriptors[i].back().size() > 0)
+				descriptors.insert(transDescriptors[i].back());
+		}
+	}
+
+	_events.clear();
+	_events.push_back("");
+	_events.insert(_events.end(), descriptors.begin(), descriptors.end());
+
+	/**
+	 * An event is identified by the longest descriptor matching it, every
+	 * shorter descriptor matching the event is a prefix of this one. Unknown
+	 * events only enable transitions with a wildcard.
+	 */
+	_eventTransBools.clear();
+	for (size_t id = 0; id < _events.size(); id++) {
+		const std::string& event = _events[id];
+		std::string transBools;
+		for (size_t i = 0; i < _transitions.size(); i++) {
+			bool matches = false;
+			for (auto& descriptor : transDescriptors[i]) {
+				if (descriptor.size() == 0 ||
+				        (id > 0 && boost::starts_with(event, descriptor) &&
+				         (event.size() == descriptor.size() || event[descriptor.size()] == '.'))) {
+					matches = true;
+					break;
+				}
+			}
+			transBools += (matches ? "1" : "0");
+		}
+		_eventTransBools.push_back(transBools);
+	}
+
+	// find a seed for a collision free hash into twice as many slots as there are descriptors
+	size_t nrSlots = 1;
+	while (nrSlots < 2 * descriptors.size())
+		nrSlots <<= 1;
+
+	while(true) {
+		for (_eventSeed = 0; _eventSeed < 4096; _eventSeed++) {
+			_eventSlots.assign(nrSlots, 0);
+			size_t id = 1;
+			for (; id < _events.size(); id++) {
+				size_t slot = eventHash(_eventSeed, _events[id]) & (nrSlots - 1);
+				if (_eventSlots[slot] != 0)
+					break;
+				_eventSlots[slot] = id;
+			}
+			if (id == _events.size())
+				return;
+		}
+		nrSlots <<= 1;
+	}
 }
 
 void ChartToC::writeTo(std::ostream& stream) {
@@ -444,15 +530,68 @@ void ChartToC::writeTo(std::ostream& stream) {
 		(*machIter)->writeExecContent(stream);
 		(*machIter)->writeStates(stream);
 		(*machIter)->writeTransitions(stream);
+		(*machIter)->writeEvents(stream);
 		(*machIter)->writeMachineInfo(stream);
 	}
 	writeHelpers(stream);
 	writeFSM(stream);
+	if (_extensions.find("batch") != _extensions.end() && _extensions.find("batch")->second == "soa") {
+		writeBatch(stream);
+	}
 
 	//    http://stackoverflow.com/questions/2525310/how-to-define-and-work-with-an-array-of-bits-in-c
 
 }
 
+void ChartToC::writeTypesHeader(std::ostream& stream) {
+	// the macros and types of an empty chart, with bitsets large enough for the machines of a host
+	ChartToC types(Interpreter::fromXML("<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" />", ""));
+	types._stateDataType = "uint16_t";
+	types._transDataType = "uint16_t";
+	types._stateCharArraySize = 32;
+	types._transCharArraySize = 64;
+	types._extensions.insert(std::make_pair("bitset", "words"));
+
+	stream << "/**" << std::endl;
+	stream << " * The macros and types of the C code generated by ChartToC, shared by all" << std::endl;
+	stream << " * machines hosted by the uscxml_native library. Written by ChartToC::writeTypesHeader" << std::endl;
+	stream << " * when building uscxml, do not edit." << std::endl;
+	stream << " *" << std::endl;
+	stream << " * Include this header before any generated machine, which will then skip" << std::endl;
+	stream << " * its own macros and types. Every machine has to fit the bitsets sized" << std::endl;
+	stream << " * below and the library has to be built with the same values, i.e. if you" << std::endl;
+	stream << " * predefine any of the USCXML_NR_* or USCXML_MAX_NR_* macros or pick" << std::endl;
+	stream << " * USCXML_BITSET_BYTES, do so for the library as well. NativeRuntime" << std::endl;
+	stream << " * rejects machines and contexts that do not fit." << std::endl;
+	stream << " */" << std::endl;
+	stream << std::endl;
+	stream << "#ifndef NATIVETYPES_H_81C5A7E2" << std::endl;
+	stream << "#define NATIVETYPES_H_81C5A7E2" << std::endl;
+	stream << std::endl;
+	stream << "#ifdef USCXML_NO_GEN_C_TYPES" << std::endl;
+	stream << "#  error \"Include uscxml/native/NativeTypes.h before any generated machine\"" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	types.writeIncludes(stream);
+	types.writeMacros(stream);
+	types.writeTypes(stream);
+
+	stream << "#ifdef __cplusplus" << std::endl;
+	stream << "extern \"C\" {" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+	stream << "/* defined by the one generated machine compiled without USCXML_NO_STEP_FUNCTION */" << std::endl;
+	stream << "int uscxml_step(uscxml_ctx* ctx);" << std::endl;
+	stream << "int uscxml_event_id(const uscxml_machine* machine, const char* name);" << std::endl;
+	stream << std::endl;
+	stream << "#ifdef __cplusplus" << std::endl;
+	stream << "}" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+	stream << "#endif /* end of include guard: NATIVETYPES_H_81C5A7E2 */" << std::endl;
+}
+
 void ChartToC::writeForwardDeclarations(std::ostream& stream) {
 	stream << "/* forward declare machines to allow references */" << std::endl;
 	for (std::list<ChartToC*>::iterator machIter = _allMachines.begin(); machIter != _allMachines.end(); machIter++) {
@@ -552,6 +691,30 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << "#endif " << std::endl;
 	stream << std::endl;
 
+	stream << "/**" << std::endl;
+	stream << " *    USCXML_BITSET_WORDS" << std::endl;
+	stream << " *      operate on bitsets a 64 bit word at a time and iterate their set bits" << std::endl;
+	stream << " *      by counting trailing zeros. Bitsets are padded to whole words and" << std::endl;
+	stream << " *      aligned, the USCXML_MAX_NR_*_BYTES macros below have to be multiples" << std::endl;
+	stream << " *      of 8 then. Leave undefined or define USCXML_BITSET_BYTES for 8-bit" << std::endl;
+	stream << " *      targets, where single bytes are faster." << std::endl;
+	stream << " */" << std::endl;
+	stream << std::endl;
+
+	// batches of instances keep their bitsets as words
+	if ((_extensions.find("bitset") != _extensions.end() && _extensions.find("bitset")->second == "words") ||
+	        (_extensions.find("batch") != _extensions.end() && _extensions.find("batch")->second == "soa")) {
+		stream << "#if !defined(USCXML_BITSET_WORDS) && !defined(USCXML_BITSET_BYTES)" << std::endl;
+		stream << "#  define USCXML_BITSET_WORDS" << std::endl;
+		stream << "#endif" << std::endl;
+		stream << std::endl;
+	}
+
+	stream << "#if defined(USCXML_BITSET_WORDS) && (defined(USCXML_BITSET_BYTES) || !(defined(__GNUC__) || defined(_MSC_VER)))" << std::endl;
+	stream << "#  undef USCXML_BITSET_WORDS /* no way to align bitsets */" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
 	stream << "/** " << std::endl;
 	stream << " *    USCXML_MAX_NR_STATES_BYTES" << std::endl;
 	stream << " *      the smallest multiple of 8 that, if multiplied by 8," << std::endl;
@@ -565,7 +728,11 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "#ifndef USCXML_MAX_NR_STATES_BYTES " << std::endl;
-	stream << "#  define USCXML_MAX_NR_STATES_BYTES " << (std::max)((size_t)1, _stateCharArraySize) << std::endl;
+	stream << "#  ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "#    define USCXML_MAX_NR_STATES_BYTES " << (std::max)((size_t)8, ((_stateCharArraySize + 7) / 8) * 8) << std::endl;
+	stream << "#  else" << std::endl;
+	stream << "#    define USCXML_MAX_NR_STATES_BYTES " << (std::max)((size_t)1, _stateCharArraySize) << std::endl;
+	stream << "#  endif" << std::endl;
 	stream << "#endif " << std::endl;
 	stream << std::endl;
 
@@ -576,7 +743,11 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "#ifndef USCXML_MAX_NR_TRANS_BYTES " << std::endl;
-	stream << "#  define USCXML_MAX_NR_TRANS_BYTES " << (std::max)((size_t)1, _transCharArraySize) << std::endl;
+	stream << "#  ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "#    define USCXML_MAX_NR_TRANS_BYTES " << (std::max)((size_t)8, ((_transCharArraySize + 7) / 8) * 8) << std::endl;
+	stream << "#  else" << std::endl;
+	stream << "#    define USCXML_MAX_NR_TRANS_BYTES " << (std::max)((size_t)1, _transCharArraySize) << std::endl;
+	stream << "#  endif" << std::endl;
 	stream << "#endif " << std::endl;
 	stream << std::endl;
 
@@ -613,6 +784,44 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << "#  define USCXML_GET_TRANS(i) (ctx->machine->transitions[i])" << std::endl;
 	stream << "#endif" << std::endl;
 	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " *    USCXML_ON_ENTRY / USCXML_ON_EXIT / USCXML_ON_TRANS / USCXML_INVOKE / USCXML_INIT_DATA / USCXML_ON_SCRIPT" << std::endl;
+	stream << " *      Per default the executable content, invocations and data of states and transitions" << std::endl;
+	stream << " *      are processed via the function pointers in the machine info, but a host processing" << std::endl;
+	stream << " *      them on its own can hook every state entered or exited and every transition taken." << std::endl;
+	stream << " */" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_ON_ENTRY" << std::endl;
+	stream << "#  define USCXML_ON_ENTRY(i) (USCXML_GET_STATE(i).on_entry != NULL ? USCXML_GET_STATE(i).on_entry(ctx, &USCXML_GET_STATE(i), ctx->event) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_ON_EXIT" << std::endl;
+	stream << "#  define USCXML_ON_EXIT(i) (USCXML_GET_STATE(i).on_exit != NULL ? USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_ON_TRANS" << std::endl;
+	stream << "#  define USCXML_ON_TRANS(i, state) (USCXML_GET_TRANS(i).on_transition != NULL ? USCXML_GET_TRANS(i).on_transition(ctx, &USCXML_GET_STATE(state), ctx->event) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_INVOKE" << std::endl;
+	stream << "#  define USCXML_INVOKE(i, uninvoke) (USCXML_GET_STATE(i).invoke != NULL ? USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, uninvoke) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_INIT_DATA" << std::endl;
+	stream << "#  define USCXML_INIT_DATA(i) (USCXML_GET_STATE(i).data != NULL && ctx->exec_content_init != NULL ? ctx->exec_content_init(ctx, USCXML_GET_STATE(i).data) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef USCXML_ON_SCRIPT" << std::endl;
+	stream << "#  define USCXML_ON_SCRIPT() (ctx->machine->script != NULL ? ctx->machine->script(ctx, &USCXML_GET_STATE(0), NULL) : USCXML_ERR_OK)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
 	stream << std::endl;
 	stream << "/* Common macros below */"<< std::endl;
 	stream << std::endl;
@@ -622,6 +831,29 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << "#define BIT_CLEAR(idx, bitset)   bitset[idx >> 3] &= (1 << (idx & 7)) ^ 0xFF;" << std::endl;
 	stream << std::endl;
 
+	stream << "/* visit the set bits of a bitset in ascending order, bits set ahead of idx are visited as well */" << std::endl;
+	stream << "#ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "#  ifdef _MSC_VER" << std::endl;
+	stream << "#    define USCXML_BITSET_ALIGNED __declspec(align(8))" << std::endl;
+	stream << "#  else" << std::endl;
+	stream << "#    define USCXML_BITSET_ALIGNED __attribute__((aligned(8)))" << std::endl;
+	stream << "#  endif" << std::endl;
+	stream << "#  define BIT_FOR_EACH(idx, bitset, nr_bits) \\" << std::endl;
+	stream << "    for (idx = bit_next(bitset, 0, nr_bits); idx < nr_bits; idx = bit_next(bitset, idx + 1, nr_bits))" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "#  define USCXML_BITSET_ALIGNED" << std::endl;
+	stream << "#  define BIT_FOR_EACH(idx, bitset, nr_bits) \\" << std::endl;
+	stream << "    for (idx = 0; idx < nr_bits; idx++) if (BIT_HAS(idx, bitset))" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 8)" << std::endl;
+	stream << "#  define USCXML_UNROLL _Pragma(\"GCC unroll 8\")" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "#  define USCXML_UNROLL" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
 	stream << "#ifdef __GNUC__" << std::endl;
 	stream << "#  define likely(x)       (__builtin_expect(!!(x), 1))" << std::endl;
 	stream << "#  define unlikely(x)     (__builtin_expect(!!(x), 0))" << std::endl;
@@ -650,6 +882,9 @@ void ChartToC::writeMacros(std::ostream& stream) {
 	stream << "#define USCXML_TRANS_INITIAL          0x10" << std::endl;
 	stream << std::endl;
 
+	stream << "#define USCXML_EVENT_UNKNOWN          0" << std::endl;
+	stream << std::endl;
+
 	stream << "#define USCXML_STATE_ATOMIC           0x01" << std::endl;
 	stream << "#define USCXML_STATE_PARALLEL         0x02" << std::endl;
 	stream << "#define USCXML_STATE_COMPOUND         0x03" << std::endl;
@@ -681,6 +916,11 @@ void ChartToC::writeMacros(std::ostream& stream) {
 
 void ChartToC::writeTypes(std::ostream& stream) {
 
+	stream << std::endl;
+	stream << "/* types predefined by a host, e.g. in uscxml/native/NativeTypes.h, have to be of the same version */" << std::endl;
+	stream << "#if defined(USCXML_GEN_C_TYPES_VERSION) && USCXML_GEN_C_TYPES_VERSION != " << USCXML_GEN_C_TYPES_VERSION << std::endl;
+	stream << "#  error \"Predefined types are of another version than the generated code\"" << std::endl;
+	stream << "#endif" << std::endl;
 	stream << std::endl;
 	stream << "#ifndef USCXML_NO_GEN_C_TYPES" << std::endl;
 	stream << std::endl;
@@ -695,6 +935,7 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "typedef struct uscxml_state uscxml_state;" << std::endl;
 	stream << "typedef struct uscxml_ctx uscxml_ctx;" << std::endl;
 	stream << "typedef struct uscxml_elem_invoke uscxml_elem_invoke;" << std::endl;
+	stream << "typedef struct uscxml_events uscxml_events;" << std::endl;
 	stream << std::endl;
 
 	stream << "typedef struct uscxml_elem_send uscxml_elem_send;" << std::endl;
@@ -709,6 +950,7 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "typedef void* (*dequeue_external_t)(const uscxml_ctx* ctx);" << std::endl;
 	stream << "typedef int (*is_enabled_t)(const uscxml_ctx* ctx, const uscxml_transition* transition);" << std::endl;
 	stream << "typedef int (*is_matched_t)(const uscxml_ctx* ctx, const uscxml_transition* transition, const void* event);" << std::endl;
+	stream << "typedef int (*event_id_t)(const uscxml_ctx* ctx, const void* event);" << std::endl;
 	stream << "typedef int (*is_true_t)(const uscxml_ctx* ctx, const char* expr);" << std::endl;
 	stream << "typedef int (*exec_content_t)(const uscxml_ctx* ctx, const uscxml_state* state, const void* event);" << std::endl;
 	stream << "typedef int (*raise_done_event_t)(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata);" << std::endl;
@@ -743,6 +985,21 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "    const uscxml_machine*       parent;" << std::endl;
 	stream << "    const uscxml_elem_donedata* donedata;" << std::endl;
 	stream << "    const exec_content_t        script;          /* Global script elements */" << std::endl;
+	stream << "    const uscxml_events*        events;          /* Event ids of all descriptors */" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * All event descriptors of a machine's transitions by event id. An event's" << std::endl;
+	stream << " * id is the one of the longest descriptor matching it, see uscxml_event_id." << std::endl;
+	stream << " */" << std::endl;
+	stream << "struct uscxml_events {" << std::endl;
+	stream << "    const unsigned int nr_events;      /* including USCXML_EVENT_UNKNOWN */" << std::endl;
+	stream << "    const uint32_t seed;               /* of the perfect hash */" << std::endl;
+	stream << "    const unsigned int nr_slots;       /* power of two */" << std::endl;
+	stream << "    const char* const* names;          /* descriptor per event id */" << std::endl;
+	stream << "    const unsigned int* slots;         /* event id per hash slot */" << std::endl;
+	stream << "    const unsigned char* transitions;  /* USCXML_MAX_NR_TRANS_BYTES of enabled transitions per event id */" << std::endl;
 	stream << "};" << std::endl;
 	stream << std::endl;
 
@@ -778,9 +1035,9 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "    const exec_content_t on_entry;                     /* on entry handlers      */" << std::endl;
 	stream << "    const exec_content_t on_exit;                      /* on exit handlers       */" << std::endl;
 	stream << "    const invoke_t invoke;                             /* invocations            */" << std::endl;
-	stream << "    const unsigned char children[USCXML_MAX_NR_STATES_BYTES];   /* all children           */" << std::endl;
-	stream << "    const unsigned char completion[USCXML_MAX_NR_STATES_BYTES]; /* default completion     */" << std::endl;
-	stream << "    const unsigned char ancestors[USCXML_MAX_NR_STATES_BYTES];  /* all ancestors          */" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char children[USCXML_MAX_NR_STATES_BYTES];   /* all children           */" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char completion[USCXML_MAX_NR_STATES_BYTES]; /* default completion     */" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char ancestors[USCXML_MAX_NR_STATES_BYTES];  /* all ancestors          */" << std::endl;
 	stream << "    const uscxml_elem_data* data;                      /* data with late binding */" << std::endl;
 	stream << "    const unsigned char type;                          /* One of USCXML_STATE_*  */" << std::endl;
 	stream << "};" << std::endl;
@@ -791,14 +1048,14 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << " */" << std::endl;
 	stream << "struct uscxml_transition {" << std::endl;
 	stream << "    const USCXML_NR_STATES_TYPE source;" << std::endl;
-	stream << "    const unsigned char target[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char target[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
 	stream << "    const char* event;" << std::endl;
 	stream << "    const char* condition;" << std::endl;
 	stream << "    const is_enabled_t is_enabled;" << std::endl;
 	stream << "    const exec_content_t on_transition;" << std::endl;
 	stream << "    const unsigned char type;" << std::endl;
-	stream << "    const unsigned char conflicts[USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
-	stream << "    const unsigned char exit_set[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char conflicts[USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED const unsigned char exit_set[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
 	stream << "};" << std::endl;
 	stream << std::endl;
 
@@ -884,10 +1141,10 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "    unsigned char         flags;" << std::endl;
 	stream << "    const uscxml_machine* machine;" << std::endl;
 	stream << std::endl;
-	stream << "    unsigned char config[USCXML_MAX_NR_STATES_BYTES]; /* Make sure these macros specify a sufficient size */" << std::endl;
-	stream << "    unsigned char history[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
-	stream << "    unsigned char invocations[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
-	stream << "    unsigned char initialized_data[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char config[USCXML_MAX_NR_STATES_BYTES]; /* Make sure these macros specify a sufficient size */" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char history[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char invocations[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char initialized_data[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
 	stream << std::endl;
 	stream << "    void* user_data;" << std::endl;
 	stream << "    void* event;" << std::endl;
@@ -895,6 +1152,7 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "    dequeue_internal_t dequeue_internal;" << std::endl;
 	stream << "    dequeue_external_t dequeue_external;" << std::endl;
 	stream << "    is_matched_t       is_matched;" << std::endl;
+	stream << "    event_id_t         event_id;         /* optional, replaces is_matched */" << std::endl;
 	stream << "    is_true_t          is_true;" << std::endl;
 	stream << "    raise_done_event_t raise_done_event;" << std::endl;
 	stream << std::endl;
@@ -912,6 +1170,7 @@ void ChartToC::writeTypes(std::ostream& stream) {
 	stream << "    invoke_t invoke;" << std::endl;
 	stream << "};" << std::endl;
 	stream << std::endl;
+	stream << "#define USCXML_GEN_C_TYPES_VERSION " << USCXML_GEN_C_TYPES_VERSION << std::endl;
 	stream << "#define USCXML_NO_GEN_C_TYPES" << std::endl;
 	stream << "#endif" << std::endl;
 	stream << std::endl;
@@ -954,6 +1213,153 @@ void ChartToC::writeHelpers(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "#ifndef USCXML_NO_BIT_OPERATIONS" << std::endl;
+	stream << "#ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "/**" << std::endl;
+	stream << " * Bitsets are still addressed as bytes by BIT_HAS and friends, words may alias them." << std::endl;
+	stream << " */" << std::endl;
+	stream << "#ifdef _MSC_VER" << std::endl;
+	stream << "typedef uint64_t uscxml_bitset_word;" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "typedef uint64_t __attribute__((__may_alias__)) uscxml_bitset_word;" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "/* bit idx of a word is bit idx of the bitset on little endian machines only */" << std::endl;
+	stream << "#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__" << std::endl;
+	stream << "#  define USCXML_WORD_LE(word) __builtin_bswap64(word)" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "#  define USCXML_WORD_LE(word) (word)" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Number of trailing zeros in a non-zero word." << std::endl;
+	stream << " */" << std::endl;
+	stream << "#ifdef __GNUC__" << std::endl;
+	stream << "#  define bit_ctz(word) ((size_t)__builtin_ctzll(word))" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "static size_t bit_ctz(uint64_t word) {" << std::endl;
+	stream << "    /* de Bruijn sequence, the isolated lowest bit selects a unique index */" << std::endl;
+	stream << "    static const unsigned char positions[64] = {" << std::endl;
+	stream << "        0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4," << std::endl;
+	stream << "        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5," << std::endl;
+	stream << "        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11," << std::endl;
+	stream << "        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6" << std::endl;
+	stream << "    };" << std::endl;
+	stream << "    return positions[((word & (0 - word)) * 0x03F79D71B4CB0A89ULL) >> 58];" << std::endl;
+	stream << "}" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Index of the first bit set in a at or after idx, nr_bits if there is none." << std::endl;
+	stream << " */" << std::endl;
+	stream << "static size_t bit_next(const unsigned char* a, size_t idx, size_t nr_bits) {" << std::endl;
+	stream << "    const uscxml_bitset_word* words = (const uscxml_bitset_word*)a;" << std::endl;
+	stream << "    size_t nr_words = (nr_bits + 63) >> 6;" << std::endl;
+	stream << "    size_t i = idx >> 6;" << std::endl;
+	stream << "    uint64_t word;" << std::endl;
+	stream << std::endl;
+	stream << "    if (i >= nr_words)" << std::endl;
+	stream << "        return nr_bits;" << std::endl;
+	stream << "    word = USCXML_WORD_LE(words[i]) & (~(uint64_t)0 << (idx & 63));" << std::endl;
+	stream << "    while (word == 0) {" << std::endl;
+	stream << "        if (++i >= nr_words)" << std::endl;
+	stream << "            return nr_bits;" << std::endl;
+	stream << "        word = USCXML_WORD_LE(words[i]);" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    idx = (i << 6) + bit_ctz(word);" << std::endl;
+	stream << "    return (idx < nr_bits ? idx : nr_bits);" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * The operations below are the ones for bytes, only a word at a time. The" << std::endl;
+	stream << " * number of bytes i is a multiple of 8 and, as it is USCXML_MAX_NR_*_BYTES," << std::endl;
+	stream << " * constant for the compiler to unroll or vectorize the loops." << std::endl;
+	stream << " */" << std::endl;
+	stream << "static int bit_has_and(const unsigned char* a, const unsigned char* b, size_t i) {" << std::endl;
+	stream << "    const uscxml_bitset_word* wa = (const uscxml_bitset_word*)a;" << std::endl;
+	stream << "    const uscxml_bitset_word* wb = (const uscxml_bitset_word*)b;" << std::endl;
+	stream << "    uint64_t common = 0;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        common |= wa[i] & wb[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return common != 0;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static void bit_clear_all(unsigned char* a, size_t i) {" << std::endl;
+	stream << "    uscxml_bitset_word* wa = (uscxml_bitset_word*)a;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        wa[i] = 0;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static int bit_has_any(unsigned const char* a, size_t i) {" << std::endl;
+	stream << "    const uscxml_bitset_word* wa = (const uscxml_bitset_word*)a;" << std::endl;
+	stream << "    uint64_t any = 0;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        any |= wa[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return any != 0;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static void bit_or(unsigned char* dest, const unsigned char* mask, size_t i) {" << std::endl;
+	stream << "    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;" << std::endl;
+	stream << "    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        wd[i] |= wm[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static void bit_copy(unsigned char* dest, const unsigned char* source, size_t i) {" << std::endl;
+	stream << "    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;" << std::endl;
+	stream << "    const uscxml_bitset_word* ws = (const uscxml_bitset_word*)source;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        wd[i] = ws[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static void bit_and_not(unsigned char* dest, const unsigned char* mask, size_t i) {" << std::endl;
+	stream << "    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;" << std::endl;
+	stream << "    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        wd[i] &= ~wm[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "static void bit_and(unsigned char* dest, const unsigned char* mask, size_t i) {" << std::endl;
+	stream << "    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;" << std::endl;
+	stream << "    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;" << std::endl;
+	stream << "    i >>= 3;" << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    while(i--) {" << std::endl;
+	stream << "        wd[i] &= wm[i];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "#else /* USCXML_BITSET_WORDS */" << std::endl;
+	stream << std::endl;
+
 	stream << "/**" << std::endl;
 	stream << " * Return true if there is a common bit in a and b." << std::endl;
 	stream << " */" << std::endl;
@@ -1029,6 +1435,7 @@ void ChartToC::writeHelpers(std::ostream& stream) {
 	stream << "    };" << std::endl;
 	stream << "}" << std::endl;
 	stream << std::endl;
+	stream << "#endif /* USCXML_BITSET_WORDS */" << std::endl;
 	stream << "#define USCXML_NO_BIT_OPERATIONS" << std::endl;
 	stream << "#endif" << std::endl;
 	stream << std::endl;
@@ -1864,11 +2271,12 @@ void ChartToC::writeMachineInfo(std::ostream& stream) {
 	stream << "        /* donedata       */ " << "&" << _prefix << "_elem_donedatas[0], " << std::endl;
 	stream << "        /* script         */ ";
 	if (DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "script", _scxml).size() > 0) {
-		stream << _prefix << "_global_script" << std::endl;
+		stream << _prefix << "_global_script";
 	} else {
 		stream << "NULL";
 	}
-	stream << std::endl;
+	stream << "," << std::endl;
+	stream << "        /* events         */ " << "&" << _prefix << "_events" << std::endl;
 
 	stream << "};" << std::endl;
 	stream << std::endl;
@@ -2131,6 +2539,73 @@ void ChartToC::writeTransitions(std::ostream& stream) {
 
 }
 
+void ChartToC::writeEvents(std::ostream& stream) {
+	stream << "#ifndef USCXML_NO_ELEM_INFO" << std::endl;
+	stream << std::endl;
+
+	if (_events.size() > 1) {
+		std::set<std::string> identifiers;
+		stream << "enum {" << std::endl;
+		for (size_t id = 1; id < _events.size(); id++) {
+			std::string identifier = _events[id];
+			for (size_t i = 0; i < identifier.size(); i++) {
+				if (!isalnum((unsigned char)identifier[i]))
+					identifier[i] = '_';
+			}
+			if (identifiers.find(identifier) != identifiers.end())
+				identifier += "_" + toStr(id);
+			identifiers.insert(identifier);
+
+			stream << "    " << _prefix << "_event_" << identifier << " = " << toStr(id) << (id + 1 < _events.size() ? "," : "");
+			stream << " /* " << _events[id] << " */" << std::endl;
+		}
+		stream << "};" << std::endl;
+		stream << std::endl;
+	}
+
+	stream << "static const char* const " << _prefix << "_event_names[" << toStr(_events.size()) << "] = {" << std::endl;
+	for (size_t id = 0; id < _events.size(); id++) {
+		stream << "    \"" << escape(_events[id]) << "\"" << (id + 1 < _events.size() ? "," : "") << std::endl;
+	}
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "static const unsigned int " << _prefix << "_event_slots[" << toStr(_eventSlots.size()) << "] = {" << std::endl;
+	stream << "    ";
+	for (size_t i = 0; i < _eventSlots.size(); i++) {
+		stream << toStr(_eventSlots[i]) << (i + 1 < _eventSlots.size() ? ", " : "");
+	}
+	stream << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "static USCXML_BITSET_ALIGNED const unsigned char " << _prefix << "_event_transitions[" << toStr(_events.size()) << "][USCXML_MAX_NR_TRANS_BYTES] = {" << std::endl;
+	for (size_t id = 0; id < _events.size(); id++) {
+		stream << "    { ";
+		if (_eventTransBools[id].size() > 0) {
+			writeCharArrayInitList(stream, _eventTransBools[id]);
+		} else {
+			stream << "0x00";
+		}
+		stream << " /* " << (id == 0 ? "unknown" : _events[id]) << ": " << _eventTransBools[id] << " */ }" << (id + 1 < _events.size() ? "," : "") << std::endl;
+	}
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "static const uscxml_events " << _prefix << "_events = {" << std::endl;
+	stream << "    /* nr_events   */ " << toStr(_events.size()) << "," << std::endl;
+	stream << "    /* seed        */ " << toStr(_eventSeed) << "," << std::endl;
+	stream << "    /* nr_slots    */ " << toStr(_eventSlots.size()) << "," << std::endl;
+	stream << "    /* names       */ &" << _prefix << "_event_names[0]," << std::endl;
+	stream << "    /* slots       */ &" << _prefix << "_event_slots[0]," << std::endl;
+	stream << "    /* transitions */ &" << _prefix << "_event_transitions[0][0]" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+}
+
 void ChartToC::writeCharArrayInitList(std::ostream& stream, const std::string& boolString) {
 	/**
 	 * 0111 -> 0x08
@@ -2175,20 +2650,65 @@ void ChartToC::writeCharArrayInitList(std::ostream& stream, const std::string& b
 
 void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "#ifndef USCXML_NO_STEP_FUNCTION" << std::endl;
+	stream << "/**" << std::endl;
+	stream << " * Id of the longest of the machine's event descriptors matching the given" << std::endl;
+	stream << " * event name, USCXML_EVENT_UNKNOWN if there is none and -1 if the machine" << std::endl;
+	stream << " * has no event ids." << std::endl;
+	stream << " */" << std::endl;
+	stream << "int uscxml_event_id(const uscxml_machine* machine, const char* name) {" << std::endl;
+	stream << "    const uscxml_events* events = machine->events;" << std::endl;
+	stream << "    const char* descriptor;" << std::endl;
+	stream << "    unsigned int candidate;" << std::endl;
+	stream << "    uint32_t hash;" << std::endl;
+	stream << "    size_t i, j;" << std::endl;
+	stream << "    int event_id = USCXML_EVENT_UNKNOWN;" << std::endl;
+	stream << std::endl;
+	stream << "    if (events == NULL || name == NULL)" << std::endl;
+	stream << "        return -1;" << std::endl;
+	stream << std::endl;
+	stream << "    /* FNV-1a, every prefix up to a dot or the end might be a descriptor */" << std::endl;
+	stream << "    hash = 2166136261UL ^ events->seed;" << std::endl;
+	stream << "    for (i = 0; ; i++) {" << std::endl;
+	stream << "        if (name[i] == '.' || name[i] == '\\0') {" << std::endl;
+	stream << "            candidate = events->slots[hash & (events->nr_slots - 1)];" << std::endl;
+	stream << "            if (candidate != USCXML_EVENT_UNKNOWN) {" << std::endl;
+	stream << "                descriptor = events->names[candidate];" << std::endl;
+	stream << "                for (j = 0; j < i && descriptor[j] == name[j]; j++);" << std::endl;
+	stream << "                if (j == i && descriptor[j] == '\\0')" << std::endl;
+	stream << "                    event_id = candidate;" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            if (name[i] == '\\0')" << std::endl;
+	stream << "                break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        hash ^= (unsigned char)name[i];" << std::endl;
+	stream << "        hash *= 16777619UL;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return event_id;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
 	stream << "int uscxml_step(uscxml_ctx* ctx) {" << std::endl;
 	stream << std::endl;
 
 	stream << "    " << (_states.size() > _transitions.size() ? "USCXML_NR_STATES_TYPE" : "USCXML_NR_TRANS_TYPE") << " i, j, k;" << std::endl;
+	stream << "#ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "    /* whole words beyond our states are zero, a constant size unrolls */" << std::endl;
+	stream << "    const size_t nr_states_bytes = USCXML_MAX_NR_STATES_BYTES;" << std::endl;
+	stream << "    const size_t nr_trans_bytes  = USCXML_MAX_NR_TRANS_BYTES;" << std::endl;
+	stream << "#else" << std::endl;
 	stream << "    USCXML_NR_STATES_TYPE nr_states_bytes = ((USCXML_NUMBER_STATES + 7) & ~7) >> 3;" << std::endl;
 	stream << "    USCXML_NR_TRANS_TYPE  nr_trans_bytes  = ((USCXML_NUMBER_TRANS + 7) & ~7) >> 3;" << std::endl;
+	stream << "#endif" << std::endl;
 	stream << "    int err = USCXML_ERR_OK;" << std::endl;
 
-	stream << "    unsigned char conflicts  [USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
-	stream << "    unsigned char trans_set  [USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
-	stream << "    unsigned char target_set [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
-	stream << "    unsigned char exit_set   [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
-	stream << "    unsigned char entry_set  [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
-	stream << "    unsigned char tmp_states [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char conflicts  [USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char trans_set  [USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char target_set [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char exit_set   [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char entry_set  [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char tmp_states [USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    const unsigned char* event_trans;" << std::endl;
+	stream << "    int event_id;" << std::endl;
 	stream << std::endl;
 
 	stream << "#ifdef USCXML_VERBOSE" << std::endl;
@@ -2207,15 +2727,12 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "        while(i-- > 0) {" << std::endl;
 	stream << "            if (BIT_HAS(i, ctx->config)) {" << std::endl;
 	stream << "                /* call all on exit handlers */" << std::endl;
-	stream << "                if (USCXML_GET_STATE(i).on_exit != NULL) {" << std::endl;
-	stream << "                    if unlikely((err = USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)" << std::endl;
-	stream << "                        return err;" << std::endl;
-	stream << "                }" << std::endl;
+	stream << "                if unlikely((err = USCXML_ON_EXIT(i)) != USCXML_ERR_OK)" << std::endl;
+	stream << "                    return err;" << std::endl;
 //	stream << "                BIT_CLEAR(i, ctx->config);" << std::endl;
 	stream << "            }" << std::endl;
 	stream << "            if (BIT_HAS(i, ctx->invocations)) {" << std::endl;
-	stream << "                if (USCXML_GET_STATE(i).invoke != NULL)" << std::endl;
-	stream << "                    USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 1);" << std::endl;
+	stream << "                USCXML_INVOKE(i, 1);" << std::endl;
 	stream << "                BIT_CLEAR(i, ctx->invocations);" << std::endl;
 	stream << "            }" << std::endl;
 	stream << "        }" << std::endl;
@@ -2227,8 +2744,7 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "    bit_clear_all(target_set, nr_states_bytes);" << std::endl;
 	stream << "    bit_clear_all(trans_set, nr_trans_bytes);" << std::endl;
 	stream << "    if unlikely(ctx->flags == USCXML_CTX_PRISTINE) {" << std::endl;
-	stream << "        if (ctx->machine->script != NULL)" << std::endl;
-	stream << "            ctx->machine->script(ctx, &ctx->machine->states[0], NULL);" << std::endl;
+	stream << "        USCXML_ON_SCRIPT();" << std::endl;
 	stream << "        bit_or(target_set, ctx->machine->states[0].completion, nr_states_bytes);" << std::endl;
 	stream << "        ctx->flags |= USCXML_CTX_SPONTANEOUS | USCXML_CTX_INITIALIZED;" << std::endl;
 	stream << "        goto ESTABLISH_ENTRY_SET;" << std::endl;
@@ -2249,14 +2765,12 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "    for (i = 0; i < USCXML_NUMBER_STATES; i++) {" << std::endl;
 	stream << "        /* uninvoke */" << std::endl;
 	stream << "        if (!BIT_HAS(i, ctx->config) && BIT_HAS(i, ctx->invocations)) {" << std::endl;
-	stream << "            if (USCXML_GET_STATE(i).invoke != NULL)" << std::endl;
-	stream << "                USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 1);" << std::endl;
+	stream << "            USCXML_INVOKE(i, 1);" << std::endl;
 	stream << "            BIT_CLEAR(i, ctx->invocations)" << std::endl;
 	stream << "        }" << std::endl;
 	stream << "        /* invoke */" << std::endl;
 	stream << "        if (BIT_HAS(i, ctx->config) && !BIT_HAS(i, ctx->invocations)) {" << std::endl;
-	stream << "            if (USCXML_GET_STATE(i).invoke != NULL)" << std::endl;
-	stream << "                USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 0);" << std::endl;
+	stream << "            USCXML_INVOKE(i, 0);" << std::endl;
 	stream << "            BIT_SET_AT(i, ctx->invocations)" << std::endl;
 	stream << "        }" << std::endl;
 	stream << "    }" << std::endl;
@@ -2275,7 +2789,23 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "SELECT_TRANSITIONS:" << std::endl;
 	stream << "    bit_clear_all(conflicts, nr_trans_bytes);" << std::endl;
 	stream << "    bit_clear_all(exit_set, nr_states_bytes);" << std::endl;
+	stream << std::endl;
+	stream << "    /* transitions enabled by the event, if the host can identify it */" << std::endl;
+	stream << "    event_trans = NULL;" << std::endl;
+	stream << "    if (ctx->event != NULL && ctx->event_id != NULL && ctx->machine->events != NULL) {" << std::endl;
+	stream << "        event_id = ctx->event_id(ctx, ctx->event);" << std::endl;
+	stream << "        if (event_id >= 0 && (unsigned int)event_id < ctx->machine->events->nr_events)" << std::endl;
+	stream << "            event_trans = &ctx->machine->events->transitions[event_id * USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "#ifdef USCXML_BITSET_WORDS" << std::endl;
+	stream << "    /* no other transitions are enabled by an event we identified */" << std::endl;
+	stream << "    for (i = (event_trans != NULL ? bit_next(event_trans, 0, USCXML_NUMBER_TRANS) : 0);" << std::endl;
+	stream << "         i < USCXML_NUMBER_TRANS;" << std::endl;
+	stream << "         i = (event_trans != NULL ? bit_next(event_trans, i + 1, USCXML_NUMBER_TRANS) : i + 1)) {" << std::endl;
+	stream << "#else" << std::endl;
 	stream << "    for (i = 0; i < USCXML_NUMBER_TRANS; i++) {" << std::endl;
+	stream << "#endif" << std::endl;
 	stream << "        /* never select history or initial transitions automatically */" << std::endl;
 	stream << "        if unlikely(USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL))" << std::endl;
 	stream << "            continue;" << std::endl;
@@ -2288,7 +2818,8 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "                if ((USCXML_GET_TRANS(i).event == NULL && ctx->event == NULL) || " << std::endl;
 	stream << "                    (USCXML_GET_TRANS(i).event != NULL && ctx->event != NULL)) {" << std::endl;
 	stream << "                    /* is it enabled? */" << std::endl;
-	stream << "                    if ((ctx->event == NULL || ctx->is_matched(ctx, &USCXML_GET_TRANS(i), ctx->event) > 0) &&" << std::endl;
+	stream << "                    if ((ctx->event == NULL ||" << std::endl;
+	stream << "                         (event_trans != NULL ? BIT_HAS(i, event_trans) : ctx->is_matched(ctx, &USCXML_GET_TRANS(i), ctx->event) > 0)) &&" << std::endl;
 	stream << "                        (USCXML_GET_TRANS(i).condition == NULL || " << std::endl;
 	stream << "                         USCXML_GET_TRANS(i).is_enabled(ctx, &USCXML_GET_TRANS(i)) > 0)) {" << std::endl;
 	stream << "                        /* remember that we found a transition */" << std::endl;
@@ -2366,103 +2897,99 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "    bit_copy(entry_set, target_set, nr_states_bytes);" << std::endl;
 	stream << std::endl;
 	stream << "    /* iterate for ancestors */" << std::endl;
-	stream << "    for (i = 0; i < USCXML_NUMBER_STATES; i++) {" << std::endl;
-	stream << "        if (BIT_HAS(i, entry_set)) {" << std::endl;
-	stream << "            bit_or(entry_set, USCXML_GET_STATE(i).ancestors, nr_states_bytes);" << std::endl;
-	stream << "        }" << std::endl;
+	stream << "    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {" << std::endl;
+	stream << "        bit_or(entry_set, USCXML_GET_STATE(i).ancestors, nr_states_bytes);" << std::endl;
 	stream << "    }" << std::endl;
 	stream << std::endl;
 
 	stream << "    /* iterate for descendants */" << std::endl;
-	stream << "    for (i = 0; i < USCXML_NUMBER_STATES; i++) {" << std::endl;
-	stream << "        if (BIT_HAS(i, entry_set)) {" << std::endl;
-	stream << "            switch (USCXML_STATE_MASK(USCXML_GET_STATE(i).type)) {" << std::endl;
-	stream << "                case USCXML_STATE_PARALLEL: {" << std::endl;
-	stream << "                    bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
-	stream << "                    break;" << std::endl;
-	stream << "                }" << std::endl;
+	stream << "    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {" << std::endl;
+	stream << "        switch (USCXML_STATE_MASK(USCXML_GET_STATE(i).type)) {" << std::endl;
+	stream << "            case USCXML_STATE_PARALLEL: {" << std::endl;
+	stream << "                bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
+	stream << "                break;" << std::endl;
+	stream << "            }" << std::endl;
 	stream << "#ifndef USCXML_NO_HISTORY" << std::endl;
-	stream << "                case USCXML_STATE_HISTORY_SHALLOW:" << std::endl;
-	stream << "                case USCXML_STATE_HISTORY_DEEP: {" << std::endl;
-	stream << "                    if (!bit_has_and(USCXML_GET_STATE(i).completion, ctx->history, nr_states_bytes) &&" << std::endl;
-	stream << "                        !BIT_HAS(USCXML_GET_STATE(i).parent, ctx->config)) {" << std::endl;
-	stream << "                        /* nothing set for history, look for a default transition */" << std::endl;
-	stream << "                        for (j = 0; j < USCXML_NUMBER_TRANS; j++) {" << std::endl;
-	stream << "                            if unlikely(ctx->machine->transitions[j].source == i) {" << std::endl;
-	stream << "                                bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);" << std::endl;
-	stream << "                                if(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP &&" << std::endl;
-	stream << "                                   !bit_has_and(ctx->machine->transitions[j].target, USCXML_GET_STATE(i).children, nr_states_bytes)) {" << std::endl;
-	stream << "                                    for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
-	stream << "                                        if (BIT_HAS(k, ctx->machine->transitions[j].target)) {" << std::endl;
-	stream << "                                            bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);" << std::endl;
-	stream << "                                            break;" << std::endl;
-	stream << "                                        }" << std::endl;
+	stream << "            case USCXML_STATE_HISTORY_SHALLOW:" << std::endl;
+	stream << "            case USCXML_STATE_HISTORY_DEEP: {" << std::endl;
+	stream << "                if (!bit_has_and(USCXML_GET_STATE(i).completion, ctx->history, nr_states_bytes) &&" << std::endl;
+	stream << "                    !BIT_HAS(USCXML_GET_STATE(i).parent, ctx->config)) {" << std::endl;
+	stream << "                    /* nothing set for history, look for a default transition */" << std::endl;
+	stream << "                    for (j = 0; j < USCXML_NUMBER_TRANS; j++) {" << std::endl;
+	stream << "                        if unlikely(ctx->machine->transitions[j].source == i) {" << std::endl;
+	stream << "                            bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);" << std::endl;
+	stream << "                            if(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP &&" << std::endl;
+	stream << "                               !bit_has_and(ctx->machine->transitions[j].target, USCXML_GET_STATE(i).children, nr_states_bytes)) {" << std::endl;
+	stream << "                                for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
+	stream << "                                    if (BIT_HAS(k, ctx->machine->transitions[j].target)) {" << std::endl;
+	stream << "                                        bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);" << std::endl;
+	stream << "                                        break;" << std::endl;
 	stream << "                                    }" << std::endl;
 	stream << "                                }" << std::endl;
-	stream << "                                BIT_SET_AT(j, trans_set);" << std::endl;
-	stream << "                                break;" << std::endl;
 	stream << "                            }" << std::endl;
-	stream << "                            /* Note: SCXML mandates every history to have a transition! */" << std::endl;
+	stream << "                            BIT_SET_AT(j, trans_set);" << std::endl;
+	stream << "                            break;" << std::endl;
 	stream << "                        }" << std::endl;
-	stream << "                    } else {" << std::endl;
-	stream << "                        bit_copy(tmp_states, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
-	stream << "                        bit_and(tmp_states, ctx->history, nr_states_bytes);" << std::endl;
-	stream << "                        bit_or(entry_set, tmp_states, nr_states_bytes);" << std::endl;
-	stream << "                        if (USCXML_GET_STATE(i).type == (USCXML_STATE_HAS_HISTORY | USCXML_STATE_HISTORY_DEEP)) {" << std::endl;
-	stream << "                            /* a deep history state with nested histories -> more completion */" << std::endl;
-	stream << "                            for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {" << std::endl;
-	stream << "                                if (BIT_HAS(j, USCXML_GET_STATE(i).completion) &&" << std::endl;
-	stream << "                                    BIT_HAS(j, entry_set) &&" << std::endl;
-	stream << "                                    (ctx->machine->states[j].type & USCXML_STATE_HAS_HISTORY)) {" << std::endl;
-	stream << "                                    for (k = j + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
-	stream << "                                        /* add nested history to entry_set */" << std::endl;
-	stream << "                                        if ((USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_DEEP ||" << std::endl;
-	stream << "                                             USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_SHALLOW) &&" << std::endl;
-	stream << "                                            BIT_HAS(k, ctx->machine->states[j].children)) {" << std::endl;
-	stream << "                                            /* a nested history state */" << std::endl;
-	stream << "                                            BIT_SET_AT(k, entry_set);" << std::endl;
-	stream << "                                        }" << std::endl;
+	stream << "                        /* Note: SCXML mandates every history to have a transition! */" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                } else {" << std::endl;
+	stream << "                    bit_copy(tmp_states, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
+	stream << "                    bit_and(tmp_states, ctx->history, nr_states_bytes);" << std::endl;
+	stream << "                    bit_or(entry_set, tmp_states, nr_states_bytes);" << std::endl;
+	stream << "                    if (USCXML_GET_STATE(i).type == (USCXML_STATE_HAS_HISTORY | USCXML_STATE_HISTORY_DEEP)) {" << std::endl;
+	stream << "                        /* a deep history state with nested histories -> more completion */" << std::endl;
+	stream << "                        for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {" << std::endl;
+	stream << "                            if (BIT_HAS(j, USCXML_GET_STATE(i).completion) &&" << std::endl;
+	stream << "                                BIT_HAS(j, entry_set) &&" << std::endl;
+	stream << "                                (ctx->machine->states[j].type & USCXML_STATE_HAS_HISTORY)) {" << std::endl;
+	stream << "                                for (k = j + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
+	stream << "                                    /* add nested history to entry_set */" << std::endl;
+	stream << "                                    if ((USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_DEEP ||" << std::endl;
+	stream << "                                         USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_SHALLOW) &&" << std::endl;
+	stream << "                                        BIT_HAS(k, ctx->machine->states[j].children)) {" << std::endl;
+	stream << "                                        /* a nested history state */" << std::endl;
+	stream << "                                        BIT_SET_AT(k, entry_set);" << std::endl;
 	stream << "                                    }" << std::endl;
 	stream << "                                }" << std::endl;
 	stream << "                            }" << std::endl;
 	stream << "                        }" << std::endl;
 	stream << "                    }" << std::endl;
-	stream << "                    break;" << std::endl;
 	stream << "                }" << std::endl;
+	stream << "                break;" << std::endl;
+	stream << "            }" << std::endl;
 	stream << "#endif" << std::endl;
-	stream << "                case USCXML_STATE_INITIAL: {" << std::endl;
-	stream << "                    for (j = 0; j < USCXML_NUMBER_TRANS; j++) {" << std::endl;
-	stream << "                        if (ctx->machine->transitions[j].source == i) {" << std::endl;
-	stream << "                            BIT_SET_AT(j, trans_set);" << std::endl;
-	stream << "                            BIT_CLEAR(i, entry_set);" << std::endl;
-	stream << "                            bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);" << std::endl;
-	stream << "                            for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
-	stream << "                                if (BIT_HAS(k, ctx->machine->transitions[j].target)) {" << std::endl;
-	stream << "                                    bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);" << std::endl;
-	stream << "                                }" << std::endl;
+	stream << "            case USCXML_STATE_INITIAL: {" << std::endl;
+	stream << "                for (j = 0; j < USCXML_NUMBER_TRANS; j++) {" << std::endl;
+	stream << "                    if (ctx->machine->transitions[j].source == i) {" << std::endl;
+	stream << "                        BIT_SET_AT(j, trans_set);" << std::endl;
+	stream << "                        BIT_CLEAR(i, entry_set);" << std::endl;
+	stream << "                        bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);" << std::endl;
+	stream << "                        for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {" << std::endl;
+	stream << "                            if (BIT_HAS(k, ctx->machine->transitions[j].target)) {" << std::endl;
+	stream << "                                bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);" << std::endl;
 	stream << "                            }" << std::endl;
 	stream << "                        }" << std::endl;
 	stream << "                    }" << std::endl;
-	stream << "                    break;" << std::endl;
 	stream << "                }" << std::endl;
-	stream << "                case USCXML_STATE_COMPOUND: { /* we need to check whether one child is already in entry_set */" << std::endl;
-	stream << "                    if (!bit_has_and(entry_set, USCXML_GET_STATE(i).children, nr_states_bytes) &&" << std::endl;
-	stream << "                        (!bit_has_and(ctx->config, USCXML_GET_STATE(i).children, nr_states_bytes) ||" << std::endl;
-	stream << "                         bit_has_and(exit_set, USCXML_GET_STATE(i).children, nr_states_bytes)))" << std::endl;
-	stream << "                    {" << std::endl;
-	stream << "                        bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
-	stream << "                        if (!bit_has_and(USCXML_GET_STATE(i).completion, USCXML_GET_STATE(i).children, nr_states_bytes)) {" << std::endl;
-	stream << "                            /* deep completion */" << std::endl;
-	stream << "                            for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {" << std::endl;
-	stream << "                                if (BIT_HAS(j, USCXML_GET_STATE(i).completion)) {" << std::endl;
-	stream << "                                    bit_or(entry_set, ctx->machine->states[j].ancestors, nr_states_bytes);" << std::endl;
-	stream << "                                    break; /* completion of compound is single state */" << std::endl;
-	stream << "                                }" << std::endl;
+	stream << "                break;" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            case USCXML_STATE_COMPOUND: { /* we need to check whether one child is already in entry_set */" << std::endl;
+	stream << "                if (!bit_has_and(entry_set, USCXML_GET_STATE(i).children, nr_states_bytes) &&" << std::endl;
+	stream << "                    (!bit_has_and(ctx->config, USCXML_GET_STATE(i).children, nr_states_bytes) ||" << std::endl;
+	stream << "                     bit_has_and(exit_set, USCXML_GET_STATE(i).children, nr_states_bytes)))" << std::endl;
+	stream << "                {" << std::endl;
+	stream << "                    bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);" << std::endl;
+	stream << "                    if (!bit_has_and(USCXML_GET_STATE(i).completion, USCXML_GET_STATE(i).children, nr_states_bytes)) {" << std::endl;
+	stream << "                        /* deep completion */" << std::endl;
+	stream << "                        for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {" << std::endl;
+	stream << "                            if (BIT_HAS(j, USCXML_GET_STATE(i).completion)) {" << std::endl;
+	stream << "                                bit_or(entry_set, ctx->machine->states[j].ancestors, nr_states_bytes);" << std::endl;
+	stream << "                                break; /* completion of compound is single state */" << std::endl;
 	stream << "                            }" << std::endl;
 	stream << "                        }" << std::endl;
 	stream << "                    }" << std::endl;
-	stream << "                    break;" << std::endl;
 	stream << "                }" << std::endl;
+	stream << "                break;" << std::endl;
 	stream << "            }" << std::endl;
 	stream << "        }" << std::endl;
 	stream << "    }" << std::endl;
@@ -2479,25 +3006,19 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << "    while(i-- > 0) {" << std::endl;
 	stream << "        if (BIT_HAS(i, exit_set) && BIT_HAS(i, ctx->config)) {" << std::endl;
 	stream << "            /* call all on exit handlers */" << std::endl;
-	stream << "            if (USCXML_GET_STATE(i).on_exit != NULL) {" << std::endl;
-	stream << "                if unlikely((err = USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)" << std::endl;
-	stream << "                    return err;" << std::endl;
-	stream << "            }" << std::endl;
+	stream << "            if unlikely((err = USCXML_ON_EXIT(i)) != USCXML_ERR_OK)" << std::endl;
+	stream << "                return err;" << std::endl;
 	stream << "            BIT_CLEAR(i, ctx->config);" << std::endl;
 	stream << "        }" << std::endl;
 	stream << "    }" << std::endl;
 	stream << std::endl;
 
 	stream << "/* TAKE_TRANSITIONS: */" << std::endl;
-	stream << "    for (i = 0; i < USCXML_NUMBER_TRANS; i++) {" << std::endl;
-	stream << "        if (BIT_HAS(i, trans_set) && (USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) == 0) {" << std::endl;
+	stream << "    BIT_FOR_EACH(i, trans_set, USCXML_NUMBER_TRANS) {" << std::endl;
+	stream << "        if ((USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) == 0) {" << std::endl;
 	stream << "            /* call executable content in transition */" << std::endl;
-	stream << "            if (USCXML_GET_TRANS(i).on_transition != NULL) {" << std::endl;
-	stream << "                if unlikely((err = USCXML_GET_TRANS(i).on_transition(ctx," << std::endl;
-	stream << "                                                                              &ctx->machine->states[USCXML_GET_TRANS(i).source]," << std::endl;
-	stream << "                                                                              ctx->event)) != USCXML_ERR_OK)" << std::endl;
-	stream << "                    return err;" << std::endl;
-	stream << "            }" << std::endl;
+	stream << "            if unlikely((err = USCXML_ON_TRANS(i, USCXML_GET_TRANS(i).source)) != USCXML_ERR_OK)" << std::endl;
+	stream << "                return err;" << std::endl;
 	stream << "        }" << std::endl;
 	stream << "    }" << std::endl;
 	stream << std::endl;
@@ -2509,8 +3030,8 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "/* ENTER_STATES: */" << std::endl;
-	stream << "    for (i = 0; i < USCXML_NUMBER_STATES; i++) {" << std::endl;
-	stream << "        if (BIT_HAS(i, entry_set) && !BIT_HAS(i, ctx->config)) {" << std::endl;
+	stream << "    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {" << std::endl;
+	stream << "        if (!BIT_HAS(i, ctx->config)) {" << std::endl;
 	stream << "            /* these are no proper states */" << std::endl;
 	stream << "            if unlikely(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP ||" << std::endl;
 	stream << "                        USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_SHALLOW ||" << std::endl;
@@ -2523,38 +3044,29 @@ void ChartToC::writeFSM(std::ostream& stream) {
 
 	stream << "            /* initialize data */" << std::endl;
 	stream << "            if (!BIT_HAS(i, ctx->initialized_data)) {" << std::endl;
-	stream << "                if unlikely(USCXML_GET_STATE(i).data != NULL && ctx->exec_content_init != NULL) {" << std::endl;
-	stream << "                    ctx->exec_content_init(ctx, USCXML_GET_STATE(i).data);" << std::endl;
-	stream << "                }" << std::endl;
+	stream << "                USCXML_INIT_DATA(i);" << std::endl;
 	stream << "                BIT_SET_AT(i, ctx->initialized_data);" << std::endl;
 	stream << "            }" << std::endl;
 	stream << std::endl;
 
-	stream << "            if (USCXML_GET_STATE(i).on_entry != NULL) {" << std::endl;
-	stream << "                if unlikely((err = USCXML_GET_STATE(i).on_entry(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)" << std::endl;
-	stream << "                    return err;" << std::endl;
-	stream << "            }" << std::endl;
+	stream << "            if unlikely((err = USCXML_ON_ENTRY(i)) != USCXML_ERR_OK)" << std::endl;
+	stream << "                return err;" << std::endl;
 	stream << std::endl;
 
 	stream << "            /* take history and initial transitions */" << std::endl;
-	stream << "            for (j = 0; j < USCXML_NUMBER_TRANS; j++) {" << std::endl;
-	stream << "                if unlikely(BIT_HAS(j, trans_set) &&" << std::endl;
-	stream << "                            (ctx->machine->transitions[j].type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) &&" << std::endl;
+	stream << "            BIT_FOR_EACH(j, trans_set, USCXML_NUMBER_TRANS) {" << std::endl;
+	stream << "                if unlikely((ctx->machine->transitions[j].type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) &&" << std::endl;
 	stream << "                            ctx->machine->states[ctx->machine->transitions[j].source].parent == i) {" << std::endl;
 	stream << "                    /* call executable content in transition */" << std::endl;
-	stream << "                    if (ctx->machine->transitions[j].on_transition != NULL) {" << std::endl;
-	stream << "                        if unlikely((err = ctx->machine->transitions[j].on_transition(ctx," << std::endl;
-	stream << "                                                                                      &USCXML_GET_STATE(i)," << std::endl;
-	stream << "                                                                                      ctx->event)) != USCXML_ERR_OK)" << std::endl;
-	stream << "                            return err;" << std::endl;
-	stream << "                    }" << std::endl;
+	stream << "                    if unlikely((err = USCXML_ON_TRANS(j, i)) != USCXML_ERR_OK)" << std::endl;
+	stream << "                        return err;" << std::endl;
 	stream << "                }" << std::endl;
 	stream << "            }" << std::endl;
 	stream << std::endl;
 
 	stream << "            /* handle final states */" << std::endl;
 	stream << "            if unlikely(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_FINAL) {" << std::endl;
-	stream << "                if unlikely(USCXML_GET_STATE(i).ancestors[0] == 0x01) {" << std::endl;
+	stream << "                if unlikely(USCXML_GET_STATE(i).parent == 0) {" << std::endl;
 	stream << "                    ctx->flags |= USCXML_CTX_TOP_LEVEL_FINAL;" << std::endl;
 	stream << "                } else {" << std::endl;
 	stream << "                    /* raise done event */" << std::endl;
@@ -2611,6 +3123,221 @@ void ChartToC::writeFSM(std::ostream& stream) {
 	stream << std::endl;
 }
 
+void ChartToC::writeBatch(std::ostream& stream) {
+	stream << "#ifndef USCXML_NO_BATCH_FUNCTIONS" << std::endl;
+	stream << "#ifndef USCXML_BITSET_WORDS" << std::endl;
+	stream << "#  error \"Batches of instances need bitsets of words, see USCXML_BITSET_WORDS\"" << std::endl;
+	stream << "#endif" << std::endl;
+	for (std::list<ChartToC*>::iterator machIter = _allMachines.begin(); machIter != _allMachines.end(); machIter++) {
+		if ((*machIter)->_hasElement.find("invoke") != (*machIter)->_hasElement.end()) {
+			stream << "#error \"Instances of a batch cannot invoke, " << (*machIter)->_prefix << " has invocations\"" << std::endl;
+			break;
+		}
+	}
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * USCXML_BATCH_STATE_WORDS / USCXML_BATCH_STRIDE" << std::endl;
+	stream << " *   A batch keeps the bitsets of its instances as a structure of arrays, the" << std::endl;
+	stream << " *   n-th word of every instance's bitset is in row n, one word per instance." << std::endl;
+	stream << " *   A row is USCXML_BATCH_STRIDE(nr_instances) words long and a bitset of a" << std::endl;
+	stream << " *   batch takes USCXML_BATCH_STATE_WORDS rows." << std::endl;
+	stream << " */" << std::endl;
+	stream << "#define USCXML_BATCH_STATE_WORDS (USCXML_MAX_NR_STATES_BYTES / 8)" << std::endl;
+	stream << "#define USCXML_BATCH_STRIDE(nr_instances) (((nr_instances) + 63) & ~(size_t)63)" << std::endl;
+	stream << std::endl;
+
+	stream << "typedef struct uscxml_batch uscxml_batch;" << std::endl;
+	stream << std::endl;
+	stream << "/**" << std::endl;
+	stream << " * Many instances of a machine, stepped together. The callbacks of the context" << std::endl;
+	stream << " * serve all of them, the one they are called for is in instance. The context" << std::endl;
+	stream << " * comes first, callbacks can cast it to the batch." << std::endl;
+	stream << " *" << std::endl;
+	stream << " * The host sets the context's machine and callbacks, nr_instances and the" << std::endl;
+	stream << " * arrays before calling uscxml_batch_init, with stride = USCXML_BATCH_STRIDE(nr_instances):" << std::endl;
+	stream << " *   config, history, initialized_data: USCXML_BATCH_STATE_WORDS * stride words" << std::endl;
+	stream << " *   flags:                             stride bytes" << std::endl;
+	stream << " *   finished:                          stride / 64 words, a bit per instance" << std::endl;
+	stream << " * The context's dequeue_external is replaced by the batch's." << std::endl;
+	stream << " */" << std::endl;
+	stream << "struct uscxml_batch {" << std::endl;
+	stream << "    uscxml_ctx     ctx;" << std::endl;
+	stream << std::endl;
+	stream << "    size_t         nr_instances;" << std::endl;
+	stream << "    size_t         stride;" << std::endl;
+	stream << "    uint64_t*      config;" << std::endl;
+	stream << "    uint64_t*      history;" << std::endl;
+	stream << "    uint64_t*      initialized_data;" << std::endl;
+	stream << "    unsigned char* flags;" << std::endl;
+	stream << "    uint64_t*      finished;" << std::endl;
+	stream << std::endl;
+	stream << "    size_t         instance;      /* the one currently stepped */" << std::endl;
+	stream << "    void*          event;         /* external event delivered to it */" << std::endl;
+	stream << "    unsigned char  event_pending;" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "static void* uscxml_batch_dequeue_external(const uscxml_ctx* ctx) {" << std::endl;
+	stream << "    uscxml_batch* batch = (uscxml_batch*)ctx;" << std::endl;
+	stream << "    if (!batch->event_pending)" << std::endl;
+	stream << "        return NULL;" << std::endl;
+	stream << "    batch->event_pending = 0;" << std::endl;
+	stream << "    return batch->event;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Gather the bitsets of an instance into the context, step it until it is" << std::endl;
+	stream << " * idle or done and scatter them back." << std::endl;
+	stream << " */" << std::endl;
+	stream << "static int uscxml_batch_step_instance(uscxml_batch* batch, size_t instance) {" << std::endl;
+	stream << "    uscxml_ctx* ctx = &batch->ctx;" << std::endl;
+	stream << "    uscxml_bitset_word* config = (uscxml_bitset_word*)ctx->config;" << std::endl;
+	stream << "    uscxml_bitset_word* history = (uscxml_bitset_word*)ctx->history;" << std::endl;
+	stream << "    uscxml_bitset_word* initialized_data = (uscxml_bitset_word*)ctx->initialized_data;" << std::endl;
+	stream << "    size_t w;" << std::endl;
+	stream << "    int err;" << std::endl;
+	stream << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    for (w = 0; w < USCXML_BATCH_STATE_WORDS; w++) {" << std::endl;
+	stream << "        config[w]           = batch->config[w * batch->stride + instance];" << std::endl;
+	stream << "        history[w]          = batch->history[w * batch->stride + instance];" << std::endl;
+	stream << "        initialized_data[w] = batch->initialized_data[w * batch->stride + instance];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    ctx->flags = batch->flags[instance];" << std::endl;
+	stream << "    batch->instance = instance;" << std::endl;
+	stream << std::endl;
+	stream << "    while ((err = uscxml_step(ctx)) == USCXML_ERR_OK);" << std::endl;
+	stream << std::endl;
+	stream << "    USCXML_UNROLL" << std::endl;
+	stream << "    for (w = 0; w < USCXML_BATCH_STATE_WORDS; w++) {" << std::endl;
+	stream << "        batch->config[w * batch->stride + instance]           = config[w];" << std::endl;
+	stream << "        batch->history[w * batch->stride + instance]          = history[w];" << std::endl;
+	stream << "        batch->initialized_data[w * batch->stride + instance] = initialized_data[w];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    batch->flags[instance] = ctx->flags;" << std::endl;
+	stream << std::endl;
+	stream << "    if (err == USCXML_ERR_DONE) {" << std::endl;
+	stream << "        batch->finished[instance >> 6] |= (uint64_t)1 << (instance & 63);" << std::endl;
+	stream << "        return USCXML_ERR_OK;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return (err == USCXML_ERR_IDLE ? USCXML_ERR_OK : err);" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Clear the batch and take every instance into its initial configuration." << std::endl;
+	stream << " */" << std::endl;
+	stream << "int uscxml_batch_init(uscxml_batch* batch) {" << std::endl;
+	stream << "    size_t i;" << std::endl;
+	stream << "    int err;" << std::endl;
+	stream << std::endl;
+	stream << "    batch->stride = USCXML_BATCH_STRIDE(batch->nr_instances);" << std::endl;
+	stream << "    for (i = 0; i < USCXML_BATCH_STATE_WORDS * batch->stride; i++) {" << std::endl;
+	stream << "        batch->config[i] = 0;" << std::endl;
+	stream << "        batch->history[i] = 0;" << std::endl;
+	stream << "        batch->initialized_data[i] = 0;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    for (i = 0; i < batch->stride; i++) {" << std::endl;
+	stream << "        batch->flags[i] = USCXML_CTX_PRISTINE;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    /* padding beyond the last instance is never stepped */" << std::endl;
+	stream << "    for (i = 0; i < batch->stride; i += 64) {" << std::endl;
+	stream << "        batch->finished[i >> 6] = 0;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    for (i = batch->nr_instances; i < batch->stride; i++) {" << std::endl;
+	stream << "        batch->finished[i >> 6] |= (uint64_t)1 << (i & 63);" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    batch->ctx.dequeue_external = uscxml_batch_dequeue_external;" << std::endl;
+	stream << "    batch->event = NULL;" << std::endl;
+	stream << "    batch->event_pending = 0;" << std::endl;
+	stream << std::endl;
+	stream << "    for (i = 0; i < batch->nr_instances; i++) {" << std::endl;
+	stream << "        if unlikely((err = uscxml_batch_step_instance(batch, i)) != USCXML_ERR_OK)" << std::endl;
+	stream << "            return err;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return USCXML_ERR_OK;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Deliver an external event to every instance set in recipients, or to all" << std::endl;
+	stream << " * if it is NULL, and step each until it is idle again. The event's id is the" << std::endl;
+	stream << " * one of uscxml_event_id. A single pass over the rows of the configurations" << std::endl;
+	stream << " * finds the instances with an active source of a transition the id enables," << std::endl;
+	stream << " * only these are stepped. A negative id steps all recipients." << std::endl;
+	stream << " * On an error, batch->instance is the one that failed." << std::endl;
+	stream << " */" << std::endl;
+	stream << "int uscxml_step_batch(uscxml_batch* batch, void* event, int event_id, const uint64_t* recipients) {" << std::endl;
+	stream << "    const uscxml_machine* machine = batch->ctx.machine;" << std::endl;
+	stream << "    USCXML_BITSET_ALIGNED unsigned char sources[USCXML_MAX_NR_STATES_BYTES];" << std::endl;
+	stream << "    const uscxml_bitset_word* source_words = (const uscxml_bitset_word*)sources;" << std::endl;
+	stream << "    const unsigned char* event_trans;" << std::endl;
+	stream << "    const uint64_t* row;" << std::endl;
+	stream << "    uint64_t candidates, active;" << std::endl;
+	stream << "    size_t i, j, w, block;" << std::endl;
+	stream << "    int err;" << std::endl;
+	stream << std::endl;
+	stream << "    /* the states whose transitions the event enables */" << std::endl;
+	stream << "    if (event_id >= 0 && machine->events != NULL && (unsigned int)event_id < machine->events->nr_events) {" << std::endl;
+	stream << "        bit_clear_all(sources, USCXML_MAX_NR_STATES_BYTES);" << std::endl;
+	stream << "        event_trans = &machine->events->transitions[event_id * USCXML_MAX_NR_TRANS_BYTES];" << std::endl;
+	stream << "        BIT_FOR_EACH(i, event_trans, machine->nr_transitions) {" << std::endl;
+	stream << "            if ((machine->transitions[i].type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) == 0)" << std::endl;
+	stream << "                BIT_SET_AT(machine->transitions[i].source, sources);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    } else {" << std::endl;
+	stream << "        for (i = 0; i < USCXML_MAX_NR_STATES_BYTES; i++)" << std::endl;
+	stream << "            sources[i] = 0xFF;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    batch->event = event;" << std::endl;
+	stream << "    for (block = 0; block < batch->stride; block += 64) {" << std::endl;
+	stream << "        /* instance-major rows, the loop over the block's instances vectorizes */" << std::endl;
+	stream << "        candidates = 0;" << std::endl;
+	stream << "        for (j = 0; j < 64; j++) {" << std::endl;
+	stream << "            active = 0;" << std::endl;
+	stream << "            row = batch->config + block + j;" << std::endl;
+	stream << "            USCXML_UNROLL" << std::endl;
+	stream << "            for (w = 0; w < USCXML_BATCH_STATE_WORDS; w++) {" << std::endl;
+	stream << "                active |= row[w * batch->stride] & source_words[w];" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            candidates |= (uint64_t)(active != 0) << j;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        candidates &= ~batch->finished[block >> 6];" << std::endl;
+	stream << "        if (recipients != NULL)" << std::endl;
+	stream << "            candidates &= recipients[block >> 6];" << std::endl;
+	stream << std::endl;
+	stream << "        while (candidates != 0) {" << std::endl;
+	stream << "            batch->event_pending = 1;" << std::endl;
+	stream << "            if unlikely((err = uscxml_batch_step_instance(batch, block + bit_ctz(candidates))) != USCXML_ERR_OK) {" << std::endl;
+	stream << "                batch->event_pending = 0;" << std::endl;
+	stream << "                return err;" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            candidates &= candidates - 1;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    batch->event_pending = 0;" << std::endl;
+	stream << "    return USCXML_ERR_OK;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * Whether an instance is in the state with the given index." << std::endl;
+	stream << " */" << std::endl;
+	stream << "int uscxml_batch_in_state(const uscxml_batch* batch, size_t instance, size_t state) {" << std::endl;
+	stream << "    const uint64_t word = batch->config[(state >> 6) * batch->stride + instance];" << std::endl;
+	stream << "    return BIT_HAS((state & 63), ((const unsigned char*)&word));" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+
+	stream << "#define USCXML_NO_BATCH_FUNCTIONS" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+}
+
 ChartToC::~ChartToC() {
 }
 
@@ -27,6 +27,11 @@
 #include <xercesc/dom/DOM.hpp>
 #include <ostream>
 #include <set>
+#include <vector>
+#include <stdint.h>
+
+/// bump whenever the generated macros or types change, uscxml/native/NativeTypes.h is written by writeTypesHeader
+#define USCXML_GEN_C_TYPES_VERSION 1
 
 namespace uscxml {
 
@@ -38,6 +43,9 @@ public:
 
 	void writeTo(std::ostream& stream);
 
+	/// The macros and types of all generated machines as a header for hosts, e.g. uscxml_native
+	static void writeTypesHeader(std::ostream& stream);
+
 protected:
 	ChartToC(const Interpreter& other);
 
@@ -56,14 +64,18 @@ protected:
 	void writeStates(std::ostream& stream);
 	void writeTransitions(std::ostream& stream);
 	void writeFSM(std::ostream& stream);
+	void writeBatch(std::ostream& stream);
 	void writeCharArrayInitList(std::ostream& stream, const std::string& boolString);
 
 	void writeExecContent(std::ostream& stream, const XERCESC_NS::DOMNode* node, size_t indent = 0);
 
+	void writeEvents(std::ostream& stream);
+
 	void resortStates(XERCESC_NS::DOMNode* node);
 	void setHistoryCompletion();
 	void setStateCompletion();
 	void prepare();
+	void prepareEvents();
 
 	void findNestedMachines();
 
@@ -84,6 +96,11 @@ protected:
 	std::string _stateCharArrayInit;
 	std::string _stateDataType;
 
+	std::vector<std::string> _events; ///< event descriptors by event id, 0 is for unknown events
+	std::vector<std::string> _eventTransBools; ///< transitions enabled by each event id
+	std::vector<size_t> _eventSlots; ///< perfect hash of descriptors to event ids
+	uint32_t _eventSeed;
+
 	ChartToC* _topMostMachine;
 	ChartToC* _parentMachine;
 	std::list<ChartToC*> _nestedMachines;
@@ -0,0 +1,1055 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "uscxml/transform/ChartToCpp.h"
+#include "uscxml/util/Predicates.h"
+#include "uscxml/util/String.h"
+
+#include <boost/algorithm/string.hpp>
+#include "uscxml/interpreter/Logging.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <set>
+
+namespace uscxml {
+
+using namespace XERCESC_NS;
+
+/// a valid C++ identifier for the given name, distinct from all taken ones
+static std::string identifierFor(const std::string& name, std::set<std::string>& taken) {
+	static const std::set<std::string> reserved = {
+		"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case",
+		"catch", "char", "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast",
+		"continue", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+		"explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int",
+		"long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+		"or_eq", "private", "protected", "public", "register", "reinterpret_cast", "return", "short",
+		"signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template",
+		"this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+		"unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq",
+		"NULL", "None", "Unknown"
+	};
+
+	std::string identifier = name;
+	for (size_t i = 0; i < identifier.size(); i++) {
+		if (!isalnum((unsigned char)identifier[i]))
+			identifier[i] = '_';
+	}
+	if (identifier.size() == 0 || isdigit((unsigned char)identifier[0]))
+		identifier = "_" + identifier;
+	if (reserved.find(identifier) != reserved.end())
+		identifier += "_";
+
+	std::string candidate = identifier;
+	for (size_t i = 1; taken.find(candidate) != taken.end(); i++) {
+		candidate = identifier + "_" + toStr(i);
+	}
+	taken.insert(candidate);
+	return candidate;
+}
+
+/// the smallest unsigned type for the given number of values
+static std::string typeFor(size_t values) {
+	if (values < (1UL << 8))
+		return "uint8_t";
+	if (values < (1UL << 16))
+		return "uint16_t";
+	return "uint32_t";
+}
+
+/// the elements serialized, to be parsed again by hosts interpreting the content
+static std::string sourceOf(const std::list<DOMElement*>& elements) {
+	std::stringstream ss;
+	for (auto element : elements) {
+		ss << *element;
+	}
+	return ss.str();
+}
+
+Transformer ChartToCpp::transform(const Interpreter& other) {
+	return std::shared_ptr<TransformerImpl>(new ChartToCpp(other));
+}
+
+ChartToCpp::ChartToCpp(const Interpreter& other) : ChartToC(other), _scriptAction(0) {
+	_namespace = "uscxml_" + _md5.substr(0, 8);
+	_stateWords = (_states.size() + 63) / 64;
+	_transWords = (_transitions.size() > 0 ? (_transitions.size() + 63) / 64 : 1);
+
+	prepareBlocks();
+}
+
+ChartToCpp::~ChartToCpp() {
+}
+
+size_t ChartToCpp::addAction(const std::string& identifier, const std::list<DOMElement*>& elements) {
+	Block action;
+	action.identifier = identifier;
+	action.source = sourceOf(elements);
+	_actions.push_back(action);
+	return _actions.size() - 1;
+}
+
+void ChartToCpp::prepareBlocks() {
+	std::set<std::string> taken;
+
+	_eventIdentifiers.push_back("Unknown");
+	for (size_t id = 1; id < _events.size(); id++) {
+		_eventIdentifiers.push_back(identifierFor(_events[id], taken));
+	}
+
+	taken.clear();
+	for (size_t i = 0; i < _states.size(); i++) {
+		DOMElement* state(_states[i]);
+		_stateIdentifiers.push_back(HAS_ATTR(state, kXMLCharId) ? identifierFor(ATTR(state, kXMLCharId), taken) : "");
+
+		// done.state.ID is identified by the longest descriptor matching it, just as uscxml_event_id does
+		std::string doneEvent = "done.state." + (HAS_ATTR(state, kXMLCharId) ? ATTR(state, kXMLCharId) : DOMUtils::idForNode(state));
+		size_t doneId = 0;
+		for (size_t id = 1; id < _events.size(); id++) {
+			const std::string& descriptor = _events[id];
+			if (boost::starts_with(doneEvent, descriptor) &&
+			        (doneEvent.size() == descriptor.size() || doneEvent[descriptor.size()] == '.') &&
+			        (doneId == 0 || descriptor.size() > _events[doneId].size())) {
+				doneId = id;
+			}
+		}
+		_doneEvents.push_back(doneId);
+	}
+
+	taken.clear();
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		if (!HAS_ATTR(_transitions[i], kXMLCharCond))
+			continue;
+		Block guard;
+		guard.identifier = identifierFor(DOMUtils::idForNode(_transitions[i]), taken);
+		guard.source = ATTR(_transitions[i], kXMLCharCond);
+		_transGuards[i] = _guards.size();
+		_guards.push_back(guard);
+	}
+
+	taken.clear();
+	_actions.push_back(Block());
+	_actions.back().identifier = "None";
+
+	std::list<DOMElement*> scripts = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "script", _states[0]);
+	if (scripts.size() > 0) {
+		_scriptAction = addAction(identifierFor("script", taken), scripts);
+	}
+
+	if (_binding == InterpreterImpl::EARLY) {
+		std::list<DOMElement*> datamodels = DOMUtils::inDocumentOrder({ XML_PREFIX(_scxml).str() + "datamodel" }, _scxml);
+		if (DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "data", datamodels).size() > 0) {
+			_dataActions[0] = addAction(identifierFor("datamodel", taken), datamodels);
+		}
+	}
+
+	for (size_t i = 0; i < _states.size(); i++) {
+		DOMElement* state(_states[i]);
+		std::string stateId = DOMUtils::idForNode(state);
+
+		if (_binding == InterpreterImpl::LATE) {
+			std::list<DOMElement*> datamodels = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "datamodel", state);
+			if (DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "data", datamodels).size() > 0) {
+				_dataActions[i] = addAction(identifierFor(stateId + "_datamodel", taken), datamodels);
+			}
+		}
+
+		std::list<DOMElement*> onentrys = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "onentry", state);
+		if (onentrys.size() > 0) {
+			_entryActions[i] = addAction(identifierFor(stateId + "_onentry", taken), onentrys);
+		}
+
+		std::list<DOMElement*> onexits = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "onexit", state);
+		if (onexits.size() > 0) {
+			_exitActions[i] = addAction(identifierFor(stateId + "_onexit", taken), onexits);
+		}
+
+		std::list<DOMElement*> donedatas = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "donedata", state);
+		if (isFinal(state) && donedatas.size() > 0) {
+			_doneDataActions[i] = addAction(identifierFor(stateId + "_donedata", taken), donedatas);
+		}
+	}
+
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		if (DOMUtils::filterChildType(DOMNode::ELEMENT_NODE, _transitions[i]).size() > 0) {
+			_transActions[i] = addAction(identifierFor(DOMUtils::idForNode(_transitions[i]) + "_ontrans", taken), { _transitions[i] });
+		}
+	}
+}
+
+void ChartToCpp::writeTo(std::ostream& stream) {
+	if (_extensions.find("namespace") != _extensions.end()) {
+		_namespace = _extensions.equal_range("namespace").first->second;
+	}
+
+	std::string guard = "USCXML_GEN_CPP_" + boost::to_upper_copy(_md5.substr(0, 8)) + "_H";
+
+	stream << "/**" << std::endl;
+	stream << "  Generated from source:" << std::endl;
+	stream << "  " << (std::string)_baseURL << std::endl;
+	stream << "*/" << std::endl;
+	stream << std::endl;
+
+	stream << "#ifndef " << guard << std::endl;
+	stream << "#define " << guard << std::endl;
+	stream << std::endl;
+	stream << "#include <stddef.h>" << std::endl;
+	stream << "#include <stdint.h>" << std::endl;
+	stream << "#include <string.h>" << std::endl;
+	stream << std::endl;
+	stream << "/* the first machine included is the default one */" << std::endl;
+	stream << "#ifndef USCXML_CPP_MACHINE" << std::endl;
+	stream << "#  define USCXML_CPP_MACHINE " << _namespace << std::endl;
+	stream << "#endif" << std::endl;
+	stream << std::endl;
+
+	stream << "/**" << std::endl;
+	stream << " * The machine's tables are constant expressions, its step function is a" << std::endl;
+	stream << " * template over a host's callbacks. These are called as static functions and" << std::endl;
+	stream << " * are inlined with the step if they are visible:" << std::endl;
+	stream << " *" << std::endl;
+	stream << " *   struct Callbacks {" << std::endl;
+	stream << " *       static bool guard(Machine<Callbacks>& machine, Guard guard);" << std::endl;
+	stream << " *       static void action(Machine<Callbacks>& machine, Action action);" << std::endl;
+	stream << " *       static bool dequeueInternal(Machine<Callbacks>& machine, Event& event);" << std::endl;
+	stream << " *       static bool dequeueExternal(Machine<Callbacks>& machine, Event& event);" << std::endl;
+	stream << " *       static void raiseDone(Machine<Callbacks>& machine, Event event, size_t state, Action donedata);" << std::endl;
+	stream << " *   };" << std::endl;
+	stream << " *" << std::endl;
+	stream << " * A Machine derives from its callbacks, state of the host can be kept there." << std::endl;
+	stream << " * Invocations are not supported." << std::endl;
+	stream << " */" << std::endl;
+	stream << "namespace " << _namespace << " {" << std::endl;
+	stream << std::endl;
+
+	writeEnums(stream);
+	writeTables(stream);
+	writeBitHelpers(stream);
+	writeMachine(stream);
+	writeStep(stream);
+
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "#endif /* " << guard << " */" << std::endl;
+}
+
+void ChartToCpp::writeEnums(std::ostream& stream) {
+	stream << "/// The machine's event descriptors, an event is identified by the longest one matching" << std::endl;
+	stream << "enum class Event : " << typeFor(_events.size()) << " {" << std::endl;
+	for (size_t id = 0; id < _events.size(); id++) {
+		stream << "    " << _eventIdentifiers[id] << " = " << toStr(id) << (id + 1 < _events.size() ? "," : "");
+		stream << " /* " << (id == 0 ? "only enables wildcard transitions" : _events[id]) << " */" << std::endl;
+	}
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "/// Conditions of transitions" << std::endl;
+	stream << "enum class Guard : " << typeFor(_guards.size()) << " {" << std::endl;
+	for (size_t i = 0; i < _guards.size(); i++) {
+		std::string comment = _guards[i].source;
+		boost::replace_all(comment, "*/", "* /");
+		boost::replace_all(comment, "\n", " ");
+		stream << "    " << _guards[i].identifier << " = " << toStr(i) << (i + 1 < _guards.size() ? "," : "");
+		stream << " /* " << comment << " */" << std::endl;
+	}
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "/// Blocks of executable content" << std::endl;
+	stream << "enum class Action : " << typeFor(_actions.size()) << " {" << std::endl;
+	for (size_t i = 0; i < _actions.size(); i++) {
+		stream << "    " << _actions[i].identifier << " = " << toStr(i) << (i + 1 < _actions.size() ? "," : "") << std::endl;
+	}
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "/// States with an id attribute by their index" << std::endl;
+	stream << "enum class StateId : " << typeFor(_states.size()) << " {" << std::endl;
+	std::string seperator = "";
+	for (size_t i = 0; i < _states.size(); i++) {
+		if (_stateIdentifiers[i].size() == 0)
+			continue;
+		stream << seperator << "    " << _stateIdentifiers[i] << " = " << toStr(i);
+		seperator = ",\n";
+	}
+	stream << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "enum class Result : uint8_t {" << std::endl;
+	stream << "    Ok,   ///< a microstep was taken" << std::endl;
+	stream << "    Idle, ///< no event is available" << std::endl;
+	stream << "    Done  ///< the machine finished" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+}
+
+void ChartToCpp::writeWords(std::ostream& stream, const std::string& boolString, size_t nrWords) {
+	std::ios::fmtflags f(stream.flags());
+	stream << "{ ";
+	for (size_t word = 0; word < nrWords; word++) {
+		uint64_t value = 0;
+		for (size_t bit = 0; bit < 64 && word * 64 + bit < boolString.size(); bit++) {
+			if (boolString[word * 64 + bit] == '1')
+				value |= ((uint64_t)1) << bit;
+		}
+		stream << (word > 0 ? ", " : "") << "0x" << std::setw(16) << std::setfill('0') << std::hex << value << "ULL";
+		stream.flags(f);
+	}
+	stream << " }";
+	stream.flags(f);
+}
+
+void ChartToCpp::writeTables(std::ostream& stream) {
+	size_t nrHistories = 0;
+	for (size_t i = 0; i < _states.size(); i++) {
+		if (isHistory(_states[i]))
+			nrHistories++;
+	}
+
+	stream << "constexpr size_t nrStates = " << toStr(_states.size()) << ";" << std::endl;
+	stream << "constexpr size_t nrTransitions = " << toStr(_transitions.size()) << ";" << std::endl;
+	stream << "constexpr size_t nrEvents = " << toStr(_events.size()) << ";" << std::endl;
+	stream << "constexpr size_t nrEventSlots = " << toStr(_eventSlots.size()) << ";" << std::endl;
+	stream << "constexpr uint32_t eventSeed = " << toStr(_eventSeed) << ";" << std::endl;
+	stream << "constexpr size_t nrGuards = " << toStr(_guards.size()) << ";" << std::endl;
+	stream << "constexpr size_t nrActions = " << toStr(_actions.size()) << ";" << std::endl;
+	stream << "constexpr size_t stateWords = " << toStr(_stateWords) << ";" << std::endl;
+	stream << "constexpr size_t transWords = " << toStr(_transWords) << ";" << std::endl;
+	stream << "constexpr bool hasHistory = " << (nrHistories > 0 ? "true" : "false") << ";" << std::endl;
+	stream << "constexpr const char* datamodel = \"" << (HAS_ATTR(_scxml, kXMLCharDataModel) ? ATTR(_scxml, kXMLCharDataModel) : "null") << "\";" << std::endl;
+	stream << std::endl;
+
+	stream << "enum StateType : uint8_t {" << std::endl;
+	stream << "    STATE_ATOMIC          = 0x01," << std::endl;
+	stream << "    STATE_PARALLEL        = 0x02," << std::endl;
+	stream << "    STATE_COMPOUND        = 0x03," << std::endl;
+	stream << "    STATE_FINAL           = 0x04," << std::endl;
+	stream << "    STATE_HISTORY_DEEP    = 0x05," << std::endl;
+	stream << "    STATE_HISTORY_SHALLOW = 0x06," << std::endl;
+	stream << "    STATE_INITIAL         = 0x07," << std::endl;
+	stream << "    STATE_HAS_HISTORY     = 0x80, /* highest bit */" << std::endl;
+	stream << "    STATE_MASK            = 0x7F" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "enum TransitionType : uint8_t {" << std::endl;
+	stream << "    TRANS_SPONTANEOUS     = 0x01," << std::endl;
+	stream << "    TRANS_TARGETLESS      = 0x02," << std::endl;
+	stream << "    TRANS_INTERNAL        = 0x04," << std::endl;
+	stream << "    TRANS_HISTORY         = 0x08," << std::endl;
+	stream << "    TRANS_INITIAL         = 0x10" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "struct State {" << std::endl;
+	stream << "    const char* name;" << std::endl;
+	stream << "    " << _stateDataType << " parent;" << std::endl;
+	stream << "    uint8_t type;" << std::endl;
+	stream << "    Event done;      ///< raised when the state is done" << std::endl;
+	stream << "    Action donedata; ///< of a final state" << std::endl;
+	stream << "    uint64_t children[stateWords];" << std::endl;
+	stream << "    uint64_t completion[stateWords];" << std::endl;
+	stream << "    uint64_t ancestors[stateWords];" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "struct Transition {" << std::endl;
+	stream << "    " << _stateDataType << " source;" << std::endl;
+	stream << "    uint8_t type;" << std::endl;
+	stream << "    uint64_t target[stateWords];" << std::endl;
+	stream << "    uint64_t conflicts[transWords];" << std::endl;
+	stream << "    uint64_t exitSet[stateWords];" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "/// A template only to define its static members in a header" << std::endl;
+	stream << "template<typename T = void>" << std::endl;
+	stream << "struct Tables {" << std::endl;
+	stream << "    static constexpr State states[nrStates] = {" << std::endl;
+	for (size_t i = 0; i < _states.size(); i++) {
+		DOMElement* state(_states[i]);
+
+		stream << "        {   /* state number " << toStr(i) << " */" << std::endl;
+		stream << "            /* name       */ " << (HAS_ATTR(state, kXMLCharId) ? "\"" + escape(ATTR(state, kXMLCharId)) + "\"" : "NULL") << "," << std::endl;
+		stream << "            /* parent     */ " << (i == 0 ? "0" : ATTR_CAST(state->getParentNode(), X("documentOrder"))) << "," << std::endl;
+
+		stream << "            /* type       */ ";
+		if (false) {
+		} else if (iequals(TAGNAME(state), "initial")) {
+			stream << "STATE_INITIAL";
+		} else if (isFinal(state)) {
+			stream << "STATE_FINAL";
+		} else if (isHistory(state)) {
+			if (HAS_ATTR(state, kXMLCharType) && iequals(ATTR(state, kXMLCharType), "deep")) {
+				stream << "STATE_HISTORY_DEEP";
+			} else {
+				stream << "STATE_HISTORY_SHALLOW";
+			}
+		} else if (isAtomic(state)) {
+			stream << "STATE_ATOMIC";
+		} else if (isParallel(state)) {
+			stream << "STATE_PARALLEL";
+		} else { // compound and <scxml>
+			stream << "STATE_COMPOUND";
+		}
+		if (HAS_ATTR(state, X("hasHistoryChild"))) {
+			stream << " | STATE_HAS_HISTORY";
+		}
+		stream << "," << std::endl;
+
+		stream << "            /* done       */ Event::" << _eventIdentifiers[_doneEvents[i]] << "," << std::endl;
+		stream << "            /* donedata   */ Action::" << _actions[_doneDataActions.find(i) != _doneDataActions.end() ? _doneDataActions[i] : 0].identifier << "," << std::endl;
+
+		stream << "            /* children   */ ";
+		writeWords(stream, ATTR(state, X("childBools")), _stateWords);
+		stream << "," << std::endl;
+		stream << "            /* completion */ ";
+		writeWords(stream, ATTR(state, X("completionBools")), _stateWords);
+		stream << "," << std::endl;
+		stream << "            /* ancestors  */ ";
+		writeWords(stream, ATTR(state, X("ancBools")), _stateWords);
+		stream << std::endl;
+		stream << "        }" << (i + 1 < _states.size() ? ",": "") << std::endl;
+	}
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	// a machine without transitions still needs a table of one to compile
+	stream << "    static constexpr Transition transitions[" << (_transitions.size() > 0 ? "nrTransitions" : "1") << "] = {" << std::endl;
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		DOMElement* transition(_transitions[i]);
+
+		stream << "        {   /* transition number " << ATTR(transition, X("documentOrder")) << " with priority " << toStr(i) << std::endl;
+		stream << "               target: " << ATTR(transition, kXMLCharTarget) << std::endl;
+		stream << "             */" << std::endl;
+		stream << "            /* source     */ " << ATTR_CAST(transition->getParentNode(), X("documentOrder")) << "," << std::endl;
+
+		stream << "            /* type       */ ";
+		std::string seperator = "";
+		if (!HAS_ATTR(transition, kXMLCharTarget)) {
+			stream << seperator << "TRANS_TARGETLESS";
+			seperator = " | ";
+		}
+		if (HAS_ATTR(transition, kXMLCharType) && iequals(ATTR(transition, kXMLCharType), "internal")) {
+			stream << seperator << "TRANS_INTERNAL";
+			seperator = " | ";
+		}
+		if (!HAS_ATTR(transition, kXMLCharEvent)) {
+			stream << seperator << "TRANS_SPONTANEOUS";
+			seperator = " | ";
+		}
+		if (iequals(TAGNAME_CAST(transition->getParentNode()), "history")) {
+			stream << seperator << "TRANS_HISTORY";
+			seperator = " | ";
+		}
+		if (iequals(TAGNAME_CAST(transition->getParentNode()), "initial")) {
+			stream << seperator << "TRANS_INITIAL";
+			seperator = " | ";
+		}
+		if (seperator.size() == 0) {
+			stream << "0";
+		}
+		stream << "," << std::endl;
+
+		stream << "            /* target     */ ";
+		writeWords(stream, HAS_ATTR(transition, X("targetBools")) ? ATTR(transition, X("targetBools")) : "", _stateWords);
+		stream << "," << std::endl;
+		stream << "            /* conflicts  */ ";
+		writeWords(stream, ATTR(transition, X("conflictBools")), _transWords);
+		stream << "," << std::endl;
+		stream << "            /* exit set   */ ";
+		writeWords(stream, ATTR(transition, X("exitSetBools")), _stateWords);
+		stream << std::endl;
+		stream << "        }" << (i + 1 < _transitions.size() ? ",": "") << std::endl;
+	}
+	if (_transitions.size() == 0) {
+		stream << "        { 0, 0, { 0 }, { 0 }, { 0 } }" << std::endl;
+	}
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	// history and initial transitions are only ever taken when their state is entered
+	std::string spontaneousBools;
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		DOMElement* transition(_transitions[i]);
+		spontaneousBools += (!HAS_ATTR(transition, kXMLCharEvent) &&
+		                     !iequals(TAGNAME_CAST(transition->getParentNode()), "history") &&
+		                     !iequals(TAGNAME_CAST(transition->getParentNode()), "initial") ? "1" : "0");
+	}
+	stream << "    /// transitions enabled without an event" << std::endl;
+	stream << "    static constexpr uint64_t spontaneous[transWords] = ";
+	writeWords(stream, spontaneousBools, _transWords);
+	stream << ";" << std::endl;
+	stream << std::endl;
+
+	stream << "    /// transitions enabled by each event" << std::endl;
+	stream << "    static constexpr uint64_t eventTransitions[nrEvents][transWords] = {" << std::endl;
+	for (size_t id = 0; id < _events.size(); id++) {
+		stream << "        ";
+		writeWords(stream, _eventTransBools[id], _transWords);
+		stream << (id + 1 < _events.size() ? "," : "") << " /* " << (id == 0 ? "unknown" : _events[id]) << " */" << std::endl;
+	}
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	stream << "    static constexpr const char* eventNames[nrEvents] = {" << std::endl;
+	for (size_t id = 0; id < _events.size(); id++) {
+		stream << "        \"" << escape(_events[id]) << "\"" << (id + 1 < _events.size() ? "," : "") << std::endl;
+	}
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	stream << "    /// perfect hash of the event descriptors to their ids" << std::endl;
+	stream << "    static constexpr " << typeFor(_events.size()) << " eventSlots[nrEventSlots] = {" << std::endl;
+	stream << "        ";
+	for (size_t i = 0; i < _eventSlots.size(); i++) {
+		stream << toStr(_eventSlots[i]) << (i + 1 < _eventSlots.size() ? ", " : "");
+	}
+	stream << std::endl;
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	stream << "    /// the original conditions and executable content, for hosts interpreting them" << std::endl;
+	stream << "    static constexpr const char* guardSources[nrGuards + 1] = {" << std::endl;
+	for (size_t i = 0; i < _guards.size(); i++) {
+		stream << "        \"" << escape(_guards[i].source) << "\"," << std::endl;
+	}
+	stream << "        NULL" << std::endl;
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	stream << "    static constexpr const char* actionSources[nrActions] = {" << std::endl;
+	for (size_t i = 0; i < _actions.size(); i++) {
+		if (i == 0) {
+			stream << "        NULL";
+		} else {
+			stream << "        \"" << escape(_actions[i].source) << "\"";
+		}
+		stream << (i + 1 < _actions.size() ? "," : "") << std::endl;
+	}
+	stream << "    };" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+
+	stream << "template<typename T> constexpr State Tables<T>::states[nrStates];" << std::endl;
+	stream << "template<typename T> constexpr Transition Tables<T>::transitions[" << (_transitions.size() > 0 ? "nrTransitions" : "1") << "];" << std::endl;
+	stream << "template<typename T> constexpr uint64_t Tables<T>::spontaneous[transWords];" << std::endl;
+	stream << "template<typename T> constexpr uint64_t Tables<T>::eventTransitions[nrEvents][transWords];" << std::endl;
+	stream << "template<typename T> constexpr const char* Tables<T>::eventNames[nrEvents];" << std::endl;
+	stream << "template<typename T> constexpr " << typeFor(_events.size()) << " Tables<T>::eventSlots[nrEventSlots];" << std::endl;
+	stream << "template<typename T> constexpr const char* Tables<T>::guardSources[nrGuards + 1];" << std::endl;
+	stream << "template<typename T> constexpr const char* Tables<T>::actionSources[nrActions];" << std::endl;
+	stream << std::endl;
+}
+
+void ChartToCpp::writeBitHelpers(std::ostream& stream) {
+	stream << "/* bitsets of whole words, their size is known at compile time and loops unroll */" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline bool bitHas(const uint64_t (&bits)[W], size_t i) {" << std::endl;
+	stream << "    return (bits[i >> 6] >> (i & 63)) & 1;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitSet(uint64_t (&bits)[W], size_t i) {" << std::endl;
+	stream << "    bits[i >> 6] |= ((uint64_t)1) << (i & 63);" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitUnset(uint64_t (&bits)[W], size_t i) {" << std::endl;
+	stream << "    bits[i >> 6] &= ~(((uint64_t)1) << (i & 63));" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "/// index of the first bit set at or after i, at least W * 64 if there is none" << std::endl;
+	stream << "template<size_t W> inline size_t bitNext(const uint64_t (&bits)[W], size_t i) {" << std::endl;
+	stream << "    while (i < W * 64) {" << std::endl;
+	stream << "        uint64_t word = bits[i >> 6] >> (i & 63);" << std::endl;
+	stream << "        if (word != 0) {" << std::endl;
+	stream << "#if defined(__GNUC__) || defined(__clang__)" << std::endl;
+	stream << "            return i + __builtin_ctzll(word);" << std::endl;
+	stream << "#else" << std::endl;
+	stream << "            while (!(word & 1)) {" << std::endl;
+	stream << "                word >>= 1;" << std::endl;
+	stream << "                i++;" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            return i;" << std::endl;
+	stream << "#endif" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        i = (i | 63) + 1;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    return i;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitsZero(uint64_t (&bits)[W]) {" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        bits[w] = 0;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitsCopy(uint64_t (&dest)[W], const uint64_t (&src)[W]) {" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        dest[w] = src[w];" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitsOr(uint64_t (&dest)[W], const uint64_t (&mask)[W]) {" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        dest[w] |= mask[w];" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitsAnd(uint64_t (&dest)[W], const uint64_t (&mask)[W]) {" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        dest[w] &= mask[w];" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline void bitsAndNot(uint64_t (&dest)[W], const uint64_t (&mask)[W]) {" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        dest[w] &= ~mask[w];" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline bool bitsIntersect(const uint64_t (&a)[W], const uint64_t (&b)[W]) {" << std::endl;
+	stream << "    uint64_t any = 0;" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        any |= a[w] & b[w];" << std::endl;
+	stream << "    return any != 0;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+	stream << "template<size_t W> inline bool bitsAny(const uint64_t (&bits)[W]) {" << std::endl;
+	stream << "    uint64_t any = 0;" << std::endl;
+	stream << "    for (size_t w = 0; w < W; w++)" << std::endl;
+	stream << "        any |= bits[w];" << std::endl;
+	stream << "    return any != 0;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+}
+
+void ChartToCpp::writeMachine(std::ostream& stream) {
+	stream << "template<class Callbacks>" << std::endl;
+	stream << "class Machine : public Callbacks {" << std::endl;
+	stream << "public:" << std::endl;
+	stream << "    typedef Tables<> Chart;" << std::endl;
+	stream << std::endl;
+	stream << "    Machine() {" << std::endl;
+	stream << "        reset();" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /// Back to a pristine machine, active states are not exited" << std::endl;
+	stream << "    void reset() {" << std::endl;
+	stream << "        bitsZero(_config);" << std::endl;
+	stream << "        bitsZero(_history);" << std::endl;
+	stream << "        bitsZero(_initialized);" << std::endl;
+	stream << "        _event = Event::Unknown;" << std::endl;
+	stream << "        _hasEvent = false;" << std::endl;
+	stream << "        _flags = PRISTINE;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /// Take a single microstep" << std::endl;
+	stream << "    Result step();" << std::endl;
+	stream << std::endl;
+	stream << "    bool isInState(StateId state) const {" << std::endl;
+	stream << "        return bitHas(_config, (size_t)state);" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    bool isInState(const char* name) const {" << std::endl;
+	stream << "        for (size_t i = 0; i < nrStates; i++) {" << std::endl;
+	stream << "            if (Chart::states[i].name != NULL && strcmp(Chart::states[i].name, name) == 0 && bitHas(_config, i))" << std::endl;
+	stream << "                return true;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        return false;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /// Reached a top-level final state and exited all states" << std::endl;
+	stream << "    bool isFinished() const {" << std::endl;
+	stream << "        return (_flags & FINISHED) != 0;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /// Whether the current microstep was taken for an event rather than spontaneously" << std::endl;
+	stream << "    bool hasEvent() const {" << std::endl;
+	stream << "        return _hasEvent;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    Event getEvent() const {" << std::endl;
+	stream << "        return _event;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /// Id of the longest event descriptor matching the given name, see uscxml_event_id" << std::endl;
+	stream << "    static Event eventFromName(const char* name) {" << std::endl;
+	stream << "        Event event = Event::Unknown;" << std::endl;
+	stream << "        uint32_t hash = 2166136261UL ^ eventSeed;" << std::endl;
+	stream << "        size_t i, j;" << std::endl;
+	stream << std::endl;
+	stream << "        if (name == NULL)" << std::endl;
+	stream << "            return event;" << std::endl;
+	stream << std::endl;
+	stream << "        /* FNV-1a, every prefix up to a dot or the end might be a descriptor */" << std::endl;
+	stream << "        for (i = 0; ; i++) {" << std::endl;
+	stream << "            if (name[i] == '.' || name[i] == '\\0') {" << std::endl;
+	stream << "                size_t candidate = Chart::eventSlots[hash & (nrEventSlots - 1)];" << std::endl;
+	stream << "                if (candidate != 0) {" << std::endl;
+	stream << "                    const char* descriptor = Chart::eventNames[candidate];" << std::endl;
+	stream << "                    for (j = 0; j < i && descriptor[j] == name[j]; j++);" << std::endl;
+	stream << "                    if (j == i && descriptor[j] == '\\0')" << std::endl;
+	stream << "                        event = (Event)candidate;" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "                if (name[i] == '\\0')" << std::endl;
+	stream << "                    break;" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            hash ^= (unsigned char)name[i];" << std::endl;
+	stream << "            hash *= 16777619UL;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        return event;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    static const char* eventName(Event event) {" << std::endl;
+	stream << "        return Chart::eventNames[(size_t)event];" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    static const char* stateName(size_t state) {" << std::endl;
+	stream << "        return Chart::states[state].name;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "protected:" << std::endl;
+	stream << "    enum Flags : uint8_t {" << std::endl;
+	stream << "        PRISTINE         = 0x00," << std::endl;
+	stream << "        SPONTANEOUS      = 0x01," << std::endl;
+	stream << "        INITIALIZED      = 0x02," << std::endl;
+	stream << "        TOP_LEVEL_FINAL  = 0x04," << std::endl;
+	stream << "        FINISHED         = 0x10" << std::endl;
+	stream << "    };" << std::endl;
+	stream << std::endl;
+
+	stream << "    bool isEnabled(size_t transition) {" << std::endl;
+	stream << "        switch (transition) {" << std::endl;
+	for (auto guard : _transGuards) {
+		stream << "        case " << toStr(guard.first) << ": return Callbacks::guard(*this, Guard::" << _guards[guard.second].identifier << ");" << std::endl;
+	}
+	stream << "        default: return true;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+
+	stream << "    void onScript() {" << std::endl;
+	if (_scriptAction != 0) {
+		stream << "        Callbacks::action(*this, Action::" << _actions[_scriptAction].identifier << ");" << std::endl;
+	}
+	stream << "    }" << std::endl;
+	stream << std::endl;
+
+	std::list<std::pair<std::string, std::map<size_t, size_t>* > > dispatches = {
+		{ "initData", &_dataActions },
+		{ "onEntry", &_entryActions },
+		{ "onExit", &_exitActions },
+		{ "onTrans", &_transActions }
+	};
+	for (auto dispatch : dispatches) {
+		stream << "    void " << dispatch.first << "(size_t " << (dispatch.first == "onTrans" ? "transition" : "state") << ") {" << std::endl;
+		stream << "        switch (" << (dispatch.first == "onTrans" ? "transition" : "state") << ") {" << std::endl;
+		for (auto action : *dispatch.second) {
+			stream << "        case " << toStr(action.first) << ": Callbacks::action(*this, Action::" << _actions[action.second].identifier << "); break;" << std::endl;
+		}
+		stream << "        default: break;" << std::endl;
+		stream << "        }" << std::endl;
+		stream << "    }" << std::endl;
+		stream << std::endl;
+	}
+
+	stream << "    uint64_t _config[stateWords];      ///< active states" << std::endl;
+	stream << "    uint64_t _history[stateWords];     ///< configuration remembered by history states" << std::endl;
+	stream << "    uint64_t _initialized[stateWords]; ///< states whose data was initialized" << std::endl;
+	stream << "    Event _event;" << std::endl;
+	stream << "    bool _hasEvent;" << std::endl;
+	stream << "    uint8_t _flags;" << std::endl;
+	stream << "};" << std::endl;
+	stream << std::endl;
+}
+
+void ChartToCpp::writeStep(std::ostream& stream) {
+	stream << "template<class Callbacks>" << std::endl;
+	stream << "Result Machine<Callbacks>::step() {" << std::endl;
+	stream << "    uint64_t conflicts [transWords];" << std::endl;
+	stream << "    uint64_t transSet  [transWords];" << std::endl;
+	stream << "    uint64_t targetSet [stateWords];" << std::endl;
+	stream << "    uint64_t exitSet   [stateWords];" << std::endl;
+	stream << "    uint64_t entrySet  [stateWords];" << std::endl;
+	stream << "    uint64_t tmpStates [stateWords];" << std::endl;
+	stream << "    const uint64_t (*enabled)[transWords];" << std::endl;
+	stream << "    bool found;" << std::endl;
+	stream << "    size_t i, j, k;" << std::endl;
+	stream << std::endl;
+	stream << "    if (_flags & FINISHED)" << std::endl;
+	stream << "        return Result::Done;" << std::endl;
+	stream << std::endl;
+	stream << "    if (_flags & TOP_LEVEL_FINAL) {" << std::endl;
+	stream << "        /* exit all remaining states */" << std::endl;
+	stream << "        i = nrStates;" << std::endl;
+	stream << "        while(i-- > 0) {" << std::endl;
+	stream << "            if (bitHas(_config, i))" << std::endl;
+	stream << "                onExit(i);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        _flags |= FINISHED;" << std::endl;
+	stream << "        return Result::Done;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    bitsZero(targetSet);" << std::endl;
+	stream << "    bitsZero(transSet);" << std::endl;
+	stream << "    bitsZero(exitSet);" << std::endl;
+	stream << "    if (_flags == PRISTINE) {" << std::endl;
+	stream << "        onScript();" << std::endl;
+	stream << "        bitsOr(targetSet, Chart::states[0].completion);" << std::endl;
+	stream << "        _flags |= SPONTANEOUS | INITIALIZED;" << std::endl;
+	stream << "        goto ESTABLISH_ENTRY_SET;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "DEQUEUE_EVENT:" << std::endl;
+	stream << "    if (_flags & SPONTANEOUS) {" << std::endl;
+	stream << "        _hasEvent = false;" << std::endl;
+	stream << "    } else if (Callbacks::dequeueInternal(*this, _event) || Callbacks::dequeueExternal(*this, _event)) {" << std::endl;
+	stream << "        _hasEvent = true;" << std::endl;
+	stream << "    } else {" << std::endl;
+	stream << "        return Result::Idle;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "/* SELECT_TRANSITIONS: */" << std::endl;
+	stream << "    bitsZero(conflicts);" << std::endl;
+	stream << "    bitsZero(exitSet);" << std::endl;
+	stream << "    found = false;" << std::endl;
+	stream << std::endl;
+	stream << "    /* only transitions of the event's descriptors are candidates, in order of priority */" << std::endl;
+	stream << "    enabled = (_hasEvent ? &Chart::eventTransitions[(size_t)_event] : &Chart::spontaneous);" << std::endl;
+	stream << "    for (i = bitNext(*enabled, 0); i < nrTransitions; i = bitNext(*enabled, i + 1)) {" << std::endl;
+	stream << "        /* is the transition active, non-conflicting and enabled? */" << std::endl;
+	stream << "        if (bitHas(_config, Chart::transitions[i].source) && !bitHas(conflicts, i) && isEnabled(i)) {" << std::endl;
+	stream << "            found = true;" << std::endl;
+	stream << std::endl;
+	stream << "            /* transitions that are pre-empted */" << std::endl;
+	stream << "            bitsOr(conflicts, Chart::transitions[i].conflicts);" << std::endl;
+	stream << "            /* states that are directly targeted (resolve as entry-set later) */" << std::endl;
+	stream << "            bitsOr(targetSet, Chart::transitions[i].target);" << std::endl;
+	stream << "            /* states that will be left */" << std::endl;
+	stream << "            bitsOr(exitSet, Chart::transitions[i].exitSet);" << std::endl;
+	stream << std::endl;
+	stream << "            bitSet(transSet, i);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << "    bitsAnd(exitSet, _config);" << std::endl;
+	stream << std::endl;
+	stream << "    if (found) {" << std::endl;
+	stream << "        _flags |= SPONTANEOUS;" << std::endl;
+	stream << "    } else {" << std::endl;
+	stream << "        _flags &= ~SPONTANEOUS;" << std::endl;
+	stream << "        goto DEQUEUE_EVENT;" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "/* REMEMBER_HISTORY: */" << std::endl;
+	stream << "    for (i = 0; hasHistory && i < nrStates; i++) {" << std::endl;
+	stream << "        if ((Chart::states[i].type & STATE_MASK) == STATE_HISTORY_SHALLOW ||" << std::endl;
+	stream << "            (Chart::states[i].type & STATE_MASK) == STATE_HISTORY_DEEP) {" << std::endl;
+	stream << "            /* a history state whose parent is about to be exited */" << std::endl;
+	stream << "            if (bitHas(exitSet, Chart::states[i].parent)) {" << std::endl;
+	stream << "                bitsCopy(tmpStates, Chart::states[i].completion);" << std::endl;
+	stream << "                bitsAnd(tmpStates, _config);" << std::endl;
+	stream << "                bitsAndNot(_history, Chart::states[i].completion);" << std::endl;
+	stream << "                bitsOr(_history, tmpStates);" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "ESTABLISH_ENTRY_SET:" << std::endl;
+	stream << "    bitsCopy(entrySet, targetSet);" << std::endl;
+	stream << std::endl;
+	stream << "    /* iterate for ancestors */" << std::endl;
+	stream << "    for (i = bitNext(entrySet, 0); i < nrStates; i = bitNext(entrySet, i + 1)) {" << std::endl;
+	stream << "        bitsOr(entrySet, Chart::states[i].ancestors);" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    /* iterate for descendants */" << std::endl;
+	stream << "    for (i = bitNext(entrySet, 0); i < nrStates; i = bitNext(entrySet, i + 1)) {" << std::endl;
+	stream << "        switch (Chart::states[i].type & STATE_MASK) {" << std::endl;
+	stream << "        case STATE_PARALLEL: {" << std::endl;
+	stream << "            bitsOr(entrySet, Chart::states[i].completion);" << std::endl;
+	stream << "            break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        case STATE_HISTORY_SHALLOW:" << std::endl;
+	stream << "        case STATE_HISTORY_DEEP: {" << std::endl;
+	stream << "            if (!bitsIntersect(Chart::states[i].completion, _history) &&" << std::endl;
+	stream << "                !bitHas(_config, Chart::states[i].parent)) {" << std::endl;
+	stream << "                /* nothing set for history, look for a default transition */" << std::endl;
+	stream << "                for (j = 0; j < nrTransitions; j++) {" << std::endl;
+	stream << "                    if (Chart::transitions[j].source == i) {" << std::endl;
+	stream << "                        bitsOr(entrySet, Chart::transitions[j].target);" << std::endl;
+	stream << "                        if ((Chart::states[i].type & STATE_MASK) == STATE_HISTORY_DEEP &&" << std::endl;
+	stream << "                            !bitsIntersect(Chart::transitions[j].target, Chart::states[i].children)) {" << std::endl;
+	stream << "                            for (k = i + 1; k < nrStates; k++) {" << std::endl;
+	stream << "                                if (bitHas(Chart::transitions[j].target, k)) {" << std::endl;
+	stream << "                                    bitsOr(entrySet, Chart::states[k].ancestors);" << std::endl;
+	stream << "                                    break;" << std::endl;
+	stream << "                                }" << std::endl;
+	stream << "                            }" << std::endl;
+	stream << "                        }" << std::endl;
+	stream << "                        bitSet(transSet, j);" << std::endl;
+	stream << "                        break;" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "            } else {" << std::endl;
+	stream << "                bitsCopy(tmpStates, Chart::states[i].completion);" << std::endl;
+	stream << "                bitsAnd(tmpStates, _history);" << std::endl;
+	stream << "                bitsOr(entrySet, tmpStates);" << std::endl;
+	stream << "                if (Chart::states[i].type == (STATE_HAS_HISTORY | STATE_HISTORY_DEEP)) {" << std::endl;
+	stream << "                    /* a deep history state with nested histories -> more completion */" << std::endl;
+	stream << "                    for (j = i + 1; j < nrStates; j++) {" << std::endl;
+	stream << "                        if (bitHas(Chart::states[i].completion, j) &&" << std::endl;
+	stream << "                            bitHas(entrySet, j) &&" << std::endl;
+	stream << "                            (Chart::states[j].type & STATE_HAS_HISTORY)) {" << std::endl;
+	stream << "                            for (k = j + 1; k < nrStates; k++) {" << std::endl;
+	stream << "                                /* add nested history to entry set */" << std::endl;
+	stream << "                                if (((Chart::states[k].type & STATE_MASK) == STATE_HISTORY_DEEP ||" << std::endl;
+	stream << "                                     (Chart::states[k].type & STATE_MASK) == STATE_HISTORY_SHALLOW) &&" << std::endl;
+	stream << "                                    bitHas(Chart::states[j].children, k)) {" << std::endl;
+	stream << "                                    bitSet(entrySet, k);" << std::endl;
+	stream << "                                }" << std::endl;
+	stream << "                            }" << std::endl;
+	stream << "                        }" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        case STATE_INITIAL: {" << std::endl;
+	stream << "            for (j = 0; j < nrTransitions; j++) {" << std::endl;
+	stream << "                if (Chart::transitions[j].source == i) {" << std::endl;
+	stream << "                    bitSet(transSet, j);" << std::endl;
+	stream << "                    bitUnset(entrySet, i);" << std::endl;
+	stream << "                    bitsOr(entrySet, Chart::transitions[j].target);" << std::endl;
+	stream << "                    for (k = i + 1; k < nrStates; k++) {" << std::endl;
+	stream << "                        if (bitHas(Chart::transitions[j].target, k)) {" << std::endl;
+	stream << "                            bitsOr(entrySet, Chart::states[k].ancestors);" << std::endl;
+	stream << "                        }" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        case STATE_COMPOUND: { /* we need to check whether one child is already in the entry set */" << std::endl;
+	stream << "            if (!bitsIntersect(entrySet, Chart::states[i].children) &&" << std::endl;
+	stream << "                (!bitsIntersect(_config, Chart::states[i].children) ||" << std::endl;
+	stream << "                 bitsIntersect(exitSet, Chart::states[i].children))) {" << std::endl;
+	stream << "                bitsOr(entrySet, Chart::states[i].completion);" << std::endl;
+	stream << "                if (!bitsIntersect(Chart::states[i].completion, Chart::states[i].children)) {" << std::endl;
+	stream << "                    /* deep completion */" << std::endl;
+	stream << "                    for (j = i + 1; j < nrStates; j++) {" << std::endl;
+	stream << "                        if (bitHas(Chart::states[i].completion, j)) {" << std::endl;
+	stream << "                            bitsOr(entrySet, Chart::states[j].ancestors);" << std::endl;
+	stream << "                            break; /* completion of compound is single state */" << std::endl;
+	stream << "                        }" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "            break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "        default:" << std::endl;
+	stream << "            break;" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "/* EXIT_STATES: */" << std::endl;
+	stream << "    i = nrStates;" << std::endl;
+	stream << "    while(i-- > 0) {" << std::endl;
+	stream << "        if (bitHas(exitSet, i) && bitHas(_config, i)) {" << std::endl;
+	stream << "            onExit(i);" << std::endl;
+	stream << "            bitUnset(_config, i);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "/* TAKE_TRANSITIONS: */" << std::endl;
+	stream << "    for (i = bitNext(transSet, 0); i < nrTransitions; i = bitNext(transSet, i + 1)) {" << std::endl;
+	stream << "        if ((Chart::transitions[i].type & (TRANS_HISTORY | TRANS_INITIAL)) == 0) {" << std::endl;
+	stream << "            onTrans(i);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "/* ENTER_STATES: */" << std::endl;
+	stream << "    for (i = bitNext(entrySet, 0); i < nrStates; i = bitNext(entrySet, i + 1)) {" << std::endl;
+	stream << "        if (bitHas(_config, i))" << std::endl;
+	stream << "            continue;" << std::endl;
+	stream << std::endl;
+	stream << "        /* these are no proper states */" << std::endl;
+	stream << "        if ((Chart::states[i].type & STATE_MASK) == STATE_HISTORY_DEEP ||" << std::endl;
+	stream << "            (Chart::states[i].type & STATE_MASK) == STATE_HISTORY_SHALLOW ||" << std::endl;
+	stream << "            (Chart::states[i].type & STATE_MASK) == STATE_INITIAL)" << std::endl;
+	stream << "            continue;" << std::endl;
+	stream << std::endl;
+	stream << "        bitSet(_config, i);" << std::endl;
+	stream << std::endl;
+	stream << "        /* initialize data */" << std::endl;
+	stream << "        if (!bitHas(_initialized, i)) {" << std::endl;
+	stream << "            initData(i);" << std::endl;
+	stream << "            bitSet(_initialized, i);" << std::endl;
+	stream << "        }" << std::endl;
+	stream << std::endl;
+	stream << "        onEntry(i);" << std::endl;
+	stream << std::endl;
+	stream << "        /* take history and initial transitions */" << std::endl;
+	stream << "        for (j = bitNext(transSet, 0); j < nrTransitions; j = bitNext(transSet, j + 1)) {" << std::endl;
+	stream << "            if ((Chart::transitions[j].type & (TRANS_HISTORY | TRANS_INITIAL)) &&" << std::endl;
+	stream << "                Chart::states[Chart::transitions[j].source].parent == i) {" << std::endl;
+	stream << "                onTrans(j);" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "        }" << std::endl;
+	stream << std::endl;
+	stream << "        /* handle final states */" << std::endl;
+	stream << "        if ((Chart::states[i].type & STATE_MASK) == STATE_FINAL) {" << std::endl;
+	stream << "            if (Chart::states[i].parent == 0) {" << std::endl;
+	stream << "                _flags |= TOP_LEVEL_FINAL;" << std::endl;
+	stream << "            } else {" << std::endl;
+	stream << "                /* raise done event */" << std::endl;
+	stream << "                k = Chart::states[i].parent;" << std::endl;
+	stream << "                Callbacks::raiseDone(*this, Chart::states[k].done, k, Chart::states[i].donedata);" << std::endl;
+	stream << "            }" << std::endl;
+	stream << std::endl;
+	stream << "            /**" << std::endl;
+	stream << "             * are we the last final state to leave a parallel state?:" << std::endl;
+	stream << "             * 1. Gather all parallel states in our ancestor chain" << std::endl;
+	stream << "             * 2. Find all states for which these parallels are ancestors" << std::endl;
+	stream << "             * 3. Iterate all active final states and remove their ancestors" << std::endl;
+	stream << "             * 4. If a state remains, not all children of a parallel are final" << std::endl;
+	stream << "             */" << std::endl;
+	stream << "            for (j = 0; j < nrStates; j++) {" << std::endl;
+	stream << "                if ((Chart::states[j].type & STATE_MASK) == STATE_PARALLEL &&" << std::endl;
+	stream << "                    bitHas(Chart::states[i].ancestors, j)) {" << std::endl;
+	stream << "                    bitsZero(tmpStates);" << std::endl;
+	stream << "                    for (k = 0; k < nrStates; k++) {" << std::endl;
+	stream << "                        if (bitHas(Chart::states[k].ancestors, j) && bitHas(_config, k)) {" << std::endl;
+	stream << "                            if ((Chart::states[k].type & STATE_MASK) == STATE_FINAL) {" << std::endl;
+	stream << "                                bitsAndNot(tmpStates, Chart::states[k].ancestors);" << std::endl;
+	stream << "                            } else {" << std::endl;
+	stream << "                                bitSet(tmpStates, k);" << std::endl;
+	stream << "                            }" << std::endl;
+	stream << "                        }" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                    if (!bitsAny(tmpStates)) {" << std::endl;
+	stream << "                        Callbacks::raiseDone(*this, Chart::states[j].done, j, Action::None);" << std::endl;
+	stream << "                    }" << std::endl;
+	stream << "                }" << std::endl;
+	stream << "            }" << std::endl;
+	stream << "        }" << std::endl;
+	stream << "    }" << std::endl;
+	stream << std::endl;
+	stream << "    return Result::Ok;" << std::endl;
+	stream << "}" << std::endl;
+	stream << std::endl;
+}
+
+}
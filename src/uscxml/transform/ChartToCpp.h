@@ -0,0 +1,90 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef CHARTTOCPP_H_7E1C3A92
+#define CHARTTOCPP_H_7E1C3A92
+
+#include "Transformer.h"
+#include "ChartToC.h"
+#include "uscxml/util/DOM.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+namespace uscxml {
+
+/**
+ * Writes a machine as a single C++11 header: constexpr tables of states,
+ * transitions and 64 bit word bitsets, an enum class of the event
+ * descriptors and a template Machine<Callbacks> with the step function.
+ * Conditions and blocks of executable content are enumerated as Guard and
+ * Action and passed to static functions of the callbacks, which the
+ * compiler can inline into the step.
+ */
+class USCXML_API ChartToCpp : public ChartToC {
+public:
+	virtual ~ChartToCpp();
+	static Transformer transform(const Interpreter& other);
+
+	void writeTo(std::ostream& stream);
+
+protected:
+	ChartToCpp(const Interpreter& other);
+
+	/// A condition or block of executable content handed to the callbacks
+	struct Block {
+		std::string identifier;
+		std::string source;
+	};
+
+	void prepareBlocks();
+	size_t addAction(const std::string& identifier, const std::list<XERCESC_NS::DOMElement*>& elements);
+
+	void writeEnums(std::ostream& stream);
+	void writeTables(std::ostream& stream);
+	void writeBitHelpers(std::ostream& stream);
+	void writeMachine(std::ostream& stream);
+	void writeStep(std::ostream& stream);
+	void writeWords(std::ostream& stream, const std::string& boolString, size_t nrWords);
+
+	std::string _namespace;
+	size_t _stateWords;
+	size_t _transWords;
+
+	std::vector<std::string> _eventIdentifiers; ///< by event id
+	std::vector<std::string> _stateIdentifiers; ///< by state, empty for states without an id
+	std::vector<size_t> _doneEvents; ///< event id of done.state.ID per state
+
+	std::vector<Block> _guards;
+	std::vector<Block> _actions; ///< the first one is Action::None
+	std::map<size_t, size_t> _transGuards; ///< guard per transition
+	std::map<size_t, size_t> _transActions;
+	std::map<size_t, size_t> _entryActions; ///< action per state
+	std::map<size_t, size_t> _exitActions;
+	std::map<size_t, size_t> _dataActions;
+	std::map<size_t, size_t> _doneDataActions;
+	size_t _scriptAction;
+};
+
+}
+
+#endif /* end of include guard: CHARTTOCPP_H_7E1C3A92 */
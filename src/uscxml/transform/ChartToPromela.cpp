@@ -42,9 +42,9 @@
 stream << std::endl; \
 stream << "#if TRACE_EXECUTION" << std::endl; \
 if (_machinesAll->size() > 1) {\
-    stream << "printf(\"%d: " fmt "\\n\", _pid, " __VA_ARGS__ ");" << std::endl; \
+    stream << "printf(\"%d: " fmt "\\n\", _pid, " << __VA_ARGS__ << ");" << std::endl; \
 } else { \
-    stream << "printf(\"" fmt "\\n\", " __VA_ARGS__ ");" << std::endl; \
+    stream << "printf(\"" fmt "\\n\", " << __VA_ARGS__ << ");" << std::endl; \
 } \
 stream << "#endif" << std::endl; \
 stream << std::endl;
@@ -123,6 +123,7 @@ void ChartToPromela::prepare() {
 		}
 
 		_machinesNested[invoke] = new ChartToPromela(nested);
+		_machinesNested[invoke]->_packedVector = _packedVector;
 		_machinesNested[invoke]->_analyzer = _analyzer;
 		_machinesNested[invoke]->_analyzer->analyze(_machinesNested[invoke]);
 		_machinesNested[invoke]->prepare();
@@ -209,6 +210,7 @@ void ChartToPromela::prepare() {
 void ChartToPromela::writeTo(std::ostream& stream) {
 	_prefix = "ROOT_";
 	_invokerid = "ROOT";
+	_packedVector = (_extensions.find("vector") != _extensions.end() && _extensions.find("vector")->second == "packed");
 	_analyzer = new PromelaCodeAnalyzer();
 	_analyzer->analyze(this);
 	_analyzer->createMacroName(_invokerid);
@@ -218,7 +220,11 @@ void ChartToPromela::writeTo(std::ostream& stream) {
 	stream << "  " << std::string(_baseURL) << std::endl;
 	stream << "  Verify as:" << std::endl;
 	stream << "  $ spin -a this.pml" << std::endl;
-	stream << "  $ gcc -DMEMLIM=1024 -DVECTORSZ=8192 -O2 -DXUSAFE pan.c -o pan" << std::endl;
+	if (_packedVector) {
+		stream << "  $ gcc -DMEMLIM=1024 -DVECTORSZ=2048 -DCOLLAPSE -O2 -DXUSAFE pan.c -o pan" << std::endl;
+	} else {
+		stream << "  $ gcc -DMEMLIM=1024 -DVECTORSZ=8192 -O2 -DXUSAFE pan.c -o pan" << std::endl;
+	}
 	stream << "  $ ./pan -a -m10000 -n -N w3c" << std::endl;
 	stream << " */" << std::endl;
 	stream << std::endl;
@@ -298,8 +304,8 @@ void ChartToPromela::writeTo(std::ostream& stream) {
 		stream << std::endl;
 
 		stream << "/* initialize data model variables */" << std::endl;
-		stream << "  " << machine.second->_prefix << "flags[USCXML_CTX_PRISTINE]  = true;" << std::endl;
-		stream << "  " << machine.second->_prefix << "flags[USCXML_CTX_SPONTANEOUS] = true;" << std::endl;
+		stream << "  " << bitSet(machine.second->_prefix + "flags", "USCXML_CTX_PRISTINE", true) << ";" << std::endl;
+		stream << "  " << bitSet(machine.second->_prefix + "flags", "USCXML_CTX_SPONTANEOUS", true) << ";" << std::endl;
 
 		for (auto initializer : machine.second->_varInitializers) {
 			stream << _analyzer->adaptCode(beautifyIndentation(initializer, 1), machine.second->_prefix) << std::endl;
@@ -311,20 +317,23 @@ void ChartToPromela::writeTo(std::ostream& stream) {
 	stream << "  run " << _prefix << "step() priority 10;" << std::endl;
 	stream << "}" << std::endl;
 	stream << std::endl;
-	stream << "ltl w3c { eventually (" << _prefix << "config[" << _prefix << "PASS]) }" << std::endl;
+	stream << "ltl w3c { eventually (" << bitHas(_prefix + "config", _prefix + "PASS") << ") }" << std::endl;
 
 }
 
 void ChartToPromela::writeBitAndMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** and'ing bits in a with mask */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_AND(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << "a[" << i << "] = a[" << i << "] & mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
 
 	stream << "#define " << _prefix << "STATES_AND(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << "a[" << i << "] = a[" << i << "] & mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
@@ -332,31 +341,37 @@ void ChartToPromela::writeBitAndMacro(std::ostream& stream) {
 }
 
 void ChartToPromela::writeBitAndNotMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** not and'ing bits in a with mask */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_AND_NOT(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
-		stream << "a[" << i << "] = a[" << i << "] & !mask[" << i << "]; \\" << std::endl;
+	for (size_t i = 0; i < nrTransElements; i++) {
+		stream << "a[" << i << "] = a[" << i << "] & " << (_packedVector ? "~" : "!") << "mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
 
 	stream << "#define " << _prefix << "STATES_AND_NOT(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
-		stream << "a[" << i << "] = a[" << i << "] & !mask[" << i << "]; \\" << std::endl;
+	for (size_t i = 0; i < nrStateElements; i++) {
+		stream << "a[" << i << "] = a[" << i << "] & " << (_packedVector ? "~" : "!") << "mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
 
 }
 
 void ChartToPromela::writeBitCopyMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** copy bits from a to b */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_COPY(a, b) \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << "a[" << i << "] = b[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
 
 	stream << "#define " << _prefix << "STATES_COPY(a, b) \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << "a[" << i << "] = b[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
@@ -365,11 +380,14 @@ void ChartToPromela::writeBitCopyMacro(std::ostream& stream) {
 }
 
 void ChartToPromela::writeBitHasAndMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** is there a common bit in t1 and t2 */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_HAS_AND(a, b) \\" << std::endl;
 
 	stream << "(false \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << " || a[" << i << "] & b[" << i << "] \\" << std::endl;
 	}
 	stream << ")" << std::endl;
@@ -378,7 +396,7 @@ void ChartToPromela::writeBitHasAndMacro(std::ostream& stream) {
 	stream << "#define " << _prefix << "STATES_HAS_AND(a, b) \\" << std::endl;
 
 	stream << "(false \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << " || a[" << i << "] & b[" << i << "] \\" << std::endl;
 	}
 	stream << ")" << std::endl;
@@ -387,11 +405,14 @@ void ChartToPromela::writeBitHasAndMacro(std::ostream& stream) {
 }
 
 void ChartToPromela::writeBitHasAnyMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** is there bit set in a */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_HAS_ANY(a) \\" << std::endl;
 
 	stream << "(false \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << " || a[" << i << "] \\" << std::endl;
 	}
 	stream << ")" << std::endl;
@@ -400,7 +421,7 @@ void ChartToPromela::writeBitHasAnyMacro(std::ostream& stream) {
 	stream << "#define " << _prefix << "STATES_HAS_ANY(a) \\" << std::endl;
 
 	stream << "(false \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << " || a[" << i << "] \\" << std::endl;
 	}
 	stream << ")" << std::endl;
@@ -409,15 +430,18 @@ void ChartToPromela::writeBitHasAnyMacro(std::ostream& stream) {
 }
 
 void ChartToPromela::writeBitOrMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** or'ing bits in a with mask */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_OR(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << "a[" << i << "] = a[" << i << "] | mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
 
 	stream << "#define " << _prefix << "STATES_OR(a, mask) \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << "a[" << i << "] = a[" << i << "] | mask[" << i << "]; \\" << std::endl;
 	}
 	stream << std::endl;
@@ -425,15 +449,18 @@ void ChartToPromela::writeBitOrMacro(std::ostream& stream) {
 }
 
 void ChartToPromela::writeBitClearMacro(std::ostream& stream) {
+	size_t nrTransElements = (_packedVector ? bitsetWords(_transitions.size()) : _transitions.size());
+	size_t nrStateElements = (_packedVector ? bitsetWords(_states.size()) : _states.size());
+
 	stream << "/** clearing all bits of a */" << std::endl;
 	stream << "#define " << _prefix << "TRANS_CLEAR(a) \\" << std::endl;
-	for (size_t i = 0; i < _transitions.size(); i++) {
+	for (size_t i = 0; i < nrTransElements; i++) {
 		stream << "a[" << i << "] = false; \\" << std::endl;
 	}
 	stream << std::endl;
 
 	stream << "#define " << _prefix << "STATES_CLEAR(a) \\" << std::endl;
-	for (size_t i = 0; i < _states.size(); i++) {
+	for (size_t i = 0; i < nrStateElements; i++) {
 		stream << "a[" << i << "] = false; \\" << std::endl;
 	}
 	stream << std::endl;
@@ -454,7 +481,7 @@ void ChartToPromela::printBitArray(std::ostream& stream,
 	}
 	stream << "\", " << std::endl;
 	for (size_t i = 0; i < length; i++) {
-		stream << padding << "    " << array << "[" << toStr(i) << "]";
+		stream << padding << "    " << bitHas(array, toStr(i));
 		if (i + 1 < length) {
 			stream << ", " << std::endl;
 		}
@@ -462,6 +489,52 @@ void ChartToPromela::printBitArray(std::ostream& stream,
 	stream << ");" << std::endl;
 }
 
+size_t ChartToPromela::bitsetWords(size_t nrBits) {
+	return (nrBits + 31) / 32;
+}
+
+std::string ChartToPromela::declBitset(const std::string& identifier, size_t nrBits) {
+	if (!_packedVector)
+		return "bool " + identifier + "[" + toStr(nrBits) + "]";
+	// a single byte will do for the flags and small machines
+	if (nrBits <= 8)
+		return "byte " + identifier + "[1]";
+	return "int " + identifier + "[" + toStr(bitsetWords(nrBits)) + "]";
+}
+
+std::string ChartToPromela::bitHas(const std::string& bitset, const std::string& index) {
+	if (!_packedVector)
+		return bitset + "[" + index + "]";
+	return "BIT_HAS(" + bitset + ", " + index + ")";
+}
+
+std::string ChartToPromela::bitSet(const std::string& bitset, const std::string& index, bool value) {
+	if (!_packedVector)
+		return bitset + "[" + index + "] = " + (value ? "true" : "false");
+	return std::string(value ? "BIT_SET(" : "BIT_CLEAR(") + bitset + ", " + index + ")";
+}
+
+void ChartToPromela::writeBitsetInit(std::ostream& stream, const std::string& bitset, const std::string& bools) {
+	if (!_packedVector) {
+		for (size_t i = 0; i < bools.size(); i++) {
+			if (bools[i] == '1')
+				stream << "  " << bitset << "[" << toStr(i) << "] = 1;" << std::endl;
+		}
+		return;
+	}
+
+	// assign whole words, as signed decimals for they are ints in promela
+	for (size_t word = 0; word < bitsetWords(bools.size()); word++) {
+		uint32_t value = 0;
+		for (size_t i = word * 32; i < bools.size() && i < (word + 1) * 32; i++) {
+			if (bools[i] == '1')
+				value |= (uint32_t)1 << (i % 32);
+		}
+		if (value != 0)
+			stream << "  " << bitset << "[" << toStr(word) << "] = " << (int32_t)value << ";" << std::endl;
+	}
+}
+
 void ChartToPromela::writeMacros(std::ostream& stream) {
 	stream << "/* machine state flags */" << std::endl;
 	stream << "#define USCXML_CTX_PRISTINE          0 /* can be out-factored */" << std::endl;
@@ -495,6 +568,16 @@ void ChartToPromela::writeMacros(std::ostream& stream) {
 
 	stream << "#define USCXML_EVENT_SPONTANEOUS     0" << std::endl;
 	stream << std::endl;
+
+	if (_packedVector) {
+		stream << "/* bitsets packed into words of 32 bits */" << std::endl;
+		stream << "#define BIT_WORD(i)                  ((i) >> 5)" << std::endl;
+		stream << "#define BIT_MASK(i)                  (1 << ((i) & 31))" << std::endl;
+		stream << "#define BIT_HAS(a, i)                ((a[BIT_WORD(i)] & BIT_MASK(i)) != 0)" << std::endl;
+		stream << "#define BIT_SET(a, i)                a[BIT_WORD(i)] = a[BIT_WORD(i)] | BIT_MASK(i)" << std::endl;
+		stream << "#define BIT_CLEAR(a, i)              a[BIT_WORD(i)] = a[BIT_WORD(i)] & ~BIT_MASK(i)" << std::endl;
+		stream << std::endl;
+	}
 	stream << "#define TRACE_EXECUTION              1" << std::endl;
 	stream << std::endl;
 
@@ -521,6 +604,19 @@ void ChartToPromela::writeCommonTypeDefs(std::ostream& stream) {
 	}
 	individualDefs.pop_front();
 
+	// events are sent over channels, keep native types for all their fields
+	std::set<std::string> messageTypes;
+	if (typeDefs.types.find("_event") != typeDefs.types.end()) {
+		currDefs.push_back(typeDefs.types["_event"]);
+		while(currDefs.size() > 0) {
+			messageTypes.insert(currDefs.front().name);
+			for (std::map<std::string, PromelaCodeAnalyzer::PromelaTypedef>::iterator typeIter = currDefs.front().types.begin(); typeIter != currDefs.front().types.end(); typeIter++) {
+				currDefs.push_back(typeIter->second);
+			}
+			currDefs.pop_front();
+		}
+	}
+
 	for (std::list<PromelaCodeAnalyzer::PromelaTypedef>::reverse_iterator rIter = individualDefs.rbegin(); rIter != individualDefs.rend(); rIter++) {
 		PromelaCodeAnalyzer::PromelaTypedef currDef = *rIter;
 
@@ -554,7 +650,8 @@ void ChartToPromela::writeCommonTypeDefs(std::ostream& stream) {
 				continue;
 			}
 			if (tIter->second.types.size() == 0) {
-				stream << "  " << declForRange(tIter->first, tIter->second.minValue, tIter->second.maxValue, true) << ";" << std::endl; // not further nested
+				bool nativeOnly = !_packedVector || messageTypes.find(currDef.name) != messageTypes.end();
+				stream << "  " << declForRange(tIter->first, tIter->second.minValue, tIter->second.maxValue, nativeOnly) << ";" << std::endl; // not further nested
 				//				stream << "  int " << tIter->first << ";" << std::endl; // not further nested
 			} else {
 				stream << "  " << tIter->second.name << " " << tIter->first << ";" << std::endl;
@@ -605,10 +702,10 @@ void ChartToPromela::writeCommonVariables(std::ostream& stream) {
 
 void ChartToPromela::writeVariables(std::ostream& stream) {
 	stream << "/* custom definitions and global variables */" << std::endl;
-	stream << "bool " << _prefix << "flags[6];" << std::endl;
-	stream << "bool " << _prefix << "config[" << _states.size() << "];" << std::endl;
-	stream << "bool " << _prefix << "history[" << _states.size() << "];" << std::endl;
-	stream << "bool " << _prefix << "invocations[" << _states.size() << "];" << std::endl;
+	stream << declBitset(_prefix + "flags", 6) << ";" << std::endl;
+	stream << declBitset(_prefix + "config", _states.size()) << ";" << std::endl;
+	stream << declBitset(_prefix + "history", _states.size()) << ";" << std::endl;
+	stream << declBitset(_prefix + "invocations", _states.size()) << ";" << std::endl;
 //	stream << "bool " << _prefix << "initialized_data[" << _states.size() << "];" << std::endl;
 
 	size_t tolerance = 6;
@@ -634,10 +731,10 @@ void ChartToPromela::writeVariables(std::ostream& stream) {
 		stream << std::endl;
 		stream << "typedef " << _prefix << "transition_t {" << std::endl;
 		stream << "  unsigned source : " << BIT_WIDTH(_states.size()) << ";" << std::endl;
-		stream << "  bool target[" << _states.size() << "];" << std::endl;
+		stream << "  " << declBitset("target", _states.size()) << ";" << std::endl;
 		stream << "  bool type[5];" << std::endl;
-		stream << "  bool conflicts[" << _transitions.size() << "];" << std::endl;
-		stream << "  bool exit_set[" << _states.size() << "];" << std::endl;
+		stream << "  " << declBitset("conflicts", _transitions.size()) << ";" << std::endl;
+		stream << "  " << declBitset("exit_set", _states.size()) << ";" << std::endl;
 		stream << "}" << std::endl;
 		stream << "hidden " << _prefix << "transition_t " << _prefix << "transitions[" << toStr(_transitions.size()) << "];" << std::endl;
 		stream << std::endl;
@@ -646,9 +743,9 @@ void ChartToPromela::writeVariables(std::ostream& stream) {
 	if (_states.size() > 0) {
 		stream << "typedef " << _prefix << "state_t {" << std::endl;
 		stream << "  unsigned parent : " << BIT_WIDTH(_states.size()) << ";" << std::endl;
-		stream << "  bool children[" << _states.size() << "];" << std::endl;
-		stream << "  bool completion[" << _states.size() << "];" << std::endl;
-		stream << "  bool ancestors[" << _states.size() << "];" << std::endl;
+		stream << "  " << declBitset("children", _states.size()) << ";" << std::endl;
+		stream << "  " << declBitset("completion", _states.size()) << ";" << std::endl;
+		stream << "  " << declBitset("ancestors", _states.size()) << ";" << std::endl;
 		stream << "  bool type[8];" << std::endl;
 		stream << "}" << std::endl;
 		stream << "hidden " << _prefix << "state_t " << _prefix << "states[" << toStr(_states.size()) << "];" << std::endl;
@@ -657,14 +754,14 @@ void ChartToPromela::writeVariables(std::ostream& stream) {
 
 	stream << "typedef " << _prefix << "ctx_t {" << std::endl;
 	if (_transitions.size() > 0) {
-		stream << "  bool conflicts[" << _transitions.size() << "];" << std::endl;
-		stream << "  bool trans_set[" << _transitions.size() << "];" << std::endl;
+		stream << "  " << declBitset("conflicts", _transitions.size()) << ";" << std::endl;
+		stream << "  " << declBitset("trans_set", _transitions.size()) << ";" << std::endl;
 	}
 
-	stream << "  bool target_set[" << _states.size() << "];" << std::endl;
-	stream << "  bool exit_set[" << _states.size() << "];" << std::endl;
-	stream << "  bool entry_set[" << _states.size() << "];" << std::endl;
-	stream << "  bool tmp_states[" << _states.size() << "];" << std::endl;
+	stream << "  " << declBitset("target_set", _states.size()) << ";" << std::endl;
+	stream << "  " << declBitset("exit_set", _states.size()) << ";" << std::endl;
+	stream << "  " << declBitset("entry_set", _states.size()) << ";" << std::endl;
+	stream << "  " << declBitset("tmp_states", _states.size()) << ";" << std::endl;
 	stream << "}" << std::endl;
 	stream << "hidden " << _prefix << "ctx_t " << _prefix << "ctx;" << std::endl;
 	stream << std::endl;
@@ -754,6 +851,42 @@ void ChartToPromela::writeVariables(std::ostream& stream) {
 }
 
 
+std::map<std::string, ChartToPromela::NameMapping> ChartToPromela::getNameMappings() {
+	std::map<std::string, NameMapping> mappings;
+	if (_machinesAll == NULL)
+		return mappings;
+
+	for (auto machine : *_machinesAll) {
+		ChartToPromela* chart = machine.second;
+		NameMapping& mapping = mappings[chart->_invokerid];
+		mapping.prefix = chart->_prefix;
+
+		for (size_t i = 0; i < chart->_states.size(); i++) {
+			DOMElement* state = chart->_states[i];
+			if (HAS_ATTR(state, kXMLCharId)) {
+				mapping.states.push_back(ATTR(state, kXMLCharId));
+			} else {
+				mapping.states.push_back(LOCALNAME(state) + "#" + toStr(i));
+			}
+		}
+
+		for (size_t i = 0; i < chart->_transitions.size(); i++) {
+			DOMElement* transition = chart->_transitions[i];
+			size_t source = strTo<size_t>(ATTR_CAST(transition->getParentNode(), X("documentOrder")));
+
+			std::string name = mapping.states[source];
+			if (HAS_ATTR(transition, kXMLCharTarget))
+				name += " -> " + ATTR(transition, kXMLCharTarget);
+			if (HAS_ATTR(transition, kXMLCharEvent))
+				name += " on " + ATTR(transition, kXMLCharEvent);
+			if (HAS_ATTR(transition, kXMLCharCond))
+				name += " [" + ATTR(transition, kXMLCharCond) + "]";
+			mapping.transitions.push_back(name);
+		}
+	}
+	return mappings;
+}
+
 void ChartToPromela::writeStrings(std::ostream& stream) {
 	stream << "/* states, events and string literals */" << std::endl;
 	std::set<std::string> literals = _analyzer->getLiterals();
@@ -792,11 +925,7 @@ void ChartToPromela::writeTransitions(std::ostream& stream) {
 
 		/** target */
 		if (HAS_ATTR(transition, X("targetBools"))) {
-			std::string targetBools = ATTR(transition, X("targetBools"));
-			for (size_t j = 0; j < _states.size(); j++) {
-				if (targetBools[j] == '1')
-					stream << "  " << _prefix << "transitions[" << toStr(i) << "].target[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "transitions[" + toStr(i) + "].target", ATTR(transition, X("targetBools")).substr(0, _states.size()));
 		}
 
 		if (!HAS_ATTR(transition, kXMLCharEvent))
@@ -815,19 +944,11 @@ void ChartToPromela::writeTransitions(std::ostream& stream) {
 			stream << "  " << _prefix << "transitions[" << toStr(i) << "].type[USCXML_TRANS_INITIAL] = 1;" << std::endl;
 
 		if (HAS_ATTR(transition, X("conflictBools"))) {
-			std::string conflicts = ATTR(transition, X("conflictBools"));
-			for (size_t j = 0; j < conflicts.size(); j++) {
-				if (conflicts[j] == '1')
-					stream << "  " << _prefix << "transitions[" << toStr(i) << "].conflicts[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "transitions[" + toStr(i) + "].conflicts", ATTR(transition, X("conflictBools")));
 		}
 
 		if (HAS_ATTR(transition, X("exitSetBools"))) {
-			std::string exitSet = ATTR(transition, X("exitSetBools"));
-			for (size_t j = 0; j < exitSet.size(); j++) {
-				if (exitSet[j] == '1')
-					stream << "  " << _prefix << "transitions[" << toStr(i) << "].exit_set[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "transitions[" + toStr(i) + "].exit_set", ATTR(transition, X("exitSetBools")));
 		}
 
 		stream << std::endl;
@@ -847,27 +968,15 @@ void ChartToPromela::writeStates(std::ostream& stream) {
 
 
 		if (HAS_ATTR(state, X("childBools"))) {
-			std::string childs = ATTR(state, X("childBools"));
-			for (size_t j = 0; j < childs.size(); j++) {
-				if (childs[j] == '1')
-					stream << "  " << _prefix << "states[" << toStr(i) << "].children[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "states[" + toStr(i) + "].children", ATTR(state, X("childBools")));
 		}
 
 		if (HAS_ATTR(state, X("completionBools"))) {
-			std::string completions = ATTR(state, X("completionBools"));
-			for (size_t j = 0; j < completions.size(); j++) {
-				if (completions[j] == '1')
-					stream << "  " << _prefix << "states[" << toStr(i) << "].completion[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "states[" + toStr(i) + "].completion", ATTR(state, X("completionBools")));
 		}
 
 		if (HAS_ATTR(state, X("ancBools"))) {
-			std::string ancestors = ATTR(state, X("ancBools"));
-			for (size_t j = 0; j < ancestors.size(); j++) {
-				if (ancestors[j] == '1')
-					stream << "  " << _prefix << "states[" << toStr(i) << "].ancestors[" << toStr(j) << "] = 1;" << std::endl;
-			}
+			writeBitsetInit(stream, _prefix + "states[" + toStr(i) + "].ancestors", ATTR(state, X("ancBools")));
 		}
 		if (false) {
 		} else if (iequals(TAGNAME(state), "initial")) {
@@ -1059,7 +1168,7 @@ void ChartToPromela::writeExecContent(std::ostream& stream, const XERCESC_NS::DO
 		std::string targetQueue;
 
 		stream << padding << "if" << std::endl;
-		stream << padding << ":: !" << _prefix << "flags[USCXML_CTX_FINISHED] || " << _prefix << "flags[USCXML_CTX_TOP_LEVEL_FINAL] -> {" << std::endl;
+		stream << padding << ":: !" << bitHas(_prefix + "flags", "USCXML_CTX_FINISHED") << " || " << bitHas(_prefix + "flags", "USCXML_CTX_TOP_LEVEL_FINAL") << " -> {" << std::endl;
 
 		padding += "  ";
 		std::string insertOp = "!";
@@ -1246,19 +1355,32 @@ void ChartToPromela::writeFSM(std::ostream& stream) {
 	stream << "#define " << _prefix << "USCXML_NUMBER_TRANS " << _transitions.size() << std::endl;
 	stream << std::endl;
 
-	stream << "proctype " << _prefix << "step() { atomic {" << std::endl;
-	stream << std::endl;
-	stream << _prefix << "procid = _pid;" << std::endl;
-
 	size_t largestBitWidth = (_states.size() > _transitions.size() ?
 	                          BIT_WIDTH(_states.size() + 1) :
 	                          BIT_WIDTH(_transitions.size() + 1));
 
-	stream << "unsigned";
-	stream << " i : " <<  largestBitWidth << ", ";
-	stream << " j : " <<  largestBitWidth << ", ";
-	stream << " k : " <<  largestBitWidth << ";" << std::endl;
+	if (_packedVector) {
+		// every loop sets its counter first, none is live where the process blocks
+		_i = _prefix + "_i";
+		_j = _prefix + "_j";
+		_k = _prefix + "_k";
+		stream << "hidden unsigned " << _i << " : " << largestBitWidth << ";" << std::endl;
+		stream << "hidden unsigned " << _j << " : " << largestBitWidth << ";" << std::endl;
+		stream << "hidden unsigned " << _k << " : " << largestBitWidth << ";" << std::endl;
+		stream << std::endl;
+	}
+
+	stream << "proctype " << _prefix << "step() { atomic {" << std::endl;
 	stream << std::endl;
+	stream << _prefix << "procid = _pid;" << std::endl;
+
+	if (!_packedVector) {
+		stream << "unsigned";
+		stream << " " << _i << " : " <<  largestBitWidth << ", ";
+		stream << " " << _j << " : " <<  largestBitWidth << ", ";
+		stream << " " << _k << " : " <<  largestBitWidth << ";" << std::endl;
+		stream << std::endl;
+	}
 
 	std::list<DOMElement*> globalScripts = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "script", _scxml, false);
 	if (globalScripts.size() > 0) {
@@ -1279,7 +1401,7 @@ void ChartToPromela::writeFSM(std::ostream& stream) {
 	stream << _prefix << "MICROSTEP:" << std::endl;
 
 	stream << "do" << std::endl;
-	stream << ":: !" << _prefix << "flags[USCXML_CTX_FINISHED] -> {" << std::endl;
+	stream << ":: !" << bitHas(_prefix + "flags", "USCXML_CTX_FINISHED") << " -> {" << std::endl;
 	stream << "  /* Run until machine is finished */" << std::endl;
 	stream << std::endl;
 
@@ -1304,7 +1426,7 @@ void ChartToPromela::writeFSM(std::ostream& stream) {
 
 
 	stream << "  if" << std::endl;
-	stream << "  :: " << _prefix << "flags[USCXML_CTX_TRANSITION_FOUND] -> {" << std::endl;
+	stream << "  :: " << bitHas(_prefix + "flags", "USCXML_CTX_TRANSITION_FOUND") << " -> {" << std::endl;
 	stream << "    /* only process anything if we found transitions or are on initial entry */" << std::endl;
 
 	writeFSMRememberHistory(stream);
@@ -1351,7 +1473,7 @@ void ChartToPromela::writeFSMRescheduleMachines(std::ostream& stream) {
 
 		stream << "  /* we may return to find ourselves terminated */" << std::endl;
 		stream << "  if" << std::endl;
-		stream << "  :: " << _prefix << "flags[USCXML_CTX_FINISHED] -> {" << std::endl;
+		stream << "  :: " << bitHas(_prefix + "flags", "USCXML_CTX_FINISHED") << " -> {" << std::endl;
 		stream << "    goto " << _prefix << "TERMINATE_MACHINE;" << std::endl;
 		stream << "  }" << std::endl;
 		stream << "  :: else -> skip;" << std::endl;
@@ -1363,32 +1485,32 @@ void ChartToPromela::writeFSMRescheduleMachines(std::ostream& stream) {
 void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 
 	stream << "  /* Dequeue an external event */" << std::endl;
-	stream << "  " << _prefix << "flags[USCXML_CTX_DEQUEUED_EXTERNAL] = false;" << std::endl;
+	stream << "  " << bitSet(_prefix + "flags", "USCXML_CTX_DEQUEUED_EXTERNAL", false) << ";" << std::endl;
 
 	stream << "  if" << std::endl;
-	stream << "  :: !" << _prefix << "flags[USCXML_CTX_SPONTANEOUS] && len(" << _prefix << "iQ) == 0 -> {" << std::endl;
+	stream << "  :: !" << bitHas(_prefix + "flags", "USCXML_CTX_SPONTANEOUS") << " && len(" << _prefix << "iQ) == 0 -> {" << std::endl;
 
 	stream << "    /* manage invocations */" << std::endl;
-	stream << "    i = 0;" << std::endl;
+	stream << "    " << _i << " = 0;" << std::endl;
 	stream << "    do" << std::endl;
-	stream << "    :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "    :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "      /* uninvoke */" << std::endl;
 	stream << "      if" << std::endl;
-	stream << "      :: !" << _prefix << "config[i] && " << _prefix << "invocations[i] -> {" << std::endl;
+	stream << "      :: !" << bitHas(_prefix + "config", _i) << " && " << bitHas(_prefix + "invocations", _i) << " -> {" << std::endl;
 
-	TRACE_EXECUTION_V("Uninvoking in state %d", "i");
+	TRACE_EXECUTION_V("Uninvoking in state %d", _i);
 
 	stream << "        if" << std::endl;
 
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "invoke" , _states[i]);
 		if (invokers.size() > 0) {
-			stream << "        :: i == " << toStr(i) << " -> {" << std::endl;
+			stream << "        :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
 			for (auto invokeElem : invokers) {
 				if (_machinesNested.find(invokeElem) == _machinesNested.end())
 					continue;
 				ChartToPromela* invoker = _machinesNested[invokeElem];
-				stream << "          " << invoker->_prefix << "flags[USCXML_CTX_FINISHED] = true;" << std::endl;
+				stream << "          " << bitSet(invoker->_prefix + "flags", "USCXML_CTX_FINISHED", true) << ";" << std::endl;
 			}
 			stream << "        }" << std::endl;
 		}
@@ -1396,7 +1518,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 	stream << "        :: else -> skip;" << std::endl;
 	stream << "        fi" << std::endl;
 
-	stream << "        " << _prefix << "invocations[i] = false;" << std::endl;
+	stream << "        " << bitSet(_prefix + "invocations", _i, false) << ";" << std::endl;
 
 	stream << "        skip;" << std::endl;
 	stream << "      }" << std::endl;
@@ -1406,13 +1528,13 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 
 	stream << "      /* invoke */" << std::endl;
 	stream << "      if" << std::endl;
-	stream << "      :: " << _prefix << "config[i] && !" << _prefix << "invocations[i] -> {" << std::endl;
+	stream << "      :: " << bitHas(_prefix + "config", _i) << " && !" << bitHas(_prefix + "invocations", _i) << " -> {" << std::endl;
 	stream << "        if" << std::endl;
 
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "invoke" , _states[i]);
 		if (invokers.size() > 0) {
-			stream << "      :: i == " << toStr(i) << " -> {" << std::endl;
+			stream << "      :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
 			for (auto invokeElem : invokers) {
 				if (_machinesNested.find(invokeElem) == _machinesNested.end())
 					continue;
@@ -1438,7 +1560,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 					}
 				}
 
-				TRACE_EXECUTION_V("Invoking in state %d", "i");
+				TRACE_EXECUTION_V("Invoking in state %d", _i);
 
 				stream << "          run " << invoker->_prefix << "step() priority 20;" << std::endl;
 				if (HAS_ATTR(invokeElem, kXMLCharIdLocation)) {
@@ -1447,7 +1569,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 				}
 
 			}
-			stream << "          " << _prefix << "invocations[i] = true;" << std::endl;
+			stream << "          " << bitSet(_prefix + "invocations", _i, true) << ";" << std::endl;
 			stream << "          skip;" << std::endl;
 			stream << "        }" << std::endl;
 		}
@@ -1458,7 +1580,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 	stream << "      }" << std::endl;
 	stream << "      :: else -> skip;" << std::endl;
 	stream << "      fi;" << std::endl;
-	stream << "      i = i + 1;" << std::endl;
+	stream << "      " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    :: else -> break;" << std::endl;
 	stream << "    od;" << std::endl;
@@ -1472,9 +1594,9 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 	if (_machinesNested.size() > 0) {
 		stream << std::endl;
 		stream << "      /* auto-forward event */" << std::endl;
-		stream << "      i = 0;" << std::endl;
+		stream << "      " << _i << " = 0;" << std::endl;
 		stream << "      do" << std::endl;
-		stream << "      :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+		stream << "      :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 		stream << "        if" << std::endl;
 
 		std::string insertOp = "!";
@@ -1486,7 +1608,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 		for (auto state : _states) {
 			std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "invoke", state, false);
 			if (invokers.size() > 0) {
-				stream << "        :: i == " << ATTR(state, X("documentOrder")) << " && " << _prefix << "invocations[i] -> { " << std::endl;
+				stream << "        :: " << _i << " == " << ATTR(state, X("documentOrder")) << " && " << bitHas(_prefix + "invocations", _i) << " -> { " << std::endl;
 				for (auto invoker : invokers) {
 					assert(_machinesNested.find(invoker) != _machinesNested.end());
 					if (HAS_ATTR(invoker, kXMLCharAutoForward) && stringIsTrue(ATTR(invoker, kXMLCharAutoForward))) {
@@ -1504,7 +1626,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 
 		stream << "        :: else -> skip;" << std::endl;
 		stream << "        fi" << std::endl;
-		stream << "        i = i + 1;" << std::endl;
+		stream << "        " << _i << " = " << _i << " + 1;" << std::endl;
 		stream << "      }" << std::endl;
 		stream << "      :: else -> break;" << std::endl;
 		stream << "      od" << std::endl;
@@ -1533,7 +1655,7 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 	}
 
 	TRACE_EXECUTION("Deqeued an external event");
-	stream << "  " << _prefix << "flags[USCXML_CTX_DEQUEUED_EXTERNAL] = true;" << std::endl;
+	stream << "  " << bitSet(_prefix + "flags", "USCXML_CTX_DEQUEUED_EXTERNAL", true) << ";" << std::endl;
 	stream << "      break;" << std::endl;
 	stream << "    }" << std::endl;
 	//  stream << "  :: else -> quit;" << std::endl;
@@ -1547,10 +1669,10 @@ void ChartToPromela::writeFSMMacrostep(std::ostream& stream) {
 
 void ChartToPromela::writeFSMDequeueInternalOrSpontaneousEvent(std::ostream& stream) {
 	stream << "  if" << std::endl;
-	stream << "  :: !" << _prefix << "flags[USCXML_CTX_DEQUEUED_EXTERNAL] -> {" << std::endl;
+	stream << "  :: !" << bitHas(_prefix + "flags", "USCXML_CTX_DEQUEUED_EXTERNAL") << " -> {" << std::endl;
 	stream << "    /* Try with a spontaneous event or dequeue an internal event */" << std::endl;
 	stream << "    if" << std::endl;
-	stream << "    :: " << _prefix << "flags[USCXML_CTX_SPONTANEOUS] -> {" << std::endl;
+	stream << "    :: " << bitHas(_prefix + "flags", "USCXML_CTX_SPONTANEOUS") << " -> {" << std::endl;
 	stream << "      /* We try with a spontaneous event */" << std::endl;
 	stream << "      " << _prefix << EVENT_NAME << " = USCXML_EVENT_SPONTANEOUS;" << std::endl;
 	stream << "    }" << std::endl;
@@ -1570,9 +1692,9 @@ void ChartToPromela::writeFSMDequeueInternalOrSpontaneousEvent(std::ostream& str
 #if 1
 void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 	stream << "  /* Dequeue an event */" << std::endl;
-	stream << "  " << _prefix << "flags[USCXML_CTX_DEQUEUE_EXTERNAL] = false;" << std::endl;
+	stream << "  " << bitSet(_prefix + "flags", "USCXML_CTX_DEQUEUE_EXTERNAL", false) << ";" << std::endl;
 	stream << "  if" << std::endl;
-	stream << "  ::" << _prefix << "flags[USCXML_CTX_SPONTANEOUS] -> {" << std::endl;
+	stream << "  ::" << bitHas(_prefix + "flags", "USCXML_CTX_SPONTANEOUS") << " -> {" << std::endl;
 	stream << "    " << _prefix << EVENT_NAME << " = USCXML_EVENT_SPONTANEOUS;" << std::endl;
 
 	TRACE_EXECUTION("Trying with a spontaneous event");
@@ -1587,7 +1709,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 
 	stream << "    }" << std::endl;
 	stream << "    :: else -> {" << std::endl;
-	stream << "      " << _prefix << "flags[USCXML_CTX_DEQUEUE_EXTERNAL] = true;" << std::endl;
+	stream << "      " << bitSet(_prefix + "flags", "USCXML_CTX_DEQUEUE_EXTERNAL", true) << ";" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    fi;" << std::endl;
 	stream << "  }" << std::endl;
@@ -1597,29 +1719,29 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "  if" << std::endl;
-	stream << "  :: " << _prefix << "flags[USCXML_CTX_DEQUEUE_EXTERNAL] -> {" << std::endl;
+	stream << "  :: " << bitHas(_prefix + "flags", "USCXML_CTX_DEQUEUE_EXTERNAL") << " -> {" << std::endl;
 	stream << "    /* manage invocations */" << std::endl;
-	stream << "    i = 0;" << std::endl;
+	stream << "    " << _i << " = 0;" << std::endl;
 	stream << "    do" << std::endl;
-	stream << "    :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "    :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "      d_step { " << std::endl;
 	stream << "      /* uninvoke */" << std::endl;
 	stream << "      if" << std::endl;
-	stream << "      :: !" << _prefix << "config[i] && " << _prefix << "invocations[i] -> {" << std::endl;
+	stream << "      :: !" << bitHas(_prefix + "config", _i) << " && " << bitHas(_prefix + "invocations", _i) << " -> {" << std::endl;
 
-	TRACE_EXECUTION_V("Uninvoking in state %d", "i");
+	TRACE_EXECUTION_V("Uninvoking in state %d", _i);
 
 	stream << "        if" << std::endl;
 
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "invoke" , _states[i]);
 		if (invokers.size() > 0) {
-			stream << "        :: i == " << toStr(i) << " -> {" << std::endl;
+			stream << "        :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
 			for (auto invokeElem : invokers) {
 				if (_machinesNested.find(invokeElem) == _machinesNested.end())
 					continue;
 				ChartToPromela* invoker = _machinesNested[invokeElem];
-				stream << "          " << invoker->_prefix << "flags[USCXML_CTX_FINISHED] = true;" << std::endl;
+				stream << "          " << bitSet(invoker->_prefix + "flags", "USCXML_CTX_FINISHED", true) << ";" << std::endl;
 			}
 			stream << "        }" << std::endl;
 		}
@@ -1627,7 +1749,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 	stream << "        :: else -> skip;" << std::endl;
 	stream << "        fi" << std::endl;
 
-	stream << "        " << _prefix << "invocations[i] = false;" << std::endl;
+	stream << "        " << bitSet(_prefix + "invocations", _i, false) << ";" << std::endl;
 
 	stream << "        skip;" << std::endl;
 	stream << "      }" << std::endl;
@@ -1641,13 +1763,13 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 
 	stream << "      /* invoke */" << std::endl;
 	stream << "      if" << std::endl;
-	stream << "      :: " << _prefix << "config[i] && !" << _prefix << "invocations[i] -> {" << std::endl;
+	stream << "      :: " << bitHas(_prefix + "config", _i) << " && !" << bitHas(_prefix + "invocations", _i) << " -> {" << std::endl;
 	stream << "        if" << std::endl;
 
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "invoke" , _states[i]);
 		if (invokers.size() > 0) {
-			stream << "      :: i == " << toStr(i) << " -> {" << std::endl;
+			stream << "      :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
 			for (auto invokeElem : invokers) {
 				if (_machinesNested.find(invokeElem) == _machinesNested.end())
 					continue;
@@ -1673,7 +1795,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 					}
 				}
 
-				TRACE_EXECUTION_V("Invoking in state %d", "i");
+				TRACE_EXECUTION_V("Invoking in state %d", _i);
 
 				stream << "          run " << invoker->_prefix << "step() priority 20;" << std::endl;
 				if (HAS_ATTR(invokeElem, kXMLCharIdLocation)) {
@@ -1682,7 +1804,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 				}
 
 			}
-			stream << "          " << _prefix << "invocations[i] = true;" << std::endl;
+			stream << "          " << bitSet(_prefix + "invocations", _i, true) << ";" << std::endl;
 			stream << "          skip;" << std::endl;
 			stream << "        }" << std::endl;
 		}
@@ -1693,7 +1815,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 	stream << "      }" << std::endl;
 	stream << "      :: else -> skip;" << std::endl;
 	stream << "      fi;" << std::endl;
-	stream << "      i = i + 1;" << std::endl;
+	stream << "      " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    :: else -> break;" << std::endl;
 	stream << "    od;" << std::endl;
@@ -1707,7 +1829,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 
 	stream << "    /* we may return to find ourselves terminated */" << std::endl;
 	stream << "    if" << std::endl;
-	stream << "    :: " << _prefix << "flags[USCXML_CTX_FINISHED] -> {" << std::endl;
+	stream << "    :: " << bitHas(_prefix + "flags", "USCXML_CTX_FINISHED") << " -> {" << std::endl;
 	stream << "      goto " << _prefix << "TERMINATE_MACHINE;" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    :: else -> skip;" << std::endl;
@@ -1723,9 +1845,9 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 		stream << std::endl;
 		stream << "      d_step {" << std::endl;
 		stream << "      /* auto-forward event */" << std::endl;
-		stream << "      i = 0;" << std::endl;
+		stream << "      " << _i << " = 0;" << std::endl;
 		stream << "      do" << std::endl;
-		stream << "      :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+		stream << "      :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 		stream << "        if" << std::endl;
 
 		std::string insertOp = "!";
@@ -1737,7 +1859,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 		for (auto state : _states) {
 			std::list<DOMElement*> invokers = DOMUtils::filterChildElements(XML_PREFIX(state).str() + "invoke", state, false);
 			if (invokers.size() > 0) {
-				stream << "        :: i == " << ATTR(state, X("documentOrder")) << " && " << _prefix << "invocations[i] -> { " << std::endl;
+				stream << "        :: " << _i << " == " << ATTR(state, X("documentOrder")) << " && " << bitHas(_prefix + "invocations", _i) << " -> { " << std::endl;
 				for (auto invoker : invokers) {
 					assert(_machinesNested.find(invoker) != _machinesNested.end());
 					if (HAS_ATTR(invoker, kXMLCharAutoForward) && stringIsTrue(ATTR(invoker, kXMLCharAutoForward))) {
@@ -1755,7 +1877,7 @@ void ChartToPromela::writeFSMDequeueEvent(std::ostream& stream) {
 
 		stream << "        :: else -> skip;" << std::endl;
 		stream << "        fi" << std::endl;
-		stream << "        i = i + 1;" << std::endl;
+		stream << "        " << _i << " = " << _i << " + 1;" << std::endl;
 		stream << "      }" << std::endl;
 		stream << "      :: else -> break;" << std::endl;
 		stream << "      od" << std::endl;
@@ -1817,40 +1939,40 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 		stream << std::endl;
 
 		stream << "#if TRACE_EXECUTION" << std::endl;
-		stream << "printf(\"Configuration: \");" << std::endl;
+		stream << "printf(\"[" << _invokerid << "] Configuration: \");" << std::endl;
 		printBitArray(stream, _prefix + "config", _states.size());
 		stream << "printf(\"\\n\");" << std::endl;
 		stream << "#endif" << std::endl;
 		stream << std::endl;
-		stream << "  " << _prefix << "flags[USCXML_CTX_TRANSITION_FOUND] = false;" << std::endl;
-		stream << "  i = 0;" << std::endl;
+		stream << "  " << bitSet(_prefix + "flags", "USCXML_CTX_TRANSITION_FOUND", false) << ";" << std::endl;
+		stream << "  " << _i << " = 0;" << std::endl;
 		stream << "  do" << std::endl;
-		stream << "  :: i < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
+		stream << "  :: " << _i << " < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
 
 		stream << "    /* only select non-history, non-initial transitions */" << std::endl;
 		stream << "    if" << std::endl;
-		stream << "    :: !" << _prefix << "transitions[i].type[USCXML_TRANS_HISTORY] &&" << std::endl;
-		stream << "       !" << _prefix << "transitions[i].type[USCXML_TRANS_INITIAL] -> {" << std::endl;
+		stream << "    :: !" << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_HISTORY] &&" << std::endl;
+		stream << "       !" << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_INITIAL] -> {" << std::endl;
 
 		stream << "      if" << std::endl;
 		stream << "      :: /* is the transition active? */" << std::endl;
-		stream << "         " << _prefix << "config[" << _prefix << "transitions[i].source] && " << std::endl;
+		stream << "         " << bitHas(_prefix + "config", _prefix + "transitions[" + _i + "].source") << " && " << std::endl;
 		stream << std::endl;
 		stream << "         /* is it non-conflicting? */" << std::endl;
-		stream << "         !" << _prefix << "ctx.conflicts[i] && " << std::endl;
+		stream << "         !" << bitHas(_prefix + "ctx.conflicts", _i) << " && " << std::endl;
 		stream << std::endl;
 		stream << "         /* is it spontaneous with an event or vice versa? */" << std::endl;
 		stream << "         ((" << _prefix << EVENT_NAME << " == USCXML_EVENT_SPONTANEOUS && " << std::endl;
-		stream << "           " << _prefix << "transitions[i].type[USCXML_TRANS_SPONTANEOUS]) || " << std::endl;
+		stream << "           " << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_SPONTANEOUS]) || " << std::endl;
 		stream << "          (" << _prefix << EVENT_NAME << " != USCXML_EVENT_SPONTANEOUS && " << std::endl;
-		stream << "           !" << _prefix << "transitions[i].type[USCXML_TRANS_SPONTANEOUS])) &&" << std::endl;
+		stream << "           !" << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_SPONTANEOUS])) &&" << std::endl;
 		stream << std::endl;
 		stream << "         /* is it matching and enabled? */" << std::endl;
 		stream << "         (false " << std::endl;
 
 
 		for (size_t i = 0; i < _transitions.size(); i++) {
-			stream << "          || (i == " << toStr(i);
+			stream << "          || (" << _i << " == " << toStr(i);
 			if (HAS_ATTR(_transitions[i], kXMLCharEvent) && ATTR(_transitions[i], kXMLCharEvent) != "*") {
 				stream << " && (false";
 				std::list<std::string> eventLiterals = tokenize(ATTR(_transitions[i], kXMLCharEvent));
@@ -1877,22 +1999,22 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 		stream << "         ) -> {" << std::endl;
 
 		stream << "        /* remember that we found a transition */" << std::endl;
-		stream << "        " << _prefix << "flags[USCXML_CTX_TRANSITION_FOUND] = true;" << std::endl;
+		stream << "        " << bitSet(_prefix + "flags", "USCXML_CTX_TRANSITION_FOUND", true) << ";" << std::endl;
 		stream << std::endl;
 
 		stream << "        /* transitions that are pre-empted */" << std::endl;
-		stream << "        " << _prefix << "TRANS_OR(" << _prefix << "ctx.conflicts, " << _prefix << "transitions[i].conflicts)" << std::endl;
+		stream << "        " << _prefix << "TRANS_OR(" << _prefix << "ctx.conflicts, " << _prefix << "transitions[" << _i << "].conflicts)" << std::endl;
 		stream << std::endl;
 
 		stream << "        /* states that are directly targeted (resolve as entry-set later) */" << std::endl;
-		stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.target_set, " << _prefix << "transitions[i].target)" << std::endl;
+		stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.target_set, " << _prefix << "transitions[" << _i << "].target)" << std::endl;
 		stream << std::endl;
 
 		stream << "        /* states that will be left */" << std::endl;
-		stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.exit_set, " << _prefix << "transitions[i].exit_set)" << std::endl;
+		stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.exit_set, " << _prefix << "transitions[" << _i << "].exit_set)" << std::endl;
 		stream << std::endl;
 
-		stream << "        " << _prefix << "ctx.trans_set[i] = true;" << std::endl;
+		stream << "        " << bitSet(_prefix + "ctx.trans_set", _i, true) << ";" << std::endl;
 
 
 		stream << "      }" << std::endl;
@@ -1906,7 +2028,7 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 		stream << "    }" << std::endl;
 		stream << "    fi" << std::endl;
 
-		stream << "    i = i + 1;" << std::endl;
+		stream << "    " << _i << " = " << _i << " + 1;" << std::endl;
 		stream << "  }" << std::endl;
 		stream << "  :: else -> break;" << std::endl;
 		stream << "  od;" << std::endl;
@@ -1915,7 +2037,7 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 
 		stream << std::endl;
 		stream << "#if TRACE_EXECUTION" << std::endl;
-		stream << "printf(\"Selected Transitions: \");" << std::endl;
+		stream << "printf(\"[" << _invokerid << "] Selected Transitions: \");" << std::endl;
 		printBitArray(stream, _prefix + "ctx.trans_set", _transitions.size());
 		stream << "printf(\"\\n\");" << std::endl;
 		stream << "#endif" << std::endl;
@@ -1941,8 +2063,8 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 	stream << "  :: !" << _prefix << "STATES_HAS_ANY(" << _prefix << "config) -> {" << std::endl;
 	stream << "    /* Enter initial configuration */" << std::endl;
 	stream << "    " << _prefix << "STATES_COPY(" << _prefix << "ctx.target_set, " << _prefix << "states[0].completion)" << std::endl;
-	stream << "    " << _prefix << "flags[USCXML_CTX_SPONTANEOUS] = true;" << std::endl;
-	stream << "    " << _prefix << "flags[USCXML_CTX_TRANSITION_FOUND] = true;" << std::endl;
+	stream << "    " << bitSet(_prefix + "flags", "USCXML_CTX_SPONTANEOUS", true) << ";" << std::endl;
+	stream << "    " << bitSet(_prefix + "flags", "USCXML_CTX_TRANSITION_FOUND", true) << ";" << std::endl;
 
 	TRACE_EXECUTION("Entering initial default completion");
 
@@ -1950,14 +2072,14 @@ void ChartToPromela::writeFSMSelectTransitions(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "  }" << std::endl;
-	stream << "  :: " << _prefix << "flags[USCXML_CTX_TRANSITION_FOUND] -> {" << std::endl;
+	stream << "  :: " << bitHas(_prefix + "flags", "USCXML_CTX_TRANSITION_FOUND") << " -> {" << std::endl;
 
 	TRACE_EXECUTION("Found transitions");
 
-	stream << "    " << _prefix << "flags[USCXML_CTX_SPONTANEOUS] = true;" << std::endl;
+	stream << "    " << bitSet(_prefix + "flags", "USCXML_CTX_SPONTANEOUS", true) << ";" << std::endl;
 	stream << "  }" << std::endl;
 	stream << "  :: else {" << std::endl;
-	stream << "    " << _prefix << "flags[USCXML_CTX_SPONTANEOUS] = false;" << std::endl;
+	stream << "    " << bitSet(_prefix + "flags", "USCXML_CTX_SPONTANEOUS", false) << ";" << std::endl;
 
 	TRACE_EXECUTION("Found NO transitions");
 
@@ -1977,28 +2099,28 @@ void ChartToPromela::writeFSMRememberHistory(std::ostream& stream) {
 	stream << "  :: " << _prefix << "STATES_HAS_ANY(" << _prefix << "config) -> {" << std::endl;
 	stream << "    /* only remember history on non-initial entry */" << std::endl;
 
-	stream << "    i = 0;" << std::endl;
+	stream << "    " << _i << " = 0;" << std::endl;
 	stream << "    do" << std::endl;
-	stream << "    :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "    :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 
 	stream << "      if" << std::endl;
-	stream << "      :: " << _prefix << "states[i].type[USCXML_STATE_HISTORY_SHALLOW] ||" << std::endl;
-	stream << "         " << _prefix << "states[i].type[USCXML_STATE_HISTORY_DEEP] -> {" << std::endl;
+	stream << "      :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_SHALLOW] ||" << std::endl;
+	stream << "         " << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_DEEP] -> {" << std::endl;
 	stream << "        if" << std::endl;
-	stream << "        :: " << _prefix << "ctx.exit_set[" << _prefix << "states[i].parent] -> {" << std::endl;
+	stream << "        :: " << bitHas(_prefix + "ctx.exit_set", _prefix + "states[" + _i + "].parent") << " -> {" << std::endl;
 
 	stream << "          /* a history state whose parent is about to be exited */" << std::endl;
-	TRACE_EXECUTION_V("history state %d is about to be exited", "i");
+	TRACE_EXECUTION_V("history state %d is about to be exited", _i);
 
 	stream << std::endl;
 	stream << "#if TRACE_EXECUTION" << std::endl;
 	stream << "printf(\"COMPLET: \");" << std::endl;
-	printBitArray(stream, _prefix + "states[i].completion", _states.size());
+	printBitArray(stream, _prefix + "states[" + _i + "].completion", _states.size());
 	stream << "printf(\"\\n\");" << std::endl;
 	stream << "#endif" << std::endl;
 	stream << std::endl;
 
-	stream << "          " << _prefix << "STATES_COPY(" << _prefix << "ctx.tmp_states, " << _prefix << "states[i].completion)" << std::endl;
+	stream << "          " << _prefix << "STATES_COPY(" << _prefix << "ctx.tmp_states, " << _prefix << "states[" << _i << "].completion)" << std::endl;
 
 	stream << std::endl;
 	stream << "          /* set those states who were enabled */" << std::endl;
@@ -2022,7 +2144,7 @@ void ChartToPromela::writeFSMRememberHistory(std::ostream& stream) {
 
 	stream << std::endl;
 	stream << "          /* clear current history with completion mask */" << std::endl;
-	stream << "          " << _prefix << "STATES_AND_NOT(" << _prefix << "history, " << _prefix << "states[i].completion)" << std::endl;
+	stream << "          " << _prefix << "STATES_AND_NOT(" << _prefix << "history, " << _prefix << "states[" << _i << "].completion)" << std::endl;
 	stream << std::endl;
 
 	stream << "          /* set history */" << std::endl;
@@ -2037,7 +2159,7 @@ void ChartToPromela::writeFSMRememberHistory(std::ostream& stream) {
 	stream << "      :: else -> skip;" << std::endl;
 	stream << "      fi;" << std::endl;
 
-	stream << "      i = i + 1;" << std::endl;
+	stream << "      " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    :: else -> break;" << std::endl;
 	stream << "    od;" << std::endl;
@@ -2061,76 +2183,76 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 	stream << "  " << _prefix << "STATES_COPY(" << _prefix << "ctx.entry_set, " << _prefix << "ctx.target_set)" << std::endl;
 	stream << std::endl;
 
-	stream << "  i = 0;" << std::endl;
+	stream << "  " << _i << " = 0;" << std::endl;
 	stream << "  do" << std::endl;
-	stream << "  :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "  :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 
 	stream << "    if" << std::endl;
-	stream << "    :: " << _prefix << "ctx.entry_set[i] -> {" << std::endl;
+	stream << "    :: " << bitHas(_prefix + "ctx.entry_set", _i) << " -> {" << std::endl;
 	stream << "      /* ancestor completion */" << std::endl;
-	stream << "      " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[i].ancestors)" << std::endl;
+	stream << "      " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _i << "].ancestors)" << std::endl;
 
 	stream << "    }" << std::endl;
 	stream << "    :: else -> skip;" << std::endl;
 	stream << "    fi;" << std::endl;
 
-	stream << "    i = i + 1;" << std::endl;
+	stream << "    " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "  }" << std::endl;
 	stream << "  :: else -> break;" << std::endl;
 	stream << "  od;" << std::endl;
 	stream << std::endl;
 
 	stream << "  /* iterate for descendants */" << std::endl;
-	stream << "  i = 0;" << std::endl;
+	stream << "  " << _i << " = 0;" << std::endl;
 	stream << "  do" << std::endl;
-	stream << "  :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "  :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "    if" << std::endl;
-	stream << "    :: " << _prefix << "ctx.entry_set[i] -> {" << std::endl;
+	stream << "    :: " << bitHas(_prefix + "ctx.entry_set", _i) << " -> {" << std::endl;
 	stream << "      if" << std::endl;
 
-	stream << "      :: " << _prefix << "states[i].type[USCXML_STATE_PARALLEL] -> {" << std::endl;
-	stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[i].completion)" << std::endl;
+	stream << "      :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_PARALLEL] -> {" << std::endl;
+	stream << "        " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _i << "].completion)" << std::endl;
 	stream << "      }" << std::endl;
 
 
-	stream << "      :: " << _prefix << "states[i].type[USCXML_STATE_HISTORY_SHALLOW] ||" << std::endl;
-	stream << "         " << _prefix << "states[i].type[USCXML_STATE_HISTORY_DEEP] -> {" << std::endl;
+	stream << "      :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_SHALLOW] ||" << std::endl;
+	stream << "         " << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_DEEP] -> {" << std::endl;
 
-	TRACE_EXECUTION_V("Descendant completion for history state %d", "i")
+	TRACE_EXECUTION_V("Descendant completion for history state %d", _i)
 
 	stream << "        if" << std::endl;
-	stream << "        :: !" << _prefix << "STATES_HAS_AND(" << _prefix << "states[i].completion, " << _prefix << "history)";
+	stream << "        :: !" << _prefix << "STATES_HAS_AND(" << _prefix << "states[" << _i << "].completion, " << _prefix << "history)";
 	//	bit_has_and(stream, _prefix + "states[i].completion", _prefix + "history", _states.size(), 5);
-	stream << " && !" << _prefix << "config[" << _prefix << "states[i].parent]" << " -> {" << std::endl;
+	stream << " && !" << bitHas(_prefix + "config", _prefix + "states[" + _i + "].parent") << " -> {" << std::endl;
 	stream << "          /* nothing set for history, look for a default transition */" << std::endl;
 	TRACE_EXECUTION("Fresh history in target set")
 	if (_transitions.size() > 0) {
-		stream << "          j = 0;" << std::endl;
+		stream << "          " << _j << " = 0;" << std::endl;
 		stream << "          do" << std::endl;
-		stream << "          :: j < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
+		stream << "          :: " << _j << " < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
 		stream << "             if" << std::endl;
-		stream << "             :: " << _prefix << "transitions[j].source == i -> {" << std::endl;
-		stream << "               " << _prefix << "ctx.trans_set[j] = true;" << std::endl;
+		stream << "             :: " << _prefix << "transitions[" << _j << "].source == " << _i << " -> {" << std::endl;
+		stream << "               " << bitSet(_prefix + "ctx.trans_set", _j, true) << ";" << std::endl;
 
-		stream << "               " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "transitions[j].target)" << std::endl;
+		stream << "               " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "transitions[" << _j << "].target)" << std::endl;
 		stream << std::endl;
 		stream << "               if" << std::endl;
-		stream << "               :: (" << _prefix << "states[i].type[USCXML_STATE_HISTORY_DEEP] &&" << std::endl;
-		stream << "                   !" << _prefix << "STATES_HAS_AND(" << _prefix << "transitions[j].target, " << _prefix << "states[i].children)";
+		stream << "               :: (" << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_DEEP] &&" << std::endl;
+		stream << "                   !" << _prefix << "STATES_HAS_AND(" << _prefix << "transitions[" << _j << "].target, " << _prefix << "states[" << _i << "].children)";
 		//    bit_has_and(stream, _prefix + "transitions[j].target", _prefix + "states[i].children", _states.size(), 10);
 		stream << "                  ) -> {" << std::endl;
-		stream << "                 k = i + 1" << std::endl;
+		stream << "                 " << _k << " = " << _i << " + 1" << std::endl;
 		stream << "                 do" << std::endl;
-		stream << "                 :: k < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+		stream << "                 :: " << _k << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 		stream << "                   if" << std::endl;
-		stream << "                   :: " << _prefix << "transitions[j].target[k] -> {" << std::endl;
-		stream << "                     " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[k].ancestors)" << std::endl;
+		stream << "                   :: " << bitHas(_prefix + "transitions[" + _j + "].target", _k) << " -> {" << std::endl;
+		stream << "                     " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _k << "].ancestors)" << std::endl;
 		stream << "                     break;" << std::endl;
 		stream << std::endl;
 		stream << "                   }" << std::endl;
 		stream << "                   :: else -> skip;" << std::endl;
 		stream << "                   fi" << std::endl;
-		stream << "                   k = k + 1;" << std::endl;
+		stream << "                   " << _k << " = " << _k << " + 1;" << std::endl;
 		stream << "                 }" << std::endl;
 		stream << "                 :: else -> break;" << std::endl;
 		stream << "                 od" << std::endl;
@@ -2141,7 +2263,7 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 		stream << "             }" << std::endl;
 		stream << "             :: else -> skip;" << std::endl;
 		stream << "             fi" << std::endl;
-		stream << "             j = j + 1;" << std::endl;
+		stream << "             " << _j << " = " << _j << " + 1;" << std::endl;
 		stream << "          }" << std::endl;
 		stream << "          :: else -> break" << std::endl;
 		stream << "          od" << std::endl;
@@ -2151,35 +2273,35 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 	stream << "        :: else -> {" << std::endl;
 
 	TRACE_EXECUTION("Established history in target set")
-	stream << "          " << _prefix << "STATES_COPY(" << _prefix << "ctx.tmp_states, " << _prefix << "states[i].completion)" << std::endl;
+	stream << "          " << _prefix << "STATES_COPY(" << _prefix << "ctx.tmp_states, " << _prefix << "states[" << _i << "].completion)" << std::endl;
 	stream << "          " << _prefix << "STATES_AND(" << _prefix << "ctx.tmp_states, " << _prefix << "history)" << std::endl;
 	stream << "          " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "ctx.tmp_states)" << std::endl;
 	stream << "          if" << std::endl;
-	stream << "          :: " << _prefix << "states[i].type[USCXML_STATE_HAS_HISTORY] ||" << std::endl;
-	stream << "             " << _prefix << "states[i].type[USCXML_STATE_HISTORY_DEEP] -> { " << std::endl;
+	stream << "          :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_HAS_HISTORY] ||" << std::endl;
+	stream << "             " << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_DEEP] -> { " << std::endl;
 	stream << "            /* a deep history state with nested histories -> more completion */" << std::endl;
 	TRACE_EXECUTION("DEEP HISTORY")
-	stream << "            j = i + 1;" << std::endl;
+	stream << "            " << _j << " = " << _i << " + 1;" << std::endl;
 	stream << "            do" << std::endl;
-	stream << "            :: j < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "            :: " << _j << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "              if" << std::endl;
-	stream << "              :: (" << _prefix << "states[i].completion[j] &&" << std::endl;
-	stream << "                  " << _prefix << "ctx.entry_set[j] && " << std::endl;
-	stream << "                  " << _prefix << "states[j].type[USCXML_STATE_HAS_HISTORY]) -> {" << std::endl;
-	stream << "                k = j + 1;" << std::endl;
+	stream << "              :: (" << bitHas(_prefix + "states[" + _i + "].completion", _j) << " &&" << std::endl;
+	stream << "                  " << bitHas(_prefix + "ctx.entry_set", _j) << " && " << std::endl;
+	stream << "                  " << _prefix << "states[" << _j << "].type[USCXML_STATE_HAS_HISTORY]) -> {" << std::endl;
+	stream << "                " << _k << " = " << _j << " + 1;" << std::endl;
 	stream << "                do" << std::endl;
-	stream << "                :: k < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "                :: " << _k << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "                  /* add nested history to entry_set */" << std::endl;
 	stream << "                  if" << std::endl;
-	stream << "                  :: (" << _prefix << "states[k].type[USCXML_STATE_HISTORY_DEEP] ||" << std::endl;
-	stream << "                      " << _prefix << "states[k].type[USCXML_STATE_HISTORY_SHALLOW]) &&" << std::endl;
-	stream << "                     " << _prefix << "states[j].children[k] -> {" << std::endl;
+	stream << "                  :: (" << _prefix << "states[" << _k << "].type[USCXML_STATE_HISTORY_DEEP] ||" << std::endl;
+	stream << "                      " << _prefix << "states[" << _k << "].type[USCXML_STATE_HISTORY_SHALLOW]) &&" << std::endl;
+	stream << "                     " << bitHas(_prefix + "states[" + _j + "].children", _k) << " -> {" << std::endl;
 	stream << "                    /* a nested history state */" << std::endl;
-	stream << "                    " << _prefix << "ctx.entry_set[k] = true;" << std::endl;
+	stream << "                    " << bitSet(_prefix + "ctx.entry_set", _k, true) << ";" << std::endl;
 	stream << "                  }" << std::endl;
 	stream << "                  :: else -> skip;" << std::endl;
 	stream << "                  fi" << std::endl;
-	stream << "                  k = k + 1;" << std::endl;
+	stream << "                  " << _k << " = " << _k << " + 1;" << std::endl;
 	stream << "                }" << std::endl;
 	stream << "                :: else -> break;" << std::endl;
 	stream << "                od" << std::endl;
@@ -2187,7 +2309,7 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 	stream << "              :: else -> skip;" << std::endl;
 	stream << "              fi" << std::endl;
 	stream << "            }" << std::endl;
-	stream << "            j = j + 1;" << std::endl;
+	stream << "            " << _j << " = " << _j << " + 1;" << std::endl;
 	stream << "            :: else -> break;" << std::endl;
 	stream << "            od" << std::endl;
 	stream << "          }" << std::endl;
@@ -2200,44 +2322,44 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 	stream << "      }" << std::endl;
 
 	if (_transitions.size() > 0) {
-		stream << "      :: " << _prefix << "states[i].type[USCXML_STATE_INITIAL] -> {" << std::endl;
+		stream << "      :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_INITIAL] -> {" << std::endl;
 
-		TRACE_EXECUTION_V("Descendant completion for initial state %d", "i")
+		TRACE_EXECUTION_V("Descendant completion for initial state %d", _i)
 
-		stream << "        j = 0" << std::endl;
+		stream << "        " << _j << " = 0" << std::endl;
 		stream << "        do" << std::endl;
-		stream << "        :: j < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
+		stream << "        :: " << _j << " < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
 		stream << "          if" << std::endl;
-		stream << "          :: " << _prefix << "transitions[j].source == i -> {" << std::endl;
-		stream << "            " << _prefix << "ctx.trans_set[j] = true;" << std::endl;
-		stream << "            " << _prefix << "ctx.entry_set[i] = false;" << std::endl;
+		stream << "          :: " << _prefix << "transitions[" << _j << "].source == " << _i << " -> {" << std::endl;
+		stream << "            " << bitSet(_prefix + "ctx.trans_set", _j, true) << ";" << std::endl;
+		stream << "            " << bitSet(_prefix + "ctx.entry_set", _i, false) << ";" << std::endl;
 
-		TRACE_EXECUTION_V("Adding transition %d!", "j");
+		TRACE_EXECUTION_V("Adding transition %d!", _j);
 
 
-		stream << "            " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "transitions[j].target)" << std::endl;
+		stream << "            " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "transitions[" << _j << "].target)" << std::endl;
 		stream << std::endl;
 
-		stream << "            k = i + 1;" << std::endl;
+		stream << "            " << _k << " = " << _i << " + 1;" << std::endl;
 		stream << "            do" << std::endl;
-		stream << "            :: k < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+		stream << "            :: " << _k << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 		stream << "              if" << std::endl;
-		stream << "              :: " << _prefix << "transitions[j].target[k] -> {" << std::endl;
+		stream << "              :: " << bitHas(_prefix + "transitions[" + _j + "].target", _k) << " -> {" << std::endl;
 
-		stream << "                " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[k].ancestors)" << std::endl;
+		stream << "                " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _k << "].ancestors)" << std::endl;
 		stream << std::endl;
 
 		stream << "              }" << std::endl;
 		stream << "              :: else -> break;" << std::endl;
 		stream << "              fi" << std::endl;
-		stream << "              k = k + 1;" << std::endl;
+		stream << "              " << _k << " = " << _k << " + 1;" << std::endl;
 		stream << "            }" << std::endl;
 		stream << "            :: else -> break" << std::endl;
 		stream << "            od" << std::endl;
 		stream << "          }" << std::endl;
 		stream << "          :: else -> skip;" << std::endl;
 		stream << "          fi" << std::endl;
-		stream << "          j = j + 1;" << std::endl;
+		stream << "          " << _j << " = " << _j << " + 1;" << std::endl;
 		stream << "        }" << std::endl;
 		stream << "        :: else -> break" << std::endl;
 		stream << "        od;" << std::endl;
@@ -2245,40 +2367,40 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 		stream << "      }" << std::endl;
 	}
 
-	stream << "      :: " << _prefix << "states[i].type[USCXML_STATE_COMPOUND] -> {" << std::endl;
+	stream << "      :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_COMPOUND] -> {" << std::endl;
 
-	//    TRACE_EXECUTION_V("Descendant completion for compound state %d", "i")
+	//    TRACE_EXECUTION_V("Descendant completion for compound state %d", _i)
 
 	stream << "        /* we need to check whether one child is already in entry_set */" << std::endl;
 	stream << "        if" << std::endl;
 	stream << "        :: (" << std::endl;
-	stream << "          !" << _prefix << "STATES_HAS_AND(" << _prefix << "ctx.entry_set, " << _prefix << "states[i].children)";
+	stream << "          !" << _prefix << "STATES_HAS_AND(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _i << "].children)";
 	stream << " && " << std::endl;
-	stream << "           (!" << _prefix << "STATES_HAS_AND(" << _prefix << "config, " << _prefix << "states[i].children)";
+	stream << "           (!" << _prefix << "STATES_HAS_AND(" << _prefix << "config, " << _prefix << "states[" << _i << "].children)";
 	//	bit_has_and(stream, _prefix + "config", _prefix + "states[i].children", _states.size(), 5);
-	stream << " || " << _prefix << "STATES_HAS_AND(" << _prefix << "ctx.exit_set, " << _prefix << "states[i].children)" << std::endl;
+	stream << " || " << _prefix << "STATES_HAS_AND(" << _prefix << "ctx.exit_set, " << _prefix << "states[" << _i << "].children)" << std::endl;
 	stream << ")) " << std::endl;
 	stream << "        -> {" << std::endl;
 
-	stream << "          " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[i].completion)" << std::endl;
+	stream << "          " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _i << "].completion)" << std::endl;
 
 	stream << "          if" << std::endl;
-	stream << "          :: (" << _prefix << "STATES_HAS_AND(" << _prefix << "states[i].completion, " << _prefix << "states[i].children)";
+	stream << "          :: (" << _prefix << "STATES_HAS_AND(" << _prefix << "states[" << _i << "].completion, " << _prefix << "states[" << _i << "].children)";
 	//	bit_has_and(stream, _prefix + "states[i].completion", _prefix + "states[i].children", _states.size(), 6);
 	stream << std::endl;
 	stream << "          ) -> {" << std::endl;
 	stream << "            /* deep completion */" << std::endl;
-	stream << "            j = i + 1;" << std::endl;
+	stream << "            " << _j << " = " << _i << " + 1;" << std::endl;
 
-	//    TRACE_EXECUTION_V("Deep completion for compound state %d", "i")
+	//    TRACE_EXECUTION_V("Deep completion for compound state %d", _i)
 
 	stream << "            do" << std::endl;
-	stream << "            :: j < " << _prefix << "USCXML_NUMBER_STATES - 1 -> {" << std::endl;
-	stream << "              j = j + 1;" << std::endl;
+	stream << "            :: " << _j << " < " << _prefix << "USCXML_NUMBER_STATES - 1 -> {" << std::endl;
+	stream << "              " << _j << " = " << _j << " + 1;" << std::endl;
 	stream << "              if" << std::endl;
-	stream << "              :: " << _prefix << "states[i].completion[j] -> {" << std::endl;
+	stream << "              :: " << bitHas(_prefix + "states[" + _i + "].completion", _j) << " -> {" << std::endl;
 
-	stream << "                " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[j].ancestors)" << std::endl;
+	stream << "                " << _prefix << "STATES_OR(" << _prefix << "ctx.entry_set, " << _prefix << "states[" << _j << "].ancestors)" << std::endl;
 	stream << std::endl;
 
 	stream << "                /* completion of compound is single state */" << std::endl;
@@ -2304,7 +2426,7 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 	stream << "    }" << std::endl;
 	stream << "    :: else -> skip;" << std::endl;
 	stream << "    fi;" << std::endl;
-	stream << "    i = i + 1;" << std::endl;
+	stream << "    " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "  }" << std::endl;
 	stream << "  :: else -> break;" << std::endl;
 	stream << "  od;" << std::endl;
@@ -2322,22 +2444,22 @@ void ChartToPromela::writeFSMEstablishEntrySet(std::ostream& stream) {
 void ChartToPromela::writeFSMExitStates(std::ostream& stream) {
 	stream << "/* ---------------------------- */" << std::endl;
 	stream << "/* EXIT_STATES: */" << std::endl;
-	stream << "  i = " << _prefix << "USCXML_NUMBER_STATES;" << std::endl;
+	stream << "  " << _i << " = " << _prefix << "USCXML_NUMBER_STATES;" << std::endl;
 	stream << "  do" << std::endl;
-	stream << "  :: i > 0 -> {" << std::endl;
-	stream << "    i = i - 1;" << std::endl;
+	stream << "  :: " << _i << " > 0 -> {" << std::endl;
+	stream << "    " << _i << " = " << _i << " - 1;" << std::endl;
 	stream << "    if" << std::endl;
-	stream << "    :: " << _prefix << "ctx.exit_set[i] && " << _prefix << "config[i] -> {" << std::endl;
+	stream << "    :: " << bitHas(_prefix + "ctx.exit_set", _i) << " && " << bitHas(_prefix + "config", _i) << " -> {" << std::endl;
 	stream << "      /* call all on-exit handlers */" << std::endl;
 
-	TRACE_EXECUTION_V("Exiting state %d", "i");
+	TRACE_EXECUTION_V("Exiting state %d", _i);
 
 	stream << "      if" << std::endl;
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> onexits = DOMUtils::filterChildElements(XML_PREFIX(_states[i]).str() + "onexit" , _states[i]);
 		if (onexits.size() > 0) {
-			stream << "      :: i == " << toStr(i) << " -> {" << std::endl;
-			TRACE_EXECUTION_V("Processing executable content for exiting state %d", "i");
+			stream << "      :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
+			TRACE_EXECUTION_V("Processing executable content for exiting state %d", _i);
 			for (auto onexit : onexits)
 				writeExecContent(stream, onexit, 3);
 			stream << "      }" << std::endl;
@@ -2347,7 +2469,7 @@ void ChartToPromela::writeFSMExitStates(std::ostream& stream) {
 	stream << "      fi" << std::endl;
 	stream << std::endl;
 
-	stream << "      " << _prefix << "config[i] = false;" << std::endl;
+	stream << "      " << bitSet(_prefix + "config", _i, false) << ";" << std::endl;
 	stream << "      skip;" << std::endl;
 	stream << "    }" << std::endl;
 	stream << "    :: else -> skip;" << std::endl;
@@ -2362,21 +2484,21 @@ void ChartToPromela::writeFSMTakeTransitions(std::ostream& stream) {
 	stream << "/* ---------------------------- */" << std::endl;
 	stream << "/* TAKE_TRANSITIONS: */" << std::endl;
 	if (_transitions.size() > 0) {
-		stream << "  i = 0;" << std::endl;
+		stream << "  " << _i << " = 0;" << std::endl;
 		stream << "  do" << std::endl;
-		stream << "  :: i < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
+		stream << "  :: " << _i << " < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
 		stream << "    if" << std::endl;
-		stream << "    :: " << _prefix << "ctx.trans_set[i] && " << std::endl;
-		stream << "       !" << _prefix << "transitions[i].type[USCXML_TRANS_HISTORY] && " << std::endl;
-		stream << "       !" << _prefix << "transitions[i].type[USCXML_TRANS_INITIAL] -> {" << std::endl;
+		stream << "    :: " << bitHas(_prefix + "ctx.trans_set", _i) << " && " << std::endl;
+		stream << "       !" << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_HISTORY] && " << std::endl;
+		stream << "       !" << _prefix << "transitions[" << _i << "].type[USCXML_TRANS_INITIAL] -> {" << std::endl;
 		stream << "      /* Call executable content in normal transition */" << std::endl;
 
-		TRACE_EXECUTION_V("Taking transition %d", "i");
+		TRACE_EXECUTION_V("Taking transition %d", _i);
 
 		stream << "      if" << std::endl;
 		for (size_t i = 0; i < _transitions.size(); i++) {
-			stream << "      :: i == " << toStr(i) << " -> {" << std::endl;
-			TRACE_EXECUTION_V("Processing executable content for transition %d", "i");
+			stream << "      :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
+			TRACE_EXECUTION_V("Processing executable content for transition %d", _i);
 			writeExecContent(stream, _transitions[i], 4);
 			stream << "        skip;" << std::endl;
 			stream << "      }" << std::endl;
@@ -2387,7 +2509,7 @@ void ChartToPromela::writeFSMTakeTransitions(std::ostream& stream) {
 		stream << "    }" << std::endl;
 		stream << "    :: else -> skip;" << std::endl;
 		stream << "    fi;" << std::endl;
-		stream << "    i = i + 1;" << std::endl;
+		stream << "    " << _i << " = " << _i << " + 1;" << std::endl;
 		stream << "  }" << std::endl;
 		stream << "  :: else -> break;" << std::endl;
 		stream << "  od;" << std::endl;
@@ -2397,28 +2519,28 @@ void ChartToPromela::writeFSMTakeTransitions(std::ostream& stream) {
 void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 	stream << "/* ---------------------------- */" << std::endl;
 	stream << "/* ENTER_STATES: */" << std::endl;
-	stream << "  i = 0;" << std::endl;
+	stream << "  " << _i << " = 0;" << std::endl;
 	stream << "  do" << std::endl;
-	stream << "  :: i < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "  :: " << _i << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "    if" << std::endl;
-	stream << "    :: (" << _prefix << "ctx.entry_set[i] &&" << std::endl;
-	stream << "        !" << _prefix << "config[i] && " << std::endl;
+	stream << "    :: (" << bitHas(_prefix + "ctx.entry_set", _i) << " &&" << std::endl;
+	stream << "        !" << bitHas(_prefix + "config", _i) << " && " << std::endl;
 	stream << "        /* these are no proper states */" << std::endl;
-	stream << "        !" << _prefix << "states[i].type[USCXML_STATE_HISTORY_DEEP] && " << std::endl;
-	stream << "        !" << _prefix << "states[i].type[USCXML_STATE_HISTORY_SHALLOW] && " << std::endl;
-	stream << "        !" << _prefix << "states[i].type[USCXML_STATE_INITIAL]" << std::endl;
+	stream << "        !" << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_DEEP] && " << std::endl;
+	stream << "        !" << _prefix << "states[" << _i << "].type[USCXML_STATE_HISTORY_SHALLOW] && " << std::endl;
+	stream << "        !" << _prefix << "states[" << _i << "].type[USCXML_STATE_INITIAL]" << std::endl;
 	stream << "       ) -> {" << std::endl;
 
-	TRACE_EXECUTION_V("Entering state %d", "i");
+	TRACE_EXECUTION_V("Entering state %d", _i);
 
-	stream << "         " << _prefix << "config[i] = true;" << std::endl;
+	stream << "         " << bitSet(_prefix + "config", _i, true) << ";" << std::endl;
 	stream << std::endl;
 
 #if 0
 	stream << "         if" << std::endl;
-	stream << "         :: !" << _prefix << "initialized_data[i] -> {" << std::endl;
+	stream << "         :: !" << _prefix << "initialized_data[" << _i << "] -> {" << std::endl;
 	stream << "           /* TODO: late data binding not supported yet */" << std::endl;
-	stream << "           " << _prefix << "initialized_data[i] = true;" << std::endl;
+	stream << "           " << _prefix << "initialized_data[" << _i << "] = true;" << std::endl;
 	stream << "           skip" << std::endl;
 	stream << "         }" << std::endl;
 	stream << "         :: else -> skip;" << std::endl;
@@ -2431,8 +2553,8 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> onentries = DOMUtils::filterChildElements(XML_PREFIX(_states[i]).str() + "onentry" , _states[i]);
 		if (onentries.size() > 0) {
-			stream << "         :: i == " << toStr(i) << " -> {" << std::endl;
-			TRACE_EXECUTION_V("Processing executable content for entering state %d", "i");
+			stream << "         :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
+			TRACE_EXECUTION_V("Processing executable content for entering state %d", _i);
 			for (auto onentry : onentries)
 				writeExecContent(stream, onentry, 5);
 			stream << "         }" << std::endl;
@@ -2444,19 +2566,19 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 
 	stream << "         /* take history and initial transitions */" << std::endl;
 	if (_transitions.size() > 0) {
-		stream << "         j = 0;" << std::endl;
+		stream << "         " << _j << " = 0;" << std::endl;
 		stream << "         do" << std::endl;
-		stream << "         :: j < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
+		stream << "         :: " << _j << " < " << _prefix << "USCXML_NUMBER_TRANS -> {" << std::endl;
 		stream << "           if" << std::endl;
-		stream << "           :: (" << _prefix << "ctx.trans_set[j] &&" << std::endl;
-		stream << "              (" << _prefix << "transitions[j].type[USCXML_TRANS_HISTORY] ||" << std::endl;
-		stream << "               " << _prefix << "transitions[j].type[USCXML_TRANS_INITIAL]) && " << std::endl;
-		stream << "               " << _prefix << "states[" << _prefix << "transitions[j].source].parent == i) -> {" << std::endl;
+		stream << "           :: (" << bitHas(_prefix + "ctx.trans_set", _j) << " &&" << std::endl;
+		stream << "              (" << _prefix << "transitions[" << _j << "].type[USCXML_TRANS_HISTORY] ||" << std::endl;
+		stream << "               " << _prefix << "transitions[" << _j << "].type[USCXML_TRANS_INITIAL]) && " << std::endl;
+		stream << "               " << _prefix << "states[" << _prefix << "transitions[" << _j << "].source].parent == " << _i << ") -> {" << std::endl;
 		stream << "              /* Call executable content in history or initial transition */" << std::endl;
 		stream << "              if" << std::endl;
 		for (size_t i = 0; i < _transitions.size(); i++) {
-			stream << "              :: j == " << toStr(i) << " -> {" << std::endl;
-			TRACE_EXECUTION_V("Processing executable content for transition %d", "j");
+			stream << "              :: " << _j << " == " << toStr(i) << " -> {" << std::endl;
+			TRACE_EXECUTION_V("Processing executable content for transition %d", _j);
 
 			writeExecContent(stream, _transitions[i], 8);
 			stream << "                skip;" << std::endl;
@@ -2469,7 +2591,7 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 		stream << "           }" << std::endl;
 		stream << "           :: else -> skip;" << std::endl;
 		stream << "           fi" << std::endl;
-		stream << "           j = j + 1;" << std::endl;
+		stream << "           " << _j << " = " << _j << " + 1;" << std::endl;
 		stream << "         }" << std::endl;
 		stream << "         :: else -> break;" << std::endl;
 		stream << "         od" << std::endl;
@@ -2477,13 +2599,13 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 
 	stream << "         /* handle final states */" << std::endl;
 	stream << "         if" << std::endl;
-	stream << "         :: " << _prefix << "states[i].type[USCXML_STATE_FINAL] -> {" << std::endl;
+	stream << "         :: " << _prefix << "states[" << _i << "].type[USCXML_STATE_FINAL] -> {" << std::endl;
 
 	stream << "           if" << std::endl;
-	stream << "           :: " << _prefix << "states[" << _prefix << "states[i].parent].children[1] -> {" << std::endl;
+	stream << "           :: " << bitHas(_prefix + "states[" + _prefix + "states[" + _i + "].parent].children", "1") << " -> {" << std::endl;
 	stream << "             /* exit topmost SCXML state */" << std::endl;
-	stream << "             " << _prefix << "flags[USCXML_CTX_TOP_LEVEL_FINAL] = true;" << std::endl;
-	stream << "             " << _prefix << "flags[USCXML_CTX_FINISHED] = true;" << std::endl;
+	stream << "             " << bitSet(_prefix + "flags", "USCXML_CTX_TOP_LEVEL_FINAL", true) << ";" << std::endl;
+	stream << "             " << bitSet(_prefix + "flags", "USCXML_CTX_FINISHED", true) << ";" << std::endl;
 	stream << "           }" << std::endl;
 	stream << "           :: else -> {" << std::endl;
 	stream << "             /* raise done event */" << std::endl;
@@ -2506,7 +2628,7 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 
 		std::string doneEvent = _analyzer->macroForLiteral("done.state." + ATTR_CAST(state->getParentNode(), kXMLCharId));
 
-		stream << "             :: (i == " << ATTR(state, X("documentOrder")) << ") -> {" << std::endl;
+		stream << "             :: (" << _i << " == " << ATTR(state, X("documentOrder")) << ") -> {" << std::endl;
 
 		if (_analyzer->usesComplexEventStruct()) {
 			std::string typeReset = _analyzer->getTypeReset(_prefix + "_tmpE", _analyzer->getType("_event"), 7);
@@ -2539,32 +2661,32 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 	stream << "            * 3. Iterate all active final states and remove their ancestors" << std::endl;
 	stream << "            * 4. If a state remains, not all children of a parallel are final" << std::endl;
 	stream << "            */" << std::endl;
-	stream << "            j = 0;" << std::endl;
+	stream << "            " << _j << " = 0;" << std::endl;
 	stream << "            do" << std::endl;
-	stream << "            :: j < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "            :: " << _j << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "              if" << std::endl;
-	stream << "              :: " << _prefix << "states[j].type[USCXML_STATE_PARALLEL] && " << _prefix << "states[i].ancestors[j] -> {" << std::endl;
+	stream << "              :: " << _prefix << "states[" << _j << "].type[USCXML_STATE_PARALLEL] && " << bitHas(_prefix + "states[" + _i + "].ancestors", _j) << " -> {" << std::endl;
 	stream << "                " << _prefix << "STATES_CLEAR(" << _prefix << "ctx.tmp_states)" << std::endl;
 
-	stream << "                k = 0;" << std::endl;
+	stream << "                " << _k << " = 0;" << std::endl;
 	stream << "                do" << std::endl;
-	stream << "                :: k < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
+	stream << "                :: " << _k << " < " << _prefix << "USCXML_NUMBER_STATES -> {" << std::endl;
 	stream << "                  if" << std::endl;
-	stream << "                  :: " << _prefix << "states[k].ancestors[j] && " << _prefix << "config[k] -> {" << std::endl;
+	stream << "                  :: " << bitHas(_prefix + "states[" + _k + "].ancestors", _j) << " && " << bitHas(_prefix + "config", _k) << " -> {" << std::endl;
 	stream << "                    if" << std::endl;
-	stream << "                    :: " << _prefix << "states[k].type[USCXML_STATE_FINAL] -> {" << std::endl;
+	stream << "                    :: " << _prefix << "states[" << _k << "].type[USCXML_STATE_FINAL] -> {" << std::endl;
 
-	stream << "                      " << _prefix << "STATES_AND_NOT(" << _prefix << "ctx.tmp_states, " << _prefix << "states[k].ancestors)" << std::endl;
+	stream << "                      " << _prefix << "STATES_AND_NOT(" << _prefix << "ctx.tmp_states, " << _prefix << "states[" << _k << "].ancestors)" << std::endl;
 	stream << "                    }" << std::endl;
 	stream << "                    :: else -> {" << std::endl;
 
-	stream << "                      " << _prefix << "ctx.tmp_states[k] = true;" << std::endl;
+	stream << "                      " << bitSet(_prefix + "ctx.tmp_states", _k, true) << ";" << std::endl;
 	stream << "                    }" << std::endl;
 	stream << "                    fi" << std::endl;
 	stream << "                  }" << std::endl;
 	stream << "                  :: else -> skip;" << std::endl;
 	stream << "                  fi" << std::endl;
-	stream << "                  k = k + 1;" << std::endl;
+	stream << "                  " << _k << " = " << _k << " + 1;" << std::endl;
 	stream << "                }" << std::endl;
 	stream << "                :: else -> break;" << std::endl;
 	stream << "                od" << std::endl;
@@ -2574,7 +2696,7 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 
 	for (auto state : _states) {
 		if (isParallel(state) && HAS_ATTR(state, kXMLCharId)) {
-			stream << "                  :: j == " << toStr(ATTR(state, X("documentOrder"))) << " -> {" << std::endl;
+			stream << "                  :: " << _j << " == " << toStr(ATTR(state, X("documentOrder"))) << " -> {" << std::endl;
 
 			std::string doneEvent = _analyzer->macroForLiteral("done.state." + ATTR(state, kXMLCharId));
 
@@ -2604,7 +2726,7 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 	stream << "              }" << std::endl;
 	stream << "              :: else -> skip;" << std::endl;
 	stream << "              fi" << std::endl;
-	stream << "              j = j + 1;" << std::endl;
+	stream << "              " << _j << " = " << _j << " + 1;" << std::endl;
 	stream << "            }" << std::endl;
 	stream << "            :: else -> break;" << std::endl;
 	stream << "            od" << std::endl;
@@ -2618,7 +2740,7 @@ void ChartToPromela::writeFSMEnterStates(std::ostream& stream) {
 
 	stream << "    }" << std::endl;
 	stream << "    :: else -> skip;" << std::endl;
-	stream << "    i = i + 1;" << std::endl;
+	stream << "    " << _i << " = " << _i << " + 1;" << std::endl;
 	stream << "    fi;" << std::endl;
 	stream << "  }" << std::endl;
 	stream << "  :: else -> break;" << std::endl;
@@ -2634,19 +2756,19 @@ void ChartToPromela::writeFSMTerminateMachine(std::ostream& stream) {
 	TRACE_EXECUTION("Machine finished");
 
 	stream << "/* exit all remaining states */" << std::endl;
-	stream << "i = " << _prefix << "USCXML_NUMBER_STATES;" << std::endl;
+	stream << _i << " = " << _prefix << "USCXML_NUMBER_STATES;" << std::endl;
 	stream << "do" << std::endl;
-	stream << ":: i > 0 -> {" << std::endl;
-	stream << "  i = i - 1;" << std::endl;
+	stream << ":: " << _i << " > 0 -> {" << std::endl;
+	stream << "  " << _i << " = " << _i << " - 1;" << std::endl;
 	stream << "  if" << std::endl;
-	stream << "  :: " << _prefix << "config[i] && " << _prefix << "flags[USCXML_CTX_TOP_LEVEL_FINAL] -> {" << std::endl;
+	stream << "  :: " << bitHas(_prefix + "config", _i) << " && " << bitHas(_prefix + "flags", "USCXML_CTX_TOP_LEVEL_FINAL") << " -> {" << std::endl;
 	stream << "    /* call all on exit handlers */" << std::endl;
 	stream << "   if" << std::endl;
 	for (size_t i = 0; i < _states.size(); i++) {
 		std::list<DOMElement*> onentries = DOMUtils::filterChildElements(XML_PREFIX(_states[i]).str() + "onexit" , _states[i]);
 		if (onentries.size() > 0) {
-			stream << "    :: i == " << toStr(i) << " -> {" << std::endl;
-			TRACE_EXECUTION_V("Processing executable content for exiting state %d", "i");
+			stream << "    :: " << _i << " == " << toStr(i) << " -> {" << std::endl;
+			TRACE_EXECUTION_V("Processing executable content for exiting state %d", _i);
 			for (auto onentry : onentries)
 				writeExecContent(stream, onentry, 2);
 			stream << "    }" << std::endl;
@@ -2663,14 +2785,14 @@ void ChartToPromela::writeFSMTerminateMachine(std::ostream& stream) {
 	stream << std::endl;
 
 	stream << "  if" << std::endl;
-	stream << "  :: " << _prefix << "invocations[i] -> {" << std::endl;
+	stream << "  :: " << bitHas(_prefix + "invocations", _i) << " -> {" << std::endl;
 	stream << "    /* cancel invocations */" << std::endl;
-	stream << "    " << _prefix << "invocations[i] = false;" << std::endl;
+	stream << "    " << bitSet(_prefix + "invocations", _i, false) << ";" << std::endl;
 	stream << "    if" << std::endl;
 
 	for (auto machine : _machinesNested) {
-		stream << "    :: i == " << ATTR_CAST(machine.first->getParentNode(), X("documentOrder")) << " -> {" << std::endl;
-		stream << "      " << machine.second->_prefix << "flags[USCXML_CTX_FINISHED] = true;" << std::endl;
+		stream << "    :: " << _i << " == " << ATTR_CAST(machine.first->getParentNode(), X("documentOrder")) << " -> {" << std::endl;
+		stream << "      " << bitSet(machine.second->_prefix + "flags", "USCXML_CTX_FINISHED", true) << ";" << std::endl;
 		stream << "    }" << std::endl;
 	}
 	stream << "    :: else -> skip;" << std::endl;
@@ -2697,7 +2819,7 @@ void ChartToPromela::writeFSMTerminateMachine(std::ostream& stream) {
 	if (_parent != NULL) {
 		stream << "/* send done event */" << std::endl;
 		stream << "if" << std::endl;
-		stream << ":: " << _prefix << "flags[USCXML_CTX_TOP_LEVEL_FINAL] -> {" << std::endl;
+		stream << ":: " << bitHas(_prefix + "flags", "USCXML_CTX_TOP_LEVEL_FINAL") << " -> {" << std::endl;
 
 		if (_analyzer->usesComplexEventStruct()) {
 			std::string typeReset = _analyzer->getTypeReset(_prefix + "_tmpE", _analyzer->getType("_event"), 2);
@@ -2878,7 +3000,7 @@ std::string ChartToPromela::declForRange(const std::string& identifier, long min
 			return "byte " + identifier;
 		return "bool " + identifier;
 	} else {
-		return "unsigned " + identifier + " : " + toStr(BIT_WIDTH(maxValue));
+		return "unsigned " + identifier + " : " + toStr(BIT_WIDTH(maxValue + 1));
 	}
 }
 
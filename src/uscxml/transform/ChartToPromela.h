@@ -28,6 +28,9 @@
 #include "promela/PromelaCodeAnalyzer.h"
 
 #include <ostream>
+#include <string>
+#include <vector>
+#include <map>
 
 namespace uscxml {
 
@@ -38,6 +41,16 @@ public:
 
 	void writeTo(std::ostream& stream);
 
+	/// Names of the states and transitions of a machine in document order
+	struct NameMapping {
+		std::string prefix;
+		std::vector<std::string> states; ///< the id or tag name and index of the state
+		std::vector<std::string> transitions; ///< source, event and targets of the transition
+	};
+
+	/// The mappings of all machines by invoker id, available after writeTo
+	std::map<std::string, NameMapping> getNameMappings();
+
 protected:
 	ChartToPromela(const Interpreter& other) : ChartToC(other) {
 		_prefix = "U" + _md5.substr(0, 8) + "_";
@@ -95,6 +108,12 @@ protected:
 	                   size_t length,
 	                   size_t indent = 0);
 
+	size_t bitsetWords(size_t nrBits);
+	std::string declBitset(const std::string& identifier, size_t nrBits);
+	std::string bitHas(const std::string& bitset, const std::string& index);
+	std::string bitSet(const std::string& bitset, const std::string& index, bool value);
+	void writeBitsetInit(std::ostream& stream, const std::string& bitset, const std::string& bools);
+
 	PromelaCodeAnalyzer* _analyzer = NULL;
 
 	ChartToPromela* _parentTopMost = NULL;
@@ -104,6 +123,10 @@ protected:
 	size_t _internalQueueLength = 7;
 	size_t _externalQueueLength = 7;
 	bool _allowEventInterleaving = false;
+	bool _packedVector = false; ///< bitsets in words, variables narrowed to their range and hidden loop counters
+	std::string _i = "i"; ///< loop counters of the step proctype, hidden globals of this machine with a packed vector
+	std::string _j = "j";
+	std::string _k = "k";
 
 	std::map<std::string, XERCESC_NS::DOMElement* > _machinesPerId;
 	std::map<std::string, XERCESC_NS::DOMElement* >* _machinesAllPerId = NULL;
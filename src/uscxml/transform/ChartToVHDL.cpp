@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <iterator>
 
 #include <sstream>
 
@@ -104,6 +105,7 @@ bool ChartToVHDL::isSupportedExecContent(DOMElement *execContentElement) {
 }
 
 void ChartToVHDL::writeTo(std::ostream &stream) {
+	_multicycle = (_extensions.find("multicycle") != _extensions.end() && _extensions.find("multicycle")->second == "on");
 	findEvents();
 
 
@@ -112,6 +114,10 @@ void ChartToVHDL::writeTo(std::ostream &stream) {
 	stream << "--   ghdl --clean && ghdl -a foo.vhdl && ghdl -e tb && ./tb --stop-time=10ms --vcd=tb.vcd" <<
 	       std::endl;
 	stream << "--   gtkwave tb.vcd" << std::endl;
+	if (_multicycle) {
+		stream << "-- the testbench passes its generics on, e.g. for a single cycle microstep" << std::endl;
+		stream << "--   ./tb -gMULTICYCLE=false -gEVENT_PORTS=1 -gFIFO_DEPTH=16 --stop-time=10ms" << std::endl;
+	}
 	stream << std::endl;
 
 	writeFiFo(stream);
@@ -131,6 +137,47 @@ void ChartToVHDL::writeIncludes(std::ostream &stream) {
 	stream << std::endl;
 }
 
+void ChartToVHDL::writeGenerics(std::ostream &stream, const std::list<std::string> &generics, const std::string &padding) {
+	stream << padding << "generic (" << std::endl;
+	for (auto iter = generics.begin(); iter != generics.end(); iter++) {
+		if (*iter == "MULTICYCLE") {
+			stream << padding << "  constant MULTICYCLE  : boolean := true";
+		} else if (*iter == "EVENT_PORTS") {
+			stream << padding << "  constant EVENT_PORTS : positive := 2";
+		} else if (*iter == "FIFO_DEPTH") {
+			stream << padding << "  constant FIFO_DEPTH  : positive := 256";
+		}
+		stream << (std::next(iter) != generics.end() ? ";" : "") << std::endl;
+	}
+	stream << padding << ");" << std::endl;
+}
+
+void ChartToVHDL::writeGenericMap(std::ostream &stream, const std::list<std::string> &generics, const std::string &padding) {
+	stream << padding << "generic map (" << std::endl;
+	for (auto iter = generics.begin(); iter != generics.end(); iter++) {
+		stream << padding << "  " << *iter << " => " << *iter;
+		stream << (std::next(iter) != generics.end() ? "," : "") << std::endl;
+	}
+	stream << padding << ")" << std::endl;
+}
+
+std::string ChartToVHDL::stageSignal(const std::string &name) {
+	// signals of the previous stage are read from its registers
+	return name + (_multicycle ? "_reg" : "_sig");
+}
+
+std::string ChartToVHDL::eventBusType() {
+	if (_multicycle)
+		return "std_logic_vector( EVENT_PORTS * " + toStr(_eventBitSize + 1) + " - 1 downto 0)";
+	return "std_logic_vector( " + toStr(_eventBitSize) + " downto 0)";
+}
+
+std::string ChartToVHDL::eventWriteType() {
+	if (_multicycle)
+		return "std_logic_vector( EVENT_PORTS - 1 downto 0)";
+	return "std_logic";
+}
+
 void ChartToVHDL::writeTestbench(std::ostream &stream) {
 
 	stream << "-- TESTBENCH" << std::endl;
@@ -140,6 +187,9 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 
 	stream << "-- empty entity" << std::endl;
 	stream << "entity tb is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"MULTICYCLE", "EVENT_PORTS", "FIFO_DEPTH"});
+	}
 	stream << "end entity tb;" << std::endl;
 	stream << std::endl;
 
@@ -150,13 +200,16 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	//COMPONENT MS
 	stream << "  -- Module declaration" << std::endl;
 	stream << "  component micro_stepper is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"MULTICYCLE", "EVENT_PORTS", "FIFO_DEPTH"}, "    ");
+	}
 	stream << "    port (" << std::endl;
 	stream << "    --inputs" << std::endl;
 	stream << "    clk  :in    std_logic;" << std::endl;
 	stream << "    rst_i  :in    std_logic;" << std::endl;
 	stream << "    en   :in    std_logic;" << std::endl;
-	stream << "    next_event_i    :in  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
-	stream << "    next_event_we_i :in  std_logic;" << std::endl;
+	stream << "    next_event_i    :in  " << eventBusType() << ";" << std::endl;
+	stream << "    next_event_we_i :in  " << eventWriteType() << ";" << std::endl;
 
 	for (auto transition : _transitions) {
 		if (HAS_ATTR(transition, kXMLCharCond)) { // create enable line if transition has conditions
@@ -195,6 +248,9 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 
 	// COMPONENT EC
 	stream << "  component event_controller is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"EVENT_PORTS"}, "  ");
+	}
 	stream << "  port(" << std::endl;
 	stream << "    --inputs" << std::endl;
 	stream << "    clk  :in    std_logic;" << std::endl;
@@ -223,8 +279,8 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	}
 	stream << "    --outputs" << std::endl;
 	stream << "    micro_stepper_en_o :out  std_logic;" << std::endl;
-	stream << "    event_o    :out  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
-	stream << "    event_we_o :out  std_logic" << std::endl;
+	stream << "    event_o    :out  " << eventBusType() << ";" << std::endl;
+	stream << "    event_we_o :out  " << eventWriteType() << std::endl;
 	//        stream << "    done_o :out std_logic" << std::endl;
 	stream << ");" << std::endl;
 	stream << "end component; " << std::endl;
@@ -262,8 +318,8 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	stream << "  signal dut_enable : std_logic;" << std::endl;
 	stream << "  signal ec_enable_out : std_logic;" << std::endl;
 	stream << "  signal cs_enable_out : std_logic;" << std::endl;
-	stream << "  signal next_event_we_i : std_logic;" << std::endl;
-	stream << "  signal next_event_i : std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
+	stream << "  signal next_event_we_i : " << eventWriteType() << ";" << std::endl;
+	stream << "  signal next_event_i : " << eventBusType() << ";" << std::endl;
 	stream << std::endl;
 
 	stream << "  -- output" << std::endl;
@@ -312,6 +368,9 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 
 	stream << "  -- Module instantiation" << std::endl;
 	stream << "  dut : micro_stepper" << std::endl;
+	if (_multicycle) {
+		writeGenericMap(stream, {"MULTICYCLE", "EVENT_PORTS", "FIFO_DEPTH"}, "    ");
+	}
 	stream << "    port map (" << std::endl;
 	stream << "      clk       => clk," << std::endl;
 	stream << "      rst_i     => reset," << std::endl;
@@ -361,6 +420,9 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	stream << std::endl;
 
 	stream << "  ec : event_controller" << std::endl;
+	if (_multicycle) {
+		writeGenericMap(stream, {"EVENT_PORTS"}, "    ");
+	}
 	stream << "    port map (" << std::endl;
 	stream << "      clk       => clk," << std::endl;
 	stream << "      rst_i     => reset," << std::endl;
@@ -441,14 +503,37 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	stream << "  -- Test observation" << std::endl;
 	stream << "  process (clk)" << std::endl;
 	stream << "  variable count_clk : integer := 0;" << std::endl;
+	if (_multicycle) {
+		stream << "  variable count_cycles : integer := 0;" << std::endl;
+		stream << "  variable count_events : integer := 0;" << std::endl;
+	}
 	stream << "  begin" << std::endl;
 	stream << "  if rising_edge(clk) then" << std::endl;
 	stream << "    count_clk := count_clk + 1;" << std::endl;
+	if (_multicycle) {
+		// to compare against a single cycle microstep via -gMULTICYCLE=false
+		stream << "    -- cycles after reset and events written into the microstepper" << std::endl;
+		stream << "    if reset = '0' and completed_o = '0' then" << std::endl;
+		stream << "      count_cycles := count_cycles + 1;" << std::endl;
+		stream << "      for i in 0 to EVENT_PORTS - 1 loop" << std::endl;
+		stream << "        if next_event_we_i(i) = '1' then" << std::endl;
+		stream << "          count_events := count_events + 1;" << std::endl;
+		stream << "        end if;" << std::endl;
+		stream << "      end loop;" << std::endl;
+		stream << "    end if;" << std::endl;
+	}
 	stream << "    if (completed_o = '1') then" << std::endl;
 	if (!passStateNo.empty()) {
 		stream << "      assert (state_active_" << passStateNo;
 		stream << "_sig = '1') report \"Completed with errors\" severity error;" << std::endl;
 	}
+	if (_multicycle) {
+		stream << "      report \"Completed after \" & integer'image(count_cycles) & \" cycles with \"" << std::endl;
+		stream << "        & integer'image(count_events) & \" events\" severity note;" << std::endl;
+		stream << "      if count_events > 0 then" << std::endl;
+		stream << "        report \"Cycles per event: \" & real'image(real(count_cycles) / real(count_events)) severity note;" << std::endl;
+		stream << "      end if;" << std::endl;
+	}
 	stream << "      -- stop simulation" << std::endl;
 	stream << "      finish(0);" << std::endl; // use 0 for ctest
 //        -- For both STOP and FINISH the STATUS values are those used
@@ -462,6 +547,10 @@ void ChartToVHDL::writeTestbench(std::ostream &stream) {
 	stream << "      -- state machine not completed" << std::endl;
 	stream << "      -- check if it is time to stop waiting (100 clk per state+transition+excontent)" << std::endl;
 	int tolleratedClocks = (_transitions.size() + _states.size() + _execContent.size()) * 100;
+	if (_multicycle) {
+		// a microstep takes a cycle per stage
+		tolleratedClocks *= 4;
+	}
 	stream << "      assert (count_clk < " << tolleratedClocks;
 	stream << ") report \"Clock count exceed\" severity failure;" << std::endl;
 	stream << "    end if;" << std::endl;
@@ -718,6 +807,9 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 	stream << "-- Event Controller Logic" << std::endl;
 	writeIncludes(stream);
 	stream << "entity event_controller is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"EVENT_PORTS"});
+	}
 	stream << "port(" << std::endl;
 	stream << "    --inputs" << std::endl;
 	stream << "    clk  :in    std_logic;" << std::endl;
@@ -747,8 +839,8 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 
 	stream << "    --outputs" << std::endl;
 	stream << "    micro_stepper_en_o :out  std_logic;" << std::endl;
-	stream << "    event_o    :out  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
-	stream << "    event_we_o :out  std_logic" << std::endl;
+	stream << "    event_o    :out  " << eventBusType() << ";" << std::endl;
+	stream << "    event_we_o :out  " << eventWriteType() << std::endl;
 	stream << ");" << std::endl;
 	stream << "end event_controller; " << std::endl;
 
@@ -762,17 +854,22 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 	stream << "signal micro_stepper_en : std_logic;" << std::endl;
 	stream << "signal cmpl_buf : std_logic;" << std::endl;
 	stream << "signal completed_sig : std_logic;" << std::endl;
-	stream << "signal event_bus : std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
-	stream << "signal event_we  : std_logic;" << std::endl;
+	stream << "signal event_bus : " << eventBusType() << ";" << std::endl;
+	stream << "signal event_we  : " << eventWriteType() << ";" << std::endl;
 
 	for (size_t i = 0; i < _execContent.size(); i++) {
 		stream << "signal done_" << toStr(i) << "_sig : std_logic;" << std::endl;
 		stream << "signal start_" << toStr(i) << "_sig : std_logic;" << std::endl;
 	}
 
-	stream << "-- sequence input line" << std::endl;
-	for (size_t i = 0; i < _execContent.size(); i++) {
-		stream << "signal seq_" << toStr(i) << "_sig : std_logic;" << std::endl;
+	if (_multicycle) {
+		stream << "-- all events of the microstep written" << std::endl;
+		stream << "signal all_done_sig : std_logic;" << std::endl;
+	} else {
+		stream << "-- sequence input line" << std::endl;
+		for (size_t i = 0; i < _execContent.size(); i++) {
+			stream << "signal seq_" << toStr(i) << "_sig : std_logic;" << std::endl;
+		}
 	}
 	stream << std::endl;
 
@@ -798,7 +895,7 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 		stream << "-- setting output lines to fulfil dummy functionality" << std::endl;
 		stream << "micro_stepper_en_o <= '1';" << std::endl;
 		stream << "event_o <= (others => '0');" << std::endl;
-		stream << "event_we_o <= '0';" << std::endl;
+		stream << "event_we_o <= " << (_multicycle ? "(others => '0')" : "'0'") << ";" << std::endl;
 		stream << std::endl;
 	} else {
 		// system signal mapping
@@ -832,99 +929,103 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 		stream << ");" << std::endl;
 		stream << std::endl;
 
-		// sequential code operation
-		stream << "-- seq code block " << std::endl;
-		stream << "ex_content_block : process (clk, rst) " << std::endl;
-		stream << "begin" << std::endl;
-		stream << "  if rst = '1' then" << std::endl;
-		for (size_t i = 0; i < _execContent.size(); i++) {
-			stream << "    done_" << toStr(i) << "_sig <= '0';" << std::endl;
-		}
-		stream << "    event_bus <= (others => '0');" << std::endl;
-		stream << "    event_we <= '0';" << std::endl;
-		stream << "    cmpl_buf <= '0';" << std::endl;
-		stream << "    completed_sig <= '0';" << std::endl;
-		stream << "  elsif rising_edge(clk) then" << std::endl;
-
-		stream << "    if micro_stepper_en = '1' then" << std::endl;
-		stream << "      cmpl_buf <= '0' ;" << std::endl;
-		stream << "    else" << std::endl;
-		stream << "      cmpl_buf <= seq_" << toStr(_execContent.size() - 1)
-		       << "_sig;" << std::endl;
-		stream << "    end if;" << std::endl;
-		stream << "    completed_sig <= cmpl_buf;" << std::endl << std::endl;
+		if (_multicycle) {
+			writeParallelExecContent(stream);
+		} else {
+			// sequential code operation
+			stream << "-- seq code block " << std::endl;
+			stream << "ex_content_block : process (clk, rst) " << std::endl;
+			stream << "begin" << std::endl;
+			stream << "  if rst = '1' then" << std::endl;
+			for (size_t i = 0; i < _execContent.size(); i++) {
+				stream << "    done_" << toStr(i) << "_sig <= '0';" << std::endl;
+			}
+			stream << "    event_bus <= (others => '0');" << std::endl;
+			stream << "    event_we <= '0';" << std::endl;
+			stream << "    cmpl_buf <= '0';" << std::endl;
+			stream << "    completed_sig <= '0';" << std::endl;
+			stream << "  elsif rising_edge(clk) then" << std::endl;
+
+			stream << "    if micro_stepper_en = '1' then" << std::endl;
+			stream << "      cmpl_buf <= '0' ;" << std::endl;
+			stream << "    else" << std::endl;
+			stream << "      cmpl_buf <= seq_" << toStr(_execContent.size() - 1)
+			       << "_sig;" << std::endl;
+			stream << "    end if;" << std::endl;
+			stream << "    completed_sig <= cmpl_buf;" << std::endl << std::endl;
 
-		size_t i = 0;
-		std::string seperator = "    ";
-		for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
-			DOMElement *exContentElem = *ecIter;
+			size_t i = 0;
+			std::string seperator = "    ";
+			for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+				DOMElement *exContentElem = *ecIter;
 
-			if (isSupportedExecContent(exContentElem)) {
+				if (isSupportedExecContent(exContentElem)) {
 
-				stream << seperator << "if start_" << toStr(i) << "_sig = '1' then"
-				       << std::endl;
+					stream << seperator << "if start_" << toStr(i) << "_sig = '1' then"
+					       << std::endl;
 
-				size_t jj = 0;
-				for (auto eventIter = _eventNames.begin(); eventIter != _eventNames.end(); eventIter++, jj++) {
-					if (((*eventIter)->value) == ATTR(exContentElem, kXMLCharEvent)) {
-						break;
+					size_t jj = 0;
+					for (auto eventIter = _eventNames.begin(); eventIter != _eventNames.end(); eventIter++, jj++) {
+						if (((*eventIter)->value) == ATTR(exContentElem, kXMLCharEvent)) {
+							break;
+						}
 					}
+					stream << "      event_bus <= \"" << toBinStr(jj, _eventBitSize + 1) << "\";" << std::endl;
+					stream << "      done_" << toStr(i) << "_sig <= '1';" << std::endl;
+					stream << "      event_we <= '1';" << std::endl;
+					seperator = "    els";
 				}
-				stream << "      event_bus <= \"" << toBinStr(jj, _eventBitSize + 1) << "\";" << std::endl;
-				stream << "      done_" << toStr(i) << "_sig <= '1';" << std::endl;
-				stream << "      event_we <= '1';" << std::endl;
-				seperator = "    els";
 			}
-		}
-		stream << "    elsif micro_stepper_en = '1' then" << std::endl;
-		i = 0;
-		//for (auto exContentElem : _execContent) {
-		for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
-			DOMElement *exContentElem = *ecIter;
-			if (isSupportedExecContent(exContentElem)) {
-				stream << "      done_" << toStr(i) << "_sig <= '0';" << std::endl;
+			stream << "    elsif micro_stepper_en = '1' then" << std::endl;
+			i = 0;
+			//for (auto exContentElem : _execContent) {
+			for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+				DOMElement *exContentElem = *ecIter;
+				if (isSupportedExecContent(exContentElem)) {
+					stream << "      done_" << toStr(i) << "_sig <= '0';" << std::endl;
+				}
 			}
-		}
-		stream << "      event_we <= '0';" << std::endl;
-		stream << "    end if;" << std::endl;
-		stream << "  end if;" << std::endl;
-		stream << "end process;" << std::endl;
-		stream << std::endl;
+			stream << "      event_we <= '0';" << std::endl;
+			stream << "    end if;" << std::endl;
+			stream << "  end if;" << std::endl;
+			stream << "end process;" << std::endl;
+			stream << std::endl;
 
-		i = 0;
-		for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
-			// start lines
-			stream << "start_" << toStr(i) << "_sig <= "
-			       << getLineForExecContent(*ecIter) << " and "
-			       << "not done_" << toStr(i) << "_sig";
-
-			// if not needed, since seq_0_sig is hard coded as '1'.
-//		if (i != 0) { // if not first element
-			stream << " and seq_" << toStr(i) << "_sig";
-//		}
+			i = 0;
+			for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+				// start lines
+				stream << "start_" << toStr(i) << "_sig <= "
+				       << getLineForExecContent(*ecIter) << " and "
+				       << "not done_" << toStr(i) << "_sig";
 
-			stream << ";" << std::endl;
+				// if not needed, since seq_0_sig is hard coded as '1'.
+	//		if (i != 0) { // if not first element
+				stream << " and seq_" << toStr(i) << "_sig";
+	//		}
 
-		}
+				stream << ";" << std::endl;
 
-		stream << "seq_0_sig <= '1';" << std::endl;
+			}
 
-		if (_execContent.size() > 1) {
-			i = 0;
-			for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
-				// prevent writing seq_0_sig since this should be hardcoded to '1'
-				if (i != 0) {
-					// seq lines (input if process i is in seqence now)
-					stream << "seq_" << toStr(i) << "_sig <= "
-					       << "done_" << toStr(i - 1) << "_sig or "
-					       << "( not "
-					       << getLineForExecContent(*ecIter);
-					stream << " and seq_" << toStr(i - 1) << "_sig";
-					stream << " );" << std::endl;
+			stream << "seq_0_sig <= '1';" << std::endl;
+
+			if (_execContent.size() > 1) {
+				i = 0;
+				for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+					// prevent writing seq_0_sig since this should be hardcoded to '1'
+					if (i != 0) {
+						// seq lines (input if process i is in seqence now)
+						stream << "seq_" << toStr(i) << "_sig <= "
+						       << "done_" << toStr(i - 1) << "_sig or "
+						       << "( not "
+						       << getLineForExecContent(*ecIter);
+						stream << " and seq_" << toStr(i - 1) << "_sig";
+						stream << " );" << std::endl;
+					}
 				}
 			}
+			stream << std::endl;
 		}
-		stream << std::endl;
 	}
 
 	stream << "end behavioral; " <<
@@ -935,6 +1036,82 @@ void ChartToVHDL::writeEventController(std::ostream &stream) {
 	       std::endl;
 }
 
+void ChartToVHDL::writeParallelExecContent(std::ostream &stream) {
+	// the events of all executable content in the microstep are written at
+	// once in document order, up to EVENT_PORTS of them per cycle
+	size_t eventWidth = _eventBitSize + 1;
+
+	stream << "-- parallel code block " << std::endl;
+	stream << "ex_content_block : process (clk, rst) " << std::endl;
+	stream << "  variable port_no : natural range 0 to EVENT_PORTS;" << std::endl;
+	stream << "begin" << std::endl;
+	stream << "  if rst = '1' then" << std::endl;
+	for (size_t i = 0; i < _execContent.size(); i++) {
+		stream << "    done_" << toStr(i) << "_sig <= '0';" << std::endl;
+	}
+	stream << "    event_bus <= (others => '0');" << std::endl;
+	stream << "    event_we <= (others => '0');" << std::endl;
+	stream << "    cmpl_buf <= '0';" << std::endl;
+	stream << "    completed_sig <= '0';" << std::endl;
+	stream << "  elsif rising_edge(clk) then" << std::endl;
+
+	stream << "    if micro_stepper_en = '1' then" << std::endl;
+	stream << "      cmpl_buf <= '0' ;" << std::endl;
+	stream << "    else" << std::endl;
+	stream << "      cmpl_buf <= all_done_sig;" << std::endl;
+	stream << "    end if;" << std::endl;
+	stream << "    completed_sig <= cmpl_buf;" << std::endl << std::endl;
+
+	stream << "    if micro_stepper_en = '1' then" << std::endl;
+	for (size_t i = 0; i < _execContent.size(); i++) {
+		stream << "      done_" << toStr(i) << "_sig <= '0';" << std::endl;
+	}
+	stream << "    end if;" << std::endl;
+	stream << std::endl;
+
+	stream << "    event_we <= (others => '0');" << std::endl;
+	stream << "    port_no := 0;" << std::endl;
+	size_t i = 0;
+	for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+		DOMElement *exContentElem = *ecIter;
+		if (!isSupportedExecContent(exContentElem))
+			continue;
+
+		size_t jj = 0;
+		for (auto eventIter = _eventNames.begin(); eventIter != _eventNames.end(); eventIter++, jj++) {
+			if (((*eventIter)->value) == ATTR(exContentElem, kXMLCharEvent)) {
+				break;
+			}
+		}
+		stream << "    if start_" << toStr(i) << "_sig = '1' and port_no < EVENT_PORTS then" << std::endl;
+		stream << "      event_bus((port_no + 1) * " << eventWidth << " - 1 downto port_no * " << eventWidth << ") <= \""
+		       << toBinStr(jj, eventWidth) << "\";" << std::endl;
+		stream << "      event_we(port_no) <= '1';" << std::endl;
+		stream << "      done_" << toStr(i) << "_sig <= '1';" << std::endl;
+		stream << "      port_no := port_no + 1;" << std::endl;
+		stream << "    end if;" << std::endl;
+	}
+	stream << "  end if;" << std::endl;
+	stream << "end process;" << std::endl;
+	stream << std::endl;
+
+	i = 0;
+	for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+		stream << "start_" << toStr(i) << "_sig <= "
+		       << getLineForExecContent(*ecIter) << " and "
+		       << "not done_" << toStr(i) << "_sig;" << std::endl;
+	}
+
+	stream << "all_done_sig <= '1'";
+	i = 0;
+	for (auto ecIter = _execContent.begin(); ecIter != _execContent.end(); ecIter++, i++) {
+		if (!isSupportedExecContent(*ecIter))
+			continue;
+		stream << std::endl << "      and (done_" << toStr(i) << "_sig or not " << getLineForExecContent(*ecIter) << ")";
+	}
+	stream << ";" << std::endl;
+	stream << std::endl;
+}
 
 void ChartToVHDL::writeConditionSolver(std::ostream &stream) {
 	// TODO implement
@@ -1064,13 +1241,16 @@ void ChartToVHDL::writeMicroStepper(std::ostream &stream) {
 	stream << "-- FSM Logic" << std::endl;
 	writeIncludes(stream);
 	stream << "entity micro_stepper is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"MULTICYCLE", "EVENT_PORTS", "FIFO_DEPTH"});
+	}
 	stream << "port(" << std::endl;
 	stream << "    --inputs" << std::endl;
 	stream << "    clk  :in    std_logic;" << std::endl;
 	stream << "    rst_i  :in    std_logic;" << std::endl;
 	stream << "    en   :in    std_logic;" << std::endl;
-	stream << "    next_event_i    :in  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
-	stream << "    next_event_we_i :in  std_logic;" << std::endl;
+	stream << "    next_event_i    :in  " << eventBusType() << ";" << std::endl;
+	stream << "    next_event_we_i :in  " << eventWriteType() << ";" << std::endl;
 
 	for (auto transition : _transitions) {
 		if (HAS_ATTR(transition, kXMLCharCond)) { // create enable line if transition has conditions
@@ -1134,6 +1314,9 @@ void ChartToVHDL::writeMicroStepper(std::ostream &stream) {
 	writeEntrySet(stream);
 	//writeDefaultCompletions(stream);
 	writeActiveStateNplusOne(stream);
+	if (_multicycle) {
+		writeMulticycleStages(stream);
+	}
 
 	// connect output signals
 	writeSystemSignalMapping(stream);
@@ -1151,15 +1334,19 @@ void ChartToVHDL::writeFiFo(std::ostream &stream) {
 	writeIncludes(stream);
 	stream << "" << std::endl;
 	stream << "entity std_fifo is" << std::endl;
-	stream << "generic (" << std::endl;
-	stream << "  constant FIFO_DEPTH  : positive := 256" << std::endl;
-	stream << ");" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"FIFO_DEPTH", "EVENT_PORTS"});
+	} else {
+		stream << "generic (" << std::endl;
+		stream << "  constant FIFO_DEPTH  : positive := 256" << std::endl;
+		stream << ");" << std::endl;
+	}
 	stream << "port ( " << std::endl;
 	stream << "  clk      : in  std_logic;" << std::endl;
 	stream << "  rst      : in  std_logic;" << std::endl;
-	stream << "  write_en  : in  std_logic;" << std::endl;
+	stream << "  write_en  : in  " << eventWriteType() << ";" << std::endl;
 	stream << "  read_en     : in  std_logic;" << std::endl;
-	stream << "  data_in     : in  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
+	stream << "  data_in     : in  " << eventBusType() << ";" << std::endl;
 	stream << "  data_out  : out std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
 	stream << "  empty       : out std_logic;" << std::endl;
 	stream << "  full        : out std_logic" << std::endl;
@@ -1206,21 +1393,43 @@ void ChartToVHDL::writeFiFo(std::ostream &stream) {
 	stream << "        end if;" << std::endl;
 	stream << "      end if;" << std::endl;
 	stream << "" << std::endl;
-	stream << "      if (write_en = '1') then" << std::endl;
-	stream << "        if ((Looped = false) or (Head /= Tail)) then" << std::endl;
-	stream << "          -- Write Data to Memory" << std::endl;
-	stream << "          Memory(Head) := data_in;" << std::endl;
-	stream << "          " << std::endl;
-	stream << "          -- Increment Head pointer as needed" << std::endl;
-	stream << "          if (Head = FIFO_DEPTH - 1) then" << std::endl;
-	stream << "            Head := 0;" << std::endl;
-	stream << "            " << std::endl;
-	stream << "            Looped := true;" << std::endl;
-	stream << "          else" << std::endl;
-	stream << "            Head := Head + 1;" << std::endl;
-	stream << "          end if;" << std::endl;
-	stream << "        end if;" << std::endl;
-	stream << "      end if;" << std::endl;
+	if (_multicycle) {
+		// all ports written in a cycle are queued in the order of the ports
+		stream << "      for i in 0 to EVENT_PORTS - 1 loop" << std::endl;
+		stream << "        if (write_en(i) = '1') then" << std::endl;
+		stream << "          if ((Looped = false) or (Head /= Tail)) then" << std::endl;
+		stream << "            -- Write Data to Memory" << std::endl;
+		stream << "            Memory(Head) := data_in((i + 1) * " << (_eventBitSize + 1) << " - 1 downto i * "
+		       << (_eventBitSize + 1) << ");" << std::endl;
+		stream << "            " << std::endl;
+		stream << "            -- Increment Head pointer as needed" << std::endl;
+		stream << "            if (Head = FIFO_DEPTH - 1) then" << std::endl;
+		stream << "              Head := 0;" << std::endl;
+		stream << "              " << std::endl;
+		stream << "              Looped := true;" << std::endl;
+		stream << "            else" << std::endl;
+		stream << "              Head := Head + 1;" << std::endl;
+		stream << "            end if;" << std::endl;
+		stream << "          end if;" << std::endl;
+		stream << "        end if;" << std::endl;
+		stream << "      end loop;" << std::endl;
+	} else {
+		stream << "      if (write_en = '1') then" << std::endl;
+		stream << "        if ((Looped = false) or (Head /= Tail)) then" << std::endl;
+		stream << "          -- Write Data to Memory" << std::endl;
+		stream << "          Memory(Head) := data_in;" << std::endl;
+		stream << "          " << std::endl;
+		stream << "          -- Increment Head pointer as needed" << std::endl;
+		stream << "          if (Head = FIFO_DEPTH - 1) then" << std::endl;
+		stream << "            Head := 0;" << std::endl;
+		stream << "            " << std::endl;
+		stream << "            Looped := true;" << std::endl;
+		stream << "          else" << std::endl;
+		stream << "            Head := Head + 1;" << std::endl;
+		stream << "          end if;" << std::endl;
+		stream << "        end if;" << std::endl;
+		stream << "      end if;" << std::endl;
+	}
 	stream << "" << std::endl;
 	stream << "      -- Update empty and full flags" << std::endl;
 	stream << "      if (Head = Tail) then" << std::endl;
@@ -1247,6 +1456,12 @@ void ChartToVHDL::writeSignalsAndComponents(std::ostream &stream) {
 	stream << "signal stall : std_logic;" << std::endl;
 	stream << "signal completed_sig : std_logic;" << std::endl;
 	stream << "signal rst : std_logic;" << std::endl;
+	if (_multicycle) {
+		stream << "signal hold : std_logic;" << std::endl;
+		stream << "signal step_stage : std_logic_vector( 3 downto 0);" << std::endl;
+		stream << "signal step_first : std_logic;" << std::endl;
+		stream << "signal step_commit : std_logic;" << std::endl;
+	}
 	stream << std::endl;
 
 	stream << "-- state signals" << std::endl;
@@ -1261,6 +1476,11 @@ void ChartToVHDL::writeSignalsAndComponents(std::ostream &stream) {
 		signalDecls.push_back("signal in_entry_set_" + ATTR(state, X("documentOrder")) + "_sig : std_logic;");
 		signalDecls.push_back("signal in_exit_set_" + ATTR(state, X("documentOrder")) + "_sig : std_logic;");
 		signalDecls.push_back("signal in_complete_entry_set_" + ATTR(state, X("documentOrder")) + "_sig : std_logic;");
+		if (_multicycle) {
+			signalDecls.push_back("signal in_entry_set_" + ATTR(state, X("documentOrder")) + "_reg : std_logic;");
+			signalDecls.push_back("signal in_exit_set_" + ATTR(state, X("documentOrder")) + "_reg : std_logic;");
+			signalDecls.push_back("signal in_complete_entry_set_" + ATTR(state, X("documentOrder")) + "_reg : std_logic;");
+		}
 
 		// not needed for <scxml> state
 		if (parent.size() != 0) {
@@ -1284,14 +1504,18 @@ void ChartToVHDL::writeSignalsAndComponents(std::ostream &stream) {
 	for (auto transition : _transitions) {
 		stream << "signal in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_sig : std_logic;"
 		       << std::endl;
+		if (_multicycle) {
+			stream << "signal in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_reg : std_logic;"
+			       << std::endl;
+		}
 	}
 	stream << std::endl;
 
 	stream << "-- event signals" << std::endl;
-	stream << "signal int_event_write_en : std_logic;" << std::endl;
+	stream << "signal int_event_write_en : " << eventWriteType() << ";" << std::endl;
 	stream << "signal int_event_read_en : std_logic;" << std::endl;
 	stream << "signal int_event_empty : std_logic;" << std::endl;
-	stream << "signal int_event_input : std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
+	stream << "signal int_event_input : " << eventBusType() << ";" << std::endl;
 	stream << "signal int_event_output : std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
 	stream << "signal next_event_re : std_logic;" << std::endl;
 	stream << "signal event_dequeued : std_logic;" << std::endl;
@@ -1313,12 +1537,15 @@ void ChartToVHDL::writeSignalsAndComponents(std::ostream &stream) {
 	// add components
 	stream << "-- event FIFO" << std::endl;
 	stream << "component std_fifo is" << std::endl;
+	if (_multicycle) {
+		writeGenerics(stream, {"FIFO_DEPTH", "EVENT_PORTS"});
+	}
 	stream << "port ( " << std::endl;
 	stream << "	clk		: in  std_logic;" << std::endl;
 	stream << "	rst		: in  std_logic;" << std::endl;
-	stream << "	write_en	: in  std_logic;" << std::endl;
+	stream << "	write_en	: in  " << eventWriteType() << ";" << std::endl;
 	stream << "	read_en         : in  std_logic;" << std::endl;
-	stream << "	data_in         : in  std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
+	stream << "	data_in         : in  " << eventBusType() << ";" << std::endl;
 	stream << "	data_out	: out std_logic_vector( " << _eventBitSize << " downto 0);" << std::endl;
 	stream << "	empty           : out std_logic;" << std::endl;
 	stream << "	full            : out std_logic" << std::endl; // we calculate how much we need
@@ -1330,6 +1557,9 @@ void ChartToVHDL::writeSignalsAndComponents(std::ostream &stream) {
 void ChartToVHDL::writeModuleInstantiation(std::ostream &stream) {
 	// instantiate event fifo
 	stream << "int_event_fifo : component std_fifo " << std::endl;
+	if (_multicycle) {
+		writeGenericMap(stream, {"FIFO_DEPTH", "EVENT_PORTS"});
+	}
 	stream << "port map ( " << std::endl;
 	stream << "	clk         => clk," << std::endl;
 	stream << "	rst         => rst_i," << std::endl;
@@ -1400,7 +1630,12 @@ void ChartToVHDL::writeInternalEventHandler(std::ostream &stream) {
 	stream << "        event_dequeued <= '0';" << std::endl;
 	stream << "        event_consumed <= '0';" << std::endl;
 
-	stream << "    elsif falling_edge(clk) and stall = '0' then" << std::endl;
+	if (_multicycle) {
+		// the next event is taken while the selection stage is active
+		stream << "    elsif falling_edge(clk) and hold = '0' and step_first = '1' then" << std::endl;
+	} else {
+		stream << "    elsif falling_edge(clk) and stall = '0' then" << std::endl;
+	}
 
 	VContainer eventConsumed = VOR;
 	for (auto transition : _transitions) {
@@ -1479,8 +1714,8 @@ void ChartToVHDL::writeActiveStateNplusOne(std::ostream &stream) {
 		VBranch *tree = (VASSIGN,
 		                 VLINE("state_next_" + ATTR(state, X("documentOrder")) + "_sig"),
 		                 (VOR,
-		                  VLINE("in_complete_entry_set_" + ATTR(state, X("documentOrder")) + "_sig"),
-		                  (VAND, (VNOT, VLINE("in_exit_set_" + ATTR(state, X("documentOrder")) + "_sig")),
+		                  VLINE(stageSignal("in_complete_entry_set_" + ATTR(state, X("documentOrder")))),
+		                  (VAND, (VNOT, VLINE(stageSignal("in_exit_set_" + ATTR(state, X("documentOrder"))))),
 		                   VLINE("state_active_" + ATTR(state, X("documentOrder")) + "_sig"))
 		                 ));
 
@@ -1581,7 +1816,7 @@ void ChartToVHDL::writeExitSet(std::ostream &stream) {
 		for (auto transition : _transitions) {
 			std::string exitSet = ATTR(transition, X("exitSetBools"));
 			if (exitSet.at(strTo<size_t>(ATTR(state, X("documentOrder")))) == '1') {
-				*exitsetters += VLINE("in_optimal_transition_set_" + ATTR(transition, X("postFixOrder")) + "_sig ");
+				*exitsetters += VLINE(stageSignal("in_optimal_transition_set_" + ATTR(transition, X("postFixOrder"))) + " ");
 			}
 		}
 
@@ -1605,7 +1840,7 @@ void ChartToVHDL::writeEntrySet(std::ostream &stream) {
 		                 VLINE("in_entry_set_" + ATTR(state, X("documentOrder")) + "_sig"),
 		                 (VAND,
 		                  VLINE("in_complete_entry_set_" + ATTR(state, X("documentOrder")) + "_sig"),
-		                  (VOR, VLINE("in_exit_set_" + ATTR(state, X("documentOrder")) + "_sig"),
+		                  (VOR, VLINE(stageSignal("in_exit_set_" + ATTR(state, X("documentOrder")))),
 		                   (VNOT, VLINE("state_active_" + ATTR(state, X("documentOrder")) + "_sig")))));
 
 		tree->print(stream);
@@ -1635,7 +1870,7 @@ void ChartToVHDL::writeCompleteEntrySet(std::ostream &stream) {
 			if (targetSet[strTo<size_t>(ATTR(state, X("documentOrder")))] == '1') {
 				//yes? then add the transition to optimal entry set of the state
 				*optimalEntrysetters +=
-				    VLINE("in_optimal_transition_set_" + ATTR(transition, X("postFixOrder")) + "_sig");
+				    VLINE(stageSignal("in_optimal_transition_set_" + ATTR(transition, X("postFixOrder"))));
 			}
 		}
 
@@ -1700,8 +1935,7 @@ void ChartToVHDL::writeCompleteEntrySet(std::ostream &stream) {
 						                          (VAND,
 						                           VLINE("state_active_" + ATTR(tmp_state, X("documentOrder")) + "_sig"),
 						                           (VNOT,
-						                            VLINE("in_exit_set_" + ATTR(tmp_state, X("documentOrder")) +
-						                                  "_sig"))));
+						                            VLINE(stageSignal("in_exit_set_" + ATTR(tmp_state, X("documentOrder")))))));
 					}
 				}
 			} else {
@@ -1753,6 +1987,74 @@ void ChartToVHDL::writeStateHandler(std::ostream &stream) {
 	stream << std::endl;
 }
 
+void ChartToVHDL::writeMulticycleStages(std::ostream &stream) {
+	// a microstep takes four cycles: selection, exit set, entry sets and the
+	// commit of the next configuration, each stage reads the registers of the
+	// one before. The next microstep only starts after the commit, so this is
+	// a multicycle stepper and not a pipeline.
+	stream << "-- multicycle microstep, one microstep every four cycles" << std::endl;
+	stream << "multicycle_stages : if MULTICYCLE generate" << std::endl;
+	stream << "  stage_proc : process (clk, rst)" << std::endl;
+	stream << "  begin" << std::endl;
+	stream << "    if rst = '1' then" << std::endl;
+	stream << "      step_stage <= \"0001\";" << std::endl;
+	for (auto transition : _transitions) {
+		stream << "      in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_reg <= '0';" << std::endl;
+	}
+	for (auto state : _states) {
+		stream << "      in_exit_set_" << ATTR(state, X("documentOrder")) << "_reg <= '0';" << std::endl;
+		stream << "      in_complete_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= '0';" << std::endl;
+		stream << "      in_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= '0';" << std::endl;
+	}
+	stream << "    elsif rising_edge(clk) and hold = '0' then" << std::endl;
+	stream << "      step_stage <= step_stage(2 downto 0) & step_stage(3);" << std::endl;
+	stream << "      if step_stage(0) = '1' then" << std::endl;
+	for (auto transition : _transitions) {
+		stream << "        in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_reg <= "
+		       << "in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_sig;" << std::endl;
+	}
+	stream << "      end if;" << std::endl;
+	stream << "      if step_stage(1) = '1' then" << std::endl;
+	for (auto state : _states) {
+		stream << "        in_exit_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_exit_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+	}
+	stream << "      end if;" << std::endl;
+	stream << "      if step_stage(2) = '1' then" << std::endl;
+	for (auto state : _states) {
+		stream << "        in_complete_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_complete_entry_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+		stream << "        in_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_entry_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+	}
+	stream << "      end if;" << std::endl;
+	stream << "    end if;" << std::endl;
+	stream << "  end process;" << std::endl;
+	stream << "  step_first <= step_stage(0);" << std::endl;
+	stream << "  step_commit <= step_stage(3);" << std::endl;
+	stream << "end generate;" << std::endl;
+	stream << std::endl;
+
+	stream << "combinational_stages : if not MULTICYCLE generate" << std::endl;
+	for (auto transition : _transitions) {
+		stream << "  in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_reg <= "
+		       << "in_optimal_transition_set_" << ATTR(transition, X("postFixOrder")) << "_sig;" << std::endl;
+	}
+	for (auto state : _states) {
+		stream << "  in_exit_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_exit_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+		stream << "  in_complete_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_complete_entry_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+		stream << "  in_entry_set_" << ATTR(state, X("documentOrder")) << "_reg <= "
+		       << "in_entry_set_" << ATTR(state, X("documentOrder")) << "_sig;" << std::endl;
+	}
+	stream << "  step_stage <= (others => '1');" << std::endl;
+	stream << "  step_first <= '1';" << std::endl;
+	stream << "  step_commit <= '1';" << std::endl;
+	stream << "end generate;" << std::endl;
+	stream << std::endl;
+}
+
 void ChartToVHDL::writeSystemSignalMapping(std::ostream &stream) {
 	stream << "-- system signals" << std::endl;
 	std::list<DOMElement *> topLevelFinal = DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "final",
@@ -1778,8 +2080,15 @@ void ChartToVHDL::writeSystemSignalMapping(std::ostream &stream) {
 //	stream << "        stall <= '0';" << std::endl;
 //	stream << "    elsif rising_edge(clk) then" << std::endl;
 	// empty queue as stall source can arise some issues with state charts just based on spontaneous transitions
-	stream << "        stall <= not en or completed_sig ; --or ( int_event_empty and not spontaneous_en); " <<
-	       std::endl;
+	if (_multicycle) {
+		// the configuration is only updated in the commit stage
+		stream << "        hold <= not en or completed_sig ; --or ( int_event_empty and not spontaneous_en); " <<
+		       std::endl;
+		stream << "        stall <= hold or not step_commit ;" << std::endl;
+	} else {
+		stream << "        stall <= not en or completed_sig ; --or ( int_event_empty and not spontaneous_en); " <<
+		       std::endl;
+	}
 //	stream << "    end if;" << std::endl;
 //	stream << "end process;" << std::endl;
 //	stream << std::endl;
@@ -1792,22 +2101,22 @@ void ChartToVHDL::writeSystemSignalMapping(std::ostream &stream) {
 		       << "_sig;" << std::endl;
 		if (DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "onexit", state).size() > 0) {
 			stream << "exit_set_" << ATTR(state, X("documentOrder"))
-			       << "_o <= in_exit_set_" << ATTR(state, X("documentOrder"))
-			       << "_sig;" << std::endl;
+			       << "_o <= " << stageSignal("in_exit_set_" + ATTR(state, X("documentOrder")))
+			       << (_multicycle ? " and step_commit" : "") << ";" << std::endl;
 		}
 
 		if (DOMUtils::filterChildElements(XML_PREFIX(_scxml).str() + "onentry", state).size() > 0) {
 			stream << "entry_set_" << ATTR(state, X("documentOrder"))
-			       << "_o <= in_entry_set_" << ATTR(state, X("documentOrder"))
-			       << "_sig;" << std::endl;
+			       << "_o <= " << stageSignal("in_entry_set_" + ATTR(state, X("documentOrder")))
+			       << (_multicycle ? " and step_commit" : "") << ";" << std::endl;
 		}
 	}
 
 	for (auto transition : _transitions) {
 		if (DOMUtils::filterChildType(DOMNode::ELEMENT_NODE, transition).size() > 0) {
 			stream << "transition_set_" << ATTR(transition, X("postFixOrder"))
-			       << "_o <= in_optimal_transition_set_" << ATTR(transition, X("postFixOrder"))
-			       << "_sig;" << std::endl;
+			       << "_o <= " << stageSignal("in_optimal_transition_set_" + ATTR(transition, X("postFixOrder")))
+			       << (_multicycle ? " and step_commit" : "") << ";" << std::endl;
 		}
 	}
 
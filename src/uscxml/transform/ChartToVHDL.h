@@ -177,6 +177,8 @@ protected:
 
 	void writeEventController(std::ostream &stream);
 
+	void writeParallelExecContent(std::ostream &stream);
+
 	void writeConditionSolver(std::ostream &stream);
 
 	void writeMicroStepper(std::ostream &stream);
@@ -214,12 +216,26 @@ protected:
 
 	void writeErrorHandler(std::ostream &stream);
 
+	// multicycle microstep, one stage per cycle
+	void writeMulticycleStages(std::ostream &stream);
+
+	void writeGenerics(std::ostream &stream, const std::list<std::string> &generics, const std::string &padding = "");
+
+	void writeGenericMap(std::ostream &stream, const std::list<std::string> &generics, const std::string &padding = "");
+
+	std::string stageSignal(const std::string &name);
+
+	std::string eventBusType();
+
+	std::string eventWriteType();
+
 
 	Trie _eventTrie;
 	std::list<TrieNode *> _eventNames;
 	size_t _eventBitSize = 0;
 	std::map<std::string, std::string> _eventsOnBus;
 	std::list<XERCESC_NS::DOMElement *> _execContent;
+	bool _multicycle = false; ///< a microstep in four registered cycles and several event ports
 
 private:
 	std::string getLineForExecContent(const XERCESC_NS::DOMNode *elem);
@@ -0,0 +1,877 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#include "NativeMicroStep.h"
+#include "ChartToC.h"
+
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/MD5.hpp"
+#include "uscxml/util/String.h"
+#include "uscxml/util/URL.h"
+#include "uscxml/util/UUID.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/interpreter/InterpreterMonitor.h"
+#include "uscxml/interpreter/Logging.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// same as in the generated code and FastMicroStep
+#define USCXML_CTX_PRISTINE           0x00
+#define USCXML_CTX_INITIALIZED        0x02
+#define USCXML_CTX_TOP_LEVEL_FINAL    0x04
+#define USCXML_CTX_FINISHED           0x10
+
+#define USCXML_ERR_OK                0
+#define USCXML_ERR_IDLE              1
+#define USCXML_ERR_DONE              2
+
+#define NATIVE_CONFIG                0
+#define NATIVE_HISTORY               1
+#define NATIVE_INVOCATIONS           2
+#define NATIVE_INITIALIZED_DATA      3
+
+#define NATIVE_BIT_HAS(idx, bitset) ((bitset[idx >> 3] & (1 << (idx & 7))) != 0)
+
+namespace uscxml {
+
+using namespace XERCESC_NS;
+
+/**
+ * Compiled before the generated machine: the host ABI and the macros to
+ * hook the step function, executable content is processed by the host.
+ */
+static const char* nativePrelude =
+    "#include <stdlib.h>\n"
+    "\n"
+    "typedef struct uscxml_native_host {\n"
+    "    void* host;\n"
+    "    void* (*dequeue_internal)(void* host);\n"
+    "    void* (*dequeue_external)(void* host);\n"
+    "    int (*is_matched)(void* host, const void* event, const char* descriptor);\n"
+    "    const char* (*event_name)(void* host, const void* event);\n"
+    "    int (*is_true)(void* host, const char* expr);\n"
+    "    int (*on_entry)(void* host, unsigned int state);\n"
+    "    int (*on_exit)(void* host, unsigned int state);\n"
+    "    int (*on_transition)(void* host, unsigned int transition);\n"
+    "    int (*init_data)(void* host, unsigned int state);\n"
+    "    int (*invoke)(void* host, unsigned int state, int uninvoke);\n"
+    "    int (*raise_done_event)(void* host, unsigned int state, int final_state);\n"
+    "} uscxml_native_host;\n"
+    "\n"
+    "typedef struct uscxml_native_machine {\n"
+    "    unsigned int abi_version;\n"
+    "    unsigned int nr_states;\n"
+    "    unsigned int nr_transitions;\n"
+    "    const char* (*state_name)(unsigned int state);\n"
+    "    unsigned int (*transition_source)(unsigned int transition);\n"
+    "    const char* (*transition_event)(unsigned int transition);\n"
+    "    const char* (*transition_condition)(unsigned int transition);\n"
+    "    void* (*create)(const uscxml_native_host* host);\n"
+    "    void (*destroy)(void* ctx);\n"
+    "    int (*step)(void* ctx);\n"
+    "    unsigned char* (*flags)(void* ctx);\n"
+    "    unsigned char* (*bitset)(void* ctx, int which);\n"
+    "} uscxml_native_machine;\n"
+    "\n"
+    "#define USCXML_NATIVE_HOST(ctx) ((const uscxml_native_host*)(ctx)->user_data)\n"
+    "#define USCXML_ON_ENTRY(i) USCXML_NATIVE_HOST(ctx)->on_entry(USCXML_NATIVE_HOST(ctx)->host, i)\n"
+    "#define USCXML_ON_EXIT(i) USCXML_NATIVE_HOST(ctx)->on_exit(USCXML_NATIVE_HOST(ctx)->host, i)\n"
+    "#define USCXML_ON_TRANS(i, state) USCXML_NATIVE_HOST(ctx)->on_transition(USCXML_NATIVE_HOST(ctx)->host, i)\n"
+    "#define USCXML_INVOKE(i, uninvoke) USCXML_NATIVE_HOST(ctx)->invoke(USCXML_NATIVE_HOST(ctx)->host, i, uninvoke)\n"
+    "#define USCXML_INIT_DATA(i) USCXML_NATIVE_HOST(ctx)->init_data(USCXML_NATIVE_HOST(ctx)->host, i)\n"
+    "#define USCXML_ON_SCRIPT() USCXML_ERR_OK /* global scripts are the on entry content of the scxml state */\n"
+    "\n";
+
+/**
+ * Compiled after the generated machine: adapts the callbacks of the
+ * generated context and exports the machine to the host.
+ */
+static const char* nativeEpilogue =
+    "\n"
+    "static void* uscxml_native_dequeue_internal(const uscxml_ctx* ctx) {\n"
+    "    return USCXML_NATIVE_HOST(ctx)->dequeue_internal(USCXML_NATIVE_HOST(ctx)->host);\n"
+    "}\n"
+    "\n"
+    "static void* uscxml_native_dequeue_external(const uscxml_ctx* ctx) {\n"
+    "    return USCXML_NATIVE_HOST(ctx)->dequeue_external(USCXML_NATIVE_HOST(ctx)->host);\n"
+    "}\n"
+    "\n"
+    "static int uscxml_native_is_matched(const uscxml_ctx* ctx, const uscxml_transition* transition, const void* event) {\n"
+    "    return USCXML_NATIVE_HOST(ctx)->is_matched(USCXML_NATIVE_HOST(ctx)->host, event, transition->event);\n"
+    "}\n"
+    "\n"
+    "static int uscxml_native_event_id(const uscxml_ctx* ctx, const void* event) {\n"
+    "    return uscxml_event_id(ctx->machine, USCXML_NATIVE_HOST(ctx)->event_name(USCXML_NATIVE_HOST(ctx)->host, event));\n"
+    "}\n"
+    "\n"
+    "static int uscxml_native_is_true(const uscxml_ctx* ctx, const char* expr) {\n"
+    "    return USCXML_NATIVE_HOST(ctx)->is_true(USCXML_NATIVE_HOST(ctx)->host, expr);\n"
+    "}\n"
+    "\n"
+    "static int uscxml_native_raise_done_event(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata) {\n"
+    "    return USCXML_NATIVE_HOST(ctx)->raise_done_event(USCXML_NATIVE_HOST(ctx)->host,\n"
+    "                                                     (unsigned int)(state - ctx->machine->states),\n"
+    "                                                     (donedata != NULL ? (int)donedata->source : -1));\n"
+    "}\n"
+    "\n"
+    "static const char* uscxml_native_state_name(unsigned int state) {\n"
+    "    return USCXML_MACHINE.states[state].name;\n"
+    "}\n"
+    "\n"
+    "static unsigned int uscxml_native_transition_source(unsigned int transition) {\n"
+    "    return USCXML_MACHINE.transitions[transition].source;\n"
+    "}\n"
+    "\n"
+    "static const char* uscxml_native_transition_event(unsigned int transition) {\n"
+    "    return USCXML_MACHINE.transitions[transition].event;\n"
+    "}\n"
+    "\n"
+    "static const char* uscxml_native_transition_condition(unsigned int transition) {\n"
+    "    return USCXML_MACHINE.transitions[transition].condition;\n"
+    "}\n"
+    "\n"
+    "static void* uscxml_native_create(const uscxml_native_host* host) {\n"
+    "    uscxml_ctx* ctx = (uscxml_ctx*)calloc(1, sizeof(uscxml_ctx));\n"
+    "    if (ctx == NULL)\n"
+    "        return NULL;\n"
+    "    ctx->machine = &USCXML_MACHINE;\n"
+    "    ctx->user_data = (void*)host;\n"
+    "    ctx->dequeue_internal = uscxml_native_dequeue_internal;\n"
+    "    ctx->dequeue_external = uscxml_native_dequeue_external;\n"
+    "    ctx->is_matched = uscxml_native_is_matched;\n"
+    "    ctx->event_id = uscxml_native_event_id;\n"
+    "    ctx->is_true = uscxml_native_is_true;\n"
+    "    ctx->raise_done_event = uscxml_native_raise_done_event;\n"
+    "    return ctx;\n"
+    "}\n"
+    "\n"
+    "static void uscxml_native_destroy(void* ctx) {\n"
+    "    free(ctx);\n"
+    "}\n"
+    "\n"
+    "static int uscxml_native_step(void* ctx) {\n"
+    "    return uscxml_step((uscxml_ctx*)ctx);\n"
+    "}\n"
+    "\n"
+    "static unsigned char* uscxml_native_flags(void* ctx) {\n"
+    "    return &((uscxml_ctx*)ctx)->flags;\n"
+    "}\n"
+    "\n"
+    "static unsigned char* uscxml_native_bitset(void* ctx, int which) {\n"
+    "    switch (which) {\n"
+    "    case 0: return ((uscxml_ctx*)ctx)->config;\n"
+    "    case 1: return ((uscxml_ctx*)ctx)->history;\n"
+    "    case 2: return ((uscxml_ctx*)ctx)->invocations;\n"
+    "    default: return ((uscxml_ctx*)ctx)->initialized_data;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "#ifdef __GNUC__\n"
+    "__attribute__((visibility(\"default\")))\n"
+    "#endif\n"
+    "int uscxml_native_init(uscxml_native_machine* native) {\n"
+    "    native->abi_version = USCXML_NATIVE_ABI_VERSION;\n"
+    "    native->nr_states = USCXML_MACHINE.nr_states;\n"
+    "    native->nr_transitions = USCXML_MACHINE.nr_transitions;\n"
+    "    native->state_name = uscxml_native_state_name;\n"
+    "    native->transition_source = uscxml_native_transition_source;\n"
+    "    native->transition_event = uscxml_native_transition_event;\n"
+    "    native->transition_condition = uscxml_native_transition_condition;\n"
+    "    native->create = uscxml_native_create;\n"
+    "    native->destroy = uscxml_native_destroy;\n"
+    "    native->step = uscxml_native_step;\n"
+    "    native->flags = uscxml_native_flags;\n"
+    "    native->bitset = uscxml_native_bitset;\n"
+    "    return 0;\n"
+    "}\n";
+
+NativeMicroStep::NativeMicroStep(MicroStepCallbacks* callbacks)
+	: FastMicroStep(callbacks),
+	  _library(NULL),
+	  _ctx(NULL),
+	  _blockMs(0),
+	  _isStable(false),
+	  _isMacroStepped(false),
+	  _isMicroStepping(false),
+	  _isCompleting(false),
+	  _enteringState(-1) {
+
+	memset(&_machine, 0, sizeof(uscxml_native_machine));
+
+	_host.host = this;
+	_host.dequeue_internal = nativeDequeueInternal;
+	_host.dequeue_external = nativeDequeueExternal;
+	_host.is_matched = nativeIsMatched;
+	_host.event_name = nativeEventName;
+	_host.is_true = nativeIsTrue;
+	_host.on_entry = nativeOnEntry;
+	_host.on_exit = nativeOnExit;
+	_host.on_transition = nativeOnTransition;
+	_host.init_data = nativeInitData;
+	_host.invoke = nativeInvoke;
+	_host.raise_done_event = nativeRaiseDoneEvent;
+}
+
+NativeMicroStep::~NativeMicroStep() {
+	unload();
+}
+
+std::shared_ptr<MicroStepImpl> NativeMicroStep::create(MicroStepCallbacks* callbacks) {
+	return std::shared_ptr<MicroStepImpl>(new NativeMicroStep(callbacks));
+}
+
+void NativeMicroStep::init(XERCESC_NS::DOMElement* scxml) {
+	FastMicroStep::init(scxml);
+	unload();
+
+#ifndef _WIN32
+	if (HAS_ATTR(scxml, kXMLCharDataModel) && ATTR(scxml, kXMLCharDataModel) == "native") {
+		// conditions would be compiled as C
+		return;
+	}
+
+	std::string sharedObject = compile(scxml);
+	if (sharedObject.length() == 0 || !load(sharedObject))
+		return;
+
+	if (!matchesChart()) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Native machine in " << sharedObject << " does not match the chart, using FastMicroStep";
+		unload();
+	}
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * Whether path is a directory or regular file of ours that nobody else can
+ * write to, we would load whatever another user places there otherwise.
+ */
+static bool isPrivate(const std::string& path, bool isDirectory) {
+	struct stat st;
+	if (lstat(path.c_str(), &st) != 0)
+		return false;
+	if (isDirectory ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode))
+		return false;
+	if (st.st_uid != geteuid())
+		return false;
+	return (st.st_mode & (isDirectory ? (S_IRWXG | S_IRWXO) : (S_IWGRP | S_IWOTH))) == 0;
+}
+
+/**
+ * The directory with the compiled machines of the current user, created
+ * with mode 0700 in the temporary directory.
+ */
+static std::string nativeCacheDir() {
+	std::string tmpPrefix = "/tmp";
+	const char* tmpEnv = getenv("TMPDIR");
+	if (tmpEnv != NULL && strlen(tmpEnv) > 0)
+		tmpPrefix = tmpEnv;
+
+	if (tmpPrefix[tmpPrefix.size() - 1] != PATH_SEPERATOR)
+		tmpPrefix += PATH_SEPERATOR;
+
+	std::string cacheDir = tmpPrefix + "uscxml-native." + toStr(geteuid());
+	if (mkdir(cacheDir.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+		return "";
+	if (!isPrivate(cacheDir, true))
+		return "";
+	return cacheDir;
+}
+
+/**
+ * Run the compiler with the given arguments and wait for it, stdout and
+ * stderr go to logFile. There is no shell to interpret the paths.
+ */
+static bool runCompiler(const std::vector<std::string>& args, const std::string& logFile) {
+	std::vector<char*> argv;
+	for (auto& arg : args)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(NULL);
+
+	pid_t pid = fork();
+	if (pid < 0)
+		return false;
+
+	if (pid == 0) {
+		// only async-signal-safe calls in the child
+		int fd = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			_exit(127);
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+		execvp(argv[0], &argv[0]);
+		_exit(127);
+	}
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Append the charts invoked via src with everything they invoke in turn,
+ * ChartToC compiles them into the same object.
+ */
+static void appendChildCharts(DOMElement* scxml, const URL& baseURL, std::set<std::string>& visited, std::ostream& charts) {
+	std::list<DOMElement*> invokes = DOMUtils::filterChildElements(XML_PREFIX(scxml).str() + "invoke", scxml, true);
+	for (auto invoke : invokes) {
+		if (!HAS_ATTR(invoke, kXMLCharSource))
+			continue;
+
+		if (HAS_ATTR(invoke, kXMLCharType) &&
+		        ATTR(invoke, kXMLCharType) != "scxml" &&
+		        ATTR(invoke, kXMLCharType) != "http://www.w3.org/TR/scxml/")
+			continue;
+
+		URL srcURL(ATTR(invoke, kXMLCharSource));
+		if (!srcURL.isAbsolute())
+			srcURL = URL::resolve(srcURL, baseURL);
+		std::string resolved = srcURL;
+		charts << resolved << std::endl;
+		if (visited.find(resolved) != visited.end())
+			continue;
+		visited.insert(resolved);
+
+		Interpreter child = Interpreter::fromURL(resolved);
+		DOMDocument* document = child.getImpl()->getDocument();
+		charts << *document << std::endl;
+		appendChildCharts(document->getDocumentElement(), srcURL, visited, charts);
+	}
+}
+#endif
+
+std::string NativeMicroStep::compile(XERCESC_NS::DOMElement* scxml) {
+#ifndef _WIN32
+	std::stringstream ss;
+	ss << *scxml->getOwnerDocument();
+	std::string xml = ss.str();
+
+	std::string cacheDir = nativeCacheDir();
+	if (cacheDir.length() == 0) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "No private directory for native machines, using FastMicroStep";
+		return "";
+	}
+
+	// CC might carry a launcher or flags of its own, e.g. "ccache gcc"
+	const char* cc = getenv("CC");
+	std::list<std::string> ccArgs = tokenize((cc != NULL && strlen(cc) > 0 ? cc : "cc"), ' ', true);
+	std::vector<std::string> args(ccArgs.begin(), ccArgs.end());
+	if (args.size() == 0)
+		args.push_back("cc");
+	std::string compiler = args.front();
+	args.push_back("-O2");
+	args.push_back("-fPIC");
+	args.push_back("-shared");
+	args.push_back("-fvisibility=hidden");
+	args.push_back("-w");
+
+	// relative src attributes are resolved against the document of the session
+	std::string baseURL = _callbacks->getInterpreter().getImpl()->getBaseURL();
+
+	std::stringstream key;
+	key << xml << std::endl;
+	try {
+		std::set<std::string> visited;
+		appendChildCharts(scxml, URL(baseURL), visited, key);
+	} catch (Event e) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot load invoked chart, using FastMicroStep" << std::endl << e;
+		return "";
+	}
+	key << USCXML_VERSION << std::endl << USCXML_NATIVE_ABI_VERSION << std::endl;
+	for (auto& arg : args)
+		key << arg << std::endl;
+
+	std::string basePath = cacheDir + PATH_SEPERATOR + md5(key.str());
+	std::string sharedObject = basePath + ".uscxml.so";
+
+	// compiled by an earlier session
+	if (isPrivate(sharedObject, false))
+		return sharedObject;
+
+	std::string sourceFile = basePath + ".uscxml.c";
+	try {
+		// the transformation annotates the DOM, work on a copy
+		Transformer transformer = ChartToC::transform(Interpreter::fromXML(xml, baseURL));
+
+		std::multimap<std::string, std::string> extensions;
+		extensions.insert(std::make_pair("bitset", "words"));
+		transformer.setExtensions(extensions);
+
+		std::ofstream source(sourceFile.c_str());
+		source << "#define USCXML_NATIVE_ABI_VERSION " << USCXML_NATIVE_ABI_VERSION << std::endl;
+		source << nativePrelude;
+		transformer.writeTo(source);
+		source << nativeEpilogue;
+		source.close();
+		if (!source) {
+			LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot write " << sourceFile << ", using FastMicroStep";
+			return "";
+		}
+	} catch (Event e) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot transform chart to C, using FastMicroStep" << std::endl << e;
+		return "";
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot transform chart to C, using FastMicroStep";
+		return "";
+	}
+
+	// compile aside and move in place, other sessions might load it already
+	std::string partialObject = basePath + "." + UUID::getUUID() + ".so";
+	std::string logFile = basePath + ".uscxml.log";
+	args.push_back("-o");
+	args.push_back(partialObject);
+	args.push_back(sourceFile);
+
+	if (!runCompiler(args, logFile)) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot compile chart with '" << compiler << "', see " << logFile << ", using FastMicroStep";
+		remove(partialObject.c_str());
+		return "";
+	}
+
+	if (rename(partialObject.c_str(), sharedObject.c_str()) != 0) {
+		remove(partialObject.c_str());
+		if (!isPrivate(sharedObject, false))
+			return "";
+	}
+
+	remove(logFile.c_str());
+	return sharedObject;
+#else
+	return "";
+#endif
+}
+
+bool NativeMicroStep::load(const std::string& sharedObject) {
+#ifndef _WIN32
+	if (!isPrivate(sharedObject, false)) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Not loading " << sharedObject << " as others could have written it, using FastMicroStep";
+		return false;
+	}
+
+	_library = dlopen(sharedObject.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (_library == NULL) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "Cannot load " << sharedObject << ": " << dlerror() << ", using FastMicroStep";
+		return false;
+	}
+
+	uscxml_native_init_t nativeInit = (uscxml_native_init_t)dlsym(_library, "uscxml_native_init");
+	if (nativeInit == NULL || nativeInit(&_machine) != 0 || _machine.abi_version != USCXML_NATIVE_ABI_VERSION) {
+		LOG(_callbacks->getLogger(), USCXML_WARN) << "No native machine in " << sharedObject << ", using FastMicroStep";
+		unload();
+		return false;
+	}
+
+	_ctx = _machine.create(&_host);
+	if (_ctx == NULL) {
+		unload();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool NativeMicroStep::matchesChart() {
+	// the state and transition indices have to be the same as ours
+	if (_machine.nr_states != _states.size() || _machine.nr_transitions != _transitions.size())
+		return false;
+
+	for (size_t i = 0; i < _states.size(); i++) {
+		const char* name = _machine.state_name(i);
+		if ((name != NULL ? name : "") != (HAS_ATTR(_states[i]->element, kXMLCharId) ? ATTR(_states[i]->element, kXMLCharId) : ""))
+			return false;
+	}
+
+	for (size_t i = 0; i < _transitions.size(); i++) {
+		const char* event = _machine.transition_event(i);
+		const char* cond = _machine.transition_condition(i);
+		if (_machine.transition_source(i) != _transitions[i]->source ||
+		        (event != NULL ? event : "") != _transitions[i]->event ||
+		        (cond != NULL ? cond : "") != _transitions[i]->cond)
+			return false;
+	}
+	return true;
+}
+
+void NativeMicroStep::unload() {
+	if (_ctx != NULL)
+		_machine.destroy(_ctx);
+	_ctx = NULL;
+
+#ifndef _WIN32
+	if (_library != NULL)
+		dlclose(_library);
+#endif
+	_library = NULL;
+}
+
+InterpreterState NativeMicroStep::step(size_t blockMs) {
+	if (_ctx == NULL)
+		return FastMicroStep::step(blockMs);
+
+	unsigned char* flags = _machine.flags(_ctx);
+	if (*flags & USCXML_CTX_FINISHED)
+		return USCXML_FINISHED;
+
+	_blockMs = blockMs;
+	_isMacroStepped = false;
+	_isMicroStepping = false;
+
+	if (*flags & USCXML_CTX_TOP_LEVEL_FINAL) {
+		USCXML_MONITOR_CALLBACK(_callbacks->getMonitors(), beforeCompletion);
+		_isCompleting = true;
+		_machine.step(_ctx);
+		_isCompleting = false;
+		USCXML_MONITOR_CALLBACK(_callbacks->getMonitors(), afterCompletion);
+		return USCXML_FINISHED;
+	}
+
+	int err = _machine.step(_ctx);
+	switch (err) {
+	case USCXML_ERR_OK:
+		if (_isMicroStepping)
+			USCXML_MONITOR_CALLBACK(_callbacks->getMonitors(), afterMicroStep);
+		return USCXML_MICROSTEPPED;
+
+	case USCXML_ERR_IDLE:
+		if (_isMacroStepped)
+			return USCXML_MACROSTEPPED;
+		if (_isCancelled) {
+			// finalize and exit
+			*flags |= USCXML_CTX_TOP_LEVEL_FINAL;
+			return USCXML_CANCELLED;
+		}
+		return USCXML_IDLE;
+
+	case USCXML_ERR_DONE:
+		return USCXML_FINISHED;
+
+	default:
+		ERROR_PLATFORM_THROW("Native microstep failed with error " + toStr(err));
+	}
+}
+
+void NativeMicroStep::beforeMicroStep() {
+	if (!_isMicroStepping && !_isCompleting) {
+		_isMicroStepping = true;
+		USCXML_MONITOR_CALLBACK(_callbacks->getMonitors(), beforeMicroStep);
+	}
+}
+
+void NativeMicroStep::reset() {
+	FastMicroStep::reset();
+	if (_ctx != NULL) {
+		for (int i = NATIVE_CONFIG; i <= NATIVE_INITIALIZED_DATA; i++) {
+			memset(_machine.bitset(_ctx, i), 0, (_states.size() + 7) / 8);
+		}
+		*_machine.flags(_ctx) = USCXML_CTX_PRISTINE;
+	}
+	_isStable = false;
+}
+
+bool NativeMicroStep::isInState(const std::string& stateId) {
+	if (_ctx == NULL)
+		return FastMicroStep::isInState(stateId);
+
+	if (_stateIds.find(stateId) == _stateIds.end())
+		return false;
+	size_t i = _stateIds[stateId];
+	return NATIVE_BIT_HAS(i, _machine.bitset(_ctx, NATIVE_CONFIG));
+}
+
+std::list<XERCESC_NS::DOMElement*> NativeMicroStep::getConfiguration() {
+	if (_ctx == NULL)
+		return FastMicroStep::getConfiguration();
+
+	std::list<XERCESC_NS::DOMElement*> config;
+	const unsigned char* bitset = _machine.bitset(_ctx, NATIVE_CONFIG);
+	for (size_t i = 0; i < _states.size(); i++) {
+		if (NATIVE_BIT_HAS(i, bitset))
+			config.push_back(_states[i]->element);
+	}
+	return config;
+}
+
+void NativeMicroStep::fromNative() {
+	boost::dynamic_bitset<BITSET_BLOCKTYPE>* bitsets[] = { &_configuration, &_history, &_invocations, &_initializedData };
+	for (int i = NATIVE_CONFIG; i <= NATIVE_INITIALIZED_DATA; i++) {
+		const unsigned char* bitset = _machine.bitset(_ctx, i);
+		bitsets[i]->resize(_states.size());
+		for (size_t j = 0; j < _states.size(); j++) {
+			(*bitsets[i])[j] = NATIVE_BIT_HAS(j, bitset);
+		}
+	}
+}
+
+void NativeMicroStep::toNative() {
+	boost::dynamic_bitset<BITSET_BLOCKTYPE>* bitsets[] = { &_configuration, &_history, &_invocations, &_initializedData };
+	for (int i = NATIVE_CONFIG; i <= NATIVE_INITIALIZED_DATA; i++) {
+		unsigned char* bitset = _machine.bitset(_ctx, i);
+		memset(bitset, 0, (_states.size() + 7) / 8);
+		for (size_t j = 0; j < _states.size() && j < bitsets[i]->size(); j++) {
+			if ((*bitsets[i])[j])
+				bitset[j >> 3] |= (1 << (j & 7));
+		}
+	}
+	if (_configuration.any())
+		*_machine.flags(_ctx) = USCXML_CTX_INITIALIZED;
+}
+
+Data NativeMicroStep::serialize() {
+	if (_ctx != NULL)
+		fromNative();
+	return FastMicroStep::serialize();
+}
+
+void NativeMicroStep::deserialize(const Data& encodedState) {
+	FastMicroStep::deserialize(encodedState);
+	if (_ctx != NULL)
+		toNative();
+}
+
+/**
+ * The callbacks below are called from within the native step function,
+ * no exception must ever unwind through it.
+ */
+
+void* NativeMicroStep::nativeDequeueInternal(void* host) {
+	return ((NativeMicroStep*)host)->dequeueInternal();
+}
+
+void* NativeMicroStep::dequeueInternal() {
+	try {
+		if (!(_event = _callbacks->dequeueInternal()))
+			return NULL;
+
+		// we read an event - signal onstable again later
+		_isStable = false;
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeProcessingEvent, _event);
+		return &_event;
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when dequeuing an internal event";
+	}
+	return NULL;
+}
+
+void* NativeMicroStep::nativeDequeueExternal(void* host) {
+	return ((NativeMicroStep*)host)->dequeueExternal();
+}
+
+void* NativeMicroStep::dequeueExternal() {
+	try {
+		// we dequeued all internal events and ought to signal stable configuration
+		if (!_isStable) {
+			USCXML_MONITOR_CALLBACK(_callbacks->getMonitors(), onStableConfiguration);
+			_isStable = true;
+			_isMacroStepped = true;
+			return NULL;
+		}
+
+		if (!(_event = _callbacks->dequeueExternal(_blockMs)))
+			return NULL;
+
+		_isStable = false;
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeProcessingEvent, _event);
+		return &_event;
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when dequeuing an external event";
+	}
+	return NULL;
+}
+
+int NativeMicroStep::nativeIsMatched(void* host, const void* event, const char* descriptor) {
+	NativeMicroStep* self = (NativeMicroStep*)host;
+	try {
+		return self->_callbacks->isMatched(*(const Event*)event, descriptor);
+	} catch (...) {
+	}
+	return 0;
+}
+
+const char* NativeMicroStep::nativeEventName(void* host, const void* event) {
+	return ((const Event*)event)->name.c_str();
+}
+
+int NativeMicroStep::nativeIsTrue(void* host, const char* expr) {
+	NativeMicroStep* self = (NativeMicroStep*)host;
+	try {
+		return self->_callbacks->isTrue(expr);
+	} catch (...) {
+	}
+	return 0;
+}
+
+int NativeMicroStep::nativeOnEntry(void* host, unsigned int state) {
+	return ((NativeMicroStep*)host)->onEntry(state);
+}
+
+int NativeMicroStep::onEntry(unsigned int state) {
+	try {
+		beforeMicroStep();
+		if (_enteringState != (int)state)
+			USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeEnteringState, _states[state]->element);
+		_enteringState = -1;
+
+		for (auto entryIter = _states[state]->onEntry.begin(); entryIter != _states[state]->onEntry.end(); entryIter++) {
+			try {
+				_callbacks->process(*entryIter);
+			} catch (...) {
+				// do nothing and continue with next block
+			}
+		}
+
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), afterEnteringState, _states[state]->element);
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when entering a state";
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeMicroStep::nativeOnExit(void* host, unsigned int state) {
+	return ((NativeMicroStep*)host)->onExit(state);
+}
+
+int NativeMicroStep::onExit(unsigned int state) {
+	try {
+		if (_isCompleting) {
+			// no monitors when exiting all states at the end
+			for (auto exitIter = _states[state]->onExit.begin(); exitIter != _states[state]->onExit.end(); exitIter++) {
+				try {
+					_callbacks->process(*exitIter);
+				} catch (...) {
+				}
+			}
+			return USCXML_ERR_OK;
+		}
+
+		beforeMicroStep();
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeExitingState, _states[state]->element);
+
+		for (auto exitIter = _states[state]->onExit.begin(); exitIter != _states[state]->onExit.end(); exitIter++) {
+			try {
+				_callbacks->process(*exitIter);
+			} catch (...) {
+				// do nothing and continue with next block
+			}
+		}
+
+		// the native step clears it only after we return, monitors expect it cleared
+		unsigned char* config = _machine.bitset(_ctx, NATIVE_CONFIG);
+		config[state >> 3] &= ~(1 << (state & 7));
+
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), afterExitingState, _states[state]->element);
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when exiting a state";
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeMicroStep::nativeOnTransition(void* host, unsigned int transition) {
+	return ((NativeMicroStep*)host)->onTransition(transition);
+}
+
+int NativeMicroStep::onTransition(unsigned int transition) {
+	try {
+		beforeMicroStep();
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeTakingTransition, _transitions[transition]->element);
+
+		if (_transitions[transition]->onTrans != NULL) {
+			try {
+				_callbacks->process(_transitions[transition]->onTrans);
+			} catch (...) {
+				// do nothing and continue with next block
+			}
+		}
+
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), afterTakingTransition, _transitions[transition]->element);
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when taking a transition";
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeMicroStep::nativeInitData(void* host, unsigned int state) {
+	return ((NativeMicroStep*)host)->initData(state);
+}
+
+int NativeMicroStep::initData(unsigned int state) {
+	try {
+		// data is initialized before the on entry handlers
+		beforeMicroStep();
+		USCXML_MONITOR_CALLBACK1(_callbacks->getMonitors(), beforeEnteringState, _states[state]->element);
+		_enteringState = state;
+
+		for (auto dataIter = _states[state]->data.begin(); dataIter != _states[state]->data.end(); dataIter++) {
+			_callbacks->initData(*dataIter);
+		}
+	} catch (...) {
+		LOG(_callbacks->getLogger(), USCXML_ERROR) << "Exception when initializing data";
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeMicroStep::nativeInvoke(void* host, unsigned int state, int uninvoke) {
+	NativeMicroStep* self = (NativeMicroStep*)host;
+	for (auto invIter = self->_states[state]->invoke.begin(); invIter != self->_states[state]->invoke.end(); invIter++) {
+		try {
+			if (uninvoke) {
+				self->_callbacks->uninvoke(*invIter);
+			} else {
+				self->_callbacks->invoke(*invIter);
+			}
+		} catch (ErrorEvent e) {
+			LOG(self->_callbacks->getLogger(), USCXML_ERROR) << e;
+		} catch (...) {
+		}
+	}
+	return USCXML_ERR_OK;
+}
+
+int NativeMicroStep::nativeRaiseDoneEvent(void* host, unsigned int state, int finalState) {
+	NativeMicroStep* self = (NativeMicroStep*)host;
+	try {
+		self->_callbacks->raiseDoneEvent(self->_states[state]->element, (finalState >= 0 ? self->_states[finalState]->doneData : NULL));
+	} catch (...) {
+		LOG(self->_callbacks->getLogger(), USCXML_ERROR) << "Exception when raising a done event";
+	}
+	return USCXML_ERR_OK;
+}
+
+}
@@ -0,0 +1,164 @@
+/**
+ *  @file
+ *  @author     2016 Stefan Radomski (stefan.radomski@cs.tu-darmstadt.de)
+ *  @copyright  Simplified BSD
+ *
+ *  @cond
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the FreeBSD license as published by the FreeBSD
+ *  project.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  You should have received a copy of the FreeBSD license along with this
+ *  program. If not, see <http://www.opensource.org/licenses/bsd-license>.
+ *  @endcond
+ */
+
+#ifndef NATIVEMICROSTEP_H_3C8E51D4
+#define NATIVEMICROSTEP_H_3C8E51D4
+
+#include "uscxml/config.h"
+#include "uscxml/Common.h"
+#include "uscxml/interpreter/FastMicroStep.h"
+
+#include <string>
+
+/// bump whenever the structs below or the glue code in NativeMicroStep.cpp change
+#define USCXML_NATIVE_ABI_VERSION 1
+
+extern "C" {
+
+/**
+ * Callbacks of the host into the interpreter, states and transitions are
+ * identified by their index in document order as in the generated code.
+ * Has to be kept in sync with the glue code compiled into every machine.
+ */
+typedef struct uscxml_native_host {
+	void* host;
+	void* (*dequeue_internal)(void* host);
+	void* (*dequeue_external)(void* host);
+	int (*is_matched)(void* host, const void* event, const char* descriptor);
+	const char* (*event_name)(void* host, const void* event);
+	int (*is_true)(void* host, const char* expr);
+	int (*on_entry)(void* host, unsigned int state);
+	int (*on_exit)(void* host, unsigned int state);
+	int (*on_transition)(void* host, unsigned int transition);
+	int (*init_data)(void* host, unsigned int state);
+	int (*invoke)(void* host, unsigned int state, int uninvoke);
+	int (*raise_done_event)(void* host, unsigned int state, int final_state);
+} uscxml_native_host;
+
+/**
+ * A compiled machine as seen from the host, independent of the layout of
+ * the generated types.
+ */
+typedef struct uscxml_native_machine {
+	unsigned int abi_version;
+	unsigned int nr_states;
+	unsigned int nr_transitions;
+	const char* (*state_name)(unsigned int state);
+	unsigned int (*transition_source)(unsigned int transition);
+	const char* (*transition_event)(unsigned int transition);
+	const char* (*transition_condition)(unsigned int transition);
+
+	void* (*create)(const uscxml_native_host* host);
+	void (*destroy)(void* ctx);
+	int (*step)(void* ctx);
+	unsigned char* (*flags)(void* ctx);
+	unsigned char* (*bitset)(void* ctx, int which); ///< config, history, invocations, initialized data
+} uscxml_native_machine;
+
+typedef int (*uscxml_native_init_t)(uscxml_native_machine* machine);
+
+}
+
+namespace uscxml {
+
+/**
+ * @ingroup microstep
+ * @ingroup impl
+ * A microstepper running the uscxml_step function of the chart transformed
+ * with ChartToC, compiled into a shared object at runtime.
+ *
+ * At init, the chart is transformed and compiled with the C compiler in
+ * the CC environment variable or "cc" into a directory of the user in the
+ * temporary directory, only accessible by the user. The object is named
+ * after the md5 of the chart, the charts it invokes, the compiler and its
+ * flags, later sessions with the same chart only load it if nobody else
+ * could have written it. Executable content, data, invokers and
+ * conditions are still processed via the MicroStepCallbacks and all
+ * monitors are called, only the state of the machine is kept natively.
+ *
+ * If there is no compiler, the object cannot be loaded or does not match
+ * the chart, the microstepper falls back to FastMicroStep.
+ */
+class USCXML_API NativeMicroStep : public FastMicroStep {
+public:
+	NativeMicroStep(MicroStepCallbacks* callbacks);
+	virtual ~NativeMicroStep();
+	virtual std::shared_ptr<MicroStepImpl> create(MicroStepCallbacks* callbacks);
+
+	virtual InterpreterState step(size_t blockMs);
+	virtual void reset();
+	virtual bool isInState(const std::string& stateId);
+	virtual std::list<XERCESC_NS::DOMElement*> getConfiguration();
+
+	virtual void deserialize(const Data& encodedState);
+	virtual Data serialize();
+
+	/// Whether the chart is stepped natively or by the FastMicroStep we fell back to
+	bool isNative() {
+		return _ctx != NULL;
+	}
+
+protected:
+	virtual void init(XERCESC_NS::DOMElement* scxml);
+
+	std::string compile(XERCESC_NS::DOMElement* scxml);
+	bool load(const std::string& sharedObject);
+	bool matchesChart();
+	void unload();
+
+	void fromNative();
+	void toNative();
+	void beforeMicroStep();
+
+	static void* nativeDequeueInternal(void* host);
+	static void* nativeDequeueExternal(void* host);
+	static int nativeIsMatched(void* host, const void* event, const char* descriptor);
+	static const char* nativeEventName(void* host, const void* event);
+	static int nativeIsTrue(void* host, const char* expr);
+	static int nativeOnEntry(void* host, unsigned int state);
+	static int nativeOnExit(void* host, unsigned int state);
+	static int nativeOnTransition(void* host, unsigned int transition);
+	static int nativeInitData(void* host, unsigned int state);
+	static int nativeInvoke(void* host, unsigned int state, int uninvoke);
+	static int nativeRaiseDoneEvent(void* host, unsigned int state, int finalState);
+
+	// the callbacks that notify monitors forward to these
+	void* dequeueInternal();
+	void* dequeueExternal();
+	int onEntry(unsigned int state);
+	int onExit(unsigned int state);
+	int onTransition(unsigned int transition);
+	int initData(unsigned int state);
+
+	void* _library;
+	void* _ctx;
+	uscxml_native_machine _machine;
+	uscxml_native_host _host;
+
+	size_t _blockMs;
+	bool _isStable;
+	bool _isMacroStepped;
+	bool _isMicroStepping;
+	bool _isCompleting;
+	int _enteringState; ///< state whose beforeEnteringState monitors were called
+};
+
+}
+
+#endif /* end of include guard: NATIVEMICROSTEP_H_3C8E51D4 */
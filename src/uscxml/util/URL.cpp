@@ -30,6 +30,13 @@
 #include <curl/curl.h>
 #include <uriparser/Uri.h>
 
+#include <algorithm>
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+// curl_multi_poll can be woken up from other threads
+#define USCXML_CURL_MULTI_POLL 1
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -685,6 +692,17 @@ URLFetcher::URLFetcher() {
 	 */
 	_envProxy = getenv("USCXML_PROXY");
 
+	// keep connections around and share them among transfers to the same host
+	CURLMcode multiError;
+#ifdef CURLPIPE_MULTIPLEX
+	(multiError = curl_multi_setopt(_multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX)) == CURLM_OK ||
+		LOGD(USCXML_WARN) << "Cannot enable multiplexing: " << curl_multi_strerror(multiError) << std::endl;
+#endif
+	(multiError = curl_multi_setopt(_multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)USCXML_URL_MAX_HOST_CONNECTIONS)) == CURLM_OK ||
+		LOGD(USCXML_WARN) << "Cannot limit connections per host: " << curl_multi_strerror(multiError) << std::endl;
+	(multiError = curl_multi_setopt(_multiHandle, CURLMOPT_MAXCONNECTS, (long)USCXML_URL_MAX_IDLE_CONNECTIONS)) == CURLM_OK ||
+		LOGD(USCXML_WARN) << "Cannot set connection cache size: " << curl_multi_strerror(multiError) << std::endl;
+
 	start();
 }
 
@@ -751,6 +769,15 @@ void URLFetcher::fetchURL(URL& url) {
 			(curlError = curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, true)) == CURLE_OK ||
 				LOGD(USCXML_ERROR) << "Cannot enable follow redirects: " << curl_easy_strerror(curlError) << std::endl;
 
+			(curlError = curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L)) == CURLE_OK ||
+				LOGD(USCXML_ERROR) << "Cannot enable TCP keep-alive: " << curl_easy_strerror(curlError) << std::endl;
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+			// rather wait for a connection that turns out to multiplex than open another one
+			(curlError = curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L)) == CURLE_OK ||
+				LOGD(USCXML_ERROR) << "Cannot enable waiting for multiplexing: " << curl_easy_strerror(curlError) << std::endl;
+#endif
+
 			if (instance->_envProxy)
 				(curlError = curl_easy_setopt(handle, CURLOPT_PROXY, instance->_envProxy)) == CURLE_OK ||
 				LOGD(USCXML_ERROR) << "Cannot set curl proxy: " << curl_easy_strerror(curlError) << std::endl;
@@ -800,13 +827,15 @@ void URLFetcher::fetchURL(URL& url) {
 			instance->_handlesToURLs[handle] = url;
 			assert(instance->_handlesToURLs.size() > 0);
 
-			curl_multi_add_handle(instance->_multiHandle, handle);
+			// only the fetcher thread touches the multi handle
+			instance->_pendingURLs.push_back(url);
 			b_require_notify = true;
 		}
 	}
 
 	if (b_require_notify) {
 		instance->_condVar.notify_all();
+		instance->wakeUp();
 	}
 }
 
@@ -815,15 +844,23 @@ void URLFetcher::breakURL(URL& url) {
 	CURL* handle = url._impl->getCurlHandle();
 
 	std::lock_guard<std::recursive_mutex> lock(instance->_mutex);
-	if (instance->_handlesToURLs.find(handle) != instance->_handlesToURLs.end()) {
-		url._impl->downloadFailed(CURLE_OK);
-		curl_multi_remove_handle(instance->_multiHandle, handle);
-		instance->_handlesToURLs.erase(handle);
-	}
-	if (instance->_handlesToHeaders.find(handle) != instance->_handlesToHeaders.end()) {
-		curl_slist_free_all((struct curl_slist *)instance->_handlesToHeaders[handle]);
-		instance->_handlesToHeaders.erase(handle);
+	auto urlIter = instance->_handlesToURLs.find(handle);
+	if (urlIter == instance->_handlesToURLs.end())
+		return;
+	instance->_handlesToURLs.erase(urlIter);
+
+	auto pendingIter = std::find(instance->_pendingURLs.begin(), instance->_pendingURLs.end(), url);
+	if (pendingIter != instance->_pendingURLs.end()) {
+		// never made it to curl
+		instance->_pendingURLs.erase(pendingIter);
+		instance->freeHeaders(handle);
+	} else {
+		// removed by the fetcher thread, headers stay valid until then
+		instance->_brokenURLs.push_back(url);
+		instance->wakeUp();
 	}
+
+	url._impl->downloadFailed(CURLE_OK);
 }
 
 void URLFetcher::start() {
@@ -844,6 +881,7 @@ void URLFetcher::stop() {
 	}
 	
 	_condVar.notify_all();	
+	wakeUp();
 	
 	if (_thread) {
 		_thread->join();
@@ -862,6 +900,51 @@ void URLFetcher::run(void* instance) {
 	}	
 }
 
+void URLFetcher::wakeUp() {
+#ifdef USCXML_CURL_MULTI_POLL
+	curl_multi_wakeup(_multiHandle);
+#endif
+}
+
+void URLFetcher::freeHeaders(void* handle) {
+	auto headerIter = _handlesToHeaders.find(handle);
+	if (headerIter != _handlesToHeaders.end()) {
+		curl_slist_free_all((struct curl_slist *)headerIter->second);
+		_handlesToHeaders.erase(headerIter);
+	}
+}
+
+void URLFetcher::activatePending() {
+	while (_inFlight < USCXML_URL_MAX_IN_FLIGHT && !_pendingURLs.empty()) {
+		URL url = _pendingURLs.front();
+		_pendingURLs.pop_front();
+
+		CURL* handle = url._impl->getCurlHandle();
+		CURLMcode err = curl_multi_add_handle(_multiHandle, handle);
+		if (err != CURLM_OK) {
+			LOGD(USCXML_WARN) << "curl_multi_add_handle: " << curl_multi_strerror(err) << std::endl;
+			_handlesToURLs.erase(handle);
+			freeHeaders(handle);
+			url._impl->downloadFailed(CURLE_FAILED_INIT);
+			continue;
+		}
+		_inFlight++;
+	}
+}
+
+void URLFetcher::removeBroken() {
+	while (!_brokenURLs.empty()) {
+		CURL* handle = _brokenURLs.front()._impl->getCurlHandle();
+		CURLMcode err = curl_multi_remove_handle(_multiHandle, handle);
+		if (err != CURLM_OK) {
+			LOGD(USCXML_WARN) << "curl_multi_remove_handle: " << curl_multi_strerror(err) << std::endl;
+		}
+		_inFlight--;
+		freeHeaders(handle);
+		_brokenURLs.pop_front();
+	}
+}
+
 void URLFetcher::perform() {
 	
 	CURLMsg *msg; /* for picking up messages with the transfer status */
@@ -871,9 +954,11 @@ void URLFetcher::perform() {
 
 	{
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		if (_handlesToURLs.empty()) {
+		if (_handlesToURLs.empty() && _brokenURLs.empty()) {
 			_condVar.wait(_mutex);
 		}
+		removeBroken();
+		activatePending();
 		err = curl_multi_perform(_multiHandle, &stillRunning);
 		if (err != CURLM_OK) {
 			LOGD(USCXML_WARN) << "curl_multi_perform: " << curl_multi_strerror(err) << std::endl;
@@ -881,6 +966,27 @@ void URLFetcher::perform() {
 	}
 
 	do {
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			removeBroken();
+			activatePending();
+		}
+
+#ifdef USCXML_CURL_MULTI_POLL
+		// returns early when fetchURL, breakURL or stop wake us up
+		err = curl_multi_poll(_multiHandle, NULL, 0, 1000, NULL);
+		if (err != CURLM_OK) {
+			LOGD(USCXML_WARN) << "curl_multi_poll: " << curl_multi_strerror(err) << std::endl;
+		}
+
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			err = curl_multi_perform(_multiHandle, &stillRunning);
+			if (err != CURLM_OK) {
+				LOGD(USCXML_WARN) << "curl_multi_perform: " << curl_multi_strerror(err) << std::endl;
+			}
+		}
+#else
 		struct timeval timeout;
 		int rc; /* select() return code */
 
@@ -954,32 +1060,37 @@ void URLFetcher::perform() {
 			break;
 		}
 		}
+#endif
 
 		{
 			std::lock_guard<std::recursive_mutex> lock(_mutex);
 			while ((msg = curl_multi_info_read(_multiHandle, &msgsLeft))) {
 				if (msg->msg == CURLMSG_DONE) {
-					switch (msg->data.result) {
-					case CURLE_OK:
-						_handlesToURLs[msg->easy_handle]._impl->downloadCompleted();
-						err = curl_multi_remove_handle(_multiHandle, msg->easy_handle);
-						if (err != CURLM_OK) {
-							LOGD(USCXML_WARN) << "curl_multi_remove_handle: " << curl_multi_strerror(err) << std::endl;
-						}
-
-						break;
-					default:
-						_handlesToURLs[msg->easy_handle]._impl->downloadFailed(msg->data.result);
-						err = curl_multi_remove_handle(_multiHandle, msg->easy_handle);
-						if (err != CURLM_OK) {
-							LOGD(USCXML_WARN) << "curl_multi_remove_handle: " << curl_multi_strerror(err) << std::endl;
-						}
-						break;
+					// msg is gone with the handle's removal
+					CURL* handle = msg->easy_handle;
+					CURLcode result = msg->data.result;
+
+					auto urlIter = _handlesToURLs.find(handle);
+					if (urlIter == _handlesToURLs.end()) {
+						// broken off, removeBroken will take care of it
+						continue;
+					}
+					URL url = urlIter->second;
+					_handlesToURLs.erase(urlIter);
 
+					err = curl_multi_remove_handle(_multiHandle, handle);
+					if (err != CURLM_OK) {
+						LOGD(USCXML_WARN) << "curl_multi_remove_handle: " << curl_multi_strerror(err) << std::endl;
+					}
+					_inFlight--;
+					freeHeaders(handle);
+
+					// monitors may fetch the same url again
+					if (result == CURLE_OK) {
+						url._impl->downloadCompleted();
+					} else {
+						url._impl->downloadFailed(result);
 					}
-					_handlesToURLs.erase(msg->easy_handle);
-					curl_slist_free_all((struct curl_slist *)_handlesToHeaders[msg->easy_handle]);
-					_handlesToHeaders.erase(msg->easy_handle);
 
 				} else {
 					LOGD(USCXML_ERROR) << "Curl reports info on unfinished download?!" << std::endl;
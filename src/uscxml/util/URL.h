@@ -28,9 +28,19 @@
 #include <map>
 #include <set>
 #include <list>
+#include <deque>
+#include <unordered_map>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
+
+/// transfers handed to curl at the same time, others wait in the fetcher
+#define USCXML_URL_MAX_IN_FLIGHT 256
+/// concurrent connections per host, transfers beyond are multiplexed or queued by curl
+#define USCXML_URL_MAX_HOST_CONNECTIONS 8
+/// idle connections kept alive for reuse
+#define USCXML_URL_MAX_IDLE_CONNECTIONS 32
+
 namespace uscxml {
 
 class URL;
@@ -243,6 +253,10 @@ public:
 		return _impl->removeMonitor(monitor);
 	}
 
+	std::shared_ptr<URLImpl> getImpl() const {
+		return _impl;
+	}
+
 	operator Data() const {
 		return _impl->operator Data();
 	}
@@ -277,6 +291,10 @@ protected:
 
 	static void run(void* instance);
 	void perform();
+	void activatePending();
+	void removeBroken();
+	void freeHeaders(void* handle);
+	void wakeUp();
 
 	std::thread* _thread = nullptr;
 	std::condition_variable_any _condVar;
@@ -284,8 +302,11 @@ protected:
 	bool _isStarted = false;
 	bool _markedToDestroy = false;
 
-	std::map<void*, URL> _handlesToURLs;
-	std::map<void*, void*> _handlesToHeaders;
+	std::unordered_map<void*, URL> _handlesToURLs; ///< pending and active transfers
+	std::unordered_map<void*, void*> _handlesToHeaders;
+	std::deque<URL> _pendingURLs; ///< prepared, but not yet handed to curl
+	std::list<URL> _brokenURLs; ///< broken off, still to be removed from curl
+	size_t _inFlight = 0;
 	void* _multiHandle = nullptr;
 	char* _envProxy = nullptr;
 
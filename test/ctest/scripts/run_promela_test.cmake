@@ -6,8 +6,8 @@ execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTDIR})
 set(ENV{USCXML_PROMELA_TRANSITION_TRACE} "TRUE")
 set(ENV{USCXML_PROMELA_TRANSITION_DEBUG} "TRUE")
 
-message(STATUS "${USCXML_TRANSFORM_BIN} -tpml -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.pml")
-execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -tpml -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.pml RESULT_VARIABLE CMD_RESULT)
+message(STATUS "${USCXML_TRANSFORM_BIN} -tpml ${TRANSFORM_ARGS} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.pml")
+execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -tpml ${TRANSFORM_ARGS} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.pml RESULT_VARIABLE CMD_RESULT)
 if(CMD_RESULT)
 	message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN}: ${CMD_RESULT}")
 endif()
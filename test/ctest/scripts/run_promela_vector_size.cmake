@@ -0,0 +1,48 @@
+# convert every chart in a directory to promela with and without a packed
+# state vector and report the size of the state vector spin reports for each
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTDIR})
+file(GLOB CHARTS ${TESTDIR}/*.scxml)
+
+set(REPORT "")
+foreach(CHART ${CHARTS})
+	get_filename_component(CHART_NAME ${CHART} NAME_WE)
+	set(SIZES "")
+
+	foreach(VECTOR "plain" "packed")
+		set(CHART_OUTDIR ${OUTDIR}/${CHART_NAME}/${VECTOR})
+		execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${CHART_OUTDIR})
+
+		if (VECTOR STREQUAL "packed")
+			set(TRANSFORM_ARGS "-Xvector=packed")
+			set(PAN_ARGS "-DCOLLAPSE")
+		else()
+			set(TRANSFORM_ARGS "")
+			set(PAN_ARGS "")
+		endif()
+
+		execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tpml ${TRANSFORM_ARGS} -i ${CHART} -o ${CHART_OUTDIR}/${CHART_NAME}.pml RESULT_VARIABLE CMD_RESULT)
+		if(CMD_RESULT)
+			message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN} on ${CHART}: ${CMD_RESULT}")
+		endif()
+		execute_process(COMMAND ${SPIN_BIN} -a ${CHART_NAME}.pml WORKING_DIRECTORY ${CHART_OUTDIR} RESULT_VARIABLE CMD_RESULT)
+		if(CMD_RESULT)
+			message(FATAL_ERROR "Error running spin on ${CHART_OUTDIR}/${CHART_NAME}.pml: ${CMD_RESULT}")
+		endif()
+		execute_process(COMMAND ${CC_BIN} -DMEMLIM=1024 -DVECTORSZ=8192 ${PAN_ARGS} -O2 -DXUSAFE -w -o pan pan.c WORKING_DIRECTORY ${CHART_OUTDIR} RESULT_VARIABLE CMD_RESULT)
+		if(CMD_RESULT)
+			message(FATAL_ERROR "Error compiling ${CHART_OUTDIR}/pan.c: ${CMD_RESULT}")
+		endif()
+		execute_process(COMMAND ${CHART_OUTDIR}/pan -m10000 -a WORKING_DIRECTORY ${CHART_OUTDIR} OUTPUT_VARIABLE PAN_OUT)
+
+		string(REGEX MATCH "State-vector ([0-9]+) byte" VECTOR_SIZE "${PAN_OUT}")
+		set(VECTOR_SIZE ${CMAKE_MATCH_1})
+		string(REGEX MATCH "([0-9.e+]+) total actual memory usage" MEMORY "${PAN_OUT}")
+		set(MEMORY ${CMAKE_MATCH_1})
+		set(SIZES "${SIZES}  ${VECTOR}: ${VECTOR_SIZE} byte, ${MEMORY} MB")
+	endforeach()
+
+	set(REPORT "${REPORT}${CHART_NAME}:${SIZES}\n")
+endforeach()
+
+message(STATUS "State-vector sizes\n${REPORT}")
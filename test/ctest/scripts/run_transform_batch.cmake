@@ -0,0 +1,75 @@
+# transform every chart in a directory as a batch, then again to make sure
+# that the unchanged charts are all skipped. The charts in FAILING have to be
+# rejected, e.g. as they reference a script that cannot be loaded.
+
+file(REMOVE_RECURSE ${OUTDIR})
+file(GLOB CHARTS ${TESTDIR}/*.scxml)
+list(LENGTH CHARTS NR_CHARTS)
+list(LENGTH FAILING NR_FAILING)
+math(EXPR NR_TRANSFORMED "${NR_CHARTS} - ${NR_FAILING}")
+
+execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tc -b ${TESTDIR} -o ${OUTDIR} OUTPUT_VARIABLE BATCH_OUT ERROR_VARIABLE BATCH_ERR RESULT_VARIABLE CMD_RESULT)
+message(STATUS "${BATCH_OUT}")
+if (NR_FAILING EQUAL 0 AND CMD_RESULT)
+	message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN} on ${TESTDIR}: ${CMD_RESULT}")
+endif()
+if (NR_FAILING GREATER 0 AND NOT CMD_RESULT)
+	message(FATAL_ERROR "Expected ${USCXML_TRANSFORM_BIN} to fail on ${FAILING}")
+endif()
+if (NOT BATCH_OUT MATCHES "c +${NR_TRANSFORMED} written +0 skipped +${NR_FAILING} failed")
+	message(FATAL_ERROR "Expected ${NR_TRANSFORMED} charts transformed and ${NR_FAILING} failed:\n${BATCH_ERR}")
+endif()
+
+foreach(CHART ${CHARTS})
+	get_filename_component(CHART_NAME ${CHART} NAME_WE)
+	list(FIND FAILING ${CHART_NAME} FAILING_INDEX)
+	if (FAILING_INDEX GREATER -1)
+		if (EXISTS ${OUTDIR}/${CHART_NAME}.c)
+			message(FATAL_ERROR "Output for ${CHART} which should have been rejected")
+		endif()
+		if (NOT BATCH_ERR MATCHES "${CHART_NAME}")
+			message(FATAL_ERROR "No error reported for ${CHART}")
+		endif()
+	elseif (NOT EXISTS ${OUTDIR}/${CHART_NAME}.c)
+		message(FATAL_ERROR "No output for ${CHART}")
+	endif()
+endforeach()
+
+execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tc -b ${TESTDIR} -o ${OUTDIR} OUTPUT_VARIABLE BATCH_OUT ERROR_VARIABLE BATCH_ERR RESULT_VARIABLE CMD_RESULT)
+message(STATUS "${BATCH_OUT}")
+if (NR_FAILING EQUAL 0 AND CMD_RESULT)
+	message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN} on ${TESTDIR} again: ${CMD_RESULT}")
+endif()
+if (NOT BATCH_OUT MATCHES "c +0 written +${NR_TRANSFORMED} skipped +${NR_FAILING} failed")
+	message(FATAL_ERROR "Unchanged charts were transformed again")
+endif()
+
+# charts and scripts loaded via src are part of the output as well, a change
+# to them has to transform the chart again
+set(SRCDIR ${OUTDIR}/src)
+file(REMOVE_RECURSE ${SRCDIR} ${OUTDIR}/src-out)
+file(WRITE ${SRCDIR}/parent.scxml "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" datamodel=\"ecmascript\">\n  <script src=\"parent.js\"/>\n  <state id=\"s0\">\n    <invoke type=\"scxml\" src=\"child.sub\"/>\n  </state>\n</scxml>\n")
+file(WRITE ${SRCDIR}/parent.js "var x = 1;\n")
+file(WRITE ${SRCDIR}/child.sub "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" datamodel=\"ecmascript\">\n  <final id=\"done\"/>\n</scxml>\n")
+
+# transform once, after changing the invoked chart and after changing the script
+foreach(CHANGED nothing child script)
+	if (CHANGED STREQUAL "child")
+		file(WRITE ${SRCDIR}/child.sub "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" datamodel=\"ecmascript\">\n  <state id=\"s0\"/>\n  <final id=\"done\"/>\n</scxml>\n")
+	elseif (CHANGED STREQUAL "script")
+		file(WRITE ${SRCDIR}/parent.js "var x = 2;\n")
+	endif()
+	execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tc -b ${SRCDIR} -o ${OUTDIR}/src-out OUTPUT_VARIABLE BATCH_OUT ERROR_VARIABLE BATCH_ERR RESULT_VARIABLE CMD_RESULT)
+	message(STATUS "${BATCH_OUT}")
+	if (CMD_RESULT)
+		message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN} on ${SRCDIR}: ${CMD_RESULT}\n${BATCH_ERR}")
+	endif()
+	if (NOT BATCH_OUT MATCHES "c +1 written +0 skipped")
+		message(FATAL_ERROR "Chart was skipped after ${CHANGED} changed")
+	endif()
+
+	execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tc -b ${SRCDIR} -o ${OUTDIR}/src-out OUTPUT_VARIABLE BATCH_OUT ERROR_VARIABLE BATCH_ERR RESULT_VARIABLE CMD_RESULT)
+	if (NOT BATCH_OUT MATCHES "c +0 written +1 skipped")
+		message(FATAL_ERROR "Chart was transformed again with nothing changed")
+	endif()
+endforeach()
@@ -8,15 +8,27 @@ execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTDIR})
 
 # message(FATAL_ERROR "PROJECT_BINARY_DIR: ${PROJECT_BINARY_DIR}")
 
-message(STATUS "${USCXML_TRANSFORM_BIN} -t${TARGETLANG} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c")
-execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -t${TARGETLANG} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c RESULT_VARIABLE CMD_RESULT)
+set(TRANSFORM_ARGS "")
+if (BITSET)
+    list(APPEND TRANSFORM_ARGS "-X" "bitset=${BITSET}")
+endif ()
+
+message(STATUS "${USCXML_TRANSFORM_BIN} -t${TARGETLANG} ${TRANSFORM_ARGS} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c")
+execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -t${TARGETLANG} ${TRANSFORM_ARGS} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c RESULT_VARIABLE CMD_RESULT)
 if (CMD_RESULT)
     message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN}: ${CMD_RESULT}")
 endif ()
+# make sure we do not silently test the byte-wise bitsets again
+if (BITSET STREQUAL "words")
+    file(STRINGS ${OUTDIR}/${TEST_FILE_NAME}.machine.c WORDS_DEFINED REGEX "^#  define USCXML_BITSET_WORDS$")
+    if (NOT WORDS_DEFINED)
+        message(FATAL_ERROR "Machine transformed with -X bitset=words does not define USCXML_BITSET_WORDS")
+    endif ()
+endif ()
 message(STATUS "time for transforming to c machine")
 
 set(LIBRARY_PATH "-L${CMAKE_LIBRARY_OUTPUT_DIRECTORY}" "-L/opt/local/lib")
-set(LIBRARY_FILE "-luscxml")
+set(LIBRARY_FILE "-luscxml_native" "-luscxml")
 set(INCLUDE_PATH 
 	"-I${PROJECT_SOURCE_DIR}/contrib/src"
 	"-I${PROJECT_SOURCE_DIR}/src"
@@ -40,17 +52,22 @@ set(INCLUDE_PATH
 
 set(COMPILE_CMD_BIN
         "-O0"
-        "-std=c++11"
+        "-std=c++11")
+if (CMAKE_HOST_APPLE)
+    list(APPEND COMPILE_CMD_BIN
         "-Wl,-search_paths_first"
-        "-Wl,-headerpad_max_install_names"
+        "-Wl,-headerpad_max_install_names")
+endif ()
+list(APPEND COMPILE_CMD_BIN
         "-o" "${OUTDIR}/${TEST_FILE_NAME}"
-        ${LIBRARY_PATH}
-        ${LIBRARY_FILE}
         ${INCLUDE_PATH}
+        "-include" "${PROJECT_BINARY_DIR}/uscxml/native/NativeTypes.h"
         "-include" "${OUTDIR}/${TEST_FILE_NAME}.machine.c"
-        "-Wl,-rpath,${CMAKE_LIBRARY_OUTPUT_DIRECTORY}"
         "-DAUTOINCLUDE_TEST=ON"
-        "${SCAFFOLDING_FOR_GENERATED_C}")
+        "${SCAFFOLDING_FOR_GENERATED_C}"
+        ${LIBRARY_PATH}
+        ${LIBRARY_FILE}
+        "-Wl,-rpath,${CMAKE_LIBRARY_OUTPUT_DIRECTORY}")
 
 message(STATUS "${CXX_BIN} ${COMPILE_CMD_BIN}")
 execute_process(
@@ -0,0 +1,44 @@
+# see test/CMakeLists.txt for passed variables
+
+get_filename_component(TEST_FILE_NAME ${TESTFILE} NAME)
+execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTDIR})
+
+message(STATUS "${USCXML_TRANSFORM_BIN} -tc -X batch=soa -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c")
+execute_process(COMMAND ${USCXML_TRANSFORM_BIN} -tc -X batch=soa -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.c RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN}: ${CMD_RESULT}")
+endif ()
+
+# the scaffolding needs nothing but the generated machine
+set(COMPILE_CMD_BIN
+        "-O2"
+        "-std=c++11"
+        "-o" "${OUTDIR}/${TEST_FILE_NAME}"
+        "-include" "${OUTDIR}/${TEST_FILE_NAME}.machine.c"
+        "-DAUTOINCLUDE_TEST=ON"
+        "${SCAFFOLDING_FOR_GENERATED_C_BATCH}")
+
+message(STATUS "${CXX_BIN} ${COMPILE_CMD_BIN}")
+execute_process(
+        COMMAND ${CXX_BIN} ${COMPILE_CMD_BIN}
+        WORKING_DIRECTORY ${OUTDIR} RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running g++ ${CXX_BIN}: ${CMD_RESULT}")
+endif ()
+
+# the scaffolding defaults to a million instances and 200 events
+if (INSTANCES)
+    set(ENV{USCXML_BATCH_INSTANCES} ${INSTANCES})
+endif ()
+if (EVENTS)
+    set(ENV{USCXML_BATCH_EVENTS} ${EVENTS})
+endif ()
+
+message(STATUS "${OUTDIR}/${TEST_FILE_NAME}")
+execute_process(
+        COMMAND ${OUTDIR}/${TEST_FILE_NAME}
+        WORKING_DIRECTORY ${OUTDIR}
+        RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running batch of generated machines: ${CMD_RESULT}")
+endif ()
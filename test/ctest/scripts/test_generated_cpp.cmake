@@ -0,0 +1,63 @@
+# see test/CMakeLists.txt for passed variables
+
+set(CMAKE_MODULE_PATH ${PROJECT_SOURCE_DIR}/contrib/cmake)
+include("${CMAKE_MODULE_PATH}/FileInformation.cmake")
+
+get_filename_component(TEST_FILE_NAME ${TESTFILE} NAME)
+execute_process(COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTDIR})
+
+message(STATUS "${USCXML_TRANSFORM_BIN} -t${TARGETLANG} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.hpp")
+execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -t${TARGETLANG} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.hpp RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN}: ${CMD_RESULT}")
+endif ()
+message(STATUS "time for transforming to c++ machine")
+
+# the scaffolding interprets executable content with the library's datamodels
+set(LIBRARY_PATH "-L${CMAKE_LIBRARY_OUTPUT_DIRECTORY}" "-L/opt/local/lib")
+set(LIBRARY_FILE "-luscxml" ${XercesC_LIBRARIES})
+set(INCLUDE_PATH
+	"-I${PROJECT_SOURCE_DIR}/contrib/src"
+	"-I${PROJECT_SOURCE_DIR}/src"
+	"-I${PROJECT_BINARY_DIR}"
+	"-I${XercesC_INCLUDE_DIRS}"
+	"-I${LIBEVENT_INCLUDE_DIR}"
+)
+
+# optimized, the machine's step is what gets benchmarked
+set(COMPILE_CMD_BIN
+        "-O2"
+        "-std=c++11")
+if (CMAKE_HOST_APPLE)
+    list(APPEND COMPILE_CMD_BIN
+        "-Wl,-search_paths_first"
+        "-Wl,-headerpad_max_install_names")
+endif ()
+list(APPEND COMPILE_CMD_BIN
+        "-o" "${OUTDIR}/${TEST_FILE_NAME}"
+        ${INCLUDE_PATH}
+        "-include" "${OUTDIR}/${TEST_FILE_NAME}.machine.hpp"
+        "-DAUTOINCLUDE_TEST=ON"
+        "${SCAFFOLDING_FOR_GENERATED_CPP}"
+        ${LIBRARY_PATH}
+        ${LIBRARY_FILE}
+        "-Wl,-rpath,${CMAKE_LIBRARY_OUTPUT_DIRECTORY}")
+
+message(STATUS "${CXX_BIN} ${COMPILE_CMD_BIN}")
+execute_process(
+        COMMAND time -p ${CXX_BIN} ${COMPILE_CMD_BIN}
+        WORKING_DIRECTORY ${OUTDIR} RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running g++ ${CXX_BIN}: ${CMD_RESULT}")
+endif ()
+message(STATUS "time for transforming to binary")
+
+message(STATUS "${OUTDIR}/${TEST_FILE_NAME}")
+execute_process(
+        COMMAND time -p ${OUTDIR}/${TEST_FILE_NAME}
+        WORKING_DIRECTORY ${OUTDIR}
+        RESULT_VARIABLE CMD_RESULT)
+if (CMD_RESULT)
+    message(FATAL_ERROR "Error running generated c++ test: ${CMD_RESULT}")
+endif ()
+message(STATUS "time for execution")
@@ -9,7 +9,12 @@ endif()
 
 set(VHDL_TESTBENCH_NAME "tb")
 
-execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -t${TARGETLANG} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.vhdl RESULT_VARIABLE CMD_RESULT)
+set(TRANSFORM_ARGS "")
+if (MULTICYCLE)
+    list(APPEND TRANSFORM_ARGS "-X" "multicycle=on")
+endif ()
+
+execute_process(COMMAND time -p ${USCXML_TRANSFORM_BIN} -t${TARGETLANG} ${TRANSFORM_ARGS} -i ${TESTFILE} -o ${OUTDIR}/${TEST_FILE_NAME}.machine.vhdl RESULT_VARIABLE CMD_RESULT)
 if (CMD_RESULT)
     message(FATAL_ERROR "Error running ${USCXML_TRANSFORM_BIN}: ${CMD_RESULT}")
 endif ()
@@ -41,8 +46,16 @@ message(STATUS "time for transforming to binary")
 message(STATUS "${GHDL_BIN} -r ${VHDL_TESTBENCH_NAME}")
 execute_process(
         COMMAND time -p ${GHDL_BIN} -r ${VHDL_TESTBENCH_NAME}
-        WORKING_DIRECTORY ${OUTDIR} RESULT_VARIABLE CMD_RESULT)
+        WORKING_DIRECTORY ${OUTDIR} RESULT_VARIABLE CMD_RESULT
+        OUTPUT_VARIABLE CMD_OUTPUT ERROR_VARIABLE CMD_OUTPUT)
+message(STATUS "${CMD_OUTPUT}")
 if (CMD_RESULT)
     message(FATAL_ERROR "Error running ghdl ${GHDL_BIN}: ${CMD_RESULT}")
 endif ()
+# only the multicycle testbench counts cycles and events
+if (MULTICYCLE AND NOT CMD_OUTPUT MATCHES "Completed after [0-9]+ cycles with [0-9]+ events")
+    message(FATAL_ERROR "Multicycle testbench did not report its cycles")
+elseif (NOT MULTICYCLE AND CMD_OUTPUT MATCHES "Completed after")
+    message(FATAL_ERROR "Testbench reported cycles without -X multicycle=on")
+endif ()
 message(STATUS "time for transforming to binary")
@@ -0,0 +1,199 @@
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/interpreter/InterpreterMonitor.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/ioprocessor/basichttp/BasicHTTPIOProcessor.h"
+#include "uscxml/server/HTTPServer.h"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+
+using namespace uscxml;
+
+class CapturingMonitor : public InterpreterMonitor {
+public:
+	virtual void beforeProcessingEvent(Interpreter& interpreter, const Event& event) {
+		if (event.name == "ping")
+			received = event;
+	}
+	Event received;
+};
+
+class TestBasicHTTPIOProcessor : public BasicHTTPIOProcessor {
+public:
+	using BasicHTTPIOProcessor::decodeBatch;
+};
+
+class CapturingCallbacks : public IOProcessorCallbacks {
+public:
+	const std::string& getName() {
+		return name;
+	}
+	const std::string& getSessionId() {
+		return name;
+	}
+	void enqueueInternal(const Event& event) {}
+	void enqueueExternal(const Event& event) {
+		events.push_back(event);
+	}
+	void enqueueAtInvoker(const std::string& invokeId, const Event& event) {}
+	void enqueueAtParent(const Event& event) {}
+	Logger getLogger() {
+		return Logger::getDefault();
+	}
+
+	std::string name = "fragments";
+	std::list<Event> events;
+};
+
+static HTTPServer::WSFrame wsFrame(const std::string& type, const std::string& content, bool fin) {
+	HTTPServer::WSFrame frame;
+	frame.data.compound["type"] = Data(type, Data::VERBATIM);
+	frame.data.compound["content"] = Data(content, Data::VERBATIM);
+	frame.data.compound["fin"] = Data(fin ? "true" : "false", Data::INTERPRETED);
+	return frame;
+}
+
+void testDecodeBatch() {
+	{
+		// newline delimited, blank lines are skipped
+		std::list<Event> events;
+		assert(TestBasicHTTPIOProcessor::decodeBatch("{\"name\": \"a\"}\n\n{\"name\": \"b\", \"data\": {\"x\": 1}}\n", true, events));
+		assert(events.size() == 2);
+		assert(events.front().name == "a");
+		assert(events.back().name == "b");
+		assert(events.back().data.at("x").atom == "1");
+		assert(events.back().eventType == Event::EXTERNAL);
+	}
+	{
+		// JSON array
+		std::list<Event> events;
+		assert(TestBasicHTTPIOProcessor::decodeBatch(" [{\"name\": \"a\"}, {\"name\": \"b\"}]", false, events));
+		assert(events.size() == 2);
+		assert(events.back().name == "b");
+	}
+	{
+		// malformed, the whole batch is rejected
+		std::list<Event> events;
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("{\"name\": \"a\"}\n{\"data\": 1}", true, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("{\"name\": \"a\"}\nfoo", true, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("[{\"name\": \"a\"}, 3]", false, events));
+		// not an array
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("{\"name\": \"a\"}", false, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("\"a\"", false, events));
+	}
+	{
+		// empty
+		std::list<Event> events;
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("", true, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("\n  \n", true, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("", false, events));
+		assert(!TestBasicHTTPIOProcessor::decodeBatch("[]", false, events));
+	}
+}
+
+void testFragmentedFrames() {
+	CapturingCallbacks callbacks;
+	std::shared_ptr<BasicHTTPIOProcessor> ioProc = std::static_pointer_cast<BasicHTTPIOProcessor>(BasicHTTPIOProcessor().create(&callbacks));
+	BasicHTTPIOProcessor::WSStream stream(ioProc.get());
+	// never dereferenced unless we reply with an error
+	struct evws_connection* conn = (struct evws_connection*)&stream;
+
+	stream.requestFromWS(conn, wsFrame("text", "{\"name\": \"a\"}\n{\"na", false));
+	assert(callbacks.events.empty());
+	stream.requestFromWS(conn, wsFrame("continuation", "me\": \"b\"}", false));
+	assert(callbacks.events.empty());
+	stream.requestFromWS(conn, wsFrame("continuation", "\n", true));
+	assert(callbacks.events.size() == 2);
+	assert(callbacks.events.back().name == "b");
+
+	// continuations of binary messages are ignored
+	stream.requestFromWS(conn, wsFrame("binary", "", false));
+	stream.requestFromWS(conn, wsFrame("continuation", "{\"name\": \"c\"}", true));
+	assert(callbacks.events.size() == 2);
+
+	// unfragmented
+	stream.requestFromWS(conn, wsFrame("text", "{\"name\": \"d\"}", true));
+	assert(callbacks.events.size() == 3);
+	assert(callbacks.events.back().name == "d");
+}
+
+static Event exchange() {
+	const char* receiverXML =
+	    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" name=\"receiver\" datamodel=\"null\">"
+	    "  <state id=\"s\">"
+	    "    <transition event=\"ping\" target=\"done\" />"
+	    "  </state>"
+	    "  <final id=\"done\" />"
+	    "</scxml>";
+
+	CapturingMonitor monitor;
+	Interpreter receiver = Interpreter::fromXML(receiverXML, "");
+	receiver.addMonitor(&monitor);
+	// the receiver must serve its path before anyone sends
+	receiver.step(0);
+
+	std::string target = HTTPServer::getBaseURL() + "/receiver/basichttp";
+	std::string senderXML =
+	    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" name=\"sender\" datamodel=\"null\">"
+	    "  <state id=\"s\">"
+	    "    <onentry>"
+	    "      <send type=\"http://www.w3.org/TR/scxml/#BasicHTTPEventProcessor\" event=\"ping\" target=\"" + target + "\">"
+	    "        <content>hello</content>"
+	    "      </send>"
+	    "    </onentry>"
+	    "  </state>"
+	    "</scxml>";
+	Interpreter sender = Interpreter::fromXML(senderXML, "");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (receiver.step(0) != USCXML_FINISHED) {
+		sender.step(0);
+		assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+	}
+	return monitor.received;
+}
+
+void testLocalDelivery() {
+	Event viaHTTP;
+	{
+		setenv("USCXML_BASICHTTP_NO_LOCAL", "1", 1);
+		viaHTTP = exchange();
+		unsetenv("USCXML_BASICHTTP_NO_LOCAL");
+	}
+	Event viaLocal = exchange();
+
+	for (auto event : { viaHTTP, viaLocal }) {
+		std::cout << event << std::endl;
+		assert(event.name == "ping");
+		assert(event.origintype == "http://www.w3.org/TR/scxml/#BasicHTTPEventProcessor");
+		assert(event.data.at("type").atom == "post");
+		assert(event.data.hasKey("content"));
+		assert(event.data.at("header").at("_scxmleventname").atom == "ping");
+		assert(event.data.at("header").at("Content-Type").atom == "application/x-www-form-urlencoded");
+	}
+
+	// an event delivered in process is indistinguishable from one via HTTP
+	assert(viaLocal.origin == viaHTTP.origin);
+	assert(viaLocal.data.at("path") == viaHTTP.data.at("path"));
+	assert(viaLocal.data.at("uri") == viaHTTP.data.at("uri"));
+	assert(viaLocal.data.at("pathComponent") == viaHTTP.data.at("pathComponent"));
+}
+
+int main(int argc, char** argv) {
+	HTTPServer::getInstance(8211, 8212);
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testDecodeBatch();
+		testFragmentedFrames();
+		testLocalDelivery();
+	} catch (ErrorEvent e) {
+		std::cout << e;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -5,7 +5,102 @@
 #include "bindings/swig/wrapped/WrappedInvoker.h"
 #include "bindings/swig/wrapped/WrappedIOProcessor.h"
 
+#include "uscxml/Interpreter.h"
+#include "uscxml/plugins/Factory.h"
+
+#include <assert.h>
+#include <iostream>
+
+using namespace uscxml;
+
+static const char* chart =
+    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+    "  <state id=\"s1\">"
+    "    <onentry><raise event=\"foo\" /></onentry>"
+    "    <transition event=\"foo\" target=\"s2\" />"
+    "  </state>"
+    "  <state id=\"s2\">"
+    "    <transition target=\"pass\" />"
+    "  </state>"
+    "  <final id=\"pass\" />"
+    "</scxml>";
+
+// as a script would, overrides only a few callbacks
+class EnteringMonitor : public WrappedInterpreterMonitor {
+public:
+	void beforeEnteringState(const std::string& stateId, const std::string& xpath, const std::string& stateXML) {
+		entered.push_back(stateId);
+		assert(xpath.size() > 0);
+		assert(stateId.empty() || stateXML.find("id=\"" + stateId + "\"") != std::string::npos);
+	}
+	void beforeEnteringStateById(size_t elementId, const std::string& stateId) {
+		enteredById.push_back(stateId);
+		assert(stateId.empty() || getXML(elementId).find("id=\"" + stateId + "\"") != std::string::npos);
+	}
+	void afterTakingTransition(const std::string& xpath, const std::string& source, const std::list<std::string>& targets, const std::string& transitionXML) {
+		taken.push_back(source);
+	}
+
+	std::list<std::string> entered;
+	std::list<std::string> enteredById;
+	std::list<std::string> taken;
+};
+
+void run(WrappedInterpreterMonitor* monitor) {
+	Interpreter interpreter = Interpreter::fromXML(chart, "");
+	interpreter.addMonitor(monitor);
+	while (interpreter.step() != USCXML_FINISHED) {}
+	assert(interpreter.isInState("pass"));
+}
+
+void testMonitorDispatch() {
+	EnteringMonitor monitor;
+	run(&monitor);
+
+	// overridden callbacks are dispatched, the scxml element is entered first
+	std::list<std::string> states = { "", "s1", "s2", "pass" };
+	assert(monitor.entered == states);
+	assert(monitor.taken.size() == 2);
+	assert(monitor.taken.front() == "s1");
+
+	// the ones not overridden are skipped after they reached their default once
+	unsigned int defaulted = monitor.getDefaultedCallbacks();
+	assert(!(defaulted & WrappedInterpreterMonitor::BEFORE_ENTERING_STATE));
+	assert(!(defaulted & WrappedInterpreterMonitor::AFTER_TAKING_TRANSITION));
+	assert(defaulted & WrappedInterpreterMonitor::AFTER_ENTERING_STATE);
+	assert(defaulted & WrappedInterpreterMonitor::BEFORE_EXECUTING_CONTENT);
+	assert(defaulted & WrappedInterpreterMonitor::BEFORE_TAKING_TRANSITION);
+	// never invoked, so never found to be defaulted
+	assert(!(defaulted & WrappedInterpreterMonitor::BEFORE_INVOKING));
+
+	// the same for the id based callbacks
+	EnteringMonitor lightweight;
+	lightweight.setLightweight(true);
+	run(&lightweight);
+	assert(lightweight.entered.size() == 0);
+	assert(lightweight.enteredById == states);
+	defaulted = lightweight.getDefaultedCallbacks();
+	assert(!(defaulted & WrappedInterpreterMonitor::BEFORE_ENTERING_STATE));
+	assert(defaulted & WrappedInterpreterMonitor::AFTER_ENTERING_STATE);
+	assert(defaulted & WrappedInterpreterMonitor::AFTER_TAKING_TRANSITION);
+
+	// callbacks masked out are not dispatched, overridden or not
+	EnteringMonitor masked;
+	masked.setCallbackMask(WrappedInterpreterMonitor::AFTER_TAKING_TRANSITION);
+	run(&masked);
+	assert(masked.entered.size() == 0);
+	assert(masked.taken.size() == 2);
+	assert(masked.getDefaultedCallbacks() == 0);
+}
 
 int main() {
-	return 0;
-}
\ No newline at end of file
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testMonitorDispatch();
+	} catch (Event e) {
+		std::cerr << e << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+#include "uscxml/Interpreter.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/debug/Breakpoint.h"
+#include "uscxml/debug/BreakpointIndex.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/Predicates.h"
+#include "uscxml/util/String.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+
+using namespace uscxml;
+using namespace XERCESC_NS;
+
+static const char* chart =
+    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+    "  <state id=\"s1\">"
+    "    <onentry><raise event=\"foo.bar\" /><log label=\"entered\" /></onentry>"
+    "    <transition event=\"foo\" target=\"s2\" />"
+    "    <transition event=\"Baz.qux error\" target=\"s21 s22\" />"
+    "    <state id=\"s11\">"
+    "      <transition event=\"done.state\" target=\"s1\" />"
+    "    </state>"
+    "  </state>"
+    "  <parallel id=\"s2\">"
+    "    <onexit><log label=\"exited\" /></onexit>"
+    "    <state id=\"s21\">"
+    "      <invoke type=\"scxml\" id=\"child\" />"
+    "      <transition target=\"pass\"><raise event=\"foo.bar.baz\" /></transition>"
+    "    </state>"
+    "    <state id=\"s22\" />"
+    "  </parallel>"
+    "  <final id=\"pass\" />"
+    "</scxml>";
+
+static std::list<std::string> eventNames = {
+	"foo", "foo.bar", "foo.bar.baz", "foobar", "FOO.BAR", "baz.qux", "baz", "error.execution", "done.state.s1", "unknown", ""
+};
+
+void collectElements(const DOMElement* element, std::list<const DOMElement*>& elements) {
+	elements.push_back(element);
+	for (DOMElement* child = element->getFirstElementChild(); child; child = child->getNextElementSibling()) {
+		collectElements(child, elements);
+	}
+}
+
+/// All the qualified breakpoints the Debugger callbacks could pass for this document
+std::list<Breakpoint> qualifiedBreakpoints(const DOMElement* root) {
+	std::list<Breakpoint> qualified;
+
+	std::list<Breakpoint::When> whens = { Breakpoint::BEFORE, Breakpoint::AFTER };
+	std::list<const DOMElement*> elements;
+	collectElements(root, elements);
+
+	for (auto when : whens) {
+		for (auto element : elements) {
+			Breakpoint bp;
+			bp.when = when;
+			bp.element = element;
+
+			if (isState(element, false)) {
+				bp.subject = Breakpoint::STATE;
+				bp.stateId = ATTR(element, kXMLCharId);
+				bp.action = Breakpoint::ENTER;
+				qualified.push_back(bp);
+				bp.action = Breakpoint::EXIT;
+				qualified.push_back(bp);
+			} else if (LOCALNAME(element) == "transition") {
+				bp.subject = Breakpoint::TRANSITION;
+				bp.transSourceId = ATTR(getSourceState(element), kXMLCharId);
+				std::list<std::string> targets = tokenize(ATTR(element, kXMLCharTarget));
+				for (auto target : targets) {
+					bp.transTargetId = target;
+					qualified.push_back(bp);
+				}
+			} else if (LOCALNAME(element) == "invoke") {
+				bp.subject = Breakpoint::INVOKER;
+				bp.invokeId = ATTR(element, kXMLCharId);
+				bp.invokeType = ATTR(element, kXMLCharType);
+				bp.action = Breakpoint::INVOKE;
+				qualified.push_back(bp);
+				bp.action = Breakpoint::UNINVOKE;
+				qualified.push_back(bp);
+			} else {
+				// every element is executable content to the index
+				bp.subject = Breakpoint::EXECUTABLE;
+				bp.executableName = LOCALNAME(element);
+				qualified.push_back(bp);
+			}
+		}
+
+		for (auto name : eventNames) {
+			Breakpoint bp;
+			bp.when = when;
+			bp.subject = Breakpoint::EVENT;
+			bp.eventName = name;
+			qualified.push_back(bp);
+		}
+
+		Breakpoint bp;
+		bp.when = when;
+		bp.subject = Breakpoint::MICROSTEP;
+		qualified.push_back(bp);
+	}
+
+	Breakpoint stable;
+	stable.when = Breakpoint::ON;
+	stable.subject = Breakpoint::STABLE;
+	qualified.push_back(stable);
+
+	return qualified;
+}
+
+Breakpoint breakpoint(Breakpoint::Subject subject) {
+	Breakpoint bp;
+	bp.subject = subject;
+	return bp;
+}
+
+/// The breakpoints set by clients, of all kinds, some of them never matching
+std::set<Breakpoint> userBreakpoints() {
+	std::set<Breakpoint> breakpoints;
+	Breakpoint bp;
+
+	std::list<std::string> stateIds = { "s1", "s11", "s2", "s21", "pass", "nonexistent" };
+	for (auto stateId : stateIds) {
+		bp = breakpoint(Breakpoint::STATE);
+		bp.stateId = stateId;
+		breakpoints.insert(bp);
+
+		bp.when = Breakpoint::AFTER;
+		bp.action = Breakpoint::EXIT;
+		breakpoints.insert(bp);
+
+		bp = breakpoint(Breakpoint::TRANSITION);
+		bp.transSourceId = stateId;
+		breakpoints.insert(bp);
+
+		bp = breakpoint(Breakpoint::TRANSITION);
+		bp.transTargetId = stateId;
+		breakpoints.insert(bp);
+
+		bp.transSourceId = "s1";
+		breakpoints.insert(bp);
+	}
+	breakpoints.insert(breakpoint(Breakpoint::STATE));
+	breakpoints.insert(breakpoint(Breakpoint::TRANSITION));
+
+	std::list<std::string> executables = { "raise", "log", "onentry", "send", "" };
+	for (auto executable : executables) {
+		bp = breakpoint(Breakpoint::EXECUTABLE);
+		bp.executableName = executable;
+		breakpoints.insert(bp);
+		bp.when = Breakpoint::BEFORE;
+		breakpoints.insert(bp);
+	}
+
+	std::list<std::string> descriptors = { "foo", "foo.*", "foo.bar", "FOO.BAR.", "baz qux.quux", "*", ".*", "error", "done.state.s1", "nope", "" };
+	for (auto descriptor : descriptors) {
+		bp = breakpoint(Breakpoint::EVENT);
+		bp.eventName = descriptor;
+		breakpoints.insert(bp);
+		bp.when = Breakpoint::AFTER;
+		breakpoints.insert(bp);
+	}
+
+	bp = breakpoint(Breakpoint::INVOKER);
+	breakpoints.insert(bp);
+	bp.invokeType = "scxml";
+	breakpoints.insert(bp);
+	bp.invokeId = "child";
+	bp.action = Breakpoint::UNINVOKE;
+	breakpoints.insert(bp);
+
+	breakpoints.insert(breakpoint(Breakpoint::STABLE));
+	bp = breakpoint(Breakpoint::MICROSTEP);
+	bp.when = Breakpoint::AFTER;
+	breakpoints.insert(bp);
+
+	// no subject, only qualified by when and action or not at all
+	bp = Breakpoint();
+	bp.when = Breakpoint::BEFORE;
+	bp.action = Breakpoint::ENTER;
+	breakpoints.insert(bp);
+	bp = Breakpoint();
+	bp.stateId = "s21";
+	breakpoints.insert(bp);
+
+	return breakpoints;
+}
+
+/// Compare the index against the linear scan over all breakpoints as in DebugSession::checkBreakpoints before
+void compare(Interpreter& interpreter, const std::set<Breakpoint>& breakpoints, const DOMElement* root, const std::list<Breakpoint>& qualified) {
+	BreakpointIndex index;
+	index.rebuild(breakpoints, root);
+
+	size_t matched = 0;
+	for (auto& qualifiedBreakpoint : qualified) {
+		std::set<Breakpoint> expected;
+		for (auto& breakpoint : breakpoints) {
+			if (breakpoint.enabled && breakpoint.matches(interpreter, qualifiedBreakpoint))
+				expected.insert(breakpoint);
+		}
+
+		std::list<Breakpoint> candidates;
+		index.candidates(qualifiedBreakpoint, candidates);
+		std::set<Breakpoint> actual;
+		for (auto& breakpoint : candidates) {
+			if (breakpoint.enabled && breakpoint.matches(interpreter, qualifiedBreakpoint))
+				actual.insert(breakpoint);
+		}
+
+		// sets of breakpoints only know about operator<
+		if (!std::includes(expected.begin(), expected.end(), actual.begin(), actual.end()) ||
+		        !std::includes(actual.begin(), actual.end(), expected.begin(), expected.end())) {
+			std::cerr << "Index differs from linear scan for " << qualifiedBreakpoint.toData() << std::endl;
+			assert(false);
+		}
+
+		// the callbacks return early only if nothing can match
+		if (!expected.empty()) {
+			if (qualifiedBreakpoint.subject == Breakpoint::EVENT) {
+				assert(index.watchesEvent(qualifiedBreakpoint.eventName));
+			} else {
+				assert(index.watches(qualifiedBreakpoint.subject, qualifiedBreakpoint.element));
+			}
+		}
+		matched += expected.size();
+	}
+
+	bool anyEnabled = false;
+	for (auto& breakpoint : breakpoints)
+		anyEnabled |= breakpoint.enabled;
+	assert(index.empty() == !anyEnabled);
+	std::cout << breakpoints.size() << " breakpoints, " << qualified.size() << " qualified, " << matched << " matches" << std::endl;
+}
+
+void testIndexMatchesLinearScan() {
+	Interpreter interpreter = Interpreter::fromXML(chart, "");
+	const DOMElement* root = interpreter.getImpl()->getDocument()->getDocumentElement();
+	std::list<Breakpoint> qualified = qualifiedBreakpoints(root);
+	std::set<Breakpoint> breakpoints = userBreakpoints();
+
+	// all of them
+	compare(interpreter, breakpoints, root, qualified);
+
+	// each on its own
+	for (auto& breakpoint : breakpoints) {
+		std::set<Breakpoint> single = { breakpoint };
+		compare(interpreter, single, root, qualified);
+	}
+
+	// without a document, nothing is resolved to elements
+	compare(interpreter, breakpoints, NULL, qualified);
+
+	// disabled breakpoints are neither indexed nor scanned
+	size_t i = 0;
+	for (auto& breakpoint : breakpoints) {
+		breakpoint.enabled = (i++ % 3 != 0);
+	}
+	compare(interpreter, breakpoints, root, qualified);
+
+	for (auto& breakpoint : breakpoints) {
+		breakpoint.enabled = false;
+	}
+	compare(interpreter, breakpoints, root, qualified);
+
+	std::set<Breakpoint> none;
+	compare(interpreter, none, root, qualified);
+}
+
+int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testIndexMatchesLinearScan();
+	} catch (Event e) {
+		std::cerr << e << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
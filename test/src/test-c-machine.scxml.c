@@ -1,6 +1,6 @@
 /**
   Generated from source:
-  file:///Users/sradomski/Documents/TK/Code/uscxml/test/w3c/lua/test240.scxml
+  test/w3c/promela/test240.scxml
 */
 
 #ifndef USCXML_NO_STDTYPES_H
@@ -39,6 +39,19 @@
 #  define USCXML_NR_TRANS_TYPE uint8_t
 #endif 
 
+/**
+ *    USCXML_BITSET_WORDS
+ *      operate on bitsets a 64 bit word at a time and iterate their set bits
+ *      by counting trailing zeros. Bitsets are padded to whole words and
+ *      aligned, the USCXML_MAX_NR_*_BYTES macros below have to be multiples
+ *      of 8 then. Leave undefined or define USCXML_BITSET_BYTES for 8-bit
+ *      targets, where single bytes are faster.
+ */
+
+#if defined(USCXML_BITSET_WORDS) && (defined(USCXML_BITSET_BYTES) || !(defined(__GNUC__) || defined(_MSC_VER)))
+#  undef USCXML_BITSET_WORDS /* no way to align bitsets */
+#endif
+
 /** 
  *    USCXML_MAX_NR_STATES_BYTES
  *      the smallest multiple of 8 that, if multiplied by 8,
@@ -51,7 +64,11 @@
  */
 
 #ifndef USCXML_MAX_NR_STATES_BYTES 
-#  define USCXML_MAX_NR_STATES_BYTES 1
+#  ifdef USCXML_BITSET_WORDS
+#    define USCXML_MAX_NR_STATES_BYTES 8
+#  else
+#    define USCXML_MAX_NR_STATES_BYTES 1
+#  endif
 #endif 
 
 /**
@@ -60,7 +77,11 @@
  */
 
 #ifndef USCXML_MAX_NR_TRANS_BYTES 
-#  define USCXML_MAX_NR_TRANS_BYTES 1
+#  ifdef USCXML_BITSET_WORDS
+#    define USCXML_MAX_NR_TRANS_BYTES 8
+#  else
+#    define USCXML_MAX_NR_TRANS_BYTES 1
+#  endif
 #endif 
 
 /**
@@ -91,6 +112,37 @@
 #  define USCXML_GET_TRANS(i) (ctx->machine->transitions[i])
 #endif
 
+/**
+ *    USCXML_ON_ENTRY / USCXML_ON_EXIT / USCXML_ON_TRANS / USCXML_INVOKE / USCXML_INIT_DATA / USCXML_ON_SCRIPT
+ *      Per default the executable content, invocations and data of states and transitions
+ *      are processed via the function pointers in the machine info, but a host processing
+ *      them on its own can hook every state entered or exited and every transition taken.
+ */
+
+#ifndef USCXML_ON_ENTRY
+#  define USCXML_ON_ENTRY(i) (USCXML_GET_STATE(i).on_entry != NULL ? USCXML_GET_STATE(i).on_entry(ctx, &USCXML_GET_STATE(i), ctx->event) : USCXML_ERR_OK)
+#endif
+
+#ifndef USCXML_ON_EXIT
+#  define USCXML_ON_EXIT(i) (USCXML_GET_STATE(i).on_exit != NULL ? USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event) : USCXML_ERR_OK)
+#endif
+
+#ifndef USCXML_ON_TRANS
+#  define USCXML_ON_TRANS(i, state) (USCXML_GET_TRANS(i).on_transition != NULL ? USCXML_GET_TRANS(i).on_transition(ctx, &USCXML_GET_STATE(state), ctx->event) : USCXML_ERR_OK)
+#endif
+
+#ifndef USCXML_INVOKE
+#  define USCXML_INVOKE(i, uninvoke) (USCXML_GET_STATE(i).invoke != NULL ? USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, uninvoke) : USCXML_ERR_OK)
+#endif
+
+#ifndef USCXML_INIT_DATA
+#  define USCXML_INIT_DATA(i) (USCXML_GET_STATE(i).data != NULL && ctx->exec_content_init != NULL ? ctx->exec_content_init(ctx, USCXML_GET_STATE(i).data) : USCXML_ERR_OK)
+#endif
+
+#ifndef USCXML_ON_SCRIPT
+#  define USCXML_ON_SCRIPT() (ctx->machine->script != NULL ? ctx->machine->script(ctx, &USCXML_GET_STATE(0), NULL) : USCXML_ERR_OK)
+#endif
+
 
 /* Common macros below */
 
@@ -98,6 +150,27 @@
 #define BIT_SET_AT(idx, bitset)  bitset[idx >> 3] |= (1 << (idx & 7));
 #define BIT_CLEAR(idx, bitset)   bitset[idx >> 3] &= (1 << (idx & 7)) ^ 0xFF;
 
+/* visit the set bits of a bitset in ascending order, bits set ahead of idx are visited as well */
+#ifdef USCXML_BITSET_WORDS
+#  ifdef _MSC_VER
+#    define USCXML_BITSET_ALIGNED __declspec(align(8))
+#  else
+#    define USCXML_BITSET_ALIGNED __attribute__((aligned(8)))
+#  endif
+#  define BIT_FOR_EACH(idx, bitset, nr_bits) \
+    for (idx = bit_next(bitset, 0, nr_bits); idx < nr_bits; idx = bit_next(bitset, idx + 1, nr_bits))
+#else
+#  define USCXML_BITSET_ALIGNED
+#  define BIT_FOR_EACH(idx, bitset, nr_bits) \
+    for (idx = 0; idx < nr_bits; idx++) if (BIT_HAS(idx, bitset))
+#endif
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 8)
+#  define USCXML_UNROLL _Pragma("GCC unroll 8")
+#else
+#  define USCXML_UNROLL
+#endif
+
 #ifdef __GNUC__
 #  define likely(x)       (__builtin_expect(!!(x), 1))
 #  define unlikely(x)     (__builtin_expect(!!(x), 0))
@@ -123,6 +196,8 @@
 #define USCXML_TRANS_HISTORY          0x08
 #define USCXML_TRANS_INITIAL          0x10
 
+#define USCXML_EVENT_UNKNOWN          0
+
 #define USCXML_STATE_ATOMIC           0x01
 #define USCXML_STATE_PARALLEL         0x02
 #define USCXML_STATE_COMPOUND         0x03
@@ -149,6 +224,11 @@
 #endif
 
 
+/* types predefined by a host, e.g. in uscxml/native/NativeTypes.h, have to be of the same version */
+#if defined(USCXML_GEN_C_TYPES_VERSION) && USCXML_GEN_C_TYPES_VERSION != 1
+#  error "Predefined types are of another version than the generated code"
+#endif
+
 #ifndef USCXML_NO_GEN_C_TYPES
 
 /**
@@ -161,6 +241,7 @@ typedef struct uscxml_transition uscxml_transition;
 typedef struct uscxml_state uscxml_state;
 typedef struct uscxml_ctx uscxml_ctx;
 typedef struct uscxml_elem_invoke uscxml_elem_invoke;
+typedef struct uscxml_events uscxml_events;
 
 typedef struct uscxml_elem_send uscxml_elem_send;
 typedef struct uscxml_elem_param uscxml_elem_param;
@@ -173,6 +254,7 @@ typedef void* (*dequeue_internal_t)(const uscxml_ctx* ctx);
 typedef void* (*dequeue_external_t)(const uscxml_ctx* ctx);
 typedef int (*is_enabled_t)(const uscxml_ctx* ctx, const uscxml_transition* transition);
 typedef int (*is_matched_t)(const uscxml_ctx* ctx, const uscxml_transition* transition, const void* event);
+typedef int (*event_id_t)(const uscxml_ctx* ctx, const void* event);
 typedef int (*is_true_t)(const uscxml_ctx* ctx, const char* expr);
 typedef int (*exec_content_t)(const uscxml_ctx* ctx, const uscxml_state* state, const void* event);
 typedef int (*raise_done_event_t)(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata);
@@ -205,6 +287,20 @@ struct uscxml_machine {
     const uscxml_machine*       parent;
     const uscxml_elem_donedata* donedata;
     const exec_content_t        script;          /* Global script elements */
+    const uscxml_events*        events;          /* Event ids of all descriptors */
+};
+
+/**
+ * All event descriptors of a machine's transitions by event id. An event's
+ * id is the one of the longest descriptor matching it, see uscxml_event_id.
+ */
+struct uscxml_events {
+    const unsigned int nr_events;      /* including USCXML_EVENT_UNKNOWN */
+    const uint32_t seed;               /* of the perfect hash */
+    const unsigned int nr_slots;       /* power of two */
+    const char* const* names;          /* descriptor per event id */
+    const unsigned int* slots;         /* event id per hash slot */
+    const unsigned char* transitions;  /* USCXML_MAX_NR_TRANS_BYTES of enabled transitions per event id */
 };
 
 /**
@@ -237,9 +333,9 @@ struct uscxml_state {
     const exec_content_t on_entry;                     /* on entry handlers      */
     const exec_content_t on_exit;                      /* on exit handlers       */
     const invoke_t invoke;                             /* invocations            */
-    const unsigned char children[USCXML_MAX_NR_STATES_BYTES];   /* all children           */
-    const unsigned char completion[USCXML_MAX_NR_STATES_BYTES]; /* default completion     */
-    const unsigned char ancestors[USCXML_MAX_NR_STATES_BYTES];  /* all ancestors          */
+    USCXML_BITSET_ALIGNED const unsigned char children[USCXML_MAX_NR_STATES_BYTES];   /* all children           */
+    USCXML_BITSET_ALIGNED const unsigned char completion[USCXML_MAX_NR_STATES_BYTES]; /* default completion     */
+    USCXML_BITSET_ALIGNED const unsigned char ancestors[USCXML_MAX_NR_STATES_BYTES];  /* all ancestors          */
     const uscxml_elem_data* data;                      /* data with late binding */
     const unsigned char type;                          /* One of USCXML_STATE_*  */
 };
@@ -249,14 +345,14 @@ struct uscxml_state {
  */
 struct uscxml_transition {
     const USCXML_NR_STATES_TYPE source;
-    const unsigned char target[USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED const unsigned char target[USCXML_MAX_NR_STATES_BYTES];
     const char* event;
     const char* condition;
     const is_enabled_t is_enabled;
     const exec_content_t on_transition;
     const unsigned char type;
-    const unsigned char conflicts[USCXML_MAX_NR_TRANS_BYTES];
-    const unsigned char exit_set[USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED const unsigned char conflicts[USCXML_MAX_NR_TRANS_BYTES];
+    USCXML_BITSET_ALIGNED const unsigned char exit_set[USCXML_MAX_NR_STATES_BYTES];
 };
 
 /**
@@ -336,10 +432,10 @@ struct uscxml_ctx {
     unsigned char         flags;
     const uscxml_machine* machine;
 
-    unsigned char config[USCXML_MAX_NR_STATES_BYTES]; /* Make sure these macros specify a sufficient size */
-    unsigned char history[USCXML_MAX_NR_STATES_BYTES];
-    unsigned char invocations[USCXML_MAX_NR_STATES_BYTES];
-    unsigned char initialized_data[USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char config[USCXML_MAX_NR_STATES_BYTES]; /* Make sure these macros specify a sufficient size */
+    USCXML_BITSET_ALIGNED unsigned char history[USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char invocations[USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char initialized_data[USCXML_MAX_NR_STATES_BYTES];
 
     void* user_data;
     void* event;
@@ -347,6 +443,7 @@ struct uscxml_ctx {
     dequeue_internal_t dequeue_internal;
     dequeue_external_t dequeue_external;
     is_matched_t       is_matched;
+    event_id_t         event_id;         /* optional, replaces is_matched */
     is_true_t          is_true;
     raise_done_event_t raise_done_event;
 
@@ -364,29 +461,30 @@ struct uscxml_ctx {
     invoke_t invoke;
 };
 
+#define USCXML_GEN_C_TYPES_VERSION 1
 #define USCXML_NO_GEN_C_TYPES
 #endif
 
 /* forward declare machines to allow references */
-extern const uscxml_machine _uscxml_ED395C23__machine;
-extern const uscxml_machine _uscxml_7847B274__machine;
-extern const uscxml_machine _uscxml_DB2A83B0__machine;
+extern const uscxml_machine _uscxml_CD22315F__machine;
+extern const uscxml_machine _uscxml_9CC10D1D__machine;
+extern const uscxml_machine _uscxml_FD4E2135__machine;
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_elem_data _uscxml_ED395C23__elem_datas[2] = {
+static const uscxml_elem_data _uscxml_CD22315F__elem_datas[2] = {
     /* id, src, expr, content */
     { "Var1", NULL, "1", NULL },
     { NULL, NULL, NULL, NULL }
 };
 
-static const uscxml_elem_param _uscxml_ED395C23__elem_params[2] = {
+static const uscxml_elem_param _uscxml_CD22315F__elem_params[2] = {
     /* name, expr, location */
     { "Var1", "1", NULL },
     { NULL, NULL, NULL }
 };
 
-static const uscxml_elem_send _uscxml_ED395C23__elem_sends[1] = {
+static const uscxml_elem_send _uscxml_CD22315F__elem_sends[1] = {
     { 
         /* event       */ "timeout", 
         /* eventexpr   */ NULL, 
@@ -405,7 +503,7 @@ static const uscxml_elem_send _uscxml_ED395C23__elem_sends[1] = {
     }
 };
 
-static const uscxml_elem_donedata _uscxml_ED395C23__elem_donedatas[1] = {
+static const uscxml_elem_donedata _uscxml_CD22315F__elem_donedatas[1] = {
     /* source, content, contentexpr, params */
     { 0, NULL, NULL, NULL }
 };
@@ -414,9 +512,9 @@ static const uscxml_elem_donedata _uscxml_ED395C23__elem_donedatas[1] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_elem_invoke _uscxml_ED395C23__elem_invokes[2] = {
+static const uscxml_elem_invoke _uscxml_CD22315F__elem_invokes[2] = {
     { 
-        /* machine     */ &_uscxml_7847B274__machine, 
+        /* machine     */ &_uscxml_9CC10D1D__machine, 
         /* type        */ "http://www.w3.org/TR/scxml/", 
         /* typeexpr    */ NULL, 
         /* src         */ NULL, 
@@ -432,7 +530,7 @@ static const uscxml_elem_invoke _uscxml_ED395C23__elem_invokes[2] = {
         /* contentexpr */ NULL,
     },
     { 
-        /* machine     */ &_uscxml_DB2A83B0__machine, 
+        /* machine     */ &_uscxml_FD4E2135__machine, 
         /* type        */ "http://www.w3.org/TR/scxml/", 
         /* typeexpr    */ NULL, 
         /* src         */ NULL, 
@@ -442,7 +540,7 @@ static const uscxml_elem_invoke _uscxml_ED395C23__elem_invokes[2] = {
         /* sourcename  */ "s02", 
         /* namelist    */ NULL, 
         /* autoforward */ 0, 
-        /* params      */ &_uscxml_ED395C23__elem_params[0], 
+        /* params      */ &_uscxml_CD22315F__elem_params[0], 
         /* finalize    */ NULL, 
         /* content     */ NULL,
         /* contentexpr */ NULL,
@@ -453,32 +551,32 @@ static const uscxml_elem_invoke _uscxml_ED395C23__elem_invokes[2] = {
 
 #ifndef USCXML_NO_EXEC_CONTENT
 
-static int _uscxml_ED395C23__s0_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_CD22315F__s0_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_send != NULL) {
-        if ((ctx->exec_content_send(ctx, &_uscxml_ED395C23__elem_sends[0])) != USCXML_ERR_OK) return err;
+        if ((ctx->exec_content_send(ctx, &_uscxml_CD22315F__elem_sends[0])) != USCXML_ERR_OK) return err;
     } else {
         return USCXML_ERR_MISSING_CALLBACK;
     }
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_ED395C23__s0_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
-    _uscxml_ED395C23__s0_on_entry_0(ctx, state, event);
+static int _uscxml_CD22315F__s0_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+    _uscxml_CD22315F__s0_on_entry_0(ctx, state, event);
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_ED395C23__s01_invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke) {
-    ctx->invoke(ctx, s, &_uscxml_ED395C23__elem_invokes[0], uninvoke);
+static int _uscxml_CD22315F__s01_invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke) {
+    ctx->invoke(ctx, s, &_uscxml_CD22315F__elem_invokes[0], uninvoke);
 
     return USCXML_ERR_OK;
 }
-static int _uscxml_ED395C23__s02_invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke) {
-    ctx->invoke(ctx, s, &_uscxml_ED395C23__elem_invokes[1], uninvoke);
+static int _uscxml_CD22315F__s02_invoke(const uscxml_ctx* ctx, const uscxml_state* s, const uscxml_elem_invoke* invocation, unsigned char uninvoke) {
+    ctx->invoke(ctx, s, &_uscxml_CD22315F__elem_invokes[1], uninvoke);
 
     return USCXML_ERR_OK;
 }
-static int _uscxml_ED395C23__pass_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_CD22315F__pass_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_log != NULL) {
         if unlikely((ctx->exec_content_log(ctx, "Outcome", "'pass'")) != USCXML_ERR_OK) return err;
@@ -488,12 +586,12 @@ static int _uscxml_ED395C23__pass_on_entry_0(const uscxml_ctx* ctx, const uscxml
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_ED395C23__pass_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
-    _uscxml_ED395C23__pass_on_entry_0(ctx, state, event);
+static int _uscxml_CD22315F__pass_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+    _uscxml_CD22315F__pass_on_entry_0(ctx, state, event);
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_ED395C23__fail_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_CD22315F__fail_on_entry_0(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_log != NULL) {
         if unlikely((ctx->exec_content_log(ctx, "Outcome", "'fail'")) != USCXML_ERR_OK) return err;
@@ -503,8 +601,8 @@ static int _uscxml_ED395C23__fail_on_entry_0(const uscxml_ctx* ctx, const uscxml
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_ED395C23__fail_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
-    _uscxml_ED395C23__fail_on_entry_0(ctx, state, event);
+static int _uscxml_CD22315F__fail_on_entry(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+    _uscxml_CD22315F__fail_on_entry_0(ctx, state, event);
     return USCXML_ERR_OK;
 }
 
@@ -512,7 +610,7 @@ static int _uscxml_ED395C23__fail_on_entry(const uscxml_ctx* ctx, const uscxml_s
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_state _uscxml_ED395C23__states[6] = {
+static const uscxml_state _uscxml_CD22315F__states[6] = {
     {   /* state number 0 */
         /* name       */ NULL,
         /* parent     */ 0,
@@ -522,13 +620,13 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
         /* children   */ { 0x32 /* 010011 */ },
         /* completion */ { 0x02 /* 010000 */ }, 	
         /* ancestors  */ { 0x00 /* 000000 */ },
-        /* data       */ &_uscxml_ED395C23__elem_datas[0],
+        /* data       */ &_uscxml_CD22315F__elem_datas[0],
         /* type       */ USCXML_STATE_COMPOUND,
     },
     {   /* state number 1 */
         /* name       */ "s0",
         /* parent     */ 0,
-        /* onentry    */ _uscxml_ED395C23__s0_on_entry,
+        /* onentry    */ _uscxml_CD22315F__s0_on_entry,
         /* onexit     */ NULL,
         /* invoke     */ NULL,
         /* children   */ { 0x0c /* 001100 */ },
@@ -542,7 +640,7 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
         /* parent     */ 1,
         /* onentry    */ NULL,
         /* onexit     */ NULL,
-        /* invoke     */ _uscxml_ED395C23__s01_invoke,
+        /* invoke     */ _uscxml_CD22315F__s01_invoke,
         /* children   */ { 0x00 /* 000000 */ },
         /* completion */ { 0x00 /* 000000 */ }, 	
         /* ancestors  */ { 0x03 /* 110000 */ },
@@ -554,7 +652,7 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
         /* parent     */ 1,
         /* onentry    */ NULL,
         /* onexit     */ NULL,
-        /* invoke     */ _uscxml_ED395C23__s02_invoke,
+        /* invoke     */ _uscxml_CD22315F__s02_invoke,
         /* children   */ { 0x00 /* 000000 */ },
         /* completion */ { 0x00 /* 000000 */ }, 	
         /* ancestors  */ { 0x03 /* 110000 */ },
@@ -564,7 +662,7 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
     {   /* state number 4 */
         /* name       */ "pass",
         /* parent     */ 0,
-        /* onentry    */ _uscxml_ED395C23__pass_on_entry,
+        /* onentry    */ _uscxml_CD22315F__pass_on_entry,
         /* onexit     */ NULL,
         /* invoke     */ NULL,
         /* children   */ { 0x00 /* 000000 */ },
@@ -576,7 +674,7 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
     {   /* state number 5 */
         /* name       */ "fail",
         /* parent     */ 0,
-        /* onentry    */ _uscxml_ED395C23__fail_on_entry,
+        /* onentry    */ _uscxml_CD22315F__fail_on_entry,
         /* onexit     */ NULL,
         /* invoke     */ NULL,
         /* children   */ { 0x00 /* 000000 */ },
@@ -591,7 +689,7 @@ static const uscxml_state _uscxml_ED395C23__states[6] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_transition _uscxml_ED395C23__transitions[5] = {
+static const uscxml_transition _uscxml_CD22315F__transitions[5] = {
     {   /* transition number 1 with priority 0
            target: s02
          */
@@ -663,37 +761,75 @@ static const uscxml_transition _uscxml_ED395C23__transitions[5] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
+enum {
+    _uscxml_CD22315F__event_failure = 1, /* failure */
+    _uscxml_CD22315F__event_success = 2, /* success */
+    _uscxml_CD22315F__event_timeout = 3 /* timeout */
+};
+
+static const char* const _uscxml_CD22315F__event_names[4] = {
+    "",
+    "failure",
+    "success",
+    "timeout"
+};
+
+static const unsigned int _uscxml_CD22315F__event_slots[16] = {
+    2, 1, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0
+};
+
+static USCXML_BITSET_ALIGNED const unsigned char _uscxml_CD22315F__event_transitions[4][USCXML_MAX_NR_TRANS_BYTES] = {
+    { 0x00 /* unknown: 00000 */ },
+    { 0x0a /* failure: 01010 */ },
+    { 0x05 /* success: 10100 */ },
+    { 0x10 /* timeout: 00001 */ }
+};
+
+static const uscxml_events _uscxml_CD22315F__events = {
+    /* nr_events   */ 4,
+    /* seed        */ 0,
+    /* nr_slots    */ 16,
+    /* names       */ &_uscxml_CD22315F__event_names[0],
+    /* slots       */ &_uscxml_CD22315F__event_slots[0],
+    /* transitions */ &_uscxml_CD22315F__event_transitions[0][0]
+};
+
+#endif
+
+#ifndef USCXML_NO_ELEM_INFO
+
 #ifndef USCXML_MACHINE
-#  define USCXML_MACHINE _uscxml_ED395C23__machine
+#  define USCXML_MACHINE _uscxml_CD22315F__machine
 #endif
-#define USCXML_MACHINE_0 _uscxml_ED395C23__machine
-#define USCXML_MACHINE_TEST240_SCXML _uscxml_ED395C23__machine
+#define USCXML_MACHINE_0 _uscxml_CD22315F__machine
+#define USCXML_MACHINE_TEST240_SCXML _uscxml_CD22315F__machine
 
-const uscxml_machine _uscxml_ED395C23__machine = {
+const uscxml_machine _uscxml_CD22315F__machine = {
         /* flags          */ 0,
         /* nr_states      */ 6,
         /* nr_transitions */ 5,
         /* name           */ "test240.scxml",
-        /* datamodel      */ "lua",
-        /* uuid           */ "ED395C2320352170727CA99C3797822B",
-        /* states         */ &_uscxml_ED395C23__states[0], 
-        /* transitions    */ &_uscxml_ED395C23__transitions[0], 
+        /* datamodel      */ "promela",
+        /* uuid           */ "CD22315FAA9783203A1DE0014516D9F3",
+        /* states         */ &_uscxml_CD22315F__states[0], 
+        /* transitions    */ &_uscxml_CD22315F__transitions[0], 
         /* parent         */ NULL,
-        /* donedata       */ &_uscxml_ED395C23__elem_donedatas[0], 
-        /* script         */ NULL
+        /* donedata       */ &_uscxml_CD22315F__elem_donedatas[0], 
+        /* script         */ NULL,
+        /* events         */ &_uscxml_CD22315F__events
 };
 
 #endif
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_elem_data _uscxml_7847B274__elem_datas[2] = {
+static const uscxml_elem_data _uscxml_9CC10D1D__elem_datas[2] = {
     /* id, src, expr, content */
     { "Var1", NULL, "0", NULL },
     { NULL, NULL, NULL, NULL }
 };
 
-static const uscxml_elem_send _uscxml_7847B274__elem_sends[2] = {
+static const uscxml_elem_send _uscxml_9CC10D1D__elem_sends[2] = {
     { 
         /* event       */ "success", 
         /* eventexpr   */ NULL, 
@@ -728,7 +864,7 @@ static const uscxml_elem_send _uscxml_7847B274__elem_sends[2] = {
     }
 };
 
-static const uscxml_elem_donedata _uscxml_7847B274__elem_donedatas[1] = {
+static const uscxml_elem_donedata _uscxml_9CC10D1D__elem_donedatas[1] = {
     /* source, content, contentexpr, params */
     { 0, NULL, NULL, NULL }
 };
@@ -741,26 +877,26 @@ static const uscxml_elem_donedata _uscxml_7847B274__elem_donedatas[1] = {
 
 #ifndef USCXML_NO_EXEC_CONTENT
 
-static int _uscxml_7847B274__sub01_transition0_is_enabled(const uscxml_ctx* ctx, const uscxml_transition* transition) {
+static int _uscxml_9CC10D1D__sub01_transition0_is_enabled(const uscxml_ctx* ctx, const uscxml_transition* transition) {
     if likely(ctx->is_true != NULL) {
         return (ctx->is_true(ctx, "Var1==1"));
     }
     return USCXML_ERR_MISSING_CALLBACK;
 }
-static int _uscxml_7847B274__sub01_transition0_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_9CC10D1D__sub01_transition0_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_send != NULL) {
-        if ((ctx->exec_content_send(ctx, &_uscxml_7847B274__elem_sends[0])) != USCXML_ERR_OK) return err;
+        if ((ctx->exec_content_send(ctx, &_uscxml_9CC10D1D__elem_sends[0])) != USCXML_ERR_OK) return err;
     } else {
         return USCXML_ERR_MISSING_CALLBACK;
     }
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_7847B274__sub01_transition1_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_9CC10D1D__sub01_transition1_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_send != NULL) {
-        if ((ctx->exec_content_send(ctx, &_uscxml_7847B274__elem_sends[1])) != USCXML_ERR_OK) return err;
+        if ((ctx->exec_content_send(ctx, &_uscxml_9CC10D1D__elem_sends[1])) != USCXML_ERR_OK) return err;
     } else {
         return USCXML_ERR_MISSING_CALLBACK;
     }
@@ -771,7 +907,7 @@ static int _uscxml_7847B274__sub01_transition1_on_trans(const uscxml_ctx* ctx, c
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_state _uscxml_7847B274__states[3] = {
+static const uscxml_state _uscxml_9CC10D1D__states[3] = {
     {   /* state number 0 */
         /* name       */ NULL,
         /* parent     */ 0,
@@ -781,7 +917,7 @@ static const uscxml_state _uscxml_7847B274__states[3] = {
         /* children   */ { 0x06 /* 011 */ },
         /* completion */ { 0x02 /* 010 */ }, 	
         /* ancestors  */ { 0x00 /* 000 */ },
-        /* data       */ &_uscxml_7847B274__elem_datas[0],
+        /* data       */ &_uscxml_9CC10D1D__elem_datas[0],
         /* type       */ USCXML_STATE_COMPOUND,
     },
     {   /* state number 1 */
@@ -814,7 +950,7 @@ static const uscxml_state _uscxml_7847B274__states[3] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_transition _uscxml_7847B274__transitions[2] = {
+static const uscxml_transition _uscxml_9CC10D1D__transitions[2] = {
     {   /* transition number 0 with priority 0
            target: subFinal1
          */
@@ -822,8 +958,8 @@ static const uscxml_transition _uscxml_7847B274__transitions[2] = {
         /* target     */ { 0x04 /* 001 */ },
         /* event      */ NULL,
         /* condition  */ "Var1==1",
-        /* is_enabled */ _uscxml_7847B274__sub01_transition0_is_enabled,
-        /* ontrans    */ _uscxml_7847B274__sub01_transition0_on_trans,
+        /* is_enabled */ _uscxml_9CC10D1D__sub01_transition0_is_enabled,
+        /* ontrans    */ _uscxml_9CC10D1D__sub01_transition0_on_trans,
         /* type       */ USCXML_TRANS_SPONTANEOUS,
         /* conflicts  */ { 0x03 /* 11 */ }, 
         /* exit set   */ { 0x06 /* 011 */ }
@@ -836,7 +972,7 @@ static const uscxml_transition _uscxml_7847B274__transitions[2] = {
         /* event      */ NULL,
         /* condition  */ NULL,
         /* is_enabled */ NULL,
-        /* ontrans    */ _uscxml_7847B274__sub01_transition1_on_trans,
+        /* ontrans    */ _uscxml_9CC10D1D__sub01_transition1_on_trans,
         /* type       */ USCXML_TRANS_SPONTANEOUS,
         /* conflicts  */ { 0x03 /* 11 */ }, 
         /* exit set   */ { 0x06 /* 011 */ }
@@ -847,37 +983,63 @@ static const uscxml_transition _uscxml_7847B274__transitions[2] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
+static const char* const _uscxml_9CC10D1D__event_names[1] = {
+    ""
+};
+
+static const unsigned int _uscxml_9CC10D1D__event_slots[1] = {
+    0
+};
+
+static USCXML_BITSET_ALIGNED const unsigned char _uscxml_9CC10D1D__event_transitions[1][USCXML_MAX_NR_TRANS_BYTES] = {
+    { 0x00 /* unknown: 00 */ }
+};
+
+static const uscxml_events _uscxml_9CC10D1D__events = {
+    /* nr_events   */ 1,
+    /* seed        */ 0,
+    /* nr_slots    */ 1,
+    /* names       */ &_uscxml_9CC10D1D__event_names[0],
+    /* slots       */ &_uscxml_9CC10D1D__event_slots[0],
+    /* transitions */ &_uscxml_9CC10D1D__event_transitions[0][0]
+};
+
+#endif
+
+#ifndef USCXML_NO_ELEM_INFO
+
 #ifndef USCXML_MACHINE
-#  define USCXML_MACHINE _uscxml_7847B274__machine
+#  define USCXML_MACHINE _uscxml_9CC10D1D__machine
 #endif
-#define USCXML_MACHINE_1 _uscxml_7847B274__machine
-#define USCXML_MACHINE_TEST240_SCXML_S01_INVOKE0_CONTENT0_SCXML0 _uscxml_7847B274__machine
+#define USCXML_MACHINE_1 _uscxml_9CC10D1D__machine
+#define USCXML_MACHINE_TEST240_SCXML_S01_INVOKE0_CONTENT0_SCXML0 _uscxml_9CC10D1D__machine
 
-const uscxml_machine _uscxml_7847B274__machine = {
+const uscxml_machine _uscxml_9CC10D1D__machine = {
         /* flags          */ 0,
         /* nr_states      */ 3,
         /* nr_transitions */ 2,
         /* name           */ "test240.scxml.s01_invoke0_content0_scxml0",
-        /* datamodel      */ "lua",
-        /* uuid           */ "7847B274CA8610349BFA9F21A78B590E",
-        /* states         */ &_uscxml_7847B274__states[0], 
-        /* transitions    */ &_uscxml_7847B274__transitions[0], 
-        /* parent         */ &_uscxml_ED395C23__machine,
-        /* donedata       */ &_uscxml_7847B274__elem_donedatas[0], 
-        /* script         */ NULL
+        /* datamodel      */ "promela",
+        /* uuid           */ "9CC10D1D9359266E7C47A6B1271C2D52",
+        /* states         */ &_uscxml_9CC10D1D__states[0], 
+        /* transitions    */ &_uscxml_9CC10D1D__transitions[0], 
+        /* parent         */ &_uscxml_CD22315F__machine,
+        /* donedata       */ &_uscxml_9CC10D1D__elem_donedatas[0], 
+        /* script         */ NULL,
+        /* events         */ &_uscxml_9CC10D1D__events
 };
 
 #endif
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_elem_data _uscxml_DB2A83B0__elem_datas[2] = {
+static const uscxml_elem_data _uscxml_FD4E2135__elem_datas[2] = {
     /* id, src, expr, content */
     { "Var1", NULL, "0", NULL },
     { NULL, NULL, NULL, NULL }
 };
 
-static const uscxml_elem_send _uscxml_DB2A83B0__elem_sends[2] = {
+static const uscxml_elem_send _uscxml_FD4E2135__elem_sends[2] = {
     { 
         /* event       */ "success", 
         /* eventexpr   */ NULL, 
@@ -912,7 +1074,7 @@ static const uscxml_elem_send _uscxml_DB2A83B0__elem_sends[2] = {
     }
 };
 
-static const uscxml_elem_donedata _uscxml_DB2A83B0__elem_donedatas[1] = {
+static const uscxml_elem_donedata _uscxml_FD4E2135__elem_donedatas[1] = {
     /* source, content, contentexpr, params */
     { 0, NULL, NULL, NULL }
 };
@@ -925,26 +1087,26 @@ static const uscxml_elem_donedata _uscxml_DB2A83B0__elem_donedatas[1] = {
 
 #ifndef USCXML_NO_EXEC_CONTENT
 
-static int _uscxml_DB2A83B0__sub02_transition0_is_enabled(const uscxml_ctx* ctx, const uscxml_transition* transition) {
+static int _uscxml_FD4E2135__sub02_transition0_is_enabled(const uscxml_ctx* ctx, const uscxml_transition* transition) {
     if likely(ctx->is_true != NULL) {
         return (ctx->is_true(ctx, "Var1==1"));
     }
     return USCXML_ERR_MISSING_CALLBACK;
 }
-static int _uscxml_DB2A83B0__sub02_transition0_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_FD4E2135__sub02_transition0_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_send != NULL) {
-        if ((ctx->exec_content_send(ctx, &_uscxml_DB2A83B0__elem_sends[0])) != USCXML_ERR_OK) return err;
+        if ((ctx->exec_content_send(ctx, &_uscxml_FD4E2135__elem_sends[0])) != USCXML_ERR_OK) return err;
     } else {
         return USCXML_ERR_MISSING_CALLBACK;
     }
     return USCXML_ERR_OK;
 }
 
-static int _uscxml_DB2A83B0__sub02_transition1_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
+static int _uscxml_FD4E2135__sub02_transition1_on_trans(const uscxml_ctx* ctx, const uscxml_state* state, const void* event) {
     int err = USCXML_ERR_OK;
     if likely(ctx->exec_content_send != NULL) {
-        if ((ctx->exec_content_send(ctx, &_uscxml_DB2A83B0__elem_sends[1])) != USCXML_ERR_OK) return err;
+        if ((ctx->exec_content_send(ctx, &_uscxml_FD4E2135__elem_sends[1])) != USCXML_ERR_OK) return err;
     } else {
         return USCXML_ERR_MISSING_CALLBACK;
     }
@@ -955,7 +1117,7 @@ static int _uscxml_DB2A83B0__sub02_transition1_on_trans(const uscxml_ctx* ctx, c
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_state _uscxml_DB2A83B0__states[3] = {
+static const uscxml_state _uscxml_FD4E2135__states[3] = {
     {   /* state number 0 */
         /* name       */ NULL,
         /* parent     */ 0,
@@ -965,7 +1127,7 @@ static const uscxml_state _uscxml_DB2A83B0__states[3] = {
         /* children   */ { 0x06 /* 011 */ },
         /* completion */ { 0x02 /* 010 */ }, 	
         /* ancestors  */ { 0x00 /* 000 */ },
-        /* data       */ &_uscxml_DB2A83B0__elem_datas[0],
+        /* data       */ &_uscxml_FD4E2135__elem_datas[0],
         /* type       */ USCXML_STATE_COMPOUND,
     },
     {   /* state number 1 */
@@ -998,7 +1160,7 @@ static const uscxml_state _uscxml_DB2A83B0__states[3] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
-static const uscxml_transition _uscxml_DB2A83B0__transitions[2] = {
+static const uscxml_transition _uscxml_FD4E2135__transitions[2] = {
     {   /* transition number 0 with priority 0
            target: subFinal2
          */
@@ -1006,8 +1168,8 @@ static const uscxml_transition _uscxml_DB2A83B0__transitions[2] = {
         /* target     */ { 0x04 /* 001 */ },
         /* event      */ NULL,
         /* condition  */ "Var1==1",
-        /* is_enabled */ _uscxml_DB2A83B0__sub02_transition0_is_enabled,
-        /* ontrans    */ _uscxml_DB2A83B0__sub02_transition0_on_trans,
+        /* is_enabled */ _uscxml_FD4E2135__sub02_transition0_is_enabled,
+        /* ontrans    */ _uscxml_FD4E2135__sub02_transition0_on_trans,
         /* type       */ USCXML_TRANS_SPONTANEOUS,
         /* conflicts  */ { 0x03 /* 11 */ }, 
         /* exit set   */ { 0x06 /* 011 */ }
@@ -1020,7 +1182,7 @@ static const uscxml_transition _uscxml_DB2A83B0__transitions[2] = {
         /* event      */ NULL,
         /* condition  */ NULL,
         /* is_enabled */ NULL,
-        /* ontrans    */ _uscxml_DB2A83B0__sub02_transition1_on_trans,
+        /* ontrans    */ _uscxml_FD4E2135__sub02_transition1_on_trans,
         /* type       */ USCXML_TRANS_SPONTANEOUS,
         /* conflicts  */ { 0x03 /* 11 */ }, 
         /* exit set   */ { 0x06 /* 011 */ }
@@ -1031,24 +1193,50 @@ static const uscxml_transition _uscxml_DB2A83B0__transitions[2] = {
 
 #ifndef USCXML_NO_ELEM_INFO
 
+static const char* const _uscxml_FD4E2135__event_names[1] = {
+    ""
+};
+
+static const unsigned int _uscxml_FD4E2135__event_slots[1] = {
+    0
+};
+
+static USCXML_BITSET_ALIGNED const unsigned char _uscxml_FD4E2135__event_transitions[1][USCXML_MAX_NR_TRANS_BYTES] = {
+    { 0x00 /* unknown: 00 */ }
+};
+
+static const uscxml_events _uscxml_FD4E2135__events = {
+    /* nr_events   */ 1,
+    /* seed        */ 0,
+    /* nr_slots    */ 1,
+    /* names       */ &_uscxml_FD4E2135__event_names[0],
+    /* slots       */ &_uscxml_FD4E2135__event_slots[0],
+    /* transitions */ &_uscxml_FD4E2135__event_transitions[0][0]
+};
+
+#endif
+
+#ifndef USCXML_NO_ELEM_INFO
+
 #ifndef USCXML_MACHINE
-#  define USCXML_MACHINE _uscxml_DB2A83B0__machine
+#  define USCXML_MACHINE _uscxml_FD4E2135__machine
 #endif
-#define USCXML_MACHINE_2 _uscxml_DB2A83B0__machine
-#define USCXML_MACHINE_TEST240_SCXML_S02_INVOKE0_CONTENT0_SCXML0 _uscxml_DB2A83B0__machine
+#define USCXML_MACHINE_2 _uscxml_FD4E2135__machine
+#define USCXML_MACHINE_TEST240_SCXML_S02_INVOKE0_CONTENT0_SCXML0 _uscxml_FD4E2135__machine
 
-const uscxml_machine _uscxml_DB2A83B0__machine = {
+const uscxml_machine _uscxml_FD4E2135__machine = {
         /* flags          */ 0,
         /* nr_states      */ 3,
         /* nr_transitions */ 2,
         /* name           */ "test240.scxml.s02_invoke0_content0_scxml0",
-        /* datamodel      */ "lua",
-        /* uuid           */ "DB2A83B067CD692F49AB0A6A6F13C5D0",
-        /* states         */ &_uscxml_DB2A83B0__states[0], 
-        /* transitions    */ &_uscxml_DB2A83B0__transitions[0], 
-        /* parent         */ &_uscxml_ED395C23__machine,
-        /* donedata       */ &_uscxml_DB2A83B0__elem_donedatas[0], 
-        /* script         */ NULL
+        /* datamodel      */ "promela",
+        /* uuid           */ "FD4E2135E29E74143708C02CCB00E101",
+        /* states         */ &_uscxml_FD4E2135__states[0], 
+        /* transitions    */ &_uscxml_FD4E2135__transitions[0], 
+        /* parent         */ &_uscxml_CD22315F__machine,
+        /* donedata       */ &_uscxml_FD4E2135__elem_donedatas[0], 
+        /* script         */ NULL,
+        /* events         */ &_uscxml_FD4E2135__events
 };
 
 #endif
@@ -1086,6 +1274,141 @@ static void printBitsetIndices(const unsigned char* a, size_t length) {
 #endif
 
 #ifndef USCXML_NO_BIT_OPERATIONS
+#ifdef USCXML_BITSET_WORDS
+/**
+ * Bitsets are still addressed as bytes by BIT_HAS and friends, words may alias them.
+ */
+#ifdef _MSC_VER
+typedef uint64_t uscxml_bitset_word;
+#else
+typedef uint64_t __attribute__((__may_alias__)) uscxml_bitset_word;
+#endif
+
+/* bit idx of a word is bit idx of the bitset on little endian machines only */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#  define USCXML_WORD_LE(word) __builtin_bswap64(word)
+#else
+#  define USCXML_WORD_LE(word) (word)
+#endif
+
+/**
+ * Number of trailing zeros in a non-zero word.
+ */
+#ifdef __GNUC__
+#  define bit_ctz(word) ((size_t)__builtin_ctzll(word))
+#else
+static size_t bit_ctz(uint64_t word) {
+    /* de Bruijn sequence, the isolated lowest bit selects a unique index */
+    static const unsigned char positions[64] = {
+        0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+    };
+    return positions[((word & (0 - word)) * 0x03F79D71B4CB0A89ULL) >> 58];
+}
+#endif
+
+/**
+ * Index of the first bit set in a at or after idx, nr_bits if there is none.
+ */
+static size_t bit_next(const unsigned char* a, size_t idx, size_t nr_bits) {
+    const uscxml_bitset_word* words = (const uscxml_bitset_word*)a;
+    size_t nr_words = (nr_bits + 63) >> 6;
+    size_t i = idx >> 6;
+    uint64_t word;
+
+    if (i >= nr_words)
+        return nr_bits;
+    word = USCXML_WORD_LE(words[i]) & (~(uint64_t)0 << (idx & 63));
+    while (word == 0) {
+        if (++i >= nr_words)
+            return nr_bits;
+        word = USCXML_WORD_LE(words[i]);
+    }
+    idx = (i << 6) + bit_ctz(word);
+    return (idx < nr_bits ? idx : nr_bits);
+}
+
+/**
+ * The operations below are the ones for bytes, only a word at a time. The
+ * number of bytes i is a multiple of 8 and, as it is USCXML_MAX_NR_*_BYTES,
+ * constant for the compiler to unroll or vectorize the loops.
+ */
+static int bit_has_and(const unsigned char* a, const unsigned char* b, size_t i) {
+    const uscxml_bitset_word* wa = (const uscxml_bitset_word*)a;
+    const uscxml_bitset_word* wb = (const uscxml_bitset_word*)b;
+    uint64_t common = 0;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        common |= wa[i] & wb[i];
+    }
+    return common != 0;
+}
+
+static void bit_clear_all(unsigned char* a, size_t i) {
+    uscxml_bitset_word* wa = (uscxml_bitset_word*)a;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        wa[i] = 0;
+    }
+}
+
+static int bit_has_any(unsigned const char* a, size_t i) {
+    const uscxml_bitset_word* wa = (const uscxml_bitset_word*)a;
+    uint64_t any = 0;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        any |= wa[i];
+    }
+    return any != 0;
+}
+
+static void bit_or(unsigned char* dest, const unsigned char* mask, size_t i) {
+    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;
+    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        wd[i] |= wm[i];
+    }
+}
+
+static void bit_copy(unsigned char* dest, const unsigned char* source, size_t i) {
+    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;
+    const uscxml_bitset_word* ws = (const uscxml_bitset_word*)source;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        wd[i] = ws[i];
+    }
+}
+
+static void bit_and_not(unsigned char* dest, const unsigned char* mask, size_t i) {
+    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;
+    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        wd[i] &= ~wm[i];
+    }
+}
+
+static void bit_and(unsigned char* dest, const unsigned char* mask, size_t i) {
+    uscxml_bitset_word* wd = (uscxml_bitset_word*)dest;
+    const uscxml_bitset_word* wm = (const uscxml_bitset_word*)mask;
+    i >>= 3;
+    USCXML_UNROLL
+    while(i--) {
+        wd[i] &= wm[i];
+    }
+}
+
+#else /* USCXML_BITSET_WORDS */
+
 /**
  * Return true if there is a common bit in a and b.
  */
@@ -1155,22 +1478,67 @@ static void bit_and(unsigned char* dest, const unsigned char* mask, size_t i) {
     };
 }
 
+#endif /* USCXML_BITSET_WORDS */
 #define USCXML_NO_BIT_OPERATIONS
 #endif
 
 #ifndef USCXML_NO_STEP_FUNCTION
+/**
+ * Id of the longest of the machine's event descriptors matching the given
+ * event name, USCXML_EVENT_UNKNOWN if there is none and -1 if the machine
+ * has no event ids.
+ */
+int uscxml_event_id(const uscxml_machine* machine, const char* name) {
+    const uscxml_events* events = machine->events;
+    const char* descriptor;
+    unsigned int candidate;
+    uint32_t hash;
+    size_t i, j;
+    int event_id = USCXML_EVENT_UNKNOWN;
+
+    if (events == NULL || name == NULL)
+        return -1;
+
+    /* FNV-1a, every prefix up to a dot or the end might be a descriptor */
+    hash = 2166136261UL ^ events->seed;
+    for (i = 0; ; i++) {
+        if (name[i] == '.' || name[i] == '\0') {
+            candidate = events->slots[hash & (events->nr_slots - 1)];
+            if (candidate != USCXML_EVENT_UNKNOWN) {
+                descriptor = events->names[candidate];
+                for (j = 0; j < i && descriptor[j] == name[j]; j++);
+                if (j == i && descriptor[j] == '\0')
+                    event_id = candidate;
+            }
+            if (name[i] == '\0')
+                break;
+        }
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619UL;
+    }
+    return event_id;
+}
+
 int uscxml_step(uscxml_ctx* ctx) {
 
     USCXML_NR_STATES_TYPE i, j, k;
+#ifdef USCXML_BITSET_WORDS
+    /* whole words beyond our states are zero, a constant size unrolls */
+    const size_t nr_states_bytes = USCXML_MAX_NR_STATES_BYTES;
+    const size_t nr_trans_bytes  = USCXML_MAX_NR_TRANS_BYTES;
+#else
     USCXML_NR_STATES_TYPE nr_states_bytes = ((USCXML_NUMBER_STATES + 7) & ~7) >> 3;
     USCXML_NR_TRANS_TYPE  nr_trans_bytes  = ((USCXML_NUMBER_TRANS + 7) & ~7) >> 3;
+#endif
     int err = USCXML_ERR_OK;
-    unsigned char conflicts  [USCXML_MAX_NR_TRANS_BYTES];
-    unsigned char trans_set  [USCXML_MAX_NR_TRANS_BYTES];
-    unsigned char target_set [USCXML_MAX_NR_STATES_BYTES];
-    unsigned char exit_set   [USCXML_MAX_NR_STATES_BYTES];
-    unsigned char entry_set  [USCXML_MAX_NR_STATES_BYTES];
-    unsigned char tmp_states [USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char conflicts  [USCXML_MAX_NR_TRANS_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char trans_set  [USCXML_MAX_NR_TRANS_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char target_set [USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char exit_set   [USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char entry_set  [USCXML_MAX_NR_STATES_BYTES];
+    USCXML_BITSET_ALIGNED unsigned char tmp_states [USCXML_MAX_NR_STATES_BYTES];
+    const unsigned char* event_trans;
+    int event_id;
 
 #ifdef USCXML_VERBOSE
     printf("Config: ");
@@ -1186,14 +1554,11 @@ int uscxml_step(uscxml_ctx* ctx) {
         while(i-- > 0) {
             if (BIT_HAS(i, ctx->config)) {
                 /* call all on exit handlers */
-                if (USCXML_GET_STATE(i).on_exit != NULL) {
-                    if unlikely((err = USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)
-                        return err;
-                }
+                if unlikely((err = USCXML_ON_EXIT(i)) != USCXML_ERR_OK)
+                    return err;
             }
             if (BIT_HAS(i, ctx->invocations)) {
-                if (USCXML_GET_STATE(i).invoke != NULL)
-                    USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 1);
+                USCXML_INVOKE(i, 1);
                 BIT_CLEAR(i, ctx->invocations);
             }
         }
@@ -1204,8 +1569,7 @@ int uscxml_step(uscxml_ctx* ctx) {
     bit_clear_all(target_set, nr_states_bytes);
     bit_clear_all(trans_set, nr_trans_bytes);
     if unlikely(ctx->flags == USCXML_CTX_PRISTINE) {
-        if (ctx->machine->script != NULL)
-            ctx->machine->script(ctx, &ctx->machine->states[0], NULL);
+        USCXML_ON_SCRIPT();
         bit_or(target_set, ctx->machine->states[0].completion, nr_states_bytes);
         ctx->flags |= USCXML_CTX_SPONTANEOUS | USCXML_CTX_INITIALIZED;
         goto ESTABLISH_ENTRY_SET;
@@ -1224,14 +1588,12 @@ DEQUEUE_EVENT:
     for (i = 0; i < USCXML_NUMBER_STATES; i++) {
         /* uninvoke */
         if (!BIT_HAS(i, ctx->config) && BIT_HAS(i, ctx->invocations)) {
-            if (USCXML_GET_STATE(i).invoke != NULL)
-                USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 1);
+            USCXML_INVOKE(i, 1);
             BIT_CLEAR(i, ctx->invocations)
         }
         /* invoke */
         if (BIT_HAS(i, ctx->config) && !BIT_HAS(i, ctx->invocations)) {
-            if (USCXML_GET_STATE(i).invoke != NULL)
-                USCXML_GET_STATE(i).invoke(ctx, &USCXML_GET_STATE(i), NULL, 0);
+            USCXML_INVOKE(i, 0);
             BIT_SET_AT(i, ctx->invocations)
         }
     }
@@ -1248,7 +1610,23 @@ DEQUEUE_EVENT:
 SELECT_TRANSITIONS:
     bit_clear_all(conflicts, nr_trans_bytes);
     bit_clear_all(exit_set, nr_states_bytes);
+
+    /* transitions enabled by the event, if the host can identify it */
+    event_trans = NULL;
+    if (ctx->event != NULL && ctx->event_id != NULL && ctx->machine->events != NULL) {
+        event_id = ctx->event_id(ctx, ctx->event);
+        if (event_id >= 0 && (unsigned int)event_id < ctx->machine->events->nr_events)
+            event_trans = &ctx->machine->events->transitions[event_id * USCXML_MAX_NR_TRANS_BYTES];
+    }
+
+#ifdef USCXML_BITSET_WORDS
+    /* no other transitions are enabled by an event we identified */
+    for (i = (event_trans != NULL ? bit_next(event_trans, 0, USCXML_NUMBER_TRANS) : 0);
+         i < USCXML_NUMBER_TRANS;
+         i = (event_trans != NULL ? bit_next(event_trans, i + 1, USCXML_NUMBER_TRANS) : i + 1)) {
+#else
     for (i = 0; i < USCXML_NUMBER_TRANS; i++) {
+#endif
         /* never select history or initial transitions automatically */
         if unlikely(USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL))
             continue;
@@ -1261,7 +1639,8 @@ SELECT_TRANSITIONS:
                 if ((USCXML_GET_TRANS(i).event == NULL && ctx->event == NULL) || 
                     (USCXML_GET_TRANS(i).event != NULL && ctx->event != NULL)) {
                     /* is it enabled? */
-                    if ((ctx->event == NULL || ctx->is_matched(ctx, &USCXML_GET_TRANS(i), ctx->event) > 0) &&
+                    if ((ctx->event == NULL ||
+                         (event_trans != NULL ? BIT_HAS(i, event_trans) : ctx->is_matched(ctx, &USCXML_GET_TRANS(i), ctx->event) > 0)) &&
                         (USCXML_GET_TRANS(i).condition == NULL || 
                          USCXML_GET_TRANS(i).is_enabled(ctx, &USCXML_GET_TRANS(i)) > 0)) {
                         /* remember that we found a transition */
@@ -1332,102 +1711,98 @@ ESTABLISH_ENTRY_SET:
     bit_copy(entry_set, target_set, nr_states_bytes);
 
     /* iterate for ancestors */
-    for (i = 0; i < USCXML_NUMBER_STATES; i++) {
-        if (BIT_HAS(i, entry_set)) {
-            bit_or(entry_set, USCXML_GET_STATE(i).ancestors, nr_states_bytes);
-        }
+    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {
+        bit_or(entry_set, USCXML_GET_STATE(i).ancestors, nr_states_bytes);
     }
 
     /* iterate for descendants */
-    for (i = 0; i < USCXML_NUMBER_STATES; i++) {
-        if (BIT_HAS(i, entry_set)) {
-            switch (USCXML_STATE_MASK(USCXML_GET_STATE(i).type)) {
-                case USCXML_STATE_PARALLEL: {
-                    bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);
-                    break;
-                }
+    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {
+        switch (USCXML_STATE_MASK(USCXML_GET_STATE(i).type)) {
+            case USCXML_STATE_PARALLEL: {
+                bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);
+                break;
+            }
 #ifndef USCXML_NO_HISTORY
-                case USCXML_STATE_HISTORY_SHALLOW:
-                case USCXML_STATE_HISTORY_DEEP: {
-                    if (!bit_has_and(USCXML_GET_STATE(i).completion, ctx->history, nr_states_bytes) &&
-                        !BIT_HAS(USCXML_GET_STATE(i).parent, ctx->config)) {
-                        /* nothing set for history, look for a default transition */
-                        for (j = 0; j < USCXML_NUMBER_TRANS; j++) {
-                            if unlikely(ctx->machine->transitions[j].source == i) {
-                                bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);
-                                if(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP &&
-                                   !bit_has_and(ctx->machine->transitions[j].target, USCXML_GET_STATE(i).children, nr_states_bytes)) {
-                                    for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {
-                                        if (BIT_HAS(k, ctx->machine->transitions[j].target)) {
-                                            bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);
-                                            break;
-                                        }
+            case USCXML_STATE_HISTORY_SHALLOW:
+            case USCXML_STATE_HISTORY_DEEP: {
+                if (!bit_has_and(USCXML_GET_STATE(i).completion, ctx->history, nr_states_bytes) &&
+                    !BIT_HAS(USCXML_GET_STATE(i).parent, ctx->config)) {
+                    /* nothing set for history, look for a default transition */
+                    for (j = 0; j < USCXML_NUMBER_TRANS; j++) {
+                        if unlikely(ctx->machine->transitions[j].source == i) {
+                            bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);
+                            if(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP &&
+                               !bit_has_and(ctx->machine->transitions[j].target, USCXML_GET_STATE(i).children, nr_states_bytes)) {
+                                for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {
+                                    if (BIT_HAS(k, ctx->machine->transitions[j].target)) {
+                                        bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);
+                                        break;
                                     }
                                 }
-                                BIT_SET_AT(j, trans_set);
-                                break;
                             }
-                            /* Note: SCXML mandates every history to have a transition! */
+                            BIT_SET_AT(j, trans_set);
+                            break;
                         }
-                    } else {
-                        bit_copy(tmp_states, USCXML_GET_STATE(i).completion, nr_states_bytes);
-                        bit_and(tmp_states, ctx->history, nr_states_bytes);
-                        bit_or(entry_set, tmp_states, nr_states_bytes);
-                        if (USCXML_GET_STATE(i).type == (USCXML_STATE_HAS_HISTORY | USCXML_STATE_HISTORY_DEEP)) {
-                            /* a deep history state with nested histories -> more completion */
-                            for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {
-                                if (BIT_HAS(j, USCXML_GET_STATE(i).completion) &&
-                                    BIT_HAS(j, entry_set) &&
-                                    (ctx->machine->states[j].type & USCXML_STATE_HAS_HISTORY)) {
-                                    for (k = j + 1; k < USCXML_NUMBER_STATES; k++) {
-                                        /* add nested history to entry_set */
-                                        if ((USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_DEEP ||
-                                             USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_SHALLOW) &&
-                                            BIT_HAS(k, ctx->machine->states[j].children)) {
-                                            /* a nested history state */
-                                            BIT_SET_AT(k, entry_set);
-                                        }
+                        /* Note: SCXML mandates every history to have a transition! */
+                    }
+                } else {
+                    bit_copy(tmp_states, USCXML_GET_STATE(i).completion, nr_states_bytes);
+                    bit_and(tmp_states, ctx->history, nr_states_bytes);
+                    bit_or(entry_set, tmp_states, nr_states_bytes);
+                    if (USCXML_GET_STATE(i).type == (USCXML_STATE_HAS_HISTORY | USCXML_STATE_HISTORY_DEEP)) {
+                        /* a deep history state with nested histories -> more completion */
+                        for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {
+                            if (BIT_HAS(j, USCXML_GET_STATE(i).completion) &&
+                                BIT_HAS(j, entry_set) &&
+                                (ctx->machine->states[j].type & USCXML_STATE_HAS_HISTORY)) {
+                                for (k = j + 1; k < USCXML_NUMBER_STATES; k++) {
+                                    /* add nested history to entry_set */
+                                    if ((USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_DEEP ||
+                                         USCXML_STATE_MASK(ctx->machine->states[k].type) == USCXML_STATE_HISTORY_SHALLOW) &&
+                                        BIT_HAS(k, ctx->machine->states[j].children)) {
+                                        /* a nested history state */
+                                        BIT_SET_AT(k, entry_set);
                                     }
                                 }
                             }
                         }
                     }
-                    break;
                 }
+                break;
+            }
 #endif
-                case USCXML_STATE_INITIAL: {
-                    for (j = 0; j < USCXML_NUMBER_TRANS; j++) {
-                        if (ctx->machine->transitions[j].source == i) {
-                            BIT_SET_AT(j, trans_set);
-                            BIT_CLEAR(i, entry_set);
-                            bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);
-                            for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {
-                                if (BIT_HAS(k, ctx->machine->transitions[j].target)) {
-                                    bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);
-                                }
+            case USCXML_STATE_INITIAL: {
+                for (j = 0; j < USCXML_NUMBER_TRANS; j++) {
+                    if (ctx->machine->transitions[j].source == i) {
+                        BIT_SET_AT(j, trans_set);
+                        BIT_CLEAR(i, entry_set);
+                        bit_or(entry_set, ctx->machine->transitions[j].target, nr_states_bytes);
+                        for (k = i + 1; k < USCXML_NUMBER_STATES; k++) {
+                            if (BIT_HAS(k, ctx->machine->transitions[j].target)) {
+                                bit_or(entry_set, ctx->machine->states[k].ancestors, nr_states_bytes);
                             }
                         }
                     }
-                    break;
                 }
-                case USCXML_STATE_COMPOUND: { /* we need to check whether one child is already in entry_set */
-                    if (!bit_has_and(entry_set, USCXML_GET_STATE(i).children, nr_states_bytes) &&
-                        (!bit_has_and(ctx->config, USCXML_GET_STATE(i).children, nr_states_bytes) ||
-                         bit_has_and(exit_set, USCXML_GET_STATE(i).children, nr_states_bytes)))
-                    {
-                        bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);
-                        if (!bit_has_and(USCXML_GET_STATE(i).completion, USCXML_GET_STATE(i).children, nr_states_bytes)) {
-                            /* deep completion */
-                            for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {
-                                if (BIT_HAS(j, USCXML_GET_STATE(i).completion)) {
-                                    bit_or(entry_set, ctx->machine->states[j].ancestors, nr_states_bytes);
-                                    break; /* completion of compound is single state */
-                                }
+                break;
+            }
+            case USCXML_STATE_COMPOUND: { /* we need to check whether one child is already in entry_set */
+                if (!bit_has_and(entry_set, USCXML_GET_STATE(i).children, nr_states_bytes) &&
+                    (!bit_has_and(ctx->config, USCXML_GET_STATE(i).children, nr_states_bytes) ||
+                     bit_has_and(exit_set, USCXML_GET_STATE(i).children, nr_states_bytes)))
+                {
+                    bit_or(entry_set, USCXML_GET_STATE(i).completion, nr_states_bytes);
+                    if (!bit_has_and(USCXML_GET_STATE(i).completion, USCXML_GET_STATE(i).children, nr_states_bytes)) {
+                        /* deep completion */
+                        for (j = i + 1; j < USCXML_NUMBER_STATES; j++) {
+                            if (BIT_HAS(j, USCXML_GET_STATE(i).completion)) {
+                                bit_or(entry_set, ctx->machine->states[j].ancestors, nr_states_bytes);
+                                break; /* completion of compound is single state */
                             }
                         }
                     }
-                    break;
                 }
+                break;
             }
         }
     }
@@ -1442,24 +1817,18 @@ ESTABLISH_ENTRY_SET:
     while(i-- > 0) {
         if (BIT_HAS(i, exit_set) && BIT_HAS(i, ctx->config)) {
             /* call all on exit handlers */
-            if (USCXML_GET_STATE(i).on_exit != NULL) {
-                if unlikely((err = USCXML_GET_STATE(i).on_exit(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)
-                    return err;
-            }
+            if unlikely((err = USCXML_ON_EXIT(i)) != USCXML_ERR_OK)
+                return err;
             BIT_CLEAR(i, ctx->config);
         }
     }
 
 /* TAKE_TRANSITIONS: */
-    for (i = 0; i < USCXML_NUMBER_TRANS; i++) {
-        if (BIT_HAS(i, trans_set) && (USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) == 0) {
+    BIT_FOR_EACH(i, trans_set, USCXML_NUMBER_TRANS) {
+        if ((USCXML_GET_TRANS(i).type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) == 0) {
             /* call executable content in transition */
-            if (USCXML_GET_TRANS(i).on_transition != NULL) {
-                if unlikely((err = USCXML_GET_TRANS(i).on_transition(ctx,
-                                                                              &ctx->machine->states[USCXML_GET_TRANS(i).source],
-                                                                              ctx->event)) != USCXML_ERR_OK)
-                    return err;
-            }
+            if unlikely((err = USCXML_ON_TRANS(i, USCXML_GET_TRANS(i).source)) != USCXML_ERR_OK)
+                return err;
         }
     }
 
@@ -1469,8 +1838,8 @@ ESTABLISH_ENTRY_SET:
 #endif
 
 /* ENTER_STATES: */
-    for (i = 0; i < USCXML_NUMBER_STATES; i++) {
-        if (BIT_HAS(i, entry_set) && !BIT_HAS(i, ctx->config)) {
+    BIT_FOR_EACH(i, entry_set, USCXML_NUMBER_STATES) {
+        if (!BIT_HAS(i, ctx->config)) {
             /* these are no proper states */
             if unlikely(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_DEEP ||
                         USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_HISTORY_SHALLOW ||
@@ -1481,35 +1850,26 @@ ESTABLISH_ENTRY_SET:
 
             /* initialize data */
             if (!BIT_HAS(i, ctx->initialized_data)) {
-                if unlikely(USCXML_GET_STATE(i).data != NULL && ctx->exec_content_init != NULL) {
-                    ctx->exec_content_init(ctx, USCXML_GET_STATE(i).data);
-                }
+                USCXML_INIT_DATA(i);
                 BIT_SET_AT(i, ctx->initialized_data);
             }
 
-            if (USCXML_GET_STATE(i).on_entry != NULL) {
-                if unlikely((err = USCXML_GET_STATE(i).on_entry(ctx, &USCXML_GET_STATE(i), ctx->event)) != USCXML_ERR_OK)
-                    return err;
-            }
+            if unlikely((err = USCXML_ON_ENTRY(i)) != USCXML_ERR_OK)
+                return err;
 
             /* take history and initial transitions */
-            for (j = 0; j < USCXML_NUMBER_TRANS; j++) {
-                if unlikely(BIT_HAS(j, trans_set) &&
-                            (ctx->machine->transitions[j].type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) &&
+            BIT_FOR_EACH(j, trans_set, USCXML_NUMBER_TRANS) {
+                if unlikely((ctx->machine->transitions[j].type & (USCXML_TRANS_HISTORY | USCXML_TRANS_INITIAL)) &&
                             ctx->machine->states[ctx->machine->transitions[j].source].parent == i) {
                     /* call executable content in transition */
-                    if (ctx->machine->transitions[j].on_transition != NULL) {
-                        if unlikely((err = ctx->machine->transitions[j].on_transition(ctx,
-                                                                                      &USCXML_GET_STATE(i),
-                                                                                      ctx->event)) != USCXML_ERR_OK)
-                            return err;
-                    }
+                    if unlikely((err = USCXML_ON_TRANS(j, i)) != USCXML_ERR_OK)
+                        return err;
                 }
             }
 
             /* handle final states */
             if unlikely(USCXML_STATE_MASK(USCXML_GET_STATE(i).type) == USCXML_STATE_FINAL) {
-                if unlikely(USCXML_GET_STATE(i).ancestors[0] == 0x01) {
+                if unlikely(USCXML_GET_STATE(i).parent == 0) {
                     ctx->flags |= USCXML_CTX_TOP_LEVEL_FINAL;
                 } else {
                     /* raise done event */
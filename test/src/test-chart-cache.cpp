@@ -0,0 +1,215 @@
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/invoker/scxml/ChartTemplateCache.h"
+#include "uscxml/server/HTTPServer.h"
+#include "uscxml/util/DOM.h"
+
+#include <xercesc/dom/DOM.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <stdio.h>
+
+using namespace uscxml;
+using namespace XERCESC_NS;
+
+static const char* chartFile = "test-chart-cache.scxml";
+
+static std::string chart(const std::string& finalId) {
+	return "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\"><final id=\"" + finalId + "\" /></scxml>";
+}
+
+static void writeChart(const std::string& finalId) {
+	std::ofstream file(chartFile);
+	file << chart(finalId);
+}
+
+/// Serves a chart and counts how often it was fetched
+class ChartServlet : public HTTPServlet {
+public:
+	bool requestFromHTTP(const HTTPServer::Request& request) {
+		// before replying, the client checks right after it got the reply
+		requests++;
+		HTTPServer::Reply reply(request);
+		reply.content = chart(finalId);
+		reply.headers["Content-Type"] = "application/scxml+xml";
+		HTTPServer::reply(reply);
+		return true;
+	}
+	void setURL(const std::string& url) {
+		this->url = url;
+	}
+
+	std::string url;
+	std::string finalId;
+	std::atomic<size_t> requests;
+};
+
+static std::string finalId(Interpreter& interpreter) {
+	DOMElement* scxml = interpreter.getImpl()->getDocument()->getDocumentElement();
+	std::list<DOMElement*> finals = DOMUtils::filterChildElements("final", scxml);
+	assert(finals.size() == 1);
+	return ATTR(finals.front(), X("id"));
+}
+
+static void runToCompletion(Interpreter& interpreter) {
+	while (interpreter.step() != USCXML_FINISHED) {}
+}
+
+void testURLCaching() {
+	ChartTemplateCache& cache = ChartTemplateCache::getInstance();
+	cache.clear();
+	ChartTemplateCache::Stats before = cache.getStats();
+
+	writeChart("first");
+	Interpreter i1 = cache.fromURL(chartFile);
+	Interpreter i2 = cache.fromURL(chartFile);
+
+	ChartTemplateCache::Stats stats = cache.getStats();
+	assert(stats.misses == before.misses + 1);
+	assert(stats.hits == before.hits + 1);
+	assert(stats.size == 1);
+
+	// every session works on a copy of its own
+	assert(i1.getImpl()->getDocument() != i2.getImpl()->getDocument());
+	assert(finalId(i1) == "first");
+	assert(finalId(i2) == "first");
+	runToCompletion(i1);
+	runToCompletion(i2);
+
+	// a changed file is parsed again
+	writeChart("second");
+	Interpreter i3 = cache.fromURL(chartFile);
+	stats = cache.getStats();
+	assert(stats.misses == before.misses + 2);
+	assert(stats.hits == before.hits + 1);
+	assert(finalId(i3) == "second");
+	runToCompletion(i3);
+
+	// so is one changed to the same size, once its modification time differs
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	writeChart("fourth");
+	Interpreter i4 = cache.fromURL(chartFile);
+	stats = cache.getStats();
+	assert(stats.misses == before.misses + 3);
+	assert(stats.size == 1);
+	assert(finalId(i4) == "fourth");
+
+	remove(chartFile);
+}
+
+void testRemoteCaching() {
+	ChartTemplateCache& cache = ChartTemplateCache::getInstance();
+	cache.clear();
+
+	ChartServlet servlet;
+	servlet.requests = 0;
+	servlet.finalId = "first";
+	assert(HTTPServer::registerServlet("/chart-cache", &servlet));
+
+	// fetched once while fresh
+	Interpreter i1 = cache.fromURL(servlet.url);
+	servlet.finalId = "second";
+	Interpreter i2 = cache.fromURL(servlet.url);
+	assert(servlet.requests == 1);
+	assert(finalId(i1) == "first");
+	assert(finalId(i2) == "first");
+
+	// and again once stale
+	cache.setRemoteTTL(0);
+	Interpreter i3 = cache.fromURL(servlet.url);
+	assert(servlet.requests == 2);
+	assert(finalId(i3) == "second");
+	assert(cache.getStats().size == 1);
+
+	cache.setRemoteTTL(USCXML_CHART_CACHE_DEFAULT_REMOTE_TTL);
+	HTTPServer::unregisterServlet(&servlet);
+}
+
+void testXMLCaching() {
+	ChartTemplateCache& cache = ChartTemplateCache::getInstance();
+	cache.clear();
+	ChartTemplateCache::Stats before = cache.getStats();
+
+	const char* xml =
+	    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+	    "  <final id=\"inline\" />"
+	    "</scxml>";
+
+	Interpreter i1 = cache.fromXML(xml, "");
+	Interpreter i2 = cache.fromXML(xml, "");
+	Interpreter i3 = cache.fromXML(std::string(xml) + " ", "");
+
+	ChartTemplateCache::Stats stats = cache.getStats();
+	assert(stats.misses == before.misses + 2);
+	assert(stats.hits == before.hits + 1);
+	assert(finalId(i2) == "inline");
+
+	// the least recently used template goes first
+	cache.setMaxSize(1);
+	stats = cache.getStats();
+	assert(stats.size == 1);
+	assert(stats.evictions == before.evictions + 1);
+	cache.setMaxSize(USCXML_CHART_CACHE_DEFAULT_SIZE);
+}
+
+void testElementCaching() {
+	ChartTemplateCache& cache = ChartTemplateCache::getInstance();
+	cache.clear();
+	ChartTemplateCache::Stats before = cache.getStats();
+
+	const char* xml =
+	    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" xmlns:foo=\"http://example.com/foo\" datamodel=\"null\">"
+	    "  <state id=\"s0\">"
+	    "    <invoke type=\"scxml\">"
+	    "      <content>"
+	    "        <scxml datamodel=\"null\" foo:bar=\"baz\">"
+	    "          <final id=\"nested\" />"
+	    "        </scxml>"
+	    "      </content>"
+	    "    </invoke>"
+	    "  </state>"
+	    "</scxml>";
+
+	Interpreter parent = Interpreter::fromXML(xml, "");
+	DOMNodeList* nested = parent.getImpl()->getDocument()->getElementsByTagNameNS(X("http://www.w3.org/2005/07/scxml"), X("scxml"));
+	assert(nested->getLength() == 2);
+	DOMElement* content = static_cast<DOMElement*>(nested->item(1));
+
+	Interpreter i1 = cache.fromElement(content, "");
+	Interpreter i2 = cache.fromElement(content, "");
+
+	ChartTemplateCache::Stats stats = cache.getStats();
+	assert(stats.misses == before.misses + 1);
+	assert(stats.hits == before.hits + 1);
+	assert(finalId(i1) == "nested");
+
+	// namespace declarations of the invoking document are carried over
+	DOMElement* scxml = i2.getImpl()->getDocument()->getDocumentElement();
+	assert(HAS_ATTR(scxml, X("xmlns")));
+	assert(ATTR(scxml, X("xmlns")) == "http://www.w3.org/2005/07/scxml");
+	assert(ATTR(scxml, X("xmlns:foo")) == "http://example.com/foo");
+	runToCompletion(i1);
+	runToCompletion(i2);
+}
+
+int main(int argc, char** argv) {
+	HTTPServer::getInstance(8213, 8214);
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testURLCaching();
+		testRemoteCaching();
+		testXMLCaching();
+		testElementCaching();
+	} catch (ErrorEvent e) {
+		std::cout << e;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+#define protected public
+#include "uscxml/config.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/invoker/dirmon/DirMonInvoker.h"
+#include "uscxml/interpreter/Logging.h"
+#undef protected
+
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace uscxml;
+
+/// Collects the events the invoker sends to its session
+class Callbacks : public InvokerCallbacks {
+public:
+	void enqueueInternal(const Event& event) {
+		enqueueExternal(event);
+	}
+	void enqueueExternal(const Event& event) {
+		std::lock_guard<std::mutex> lock(mutex);
+		events.push_back(event);
+		cond.notify_all();
+	}
+	ActionLanguage* getActionLanguage() {
+		return NULL;
+	}
+	std::set<InterpreterMonitor*> getMonitors() {
+		return std::set<InterpreterMonitor*>();
+	}
+	std::string getBaseURL() {
+		return "file:///";
+	}
+	Logger getLogger() {
+		return Logger::getDefault();
+	}
+	Factory* getFactory() {
+		return &Factory::getInstance();
+	}
+
+	/// Block until the invoker reported the given event for a file
+	bool waitFor(const std::string& name, const std::string& relPath, int timeoutMs = 2000) {
+		std::unique_lock<std::mutex> lock(mutex);
+		std::chrono::system_clock::time_point until = std::chrono::system_clock::now() + std::chrono::milliseconds(timeoutMs);
+		while(true) {
+			for (auto& event : events) {
+				if (event.name == name && event.data.compound["file"].compound["relPath"].atom == relPath)
+					return true;
+			}
+			if (cond.wait_until(lock, until) == std::cv_status::timeout)
+				return false;
+		}
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		events.clear();
+	}
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::list<Event> events;
+};
+
+static void writeFile(const std::string& path, const std::string& content, bool append = false) {
+	std::ofstream file(path.c_str(), append ? std::ios::app : std::ios::trunc);
+	file << content;
+}
+
+/// Let the invoker see everything pending, so later events stem from later changes
+static void settle(Callbacks& callbacks) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	callbacks.clear();
+}
+
+void testChanges(const std::string& dir, bool poll) {
+	writeFile(dir + "/existing.txt", "existing");
+
+	Callbacks callbacks;
+	DirMonInvoker prototype;
+	std::shared_ptr<InvokerImpl> impl = prototype.create(&callbacks);
+	DirMonInvoker* invoker = (DirMonInvoker*)impl.get();
+
+	Event invokeEvent;
+	invokeEvent.params.insert(std::make_pair("dir", Data(dir, Data::VERBATIM)));
+	invokeEvent.params.insert(std::make_pair("recurse", Data("true", Data::VERBATIM)));
+	if (poll)
+		invokeEvent.params.insert(std::make_pair("poll", Data("true", Data::VERBATIM)));
+	invoker->invoke("", invokeEvent);
+
+	// notifications unless we asked for polling
+	assert(invoker->_watcher->hasNotifications() == !poll);
+	assert(callbacks.waitFor("file.existing", "/existing.txt"));
+	settle(callbacks);
+
+	// create
+	writeFile(dir + "/a.txt", "a");
+	assert(callbacks.waitFor("file.added", "/a.txt"));
+	settle(callbacks);
+
+	// modify, polling only rescans the directory when its own mtime changed
+	if (!poll) {
+		writeFile(dir + "/a.txt", "more", true);
+		assert(callbacks.waitFor("file.modified", "/a.txt"));
+		settle(callbacks);
+	}
+
+	// delete
+	assert(unlink((dir + "/a.txt").c_str()) == 0);
+	assert(callbacks.waitFor("file.deleted", "/a.txt"));
+	settle(callbacks);
+
+	// in new subdirectories as well
+	assert(mkdir((dir + "/sub").c_str(), 0700) == 0);
+	writeFile(dir + "/sub/b.txt", "b");
+	assert(callbacks.waitFor("file.added", "/sub/b.txt"));
+	settle(callbacks);
+
+	if (!poll) {
+		writeFile(dir + "/sub/b.txt", "more", true);
+		assert(callbacks.waitFor("file.modified", "/sub/b.txt"));
+		settle(callbacks);
+	}
+
+	assert(unlink((dir + "/sub/b.txt").c_str()) == 0);
+	assert(callbacks.waitFor("file.deleted", "/sub/b.txt"));
+	assert(rmdir((dir + "/sub").c_str()) == 0);
+
+	// hidden files are not reported
+	writeFile(dir + "/.hidden", "hidden");
+	writeFile(dir + "/c.txt", "c");
+	assert(callbacks.waitFor("file.added", "/c.txt"));
+	assert(!callbacks.waitFor("file.added", "/.hidden", 100));
+
+	invoker->uninvoke();
+	assert(invoker->_watcher->hasNotifications() == !poll);
+
+	unlink((dir + "/.hidden").c_str());
+	unlink((dir + "/c.txt").c_str());
+	unlink((dir + "/existing.txt").c_str());
+}
+
+int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
+	char tmpl[] = "/tmp/uscxml-dirmon-XXXXXX";
+	char* tmpDir = mkdtemp(tmpl);
+	assert(tmpDir != NULL);
+
+	try {
+		testChanges(tmpDir, false);
+		testChanges(tmpDir, true);
+	} catch (Event e) {
+		LOGD(USCXML_FATAL) << e;
+		rmdir(tmpDir);
+		return EXIT_FAILURE;
+	}
+
+	rmdir(tmpDir);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include <stdlib.h> // getenv, rand
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+// the machine is generated with -X batch=soa and included via -include
+#ifndef AUTOINCLUDE_TEST
+#error "Compile with -include <machine>.c generated by uscxml-transform -tc -X batch=soa"
+#endif
+
+/**
+ * Steps many instances of a machine with uscxml_step_batch and the same
+ * number of contexts with uscxml_step one after the other, compares their
+ * configurations and whether they finished, and prints the events
+ * delivered per second of both.
+ */
+
+static const char* eventNames[] = {
+	"tick", "power.on", "power.off", "power.sleep",
+	"link.up", "link.down", "link.send", "link.ack",
+	"alarm.raise", "alarm.ack", "alarm.clear"
+};
+static const size_t nrEventNames = sizeof(eventNames) / sizeof(eventNames[0]);
+
+struct Event {
+	const char* name;
+	int id;
+};
+
+static Event* pendingEvent = NULL;
+
+static void* dequeueInternal(const uscxml_ctx* ctx) {
+	return NULL;
+}
+
+static void* dequeueExternal(const uscxml_ctx* ctx) {
+	Event* event = pendingEvent;
+	pendingEvent = NULL;
+	return event;
+}
+
+static int eventId(const uscxml_ctx* ctx, const void* event) {
+	return ((const Event*)event)->id;
+}
+
+static int isMatched(const uscxml_ctx* ctx, const uscxml_transition* t, const void* event) {
+	const char* name = ((const Event*)event)->name;
+	size_t length = strlen(t->event);
+	if (strcmp(t->event, "*") == 0)
+		return 1;
+	return strncmp(name, t->event, length) == 0 && (name[length] == '\0' || name[length] == '.');
+}
+
+static int raiseDoneEvent(const uscxml_ctx* ctx, const uscxml_state* state, const uscxml_elem_donedata* donedata) {
+	return USCXML_ERR_OK;
+}
+
+static void setCallbacks(uscxml_ctx* ctx) {
+	ctx->machine = &USCXML_MACHINE;
+	ctx->dequeue_internal = dequeueInternal;
+	ctx->dequeue_external = dequeueExternal;
+	ctx->is_matched = isMatched;
+	ctx->event_id = eventId;
+	ctx->raise_done_event = raiseDoneEvent;
+}
+
+int main(int argc, char** argv) {
+	size_t nrInstances = 1000000;
+	size_t nrEvents = 200;
+
+	const char* envInstances = getenv("USCXML_BATCH_INSTANCES");
+	if (envInstances != NULL)
+		nrInstances = strtoul(envInstances, NULL, 10);
+	const char* envEvents = getenv("USCXML_BATCH_EVENTS");
+	if (envEvents != NULL)
+		nrEvents = strtoul(envEvents, NULL, 10);
+
+	Event events[nrEventNames];
+	for (size_t i = 0; i < nrEventNames; i++) {
+		events[i].name = eventNames[i];
+		events[i].id = uscxml_event_id(&USCXML_MACHINE, eventNames[i]);
+	}
+
+	// every event goes to a random half of the instances
+	srand(42);
+	size_t stride = USCXML_BATCH_STRIDE(nrInstances);
+	std::vector<size_t> sequence(nrEvents);
+	std::vector<uint64_t> recipients(nrEvents * stride / 64);
+	for (size_t i = 0; i < nrEvents; i++) {
+		sequence[i] = rand() % nrEventNames;
+		for (size_t j = 0; j < stride / 64; j++) {
+			recipients[i * stride / 64 + j] = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+		}
+	}
+
+	// one context per instance
+	std::vector<uscxml_ctx> contexts(nrInstances);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < nrInstances; i++) {
+		memset(&contexts[i], 0, sizeof(uscxml_ctx));
+		setCallbacks(&contexts[i]);
+		while (uscxml_step(&contexts[i]) == USCXML_ERR_OK);
+	}
+	std::chrono::steady_clock::time_point initialized = std::chrono::steady_clock::now();
+	size_t delivered = 0;
+	for (size_t i = 0; i < nrEvents; i++) {
+		const uint64_t* to = &recipients[i * stride / 64];
+		for (size_t j = 0; j < nrInstances; j++) {
+			if (!(to[j >> 6] & ((uint64_t)1 << (j & 63))))
+				continue;
+			pendingEvent = &events[sequence[i]];
+			while (uscxml_step(&contexts[j]) == USCXML_ERR_OK);
+			delivered++;
+		}
+	}
+	std::chrono::steady_clock::time_point stepped = std::chrono::steady_clock::now();
+	double contextInit = std::chrono::duration<double>(initialized - start).count();
+	double contextSteps = std::chrono::duration<double>(stepped - initialized).count();
+
+	// the same instances in a batch
+	uscxml_batch batch;
+	memset(&batch, 0, sizeof(uscxml_batch));
+	setCallbacks(&batch.ctx);
+	std::vector<uint64_t> config(USCXML_BATCH_STATE_WORDS * stride);
+	std::vector<uint64_t> history(USCXML_BATCH_STATE_WORDS * stride);
+	std::vector<uint64_t> initializedData(USCXML_BATCH_STATE_WORDS * stride);
+	std::vector<unsigned char> flags(stride);
+	std::vector<uint64_t> finished(stride / 64);
+	batch.nr_instances = nrInstances;
+	batch.config = &config[0];
+	batch.history = &history[0];
+	batch.initialized_data = &initializedData[0];
+	batch.flags = &flags[0];
+	batch.finished = &finished[0];
+
+	start = std::chrono::steady_clock::now();
+	if (uscxml_batch_init(&batch) != USCXML_ERR_OK) {
+		std::cerr << "Initializing the batch failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	initialized = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < nrEvents; i++) {
+		Event* event = &events[sequence[i]];
+		if (uscxml_step_batch(&batch, event, event->id, &recipients[i * stride / 64]) != USCXML_ERR_OK) {
+			std::cerr << "Stepping instance " << batch.instance << " failed" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	stepped = std::chrono::steady_clock::now();
+	double batchInit = std::chrono::duration<double>(initialized - start).count();
+	double batchSteps = std::chrono::duration<double>(stepped - initialized).count();
+
+	for (size_t i = 0; i < nrInstances; i++) {
+		for (size_t j = 0; j < USCXML_MACHINE.nr_states; j++) {
+			if (!BIT_HAS(j, contexts[i].config) != !uscxml_batch_in_state(&batch, i, j)) {
+				std::cerr << "Instance " << i << " differs in state " << j << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		bool batchFinished = (finished[i >> 6] & ((uint64_t)1 << (i & 63))) != 0;
+		if (!(contexts[i].flags & USCXML_CTX_FINISHED) != !batchFinished) {
+			std::cerr << "Instance " << i << " differs in being finished" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::cout << nrInstances << " instances, " << delivered << " events delivered" << std::endl;
+	std::cout << "contexts: " << contextInit << "s to initialize, "
+	          << (contextSteps > 0 ? delivered / contextSteps : 0) << " events/s" << std::endl;
+	std::cout << "batch:    " << batchInit << "s to initialize, "
+	          << (batchSteps > 0 ? delivered / batchSteps : 0) << " events/s" << std::endl;
+	return EXIT_SUCCESS;
+}
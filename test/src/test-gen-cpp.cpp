@@ -0,0 +1,473 @@
+#include <stdlib.h> // getenv
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+
+// the machine is included via -include by ctest/scripts/test_generated_cpp.cmake
+#ifndef AUTOINCLUDE_TEST
+#error "Compile with a machine generated by uscxml-transform -tcpp included first"
+#endif
+
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/dom/DOM.hpp>
+
+#include "uscxml/Interpreter.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/DataModel.h"
+#include "uscxml/plugins/DataModelImpl.h"
+#include "uscxml/plugins/IOProcessor.h"
+#include "uscxml/plugins/IOProcessorImpl.h"
+#include "uscxml/plugins/Invoker.h"
+#include "uscxml/interpreter/ContentExecutor.h"
+#include "uscxml/interpreter/BasicContentExecutor.h"
+#include "uscxml/interpreter/Logging.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/UUID.h"
+#include "uscxml/util/Convenience.h"
+
+using namespace uscxml;
+using namespace XERCESC_NS;
+
+namespace chart = USCXML_CPP_MACHINE;
+
+class Host;
+typedef chart::Machine<Host> Machine;
+
+/**
+ * Callbacks of a generated machine backed by a datamodel from the factory.
+ * Conditions are evaluated and blocks of executable content interpreted
+ * from the sources embedded in the machine's tables.
+ */
+class Host : public DataModelCallbacks, public IOProcessorCallbacks, public ContentExecutorCallbacks {
+public:
+	Host();
+	virtual ~Host();
+
+	static bool guard(Machine& machine, chart::Guard guard);
+	static void action(Machine& machine, chart::Action action);
+	static bool dequeueInternal(Machine& machine, chart::Event& event);
+	static bool dequeueExternal(Machine& machine, chart::Event& event);
+	static void raiseDone(Machine& machine, chart::Event event, size_t state, chart::Action donedata);
+
+	/// Wait for the earliest delayed event and dispatch it, false if there is none
+	bool awaitDelayed();
+
+	// DataModelCallbacks / IOProcessorCallbacks
+	const std::string& getName() {
+		return _name;
+	}
+	const std::string& getSessionId() {
+		return _sessionId;
+	}
+	const std::map<std::string, IOProcessor>& getIOProcessors() {
+		return _ioProcs;
+	}
+	bool isInState(const std::string& stateId);
+	DOMDocument* getDocument() const {
+		return NULL;
+	}
+	const std::map<std::string, Invoker>& getInvokers() {
+		return _invokers;
+	}
+	Logger getLogger() {
+		return Logger::getDefault();
+	}
+
+	void enqueueInternal(const Event& event);
+	void enqueueExternal(const Event& event);
+	void enqueueAtInvoker(const std::string& invokeId, const Event& event) {
+		ERROR_COMMUNICATION_THROW("Invocations are not supported by generated C++ machines");
+	}
+	void enqueueAtParent(const Event& event) {
+		ERROR_COMMUNICATION_THROW("Invocations are not supported by generated C++ machines");
+	}
+
+	// ContentExecutorCallbacks
+	void enqueueExternalDelayed(const Event& event, size_t delayMs, const std::string& eventUUID);
+	void cancelDelayed(const std::string& sendId);
+
+	bool isTrue(const std::string& expr);
+	size_t getLength(const std::string& expr) {
+		return _dataModel.getLength(expr);
+	}
+	void setForeach(const std::string& item, const std::string& array, const std::string& index, uint32_t iteration) {
+		_dataModel.setForeach(item, array, index, iteration);
+	}
+	Data evalAsData(const std::string& expr) {
+		return _dataModel.evalAsData(expr);
+	}
+	void eval(const std::string& expr) {
+		_dataModel.eval(expr);
+	}
+	Data getAsData(const std::string& expr) {
+		return _dataModel.getAsData(expr);
+	}
+	void assign(const std::string& location, const Data& data, const std::map<std::string, std::string>& attrs) {
+		_dataModel.assign(location, data, attrs);
+	}
+	bool isValidExprSyntax(const std::string& expr) {
+		return _dataModel.isValidExprSyntax(expr);
+	}
+	bool isValidScriptSyntax(const std::string& script) {
+		return _dataModel.isValidScriptSyntax(script);
+	}
+
+	std::string getInvokeId() {
+		return "";
+	}
+	std::string getBaseURL() {
+		return "";
+	}
+	bool checkValidSendType(const std::string& type, const std::string& target);
+	void enqueue(const std::string& type, const std::string& target, size_t delayMs, const Event& sendEvent);
+	void invoke(const std::string& type, const std::string& src, bool autoForward, DOMElement* finalize, const Event& invokeEvent) {
+		ERROR_EXECUTION_THROW("Invocations are not supported by generated C++ machines");
+	}
+	void uninvoke(const std::string& invokeId) {}
+
+	const Event& getCurrentEvent() {
+		return _currEvent;
+	}
+
+	std::set<InterpreterMonitor*> getMonitors() {
+		return std::set<InterpreterMonitor*>();
+	}
+	Interpreter getInterpreter() {
+		return Interpreter();
+	}
+	ExecutableContent createExecutableContent(const std::string& localName, const std::string& nameSpace) {
+		// the factory instantiates custom executable content for interpreters only
+		ERROR_EXECUTION_THROW("Custom executable content is not supported by generated C++ machines");
+	}
+
+protected:
+	struct Delayed {
+		std::chrono::steady_clock::time_point due;
+		std::string uuid;
+		std::string sendId;
+		std::string type;
+		std::string target;
+		Event event;
+	};
+
+	/// The parsed source of an action, wrapped into an scxml element
+	DOMElement* actionRoot(chart::Action action, const std::string& wrapper = "");
+	void execute(chart::Action action);
+	void dispatch(const std::string& type, const std::string& target, const Event& event);
+
+	std::string _name;
+	std::string _sessionId;
+	DataModel _dataModel;
+	ContentExecutor _execContent;
+	std::map<std::string, IOProcessor> _ioProcs;
+	std::map<std::string, Invoker> _invokers;
+
+	Event _currEvent;
+	std::deque<Event> _internalQueue;
+	std::deque<Event> _externalQueue;
+	std::list<Delayed> _delayed;
+	std::recursive_mutex _mutex;
+
+	std::map<chart::Action, DOMDocument*> _documents;
+};
+
+Host::Host() {
+	_sessionId = UUID::getUUID();
+	_dataModel = Factory::getInstance().createDataModel(chart::datamodel, this);
+	_execContent = ContentExecutor(std::shared_ptr<ContentExecutorImpl>(new BasicContentExecutor(this, &Factory::getInstance())));
+
+	// as in NativeSession::getIOProcessors
+	std::map<std::string, IOProcessorImpl*> allIOProcs = Factory::getInstance().getIOProcessors();
+	for (auto ioProcImpl : allIOProcs) {
+		_ioProcs[ioProcImpl.first] = Factory::getInstance().createIOProcessor(ioProcImpl.first, this);
+		std::list<std::string> names = ioProcImpl.second->getNames();
+		for (auto name : names) {
+			_ioProcs[name] = _ioProcs[ioProcImpl.first];
+		}
+	}
+}
+
+Host::~Host() {
+	for (auto document : _documents) {
+		delete document.second;
+	}
+}
+
+bool Host::isInState(const std::string& stateId) {
+	return static_cast<Machine*>(this)->isInState(stateId.c_str());
+}
+
+DOMElement* Host::actionRoot(chart::Action action, const std::string& wrapper) {
+	if (_documents.find(action) != _documents.end())
+		return _documents[action]->getDocumentElement();
+
+	std::string source = Machine::Chart::actionSources[(size_t)action];
+	// blocks are serialized one by one, drop any xml declarations
+	size_t declaration;
+	while ((declaration = source.find("<?xml")) != std::string::npos) {
+		source.erase(declaration, source.find("?>", declaration) + 2 - declaration);
+	}
+	if (wrapper.size() > 0) {
+		source = "<" + wrapper + ">" + source + "</" + wrapper.substr(0, wrapper.find(' ')) + ">";
+	}
+	std::string xml = "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\">" + source + "</scxml>";
+
+	std::unique_ptr<XercesDOMParser> parser(new XercesDOMParser());
+	std::unique_ptr<ErrorHandler> errHandler(new HandlerBase());
+
+	try {
+		parser->setDoNamespaces(true);
+		parser->useScanner(XMLUni::fgWFXMLScanner);
+		parser->setErrorHandler(errHandler.get());
+
+		MemBufInputSource is((XMLByte*)xml.c_str(), xml.size(), X("fake"));
+		parser->parse(is);
+		_documents[action] = parser->adoptDocument();
+
+	} catch (const SAXParseException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	} catch (const XMLException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	} catch (const DOMException& toCatch) {
+		ERROR_PLATFORM_THROW(X(toCatch.getMessage()).str());
+	}
+
+	return _documents[action]->getDocumentElement();
+}
+
+void Host::execute(chart::Action action) {
+	DOMElement* root = actionRoot(action);
+	for (DOMElement* block = root->getFirstElementChild(); block; block = block->getNextElementSibling()) {
+		try {
+			if (TAGNAME(block) == "datamodel") {
+				std::list<DOMElement*> datas = DOMUtils::filterChildElements("data", block);
+				for (auto data : datas) {
+					try {
+						// as in InterpreterImpl::initData, e.g. for the type of promela variables
+						std::map<std::string, std::string> attrs;
+						DOMNamedNodeMap* xmlAttrs = data->getAttributes();
+						for (size_t i = 0; i < xmlAttrs->getLength(); i++) {
+							attrs[X(xmlAttrs->item(i)->getNodeName()).str()] = X(xmlAttrs->item(i)->getNodeValue()).str();
+						}
+						_dataModel.init(ATTR(data, kXMLCharId), _execContent.elementAsData(data), attrs);
+					} catch (ErrorEvent e) {
+						// test 277
+						enqueueInternal(e);
+					}
+				}
+			} else {
+				_execContent.process(block);
+			}
+		} catch (Event e) {
+			// an error aborts the block, test 159, the executor already raised it
+		}
+	}
+}
+
+bool Host::guard(Machine& machine, chart::Guard guard) {
+	return machine.isTrue(Machine::Chart::guardSources[(size_t)guard]);
+}
+
+void Host::action(Machine& machine, chart::Action action) {
+	machine.execute(action);
+}
+
+void Host::raiseDone(Machine& machine, chart::Event event, size_t state, chart::Action donedata) {
+	const char* name = Machine::Chart::states[state].name;
+	if (donedata == chart::Action::None) {
+		machine.enqueueInternal(Event(std::string("done.state.") + (name != NULL ? name : "")));
+		return;
+	}
+
+	// raiseDoneEvent wants the donedata within its final state
+	DOMElement* root = machine.actionRoot(donedata, std::string("final id=\"") + (name != NULL ? name : "") + "\"");
+	DOMElement* finalState = root->getFirstElementChild();
+	try {
+		machine._execContent.raiseDoneEvent(finalState, finalState->getFirstElementChild());
+	} catch (Event e) {
+		machine.enqueueInternal(e);
+	}
+}
+
+bool Host::dequeueInternal(Machine& machine, chart::Event& event) {
+	if (machine._internalQueue.empty())
+		return false;
+
+	machine._currEvent = machine._internalQueue.front();
+	machine._internalQueue.pop_front();
+	machine._currEvent.eventType = Event::INTERNAL;
+	machine._dataModel.setEvent(machine._currEvent);
+	event = Machine::eventFromName(machine._currEvent.name.c_str());
+	return true;
+}
+
+bool Host::dequeueExternal(Machine& machine, chart::Event& event) {
+	std::lock_guard<std::recursive_mutex> lock(machine._mutex);
+	if (machine._externalQueue.empty())
+		return false;
+
+	machine._currEvent = machine._externalQueue.front();
+	machine._externalQueue.pop_front();
+	machine._currEvent.eventType = Event::EXTERNAL;
+	machine._dataModel.setEvent(machine._currEvent);
+	event = Machine::eventFromName(machine._currEvent.name.c_str());
+	return true;
+}
+
+bool Host::isTrue(const std::string& expr) {
+	try {
+		return _dataModel.evalAsBool(expr);
+	} catch (ErrorEvent e) {
+		// test 244, 344: undefined is false and raises error.execution
+		enqueueInternal(e);
+		return false;
+	}
+}
+
+void Host::enqueueInternal(const Event& event) {
+	_internalQueue.push_back(event);
+}
+
+void Host::enqueueExternal(const Event& event) {
+	// I/O processors might deliver from other threads
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_externalQueue.push_back(event);
+}
+
+void Host::enqueueExternalDelayed(const Event& event, size_t delayMs, const std::string& eventUUID) {
+	enqueue("", "", delayMs, event);
+}
+
+bool Host::checkValidSendType(const std::string& type, const std::string& target) {
+	if (_ioProcs.find(type) == _ioProcs.end()) {
+		ERROR_EXECUTION_THROW("Type '" + type + "' not supported for sending");
+	}
+	if (!_ioProcs[type].isValidTarget(target)) {
+		ERROR_COMMUNICATION_THROW("Target '" + target + "' not supported in send");
+	}
+	return true;
+}
+
+void Host::dispatch(const std::string& type, const std::string& target, const Event& event) {
+	// test 172
+	std::string ioProcType = (type.size() > 0 ? type : "http://www.w3.org/TR/scxml/#SCXMLEventProcessor");
+	if (_ioProcs.find(ioProcType) == _ioProcs.end()) {
+		ERROR_PLATFORM_THROW("No IO processor " + ioProcType + " known");
+	}
+	if (target == "#_scxml_" + _sessionId) {
+		// we are no interpreter the SCXML I/O processor could look up, test 336
+		_ioProcs[ioProcType].eventFromSCXML("", event);
+		return;
+	}
+	_ioProcs[ioProcType].eventFromSCXML(target, event);
+}
+
+void Host::enqueue(const std::string& type, const std::string& target, size_t delayMs, const Event& sendEvent) {
+	if (delayMs == 0) {
+		dispatch(type, target, sendEvent);
+		return;
+	}
+
+	Delayed delayed;
+	delayed.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+	delayed.uuid = sendEvent.uuid;
+	delayed.sendId = sendEvent.sendid;
+	delayed.type = type;
+	delayed.target = target;
+	delayed.event = sendEvent;
+
+	// keep them ordered by due time, the same ones in the order they were sent
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	auto position = _delayed.begin();
+	while (position != _delayed.end() && position->due <= delayed.due)
+		position++;
+	_delayed.insert(position, delayed);
+}
+
+void Host::cancelDelayed(const std::string& sendId) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	for (auto delayedIter = _delayed.begin(); delayedIter != _delayed.end();) {
+		if (delayedIter->sendId == sendId) {
+			delayedIter = _delayed.erase(delayedIter);
+		} else {
+			delayedIter++;
+		}
+	}
+}
+
+bool Host::awaitDelayed() {
+	Delayed delayed;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_delayed.empty())
+			return false;
+		delayed = _delayed.front();
+		_delayed.pop_front();
+	}
+
+	std::this_thread::sleep_until(delayed.due);
+	try {
+		dispatch(delayed.type, delayed.target, delayed.event);
+	} catch (ErrorEvent e) {
+		// the send element is long done
+		e.sendid = delayed.sendId;
+		enqueueInternal(e);
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	size_t benchmarkRuns = 1;
+	const char* envBenchmarkRuns = getenv("USCXML_BENCHMARK_ITERATIONS");
+	if (envBenchmarkRuns != NULL) {
+		benchmarkRuns = strTo<size_t>(envBenchmarkRuns);
+	}
+
+	Factory::getInstance().registerPlugins();
+
+	size_t totalMicroSteps = 0;
+	std::chrono::steady_clock::duration stepTime(0);
+
+	try {
+		for (size_t run = 0; run < benchmarkRuns; run++) {
+			std::unique_ptr<Machine> machine(new Machine());
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			chart::Result result;
+			while ((result = machine->step()) != chart::Result::Done) {
+				if (result == chart::Result::Ok) {
+					totalMicroSteps++;
+				} else if (!machine->awaitDelayed()) {
+					std::cerr << "Machine is idle without pending events" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+
+			stepTime += std::chrono::steady_clock::now() - start;
+
+			if (!machine->isInState("pass")) {
+				std::cerr << "Machine did not end in pass" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	} catch (Event e) {
+		LOGD(USCXML_FATAL) << e;
+		exit(EXIT_FAILURE);
+	}
+
+	if (benchmarkRuns > 1) {
+		double seconds = std::chrono::duration<double>(stepTime).count();
+		std::cout << benchmarkRuns << " runs with " << totalMicroSteps << " microsteps in " << seconds << "s: "
+		          << (seconds > 0 ? totalMicroSteps / seconds : 0) << " microsteps/s" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#include "uscxml/config.h"
+#include "uscxml/server/HTTPServer.h"
+#include "uscxml/util/Convenience.h"
+
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace uscxml;
+
+static unsigned short port = 8231;
+
+class ReplyingServlet : public HTTPServlet {
+public:
+	ReplyingServlet(const std::string& content, int delayMs = 0) : _content(content), _delayMs(delayMs) {}
+
+	bool requestFromHTTP(const HTTPServer::Request& request) {
+		raw = request.getRaw();
+		if (_delayMs > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(_delayMs));
+
+		HTTPServer::Reply reply(request);
+		reply.content = _content;
+		reply.headers["Content-Type"] = "text/plain";
+		HTTPServer::reply(reply);
+		return true;
+	}
+	void setURL(const std::string& url) {}
+	bool canAdaptPath() {
+		return false;
+	}
+
+	std::string raw;
+
+protected:
+	std::string _content;
+	int _delayMs;
+};
+
+// a plain socket, so we control the header order on the wire
+static std::string request(const std::string& path, const std::string& headers = "") {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	assert(fd >= 0);
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return "";
+	}
+
+	std::string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "Content-Type: text/plain\r\nConnection: close\r\n\r\n";
+	send(fd, req.data(), req.size(), 0);
+
+	std::string response;
+	char buffer[1024];
+	ssize_t read;
+	while ((read = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+		response.append(buffer, read);
+	close(fd);
+	return response;
+}
+
+static bool isOk(const std::string& response, const std::string& content) {
+	return response.compare(0, 12, "HTTP/1.1 200") == 0 &&
+	       response.size() >= content.size() &&
+	       response.compare(response.size() - content.size(), content.size(), content) == 0;
+}
+
+void testRawHeaderOrder() {
+	ReplyingServlet servlet("ordered");
+	assert(HTTPServer::registerServlet("order", &servlet));
+
+	std::string response = request("/order", "Zeta: 1\r\nAlpha: 2\r\nZeta: 3\r\n");
+	assert(isOk(response, "ordered"));
+	HTTPServer::unregisterServlet(&servlet);
+
+	// as sent, not sorted by name and with the repeated header twice
+	std::cout << servlet.raw << std::endl;
+	size_t host = servlet.raw.find("Host: localhost");
+	size_t zeta1 = servlet.raw.find("Zeta: 1");
+	size_t alpha = servlet.raw.find("Alpha: 2");
+	size_t zeta3 = servlet.raw.find("Zeta: 3");
+	assert(servlet.raw.compare(0, 11, "GET /order ") == 0);
+	assert(host != std::string::npos && zeta1 != std::string::npos && alpha != std::string::npos && zeta3 != std::string::npos);
+	assert(host < zeta1 && zeta1 < alpha && alpha < zeta3);
+}
+
+void testRegisterWhileServing() {
+	ReplyingServlet slow("slow", 5);
+	assert(HTTPServer::registerServlet("slow", &slow));
+
+	// keep all loops busy in the slow servlet
+	std::atomic<bool> done(false);
+	std::atomic<size_t> served(0);
+	std::atomic<size_t> failed(0);
+	std::vector<std::thread> clients;
+	for (size_t i = 0; i < 8; i++) {
+		clients.push_back(std::thread([&]() {
+			while (!done) {
+				if (isOk(request("/slow"), "slow")) {
+					served++;
+				} else {
+					failed++;
+				}
+			}
+		}));
+	}
+
+	// servlets come and go while requests are in flight
+	for (size_t i = 0; i < 50; i++) {
+		ReplyingServlet dynamic("dynamic" + toStr(i));
+		assert(HTTPServer::registerServlet("dynamic" + toStr(i), &dynamic));
+		assert(isOk(request("/dynamic" + toStr(i)), "dynamic" + toStr(i)));
+		HTTPServer::unregisterServlet(&dynamic);
+	}
+
+	done = true;
+	for (auto& client : clients)
+		client.join();
+	HTTPServer::unregisterServlet(&slow);
+
+	std::cout << served << " requests served, " << failed << " failed" << std::endl;
+	assert(served > 0);
+	assert(failed == 0);
+}
+
+int main(int argc, char** argv) {
+	// one listener per loop on the same port, see SO_REUSEPORT
+	HTTPServer::setThreads(4);
+	HTTPServer::getInstance(port, port + 1);
+
+	testRawHeaderOrder();
+	testRegisterWhileServing();
+
+	return EXIT_SUCCESS;
+}
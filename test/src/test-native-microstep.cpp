@@ -0,0 +1,188 @@
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/interpreter/InterpreterMonitor.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/transform/NativeMicroStep.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/String.h"
+
+#include <fstream>
+#include <iostream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace uscxml;
+using namespace XERCESC_NS;
+
+class RecordingMonitor : public InterpreterMonitor {
+public:
+	virtual void beforeProcessingEvent(Interpreter& interpreter, const Event& event) {
+		trace.push_back("event " + event.name);
+	}
+	virtual void beforeMicroStep(Interpreter& interpreter) {
+		microSteps++;
+	}
+	virtual void beforeExitingState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+		trace.push_back("exit " + ATTR(state, X("id")));
+	}
+	virtual void beforeTakingTransition(Interpreter& interpreter, const XERCESC_NS::DOMElement* transition) {
+		trace.push_back("transition " + ATTR(transition, X("target")));
+	}
+	virtual void beforeEnteringState(Interpreter& interpreter, const XERCESC_NS::DOMElement* state) {
+		trace.push_back("enter " + ATTR(state, X("id")));
+	}
+	virtual void onStableConfiguration(Interpreter& interpreter) {
+		trace.push_back("stable");
+	}
+	virtual void beforeCompletion(Interpreter& interpreter) {
+		trace.push_back("completion");
+	}
+
+	std::list<std::string> trace;
+	size_t microSteps = 0;
+};
+
+static const char* xml =
+    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\" initial=\"s1\">"
+    "  <state id=\"s1\">"
+    "    <onentry><raise event=\"internal\" /></onentry>"
+    "    <transition event=\"internal\" target=\"s2\" />"
+    "  </state>"
+    "  <state id=\"s2\">"
+    "    <transition event=\"external\" target=\"done\" />"
+    "  </state>"
+    "  <final id=\"done\" />"
+    "</scxml>";
+
+static const char* parentXML =
+    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+    "  <state id=\"s0\">"
+    "    <invoke id=\"child\" type=\"scxml\" src=\"child.scxml\" />"
+    "    <transition event=\"done.invoke\" target=\"done\" />"
+    "  </state>"
+    "  <final id=\"done\" />"
+    "</scxml>";
+
+static const char* childXML =
+    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+    "  <final id=\"childDone\" />"
+    "</scxml>";
+
+static RecordingMonitor run(Interpreter interpreter, bool native, bool expectNative = true) {
+	RecordingMonitor monitor;
+	interpreter.addMonitor(&monitor);
+
+	std::shared_ptr<NativeMicroStep> microStepper;
+	if (native) {
+		microStepper = std::shared_ptr<NativeMicroStep>(new NativeMicroStep(interpreter.getImpl().get()));
+		ActionLanguage al;
+		al.microStepper = MicroStep(microStepper);
+		interpreter.setActionLanguage(al);
+	}
+
+	// deliver the external event once the chart settled in s2
+	bool sent = false;
+	InterpreterState state;
+	while ((state = interpreter.step(0)) != USCXML_FINISHED) {
+		if (!sent && (state == USCXML_MACROSTEPPED || state == USCXML_IDLE)) {
+			interpreter.receive(Event("external"));
+			sent = true;
+		}
+	}
+
+	if (native) {
+		// fails only when there is no C compiler, FastMicroStep would be used instead
+		assert(microStepper->isNative() == expectNative);
+	}
+	return monitor;
+}
+
+static void writeFile(const std::string& path, const std::string& content) {
+	std::ofstream file(path.c_str());
+	file << content;
+}
+
+static std::list<std::string> sharedObjects(const std::string& dir) {
+	std::list<std::string> objects;
+	DIR* dp = opendir(dir.c_str());
+	assert(dp != NULL);
+	struct dirent* entry;
+	while ((entry = readdir(dp)) != NULL) {
+		std::string name = entry->d_name;
+		if (name.size() > 3 && name.substr(name.size() - 3) == ".so")
+			objects.push_back(dir + "/" + name);
+	}
+	closedir(dp);
+	return objects;
+}
+
+static mode_t modeOf(const std::string& path) {
+	struct stat st;
+	assert(lstat(path.c_str(), &st) == 0);
+	assert(st.st_uid == geteuid());
+	return st.st_mode & 0777;
+}
+
+int main(int argc, char** argv) {
+	// compile into a cache directory of our own
+	char tmpTemplate[] = "/tmp/uscxml-native-test.XXXXXX";
+	std::string tmpDir = mkdtemp(tmpTemplate);
+	setenv("TMPDIR", tmpDir.c_str(), 1);
+	std::string cacheDir = tmpDir + "/uscxml-native." + toStr(geteuid());
+
+	Factory::getInstance().registerPlugins();
+
+	try {
+		RecordingMonitor fast = run(Interpreter::fromXML(xml, ""), false);
+		RecordingMonitor native = run(Interpreter::fromXML(xml, ""), true);
+
+		for (auto line : native.trace) {
+			std::cout << line << std::endl;
+		}
+
+		assert(!native.trace.empty());
+		assert(native.trace == fast.trace);
+		assert(native.microSteps == fast.microSteps);
+
+		// only we can read the cache directory and write to the objects in it
+		assert(modeOf(cacheDir) == 0700);
+		std::list<std::string> objects = sharedObjects(cacheDir);
+		assert(objects.size() == 1);
+		assert((modeOf(objects.front()) & 0022) == 0);
+
+		// an object others could have written is compiled again, never loaded
+		chmod(objects.front().c_str(), 0777);
+		run(Interpreter::fromXML(xml, ""), true);
+		assert((modeOf(objects.front()) & 0022) == 0);
+
+		// nothing is loaded from a cache directory others can access
+		chmod(cacheDir.c_str(), 0755);
+		run(Interpreter::fromXML(xml, ""), true, false);
+		chmod(cacheDir.c_str(), 0700);
+
+		// relative src attributes resolve against the chart and the invoked chart is part of the object
+		std::string chartDir = tmpDir + "/charts";
+		mkdir(chartDir.c_str(), 0700);
+		writeFile(chartDir + "/parent.scxml", parentXML);
+		writeFile(chartDir + "/child.scxml", childXML);
+
+		RecordingMonitor fastParent = run(Interpreter::fromURL(chartDir + "/parent.scxml"), false);
+		RecordingMonitor nativeParent = run(Interpreter::fromURL(chartDir + "/parent.scxml"), true);
+		assert(nativeParent.trace == fastParent.trace);
+
+		// one for the parent and one for the child, invoked with the microstepper of its parent
+		assert(sharedObjects(cacheDir).size() == 3);
+
+		writeFile(chartDir + "/child.scxml", std::string(childXML).replace(std::string(childXML).find("childDone"), 9, "otherDone"));
+		run(Interpreter::fromURL(chartDir + "/parent.scxml"), true);
+		assert(sharedObjects(cacheDir).size() == 5);
+
+	} catch (ErrorEvent e) {
+		std::cout << e;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+// the machine has to use the types of the library
+#include "uscxml/native/NativeTypes.h"
+#include "test-c-machine.scxml.c"
+
+#include "uscxml/native/NativeRuntime.h"
+#include "uscxml/native/NativeSession.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/interpreter/Logging.h"
+
+using namespace uscxml;
+
+void testEventPool() {
+	NativeEventPool pool;
+	assert(pool.capacity() == 0);
+
+	// grows by whole chunks
+	std::set<NativeEvent*> acquired;
+	for (size_t i = 0; i < USCXML_NATIVE_POOL_CHUNK + 1; i++) {
+		NativeEvent* event = pool.acquire();
+		assert(event->next == NULL);
+		acquired.insert(event);
+	}
+	assert(acquired.size() == USCXML_NATIVE_POOL_CHUNK + 1);
+	assert(pool.capacity() == 2 * USCXML_NATIVE_POOL_CHUNK);
+	assert(pool.available() == USCXML_NATIVE_POOL_CHUNK - 1);
+
+	// a released event is handed out next and cleared
+	NativeEvent* event = *acquired.begin();
+	acquired.erase(event);
+	event->event.name = "foo.bar";
+	event->event.sendid = "send1";
+	event->event.data = Data("baz", Data::VERBATIM);
+	event->target = "#_parent";
+	pool.release(event);
+
+	NativeEvent* recycled = pool.acquire();
+	assert(recycled == event);
+	assert(recycled->event.name.size() == 0);
+	assert(recycled->event.sendid.size() == 0);
+	assert(recycled->event.data.empty());
+	assert(recycled->target.size() == 0);
+	pool.release(recycled);
+
+	// copies the given event
+	Event original("copied");
+	original.data.compound["key"] = Data("value", Data::VERBATIM);
+	NativeEvent* copy = pool.acquire(original);
+	assert(copy->event.name == "copied");
+	assert(copy->event.data.compound["key"].atom == "value");
+	acquired.insert(copy);
+
+	// queues are released at once
+	NativeEventQueue queue;
+	for (auto pooled : acquired) {
+		queue.push(pooled);
+	}
+	NativeEventQueue other;
+	other.push(pool.acquire());
+	queue.append(other);
+	assert(other.empty());
+
+	pool.release(queue);
+	assert(queue.empty());
+	assert(pool.available() == pool.capacity());
+	assert(pool.capacity() == 2 * USCXML_NATIVE_POOL_CHUNK);
+
+	// concurrent producers and consumers only ever recycle
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < 4; i++) {
+		threads.push_back(std::thread([&pool]() {
+			for (size_t j = 0; j < 10000; j++) {
+				NativeEvent* pooled = pool.acquire();
+				pooled->event.name = "e";
+				pool.release(pooled);
+			}
+		}));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	assert(pool.available() == pool.capacity());
+	assert(pool.capacity() <= 2 * USCXML_NATIVE_POOL_CHUNK);
+}
+
+void testTimerWheel() {
+	NativeEventPool pool;
+	NativeRuntime runtime(0);
+
+	// the wheel only needs sessions, run them to completion first
+	NativeSession* session1 = runtime.create(&USCXML_MACHINE);
+	NativeSession* session2 = runtime.create(&USCXML_MACHINE);
+	runtime.run();
+
+	NativeTimerWheel wheel;
+	std::list<NativeTimerWheel::Timer*> timers;
+
+	// expire in order of their due ticks, beyond a revolution as well
+	uint64_t before = wheel.now();
+	wheel.schedule(session1, pool.acquire(Event("late")), 3 * USCXML_NATIVE_WHEEL_SLOTS + 7, "late");
+	wheel.schedule(session1, pool.acquire(Event("first")), 5, "first");
+	wheel.schedule(session2, pool.acquire(Event("second")), 5, "second");
+	wheel.schedule(session1, pool.acquire(Event("third")), 20, "third");
+	uint64_t after = wheel.now();
+	assert(wheel.size() == 4);
+
+	wheel.advance(before + 4, timers);
+	assert(timers.size() == 0);
+	assert(wheel.nextExpiration() >= before + 5 && wheel.nextExpiration() <= after + 5);
+
+	wheel.advance(after + 5, timers);
+	assert(timers.size() == 2);
+	assert(timers.front()->event->event.name == "first");
+	assert(timers.back()->event->event.name == "second");
+	assert(timers.back()->session == session2);
+
+	wheel.advance(after + 20, timers);
+	assert(timers.size() == 3);
+	assert(timers.back()->event->event.name == "third");
+
+	// not one revolution earlier
+	wheel.advance(before + 2 * USCXML_NATIVE_WHEEL_SLOTS + 7, timers);
+	assert(timers.size() == 3);
+	assert(wheel.size() == 1);
+	wheel.advance(after + 3 * USCXML_NATIVE_WHEEL_SLOTS + 7, timers);
+	assert(timers.size() == 4);
+	assert(timers.back()->event->event.name == "late");
+	assert(wheel.size() == 0);
+
+	for (auto timer : timers) {
+		pool.release(timer->event);
+		wheel.release(timer);
+	}
+	timers.clear();
+
+	// the ticks above ran ahead of the clock, start over
+	NativeTimerWheel cancelling;
+
+	// cancelling only removes timers of the given session and send id
+	cancelling.schedule(session1, pool.acquire(Event("a")), 10, "cancelled");
+	cancelling.schedule(session1, pool.acquire(Event("b")), 10, "kept");
+	cancelling.schedule(session1, pool.acquire(Event("c")), 1000, "cancelled");
+	cancelling.schedule(session2, pool.acquire(Event("d")), 10, "cancelled");
+	assert(cancelling.size() == 4);
+
+	cancelling.cancel(session1, "cancelled", timers);
+	assert(timers.size() == 2);
+	assert(cancelling.size() == 2);
+	for (auto timer : timers) {
+		assert(timer->session == session1);
+		assert(timer->sendId == "cancelled");
+		pool.release(timer->event);
+		cancelling.release(timer);
+	}
+	timers.clear();
+
+	cancelling.cancelAll(session2, timers);
+	assert(timers.size() == 1);
+	assert(timers.front()->event->event.name == "d");
+	assert(cancelling.size() == 1);
+	pool.release(timers.front()->event);
+	cancelling.release(timers.front());
+	timers.clear();
+
+	cancelling.advance(cancelling.now() + 10, timers);
+	assert(timers.size() == 1);
+	assert(timers.front()->event->event.name == "b");
+	assert(cancelling.size() == 0);
+	NativeTimerWheel::Timer* released = timers.front();
+	pool.release(released->event);
+	cancelling.release(released);
+	timers.clear();
+
+	// released timers are reused
+	cancelling.schedule(session1, pool.acquire(Event("reused")), 1, "reused");
+	cancelling.cancelAll(session1, timers);
+	assert(timers.size() == 1);
+	assert(timers.front() == released);
+	pool.release(timers.front()->event);
+	cancelling.release(timers.front());
+	timers.clear();
+
+	// an idle wheel catches up with the clock when scheduling, not tick by tick when advancing
+	NativeTimerWheel idle;
+	std::this_thread::sleep_for(std::chrono::milliseconds(USCXML_NATIVE_WHEEL_SLOTS + 100));
+	idle.schedule(session1, pool.acquire(Event("idle")), 5, "idle");
+	assert(idle.nextExpiration() >= idle.now());
+	idle.cancelAll(session1, timers);
+	assert(timers.size() == 1);
+	assert(timers.front()->rounds == 0);
+	pool.release(timers.front()->event);
+	idle.release(timers.front());
+
+	assert(pool.available() == pool.capacity());
+
+	runtime.destroy(session1);
+	runtime.destroy(session2);
+}
+
+int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testEventPool();
+		testTimerWheel();
+	} catch (Event e) {
+		LOGD(USCXML_FATAL) << e;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+#define protected public
+#include "uscxml/config.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/datamodel/promela/PromelaDataModel.h"
+#include "uscxml/plugins/datamodel/promela/PromelaParser.h"
+#include "uscxml/interpreter/Logging.h"
+
+#include <assert.h>
+#include <iostream>
+
+using namespace uscxml;
+
+class Callbacks : public DataModelCallbacks {
+public:
+	const std::string& getName() {
+		return name;
+	}
+	const std::string& getSessionId() {
+		return sessionId;
+	}
+	const std::map<std::string, IOProcessor>& getIOProcessors() {
+		return ioProcs;
+	}
+	bool isInState(const std::string& stateId) {
+		return false;
+	}
+	XERCESC_NS::DOMDocument* getDocument() const {
+		return NULL;
+	}
+	const std::map<std::string, Invoker>& getInvokers() {
+		return invokers;
+	}
+	Logger getLogger() {
+		return Logger::getDefault();
+	}
+
+	std::string name = "test";
+	std::string sessionId = "session";
+	std::map<std::string, IOProcessor> ioProcs;
+	std::map<std::string, Invoker> invokers;
+};
+
+std::list<std::string> expressions = {
+	"1",
+	"true",
+	"'foo'",
+	"x",
+	"x + 1",
+	"x * 3 - y / 2",
+	"x % 4",
+	"x << 2",
+	"y >> 1",
+	"-x",
+	"0 - x",
+	"!x",
+	"x == 7",
+	"x < y",
+	"x <= y",
+	"x > y && y >= 0",
+	"x > 100 || arr[1] == 5",
+	"arr[0] + arr[1] * arr[2]",
+	"arr[x % 3]",
+	"_event.name",
+	"_event.data.foo",
+	"_sessionid",
+	"_name",
+};
+
+/// The expression as evaluated before the caches, from a private parse of it
+Data uncached(PromelaDataModel* dm, const std::string& expr) {
+	PromelaParser parser(expr);
+	return dm->evaluateExpr(parser.ast);
+}
+
+/// Every expression has to evaluate the same, cached or not, compiled or not
+void compareAll(PromelaDataModel* dm) {
+	for (auto& expr : expressions) {
+		Data expected;
+		bool expectedThrows = false;
+		try {
+			expected = uncached(dm, expr);
+		} catch (Event e) {
+			expectedThrows = true;
+		}
+
+		// twice, the second time from the cache
+		for (size_t i = 0; i < 2; i++) {
+			Data actual;
+			bool actualThrows = false;
+			try {
+				actual = dm->evalAsData(expr);
+			} catch (Event e) {
+				actualThrows = true;
+			}
+			if (actualThrows != expectedThrows || actual != expected || actual.type != expected.type) {
+				std::cerr << expr << ": expected " << (expectedThrows ? "an error" : expected.asJSON())
+				          << " but got " << (actualThrows ? "an error" : actual.asJSON()) << std::endl;
+				assert(false);
+			}
+			if (!expectedThrows) {
+				assert(dm->evalAsBool(expr) == dm->dataToBool(expected));
+			}
+		}
+	}
+}
+
+void testCachedMatchesUncached() {
+	Callbacks callbacks;
+	PromelaDataModel prototype;
+	std::shared_ptr<DataModelImpl> impl = prototype.create(&callbacks);
+	PromelaDataModel* dm = (PromelaDataModel*)impl.get();
+
+	// compiled before any variable is declared, all but the constants throw
+	compareAll(dm);
+
+	dm->evaluateDecl("int x = 7; int y = 12; int arr[3];");
+	compareAll(dm);
+
+	// the compiled programs see assignments
+	dm->assign("x", Data(2));
+	dm->assign("arr[1]", Data(5));
+	dm->evaluateStmnt("y = y + x;");
+	assert(dm->evalAsData("x").atom == "2");
+	assert(dm->evalAsData("x * 3 - y / 2").atom == "-1");
+	assert(dm->evalAsBool("x > 100 || arr[1] == 5"));
+	compareAll(dm);
+
+	// and redeclarations
+	dm->evaluateDecl("int x = 9;");
+	assert(dm->evalAsData("x + 1").atom == "10");
+	assert(dm->evalAsData("-x").atom == "-9");
+	compareAll(dm);
+
+	// and events
+	Event event("foo.bar");
+	event.data.compound["foo"] = Data(42);
+	dm->setEvent(event);
+	assert(dm->evalAsData("_event.name").atom == "foo.bar");
+	compareAll(dm);
+
+	event.name = "baz";
+	event.data.compound["foo"] = Data("qux", Data::VERBATIM);
+	dm->setEvent(event);
+	assert(dm->evalAsData("_event.name").atom == "baz");
+	compareAll(dm);
+}
+
+void testSessionsAreSeparate() {
+	Callbacks callbacks1;
+	Callbacks callbacks2;
+	callbacks2.sessionId = "other";
+
+	PromelaDataModel prototype;
+	std::shared_ptr<DataModelImpl> impl1 = prototype.create(&callbacks1);
+	std::shared_ptr<DataModelImpl> impl2 = prototype.create(&callbacks2);
+	PromelaDataModel* dm1 = (PromelaDataModel*)impl1.get();
+	PromelaDataModel* dm2 = (PromelaDataModel*)impl2.get();
+
+	// the AST is shared, the compiled program is not
+	dm1->evaluateDecl("int x = 1;");
+	dm2->evaluateDecl("int x = 2;");
+	assert(dm1->evalAsData("x + 1").atom == "2");
+	assert(dm2->evalAsData("x + 1").atom == "3");
+	assert(dm1->parse("x + 1") == dm2->parse("x + 1"));
+	assert(dm1->compiled("x + 1") != dm2->compiled("x + 1"));
+	assert(dm1->evalAsData("_sessionid") == uncached(dm1, "_sessionid"));
+	assert(dm2->evalAsData("_sessionid") == uncached(dm2, "_sessionid"));
+	assert(dm1->evalAsData("_sessionid") != dm2->evalAsData("_sessionid"));
+
+	// a session going away leaves the others be
+	impl1.reset();
+	assert(dm2->evalAsData("x + 1").atom == "3");
+}
+
+void testCacheBounds() {
+	Callbacks callbacks;
+	PromelaDataModel prototype;
+	std::shared_ptr<DataModelImpl> impl = prototype.create(&callbacks);
+	PromelaDataModel* dm = (PromelaDataModel*)impl.get();
+	dm->evaluateDecl("int x = 3;");
+
+	// more distinct expressions than either cache holds, results stay the same
+	for (size_t i = 0; i < 2 * PROMELA_AST_CACHE_SIZE; i++) {
+		std::string expr = "x + " + toStr(i);
+		assert(dm->evalAsData(expr).atom == toStr(i + 3));
+		assert(dm->_exprCache.size() <= PROMELA_EXPR_CACHE_SIZE);
+		assert(dm->_astCache.size() <= PROMELA_AST_CACHE_SIZE);
+	}
+	compareAll(dm);
+}
+
+int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testCachedMatchesUncached();
+		testSessionsAreSeparate();
+		testCacheBounds();
+	} catch (Event e) {
+		LOGD(USCXML_FATAL) << e;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/plugins/Factory.h"
+#include "uscxml/plugins/invoker/scxml/USCXMLInvoker.h"
+
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace uscxml;
+
+// every region invokes a child, one of them waits for an event from us
+static std::string chart(size_t nrChildren) {
+	std::stringstream ss;
+	ss << "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">";
+	ss << "  <parallel id=\"p\">";
+	for (size_t i = 0; i < nrChildren; i++) {
+		ss << "    <state id=\"r" << i << "\">";
+		ss << "      <state id=\"r" << i << ".running\">";
+		ss << "        <invoke type=\"scxml\" id=\"c" << i << "\">";
+		ss << "          <content>";
+		ss << "            <scxml datamodel=\"null\">";
+		if (i == 0) {
+			ss << "              <state id=\"waiting\">";
+			ss << "                <onentry><send target=\"#_parent\" event=\"ready\" /></onentry>";
+			ss << "                <transition event=\"ping\" target=\"done\" />";
+			ss << "              </state>";
+		} else {
+			ss << "              <state id=\"a\">";
+			ss << "                <onentry><send event=\"go\" /></onentry>";
+			ss << "                <transition event=\"go\" target=\"b\" />";
+			ss << "              </state>";
+			ss << "              <state id=\"b\">";
+			ss << "                <onentry><raise event=\"go\" /></onentry>";
+			ss << "                <transition event=\"go\" target=\"done\" />";
+			ss << "              </state>";
+		}
+		ss << "              <final id=\"done\" />";
+		ss << "            </scxml>";
+		ss << "          </content>";
+		ss << "        </invoke>";
+		if (i == 0) {
+			ss << "        <transition event=\"ready\"><send target=\"#_c0\" event=\"ping\" /></transition>";
+		}
+		ss << "        <transition event=\"done.invoke.c" << i << "\" target=\"r" << i << ".done\" />";
+		ss << "      </state>";
+		ss << "      <final id=\"r" << i << ".done\" />";
+		ss << "    </state>";
+	}
+	ss << "    <transition event=\"done.state.p\" target=\"done\" />";
+	ss << "  </parallel>";
+	ss << "  <final id=\"done\" />";
+	ss << "</scxml>";
+	return ss.str();
+}
+
+static void runToCompletion(Interpreter& interpreter) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (interpreter.step(100) != USCXML_FINISHED) {
+		assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(30));
+	}
+}
+
+void testPooledInvokers() {
+	USCXMLInvoker::setPooled(true);
+	assert(USCXMLInvoker::isPooled());
+
+	// more children than executor threads
+	Interpreter interpreter = Interpreter::fromXML(chart(32), "");
+	runToCompletion(interpreter);
+
+	USCXMLInvoker::setPooled(false);
+	assert(!USCXMLInvoker::isPooled());
+}
+
+void testCancelPooledInvokers() {
+	USCXMLInvoker::setPooled(true);
+
+	// the children never finish on their own and are cancelled when we leave
+	const char* xml =
+	    "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" datamodel=\"null\">"
+	    "  <state id=\"s\">"
+	    "    <onentry><send event=\"leave\" delay=\"200ms\" /></onentry>"
+	    "    <invoke type=\"scxml\"><content><scxml datamodel=\"null\"><state id=\"forever\" /></scxml></content></invoke>"
+	    "    <invoke type=\"scxml\"><content><scxml datamodel=\"null\"><state id=\"forever\" /></scxml></content></invoke>"
+	    "    <transition event=\"leave\" target=\"done\" />"
+	    "  </state>"
+	    "  <final id=\"done\" />"
+	    "</scxml>";
+
+	Interpreter interpreter = Interpreter::fromXML(xml, "");
+	runToCompletion(interpreter);
+
+	USCXMLInvoker::setPooled(false);
+}
+
+int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
+	try {
+		testPooledInvokers();
+		testCancelPooledInvokers();
+
+		// the same charts with a thread per child
+		Interpreter interpreter = Interpreter::fromXML(chart(4), "");
+		runToCompletion(interpreter);
+	} catch (ErrorEvent e) {
+		std::cout << e;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
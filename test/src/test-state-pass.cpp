@@ -8,6 +8,7 @@
 
 #include "uscxml/Interpreter.h"
 #include "uscxml/interpreter/InterpreterMonitor.h"
+#include "uscxml/plugins/Factory.h"
 #include "uscxml/util/DOM.h"
 #include "uscxml/util/String.h"
 #include "uscxml/util/UUID.h"
@@ -19,7 +20,9 @@
 #include "uscxml/messages/Event.h"
 #include "uscxml/server/HTTPServer.h"
 
+#include <stdlib.h> // getenv
 #include <iostream>
+#include <chrono>
 #include <queue>
 #include <condition_variable>
 
@@ -42,6 +45,12 @@ using namespace uscxml;
 int main(int argc, char** argv) {
 	size_t iterations = 1;
 
+	// benchmark the interpreter as test-gen-c does its generated machines
+	const char* envBenchmarkRuns = getenv("USCXML_BENCHMARK_ITERATIONS");
+	if (envBenchmarkRuns != NULL) {
+		iterations = strTo<size_t>(envBenchmarkRuns);
+	}
+
 	std::string documentURI;
 //	el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Format, "%datetime %level %fbase:%line: %msg");
 
@@ -62,7 +71,13 @@ int main(int argc, char** argv) {
 
 	documentURI = argv[optind];
 
+	// the basichttp I/O processors register with the server when the plugins are
 	HTTPServer::getInstance(7080, 7443);
+	Factory::getInstance().registerPlugins();
+
+	size_t benchmarkRuns = iterations;
+	size_t totalMicroSteps = 0;
+	std::chrono::steady_clock::duration stepTime(0);
 
 	while(iterations--) {
 		try {
@@ -72,13 +87,21 @@ int main(int argc, char** argv) {
 //			al.execContent = std::shared_ptr<ContentExecutorImpl>(new ContentExecutorBasic(interpreter.getImpl().get()));
 //			interpreter.setActionLanguage(al);
 
+			// logging every transition would dominate a benchmark
 			StateTransitionMonitor mon;
-			interpreter.addMonitor(&mon);
+			if (benchmarkRuns == 1)
+				interpreter.addMonitor(&mon);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
 			InterpreterState state = InterpreterState::USCXML_UNDEF;
 			while(state != USCXML_FINISHED) {
 				state = interpreter.step();
+				if (state == USCXML_MICROSTEPPED)
+					totalMicroSteps++;
 			}
+
+			stepTime += std::chrono::steady_clock::now() - start;
 			assert(interpreter.isInState("pass"));
 		} catch (Event e) {
 			std::cerr << "Thrown Event out of Interpreter: " << e;
@@ -86,5 +109,11 @@ int main(int argc, char** argv) {
 		}
 	}
 
+	if (benchmarkRuns > 1) {
+		double seconds = std::chrono::duration<double>(stepTime).count();
+		std::cout << benchmarkRuns << " runs with " << totalMicroSteps << " microsteps in " << seconds << "s: "
+		          << (seconds > 0 ? totalMicroSteps / seconds : 0) << " microsteps/s" << std::endl;
+	}
+
 	return 0;
 }
@@ -0,0 +1,271 @@
+#include "uscxml/config.h"
+#include "uscxml/util/URL.h"
+#include "uscxml/util/Convenience.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace uscxml;
+
+#ifndef _WIN32
+
+/**
+ * Stand-in for a remote SCXML session: answers every request on a
+ * keep-alive connection with an empty 200 and counts connections.
+ */
+class LoopbackServer {
+public:
+	LoopbackServer() {
+		_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+		int yes = 1;
+		setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		if (bind(_listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listenFd, 512) != 0) {
+			perror("bind");
+			exit(EXIT_FAILURE);
+		}
+
+		socklen_t len = sizeof(addr);
+		getsockname(_listenFd, (struct sockaddr*)&addr, &len);
+		port = ntohs(addr.sin_port);
+
+		_thread = std::thread(&LoopbackServer::run, this);
+	}
+
+	~LoopbackServer() {
+		_isRunning = false;
+		_thread.join();
+		close(_listenFd);
+	}
+
+	void run() {
+		std::vector<struct pollfd> fds;
+		std::unordered_map<int, std::string> buffers;
+		fds.push_back({_listenFd, POLLIN, 0});
+
+		while (_isRunning) {
+			if (poll(fds.data(), fds.size(), 50) <= 0)
+				continue;
+
+			for (size_t i = 1; i < fds.size(); i++) {
+				if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+					continue;
+
+				char chunk[16384];
+				ssize_t got = read(fds[i].fd, chunk, sizeof(chunk));
+				if (got <= 0) {
+					close(fds[i].fd);
+					buffers.erase(fds[i].fd);
+					fds[i].fd = -1;
+					continue;
+				}
+
+				std::string& buffer = buffers[fds[i].fd];
+				buffer.append(chunk, got);
+				respond(fds[i].fd, buffer);
+			}
+
+			// drop closed connections
+			fds.erase(std::remove_if(fds.begin() + 1, fds.end(), [](const struct pollfd& pfd) {
+				return pfd.fd < 0;
+			}), fds.end());
+
+			if (fds[0].revents & POLLIN) {
+				int fd = accept(_listenFd, NULL, NULL);
+				if (fd >= 0) {
+					int yes = 1;
+					setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+					fds.push_back({fd, POLLIN, 0});
+					connections++;
+				}
+			}
+		}
+
+		for (size_t i = 1; i < fds.size(); i++) {
+			close(fds[i].fd);
+		}
+	}
+
+	/// answer all complete requests in the buffer, possibly pipelined
+	void respond(int fd, std::string& buffer) {
+		static const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n";
+		while (true) {
+			size_t headerEnd = buffer.find("\r\n\r\n");
+			if (headerEnd == std::string::npos)
+				return;
+
+			size_t contentLength = 0;
+			size_t lengthStart = buffer.find("Content-Length:");
+			if (lengthStart != std::string::npos && lengthStart < headerEnd)
+				contentLength = strtoul(buffer.c_str() + lengthStart + 15, NULL, 10);
+
+			size_t requestEnd = headerEnd + 4 + contentLength;
+			if (buffer.size() < requestEnd)
+				return;
+
+			buffer.erase(0, requestEnd);
+			if (write(fd, response.data(), response.size()) < 0)
+				return;
+		}
+	}
+
+	unsigned short port = 0;
+	std::atomic<size_t> connections{0};
+
+protected:
+	int _listenFd = -1;
+	std::atomic<bool> _isRunning{true};
+	std::thread _thread;
+};
+
+/// Records the latency of every request from its fetch to its completion
+class LatencyMonitor : public URLMonitor {
+public:
+	void started(const URL& url) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_started[url.getImpl().get()] = std::chrono::steady_clock::now();
+		_inFlight++;
+	}
+
+	virtual void downloadCompleted(const URL& url) {
+		finished(url);
+	}
+
+	virtual void downloadFailed(const URL& url, int errorCode) {
+		failed++;
+		finished(url);
+	}
+
+	void finished(const URL& url) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto startIter = _started.find(url.getImpl().get());
+		if (startIter != _started.end()) {
+			latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startIter->second).count());
+			_started.erase(startIter);
+		}
+		_inFlight--;
+		_cond.notify_all();
+	}
+
+	void waitForRoom(size_t window) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_inFlight >= window)
+			_cond.wait(lock);
+	}
+
+	std::vector<double> latencies;
+	std::atomic<size_t> failed{0};
+
+protected:
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::unordered_map<URLImpl*, std::chrono::steady_clock::time_point> _started;
+	size_t _inFlight = 0;
+};
+
+double percentile(std::vector<double>& sorted, double p) {
+	if (sorted.size() == 0)
+		return 0;
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+int main(int argc, char** argv) {
+	size_t nrRequests = (argc > 1 ? strTo<size_t>(argv[1]) : 20000);
+
+	std::list<size_t> windows;
+	for (int i = 2; i < argc; i++) {
+		windows.push_back(strTo<size_t>(argv[i]));
+	}
+	if (windows.size() == 0) {
+		windows.push_back(1);
+		windows.push_back(16);
+		windows.push_back(256);
+	}
+
+	LoopbackServer server;
+	std::string target = "http://127.0.0.1:" + toStr(server.port) + "/scxml";
+
+	std::cout << std::setw(8) << "window"
+	          << std::setw(14) << "sends/s"
+	          << std::setw(12) << "p50 [ms]"
+	          << std::setw(12) << "p99 [ms]"
+	          << std::setw(12) << "p99.9 [ms]"
+	          << std::setw(12) << "max [ms]"
+	          << std::setw(14) << "connections"
+	          << std::setw(10) << "failed" << std::endl;
+
+	bool success = true;
+	for (auto window : windows) {
+		LatencyMonitor monitor;
+		size_t connectionsBefore = server.connections;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < nrRequests; i++) {
+			monitor.waitForRoom(window);
+
+			// what BasicHTTPIOProcessor::eventFromSCXML sends
+			URL url(target);
+			url.setRequestType(URLRequestType::POST);
+			url.addOutHeader("_scxmleventname", "bench.event");
+			url.addOutHeader("Content-Type", "application/x-www-form-urlencoded");
+			url.setOutContent("_scxmleventname=bench.event&seq=" + toStr(i));
+			url.addMonitor(&monitor);
+
+			monitor.started(url);
+			URLFetcher::fetchURL(url);
+		}
+		monitor.waitForRoom(1);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::sort(monitor.latencies.begin(), monitor.latencies.end());
+		std::cout << std::setw(8) << window
+		          << std::setw(14) << std::fixed << std::setprecision(0) << nrRequests / seconds
+		          << std::setw(12) << std::fixed << std::setprecision(3) << percentile(monitor.latencies, 0.5)
+		          << std::setw(12) << std::fixed << std::setprecision(3) << percentile(monitor.latencies, 0.99)
+		          << std::setw(12) << std::fixed << std::setprecision(3) << percentile(monitor.latencies, 0.999)
+		          << std::setw(12) << std::fixed << std::setprecision(3) << percentile(monitor.latencies, 1.0)
+		          << std::setw(14) << server.connections - connectionsBefore
+		          << std::setw(10) << monitor.failed << std::endl;
+
+		// one request at a time has to stay on a single kept-alive connection
+		if (monitor.failed > 0 || (window == 1 && server.connections - connectionsBefore > 1))
+			success = false;
+	}
+
+	URLFetcher::cleanup();
+	return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+#else
+
+int main(int argc, char** argv) {
+	std::cerr << "The loopback server of this benchmark is not available on windows" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+#endif
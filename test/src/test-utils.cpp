@@ -10,9 +10,22 @@
 #include "uscxml/Common.h"
 #include "uscxml/Interpreter.h"
 #include "uscxml/interpreter/InterpreterImpl.h"
+#include "uscxml/interpreter/VirtualTimeEventQueue.h"
+#include "uscxml/interpreter/PriorityEventQueue.h"
+#include "uscxml/interpreter/SessionRegistry.h"
+#include "uscxml/interpreter/AsyncLogger.h"
+#include "uscxml/plugins/Factory.h"
 #include "uscxml/util/DOM.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace uscxml;
 using namespace XERCESC_NS;
@@ -67,10 +80,314 @@ void testDOMUtils() {
 
 }
 
+class RecordingCallbacks : public DelayedEventQueueCallbacks {
+public:
+	void eventReady(Event& event, const std::string& eventId) {
+		names.push_back(event.name);
+	}
+	std::list<std::string> names;
+};
+
+class SlowCallbacks : public DelayedEventQueueCallbacks {
+public:
+	void eventReady(Event& event, const std::string& eventId) {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		finished = true;
+	}
+	std::atomic<bool> started{false};
+	std::atomic<bool> finished{false};
+};
+
+void testVirtualTime() {
+	{
+		// advancing by hand
+		std::shared_ptr<VirtualClock> clock(new VirtualClock(false));
+		RecordingCallbacks callbacks;
+		VirtualTimeDelayedEventQueue queue(&callbacks, clock);
+
+		queue.enqueueDelayed(Event("a"), 5000, "a");
+		queue.enqueueDelayed(Event("b"), 1000, "b");
+		queue.enqueueDelayed(Event("c"), 1000, "c");
+		queue.cancelDelayed("c");
+		assert(clock->pending() == 2);
+
+		clock->advance(999);
+		assert(callbacks.names.size() == 0);
+		clock->advance(1);
+		assert(callbacks.names.size() == 1 && callbacks.names.front() == "b");
+		assert(clock->advanceToNext());
+		assert(callbacks.names.back() == "a");
+		assert(clock->now() == 5000);
+		assert(!clock->advanceToNext());
+	}
+
+	{
+		// a chart waiting half an hour finishes right away
+		const char* xml =
+		    "<scxml datamodel=\"null\">"
+		    "  <state id=\"s\">"
+		    "    <onentry><send event=\"timeout\" delay=\"1800s\" /></onentry>"
+		    "    <transition event=\"timeout\" target=\"done\" />"
+		    "  </state>"
+		    "  <final id=\"done\" />"
+		    "</scxml>";
+
+		std::shared_ptr<VirtualClock> clock(new VirtualClock());
+		Interpreter interpreter = Interpreter::fromXML(xml, "");
+
+		ActionLanguage al;
+		al.externalQueue = EventQueue(std::shared_ptr<EventQueueImpl>(new VirtualTimeEventQueue(clock)));
+		al.delayQueue = DelayedEventQueue(std::shared_ptr<DelayedEventQueueImpl>(new VirtualTimeDelayedEventQueue(interpreter.getImpl().get(), clock)));
+		interpreter.setActionLanguage(al);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while(interpreter.step() != USCXML_FINISHED) {}
+
+		assert(clock->now() == 1800 * 1000);
+		assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(60));
+	}
+
+	{
+		// a queue destroyed while its event is delivered on another thread
+		std::shared_ptr<VirtualClock> clock(new VirtualClock(false));
+		SlowCallbacks callbacks;
+		VirtualTimeDelayedEventQueue* queue = new VirtualTimeDelayedEventQueue(&callbacks, clock);
+		queue->enqueueDelayed(Event("slow"), 10, "slow");
+
+		std::thread advancer([clock] {
+			clock->advanceToNext();
+		});
+		while (!callbacks.started) {
+			std::this_thread::yield();
+		}
+		delete queue;
+		assert(callbacks.finished);
+		advancer.join();
+	}
+}
+
+void testPriorityEventQueue() {
+	{
+		// control events overtake bulk events, which are rejected when full
+		PriorityEventQueue queue(2, PriorityEventQueue::REJECT);
+		queue.enqueue(Event("bulk.1"));
+		queue.enqueue(Event("bulk.2"));
+		queue.enqueue(Event("done.invoke.child"));
+
+		bool rejected = false;
+		try {
+			queue.enqueue(Event("bulk.3"));
+		} catch (ErrorEvent e) {
+			rejected = (e.name == "error.communication");
+		}
+		assert(rejected);
+
+		assert(queue.dequeue(0).name == "done.invoke.child");
+		assert(queue.dequeue(0).name == "bulk.1");
+		assert(queue.depth() == 1);
+		assert(queue.highWaterMark() == 3);
+		assert(queue.getStats()["default"].rejected == 1);
+		assert(queue.getStats()["control"].enqueued == 1);
+	}
+
+	{
+		// lanes by origin type, oldest bulk events are dropped
+		PriorityEventQueue queue(2, PriorityEventQueue::DROP_OLDEST);
+		PriorityEventQueue::Lane probes("probes");
+		probes.origintypes.push_back("probe");
+		queue.addLane(probes);
+
+		Event probe("ping");
+		probe.origintype = "probe";
+		for (size_t i = 0; i < 5; i++) {
+			queue.enqueue(Event("bulk." + toStr(i)));
+		}
+		queue.enqueue(probe);
+
+		assert(queue.dequeue(0).name == "ping");
+		assert(queue.dequeue(0).name == "bulk.3");
+		assert(queue.dequeue(0).name == "bulk.4");
+		assert(!queue.dequeue(0));
+		assert(queue.getStats()["default"].dropped == 3);
+	}
+
+	{
+		// event loops are rejected right away instead of waiting for room
+		PriorityEventQueue queue(1, PriorityEventQueue::BLOCK);
+		queue.enqueue(Event("bulk.1"));
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool rejected = false;
+		try {
+			PriorityEventQueue::NonBlockingScope nonBlocking;
+			queue.enqueue(Event("bulk.2"));
+		} catch (ErrorEvent e) {
+			rejected = true;
+		}
+		assert(rejected);
+		assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(USCXML_PRIORITY_QUEUE_BLOCK_MS / 2));
+
+		// control events are never refused
+		{
+			PriorityEventQueue::NonBlockingScope nonBlocking;
+			queue.enqueue(Event("error.communication"));
+		}
+		assert(queue.dequeue(0).name == "error.communication");
+		assert(queue.getStats()["default"].rejected == 1);
+	}
+}
+
+void testSessionRegistry() {
+	SessionRegistry registry;
+
+	{
+		// ids are unique among live sessions only
+		std::shared_ptr<InterpreterImpl> session(new InterpreterImpl());
+		assert(registry.add("a", session));
+		assert(!registry.add("a", std::shared_ptr<InterpreterImpl>(new InterpreterImpl())));
+		assert(registry.get("a") == session);
+		session.reset();
+		assert(!registry.get("a"));
+		assert(registry.size() == 0);
+	}
+
+	{
+		// concurrent register, lookup and unregister
+		const size_t nrThreads = 8;
+		const size_t nrSessions = 500;
+		std::atomic<bool> failed(false);
+		std::vector<std::thread> threads;
+
+		for (size_t t = 0; t < nrThreads; t++) {
+			threads.push_back(std::thread([&registry, &failed, t, nrThreads, nrSessions] {
+				std::vector<std::shared_ptr<InterpreterImpl> > sessions;
+				for (size_t i = 0; i < nrSessions; i++) {
+					std::shared_ptr<InterpreterImpl> session(new InterpreterImpl());
+					std::string sessionId = toStr(t) + "." + toStr(i);
+					if (!registry.add(sessionId, session) || registry.get(sessionId) != session)
+						failed = true;
+					sessions.push_back(session);
+
+					// sessions of the others are either there or not, but never wrong
+					std::string otherId = toStr((t + 1) % nrThreads) + "." + toStr(i);
+					std::shared_ptr<InterpreterImpl> other = registry.get(otherId);
+					if (other && registry.get(otherId) != other)
+						failed = true;
+
+					if (i % 2 == 1) {
+						registry.remove(toStr(t) + "." + toStr(i - 1));
+						if (registry.get(toStr(t) + "." + toStr(i - 1)))
+							failed = true;
+					}
+					if (i % 100 == 0) {
+						registry.forEach([](const std::shared_ptr<InterpreterImpl>& session) {
+							return true;
+						});
+					}
+				}
+				for (size_t i = 1; i < nrSessions; i += 2) {
+					registry.remove(toStr(t) + "." + toStr(i));
+				}
+			}));
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		assert(!failed);
+		assert(registry.size() == 0);
+	}
+}
+
+static size_t loggerEvaluations = 0;
+static Logger countedLogger() {
+	loggerEvaluations++;
+	return Logger::getDefault();
+}
+
+void testAsyncLogger() {
+	// the logger expression of the macros is evaluated once, enabled or not
+	LOG(countedLogger(), USCXML_FATAL) << "logged once" << std::endl;
+	assert(loggerEvaluations == 1);
+	LOG(countedLogger(), USCXML_SCXML) << "maybe logged" << std::endl;
+	assert(loggerEvaluations == 2);
+
+	assert(Logger::stringToSeverity("Warning") == USCXML_WARN);
+	assert(Logger::stringToSeverity("nonsense") == USCXML_SCXML);
+	assert(Logger::stringToSeverity("nonsense", USCXML_INFO) == USCXML_INFO);
+	assert(Logger::isSeverity("ERROR"));
+	assert(!Logger::isSeverity("nonsense"));
+
+	std::string path = "test-utils-async.log";
+	remove(path.c_str());
+
+	size_t nrProducers = 8;
+	size_t nrRecords = 2000;
+	{
+		AsyncLogger::Config config;
+		config.target = AsyncLogger::FILE;
+		config.path = path;
+		config.ringSize = 64;
+		config.overflow = AsyncLogger::BLOCK;
+		AsyncLogger logger(config);
+
+		// every producer flushes now and then while the others keep logging
+		std::vector<std::thread> producers;
+		for (size_t i = 0; i < nrProducers; i++) {
+			producers.push_back(std::thread([&logger, i, nrRecords]() {
+				for (size_t j = 0; j < nrRecords; j++) {
+					logger.log(USCXML_INFO, "p" + toStr(i) + " " + toStr(j) + "\n");
+					if (j % 500 == 0)
+						logger.flush();
+				}
+				logger.flush();
+			}));
+		}
+		for (auto& producer : producers)
+			producer.join();
+		assert(logger.getDropped() == 0);
+
+		// everything flushed is in the file, in order per producer
+		std::ifstream file(path.c_str());
+		std::map<size_t, size_t> next;
+		std::string line;
+		size_t lines = 0;
+		while (std::getline(file, line)) {
+			std::stringstream ss(line.substr(line.find('p') + 1));
+			size_t producer, record;
+			ss >> producer >> record;
+			assert(record == next[producer]);
+			next[producer]++;
+			lines++;
+		}
+		assert(lines == nrProducers * nrRecords);
+	}
+	remove(path.c_str());
+
+	// the rings of destroyed backends are released when this thread logs to a new one
+	for (size_t i = 0; i < 10; i++) {
+		AsyncLogger::Config config;
+		config.target = AsyncLogger::FILE;
+		config.path = path;
+		AsyncLogger logger(config);
+		logger.log(USCXML_INFO, "once\n");
+		logger.flush();
+	}
+	remove(path.c_str());
+}
+
 int main(int argc, char** argv) {
+	Factory::getInstance().registerPlugins();
+
 	try {
+		testVirtualTime();
+		testPriorityEventQueue();
+		testSessionRegistry();
+		testAsyncLogger();
 		testDOMUtils();
 	} catch (ErrorEvent e) {
 		std::cout << e;
+		return EXIT_FAILURE;
 	}
+	return EXIT_SUCCESS;
 }
@@ -0,0 +1,269 @@
+// everything InterpreterImpl.h includes from the standard library, before we widen its access
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// setupDOM() is private, we want to time the validation without downloading scripts
+#define protected public
+#define private public
+#include "uscxml/interpreter/InterpreterImpl.h"
+#undef private
+#undef protected
+
+#include "uscxml/config.h"
+#include "uscxml/Interpreter.h"
+#include "uscxml/debug/InterpreterIssue.h"
+#include "uscxml/util/Predicates.h"
+#include "uscxml/util/DOM.h"
+#include "uscxml/util/Convenience.h"
+#include "uscxml/util/String.h"
+#include "uscxml/plugins/Factory.h"
+
+using namespace uscxml;
+using namespace XERCESC_NS;
+
+/**
+ * A synthetic chart with the given number of compound states, each with a
+ * few atomic children, a history, a parallel region and transitions to
+ * far away states.
+ */
+std::string syntheticChart(size_t nrCompounds) {
+	std::stringstream ss;
+	ss << "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" datamodel=\"null\">" << std::endl;
+	for (size_t i = 0; i < nrCompounds; i++) {
+		size_t next = (i * 7919 + 1) % nrCompounds;
+		ss << "<state id=\"c" << i << "\" initial=\"c" << i << ".a\">" << std::endl;
+		ss << "  <history id=\"c" << i << ".h\" type=\"deep\"><transition target=\"c" << i << ".a\" /></history>" << std::endl;
+		ss << "  <state id=\"c" << i << ".a\">" << std::endl;
+		ss << "    <transition event=\"e." << i << "\" target=\"c" << i << ".b\" />" << std::endl;
+		ss << "    <transition event=\"jump\" target=\"c" << next << ".h\" />" << std::endl;
+		ss << "  </state>" << std::endl;
+		ss << "  <state id=\"c" << i << ".b\">" << std::endl;
+		ss << "    <onentry><log label=\"b\" /><raise event=\"r." << i << "\" /></onentry>" << std::endl;
+		ss << "    <transition event=\"r.*\" target=\"c" << i << ".p\" />" << std::endl;
+		ss << "  </state>" << std::endl;
+		ss << "  <parallel id=\"c" << i << ".p\">" << std::endl;
+		ss << "    <state id=\"c" << i << ".p1\" />" << std::endl;
+		ss << "    <state id=\"c" << i << ".p2\" />" << std::endl;
+		ss << "    <transition event=\"done\" target=\"c" << next << "\" />" << std::endl;
+		ss << "  </parallel>" << std::endl;
+		ss << "</state>" << std::endl;
+	}
+	ss << "</scxml>" << std::endl;
+	return ss.str();
+}
+
+/// Issues of the former, unindexed validation per chart, see test-validate-bench.issues
+typedef std::map<std::string, std::multiset<std::string> > Recorded;
+
+Recorded readRecorded(const std::string& path) {
+	Recorded recorded;
+	std::ifstream file(path.c_str());
+	if (!file) {
+		std::cerr << "Cannot read " << path << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// a chart per line, followed by its issues indented with a tab
+	std::string line;
+	std::multiset<std::string>* issues = NULL;
+	while (std::getline(file, line)) {
+		if (line.size() == 0 || line[0] == '#')
+			continue;
+		if (line[0] == '\t') {
+			if (issues != NULL)
+				issues->insert(line.substr(1));
+		} else {
+			issues = &recorded[line];
+		}
+	}
+	return recorded;
+}
+
+double millisSince(const std::chrono::steady_clock::time_point& start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::multiset<std::string> describe(const std::list<InterpreterIssue>& issues) {
+	std::multiset<std::string> described;
+	for (auto& issue : issues) {
+		std::stringstream ss;
+		ss << issue.severity << " " << (issue.node ? DOMUtils::xPathForNode(issue.node) : "") << " " << issue.message;
+		described.insert(ss.str());
+	}
+	return described;
+}
+
+struct Comparison {
+	size_t issues = 0;
+	double millis = 0;
+	bool recorded = false;
+	bool same = true;
+	bool skipped = false;
+};
+
+/// Validate the chart and compare with the issues recorded for it, if any
+Comparison compare(Interpreter interpreter, const Recorded& recorded, const std::string& name) {
+	Comparison comparison;
+
+	// setting up the DOM downloads scripts, this is not what we measure
+	try {
+		InterpreterImpl* impl = interpreter.getImpl().get();
+		if (impl->_factory == NULL)
+			impl->_factory = &Factory::getInstance();
+		impl->setupDOM();
+	} catch (ErrorEvent e) {
+		std::cout << "  skipped " << name << ": " << e.name << " when setting up the document" << std::endl;
+		comparison.skipped = true;
+		return comparison;
+	}
+
+	// a validation might also throw, e.g. for an unknown datamodel
+	std::multiset<std::string> issues;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	try {
+		issues = describe(interpreter.validate());
+	} catch (ErrorEvent e) {
+		issues.insert("thrown " + e.name);
+	}
+	comparison.millis = millisSince(start);
+	comparison.issues = issues.size();
+
+	auto recordedIter = recorded.find(name);
+	if (recordedIter == recorded.end())
+		return comparison;
+
+	comparison.recorded = true;
+	comparison.same = (issues == recordedIter->second);
+	if (!comparison.same) {
+		for (auto& issue : recordedIter->second) {
+			if (issues.find(issue) == issues.end())
+				std::cout << "  only recorded: " << issue << std::endl;
+		}
+		for (auto& issue : issues) {
+			if (recordedIter->second.find(issue) == recordedIter->second.end())
+				std::cout << "  only found: " << issue << std::endl;
+		}
+	}
+	return comparison;
+}
+
+void printRow(const std::string& name, size_t elements, const Comparison& comparison) {
+	std::cout << std::setw(24) << name
+	          << std::setw(10) << elements
+	          << std::setw(8) << comparison.issues
+	          << std::setw(14) << std::fixed << std::setprecision(2) << comparison.millis
+	          << std::setw(6) << (!comparison.recorded ? "-" : comparison.same ? "yes" : "NO") << std::endl;
+}
+
+size_t countElements(Interpreter interpreter) {
+	DOMElement* root = interpreter.getImpl()->getDocument()->getDocumentElement();
+	std::list<DOMNode*> elements = DOMUtils::filterChildType(DOMNode::ELEMENT_NODE, root, true);
+	return elements.size() + 1;
+}
+
+/// Charts are recorded by their datamodel directory and file name, e.g. promela/test144.scxml
+std::string chartName(const std::string& file) {
+	size_t slash = file.find_last_of("/\\");
+	if (slash == std::string::npos || slash == 0)
+		return file;
+	size_t dirSlash = file.find_last_of("/\\", slash - 1);
+	return file.substr(dirSlash == std::string::npos ? 0 : dirSlash + 1);
+}
+
+/**
+ * Times the validation on synthetic charts of the given sizes (in compound
+ * states) and on the given SCXML files, e.g. the W3C tests. Issues are
+ * compared with those the former validation found on the same charts.
+ */
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " ISSUES [SIZE|FILE]..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Factory::getInstance().registerPlugins();
+	Recorded recorded = readRecorded(argv[1]);
+
+	std::list<size_t> sizes;
+	std::list<std::string> files;
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		if (isNumeric(arg.c_str(), 10)) {
+			sizes.push_back(strTo<size_t>(arg));
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (argc == 2) {
+		sizes.push_back(10);
+		sizes.push_back(100);
+		sizes.push_back(500);
+		sizes.push_back(2000);
+	}
+
+	std::cout << std::setw(24) << "chart"
+	          << std::setw(10) << "elements"
+	          << std::setw(8) << "issues"
+	          << std::setw(14) << "time [ms]"
+	          << std::setw(6) << "same" << std::endl;
+
+	bool allSame = true;
+	for (auto size : sizes) {
+		std::string xml = syntheticChart(size);
+		std::string name = "synthetic." + toStr(size);
+		Comparison comparison = compare(Interpreter::fromXML(xml, ""), recorded, name);
+		printRow(name, countElements(Interpreter::fromXML(xml, "")), comparison);
+		allSame &= comparison.same;
+	}
+
+	if (files.size() > 0) {
+		Comparison total;
+		size_t elements = 0;
+		size_t charts = 0;
+		size_t compared = 0;
+		for (auto file : files) {
+			Interpreter interpreter;
+			try {
+				interpreter = Interpreter::fromURL(file);
+			} catch (ErrorEvent e) {
+				// e.g. not well-formed on purpose
+				continue;
+			}
+			std::string name = chartName(file);
+			Comparison comparison = compare(interpreter, recorded, name);
+			if (comparison.skipped)
+				continue;
+			if (!comparison.same) {
+				printRow(name, countElements(interpreter), comparison);
+				allSame = false;
+			}
+			total.issues += comparison.issues;
+			total.millis += comparison.millis;
+			total.same &= comparison.same;
+			total.recorded |= comparison.recorded;
+			compared += (comparison.recorded ? 1 : 0);
+			elements += countElements(interpreter);
+			charts++;
+		}
+		printRow(toStr(charts) + " charts", elements, total);
+		std::cout << compared << " of them compared with recorded issues" << std::endl;
+	}
+
+	return (allSame ? EXIT_SUCCESS : EXIT_FAILURE);
+}